@@ -0,0 +1,27 @@
+#!/bin/bash
+
+# 以train_pcm目录下的音频为目录，test_pcm目录下的音频为查询，运行端到端评测
+# test_pcm没有真值，查询标注为?，只参与性能统计；--self-queries用目录音频本身提供有真值的正样本
+
+PCM_FILES=$(find test_pcm -name "*.pcm" -type f)
+CATALOG_FILES=$(find train_pcm -name "*.pcm" -type f)
+
+if [ -z "$CATALOG_FILES" ]; then
+    echo "错误：在train_pcm目录下未找到PCM文件"
+    exit 1
+fi
+
+# 生成评测清单（路径相对于清单所在目录）
+MANIFEST="eval_manifest.txt"
+: > "$MANIFEST"
+for file in $CATALOG_FILES; do
+    echo "catalog $(basename "$file" .pcm) $file" >> "$MANIFEST"
+done
+for file in $PCM_FILES; do
+    echo "query $file ?" >> "$MANIFEST"
+done
+
+CMD="./build/afp_eval $MANIFEST --output eval_results.json --self-queries $*"
+
+echo "执行命令: $CMD"
+$CMD
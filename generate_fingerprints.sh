@@ -8,7 +8,7 @@ if [ -z "$PCM_FILES" ]; then
 fi
 
 # 构建命令行参数
-CMD="./build/AFingerprint generate shazam fingerprints.db"
+CMD="./build/AFingerprint generate shazam fingerprints.db --jobs 0"
 
 # 添加所有找到的PCM文件作为输入参数
 for file in $PCM_FILES; do
@@ -0,0 +1,179 @@
+#include "bench/bench_inputs.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include "afp/afp_interface.h"
+
+namespace afp::bench {
+
+namespace {
+
+constexpr uint32_t kSampleRate = 44100;
+
+BenchOptions& mutableOptions() {
+    static BenchOptions options;
+    return options;
+}
+
+// 与性能校准相同的合成音频：两个调频的音调加上固定种子的噪声，频谱中有持续变化的峰值
+std::vector<float> synthesizeAudio(double seconds) {
+    const size_t frame_count = static_cast<size_t>(seconds * kSampleRate);
+    std::vector<float> audio(frame_count);
+    uint32_t noise_state = 0x12345678u;
+    for (size_t i = 0; i < frame_count; ++i) {
+        const double t = static_cast<double>(i) / kSampleRate;
+        noise_state = noise_state * 1664525u + 1013904223u;
+        const double noise = (static_cast<double>(noise_state >> 8) / (1u << 24) - 0.5) * 0.12;
+        const double tone1 = 0.18 * std::sin(2.0 * M_PI * (440.0 + 200.0 * std::sin(t)) * t);
+        const double tone2 = 0.12 * std::sin(2.0 * M_PI * 1234.0 * t * (1.0 + 0.1 * std::sin(3.0 * t)));
+        audio[i] = static_cast<float>(tone1 + tone2 + noise);
+    }
+    return audio;
+}
+
+// 按文件名顺序拼接pcmDir中的S16小端单声道录音，直到满足时长
+std::vector<float> loadTestPcm(const std::string& pcm_dir, double seconds) {
+    namespace fs = std::filesystem;
+    std::error_code error;
+    if (!fs::is_directory(pcm_dir, error)) {
+        std::cerr << "test_pcm目录不存在: " << pcm_dir << std::endl;
+        return {};
+    }
+
+    std::vector<fs::path> files;
+    for (const auto& entry : fs::directory_iterator(pcm_dir, error)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".pcm") {
+            files.push_back(entry.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+
+    const size_t frame_count = static_cast<size_t>(seconds * kSampleRate);
+    std::vector<float> audio;
+    audio.reserve(frame_count);
+    for (const auto& file : files) {
+        std::ifstream input(file, std::ios::binary);
+        std::vector<char> bytes((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+        for (size_t i = 0; i + 1 < bytes.size() && audio.size() < frame_count; i += 2) {
+            int16_t value;
+            std::memcpy(&value, bytes.data() + i, sizeof(value));
+            audio.push_back(static_cast<float>(value) / 32768.0f);
+        }
+        if (audio.size() >= frame_count) {
+            break;
+        }
+    }
+    if (audio.empty()) {
+        std::cerr << "test_pcm目录中没有可用的.pcm文件: " << pcm_dir << std::endl;
+    }
+    return audio;
+}
+
+template<typename T>
+void appendLittleEndian(std::vector<uint8_t>& out, T value, size_t bytes = sizeof(T)) {
+    uint8_t raw[sizeof(T)];
+    std::memcpy(raw, &value, sizeof(T));
+    out.insert(out.end(), raw, raw + bytes);
+}
+
+} // namespace
+
+const BenchOptions& benchOptions() {
+    return mutableOptions();
+}
+
+void setBenchOptions(BenchOptions options) {
+    mutableOptions() = std::move(options);
+}
+
+const char* audioSourceName(AudioSource source) {
+    return source == AudioSource::Synthetic ? "synthetic" : "test_pcm";
+}
+
+const std::vector<float>& benchAudio(AudioSource source) {
+    if (source == AudioSource::Synthetic) {
+        static const std::vector<float> synthetic = synthesizeAudio(benchOptions().audioSeconds);
+        return synthetic;
+    }
+    static const std::vector<float> recorded = loadTestPcm(benchOptions().pcmDir, benchOptions().audioSeconds);
+    return recorded;
+}
+
+std::vector<uint8_t> encodePcm(const std::vector<float>& samples, SampleFormat format, uint32_t channels) {
+    PCMFormat pcm_format(kSampleRate, format, channels);
+    std::vector<uint8_t> out;
+    out.reserve(samples.size() * pcm_format.frameSize());
+    for (float sample : samples) {
+        const double value = std::max(-1.0, std::min(1.0 - 1e-9, static_cast<double>(sample)));
+        for (uint32_t channel = 0; channel < channels; ++channel) {
+            switch (format) {
+                case SampleFormat::S8:  appendLittleEndian(out, static_cast<int8_t>(value * 128.0)); break;
+                case SampleFormat::U8:  appendLittleEndian(out, static_cast<uint8_t>(value * 128.0 + 128.0)); break;
+                case SampleFormat::S16: appendLittleEndian(out, static_cast<int16_t>(value * 32768.0)); break;
+                case SampleFormat::U16: appendLittleEndian(out, static_cast<uint16_t>(value * 32768.0 + 32768.0)); break;
+                case SampleFormat::S24: appendLittleEndian(out, static_cast<int32_t>(value * 8388608.0), 3); break;
+                case SampleFormat::U24: appendLittleEndian(out, static_cast<uint32_t>(value * 8388608.0 + 8388608.0), 3); break;
+                case SampleFormat::S32: appendLittleEndian(out, static_cast<int32_t>(value * 2147483648.0)); break;
+                case SampleFormat::U32: appendLittleEndian(out, static_cast<uint32_t>(value * 2147483648.0 + 2147483648.0)); break;
+                case SampleFormat::F32: appendLittleEndian(out, static_cast<float>(value)); break;
+                case SampleFormat::F64: appendLittleEndian(out, value); break;
+            }
+        }
+    }
+    return out;
+}
+
+PCMFormat benchFormat(uint32_t channels) {
+    return PCMFormat(kSampleRate, SampleFormat::S16, channels, Endianness::Little,
+                     channels == 1 ? ChannelLayout::Mono : ChannelLayout::Stereo);
+}
+
+const char* sampleFormatName(SampleFormat format) {
+    switch (format) {
+        case SampleFormat::S8:  return "S8";
+        case SampleFormat::U8:  return "U8";
+        case SampleFormat::S16: return "S16";
+        case SampleFormat::U16: return "U16";
+        case SampleFormat::S24: return "S24";
+        case SampleFormat::U24: return "U24";
+        case SampleFormat::S32: return "S32";
+        case SampleFormat::U32: return "U32";
+        case SampleFormat::F32: return "F32";
+        case SampleFormat::F64: return "F64";
+    }
+    return "unknown";
+}
+
+BenchConfig::BenchConfig(const IPerformanceConfig& base)
+    : fft(base.getFFTConfig())
+    , peakDetection(base.getPeakDetectionConfig())
+    , signatureGeneration(base.getSignatureGenerationConfig())
+    , matching(base.getMatchingConfig()) {
+}
+
+std::shared_ptr<BenchConfig> makeBenchConfig(PlatformType platform, size_t fftSize) {
+    auto config = std::make_shared<BenchConfig>(*interface::createPerformanceConfig(platform));
+    if (fftSize != 0) {
+        config->fft.fftSize = fftSize;
+        config->fft.hopSize = fftSize / 4;
+        config->fft.enableDecimation = false;
+    }
+    return config;
+}
+
+std::vector<SignaturePoint> generateSignature(const std::vector<float>& samples,
+                                              std::shared_ptr<IPerformanceConfig> config) {
+    auto generator = interface::createSignatureGenerator(config);
+    if (!generator->init(benchFormat(1))) {
+        return {};
+    }
+    const auto pcm = encodePcm(samples, SampleFormat::S16, 1);
+    generator->appendStreamBuffer(pcm.data(), pcm.size(), 0.0);
+    generator->flush();
+    return generator->takeSignature();
+}
+
+} // namespace afp::bench
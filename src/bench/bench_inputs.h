@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "afp/iperformance_config.h"
+#include "afp/isignature_generator.h"
+#include "afp/pcm_format.h"
+
+namespace afp::bench {
+
+// 命令行参数（--afp_*），在Google Benchmark解析完自己的参数之后读取
+struct BenchOptions {
+    std::string pcmDir;                     // test_pcm目录，默认为源码树中的test_pcm
+    std::vector<size_t> catalogSizes;       // 匹配基准的目录规模（媒体项数）
+    double audioSeconds = 10.0;             // 每个输入音频的时长（秒）
+};
+
+const BenchOptions& benchOptions();
+void setBenchOptions(BenchOptions options);
+
+// 输入音频的来源：合成的调频音调加噪声，或test_pcm中的录音
+enum class AudioSource {
+    Synthetic,
+    TestPcm,
+};
+
+const char* audioSourceName(AudioSource source);
+
+// 44100Hz单声道的输入音频，首次使用时生成或读取，之后复用；test_pcm不可用时返回空
+const std::vector<float>& benchAudio(AudioSource source);
+
+// 把[-1, 1]的单声道样本按format编码为小端交错的PCM数据，每个通道写入相同的样本
+std::vector<uint8_t> encodePcm(const std::vector<float>& samples, SampleFormat format, uint32_t channels);
+
+// 对应的S16小端PCM格式
+PCMFormat benchFormat(uint32_t channels);
+
+const char* sampleFormatName(SampleFormat format);
+
+// 可修改各项配置的IPerformanceConfig，由某个平台的配置复制而来
+class BenchConfig : public IPerformanceConfig {
+public:
+    explicit BenchConfig(const IPerformanceConfig& base);
+
+    const FFTConfig& getFFTConfig() const override { return fft; }
+    const PeakDetectionConfig& getPeakDetectionConfig() const override { return peakDetection; }
+    const SignatureGenerationConfig& getSignatureGenerationConfig() const override { return signatureGeneration; }
+    const MatchingConfig& getMatchingConfig() const override { return matching; }
+
+    FFTConfig fft;
+    PeakDetectionConfig peakDetection;
+    SignatureGenerationConfig signatureGeneration;
+    MatchingConfig matching;
+};
+
+// 平台配置的副本；fftSize不为0时改用该FFT大小（帧移为其1/4）并关闭降采样，使FFT阶段按该大小变换
+std::shared_ptr<BenchConfig> makeBenchConfig(PlatformType platform, size_t fftSize = 0);
+
+// 用完整的指纹生成器为一段音频生成指纹
+std::vector<SignaturePoint> generateSignature(const std::vector<float>& samples,
+                                              std::shared_ptr<IPerformanceConfig> config);
+
+} // namespace afp::bench
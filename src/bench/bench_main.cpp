@@ -0,0 +1,89 @@
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "bench/bench_inputs.h"
+#include "bench/bench_registry.h"
+
+#ifndef AFP_BENCH_DEFAULT_PCM_DIR
+#define AFP_BENCH_DEFAULT_PCM_DIR "test_pcm"
+#endif
+
+namespace {
+
+void printUsage() {
+    std::cerr << "afp_bench [Google Benchmark参数] [--afp_pcm_dir=<目录>] [--afp_catalog_sizes=<n,n,...>] "
+                 "[--afp_audio_seconds=<秒>]" << std::endl;
+}
+
+bool parseCatalogSizes(const std::string& value, std::vector<size_t>& sizes) {
+    sizes.clear();
+    std::stringstream stream(value);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        char* end = nullptr;
+        const unsigned long long size = std::strtoull(item.c_str(), &end, 10);
+        if (item.empty() || *end != '\0' || size == 0) {
+            return false;
+        }
+        sizes.push_back(static_cast<size_t>(size));
+    }
+    return !sizes.empty();
+}
+
+// 解析Google Benchmark没有识别的--afp_*参数，其余参数视为错误
+bool parseOptions(int argc, char** argv, afp::bench::BenchOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const auto value_of = [&arg](const char* prefix) -> const char* {
+            const size_t length = std::strlen(prefix);
+            return arg.compare(0, length, prefix) == 0 ? arg.c_str() + length : nullptr;
+        };
+
+        if (const char* value = value_of("--afp_pcm_dir=")) {
+            options.pcmDir = value;
+        } else if (const char* value = value_of("--afp_catalog_sizes=")) {
+            if (!parseCatalogSizes(value, options.catalogSizes)) {
+                std::cerr << "无效的目录规模: " << value << std::endl;
+                return false;
+            }
+        } else if (const char* value = value_of("--afp_audio_seconds=")) {
+            options.audioSeconds = std::atof(value);
+            if (options.audioSeconds <= 0.0) {
+                std::cerr << "无效的音频时长: " << value << std::endl;
+                return false;
+            }
+        } else {
+            std::cerr << "未知参数: " << arg << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+
+    afp::bench::BenchOptions options;
+    options.pcmDir = AFP_BENCH_DEFAULT_PCM_DIR;
+    options.catalogSizes = {16, 256, 4096};
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+    afp::bench::setBenchOptions(std::move(options));
+
+    afp::bench::registerPCMReaderBenchmarks();
+    afp::bench::registerFftBenchmarks();
+    afp::bench::registerPeakBenchmarks();
+    afp::bench::registerHashBenchmarks();
+    afp::bench::registerMatcherBenchmarks();
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
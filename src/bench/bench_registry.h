@@ -0,0 +1,12 @@
+#pragma once
+
+namespace afp::bench {
+
+// 各组基准按命令行参数（目录规模、输入目录等）注册，在bench_main中依次调用
+void registerPCMReaderBenchmarks();
+void registerFftBenchmarks();
+void registerPeakBenchmarks();
+void registerHashBenchmarks();
+void registerMatcherBenchmarks();
+
+} // namespace afp::bench
@@ -0,0 +1,141 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <complex>
+#include <memory>
+#include <string>
+#include <vector>
+#include "bench/bench_inputs.h"
+#include "bench/bench_registry.h"
+#include "bench/short_frame_capture.h"
+#include "fft/fft_interface.h"
+#include "signature_generation_pipeline/phase/fft_phase.h"
+#if !defined(__APPLE__) && !defined(__ANDROID__)
+#include "fft/fft_native.h"
+#if defined(AFP_HAVE_FFTW)
+#include "fft/fft_fftw.h"
+#endif
+#endif
+
+namespace afp::bench {
+
+namespace {
+
+constexpr size_t kFftSizes[] = {512, 1024, 2048, 4096, 8192};
+constexpr size_t kBatchWindows = 8;
+constexpr size_t kMaxPreparedBatches = 32;
+
+using FftCreator = std::unique_ptr<FFTInterface> (*)(size_t size);
+
+template<typename T>
+std::unique_ptr<FFTInterface> createBackend(size_t size) {
+    auto fft = std::make_unique<T>();
+    if (!fft->init(size)) {
+        return nullptr;
+    }
+    return fft;
+}
+
+struct FftBackend {
+    const char* name;
+    FftCreator create;
+};
+
+// factory是当前平台上FFTFactory选择的后端，其余是可以单独创建的后端
+const FftBackend kFftBackends[] = {
+    {"factory", [](size_t size) { return FFTFactory::create(size); }},
+    {"fixed_point", [](size_t size) { return FFTFactory::createFixedPoint(size); }},
+#if !defined(__APPLE__) && !defined(__ANDROID__)
+    {"native", createBackend<NativeFFT>},
+#if defined(AFP_HAVE_FFTW)
+    {"fftw", createBackend<FFTWFFT>},
+#endif
+#endif
+};
+
+// 每次批量变换kBatchWindows个相邻帧移的窗口，与FFT阶段一次收集多个窗口的用法相同
+void BM_FftTransformBatch(benchmark::State& state, FftBackend backend, AudioSource source, size_t fft_size) {
+    const auto& audio = benchAudio(source);
+    const size_t hop_size = fft_size / 4;
+    if (audio.size() < fft_size + hop_size * kBatchWindows) {
+        state.SkipWithError("input audio unavailable");
+        return;
+    }
+    auto fft = backend.create(fft_size);
+    if (!fft) {
+        state.SkipWithError("backend does not support this size");
+        return;
+    }
+
+    // 预先切好若干批窗口，循环使用，计时内只有变换本身
+    const size_t batch_count = std::min<size_t>(kMaxPreparedBatches,
+                                                (audio.size() - fft_size) / (hop_size * kBatchWindows));
+    std::vector<float> inputs(fft_size * kBatchWindows * batch_count);
+    for (size_t window = 0; window < kBatchWindows * batch_count; ++window) {
+        std::copy_n(audio.data() + window * hop_size, fft_size, inputs.data() + window * fft_size);
+    }
+    std::vector<std::complex<float>> outputs((fft_size / 2 + 1) * kBatchWindows);
+
+    size_t batch = 0;
+    for (auto _ : state) {
+        fft->transformBatch(inputs.data() + batch * fft_size * kBatchWindows, kBatchWindows, outputs.data());
+        benchmark::DoNotOptimize(outputs.data());
+        benchmark::ClobberMemory();
+        batch = batch + 1 == batch_count ? 0 : batch + 1;
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * kBatchWindows));
+}
+
+// 只计数的短帧接收方，使FFT阶段的测量不含峰值检测
+class CountingShortFrameConsumer : public IShortFrameConsumer {
+public:
+    void handleShortFrames(const ChannelArray<SpectrogramView>& short_frames) override {
+        frames += short_frames[0].size();
+    }
+    void flush() override {}
+
+    size_t frames = 0;
+};
+
+// 整段音频按通道缓冲区的大小依次送入FFT阶段（加窗、静音判断、批量变换和对数幅度谱）
+void BM_FftPhase(benchmark::State& state, AudioSource source, size_t fft_size) {
+    const auto& audio = benchAudio(source);
+    if (audio.empty()) {
+        state.SkipWithError("input audio unavailable");
+        return;
+    }
+
+    auto config = makeBenchConfig(PlatformType::Desktop, fft_size);
+    auto ctx = makeBenchCtx(config);
+    FftPhase phase(ctx.get());
+    CountingShortFrameConsumer consumer;
+    phase.attach(&consumer);
+
+    const size_t chunk = ctx->channel_buffer_sample_count;
+    for (auto _ : state) {
+        for (size_t offset = 0; offset + chunk <= audio.size(); offset += chunk) {
+            std::copy_n(audio.data() + offset, chunk, ctx->channel_samples[0]);
+            phase.handleSamples(ctx->channel_samples, chunk, 0.0);
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * (audio.size() / chunk) * chunk));
+    state.counters["short_frames"] = benchmark::Counter(static_cast<double>(consumer.frames), benchmark::Counter::kAvgIterations);
+}
+
+} // namespace
+
+void registerFftBenchmarks() {
+    for (auto source : {AudioSource::Synthetic, AudioSource::TestPcm}) {
+        for (size_t fft_size : kFftSizes) {
+            for (const auto& backend : kFftBackends) {
+                const std::string name = std::string("FFT/transformBatch/") + backend.name + "/"
+                                       + audioSourceName(source) + "/size:" + std::to_string(fft_size);
+                benchmark::RegisterBenchmark(name.c_str(), BM_FftTransformBatch, backend, source, fft_size);
+            }
+            const std::string name = std::string("FftPhase/handleSamples/") + audioSourceName(source)
+                                   + "/size:" + std::to_string(fft_size);
+            benchmark::RegisterBenchmark(name.c_str(), BM_FftPhase, source, fft_size);
+        }
+    }
+}
+
+} // namespace afp::bench
@@ -0,0 +1,46 @@
+#include <benchmark/benchmark.h>
+#include <string>
+#include "bench/bench_registry.h"
+#include "bench/short_frame_capture.h"
+
+namespace afp::bench {
+
+namespace {
+
+// hash计算阶段（handleFrame中逐个长帧的consumeFrame：三帧组合枚举、评分和跨通道去重）的独占时间
+// 长帧由重放短帧时的峰值检测和长帧构建阶段生成，它们的耗时不计入
+// 降级级别按倍数减小每个三帧窗口的组合数和对称帧范围
+void BM_HashComputationPhase(benchmark::State& state, AudioSource source) {
+    const auto& captured = capturedShortFrames(source);
+    if (captured.batches.empty()) {
+        state.SkipWithError("input audio unavailable");
+        return;
+    }
+
+    const size_t degradation_level = static_cast<size_t>(state.range(0));
+    uint64_t frames_in = 0;
+    uint64_t points_out = 0;
+    for (auto _ : state) {
+        const auto stats = replayShortFrames(captured, degradation_level);
+        state.SetIterationTime(static_cast<double>(stats.hashComputation.nanoseconds) * 1e-9);
+        frames_in += stats.hashComputation.itemsIn;
+        points_out += stats.hashComputation.itemsOut;
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(frames_in));
+    state.counters["points_per_frame"] = frames_in ? static_cast<double>(points_out) / frames_in : 0.0;
+}
+
+} // namespace
+
+void registerHashBenchmarks() {
+    for (auto source : {AudioSource::Synthetic, AudioSource::TestPcm}) {
+        const std::string name = std::string("HashComputationPhase/consumeFrame/") + audioSourceName(source);
+        benchmark::RegisterBenchmark(name.c_str(), BM_HashComputationPhase, source)
+            ->ArgName("degradation")
+            ->DenseRange(0, static_cast<int64_t>(SignatureGenerationPipelineCtx::kMaxDegradationLevel))
+            ->UseManualTime()
+            ->Unit(benchmark::kMillisecond);
+    }
+}
+
+} // namespace afp::bench
@@ -0,0 +1,265 @@
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "afp/afp_interface.h"
+#include "bench/bench_inputs.h"
+#include "bench/bench_registry.h"
+#include "catalog/catalog.h"
+#include "signature/session_score_heap.h"
+#include "signature/signature_matcher.h"
+
+namespace afp::bench {
+
+namespace {
+
+// 查询按流式输入的节奏分批送入，每批是这段时长内新生成的指纹点
+constexpr double kQueryBatchSeconds = 1.0;
+
+// 计时期间丢弃std::cout的输出：匹配器构建时按默认日志级别打印目录信息
+class ScopedSilentCout {
+public:
+    ScopedSilentCout() : previous_(std::cout.rdbuf(sink_.rdbuf())) {}
+    ~ScopedSilentCout() { std::cout.rdbuf(previous_); }
+
+private:
+    std::ostringstream sink_;
+    std::streambuf* previous_;
+};
+
+struct BenchCatalog {
+    std::shared_ptr<IPerformanceConfig> config;
+    std::shared_ptr<Catalog> catalog;
+    std::vector<SignaturePoint> query;      // 第0个媒体项的指纹，作为查询
+    size_t postingCount = 0;
+};
+
+// 第0个媒体项是输入音频真实生成的指纹，其余是由它派生的干扰项：
+// 每个点以1/16的概率保留原hash（制造与查询的偶然命中），否则换成伪随机hash，时间戳随机打乱
+BenchCatalog buildCatalog(AudioSource source, size_t catalog_size) {
+    BenchCatalog bench_catalog;
+    bench_catalog.config = makeBenchConfig(PlatformType::Desktop);
+    bench_catalog.catalog = std::make_shared<Catalog>();
+
+    const auto& audio = benchAudio(source);
+    if (audio.empty()) {
+        return bench_catalog;
+    }
+    bench_catalog.query = generateSignature(audio, bench_catalog.config);
+    if (bench_catalog.query.empty()) {
+        return bench_catalog;
+    }
+
+    const double duration = static_cast<double>(audio.size()) / 44100.0;
+    uint32_t state = 0x9E3779B9u;
+    auto next = [&state]() {
+        state = state * 1664525u + 1013904223u;
+        return state;
+    };
+
+    for (size_t item = 0; item < catalog_size; ++item) {
+        std::vector<SignaturePoint> signature = bench_catalog.query;
+        if (item != 0) {
+            for (auto& point : signature) {
+                if ((next() >> 28) != 0) {
+                    point.hash = next();
+                }
+                point.timestamp = duration * (next() >> 8) / static_cast<double>(1u << 24);
+            }
+        }
+        MediaItem media_item;
+        media_item.setTitle("bench_" + std::to_string(item));
+        media_item.setChannelCount(1);
+        bench_catalog.catalog->addSignature(signature, media_item);
+        bench_catalog.postingCount += signature.size();
+    }
+    return bench_catalog;
+}
+
+const BenchCatalog& benchCatalog(AudioSource source, size_t catalog_size) {
+    static std::map<std::pair<AudioSource, size_t>, BenchCatalog> cache;
+    const auto key = std::make_pair(source, catalog_size);
+    auto it = cache.find(key);
+    if (it == cache.end()) {
+        it = cache.emplace(key, buildCatalog(source, catalog_size)).first;
+    }
+    return it->second;
+}
+
+// 构建匹配器：shared_index为false时包含倒排索引的构建，为true时复用预先构建的共享索引
+void BM_SignatureMatcherConstruct(benchmark::State& state, AudioSource source, bool shared_index) {
+    const auto& bench_catalog = benchCatalog(source, static_cast<size_t>(state.range(0)));
+    if (bench_catalog.query.empty()) {
+        state.SkipWithError("input audio unavailable");
+        return;
+    }
+
+    std::shared_ptr<const ICatalogIndex> index;
+    if (shared_index) {
+        index = interface::createCatalogIndex(bench_catalog.catalog, bench_catalog.config);
+    }
+
+    ScopedSilentCout silent;
+    for (auto _ : state) {
+        SignatureMatcher matcher(bench_catalog.catalog, bench_catalog.config, index);
+        benchmark::DoNotOptimize(&matcher);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * bench_catalog.postingCount));
+}
+
+// 把第0个媒体项的指纹按kQueryBatchSeconds分批查询，每次迭代前清空session
+void BM_ProcessQuerySignature(benchmark::State& state, AudioSource source) {
+    const auto& bench_catalog = benchCatalog(source, static_cast<size_t>(state.range(0)));
+    if (bench_catalog.query.empty()) {
+        state.SkipWithError("input audio unavailable");
+        return;
+    }
+
+    std::vector<std::vector<SignaturePoint>> batches;
+    for (const auto& point : bench_catalog.query) {
+        const size_t batch = static_cast<size_t>(point.timestamp / kQueryBatchSeconds);
+        if (batches.size() <= batch) {
+            batches.resize(batch + 1);
+        }
+        batches[batch].push_back(point);
+    }
+
+    std::unique_ptr<SignatureMatcher> matcher;
+    {
+        ScopedSilentCout silent;
+        matcher = std::make_unique<SignatureMatcher>(bench_catalog.catalog, bench_catalog.config);
+    }
+    matcher->setLogLevel(MatcherLogLevel::Quiet);
+    matcher->setMatchResultSink([](MatchResult&&) {});
+
+    uint64_t posting_hits = 0;
+    for (auto _ : state) {
+        matcher->reset();
+        for (const auto& batch : batches) {
+            matcher->processQuerySignature(batch, 1);
+            posting_hits += matcher->lastStats().postingHitCount;
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * bench_catalog.query.size()));
+    state.counters["posting_hits"] = benchmark::Counter(static_cast<double>(posting_hits), benchmark::Counter::kAvgIterations);
+}
+
+// session表满时的淘汰：每次有一个新session到达，淘汰分数最低的session。
+// 分数按SignatureMatcher的评分公式模拟：大部分session只有一次匹配，最后匹配时间均匀分布在过期时间内，
+// 每次淘汰前随机一个session新增一次匹配。计数器rescored_per_eviction是每次淘汰重新计算分数的session数
+void BM_SessionEviction(benchmark::State& state) {
+    constexpr double kExpireSeconds = 10.0;
+    constexpr double kHalfLife = kExpireSeconds / 3.0;
+    const size_t session_count = static_cast<size_t>(state.range(0));
+    const double arrival_interval = kExpireSeconds / static_cast<double>(session_count);
+
+    struct Session {
+        uint32_t matchCount;
+        uint32_t maxPossibleMatches;
+        double consistency;
+        double lastMatchTime;
+        uint32_t version;
+    };
+    uint32_t rng = 0x9E3779B9u;
+    auto next = [&rng]() {
+        rng = rng * 1664525u + 1013904223u;
+        return rng >> 8;
+    };
+    auto base_score = [](const Session& session) {
+        const double density = std::min(1.0, static_cast<double>(session.matchCount) / session.maxPossibleMatches);
+        const double count = std::log(1.0 + std::min(static_cast<double>(session.matchCount), 100.0)) / std::log(101.0);
+        return 0.1 * density + 0.50 * count + 0.05 * session.consistency;
+    };
+    auto activity = [](double lastMatchTime, double now) {
+        return now >= lastMatchTime ? 0.35 * std::exp(-(now - lastMatchTime) * std::log(2.0) / kHalfLife) : 0.0;
+    };
+    auto new_session = [&](double now) {
+        return Session{1, 200 + next() % 1800, 1.0, now, 0};
+    };
+
+    std::vector<Session> sessions;
+    double now = 0.0;
+    for (size_t i = 0; i < session_count; ++i) {
+        now += arrival_interval;
+        sessions.push_back(new_session(now));
+        if (next() % 4 == 0) {
+            sessions.back().matchCount += 1 + next() % 4;
+            sessions.back().consistency = 0.5 + (next() % 1000) / 2000.0;
+        }
+    }
+
+    SessionScoreHeap heap;
+    auto rebuild = [&]() {
+        heap.clear();
+        for (size_t handle = 0; handle < sessions.size(); ++handle) {
+            heap.append(base_score(sessions[handle]), sessions[handle].lastMatchTime,
+                        static_cast<SessionTable::Handle>(handle), sessions[handle].version);
+        }
+        heap.build();
+    };
+    auto update = [&](size_t handle) {
+        auto& session = sessions[handle];
+        ++session.version;
+        heap.push(base_score(session), session.lastMatchTime, static_cast<SessionTable::Handle>(handle), session.version);
+    };
+    rebuild();
+
+    uint64_t rescored = 0;
+    uint64_t evictions = 0;
+    for (auto _ : state) {
+        now += arrival_interval;
+        const size_t matched = next() % session_count;
+        sessions[matched].matchCount += 1;
+        sessions[matched].lastMatchTime = now;
+        update(matched);
+
+        const auto lowest = heap.findLowest(
+            [&](SessionTable::Handle handle, uint32_t version) { return sessions[handle].version == version; },
+            [&](SessionTable::Handle handle) {
+                ++rescored;
+                return base_score(sessions[handle]) + activity(sessions[handle].lastMatchTime, now);
+            },
+            [&](double lastMatchTime) { return activity(lastMatchTime, now); });
+        const uint32_t version = sessions[lowest].version;
+        sessions[lowest] = new_session(now);
+        sessions[lowest].version = version;
+        update(lowest);
+        ++evictions;
+
+        // 与SignatureMatcher::prepareScoreHeaps相同，过期条目过多时重建
+        if (heap.size() > 2 * session_count + 64) {
+            rebuild();
+        }
+    }
+    state.counters["rescored_per_eviction"] = static_cast<double>(rescored) / std::max<uint64_t>(1, evictions);
+}
+
+} // namespace
+
+void registerMatcherBenchmarks() {
+    for (auto source : {AudioSource::Synthetic, AudioSource::TestPcm}) {
+        const std::string suffix = std::string("/") + audioSourceName(source);
+        auto* construct = benchmark::RegisterBenchmark(("SignatureMatcher/construct" + suffix).c_str(),
+                                                       BM_SignatureMatcherConstruct, source, false);
+        auto* construct_shared = benchmark::RegisterBenchmark(("SignatureMatcher/construct_shared_index" + suffix).c_str(),
+                                                              BM_SignatureMatcherConstruct, source, true);
+        auto* query = benchmark::RegisterBenchmark(("SignatureMatcher/processQuerySignature" + suffix).c_str(),
+                                                   BM_ProcessQuerySignature, source);
+        for (auto* bench : {construct, construct_shared, query}) {
+            bench->ArgName("catalog")->Unit(benchmark::kMicrosecond);
+            for (size_t size : benchOptions().catalogSizes) {
+                bench->Arg(static_cast<int64_t>(size));
+            }
+        }
+    }
+
+    auto* eviction = benchmark::RegisterBenchmark("SessionScoreHeap/evict", BM_SessionEviction);
+    eviction->ArgName("sessions")->Arg(256)->Arg(4096)->Arg(65536);
+}
+
+} // namespace afp::bench
@@ -0,0 +1,73 @@
+#include <benchmark/benchmark.h>
+#include <string>
+#include <vector>
+#include "audio/pcm_reader.h"
+#include "bench/bench_inputs.h"
+#include "bench/bench_registry.h"
+
+namespace afp::bench {
+
+namespace {
+
+constexpr size_t kChannelBufferSamples = 2048;
+
+// 与通道分离阶段相同的用法：每次把源数据解码到各通道的定长缓冲，缓冲满后从头写入，直到源数据用完
+void BM_PCMReaderProcess2(benchmark::State& state, AudioSource source, SampleFormat format, uint32_t channels) {
+    const auto& audio = benchAudio(source);
+    if (audio.empty()) {
+        state.SkipWithError("input audio unavailable");
+        return;
+    }
+
+    const PCMFormat pcm_format(44100, format, channels, Endianness::Little,
+                               channels == 1 ? ChannelLayout::Mono : ChannelLayout::Stereo);
+    const auto pcm = encodePcm(audio, format, channels);
+    PCMReader reader(pcm_format);
+
+    std::vector<std::vector<float>> buffers(channels, std::vector<float>(kChannelBufferSamples));
+    ChannelArray<float*> dst_buffers{};
+    ChannelArray<size_t> dst_capacities{};
+    for (uint32_t channel = 0; channel < channels; ++channel) {
+        dst_buffers[channel] = buffers[channel].data();
+        dst_capacities[channel] = kChannelBufferSamples;
+    }
+
+    for (auto _ : state) {
+        ChannelArray<size_t> dst_offsets{};
+        ChannelArray<size_t> consumed{};
+        while (consumed[0] < pcm.size()) {
+            const size_t before = consumed[0];
+            reader.process2(pcm.data() + consumed[0], pcm.size() - consumed[0],
+                            dst_buffers, dst_capacities, dst_offsets, consumed);
+            if (consumed[0] == before) {
+                break;
+            }
+            benchmark::DoNotOptimize(dst_buffers[0][0]);
+        }
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * pcm.size()));
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * audio.size() * channels));
+}
+
+const SampleFormat kSampleFormats[] = {
+    SampleFormat::S8, SampleFormat::U8, SampleFormat::S16, SampleFormat::U16, SampleFormat::S24,
+    SampleFormat::U24, SampleFormat::S32, SampleFormat::U32, SampleFormat::F32, SampleFormat::F64,
+};
+
+} // namespace
+
+void registerPCMReaderBenchmarks() {
+    for (auto source : {AudioSource::Synthetic, AudioSource::TestPcm}) {
+        for (auto format : kSampleFormats) {
+            for (uint32_t channels : {1u, 2u}) {
+                const std::string name = std::string("PCMReader/process2/") + audioSourceName(source) + "/"
+                                       + sampleFormatName(format) + "/channels:" + std::to_string(channels);
+                benchmark::RegisterBenchmark(name.c_str(), BM_PCMReaderProcess2, source, format, channels);
+            }
+        }
+    }
+}
+
+} // namespace afp::bench
@@ -0,0 +1,88 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+#include "bench/bench_registry.h"
+#include "bench/short_frame_capture.h"
+#include "signature_generation_pipeline/peak_detection/peak_extractor.h"
+
+namespace afp::bench {
+
+namespace {
+
+// 以峰值检测窗口的长度在整段短帧上逐窗口提取峰值，前后各保留timeMaxRange帧作为保护区，与峰值检测阶段相同
+void BM_PeakExtractorExtractPeaks(benchmark::State& state, AudioSource source) {
+    const auto& captured = capturedShortFrames(source);
+    if (captured.batches.empty()) {
+        state.SkipWithError("input audio unavailable");
+        return;
+    }
+
+    auto ctx = makeBenchCtx(captured.config);
+    PeakExtractor extractor(ctx.get());
+    const auto& peak_config = captured.config->getPeakDetectionConfig();
+    const auto spectrogram = captured.all->view();
+    const int guard = static_cast<int>(peak_config.timeMaxRange);
+    const double hop_duration = static_cast<double>(ctx->hop_size) / ctx->sample_rate;
+    const int window = std::max(1, static_cast<int>(std::lround(ctx->peak_detection_duration / hop_duration)));
+    const int last_end = static_cast<int>(spectrogram.size()) - guard;
+    if (last_end - guard < window) {
+        state.SkipWithError("input audio shorter than one detection window");
+        return;
+    }
+
+    std::vector<Peak> peaks;
+    size_t peak_count = 0;
+    size_t window_count = 0;
+    for (auto _ : state) {
+        for (int start = guard; start + window <= last_end; start += window) {
+            extractor.extractPeaks(spectrogram, start, start + window, peak_config.quantileThreshold, peaks);
+            peak_count += peaks.size();
+            ++window_count;
+        }
+        benchmark::DoNotOptimize(peaks.data());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(window_count));
+    state.counters["peaks_per_window"] = window_count ? static_cast<double>(peak_count) / window_count : 0.0;
+}
+
+// 峰值检测阶段（峰值提取、动态配额分配和按频段过滤）的独占时间，不含之后的长帧构建和hash计算
+// 降级级别按倍数减小每帧的峰值配额，覆盖配额分配的不同分支
+void BM_PeakDetectionPhase(benchmark::State& state, AudioSource source) {
+    const auto& captured = capturedShortFrames(source);
+    if (captured.batches.empty()) {
+        state.SkipWithError("input audio unavailable");
+        return;
+    }
+
+    const size_t degradation_level = static_cast<size_t>(state.range(0));
+    uint64_t frames_in = 0;
+    uint64_t peaks_out = 0;
+    for (auto _ : state) {
+        const auto stats = replayShortFrames(captured, degradation_level);
+        state.SetIterationTime(static_cast<double>(stats.peakDetection.nanoseconds) * 1e-9);
+        frames_in += stats.peakDetection.itemsIn;
+        peaks_out += stats.peakDetection.itemsOut;
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(frames_in));
+    state.counters["peaks_per_frame"] = frames_in ? static_cast<double>(peaks_out) / frames_in : 0.0;
+}
+
+} // namespace
+
+void registerPeakBenchmarks() {
+    for (auto source : {AudioSource::Synthetic, AudioSource::TestPcm}) {
+        const std::string suffix = std::string("/") + audioSourceName(source);
+        benchmark::RegisterBenchmark(("PeakExtractor/extractPeaks" + suffix).c_str(),
+                                     BM_PeakExtractorExtractPeaks, source);
+        benchmark::RegisterBenchmark(("PeakDetectionPhase/handleShortFrames" + suffix).c_str(),
+                                     BM_PeakDetectionPhase, source)
+            ->ArgName("degradation")
+            ->DenseRange(0, static_cast<int64_t>(SignatureGenerationPipelineCtx::kMaxDegradationLevel))
+            ->UseManualTime()
+            ->Unit(benchmark::kMillisecond);
+    }
+}
+
+} // namespace afp::bench
@@ -0,0 +1,117 @@
+#include "bench/short_frame_capture.h"
+#include <algorithm>
+#include <map>
+#include "signature_generation_pipeline/phase/decimation_phase.h"
+#include "signature_generation_pipeline/phase/emphasis_phase.h"
+#include "signature_generation_pipeline/phase/fft_phase.h"
+#include "signature_generation_pipeline/phase/hash_computation_phase.h"
+#include "signature_generation_pipeline/phase/long_frame_building_phase.h"
+#include "signature_generation_pipeline/phase/peak_detection_phase.h"
+
+namespace afp::bench {
+
+namespace {
+
+// 把FFT阶段交出的每批短帧复制下来
+class CapturingShortFrameConsumer : public IShortFrameConsumer {
+public:
+    explicit CapturingShortFrameConsumer(CapturedShortFrames& captured) : captured_(captured) {}
+
+    void handleShortFrames(const ChannelArray<SpectrogramView>& short_frames) override {
+        const auto& frames = short_frames[0];
+        if (frames.size() == 0) {
+            return;
+        }
+        auto batch = std::make_unique<SpectrogramRing>(frames.size(), frames.binCount());
+        for (size_t i = 0; i < frames.size(); ++i) {
+            batch->pushBack(frames, i);
+        }
+        captured_.batches.push_back(std::move(batch));
+    }
+
+    void flush() override {}
+
+private:
+    CapturedShortFrames& captured_;
+};
+
+CapturedShortFrames captureShortFrames(AudioSource source) {
+    CapturedShortFrames captured;
+    captured.config = makeBenchConfig(PlatformType::Desktop);
+    const auto& audio = benchAudio(source);
+    if (audio.empty()) {
+        return captured;
+    }
+
+    auto ctx = makeBenchCtx(captured.config);
+    EmphasisPhase emphasis(ctx.get());
+    DecimationPhase decimation(ctx.get());
+    FftPhase fft(ctx.get());
+    CapturingShortFrameConsumer consumer(captured);
+    emphasis.attach(&decimation);
+    decimation.attach(&fft);
+    fft.attach(&consumer);
+
+    const size_t chunk = ctx->channel_buffer_sample_count;
+    const double chunk_duration = static_cast<double>(chunk) / ctx->format->sampleRate();
+    double timestamp = 0.0;
+    for (size_t offset = 0; offset + chunk <= audio.size(); offset += chunk) {
+        std::copy_n(audio.data() + offset, chunk, ctx->channel_samples[0]);
+        emphasis.handleSamples(ctx->channel_samples, chunk, timestamp);
+        timestamp += chunk_duration;
+    }
+
+    size_t frame_count = 0;
+    size_t bin_count = ctx->fft_size / 2;
+    for (const auto& batch : captured.batches) {
+        frame_count += batch->size();
+    }
+    captured.all = std::make_unique<SpectrogramRing>(std::max<size_t>(frame_count, 1), bin_count);
+    for (const auto& batch : captured.batches) {
+        const auto view = batch->view();
+        for (size_t i = 0; i < view.size(); ++i) {
+            captured.all->pushBack(view, i);
+        }
+    }
+    return captured;
+}
+
+} // namespace
+
+const CapturedShortFrames& capturedShortFrames(AudioSource source) {
+    static std::map<AudioSource, CapturedShortFrames> cache;
+    auto it = cache.find(source);
+    if (it == cache.end()) {
+        it = cache.emplace(source, captureShortFrames(source)).first;
+    }
+    return it->second;
+}
+
+GeneratorPerformanceStats replayShortFrames(const CapturedShortFrames& captured, size_t degradation_level) {
+    auto ctx = makeBenchCtx(captured.config);
+    ctx->degradation_level.store(degradation_level, std::memory_order_relaxed);
+    PeakDetectionPhase peak_detection(ctx.get());
+    LongFrameBuildingPhase long_frame_building(ctx.get());
+    HashComputationPhase hash_computation(ctx.get());
+    peak_detection.attach(&long_frame_building);
+    long_frame_building.attach(&hash_computation);
+
+    ChannelArray<SpectrogramView> views{};
+    for (const auto& batch : captured.batches) {
+        views[0] = batch->view();
+        peak_detection.handleShortFrames(views);
+    }
+    peak_detection.flush();
+    return ctx->counters.snapshot(ctx->format->sampleRate(), degradation_level);
+}
+
+std::unique_ptr<SignatureGenerationPipelineCtx> makeBenchCtx(std::shared_ptr<IPerformanceConfig> config) {
+    // 各阶段假定可视化配置总是存在（由SignatureGenerator设置），基准中使用一个不收集数据的共享配置
+    static VisualizationConfig visualization_config;
+    auto ctx = std::make_unique<SignatureGenerationPipelineCtx>(
+        config, std::make_shared<PCMFormat>(benchFormat(1)), [](const std::vector<SignaturePoint>&) {});
+    ctx->visualization_config = &visualization_config;
+    return ctx;
+}
+
+} // namespace afp::bench
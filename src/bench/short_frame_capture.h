@@ -0,0 +1,28 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "base/spectrogram_ring.h"
+#include "bench/bench_inputs.h"
+#include "signature_generation_pipeline/signature_generation_pipeline_ctx.h"
+
+namespace afp::bench {
+
+// 一段音频经过前几个阶段（预加重、降采样、FFT）得到的短帧，用于单独测量之后的阶段
+struct CapturedShortFrames {
+    std::shared_ptr<BenchConfig> config;
+    std::vector<std::unique_ptr<SpectrogramRing>> batches;  // 按FFT阶段每次交出的批次保存，可原样重放
+    std::unique_ptr<SpectrogramRing> all;                   // 所有短帧依次存放
+};
+
+// Desktop配置下单声道输入的短帧，首次使用时生成，之后复用；输入音频不可用时batches为空
+const CapturedShortFrames& capturedShortFrames(AudioSource source);
+
+// 用新建的峰值检测、长帧构建和hash计算阶段按原批次重放全部短帧并flush，返回这些阶段的计数
+// 各阶段的耗时是不含下游阶段的独占时间，可以分别作为单个阶段的测量结果
+GeneratorPerformanceStats replayShortFrames(const CapturedShortFrames& captured, size_t degradation_level);
+
+// 新建单声道流水线的上下文，生成的指纹点直接丢弃
+std::unique_ptr<SignatureGenerationPipelineCtx> makeBenchCtx(std::shared_ptr<IPerformanceConfig> config);
+
+} // namespace afp::bench
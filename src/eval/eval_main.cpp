@@ -0,0 +1,274 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include "afp/afp_interface.h"
+#include "eval/eval_manifest.h"
+#include "eval/eval_report.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// 与AFingerprint相同的输入格式：16位有符号整数，小端序，单声道，44100Hz
+const afp::PCMFormat evalFormat(44100,
+                                afp::SampleFormat::S16,
+                                1,
+                                afp::Endianness::Little,
+                                afp::ChannelLayout::Mono);
+
+struct EvalOptions {
+    std::string manifest;
+    std::string output = "eval_results.json";
+    std::string platform = "mobile";
+    double chunkMs = 40.0;          // 每次送入匹配器的音频时长，接近实时采集的缓冲大小
+    size_t matchThreads = 1;
+    bool selfQueries = false;       // 把每个目录项的音频本身作为偏移为0的正样本查询
+    bool decimate = false;          // 生成和匹配都在FFT前降采样，见PerformanceConfigOptions::enableDecimation
+    double latencyBudgetMs = 0.0;   // 匹配端的低延迟流式模式预算，见PerformanceConfigOptions::streamingLatencyBudgetMs
+};
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <manifest> [--output results.json] [--platform mobile|desktop|server|mobile-lowend]"
+              << " [--chunk-ms N] [--jobs N] [--self-queries] [--decimate] [--latency-budget-ms N]" << std::endl;
+}
+
+bool parseOptions(int argc, char* argv[], EvalOptions& options) {
+    if (argc < 2) {
+        return false;
+    }
+    options.manifest = argv[1];
+    for (int i = 2; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (arg == "--output" && has_value) {
+            options.output = argv[++i];
+        } else if (arg == "--platform" && has_value) {
+            options.platform = argv[++i];
+        } else if (arg == "--chunk-ms" && has_value) {
+            options.chunkMs = std::stod(argv[++i]);
+        } else if (arg == "--jobs" && has_value) {
+            options.matchThreads = std::max<size_t>(1, std::stoul(argv[++i]));
+        } else if (arg == "--self-queries") {
+            options.selfQueries = true;
+        } else if (arg == "--decimate") {
+            options.decimate = true;
+        } else if (arg == "--latency-budget-ms" && has_value) {
+            options.latencyBudgetMs = std::stod(argv[++i]);
+        } else {
+            std::cerr << "未知参数: " << arg << std::endl;
+            return false;
+        }
+    }
+    return options.chunkMs > 0.0 && options.latencyBudgetMs >= 0.0;
+}
+
+// 生成目录和匹配分别使用同一平台的生成配置和匹配配置，与AFingerprint的generate/match一致
+bool selectPlatforms(const std::string& platform, afp::PlatformType& gen, afp::PlatformType& match) {
+    if (platform == "mobile") {
+        gen = afp::PlatformType::Mobile_Gen;
+        match = afp::PlatformType::Mobile;
+    } else if (platform == "desktop") {
+        gen = afp::PlatformType::Desktop_Gen;
+        match = afp::PlatformType::Desktop;
+    } else if (platform == "server") {
+        gen = afp::PlatformType::Server_Gen;
+        match = afp::PlatformType::Server;
+    } else if (platform == "mobile-lowend") {
+        // 目录仍由浮点的Mobile_Gen生成，衡量定点频谱匹配端与之的兼容程度
+        gen = afp::PlatformType::Mobile_Gen;
+        match = afp::PlatformType::Mobile_LowEnd;
+    } else {
+        std::cerr << "未知平台: " << platform << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::vector<uint8_t> readPCMFile(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file: " << filename << std::endl;
+        return {};
+    }
+    return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+double audioSecondsOf(size_t bytes) {
+    return static_cast<double>(bytes / evalFormat.frameSize()) / evalFormat.sampleRate();
+}
+
+bool buildCatalog(const std::vector<afp::eval::CatalogEntry>& entries,
+                  std::shared_ptr<afp::IPerformanceConfig> config,
+                  std::shared_ptr<afp::ICatalog>& catalog,
+                  afp::eval::CatalogSummary& summary) {
+    const auto start_time = Clock::now();
+    catalog = afp::interface::createCatalog();
+    for (const auto& entry : entries) {
+        const auto buffer = readPCMFile(entry.path);
+        if (buffer.empty()) {
+            return false;
+        }
+
+        auto generator = afp::interface::createSignatureGenerator(config);
+        if (!generator->init(evalFormat)) {
+            std::cerr << "Failed to initialize signature generator" << std::endl;
+            return false;
+        }
+        if (!generator->appendStreamBuffer(buffer.data(), buffer.size(), 0.0)) {
+            std::cerr << "Failed to generate signature: " << entry.path << std::endl;
+            return false;
+        }
+        const auto signature = generator->takeSignature();
+
+        afp::MediaItem mediaItem;
+        mediaItem.setTitle(entry.title);
+        mediaItem.setChannelCount(evalFormat.channels());
+        catalog->addSignature(signature, mediaItem);
+
+        summary.signaturePointCount += signature.size();
+        summary.audioSeconds += audioSecondsOf(buffer.size());
+    }
+    summary.itemCount = entries.size();
+    summary.buildSeconds = std::chrono::duration<double>(Clock::now() - start_time).count();
+    return true;
+}
+
+// 按chunkMs分块流式送入查询音频，记录每个目录项第一次被通知时已送入的音频时长
+bool runQuery(const afp::eval::QueryEntry& query,
+              const EvalOptions& options,
+              std::shared_ptr<afp::ICatalog> catalog,
+              std::shared_ptr<const afp::ICatalogIndex> index,
+              std::shared_ptr<afp::IPerformanceConfig> config,
+              afp::eval::QueryResult& result) {
+    result.query = query;
+    const auto buffer = readPCMFile(query.path);
+    if (buffer.empty()) {
+        return false;
+    }
+
+    auto matcher = afp::interface::createMatcher(catalog, index, config, evalFormat);
+    matcher->setLogLevel(afp::MatcherLogLevel::Quiet);
+    matcher->setMatchThreads(options.matchThreads);
+
+    double fed_seconds = 0.0;
+    std::map<std::string, size_t> detection_indices;
+    matcher->setMatchCallback([&](const afp::MatchResult& match) {
+        const std::string& title = match.mediaItem->title();
+        auto it = detection_indices.find(title);
+        if (it == detection_indices.end()) {
+            afp::eval::Detection detection;
+            detection.title = title;
+            detection.offset = match.offset / 1000.0;   // 匹配器报告的偏移实际以毫秒为单位
+            detection.confidence = match.confidence;
+            detection.detectedAt = fed_seconds;
+            it = detection_indices.emplace(title, result.detections.size()).first;
+            result.detections.push_back(std::move(detection));
+        }
+        ++result.detections[it->second].notifyCount;
+    });
+
+    const size_t frame_size = evalFormat.frameSize();
+    const size_t chunk_frames = std::max<size_t>(1, static_cast<size_t>(options.chunkMs * evalFormat.sampleRate() / 1000.0));
+    const size_t chunk_bytes = chunk_frames * frame_size;
+    const size_t total_bytes = buffer.size() / frame_size * frame_size;
+
+    Clock::duration processing{0};
+    for (size_t offset = 0; offset < total_bytes; offset += chunk_bytes) {
+        const size_t bytes = std::min(chunk_bytes, total_bytes - offset);
+        const double start_timestamp = audioSecondsOf(offset);
+        // 回调在appendStreamBuffer内触发，此时本块已全部送入
+        fed_seconds = audioSecondsOf(offset + bytes);
+
+        const auto start_time = Clock::now();
+        matcher->appendStreamBuffer(buffer.data() + offset, bytes, start_timestamp);
+        processing += Clock::now() - start_time;
+    }
+
+    result.audioSeconds = audioSecondsOf(total_bytes);
+    result.processingSeconds = std::chrono::duration<double>(processing).count();
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    EvalOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    afp::PlatformType gen_platform;
+    afp::PlatformType match_platform;
+    if (!selectPlatforms(options.platform, gen_platform, match_platform)) {
+        return 1;
+    }
+
+    afp::eval::Manifest manifest;
+    if (!afp::eval::loadManifest(options.manifest, manifest)) {
+        return 1;
+    }
+    if (manifest.catalog.empty()) {
+        std::cerr << "评测清单中没有目录项" << std::endl;
+        return 1;
+    }
+    if (options.selfQueries) {
+        for (const auto& entry : manifest.catalog) {
+            afp::eval::QueryEntry query;
+            query.path = entry.path;
+            query.label = afp::eval::QueryLabel::Positive;
+            query.expectedTitle = entry.title;
+            query.hasExpectedOffset = true;
+            query.expectedOffset = 0.0;
+            manifest.queries.push_back(std::move(query));
+        }
+    }
+
+    std::cout << "构建目录: " << manifest.catalog.size() << " 个目录项" << std::endl;
+    std::shared_ptr<afp::ICatalog> catalog;
+    afp::eval::CatalogSummary catalog_summary;
+    afp::PerformanceConfigOptions config_options;
+    config_options.enableDecimation = options.decimate;
+    if (!buildCatalog(manifest.catalog, afp::interface::createPerformanceConfig(gen_platform, config_options), catalog,
+                      catalog_summary)) {
+        return 1;
+    }
+
+    // 倒排索引只构建一次，所有查询的匹配器共享，与AFingerprint match相同
+    // 离线评测关闭自适应降级，准确率不随机器负载变化
+    auto match_options = config_options;
+    match_options.adaptiveDegradation = false;
+    match_options.streamingLatencyBudgetMs = options.latencyBudgetMs;
+    auto match_config = afp::interface::createPerformanceConfig(match_platform, match_options);
+    const auto index_start = Clock::now();
+    auto index = afp::interface::createCatalogIndex(catalog, match_config);
+    catalog_summary.buildSeconds += std::chrono::duration<double>(Clock::now() - index_start).count();
+    catalog_summary.uniqueHashCount = index->hashCount();
+
+    std::vector<afp::eval::QueryResult> results;
+    results.reserve(manifest.queries.size());
+    for (const auto& query : manifest.queries) {
+        afp::eval::QueryResult result;
+        if (!runQuery(query, options, catalog, index, match_config, result)) {
+            std::cerr << "跳过无法读取的查询: " << query.path << std::endl;
+            continue;
+        }
+        std::cout << "查询 " << query.path << ": " << result.detections.size() << " 个检测结果" << std::endl;
+        results.push_back(std::move(result));
+    }
+
+    afp::eval::EvalSettings settings;
+    settings.manifest = options.manifest;
+    settings.platform = options.platform;
+    settings.chunkMs = options.chunkMs;
+    settings.matchThreads = options.matchThreads;
+    settings.decimate = options.decimate;
+    if (!afp::eval::writeEvalReport(options.output, settings, catalog_summary, results, afp::eval::peakRssBytes())) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include "eval/eval_manifest.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace afp::eval {
+
+namespace fs = std::filesystem;
+
+bool loadManifest(const std::string& filename, Manifest& manifest) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "无法打开评测清单: " << filename << std::endl;
+        return false;
+    }
+
+    const fs::path base_dir = fs::path(filename).parent_path();
+    auto resolve = [&base_dir](const std::string& path) {
+        const fs::path resolved(path);
+        return resolved.is_absolute() ? resolved.string() : (base_dir / resolved).string();
+    };
+
+    std::string line;
+    size_t line_number = 0;
+    while (std::getline(file, line)) {
+        ++line_number;
+        std::istringstream fields(line);
+        std::string kind;
+        if (!(fields >> kind) || kind[0] == '#') {
+            continue;
+        }
+
+        if (kind == "catalog") {
+            CatalogEntry entry;
+            if (!(fields >> entry.title >> entry.path)) {
+                std::cerr << filename << ":" << line_number << ": catalog需要<标题> <pcm文件>" << std::endl;
+                return false;
+            }
+            entry.path = resolve(entry.path);
+            manifest.catalog.push_back(std::move(entry));
+        } else if (kind == "query") {
+            QueryEntry entry;
+            std::string expected;
+            if (!(fields >> entry.path >> expected)) {
+                std::cerr << filename << ":" << line_number << ": query需要<pcm文件> <期望标题|-|?>" << std::endl;
+                return false;
+            }
+            entry.path = resolve(entry.path);
+            if (expected == "-") {
+                entry.label = QueryLabel::Negative;
+            } else if (expected == "?") {
+                entry.label = QueryLabel::Unlabeled;
+            } else {
+                entry.label = QueryLabel::Positive;
+                entry.expectedTitle = expected;
+                entry.hasExpectedOffset = static_cast<bool>(fields >> entry.expectedOffset);
+            }
+            manifest.queries.push_back(std::move(entry));
+        } else {
+            std::cerr << filename << ":" << line_number << ": 未知的记录类型: " << kind << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace afp::eval
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace afp::eval {
+
+// 评测清单，每行一条记录，#开头为注释，字段以空白分隔，相对路径相对于清单所在目录：
+//   catalog <标题> <pcm文件>                      加入目录的音频
+//   query <pcm文件> <期望标题> [期望偏移秒]        查询音频及其真值
+// 期望标题为-表示查询中不应出现任何目录项（负样本），为?表示未标注，只参与性能统计
+// 期望偏移是目录项在查询中开始的时间，即MatchResult::offset的真值
+struct CatalogEntry {
+    std::string title;
+    std::string path;
+};
+
+enum class QueryLabel {
+    Positive,       // 应匹配expectedTitle
+    Negative,       // 不应匹配任何目录项
+    Unlabeled,      // 没有真值
+};
+
+struct QueryEntry {
+    std::string path;
+    QueryLabel label = QueryLabel::Unlabeled;
+    std::string expectedTitle;
+    bool hasExpectedOffset = false;
+    double expectedOffset = 0.0;
+};
+
+struct Manifest {
+    std::vector<CatalogEntry> catalog;
+    std::vector<QueryEntry> queries;
+};
+
+// 读取清单，格式错误时输出行号并返回false
+bool loadManifest(const std::string& filename, Manifest& manifest);
+
+} // namespace afp::eval
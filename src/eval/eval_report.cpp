@@ -0,0 +1,196 @@
+#include "eval/eval_report.h"
+#include "base/json_string.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#if !defined(_WIN32)
+#include <sys/resource.h>
+#endif
+
+namespace afp::eval {
+
+namespace {
+
+const char* labelName(QueryLabel label) {
+    switch (label) {
+        case QueryLabel::Positive: return "positive";
+        case QueryLabel::Negative: return "negative";
+        case QueryLabel::Unlabeled: return "unlabeled";
+    }
+    return "unlabeled";
+}
+
+// 最近秩法的分位数，values为空时返回0
+double percentile(std::vector<double> values, double p) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    const size_t rank = static_cast<size_t>(std::ceil(p * values.size()));
+    return values[std::min(values.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+struct Accuracy {
+    size_t labeledQueries = 0;
+    size_t truePositives = 0;
+    size_t falsePositives = 0;
+    size_t falseNegatives = 0;
+    std::vector<double> offsetErrors;
+};
+
+} // namespace
+
+uint64_t peakRssBytes() {
+#if defined(_WIN32)
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#if defined(__APPLE__)
+    return static_cast<uint64_t>(usage.ru_maxrss);          // macOS以字节为单位
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;   // Linux以KB为单位
+#endif
+#endif
+}
+
+bool writeEvalReport(const std::string& filename,
+                     const EvalSettings& settings,
+                     const CatalogSummary& catalog,
+                     const std::vector<QueryResult>& results,
+                     uint64_t peakRss) {
+    double audio_seconds = 0.0;
+    double processing_seconds = 0.0;
+    std::vector<double> detection_latencies;
+    Accuracy accuracy;
+
+    for (const auto& result : results) {
+        audio_seconds += result.audioSeconds;
+        processing_seconds += result.processingSeconds;
+
+        const auto& query = result.query;
+        bool expected_found = false;
+        for (const auto& detection : result.detections) {
+            const bool correct = query.label == QueryLabel::Positive && detection.title == query.expectedTitle;
+            if (query.label != QueryLabel::Unlabeled) {
+                if (correct) {
+                    ++accuracy.truePositives;
+                    expected_found = true;
+                    if (query.hasExpectedOffset) {
+                        accuracy.offsetErrors.push_back(std::abs(detection.offset - query.expectedOffset));
+                    }
+                } else {
+                    ++accuracy.falsePositives;
+                }
+            }
+
+            // 只统计可以确定目录项开始时间的检测：正样本的正确检测，或未标注样本的检测
+            if (correct || query.label == QueryLabel::Unlabeled) {
+                const double onset = correct && query.hasExpectedOffset ? query.expectedOffset : detection.offset;
+                detection_latencies.push_back(std::max(0.0, detection.detectedAt - std::max(0.0, onset)));
+            }
+        }
+        if (query.label != QueryLabel::Unlabeled) {
+            ++accuracy.labeledQueries;
+        }
+        if (query.label == QueryLabel::Positive && !expected_found) {
+            ++accuracy.falseNegatives;
+        }
+    }
+
+    const size_t detected = accuracy.truePositives + accuracy.falsePositives;
+    const size_t expected = accuracy.truePositives + accuracy.falseNegatives;
+    const double precision = detected ? static_cast<double>(accuracy.truePositives) / detected : 0.0;
+    const double recall = expected ? static_cast<double>(accuracy.truePositives) / expected : 0.0;
+    double offset_error_mean = 0.0;
+    double offset_error_max = 0.0;
+    for (double error : accuracy.offsetErrors) {
+        offset_error_mean += error;
+        offset_error_max = std::max(offset_error_max, error);
+    }
+    if (!accuracy.offsetErrors.empty()) {
+        offset_error_mean /= accuracy.offsetErrors.size();
+    }
+
+    std::ofstream file(filename, std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "无法写入评测结果: " << filename << std::endl;
+        return false;
+    }
+    file << std::setprecision(6) << std::fixed;
+
+    file << "{\n";
+    file << "  \"settings\": {\"manifest\": " << jsonString(settings.manifest)
+         << ", \"platform\": " << jsonString(settings.platform)
+         << ", \"chunk_ms\": " << settings.chunkMs
+         << ", \"match_threads\": " << settings.matchThreads
+         << ", \"decimate\": " << (settings.decimate ? "true" : "false") << "},\n";
+    file << "  \"catalog\": {\"items\": " << catalog.itemCount
+         << ", \"signature_points\": " << catalog.signaturePointCount
+         << ", \"unique_hashes\": " << catalog.uniqueHashCount
+         << ", \"audio_seconds\": " << catalog.audioSeconds
+         << ", \"build_seconds\": " << catalog.buildSeconds << "},\n";
+    file << "  \"throughput\": {\"queries\": " << results.size()
+         << ", \"audio_seconds\": " << audio_seconds
+         << ", \"processing_seconds\": " << processing_seconds
+         << ", \"realtime_factor\": " << (audio_seconds > 0.0 ? processing_seconds / audio_seconds : 0.0) << "},\n";
+    file << "  \"detection_latency\": {\"count\": " << detection_latencies.size()
+         << ", \"p50_seconds\": " << percentile(detection_latencies, 0.50)
+         << ", \"p99_seconds\": " << percentile(detection_latencies, 0.99) << "},\n";
+    file << "  \"accuracy\": {\"labeled_queries\": " << accuracy.labeledQueries
+         << ", \"true_positives\": " << accuracy.truePositives
+         << ", \"false_positives\": " << accuracy.falsePositives
+         << ", \"false_negatives\": " << accuracy.falseNegatives
+         << ", \"precision\": " << precision
+         << ", \"recall\": " << recall
+         << ", \"offset_error_count\": " << accuracy.offsetErrors.size()
+         << ", \"offset_error_mean_seconds\": " << offset_error_mean
+         << ", \"offset_error_max_seconds\": " << offset_error_max << "},\n";
+    file << "  \"memory\": {\"peak_rss_bytes\": " << peakRss << "},\n";
+
+    file << "  \"queries\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const auto& result = results[i];
+        file << (i == 0 ? "\n" : ",\n");
+        file << "    {\"file\": " << jsonString(result.query.path)
+             << ", \"label\": \"" << labelName(result.query.label) << "\""
+             << ", \"expected_title\": " << jsonString(result.query.expectedTitle);
+        if (result.query.hasExpectedOffset) {
+            file << ", \"expected_offset\": " << result.query.expectedOffset;
+        }
+        file << ", \"audio_seconds\": " << result.audioSeconds
+             << ", \"processing_seconds\": " << result.processingSeconds
+             << ", \"detections\": [";
+        for (size_t j = 0; j < result.detections.size(); ++j) {
+            const auto& detection = result.detections[j];
+            file << (j == 0 ? "" : ", ")
+                 << "{\"title\": " << jsonString(detection.title)
+                 << ", \"offset\": " << detection.offset
+                 << ", \"confidence\": " << detection.confidence
+                 << ", \"detected_at\": " << detection.detectedAt
+                 << ", \"notify_count\": " << detection.notifyCount << "}";
+        }
+        file << "]}";
+    }
+    file << "\n  ]\n}\n";
+
+    file.flush();
+    if (!file.good()) {
+        std::cerr << "写入评测结果失败: " << filename << std::endl;
+        return false;
+    }
+
+    std::cout << "评测完成: 查询 " << results.size()
+              << ", 实时率 " << (audio_seconds > 0.0 ? processing_seconds / audio_seconds : 0.0)
+              << ", 检测时延p50/p99 " << percentile(detection_latencies, 0.50) << "/" << percentile(detection_latencies, 0.99) << "秒"
+              << ", 精确率 " << precision << ", 召回率 " << recall
+              << ", 峰值内存 " << peakRss / (1024 * 1024) << "MB" << std::endl;
+    std::cout << "评测结果已写入: " << filename << std::endl;
+    return true;
+}
+
+} // namespace afp::eval
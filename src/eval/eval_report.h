@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "eval/eval_manifest.h"
+
+namespace afp::eval {
+
+// 一个查询中某个目录项的检测，同一目录项多次通知时只保留第一次
+struct Detection {
+    std::string title;
+    double offset = 0.0;            // 报告的偏移（秒）
+    double confidence = 0.0;
+    double detectedAt = 0.0;        // 通知时已送入的音频时长（秒）
+    size_t notifyCount = 0;         // 该目录项在本查询中的通知次数
+};
+
+struct QueryResult {
+    QueryEntry query;
+    double audioSeconds = 0.0;
+    double processingSeconds = 0.0;     // appendStreamBuffer的总耗时
+    std::vector<Detection> detections;
+};
+
+struct CatalogSummary {
+    size_t itemCount = 0;
+    size_t signaturePointCount = 0;
+    size_t uniqueHashCount = 0;
+    double audioSeconds = 0.0;
+    double buildSeconds = 0.0;          // 生成所有目录项指纹和倒排索引的耗时
+};
+
+struct EvalSettings {
+    std::string manifest;
+    std::string platform;
+    double chunkMs = 0.0;
+    size_t matchThreads = 1;
+    bool decimate = false;
+};
+
+// 汇总所有查询的结果，以JSON写入filename
+// 检测时延：正样本按期望偏移，未标注样本按报告的偏移，计算从目录项开始到通知的时长
+// 准确率：正样本中检测到期望标题为真阳性，其他检测（含负样本中的检测）为假阳性，未检测到期望标题为假阴性
+bool writeEvalReport(const std::string& filename,
+                     const EvalSettings& settings,
+                     const CatalogSummary& catalog,
+                     const std::vector<QueryResult>& results,
+                     uint64_t peakRss);
+
+// 进程的峰值常驻内存（字节），平台不支持时返回0
+uint64_t peakRssBytes();
+
+} // namespace afp::eval
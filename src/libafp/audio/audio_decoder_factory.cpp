@@ -0,0 +1,33 @@
+#include "audio/audio_decoder_interface.h"
+#include "audio/wav_decoder.h"
+#include "audio/ffmpeg_pipe_decoder.h"
+#include <algorithm>
+#include <cctype>
+
+namespace afp {
+
+std::unique_ptr<AudioDecoderInterface> AudioDecoderFactory::create(const std::string& filename, uint32_t sampleRate) {
+    std::string extension;
+    const auto dot = filename.find_last_of('.');
+    if (dot != std::string::npos) {
+        extension = filename.substr(dot + 1);
+        std::transform(extension.begin(), extension.end(), extension.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    }
+
+    if (extension == "wav") {
+        auto decoder = std::make_unique<WavDecoder>();
+        if (!decoder->open(filename, sampleRate)) {
+            return nullptr;
+        }
+        return decoder;
+    }
+
+    auto decoder = std::make_unique<FfmpegPipeDecoder>();
+    if (!decoder->open(filename, sampleRate)) {
+        return nullptr;
+    }
+    return decoder;
+}
+
+} // namespace afp
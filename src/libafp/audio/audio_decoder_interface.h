@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace afp {
+
+// 压缩或封装音频文件的流式解码前端：按块输出指定采样率的单声道S16 PCM（与convert_to_pcm.sh的输出相同），
+// 解码、混缩和重采样在同一遍中完成，不写任何中间文件
+class AudioDecoderInterface {
+public:
+    virtual ~AudioDecoderInterface() = default;
+
+    // 读取最多maxFrames帧到buffer，返回读到的帧数；返回0表示已到结尾或解码失败（见failed）
+    virtual size_t read(int16_t* buffer, size_t maxFrames) = 0;
+
+    // 解码过程中是否出错
+    virtual bool failed() const = 0;
+};
+
+class AudioDecoderFactory {
+public:
+    // 按扩展名选择解码器：wav由内置的解析器解码，其余格式（mp3、mov等）由ffmpeg子进程解码后经管道读入
+    // sampleRate为输出采样率；文件无法打开或格式不支持时返回nullptr
+    static std::unique_ptr<AudioDecoderInterface> create(const std::string& filename, uint32_t sampleRate);
+};
+
+} // namespace afp
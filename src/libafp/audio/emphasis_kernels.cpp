@@ -0,0 +1,71 @@
+#include "audio/emphasis_kernels.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define AFP_EMPHASIS_SIMD_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AFP_EMPHASIS_SIMD_SSE2 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define AFP_EMPHASIS_SIMD_NEON 1
+#endif
+
+namespace afp {
+
+float applyPreEmphasis(float* samples, size_t count, float coefficient, float previous) {
+    if (count == 0) {
+        return previous;
+    }
+
+    const float last = samples[count - 1];
+
+    // 从后往前处理：写入位置i之后，更低位置的原始样本还没有被覆盖，读取x[i-1]时拿到的仍是原始值
+    size_t i = count;
+#if defined(AFP_EMPHASIS_SIMD_AVX2)
+    const __m256 coef = _mm256_set1_ps(coefficient);
+    for (; i >= 8 + 1; i -= 8) {
+        float* p = samples + i - 8;
+        const __m256 cur = _mm256_loadu_ps(p);
+        const __m256 prev = _mm256_loadu_ps(p - 1);
+        _mm256_storeu_ps(p, _mm256_sub_ps(cur, _mm256_mul_ps(coef, prev)));
+    }
+#elif defined(AFP_EMPHASIS_SIMD_SSE2)
+    const __m128 coef = _mm_set1_ps(coefficient);
+    for (; i >= 4 + 1; i -= 4) {
+        float* p = samples + i - 4;
+        const __m128 cur = _mm_loadu_ps(p);
+        const __m128 prev = _mm_loadu_ps(p - 1);
+        _mm_storeu_ps(p, _mm_sub_ps(cur, _mm_mul_ps(coef, prev)));
+    }
+#elif defined(AFP_EMPHASIS_SIMD_NEON)
+    const float32x4_t coef = vdupq_n_f32(coefficient);
+    for (; i >= 4 + 1; i -= 4) {
+        float* p = samples + i - 4;
+        const float32x4_t cur = vld1q_f32(p);
+        const float32x4_t prev = vld1q_f32(p - 1);
+        // 分开乘和减（不用vmlsq），与标量版本逐位一致
+        vst1q_f32(p, vsubq_f32(cur, vmulq_f32(coef, prev)));
+    }
+#endif
+    for (; i > 1; --i) {
+        samples[i - 1] -= coefficient * samples[i - 2];
+    }
+    samples[0] -= coefficient * previous;
+
+    return last;
+}
+
+const char* preEmphasisSimdName() {
+#if defined(AFP_EMPHASIS_SIMD_AVX2)
+    return "avx2";
+#elif defined(AFP_EMPHASIS_SIMD_SSE2)
+    return "sse2";
+#elif defined(AFP_EMPHASIS_SIMD_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+} // namespace afp
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+
+namespace afp {
+
+// 一阶预加重 y[i] = x[i] - coefficient * x[i-1]，原地处理count个样本
+// x[i-1]取处理前的原始样本，各输出之间没有依赖，按编译目标使用AVX2/SSE2/NEON一次处理多个样本；
+// previous为上一段最后一个原始样本（第一段传0），返回本段最后一个原始样本，供下一段接续，count为0时原样返回previous
+float applyPreEmphasis(float* samples, size_t count, float coefficient, float previous);
+
+// 当前编译目标使用的SIMD指令集名称，未启用时为"scalar"
+const char* preEmphasisSimdName();
+
+} // namespace afp
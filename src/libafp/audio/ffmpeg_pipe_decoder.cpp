@@ -0,0 +1,79 @@
+#include "audio/ffmpeg_pipe_decoder.h"
+#include <iostream>
+#include <string>
+
+#ifdef _WIN32
+#define AFP_POPEN _popen
+#define AFP_PCLOSE _pclose
+#else
+#define AFP_POPEN popen
+#define AFP_PCLOSE pclose
+#endif
+
+namespace afp {
+
+namespace {
+
+// 把路径作为单个参数传给shell
+std::string quoteArgument(const std::string& value) {
+#ifdef _WIN32
+    return "\"" + value + "\"";
+#else
+    std::string quoted = "'";
+    for (const char c : value) {
+        if (c == '\'') {
+            quoted += "'\\''";
+        } else {
+            quoted += c;
+        }
+    }
+    quoted += "'";
+    return quoted;
+#endif
+}
+
+} // namespace
+
+FfmpegPipeDecoder::~FfmpegPipeDecoder() {
+    close();
+}
+
+bool FfmpegPipeDecoder::open(const std::string& filename, uint32_t sampleRate) {
+    // 参数与convert_to_pcm.sh相同，输出写到标准输出而不是文件
+    const std::string command = "ffmpeg -nostdin -loglevel error -i " + quoteArgument(filename) +
+                                " -vn -acodec pcm_s16le -ar " + std::to_string(sampleRate) + " -ac 1 -f s16le -";
+#ifdef _WIN32
+    pipe_ = AFP_POPEN(command.c_str(), "rb");
+#else
+    pipe_ = AFP_POPEN(command.c_str(), "r");
+#endif
+    if (!pipe_) {
+        std::cerr << "无法启动ffmpeg解码: " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+size_t FfmpegPipeDecoder::read(int16_t* buffer, size_t maxFrames) {
+    if (!pipe_) {
+        return 0;
+    }
+    const size_t frames = std::fread(buffer, sizeof(int16_t), maxFrames, pipe_);
+    if (frames == 0) {
+        close();
+    }
+    return frames;
+}
+
+void FfmpegPipeDecoder::close() {
+    if (!pipe_) {
+        return;
+    }
+    // ffmpeg无法打开或解码文件、或者不在PATH中时退出码非0
+    if (AFP_PCLOSE(pipe_) != 0) {
+        failed_ = true;
+    }
+    pipe_ = nullptr;
+}
+
+} // namespace afp
@@ -0,0 +1,32 @@
+#pragma once
+#include "audio/audio_decoder_interface.h"
+#include <cstdio>
+
+namespace afp {
+
+// 通过ffmpeg子进程解码任意容器/编码格式：ffmpeg把音轨混缩、重采样为单声道S16小端PCM并写到标准输出，
+// 本对象经管道按块读取；需要PATH中有ffmpeg
+class FfmpegPipeDecoder : public AudioDecoderInterface {
+public:
+    FfmpegPipeDecoder() = default;
+    ~FfmpegPipeDecoder() override;
+
+    FfmpegPipeDecoder(const FfmpegPipeDecoder&) = delete;
+    FfmpegPipeDecoder& operator=(const FfmpegPipeDecoder&) = delete;
+
+    // 启动ffmpeg子进程，进程无法启动时返回false；文件不存在等解码错误在读取结束时由failed报告
+    bool open(const std::string& filename, uint32_t sampleRate);
+
+    size_t read(int16_t* buffer, size_t maxFrames) override;
+
+    bool failed() const override { return failed_; }
+
+private:
+    // 等待子进程退出，退出码非0时标记失败
+    void close();
+
+    FILE* pipe_ = nullptr;
+    bool failed_ = false;
+};
+
+} // namespace afp
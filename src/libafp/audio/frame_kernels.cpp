@@ -0,0 +1,71 @@
+#include "audio/frame_kernels.h"
+#include <algorithm>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace afp {
+
+namespace {
+
+void applyWindowGeneric(const float* samples, const float* window, size_t count, float* out) {
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = samples[i] * window[i];
+    }
+}
+
+void maxInPlaceGeneric(float* dst, const float* src, size_t count) {
+    size_t i = 0;
+#if defined(__ARM_NEON)
+    // 幅度没有NaN，vmaxq_f32与std::max的结果在比较意义上一致
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(dst + i, vmaxq_f32(vld1q_f32(dst + i), vld1q_f32(src + i)));
+    }
+#endif
+    for (; i < count; ++i) {
+        dst[i] = std::max(dst[i], src[i]);
+    }
+}
+
+// 长度为编译期常量的版本，count与N相同，不再使用
+template<size_t N>
+void applyWindowFixed(const float* samples, const float* window, size_t, float* out) {
+    for (size_t i = 0; i < N; ++i) {
+        out[i] = samples[i] * window[i];
+    }
+}
+
+template<size_t N>
+void maxInPlaceFixed(float* dst, const float* src, size_t) {
+#if defined(__ARM_NEON)
+    static_assert(N % 4 == 0, "bin count must be a multiple of 4");
+    for (size_t i = 0; i < N; i += 4) {
+        vst1q_f32(dst + i, vmaxq_f32(vld1q_f32(dst + i), vld1q_f32(src + i)));
+    }
+#else
+    for (size_t i = 0; i < N; ++i) {
+        dst[i] = std::max(dst[i], src[i]);
+    }
+#endif
+}
+
+template<size_t FftSize>
+FrameKernels fixedFrameKernels() {
+    return FrameKernels{&applyWindowFixed<FftSize>, &maxInPlaceFixed<FftSize / 2>, true};
+}
+
+} // namespace
+
+FrameKernels selectFrameKernels(size_t fft_size) {
+    switch (fft_size) {
+    case 512: return fixedFrameKernels<512>();
+    case 1024: return fixedFrameKernels<1024>();
+    case 2048: return fixedFrameKernels<2048>();
+    case 4096: return fixedFrameKernels<4096>();
+    case 8192: return fixedFrameKernels<8192>();
+    default: return FrameKernels{&applyWindowGeneric, &maxInPlaceGeneric, false};
+    }
+}
+
+} // namespace afp
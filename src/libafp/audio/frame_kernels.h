@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+
+namespace afp {
+
+// 加窗：out[i] = samples[i] * window[i]，i < count
+using ApplyWindowKernel = void (*)(const float* samples, const float* window, size_t count, float* out);
+
+// 逐元素取最大值：dst[i] = max(dst[i], src[i])，i < count
+using MaxInPlaceKernel = void (*)(float* dst, const float* src, size_t count);
+
+// 按FFT大小特化的一组帧内核
+// 配置中用到的FFT大小（降采样后的大小也在内）使用循环次数为编译期常量的实例，编译器可以完全展开并向量化，
+// 省去按运行时长度处理尾部的分支；其他大小使用按count循环的通用版本。各版本的结果逐位一致
+struct FrameKernels {
+    ApplyWindowKernel apply_window;     // count = fft_size
+    MaxInPlaceKernel max_in_place;      // count = fft_size / 2，即每帧的bin数
+    bool specialized;                   // 是否为编译期长度的实例
+};
+
+// 选择帧内核，FftPhase和PeakExtractor构造时调用一次
+FrameKernels selectFrameKernels(size_t fft_size);
+
+} // namespace afp
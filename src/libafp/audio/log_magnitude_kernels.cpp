@@ -0,0 +1,289 @@
+#include "audio/log_magnitude_kernels.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define AFP_LOGMAG_SIMD_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AFP_LOGMAG_SIMD_SSE2 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define AFP_LOGMAG_SIMD_NEON 1
+#endif
+
+namespace afp {
+
+namespace {
+
+// 幅度阈值1e-5对应的功率阈值
+constexpr float kMinPower = 1e-10f;
+// 10*log10(p) = kDbPerNeper * ln(p)
+constexpr float kDbPerNeper = 4.342944819032518f;
+constexpr float kDbOffset = 100.0f;
+
+// Cephes logf：尾数归一化到[sqrt(0.5), sqrt(2))后用8阶多项式逼近ln(1+x)，ln2拆成两部分减小舍入误差
+constexpr float kSqrtHalf = 0.707106781186547524f;
+constexpr float kLogP0 = 7.0376836292e-2f;
+constexpr float kLogP1 = -1.1514610310e-1f;
+constexpr float kLogP2 = 1.1676998740e-1f;
+constexpr float kLogP3 = -1.2420140846e-1f;
+constexpr float kLogP4 = 1.4249322787e-1f;
+constexpr float kLogP5 = -1.6668057665e-1f;
+constexpr float kLogP6 = 2.0000714765e-1f;
+constexpr float kLogP7 = -2.4999993993e-1f;
+constexpr float kLogP8 = 3.3333331174e-1f;
+constexpr float kLn2Low = -2.12194440e-4f;
+constexpr float kLn2High = 0.693359375f;
+
+// 标量版本的近似ln，只用于正规化的正数
+inline float logApprox(float x) {
+    uint32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    float e = static_cast<float>(static_cast<int32_t>(bits >> 23) - 0x7e);
+    bits = (bits & 0x007fffffu) | 0x3f000000u;  // 尾数放到[0.5, 1)
+    float m;
+    std::memcpy(&m, &bits, sizeof(m));
+    if (m < kSqrtHalf) {
+        e -= 1.0f;
+        m = m + m - 1.0f;
+    } else {
+        m = m - 1.0f;
+    }
+
+    const float z = m * m;
+    float y = kLogP0;
+    y = y * m + kLogP1;
+    y = y * m + kLogP2;
+    y = y * m + kLogP3;
+    y = y * m + kLogP4;
+    y = y * m + kLogP5;
+    y = y * m + kLogP6;
+    y = y * m + kLogP7;
+    y = y * m + kLogP8;
+    y = y * m * z;
+    y += e * kLn2Low;
+    y -= 0.5f * z;
+    return m + y + e * kLn2High;
+}
+
+inline float powerToDb(float power) {
+    return power > kMinPower ? kDbPerNeper * logApprox(power) + kDbOffset : 0.0f;
+}
+
+void logMagnitudeFastScalar(const std::complex<float>* spectrum, size_t count, float scale2, float* magnitudes) {
+    for (size_t i = 0; i < count; ++i) {
+        const float re = spectrum[i].real();
+        const float im = spectrum[i].imag();
+        magnitudes[i] = powerToDb((re * re + im * im) * scale2);
+    }
+}
+
+#if defined(AFP_LOGMAG_SIMD_AVX2)
+
+constexpr size_t kLanes = 8;
+
+inline __m256 logApprox(__m256 x) {
+    __m256i bits = _mm256_castps_si256(x);
+    __m256 e = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(0x7e)));
+    bits = _mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007fffff)), _mm256_set1_epi32(0x3f000000));
+    __m256 m = _mm256_castsi256_ps(bits);
+
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 below = _mm256_cmp_ps(m, _mm256_set1_ps(kSqrtHalf), _CMP_LT_OQ);
+    e = _mm256_sub_ps(e, _mm256_and_ps(below, one));
+    m = _mm256_add_ps(_mm256_sub_ps(m, one), _mm256_and_ps(below, m));
+
+    const __m256 z = _mm256_mul_ps(m, m);
+    __m256 y = _mm256_set1_ps(kLogP0);
+    y = _mm256_add_ps(_mm256_mul_ps(y, m), _mm256_set1_ps(kLogP1));
+    y = _mm256_add_ps(_mm256_mul_ps(y, m), _mm256_set1_ps(kLogP2));
+    y = _mm256_add_ps(_mm256_mul_ps(y, m), _mm256_set1_ps(kLogP3));
+    y = _mm256_add_ps(_mm256_mul_ps(y, m), _mm256_set1_ps(kLogP4));
+    y = _mm256_add_ps(_mm256_mul_ps(y, m), _mm256_set1_ps(kLogP5));
+    y = _mm256_add_ps(_mm256_mul_ps(y, m), _mm256_set1_ps(kLogP6));
+    y = _mm256_add_ps(_mm256_mul_ps(y, m), _mm256_set1_ps(kLogP7));
+    y = _mm256_add_ps(_mm256_mul_ps(y, m), _mm256_set1_ps(kLogP8));
+    y = _mm256_mul_ps(_mm256_mul_ps(y, m), z);
+    y = _mm256_add_ps(y, _mm256_mul_ps(e, _mm256_set1_ps(kLn2Low)));
+    y = _mm256_sub_ps(y, _mm256_mul_ps(z, _mm256_set1_ps(0.5f)));
+    return _mm256_add_ps(_mm256_add_ps(m, y), _mm256_mul_ps(e, _mm256_set1_ps(kLn2High)));
+}
+
+// 8个交错存放的复数 -> 8个功率值
+inline __m256 loadPower(const float* src) {
+    const __m256 a = _mm256_loadu_ps(src);
+    const __m256 b = _mm256_loadu_ps(src + 8);
+    // hadd按128位通道工作，结果顺序为[p0 p1 p4 p5 | p2 p3 p6 p7]，再按64位重排
+    const __m256 sum = _mm256_hadd_ps(_mm256_mul_ps(a, a), _mm256_mul_ps(b, b));
+    return _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(sum), _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+inline void storeDb(__m256 power, float* dst) {
+    const __m256 valid = _mm256_cmp_ps(power, _mm256_set1_ps(kMinPower), _CMP_GT_OQ);
+    // 无效的bin先替换成1，避免对0和非正规数取对数
+    const __m256 safe = _mm256_blendv_ps(_mm256_set1_ps(1.0f), power, valid);
+    const __m256 db = _mm256_add_ps(_mm256_mul_ps(logApprox(safe), _mm256_set1_ps(kDbPerNeper)), _mm256_set1_ps(kDbOffset));
+    _mm256_storeu_ps(dst, _mm256_and_ps(db, valid));
+}
+
+inline __m256 setScale(float scale2) { return _mm256_set1_ps(scale2); }
+inline __m256 mulScale(__m256 power, __m256 scale2) { return _mm256_mul_ps(power, scale2); }
+
+#elif defined(AFP_LOGMAG_SIMD_SSE2)
+
+constexpr size_t kLanes = 4;
+
+inline __m128 logApprox(__m128 x) {
+    __m128i bits = _mm_castps_si128(x);
+    __m128 e = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(0x7e)));
+    bits = _mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)), _mm_set1_epi32(0x3f000000));
+    __m128 m = _mm_castsi128_ps(bits);
+
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 below = _mm_cmplt_ps(m, _mm_set1_ps(kSqrtHalf));
+    e = _mm_sub_ps(e, _mm_and_ps(below, one));
+    m = _mm_add_ps(_mm_sub_ps(m, one), _mm_and_ps(below, m));
+
+    const __m128 z = _mm_mul_ps(m, m);
+    __m128 y = _mm_set1_ps(kLogP0);
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(kLogP1));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(kLogP2));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(kLogP3));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(kLogP4));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(kLogP5));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(kLogP6));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(kLogP7));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(kLogP8));
+    y = _mm_mul_ps(_mm_mul_ps(y, m), z);
+    y = _mm_add_ps(y, _mm_mul_ps(e, _mm_set1_ps(kLn2Low)));
+    y = _mm_sub_ps(y, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+    return _mm_add_ps(_mm_add_ps(m, y), _mm_mul_ps(e, _mm_set1_ps(kLn2High)));
+}
+
+// 4个交错存放的复数 -> 4个功率值
+inline __m128 loadPower(const float* src) {
+    const __m128 a = _mm_loadu_ps(src);
+    const __m128 b = _mm_loadu_ps(src + 4);
+    const __m128 a2 = _mm_mul_ps(a, a);
+    const __m128 b2 = _mm_mul_ps(b, b);
+    return _mm_add_ps(_mm_shuffle_ps(a2, b2, _MM_SHUFFLE(2, 0, 2, 0)),
+                      _mm_shuffle_ps(a2, b2, _MM_SHUFFLE(3, 1, 3, 1)));
+}
+
+inline void storeDb(__m128 power, float* dst) {
+    const __m128 valid = _mm_cmpgt_ps(power, _mm_set1_ps(kMinPower));
+    // 无效的bin先替换成1，避免对0和非正规数取对数
+    const __m128 safe = _mm_or_ps(_mm_and_ps(valid, power), _mm_andnot_ps(valid, _mm_set1_ps(1.0f)));
+    const __m128 db = _mm_add_ps(_mm_mul_ps(logApprox(safe), _mm_set1_ps(kDbPerNeper)), _mm_set1_ps(kDbOffset));
+    _mm_storeu_ps(dst, _mm_and_ps(db, valid));
+}
+
+inline __m128 setScale(float scale2) { return _mm_set1_ps(scale2); }
+inline __m128 mulScale(__m128 power, __m128 scale2) { return _mm_mul_ps(power, scale2); }
+
+#elif defined(AFP_LOGMAG_SIMD_NEON)
+
+constexpr size_t kLanes = 4;
+
+inline float32x4_t logApprox(float32x4_t x) {
+    uint32x4_t bits = vreinterpretq_u32_f32(x);
+    float32x4_t e = vcvtq_f32_s32(vsubq_s32(vreinterpretq_s32_u32(vshrq_n_u32(bits, 23)), vdupq_n_s32(0x7e)));
+    bits = vorrq_u32(vandq_u32(bits, vdupq_n_u32(0x007fffff)), vdupq_n_u32(0x3f000000));
+    float32x4_t m = vreinterpretq_f32_u32(bits);
+
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const uint32x4_t below = vcltq_f32(m, vdupq_n_f32(kSqrtHalf));
+    e = vsubq_f32(e, vreinterpretq_f32_u32(vandq_u32(below, vreinterpretq_u32_f32(one))));
+    m = vaddq_f32(vsubq_f32(m, one), vreinterpretq_f32_u32(vandq_u32(below, vreinterpretq_u32_f32(m))));
+
+    const float32x4_t z = vmulq_f32(m, m);
+    float32x4_t y = vdupq_n_f32(kLogP0);
+    y = vaddq_f32(vmulq_f32(y, m), vdupq_n_f32(kLogP1));
+    y = vaddq_f32(vmulq_f32(y, m), vdupq_n_f32(kLogP2));
+    y = vaddq_f32(vmulq_f32(y, m), vdupq_n_f32(kLogP3));
+    y = vaddq_f32(vmulq_f32(y, m), vdupq_n_f32(kLogP4));
+    y = vaddq_f32(vmulq_f32(y, m), vdupq_n_f32(kLogP5));
+    y = vaddq_f32(vmulq_f32(y, m), vdupq_n_f32(kLogP6));
+    y = vaddq_f32(vmulq_f32(y, m), vdupq_n_f32(kLogP7));
+    y = vaddq_f32(vmulq_f32(y, m), vdupq_n_f32(kLogP8));
+    y = vmulq_f32(vmulq_f32(y, m), z);
+    y = vaddq_f32(y, vmulq_f32(e, vdupq_n_f32(kLn2Low)));
+    y = vsubq_f32(y, vmulq_f32(z, vdupq_n_f32(0.5f)));
+    return vaddq_f32(vaddq_f32(m, y), vmulq_f32(e, vdupq_n_f32(kLn2High)));
+}
+
+// 4个交错存放的复数 -> 4个功率值，vld2在加载时完成实部、虚部分离
+inline float32x4_t loadPower(const float* src) {
+    const float32x4x2_t z = vld2q_f32(src);
+    return vaddq_f32(vmulq_f32(z.val[0], z.val[0]), vmulq_f32(z.val[1], z.val[1]));
+}
+
+inline void storeDb(float32x4_t power, float* dst) {
+    const uint32x4_t valid = vcgtq_f32(power, vdupq_n_f32(kMinPower));
+    // 无效的bin先替换成1，避免对0和非正规数取对数
+    const float32x4_t safe = vbslq_f32(valid, power, vdupq_n_f32(1.0f));
+    const float32x4_t db = vaddq_f32(vmulq_f32(logApprox(safe), vdupq_n_f32(kDbPerNeper)), vdupq_n_f32(kDbOffset));
+    vst1q_f32(dst, vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(db), valid)));
+}
+
+inline float32x4_t setScale(float scale2) { return vdupq_n_f32(scale2); }
+inline float32x4_t mulScale(float32x4_t power, float32x4_t scale2) { return vmulq_f32(power, scale2); }
+
+#endif
+
+} // namespace
+
+void logMagnitudeExact(const std::complex<float>* spectrum, size_t count, float scale, float* magnitudes) {
+    for (size_t i = 0; i < count; ++i) {
+        const float magnitude = std::abs(spectrum[i]) * scale;
+        // 对数频谱，保持绝对值以确保不同短帧之间的可比性
+        magnitudes[i] = magnitude > 0.00001f ? 20.0f * std::log10(magnitude) + 100.0f : 0;
+    }
+}
+
+void logMagnitudeFast(const std::complex<float>* spectrum, size_t count, float scale, float* magnitudes) {
+    const float scale2 = scale * scale;
+    size_t i = 0;
+#if defined(AFP_LOGMAG_SIMD_AVX2) || defined(AFP_LOGMAG_SIMD_SSE2) || defined(AFP_LOGMAG_SIMD_NEON)
+    // std::complex<float>保证按实部、虚部交错存放
+    const float* src = reinterpret_cast<const float*>(spectrum);
+    const auto scale_vec = setScale(scale2);
+    for (; i + kLanes <= count; i += kLanes) {
+        storeDb(mulScale(loadPower(src + 2 * i), scale_vec), magnitudes + i);
+    }
+#endif
+    logMagnitudeFastScalar(spectrum + i, count - i, scale2, magnitudes + i);
+}
+
+LogMagnitudeKernel selectLogMagnitudeKernel(bool fast) {
+    return fast ? &logMagnitudeFast : &logMagnitudeExact;
+}
+
+void quantizeMagnitudes(float* magnitudes, size_t count, uint32_t bits) {
+    // 网格上限取2^bits个刻度，步长为2的负幂，量化后的值在float中精确表示
+    const float steps_per_db = bits >= 16 ? 256.0f : 2.0f;
+    const float max_code = bits >= 16 ? 65535.0f : 255.0f;
+    const float db_per_step = 1.0f / steps_per_db;
+    for (size_t i = 0; i < count; ++i) {
+        const float code = std::min(std::nearbyint(magnitudes[i] * steps_per_db), max_code);
+        magnitudes[i] = code * db_per_step;
+    }
+}
+
+const char* logMagnitudeSimdName() {
+#if defined(AFP_LOGMAG_SIMD_AVX2)
+    return "avx2";
+#elif defined(AFP_LOGMAG_SIMD_SSE2)
+    return "sse2";
+#elif defined(AFP_LOGMAG_SIMD_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+} // namespace afp
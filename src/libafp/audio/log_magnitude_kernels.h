@@ -0,0 +1,30 @@
+#pragma once
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+
+namespace afp {
+
+// 把count个复数频谱bin转换为对数幅度：幅度|X|*scale大于1e-5时输出20*log10(|X|*scale)+100，否则输出0
+using LogMagnitudeKernel = void (*)(const std::complex<float>* spectrum, size_t count, float scale, float* magnitudes);
+
+// 逐bin的标量版本：std::abs后取log10，作为精确参考
+void logMagnitudeExact(const std::complex<float>* spectrum, size_t count, float scale, float* magnitudes);
+
+// 快速版本：在功率域计算10*log10(re²+im²)，省去开方；对数用Cephes logf的多项式近似，
+// 按编译目标使用AVX2/SSE2/NEON一次处理多个bin，尾部用同一近似的标量版本
+// 与精确版本的差异在1e-3dB以内，不影响峰值检测的比较
+void logMagnitudeFast(const std::complex<float>* spectrum, size_t count, float scale, float* magnitudes);
+
+// 按配置选择内核，FftPhase构造时调用一次
+LogMagnitudeKernel selectLogMagnitudeKernel(bool fast);
+
+// 把对数幅度量化到FFTConfig::magnitudeQuantizationBits（8或16）对应的网格，就地修改
+// 幅度非负，超出网格上限的截断到上限
+void quantizeMagnitudes(float* magnitudes, size_t count, uint32_t bits);
+
+// 快速版本使用的SIMD指令集名称，未启用时为"scalar"
+const char* logMagnitudeSimdName();
+
+} // namespace afp
@@ -0,0 +1,418 @@
+#include "audio/pcm_convert_kernels.h"
+#include <algorithm>
+#include <cstring>
+
+// SIMD路径假设主机为小端（x86与ARM的常见ABI均如此），大端数据在寄存器内交换字节序
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define AFP_PCM_SIMD_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AFP_PCM_SIMD_SSE2 1
+#elif defined(__ARM_NEON) && (!defined(__BYTE_ORDER__) || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#include <arm_neon.h>
+#define AFP_PCM_SIMD_NEON 1
+#endif
+
+namespace afp {
+
+namespace {
+
+// 按字节序从ptr读取N字节的无符号整数，循环在编译期展开
+template<size_t N, bool BigEndian>
+inline uint64_t loadBits(const uint8_t* ptr) {
+    uint64_t bits = 0;
+    for (size_t i = 0; i < N; ++i) {
+        bits |= static_cast<uint64_t>(ptr[BigEndian ? N - 1 - i : i]) << (8 * i);
+    }
+    return bits;
+}
+
+// 标量样本解码，每种格式一个特化
+template<SampleFormat Format, bool BigEndian>
+struct SampleCodec;
+
+template<bool BigEndian>
+struct SampleCodec<SampleFormat::S8, BigEndian> {
+    static constexpr size_t kBytes = 1;
+    static float decode(const uint8_t* ptr) {
+        return static_cast<float>(static_cast<int8_t>(ptr[0])) / 128.0f;
+    }
+};
+
+template<bool BigEndian>
+struct SampleCodec<SampleFormat::U8, BigEndian> {
+    static constexpr size_t kBytes = 1;
+    static float decode(const uint8_t* ptr) {
+        return (static_cast<float>(ptr[0]) - 128.0f) / 128.0f;
+    }
+};
+
+template<bool BigEndian>
+struct SampleCodec<SampleFormat::S16, BigEndian> {
+    static constexpr size_t kBytes = 2;
+    static float decode(const uint8_t* ptr) {
+        const auto value = static_cast<int16_t>(loadBits<2, BigEndian>(ptr));
+        return static_cast<float>(value) / 32768.0f;
+    }
+};
+
+template<bool BigEndian>
+struct SampleCodec<SampleFormat::U16, BigEndian> {
+    static constexpr size_t kBytes = 2;
+    static float decode(const uint8_t* ptr) {
+        const auto value = static_cast<uint16_t>(loadBits<2, BigEndian>(ptr));
+        return (static_cast<float>(value) - 32768.0f) / 32768.0f;
+    }
+};
+
+template<bool BigEndian>
+struct SampleCodec<SampleFormat::S24, BigEndian> {
+    static constexpr size_t kBytes = 3;
+    static float decode(const uint8_t* ptr) {
+        // 左移到高位再算术右移完成符号扩展
+        const auto value = static_cast<int32_t>(static_cast<uint32_t>(loadBits<3, BigEndian>(ptr)) << 8) >> 8;
+        return static_cast<float>(value) / 8388608.0f;
+    }
+};
+
+template<bool BigEndian>
+struct SampleCodec<SampleFormat::U24, BigEndian> {
+    static constexpr size_t kBytes = 3;
+    static float decode(const uint8_t* ptr) {
+        const auto value = static_cast<uint32_t>(loadBits<3, BigEndian>(ptr));
+        return (static_cast<float>(value) - 8388608.0f) / 8388608.0f;
+    }
+};
+
+template<bool BigEndian>
+struct SampleCodec<SampleFormat::S32, BigEndian> {
+    static constexpr size_t kBytes = 4;
+    static float decode(const uint8_t* ptr) {
+        const auto value = static_cast<int32_t>(static_cast<uint32_t>(loadBits<4, BigEndian>(ptr)));
+        return static_cast<float>(value) / 2147483648.0f;
+    }
+};
+
+template<bool BigEndian>
+struct SampleCodec<SampleFormat::U32, BigEndian> {
+    static constexpr size_t kBytes = 4;
+    static float decode(const uint8_t* ptr) {
+        const auto value = static_cast<uint32_t>(loadBits<4, BigEndian>(ptr));
+        return (static_cast<float>(value) - 2147483648.0f) / 2147483648.0f;
+    }
+};
+
+template<bool BigEndian>
+struct SampleCodec<SampleFormat::F32, BigEndian> {
+    static constexpr size_t kBytes = 4;
+    static float decode(const uint8_t* ptr) {
+        const auto bits = static_cast<uint32_t>(loadBits<4, BigEndian>(ptr));
+        float value;
+        std::memcpy(&value, &bits, sizeof(float));
+        return value;
+    }
+};
+
+template<bool BigEndian>
+struct SampleCodec<SampleFormat::F64, BigEndian> {
+    static constexpr size_t kBytes = 8;
+    static float decode(const uint8_t* ptr) {
+        const auto bits = loadBits<8, BigEndian>(ptr);
+        double value;
+        std::memcpy(&value, &bits, sizeof(double));
+        return static_cast<float>(value);
+    }
+};
+
+// 向量化加载：一次读取kLanes个连续样本并转换成float向量
+// 只为S16/S32/F32特化，其余格式kEnabled为false走标量路径
+// 整数样本的缩放系数都是2的幂，乘以倒数与标量版本的除法结果一致
+template<SampleFormat Format, bool BigEndian>
+struct SimdLoader {
+    static constexpr bool kEnabled = false;
+};
+
+#if defined(AFP_PCM_SIMD_AVX2)
+
+using FloatVec = __m256;
+constexpr size_t kLanes = 8;
+
+inline void storeVec(float* dst, FloatVec value) {
+    _mm256_storeu_ps(dst, value);
+}
+
+// (L0 R0 L1 R1 L2 R2 L3 R3), (L4 R4 ... L7 R7) -> (L0 ... L7), (R0 ... R7)
+inline void deinterleave(FloatVec a, FloatVec b, FloatVec& left, FloatVec& right) {
+    const __m256 evens = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+    const __m256 odds = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+    // shuffle_ps在128位通道内进行，结果的64位块顺序为(0, 2, 1, 3)
+    left = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(evens), _MM_SHUFFLE(3, 1, 2, 0)));
+    right = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(odds), _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+inline __m256i swapBytes32(__m256i value) {
+    const __m256i mask = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                          3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    return _mm256_shuffle_epi8(value, mask);
+}
+
+template<bool BigEndian>
+struct SimdLoader<SampleFormat::S16, BigEndian> {
+    static constexpr bool kEnabled = true;
+    static FloatVec load(const uint8_t* ptr) {
+        __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+        if (BigEndian) {
+            value = _mm_or_si128(_mm_slli_epi16(value, 8), _mm_srli_epi16(value, 8));
+        }
+        const __m256 samples = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(value));
+        return _mm256_mul_ps(samples, _mm256_set1_ps(1.0f / 32768.0f));
+    }
+};
+
+template<bool BigEndian>
+struct SimdLoader<SampleFormat::S32, BigEndian> {
+    static constexpr bool kEnabled = true;
+    static FloatVec load(const uint8_t* ptr) {
+        __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr));
+        if (BigEndian) {
+            value = swapBytes32(value);
+        }
+        return _mm256_mul_ps(_mm256_cvtepi32_ps(value), _mm256_set1_ps(1.0f / 2147483648.0f));
+    }
+};
+
+template<bool BigEndian>
+struct SimdLoader<SampleFormat::F32, BigEndian> {
+    static constexpr bool kEnabled = true;
+    static FloatVec load(const uint8_t* ptr) {
+        __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr));
+        if (BigEndian) {
+            value = swapBytes32(value);
+        }
+        return _mm256_castsi256_ps(value);
+    }
+};
+
+#elif defined(AFP_PCM_SIMD_SSE2)
+
+using FloatVec = __m128;
+constexpr size_t kLanes = 4;
+
+inline void storeVec(float* dst, FloatVec value) {
+    _mm_storeu_ps(dst, value);
+}
+
+// (L0 R0 L1 R1), (L2 R2 L3 R3) -> (L0 L1 L2 L3), (R0 R1 R2 R3)
+inline void deinterleave(FloatVec a, FloatVec b, FloatVec& left, FloatVec& right) {
+    left = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+    right = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+}
+
+inline __m128i swapBytes16(__m128i value) {
+    return _mm_or_si128(_mm_slli_epi16(value, 8), _mm_srli_epi16(value, 8));
+}
+
+// SSE2没有字节重排指令：先交换每个16位内的字节，再交换32位内的两个16位
+inline __m128i swapBytes32(__m128i value) {
+    const __m128i swapped = swapBytes16(value);
+    return _mm_shufflehi_epi16(_mm_shufflelo_epi16(swapped, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+}
+
+template<bool BigEndian>
+struct SimdLoader<SampleFormat::S16, BigEndian> {
+    static constexpr bool kEnabled = true;
+    static FloatVec load(const uint8_t* ptr) {
+        __m128i value = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ptr));
+        if (BigEndian) {
+            value = swapBytes16(value);
+        }
+        // 每个样本复制到32位的高16位，算术右移完成符号扩展
+        const __m128i widened = _mm_srai_epi32(_mm_unpacklo_epi16(value, value), 16);
+        return _mm_mul_ps(_mm_cvtepi32_ps(widened), _mm_set1_ps(1.0f / 32768.0f));
+    }
+};
+
+template<bool BigEndian>
+struct SimdLoader<SampleFormat::S32, BigEndian> {
+    static constexpr bool kEnabled = true;
+    static FloatVec load(const uint8_t* ptr) {
+        __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+        if (BigEndian) {
+            value = swapBytes32(value);
+        }
+        return _mm_mul_ps(_mm_cvtepi32_ps(value), _mm_set1_ps(1.0f / 2147483648.0f));
+    }
+};
+
+template<bool BigEndian>
+struct SimdLoader<SampleFormat::F32, BigEndian> {
+    static constexpr bool kEnabled = true;
+    static FloatVec load(const uint8_t* ptr) {
+        __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+        if (BigEndian) {
+            value = swapBytes32(value);
+        }
+        return _mm_castsi128_ps(value);
+    }
+};
+
+#elif defined(AFP_PCM_SIMD_NEON)
+
+using FloatVec = float32x4_t;
+constexpr size_t kLanes = 4;
+
+inline void storeVec(float* dst, FloatVec value) {
+    vst1q_f32(dst, value);
+}
+
+inline void deinterleave(FloatVec a, FloatVec b, FloatVec& left, FloatVec& right) {
+    const float32x4x2_t unzipped = vuzpq_f32(a, b);
+    left = unzipped.val[0];
+    right = unzipped.val[1];
+}
+
+template<bool BigEndian>
+struct SimdLoader<SampleFormat::S16, BigEndian> {
+    static constexpr bool kEnabled = true;
+    static FloatVec load(const uint8_t* ptr) {
+        uint8x8_t bytes = vld1_u8(ptr);
+        if (BigEndian) {
+            bytes = vrev16_u8(bytes);
+        }
+        const int32x4_t widened = vmovl_s16(vreinterpret_s16_u8(bytes));
+        return vmulq_n_f32(vcvtq_f32_s32(widened), 1.0f / 32768.0f);
+    }
+};
+
+template<bool BigEndian>
+struct SimdLoader<SampleFormat::S32, BigEndian> {
+    static constexpr bool kEnabled = true;
+    static FloatVec load(const uint8_t* ptr) {
+        uint8x16_t bytes = vld1q_u8(ptr);
+        if (BigEndian) {
+            bytes = vrev32q_u8(bytes);
+        }
+        return vmulq_n_f32(vcvtq_f32_s32(vreinterpretq_s32_u8(bytes)), 1.0f / 2147483648.0f);
+    }
+};
+
+template<bool BigEndian>
+struct SimdLoader<SampleFormat::F32, BigEndian> {
+    static constexpr bool kEnabled = true;
+    static FloatVec load(const uint8_t* ptr) {
+        uint8x16_t bytes = vld1q_u8(ptr);
+        if (BigEndian) {
+            bytes = vrev32q_u8(bytes);
+        }
+        return vreinterpretq_f32_u8(bytes);
+    }
+};
+
+#endif
+
+template<SampleFormat Format, bool BigEndian>
+struct ConvertKernels {
+    using Codec = SampleCodec<Format, BigEndian>;
+    using Loader = SimdLoader<Format, BigEndian>;
+    static constexpr size_t kBytes = Codec::kBytes;
+
+    static float decode(const uint8_t* ptr) {
+        return Codec::decode(ptr);
+    }
+
+    static void mono(const uint8_t* src, size_t frameCount, float* dst) {
+        size_t i = 0;
+#if defined(AFP_PCM_SIMD_AVX2) || defined(AFP_PCM_SIMD_SSE2) || defined(AFP_PCM_SIMD_NEON)
+        if constexpr (Loader::kEnabled) {
+            for (; i + kLanes <= frameCount; i += kLanes) {
+                storeVec(dst + i, Loader::load(src + i * kBytes));
+            }
+        }
+#endif
+        for (; i < frameCount; ++i) {
+            dst[i] = Codec::decode(src + i * kBytes);
+        }
+    }
+
+    static void stereo(const uint8_t* src, size_t frameCount, float* left, float* right) {
+        constexpr size_t frameBytes = 2 * kBytes;
+        size_t i = 0;
+#if defined(AFP_PCM_SIMD_AVX2) || defined(AFP_PCM_SIMD_SSE2) || defined(AFP_PCM_SIMD_NEON)
+        if constexpr (Loader::kEnabled) {
+            // 每次读取kLanes帧（2 * kLanes个样本），恰好不越过剩余数据
+            for (; i + kLanes <= frameCount; i += kLanes) {
+                const uint8_t* ptr = src + i * frameBytes;
+                FloatVec l;
+                FloatVec r;
+                deinterleave(Loader::load(ptr), Loader::load(ptr + kLanes * kBytes), l, r);
+                storeVec(left + i, l);
+                storeVec(right + i, r);
+            }
+        }
+#endif
+        for (; i < frameCount; ++i) {
+            const uint8_t* ptr = src + i * frameBytes;
+            left[i] = Codec::decode(ptr);
+            right[i] = Codec::decode(ptr + kBytes);
+        }
+    }
+};
+
+template<SampleFormat Format, bool BigEndian>
+PCMConvertKernels makeKernels() {
+    using Kernels = ConvertKernels<Format, BigEndian>;
+    return PCMConvertKernels{&Kernels::decode, &Kernels::mono, &Kernels::stereo};
+}
+
+template<SampleFormat Format>
+PCMConvertKernels makeKernels(Endianness endianness) {
+    return endianness == Endianness::Big ? makeKernels<Format, true>() : makeKernels<Format, false>();
+}
+
+float decodeSilence(const uint8_t*) {
+    return 0.0f;
+}
+
+void convertMonoSilence(const uint8_t*, size_t frameCount, float* dst) {
+    std::fill(dst, dst + frameCount, 0.0f);
+}
+
+void convertStereoSilence(const uint8_t*, size_t frameCount, float* left, float* right) {
+    std::fill(left, left + frameCount, 0.0f);
+    std::fill(right, right + frameCount, 0.0f);
+}
+
+} // namespace
+
+PCMConvertKernels selectPCMConvertKernels(SampleFormat format, Endianness endianness) {
+    switch (format) {
+        case SampleFormat::S8:  return makeKernels<SampleFormat::S8>(endianness);
+        case SampleFormat::U8:  return makeKernels<SampleFormat::U8>(endianness);
+        case SampleFormat::S16: return makeKernels<SampleFormat::S16>(endianness);
+        case SampleFormat::U16: return makeKernels<SampleFormat::U16>(endianness);
+        case SampleFormat::S24: return makeKernels<SampleFormat::S24>(endianness);
+        case SampleFormat::U24: return makeKernels<SampleFormat::U24>(endianness);
+        case SampleFormat::S32: return makeKernels<SampleFormat::S32>(endianness);
+        case SampleFormat::U32: return makeKernels<SampleFormat::U32>(endianness);
+        case SampleFormat::F32: return makeKernels<SampleFormat::F32>(endianness);
+        case SampleFormat::F64: return makeKernels<SampleFormat::F64>(endianness);
+        default:
+            // 未知格式与原先readSample的行为一致，输出静音
+            return PCMConvertKernels{&decodeSilence, &convertMonoSilence, &convertStereoSilence};
+    }
+}
+
+const char* pcmConvertSimdName() {
+#if defined(AFP_PCM_SIMD_AVX2)
+    return "avx2";
+#elif defined(AFP_PCM_SIMD_SSE2)
+    return "sse2";
+#elif defined(AFP_PCM_SIMD_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+} // namespace afp
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "afp/pcm_format.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace afp {
+
+// 读取单个样本并转换成[-1, 1)范围的float
+using SampleDecoder = float (*)(const uint8_t* ptr);
+
+// 把frameCount帧单声道数据转换到dst
+using MonoConvertKernel = void (*)(const uint8_t* src, size_t frameCount, float* dst);
+
+// 把frameCount帧交错的立体声数据转换并分离到left/right
+using StereoConvertKernel = void (*)(const uint8_t* src, size_t frameCount, float* left, float* right);
+
+// 按样本格式和字节序特化的一组转换内核
+// S16/S32/F32按编译目标使用AVX2/SSE2/NEON批量转换（大端数据在向量寄存器内交换字节序），其余格式为逐样本的标量版本
+// 所有版本的转换结果与标量版本逐位一致
+struct PCMConvertKernels {
+    SampleDecoder decode;
+    MonoConvertKernel mono;
+    StereoConvertKernel stereo;
+};
+
+// 选择转换内核，PCMReader构造时调用一次，之后的转换不再按格式分支
+PCMConvertKernels selectPCMConvertKernels(SampleFormat format, Endianness endianness);
+
+// 当前编译目标使用的SIMD指令集名称，未启用时为"scalar"
+const char* pcmConvertSimdName();
+
+} // namespace afp
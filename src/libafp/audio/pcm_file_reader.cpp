@@ -0,0 +1,47 @@
+#include "audio/pcm_file_reader.h"
+#include <algorithm>
+
+namespace afp {
+
+bool PcmFileReader::open(const std::string& filename, const PCMFormat& format, size_t chunkFrames) {
+    if (format.frameSize() == 0 || format.sampleRate() == 0 || chunkFrames == 0) {
+        return false;
+    }
+    if (!file_.open(filename)) {
+        return false;
+    }
+    file_.adviseSequential();
+
+    frameSize_ = format.frameSize();
+    chunkBytes_ = chunkFrames * frameSize_;
+    sampleRate_ = format.sampleRate();
+    offset_ = 0;
+    released_ = 0;
+    return true;
+}
+
+bool PcmFileReader::next(Chunk& chunk) {
+    // 上一块已交给调用方处理完毕，释放其页面
+    if (offset_ > released_) {
+        file_.releaseRange(released_, offset_ - released_);
+        released_ = offset_;
+    }
+
+    const size_t remaining = (file_.size() - offset_) / frameSize_ * frameSize_;
+    if (remaining == 0) {
+        return false;
+    }
+
+    chunk.data = file_.data() + offset_;
+    chunk.size = std::min(chunkBytes_, remaining);
+    chunk.startTimestamp = static_cast<double>(offset_ / frameSize_) / sampleRate_;
+    offset_ += chunk.size;
+    return true;
+}
+
+void PcmFileReader::rewind() {
+    offset_ = 0;
+    released_ = 0;
+}
+
+} // namespace afp
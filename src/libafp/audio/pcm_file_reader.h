@@ -0,0 +1,44 @@
+#pragma once
+
+#include "afp/pcm_format.h"
+#include "base/mapped_file.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace afp {
+
+// 分块顺序读取PCM文件，用于把大文件以流的方式送入匹配器或生成器
+// 文件整体只读映射并提示内核顺序预读，不复制到堆上；每块按帧对齐，起始时间戳按已交付的帧数累计；
+// 取下一块时释放上一块的页面，驻留内存与块大小相当而不是整个文件；文件末尾不足一帧的字节被忽略
+class PcmFileReader {
+public:
+    struct Chunk {
+        const uint8_t* data;
+        size_t size;
+        double startTimestamp;  // 块中第一帧的时间（秒）
+    };
+
+    // 映射文件，chunkFrames为每块的帧数；文件不存在或为空时返回false
+    bool open(const std::string& filename, const PCMFormat& format, size_t chunkFrames);
+
+    // 取下一块，上一块的数据随之失效；没有更多数据时返回false
+    bool next(Chunk& chunk);
+
+    // 从头重新读取
+    void rewind();
+
+    // 整个文件的映射视图，用于需要一次访问全部数据的场景（如分段并行生成）
+    const uint8_t* data() const { return file_.data(); }
+    size_t size() const { return file_.size(); }
+
+private:
+    MappedFile file_;
+    size_t frameSize_ = 0;
+    size_t chunkBytes_ = 0;
+    uint32_t sampleRate_ = 0;
+    size_t offset_ = 0;         // 下一块在文件中的位置
+    size_t released_ = 0;       // 已释放页面的范围[0, released_)
+};
+
+} // namespace afp
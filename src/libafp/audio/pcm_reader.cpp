@@ -5,7 +5,8 @@
 namespace afp {
 
 PCMReader::PCMReader(const PCMFormat& format)
-    : format_(format) {
+    : format_(format)
+    , kernels_(selectPCMConvertKernels(format.format(), format.endianness())) {
 }
 
 void PCMReader::process(const void* data, size_t size, SampleCallback callback) {
@@ -24,8 +25,10 @@ void PCMReader::process2(const uint8_t* src_data, size_t src_bytes_count,
         ){
     if (format_.layout() == ChannelLayout::Mono) {
         processMono2(src_data, src_bytes_count, dst_buffers[0], dst_max_capacitys[0], dst_offsets[0], src_consumed_bytes_counts[0]);
-    } else {
+    } else if (format_.channels() == 2) {
         processStereo2(src_data, src_bytes_count, dst_buffers, dst_max_capacitys, dst_offsets, src_consumed_bytes_counts);
+    } else {
+        processMultichannel2(src_data, src_bytes_count, dst_buffers, dst_max_capacitys, dst_offsets, src_consumed_bytes_counts);
     }
 }
 
@@ -47,17 +50,8 @@ void PCMReader::processMono2(const uint8_t* src_data, size_t src_bytes_count,
     // 实际处理的frame数量取两者的最小值
     size_t framesToProcess = std::min(maxSourceFrames, maxDestFrames);
     
-    // 处理每个frame
-    for (size_t i = 0; i < framesToProcess; ++i) {
-        // 使用readSample读取并转换样本
-        float sample = readSample(ptr);
-        
-        // 写入目标缓冲区，考虑偏移量
-        dst_buffer[dst_offset + i] = sample;
-        
-        // 移动源数据指针
-        ptr += frameSize;
-    }
+    // 按格式特化的内核批量转换
+    kernels_.mono(ptr, framesToProcess, dst_buffer + dst_offset);
     
     // 更新消耗的源数据字节数
     src_consumed_bytes_count += framesToProcess * frameSize;
@@ -83,20 +77,41 @@ void PCMReader::processStereo2(const uint8_t* src_data, size_t src_bytes_count,
     // 实际处理的frame数量取三者的最小值
     size_t framesToProcess = std::min({maxSourceFrames, maxLeftFrames, maxRightFrames});
     
-    // 处理每个frame（立体声frame包含左右两个样本）
+    // 按格式特化的内核批量转换并分离左右声道
+    kernels_.stereo(ptr, framesToProcess, dst_buffers[0] + dst_offsets[0], dst_buffers[1] + dst_offsets[1]);
+    
+    // 更新消耗的源数据字节数（对于立体声，所有通道共享同一个源数据流）
+    size_t totalConsumedBytes = framesToProcess * frameSize;
+    for (size_t i = 0; i < src_consumed_bytes_counts.size(); ++i) {
+        src_consumed_bytes_counts[i] += totalConsumedBytes;
+    }
+}
+
+void PCMReader::processMultichannel2(const uint8_t* src_data, size_t src_bytes_count, 
+        ChannelArray<float*>& dst_buffers, 
+        ChannelArray<size_t>& dst_max_capacitys, 
+        ChannelArray<size_t>& dst_offsets,
+        ChannelArray<size_t>& src_consumed_bytes_counts) {
+    
+    const size_t channel_count = format_.channels();
+    const size_t frameSize = format_.frameSize();
+    const size_t sampleSize = format_.sampleSize();
+    
+    // 实际处理的frame数量取源数据和各通道缓冲区剩余空间的最小值
+    size_t framesToProcess = src_bytes_count / frameSize;
+    for (size_t ch = 0; ch < channel_count; ++ch) {
+        framesToProcess = std::min(framesToProcess, dst_max_capacitys[ch] - dst_offsets[ch]);
+    }
+    
+    const uint8_t* ptr = src_data;
     for (size_t i = 0; i < framesToProcess; ++i) {
-        // 读取左声道样本
-        float leftSample = readSample(ptr);
-        dst_buffers[0][dst_offsets[0] + i] = leftSample;
-        ptr += sampleSize;
-        
-        // 读取右声道样本
-        float rightSample = readSample(ptr);
-        dst_buffers[1][dst_offsets[1] + i] = rightSample;
-        ptr += sampleSize;
+        for (size_t ch = 0; ch < channel_count; ++ch) {
+            dst_buffers[ch][dst_offsets[ch] + i] = readSample(ptr);
+            ptr += sampleSize;
+        }
     }
     
-    // 更新消耗的源数据字节数（对于立体声，所有通道共享同一个源数据流）
+    // 所有通道共享同一个源数据流
     size_t totalConsumedBytes = framesToProcess * frameSize;
     for (size_t i = 0; i < src_consumed_bytes_counts.size(); ++i) {
         src_consumed_bytes_counts[i] += totalConsumedBytes;
@@ -131,113 +146,4 @@ void PCMReader::processStereo(const void* data, size_t size, SampleCallback call
     }
 }
 
-float PCMReader::readSample(const uint8_t* ptr) {
-    switch (format_.format()) {
-        case SampleFormat::S8: {
-            int8_t value = *reinterpret_cast<const int8_t*>(ptr);
-            return static_cast<float>(value) / 128.0f;
-        }
-        case SampleFormat::U8: {
-            uint8_t value = *ptr;
-            return (static_cast<float>(value) - 128.0f) / 128.0f;
-        }
-        case SampleFormat::S16: {
-            int16_t value;
-            if (format_.endianness() == Endianness::Little) {
-                value = static_cast<int16_t>(ptr[0] | (ptr[1] << 8));
-            } else {
-                value = static_cast<int16_t>((ptr[0] << 8) | ptr[1]);
-            }
-            return static_cast<float>(value) / 32768.0f;
-        }
-        case SampleFormat::U16: {
-            uint16_t value;
-            if (format_.endianness() == Endianness::Little) {
-                value = static_cast<uint16_t>(ptr[0] | (ptr[1] << 8));
-            } else {
-                value = static_cast<uint16_t>((ptr[0] << 8) | ptr[1]);
-            }
-            return (static_cast<float>(value) - 32768.0f) / 32768.0f;
-        }
-        case SampleFormat::S24: {
-            int32_t value;
-            if (format_.endianness() == Endianness::Little) {
-                value = static_cast<int32_t>(ptr[0] | (ptr[1] << 8) | (ptr[2] << 16));
-            } else {
-                value = static_cast<int32_t>((ptr[0] << 16) | (ptr[1] << 8) | ptr[2]);
-            }
-            // 符号扩展
-            if (value & 0x800000) {
-                value |= 0xFF000000;
-            }
-            return static_cast<float>(value) / 8388608.0f;
-        }
-        case SampleFormat::U24: {
-            uint32_t value;
-            if (format_.endianness() == Endianness::Little) {
-                value = static_cast<uint32_t>(ptr[0] | (ptr[1] << 8) | (ptr[2] << 16));
-            } else {
-                value = static_cast<uint32_t>((ptr[0] << 16) | (ptr[1] << 8) | ptr[2]);
-            }
-            return (static_cast<float>(value) - 8388608.0f) / 8388608.0f;
-        }
-        case SampleFormat::S32: {
-            int32_t value;
-            if (format_.endianness() == Endianness::Little) {
-                value = static_cast<int32_t>(ptr[0] | (ptr[1] << 8) | (ptr[2] << 16) | (ptr[3] << 24));
-            } else {
-                value = static_cast<int32_t>((ptr[0] << 24) | (ptr[1] << 16) | (ptr[2] << 8) | ptr[3]);
-            }
-            return static_cast<float>(value) / 2147483648.0f;
-        }
-        case SampleFormat::U32: {
-            uint32_t value;
-            if (format_.endianness() == Endianness::Little) {
-                value = static_cast<uint32_t>(ptr[0] | (ptr[1] << 8) | (ptr[2] << 16) | (ptr[3] << 24));
-            } else {
-                value = static_cast<uint32_t>((ptr[0] << 24) | (ptr[1] << 16) | (ptr[2] << 8) | ptr[3]);
-            }
-            return (static_cast<float>(value) - 2147483648.0f) / 2147483648.0f;
-        }
-        case SampleFormat::F32: {
-            float value;
-            if (format_.endianness() == Endianness::Little) {
-                uint32_t bits = static_cast<uint32_t>(ptr[0] | (ptr[1] << 8) | (ptr[2] << 16) | (ptr[3] << 24));
-                std::memcpy(&value, &bits, sizeof(float));
-            } else {
-                uint32_t bits = static_cast<uint32_t>((ptr[0] << 24) | (ptr[1] << 16) | (ptr[2] << 8) | ptr[3]);
-                std::memcpy(&value, &bits, sizeof(float));
-            }
-            return value;
-        }
-        case SampleFormat::F64: {
-            double value;
-            if (format_.endianness() == Endianness::Little) {
-                uint64_t bits = static_cast<uint64_t>(ptr[0]) |
-                              (static_cast<uint64_t>(ptr[1]) << 8) |
-                              (static_cast<uint64_t>(ptr[2]) << 16) |
-                              (static_cast<uint64_t>(ptr[3]) << 24) |
-                              (static_cast<uint64_t>(ptr[4]) << 32) |
-                              (static_cast<uint64_t>(ptr[5]) << 40) |
-                              (static_cast<uint64_t>(ptr[6]) << 48) |
-                              (static_cast<uint64_t>(ptr[7]) << 56);
-                std::memcpy(&value, &bits, sizeof(double));
-            } else {
-                uint64_t bits = (static_cast<uint64_t>(ptr[0]) << 56) |
-                              (static_cast<uint64_t>(ptr[1]) << 48) |
-                              (static_cast<uint64_t>(ptr[2]) << 40) |
-                              (static_cast<uint64_t>(ptr[3]) << 32) |
-                              (static_cast<uint64_t>(ptr[4]) << 24) |
-                              (static_cast<uint64_t>(ptr[5]) << 16) |
-                              (static_cast<uint64_t>(ptr[6]) << 8) |
-                              static_cast<uint64_t>(ptr[7]);
-                std::memcpy(&value, &bits, sizeof(double));
-            }
-            return static_cast<float>(value);
-        }
-        default:
-            return 0.0f;
-    }
-}
-
 } // namespace afp 
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include <vector>
 #include <functional>
 #include "base/channel_array.h"
+#include "audio/pcm_convert_kernels.h"
 
 namespace afp {
 
@@ -28,7 +29,7 @@ public:
 
 private:
     // 从原始数据读取样本值
-    float readSample(const uint8_t* ptr);
+    float readSample(const uint8_t* ptr) { return kernels_.decode(ptr); }
     
     // 处理单声道数据
     void processMono(const void* data, size_t size, SampleCallback callback);
@@ -44,6 +45,13 @@ private:
         ChannelArray<size_t>& dst_max_capacitys, 
         ChannelArray<size_t>& dst_offsets,
         ChannelArray<size_t>& src_consumed_bytes_counts);
+
+    // 三个及以上通道的交错数据，逐样本解码后分离到各通道
+    void processMultichannel2(const uint8_t* src_data, size_t src_bytes_count, 
+        ChannelArray<float*>& dst_buffers, 
+        ChannelArray<size_t>& dst_max_capacitys, 
+        ChannelArray<size_t>& dst_offsets,
+        ChannelArray<size_t>& src_consumed_bytes_counts);
     
     // 处理立体声数据
     void processStereo(const void* data, size_t size, SampleCallback callback);
@@ -62,6 +70,7 @@ private:
     T swapEndian(T value) const;
 
     PCMFormat format_;
+    PCMConvertKernels kernels_;  // 构造时按样本格式和字节序选定的转换内核
     float maxValue_;
 };
 
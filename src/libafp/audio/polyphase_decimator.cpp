@@ -0,0 +1,127 @@
+#include "audio/polyphase_decimator.h"
+#include <algorithm>
+#include <cmath>
+#include "base/state_stream.h"
+
+namespace afp {
+
+namespace {
+
+// Blackman窗的过渡带宽度约为5.5/N（以采样率归一化）
+constexpr double kBlackmanTransitionFactor = 5.5;
+
+// 候选的最大降采样倍数
+constexpr size_t kMaxFactor = 8;
+
+} // namespace
+
+size_t PolyphaseDecimator::estimateTapCount(size_t factor, uint32_t sampleRate, size_t maxFreq) {
+    // 通带截止在maxFreq，混叠到maxFreq以下的成分来自fs/D - maxFreq以上，过渡带为两者之间
+    const double outputRate = static_cast<double>(sampleRate) / factor;
+    const double transition = outputRate - 2.0 * static_cast<double>(maxFreq);
+    if (transition <= 0.0) {
+        return 0;
+    }
+    auto count = static_cast<size_t>(std::ceil(kBlackmanTransitionFactor * sampleRate / transition));
+    return count | 1;
+}
+
+size_t PolyphaseDecimator::chooseFactor(uint32_t sampleRate, size_t maxFreq, size_t fftSize, size_t hopSize) {
+    size_t best = 1;
+    for (size_t factor = 2; factor <= kMaxFactor; factor *= 2) {
+        if (fftSize % factor != 0 || hopSize % factor != 0 || sampleRate % factor != 0) {
+            break;
+        }
+        const size_t tapCount = estimateTapCount(factor, sampleRate, maxFreq);
+        if (tapCount == 0 || tapCount > kMaxTapCount) {
+            break;
+        }
+        best = factor;
+    }
+    return best;
+}
+
+PolyphaseDecimator::PolyphaseDecimator(size_t factor, uint32_t sampleRate, size_t maxFreq)
+    : factor_(std::max<size_t>(factor, 1)) {
+    size_t tapCount = factor_ > 1 ? estimateTapCount(factor_, sampleRate, maxFreq) : 1;
+    tapCount = std::min(std::max<size_t>(tapCount, 1), kMaxTapCount);
+    halfLength_ = (tapCount - 1) / 2;
+
+    // 截止频率为新奈奎斯特频率（以输入采样率归一化为0.5/D），归一化到直流增益为1
+    taps_.resize(tapCount);
+    const double cutoff = 0.5 / static_cast<double>(factor_);
+    double sum = 0.0;
+    for (size_t i = 0; i < tapCount; ++i) {
+        const double n = static_cast<double>(i) - static_cast<double>(halfLength_);
+        const double sinc = n == 0.0 ? 2.0 * cutoff : std::sin(2.0 * M_PI * cutoff * n) / (M_PI * n);
+        const double phase = tapCount > 1 ? 2.0 * M_PI * i / (tapCount - 1) : 0.0;
+        const double window = 0.42 - 0.5 * std::cos(phase) + 0.08 * std::cos(2.0 * phase);
+        taps_[i] = static_cast<float>(sinc * window);
+        sum += taps_[i];
+    }
+    for (auto& tap : taps_) {
+        tap = static_cast<float>(tap / sum);
+    }
+
+    reset();
+}
+
+void PolyphaseDecimator::reset() {
+    // 第一个输出以第一个输入样本为中心，左侧不存在的样本视为0
+    history_.assign(halfLength_, 0.0f);
+    nextCenter_ = halfLength_;
+}
+
+size_t PolyphaseDecimator::emitReady(float* output) {
+    size_t written = 0;
+    const size_t tapCount = taps_.size();
+    while (nextCenter_ + halfLength_ < history_.size()) {
+        const float* window = history_.data() + nextCenter_ - halfLength_;
+        float acc = 0.0f;
+        for (size_t k = 0; k < tapCount; ++k) {
+            acc += taps_[k] * window[k];
+        }
+        output[written++] = acc;
+        nextCenter_ += factor_;
+    }
+
+    // 丢弃之后的输出不再用到的样本，只保留一个滤波器长度以内的历史
+    const size_t consumed = std::min(nextCenter_ - halfLength_, history_.size());
+    history_.erase(history_.begin(), history_.begin() + consumed);
+    nextCenter_ -= consumed;
+    return written;
+}
+
+size_t PolyphaseDecimator::process(const float* input, size_t count, float* output) {
+    history_.insert(history_.end(), input, input + count);
+    return emitReady(output);
+}
+
+void PolyphaseDecimator::saveState(StateWriter& writer) const {
+    writer.writeVarint(history_.size());
+    writer.writeFloats(history_.data(), history_.size());
+    writer.writeVarint(nextCenter_);
+}
+
+void PolyphaseDecimator::restoreState(StateReader& reader) {
+    // 每次处理后只保留一个滤波器长度以内的历史
+    std::vector<float> history(reader.readCount(taps_.size() + factor_));
+    reader.readFloats(history.data(), history.size());
+    const size_t next_center = reader.readCount(history.size() + factor_);
+    if (!reader.ok() || next_center < halfLength_) {
+        reader.fail();
+        return;
+    }
+    history_ = std::move(history);
+    nextCenter_ = next_center;
+}
+
+size_t PolyphaseDecimator::drain(float* output) {
+    // 右侧补零，使最后一个真实样本附近的输出也能算出
+    history_.insert(history_.end(), halfLength_, 0.0f);
+    const size_t written = emitReady(output);
+    reset();
+    return written;
+}
+
+} // namespace afp
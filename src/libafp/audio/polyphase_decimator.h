@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace afp {
+
+class StateWriter;
+class StateReader;
+
+// 低通滤波加整数倍降采样
+// 滤波器为Blackman窗的线性相位sinc，截止在新奈奎斯特频率，只在输出采样点上计算卷积（每D个输入算一次）
+// 输出第m个样本与输入第m*D个样本对齐：滤波器的群延迟通过预填零和排空补偿，时间轴不偏移
+class PolyphaseDecimator {
+public:
+    // 允许的最大抽头数，过渡带太窄需要更长的滤波器时放弃该降采样倍数
+    static constexpr size_t kMaxTapCount = 255;
+
+    // 选择降采样倍数：在保持fftSize、hopSize都能整除（时间和频率分辨率不变）、
+    // 新奈奎斯特频率仍高于maxFreq的前提下取最大的2的幂，不满足时返回1
+    static size_t chooseFactor(uint32_t sampleRate, size_t maxFreq, size_t fftSize, size_t hopSize);
+
+    PolyphaseDecimator(size_t factor, uint32_t sampleRate, size_t maxFreq);
+
+    // 处理一段输入，输出追加写入output，返回写入的样本数；output至少要能容纳maxOutputCount(count)个样本
+    size_t process(const float* input, size_t count, float* output);
+
+    // 输入结束：补零排空尚在滤波器中的样本，返回写入的样本数，之后恢复到初始状态
+    size_t drain(float* output);
+
+    // 处理count个输入样本时最多产生的输出数量
+    size_t maxOutputCount(size_t count) const {
+        return (count + taps_.size()) / factor_ + 1;
+    }
+
+    size_t factor() const { return factor_; }
+    size_t tapCount() const { return taps_.size(); }
+
+    // 保存/恢复尚未用完的输入历史，滤波器系数由构造参数决定，不保存
+    void saveState(StateWriter& writer) const;
+    void restoreState(StateReader& reader);
+
+    // 滤波器系数和输入历史占用的内存（字节）
+    size_t memoryUsage() const { return (taps_.capacity() + history_.capacity()) * sizeof(float); }
+
+private:
+    // 按过渡带宽度估算的抽头数（奇数）
+    static size_t estimateTapCount(size_t factor, uint32_t sampleRate, size_t maxFreq);
+
+    void reset();
+
+    // 计算history_中所有输入已经到齐的输出
+    size_t emitReady(float* output);
+
+    size_t factor_;
+    size_t halfLength_;           // (抽头数 - 1) / 2，即群延迟
+    std::vector<float> taps_;
+    std::vector<float> history_;  // 尚未用完的输入样本
+    size_t nextCenter_;           // 下一个输出对应的中心样本在history_中的下标
+};
+
+} // namespace afp
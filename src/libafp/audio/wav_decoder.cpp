@@ -0,0 +1,176 @@
+#include "audio/wav_decoder.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace afp {
+
+namespace {
+
+// 每次从文件读取的源帧数
+constexpr size_t kSourceBlockFrames = 4096;
+
+constexpr uint16_t kWaveFormatPcm = 1;
+constexpr uint16_t kWaveFormatFloat = 3;
+constexpr uint16_t kWaveFormatExtensible = 0xFFFE;
+
+uint16_t readLe16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t readLe32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+bool sampleFormatOf(uint16_t formatTag, uint16_t bitsPerSample, SampleFormat& format) {
+    if (formatTag == kWaveFormatPcm) {
+        switch (bitsPerSample) {
+            case 8: format = SampleFormat::U8; return true;
+            case 16: format = SampleFormat::S16; return true;
+            case 24: format = SampleFormat::S24; return true;
+            case 32: format = SampleFormat::S32; return true;
+            default: return false;
+        }
+    }
+    if (formatTag == kWaveFormatFloat) {
+        switch (bitsPerSample) {
+            case 32: format = SampleFormat::F32; return true;
+            case 64: format = SampleFormat::F64; return true;
+            default: return false;
+        }
+    }
+    return false;
+}
+
+int16_t toS16(float sample) {
+    const float scaled = std::round(sample * 32768.0f);
+    return static_cast<int16_t>(std::min(32767.0f, std::max(-32768.0f, scaled)));
+}
+
+} // namespace
+
+bool WavDecoder::open(const std::string& filename, uint32_t sampleRate) {
+    file_.open(filename, std::ios::binary);
+    if (!file_.is_open()) {
+        std::cerr << "无法打开WAV文件: " << filename << std::endl;
+        return false;
+    }
+
+    uint8_t header[12];
+    if (!file_.read(reinterpret_cast<char*>(header), sizeof(header)) ||
+        std::memcmp(header, "RIFF", 4) != 0 || std::memcmp(header + 8, "WAVE", 4) != 0) {
+        std::cerr << "不是有效的WAV文件: " << filename << std::endl;
+        return false;
+    }
+
+    // 依次查找fmt和data块，其余块跳过（块大小为奇数时有一个填充字节）
+    bool hasFormat = false;
+    while (true) {
+        uint8_t chunkHeader[8];
+        if (!file_.read(reinterpret_cast<char*>(chunkHeader), sizeof(chunkHeader))) {
+            std::cerr << "WAV文件缺少data块: " << filename << std::endl;
+            return false;
+        }
+        const uint32_t chunkSize = readLe32(chunkHeader + 4);
+
+        if (std::memcmp(chunkHeader, "fmt ", 4) == 0) {
+            std::vector<uint8_t> fmt(chunkSize);
+            if (chunkSize < 16 || !file_.read(reinterpret_cast<char*>(fmt.data()), chunkSize)) {
+                std::cerr << "WAV文件的fmt块无效: " << filename << std::endl;
+                return false;
+            }
+            uint16_t formatTag = readLe16(fmt.data());
+            channels_ = readLe16(fmt.data() + 2);
+            sourceRate_ = readLe32(fmt.data() + 4);
+            const uint16_t bitsPerSample = readLe16(fmt.data() + 14);
+            // WAVE_FORMAT_EXTENSIBLE的实际格式在子格式GUID的前两个字节
+            if (formatTag == kWaveFormatExtensible && chunkSize >= 40) {
+                formatTag = readLe16(fmt.data() + 24);
+            }
+            SampleFormat format;
+            if (channels_ == 0 || sourceRate_ == 0 || !sampleFormatOf(formatTag, bitsPerSample, format)) {
+                std::cerr << "不支持的WAV格式 (格式: " << formatTag << ", 位深: " << bitsPerSample
+                          << ", 通道数: " << channels_ << "): " << filename << std::endl;
+                return false;
+            }
+            kernels_ = selectPCMConvertKernels(format, Endianness::Little);
+            bytesPerSample_ = bitsPerSample / 8;
+            hasFormat = true;
+        } else if (std::memcmp(chunkHeader, "data", 4) == 0) {
+            if (!hasFormat) {
+                std::cerr << "WAV文件的data块位于fmt块之前: " << filename << std::endl;
+                return false;
+            }
+            remainingBytes_ = chunkSize;
+            break;
+        } else {
+            file_.seekg(chunkSize, std::ios::cur);
+        }
+        if (chunkSize & 1) {
+            file_.seekg(1, std::ios::cur);
+        }
+    }
+
+    targetRate_ = sampleRate;
+    step_ = static_cast<double>(sourceRate_) / targetRate_;
+    position_ = 0.0;
+    mono_.clear();
+    return true;
+}
+
+size_t WavDecoder::fillSource() {
+    const size_t frameBytes = static_cast<size_t>(channels_) * bytesPerSample_;
+    const size_t wantBytes = static_cast<size_t>(std::min<uint64_t>(remainingBytes_, kSourceBlockFrames * frameBytes));
+    if (wantBytes < frameBytes) {
+        return 0;
+    }
+
+    raw_.resize(wantBytes);
+    file_.read(reinterpret_cast<char*>(raw_.data()), static_cast<std::streamsize>(wantBytes));
+    const size_t frames = static_cast<size_t>(file_.gcount()) / frameBytes;
+    // data块大小可能大于文件的实际长度（录制中断），读到文件末尾即结束
+    remainingBytes_ = frames * frameBytes < wantBytes ? 0 : remainingBytes_ - wantBytes;
+
+    const float scale = 1.0f / static_cast<float>(channels_);
+    const uint8_t* src = raw_.data();
+    for (size_t i = 0; i < frames; ++i) {
+        float sum = 0.0f;
+        for (uint32_t ch = 0; ch < channels_; ++ch) {
+            sum += kernels_.decode(src);
+            src += bytesPerSample_;
+        }
+        mono_.push_back(channels_ == 1 ? sum : sum * scale);
+    }
+    return frames;
+}
+
+size_t WavDecoder::read(int16_t* buffer, size_t maxFrames) {
+    size_t produced = 0;
+    while (produced < maxFrames) {
+        // 线性插值需要position_两侧的样本；恰好落在源样本上时只需要该样本本身
+        const size_t index = static_cast<size_t>(position_);
+        const double fraction = position_ - static_cast<double>(index);
+        const size_t needed = fraction > 0.0 ? index + 2 : index + 1;
+        if (needed > mono_.size()) {
+            // 丢弃已消费的样本，保留插值还要用到的部分
+            mono_.erase(mono_.begin(), mono_.begin() + static_cast<std::ptrdiff_t>(std::min(index, mono_.size())));
+            position_ -= static_cast<double>(index);
+            if (fillSource() == 0) {
+                break;
+            }
+            continue;
+        }
+
+        float sample = mono_[index];
+        if (fraction > 0.0) {
+            sample += static_cast<float>(fraction) * (mono_[index + 1] - sample);
+        }
+        buffer[produced++] = toS16(sample);
+        position_ += step_;
+    }
+    return produced;
+}
+
+} // namespace afp
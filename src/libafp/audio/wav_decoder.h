@@ -0,0 +1,41 @@
+#pragma once
+#include "audio/audio_decoder_interface.h"
+#include "audio/pcm_convert_kernels.h"
+#include <fstream>
+#include <vector>
+
+namespace afp {
+
+// 内置的WAV解码器：支持PCM整数（8/16/24/32位）和IEEE浮点（32/64位）格式，包括WAVE_FORMAT_EXTENSIBLE
+// 各通道取平均混缩为单声道，采样率不同时线性插值重采样；指纹只使用maxFreq以下的频段，线性插值引入的误差集中在高频
+class WavDecoder : public AudioDecoderInterface {
+public:
+    // 解析文件头并定位到数据块，失败时返回false
+    bool open(const std::string& filename, uint32_t sampleRate);
+
+    size_t read(int16_t* buffer, size_t maxFrames) override;
+
+    bool failed() const override { return failed_; }
+
+private:
+    // 从文件中读取下一批源帧并混缩到mono_，返回读到的帧数
+    size_t fillSource();
+
+    std::ifstream file_;
+    PCMConvertKernels kernels_{};
+    uint32_t channels_ = 0;
+    uint32_t bytesPerSample_ = 0;
+    uint32_t sourceRate_ = 0;
+    uint32_t targetRate_ = 0;
+    uint64_t remainingBytes_ = 0;    // 数据块中尚未读取的字节数
+    bool failed_ = false;
+
+    std::vector<uint8_t> raw_;       // 一批源数据
+    std::vector<float> mono_;        // 混缩后尚未消费完的源样本
+
+    // 重采样：下一个输出样本在mono_中的位置，整数部分之前的样本已消费；step_为源采样率与输出采样率之比
+    double position_ = 0.0;
+    double step_ = 1.0;
+};
+
+} // namespace afp
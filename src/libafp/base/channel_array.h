@@ -1,10 +1,12 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
 
 namespace afp {
 
-constexpr size_t max_channel_count = 2;
+// 支持的最大通道数，覆盖立体声到7.1环绕声；每个通道的状态相互独立，可按通道并行处理
+constexpr size_t max_channel_count = 8;
 
 template<typename T>
 using ChannelArray = std::array<T, max_channel_count>;
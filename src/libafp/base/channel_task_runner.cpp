@@ -0,0 +1,104 @@
+#include "channel_task_runner.h"
+
+namespace afp {
+
+ChannelTaskRunner::ChannelTaskRunner(size_t worker_count) {
+    workers_.reserve(worker_count);
+    for (size_t i = 0; i < worker_count; ++i) {
+        workers_.emplace_back(&ChannelTaskRunner::workerLoop, this);
+    }
+}
+
+ChannelTaskRunner::~ChannelTaskRunner() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    start_cv_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ChannelTaskRunner::run(size_t task_count, const std::function<void(size_t)>& task) {
+    if (workers_.empty() || task_count < 2) {
+        for (size_t i = 0; i < task_count; ++i) {
+            task(i);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task_ = &task;
+        task_count_ = task_count;
+        next_task_ = 0;
+        busy_workers_ = workers_.size();
+        error_ = nullptr;
+        ++generation_;
+    }
+    start_cv_.notify_all();
+
+    // 调用线程也参与执行，而不是空等
+    drainTasks();
+
+    std::exception_ptr error;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_cv_.wait(lock, [this] { return busy_workers_ == 0; });
+        task_ = nullptr;
+        error = error_;
+        error_ = nullptr;
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void ChannelTaskRunner::workerLoop() {
+    uint64_t seen_generation = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            start_cv_.wait(lock, [&] { return stopping_ || generation_ != seen_generation; });
+            if (stopping_) {
+                return;
+            }
+            seen_generation = generation_;
+        }
+
+        drainTasks();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --busy_workers_;
+        }
+        done_cv_.notify_one();
+    }
+}
+
+void ChannelTaskRunner::drainTasks() {
+    for (;;) {
+        size_t task_i;
+        const std::function<void(size_t)>* task;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (next_task_ >= task_count_) {
+                return;
+            }
+            task_i = next_task_++;
+            task = task_;
+        }
+
+        try {
+            (*task)(task_i);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!error_) {
+                error_ = std::current_exception();
+            }
+        }
+    }
+}
+
+} // namespace afp
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace afp {
+
+// fork-join执行器：run把task(0) ~ task(task_count-1)分给常驻的工作线程和调用线程，全部完成后才返回。
+// 用于按通道生成指纹、匹配器分片和散射-聚合的分片请求：各任务只能访问自己的通道/分片的状态，
+// 调用方在run返回后按序号顺序合并结果，因此输出与依次执行相同
+class ChannelTaskRunner {
+public:
+    // worker_count为0时所有任务都在调用线程上依次执行
+    explicit ChannelTaskRunner(size_t worker_count);
+    ~ChannelTaskRunner();
+
+    ChannelTaskRunner(const ChannelTaskRunner&) = delete;
+    ChannelTaskRunner& operator=(const ChannelTaskRunner&) = delete;
+
+    // 执行全部任务并等待完成；任务抛出的第一个异常在所有任务结束后于调用线程上重新抛出
+    void run(size_t task_count, const std::function<void(size_t)>& task);
+
+    size_t workerCount() const { return workers_.size(); }
+
+private:
+    void workerLoop();
+
+    // 领取并执行任务，直到本轮任务全部被领取
+    void drainTasks();
+
+    std::vector<std::thread> workers_;
+
+    std::mutex mutex_;
+    std::condition_variable start_cv_;
+    std::condition_variable done_cv_;
+
+    // 以下状态由mutex_保护
+    const std::function<void(size_t)>* task_ = nullptr;
+    size_t task_count_ = 0;
+    size_t next_task_ = 0;
+    size_t busy_workers_ = 0;
+    uint64_t generation_ = 0;       // 每轮run加1，工作线程据此判断是否有新任务
+    bool stopping_ = false;
+    std::exception_ptr error_;
+};
+
+} // namespace afp
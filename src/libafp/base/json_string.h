@@ -0,0 +1,10 @@
+#pragma once
+
+#include <string>
+
+namespace afp {
+
+// 把value转义为带引号的JSON字符串：转义引号、反斜杠和控制字符，其余字节（含UTF-8）原样输出
+std::string jsonString(const std::string& value);
+
+} // namespace afp
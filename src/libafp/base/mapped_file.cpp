@@ -0,0 +1,142 @@
+#include "mapped_file.h"
+#include <algorithm>
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace afp {
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& filename) {
+    close();
+
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        std::cerr << "无法打开文件进行映射: " << filename << std::endl;
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        std::cerr << "无法获取文件大小或文件为空: " << filename << std::endl;
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        std::cerr << "创建文件映射失败: " << filename << std::endl;
+        CloseHandle(file);
+        return false;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) {
+        std::cerr << "映射文件视图失败: " << filename << std::endl;
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    fileHandle_ = file;
+    mappingHandle_ = mapping;
+    data_ = static_cast<const uint8_t*>(view);
+    size_ = static_cast<size_t>(fileSize.QuadPart);
+    return true;
+}
+
+void MappedFile::adviseSequential() {
+}
+
+void MappedFile::releaseRange(size_t, size_t) {
+}
+
+void MappedFile::close() {
+    if (data_) {
+        UnmapViewOfFile(data_);
+    }
+    if (mappingHandle_) {
+        CloseHandle(static_cast<HANDLE>(mappingHandle_));
+    }
+    if (fileHandle_) {
+        CloseHandle(static_cast<HANDLE>(fileHandle_));
+    }
+    data_ = nullptr;
+    size_ = 0;
+    fileHandle_ = nullptr;
+    mappingHandle_ = nullptr;
+}
+
+#else
+
+bool MappedFile::open(const std::string& filename) {
+    close();
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "无法打开文件进行映射: " << filename << std::endl;
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        std::cerr << "无法获取文件大小或文件为空: " << filename << std::endl;
+        ::close(fd);
+        return false;
+    }
+
+    void* addr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    // 映射建立后文件描述符即可关闭
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        std::cerr << "映射文件失败: " << filename << std::endl;
+        return false;
+    }
+
+    data_ = static_cast<const uint8_t*>(addr);
+    size_ = static_cast<size_t>(st.st_size);
+    return true;
+}
+
+void MappedFile::adviseSequential() {
+    if (data_) {
+        madvise(const_cast<uint8_t*>(data_), size_, MADV_SEQUENTIAL);
+    }
+}
+
+void MappedFile::releaseRange(size_t offset, size_t size) {
+    if (!data_ || offset >= size_) {
+        return;
+    }
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t begin = offset / pageSize * pageSize;
+    const size_t end = std::min(offset + size, size_) / pageSize * pageSize;
+    if (begin < end) {
+        madvise(const_cast<uint8_t*>(data_) + begin, end - begin, MADV_DONTNEED);
+    }
+}
+
+void MappedFile::close() {
+    if (data_) {
+        munmap(const_cast<uint8_t*>(data_), size_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+}
+
+#endif
+
+} // namespace afp
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace afp {
+
+// 只读内存映射文件，用于直接在文件内容上使用预构建的数据（如catalog倒排索引）
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    // 禁用拷贝构造和赋值
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // 以只读方式映射整个文件
+    bool open(const std::string& filename);
+
+    // 解除映射
+    void close();
+
+    // 获取映射内存的起始地址和大小
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+
+    // 检查是否已映射
+    bool isOpen() const { return data_ != nullptr; }
+
+    // 提示内核将按顺序访问映射内容，加大预读；不支持的平台上忽略
+    void adviseSequential();
+
+    // 释放[offset, offset + size)范围的驻留内存，之后再访问时重新从文件读取；不支持的平台上忽略
+    // 两端都按页向下对齐，适用于顺序读取时释放已读过的部分：起点所在页之前的部分属于更早读过的数据，
+    // 终点所在的不完整页留到下次释放
+    void releaseRange(size_t offset, size_t size);
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+
+#ifdef _WIN32
+    void* fileHandle_ = nullptr;
+    void* mappingHandle_ = nullptr;
+#endif
+};
+
+} // namespace afp
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace afp {
+
+// 分配计数器：记录经由CountingAllocator分配、尚未释放的字节数及其峰值
+// 计数以relaxed原子操作更新，可在任意线程上读取
+class MemoryCounter {
+public:
+    void allocated(size_t bytes) {
+        const uint64_t current = bytes_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        uint64_t peak = peakBytes_.load(std::memory_order_relaxed);
+        while (current > peak && !peakBytes_.compare_exchange_weak(peak, current, std::memory_order_relaxed)) {
+        }
+    }
+
+    void deallocated(size_t bytes) {
+        bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    uint64_t bytes() const { return bytes_.load(std::memory_order_relaxed); }
+    uint64_t peakBytes() const { return peakBytes_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> bytes_{0};
+    std::atomic<uint64_t> peakBytes_{0};
+};
+
+// 计数分配器：按std::allocator分配，同时把分配和释放的字节数记入counter，counter为空时不计数
+// 用于大小随输入无限增长、按容量又难以估算的内部容器（嵌套容器、基于节点的容器）
+template<typename T>
+class CountingAllocator {
+public:
+    using value_type = T;
+
+    CountingAllocator() noexcept = default;
+    explicit CountingAllocator(MemoryCounter* counter) noexcept : counter_(counter) {}
+
+    template<typename U>
+    CountingAllocator(const CountingAllocator<U>& other) noexcept : counter_(other.counter()) {}
+
+    T* allocate(size_t n) {
+        T* p = std::allocator<T>().allocate(n);
+        if (counter_) {
+            counter_->allocated(n * sizeof(T));
+        }
+        return p;
+    }
+
+    void deallocate(T* p, size_t n) noexcept {
+        if (counter_) {
+            counter_->deallocated(n * sizeof(T));
+        }
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    MemoryCounter* counter() const noexcept { return counter_; }
+
+    // 容器拷贝、移动和交换时分配器随内容一起转移，保证释放记入分配时的计数器
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+private:
+    MemoryCounter* counter_ = nullptr;
+};
+
+template<typename T, typename U>
+bool operator==(const CountingAllocator<T>& a, const CountingAllocator<U>& b) noexcept {
+    return a.counter() == b.counter();
+}
+
+template<typename T, typename U>
+bool operator!=(const CountingAllocator<T>& a, const CountingAllocator<U>& b) noexcept {
+    return !(a == b);
+}
+
+// 以下按容量估算容器在堆上占用的字节数，不含容器对象本身，也不含元素自身持有的堆内存
+
+template<typename T, typename A>
+size_t heapBytes(const std::vector<T, A>& values) {
+    return values.capacity() * sizeof(T);
+}
+
+// 短字符串存放在对象内部时返回0
+inline size_t heapBytes(const std::string& value) {
+    const char* data = value.data();
+    const char* object = reinterpret_cast<const char*>(&value);
+    if (data >= object && data < object + sizeof(value)) {
+        return 0;
+    }
+    return value.capacity() + 1;
+}
+
+// 节点按元素加next指针和缓存的哈希值估算（libstdc++/libc++的实现）
+template<typename K, typename V, typename H, typename E, typename A>
+size_t heapBytes(const std::unordered_map<K, V, H, E, A>& values) {
+    using Node = std::pair<const K, V>;
+    return values.bucket_count() * sizeof(void*) + values.size() * (sizeof(Node) + sizeof(void*) + sizeof(size_t));
+}
+
+template<typename K, typename H, typename E, typename A>
+size_t heapBytes(const std::unordered_set<K, H, E, A>& values) {
+    return values.bucket_count() * sizeof(void*) + values.size() * (sizeof(K) + sizeof(void*) + sizeof(size_t));
+}
+
+// 红黑树节点按元素加三个指针和颜色估算
+template<typename K, typename V, typename C, typename A>
+size_t heapBytes(const std::map<K, V, C, A>& values) {
+    using Node = std::pair<const K, V>;
+    return values.size() * (sizeof(Node) + 4 * sizeof(void*));
+}
+
+} // namespace afp
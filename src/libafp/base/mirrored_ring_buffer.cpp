@@ -0,0 +1,64 @@
+#include "base/mirrored_ring_buffer.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "base/state_stream.h"
+
+namespace afp {
+
+MirroredRingBuffer::MirroredRingBuffer(size_t capacity)
+    : capacity_(capacity)
+    , buffer_(capacity * 2, 0.0f) {
+    if (capacity == 0) {
+        throw std::invalid_argument("MirroredRingBuffer capacity must be greater than 0");
+    }
+}
+
+size_t MirroredRingBuffer::write(const float* data, size_t count) {
+    if (!data || count == 0) {
+        return 0;
+    }
+
+    const size_t to_write = std::min(count, availableSpace());
+
+    // 最多分两段（写到存储区前半部分末尾时回绕），每段同时写入前半部分和镜像
+    size_t written = 0;
+    while (written < to_write) {
+        const size_t chunk = std::min(to_write - written, capacity_ - write_pos_);
+        float* dst = buffer_.data() + write_pos_;
+        std::memcpy(dst, data + written, chunk * sizeof(float));
+        std::memcpy(dst + capacity_, data + written, chunk * sizeof(float));
+        write_pos_ = (write_pos_ + chunk) % capacity_;
+        written += chunk;
+    }
+    fill_count_ += to_write;
+
+    return to_write;
+}
+
+void MirroredRingBuffer::moveWindow(size_t count) {
+    if (count >= fill_count_) {
+        reset();
+    } else {
+        fill_count_ -= count;
+    }
+}
+
+void MirroredRingBuffer::reset() {
+    write_pos_ = 0;
+    fill_count_ = 0;
+}
+
+void MirroredRingBuffer::saveState(StateWriter& writer) const {
+    writer.writeVarint(fill_count_);
+    writer.writeFloats(data(), fill_count_);
+}
+
+void MirroredRingBuffer::restoreState(StateReader& reader) {
+    std::vector<float> samples(reader.readCount(capacity_));
+    reader.readFloats(samples.data(), samples.size());
+    reset();
+    write(samples.data(), samples.size());
+}
+
+} // namespace afp
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace afp {
+
+class StateWriter;
+class StateReader;
+
+// 样本的镜像环形缓冲
+// 存储区长度为容量的2倍，每个样本同时写入位置p和p+capacity，
+// 因此缓冲区中的全部数据（从最早的样本开始）在内存中总是连续的，可以直接按指针读取，不需要处理回绕；
+// 代价是每个样本多一次写入。不使用虚拟内存双重映射，以保持各平台行为一致
+class MirroredRingBuffer {
+public:
+    explicit MirroredRingBuffer(size_t capacity);
+
+    // 禁用拷贝构造和赋值
+    MirroredRingBuffer(const MirroredRingBuffer&) = delete;
+    MirroredRingBuffer& operator=(const MirroredRingBuffer&) = delete;
+
+    // 写入数据到缓冲区
+    // 返回实际写入的元素数量
+    size_t write(const float* data, size_t count);
+
+    // 从最早的样本开始的size()个连续样本，写入或移动窗口之后失效
+    const float* data() const { return buffer_.data() + getReadPos(); }
+
+    // 移动窗口，移除最早的count个样本
+    void moveWindow(size_t count);
+
+    // 重置缓冲区
+    void reset();
+
+    // 保存/恢复缓冲区中的样本（从最早的样本开始），恢复时样本数超过容量视为数据不合法
+    void saveState(StateWriter& writer) const;
+    void restoreState(StateReader& reader);
+
+    size_t size() const { return fill_count_; }
+    size_t capacity() const { return capacity_; }
+    size_t availableSpace() const { return capacity_ - fill_count_; }
+
+    // 存储区占用的内存（字节）
+    size_t memoryUsage() const { return buffer_.capacity() * sizeof(float); }
+    bool empty() const { return fill_count_ == 0; }
+    bool full() const { return fill_count_ == capacity_; }
+
+private:
+    size_t getReadPos() const { return (write_pos_ + capacity_ - fill_count_) % capacity_; }
+
+    const size_t capacity_;
+    std::vector<float> buffer_;     // 2 * capacity_，后半部分是前半部分的镜像
+    size_t write_pos_ = 0;          // [0, capacity_)
+    size_t fill_count_ = 0;
+};
+
+using MirroredRingBufferPtr = std::unique_ptr<MirroredRingBuffer>;
+
+} // namespace afp
@@ -0,0 +1,42 @@
+#include "base/peak_columns.h"
+#include <algorithm>
+#include <cmath>
+
+namespace afp {
+
+void PeakColumns::assign(const std::vector<Peak>& peaks) {
+    const size_t count = peaks.size();
+
+    source_index.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        source_index[i] = static_cast<uint32_t>(i);
+    }
+    std::sort(source_index.begin(), source_index.end(), [&](uint32_t a, uint32_t b) {
+        if (peaks[a].frequency != peaks[b].frequency) return peaks[a].frequency < peaks[b].frequency;
+        return a < b;
+    });
+
+    frequency.resize(count);
+    magnitude.resize(count);
+    timestamp.resize(count);
+    sharpness.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        const Peak& peak = peaks[source_index[i]];
+        frequency[i] = peak.frequency;
+        magnitude[i] = peak.magnitude;
+        timestamp[i] = peak.timestamp;
+        sharpness[i] = std::log10(peak.magnitude + 1);
+    }
+}
+
+size_t PeakColumns::lowerBound(int64_t value) const {
+    return std::lower_bound(frequency.begin(), frequency.end(), value,
+        [](uint32_t f, int64_t v) { return static_cast<int64_t>(f) < v; }) - frequency.begin();
+}
+
+size_t PeakColumns::upperBound(int64_t value) const {
+    return std::upper_bound(frequency.begin(), frequency.end(), value,
+        [](int64_t v, uint32_t f) { return v < static_cast<int64_t>(f); }) - frequency.begin();
+}
+
+} // namespace afp
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "base/peek.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace afp {
+
+// 一帧峰值的列式存储，峰值按频率升序排列（频率相同时保持原顺序）
+// 组合枚举时按列连续读取需要的字段，不必逐个读取整个Peak；
+// 评分中只与单个峰值有关的尖锐度项log10(幅度+1)在写入时算好，不再逐组合重复计算
+struct PeakColumns {
+    std::vector<uint32_t> frequency;
+    std::vector<float> magnitude;
+    std::vector<double> timestamp;
+    std::vector<float> sharpness;         // log10(magnitude + 1)
+    std::vector<uint32_t> source_index;   // 峰值在原数组中的下标
+
+    size_t size() const { return frequency.size(); }
+
+    // 各列占用的内存（字节）
+    size_t memoryUsage() const {
+        return (frequency.capacity() + source_index.capacity()) * sizeof(uint32_t) +
+               (magnitude.capacity() + sharpness.capacity()) * sizeof(float) + timestamp.capacity() * sizeof(double);
+    }
+
+    // 从峰值数组重建，各列的容量在多次调用之间复用
+    void assign(const std::vector<Peak>& peaks);
+
+    // 第一个频率不小于frequency的位置
+    size_t lowerBound(int64_t frequency) const;
+
+    // 第一个频率大于frequency的位置
+    size_t upperBound(int64_t frequency) const;
+};
+
+} // namespace afp
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+
 namespace afp {
     // 定义峰值结构，用于跨帧存储
 struct Peak {
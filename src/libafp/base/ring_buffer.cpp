@@ -1,6 +1,7 @@
 #include "ring_buffer.h"
 #include <stdexcept>
 #include <algorithm>
+#include <utility>
 #include "base/frame.h"
 #include "base/fft_result.h"
 #include <vector>
@@ -69,6 +70,20 @@ bool RingBuffer<T>::push_back(const T& element) {
     return true;
 }
 
+template<typename T>
+bool RingBuffer<T>::push_back(T&& element) {
+    if (full()) {
+        return false; // 缓冲区已满
+    }
+    
+    using std::swap;
+    swap(buffer_[write_pos_], element);
+    write_pos_ = (write_pos_ + 1) % capacity();
+    fill_count_++;
+    
+    return true;
+}
+
 template<typename T>
 size_t RingBuffer<T>::read(T* dest, size_t count) const {
     return readWithOffset(dest, count, 0);
@@ -2,6 +2,7 @@
 
 #include <vector>
 #include <cstddef>
+#include <memory>
 
 namespace afp {
 
@@ -28,6 +29,11 @@ public:
     
     // 添加单个元素到缓冲区末尾
     bool push_back(const T& element);
+
+    // 以交换的方式添加单个元素到缓冲区末尾，不拷贝element
+    // 返回后element持有写入位置上原来的元素（已移出窗口的旧元素或默认构造的元素），
+    // 调用方可以复用其中已分配的存储（如Frame的峰值数组），窗口滑动时不必反复释放和重新分配
+    bool push_back(T&& element);
     
     // 从缓冲区读取数据到目标数组
     // 返回实际读取的元素数量
@@ -51,6 +57,17 @@ public:
     
     // 获取可用空间
     size_t availableSpace() const { return capacity() - size(); }
+
+    // 存储区占用的内存（字节），element_bytes返回每个元素自身持有的堆内存，
+    // 包括已移出窗口、保留存储待复用的元素
+    template<typename ElementBytes>
+    size_t memoryUsage(ElementBytes&& element_bytes) const {
+        size_t bytes = buffer_.capacity() * sizeof(T);
+        for (const auto& element : buffer_) {
+            bytes += element_bytes(element);
+        }
+        return bytes;
+    }
     
     // 检查缓冲区是否为空
     bool empty() const { return fill_count_ == 0; }
@@ -79,6 +96,7 @@ public:
 
     // 兼容性别名
     bool push(const T& element) { return push_back(element); }
+    bool push(T&& element) { return push_back(std::move(element)); }
     bool pop() { return pop_front(); }
 
 private:
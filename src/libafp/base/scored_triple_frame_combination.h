@@ -1,6 +1,7 @@
 #pragma once
 
 #include "base/peek.h"
+#include <cstdint>
 
 namespace afp {
 
@@ -11,6 +12,7 @@ struct ScoredTripleFrameCombination {
     const Peak* targetPeak2;
     double score;
     uint32_t hash;
+    uint64_t order;     // 组合在原始枚举顺序（锚点、目标峰值1、目标峰值2的下标）中的位置，评分相同时靠前的优先
     
     // 用于排序的比较函数
     bool operator>(const ScoredTripleFrameCombination& other) const {
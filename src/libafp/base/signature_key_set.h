@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace afp {
+
+// 指纹点(hash, 时间戳)去重用的扁平开放寻址集合
+// 槽位是连续数组（容量为2的幂，线性探测，装载因子不超过1/2），插入不分配节点；
+// 每个槽位记录写入时的代数，clear只把代数加1，不用逐个清空槽位，因此可以每轮清空后继续复用同一块内存。
+// 时间戳按double的位模式比较，与按值比较std::pair<uint32_t, double>的结果相同（时间戳不会是NaN或-0.0）
+class SignatureKeySet {
+public:
+    SignatureKeySet() {
+        rehash(kMinCapacity);
+    }
+
+    // 预留至少能容纳count个元素的空间，之后插入count个元素以内不会扩容
+    void reserve(size_t count) {
+        size_t capacity = kMinCapacity;
+        while (capacity < count * 2) {
+            capacity *= 2;
+        }
+        if (capacity > slots_.size()) {
+            rehash(capacity);
+        }
+    }
+
+    // 插入(hash, timestamp)，集合中原本没有时返回true
+    bool insert(uint32_t hash, double timestamp) {
+        if ((size_ + 1) * 2 > slots_.size()) {
+            rehash(slots_.size() * 2);
+        }
+
+        const uint64_t timestamp_bits = bitsOf(timestamp);
+        for (size_t i = slotOf(hash, timestamp_bits);; i = (i + 1) & mask_) {
+            Slot& slot = slots_[i];
+            if (slot.generation != generation_) {
+                slot.generation = generation_;
+                slot.hash = hash;
+                slot.timestamp_bits = timestamp_bits;
+                ++size_;
+                return true;
+            }
+            if (slot.hash == hash && slot.timestamp_bits == timestamp_bits) {
+                return false;
+            }
+        }
+    }
+
+    void clear() {
+        size_ = 0;
+        if (++generation_ == 0) {
+            // 代数回绕时旧槽位的代数可能与新的相同，整体清零一次
+            for (auto& slot : slots_) {
+                slot.generation = 0;
+            }
+            generation_ = 1;
+        }
+    }
+
+    size_t size() const { return size_; }
+
+    // 槽位数组占用的内存（字节）
+    size_t memoryUsage() const { return slots_.capacity() * sizeof(Slot); }
+
+private:
+    struct Slot {
+        uint64_t timestamp_bits;
+        uint32_t hash;
+        uint32_t generation;    // 与generation_相同时槽位有效
+    };
+
+    static constexpr size_t kMinCapacity = 64;
+
+    static uint64_t bitsOf(double timestamp) {
+        uint64_t bits;
+        std::memcpy(&bits, &timestamp, sizeof(bits));
+        return bits;
+    }
+
+    // 把两部分混合后再取低位，相邻时间戳和相近的hash也能均匀分布到各个槽位
+    size_t slotOf(uint32_t hash, uint64_t timestamp_bits) const {
+        uint64_t x = timestamp_bits ^ (static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ull);
+        x ^= x >> 30;
+        x *= 0xBF58476D1CE4E5B9ull;
+        x ^= x >> 27;
+        x *= 0x94D049BB133111EBull;
+        x ^= x >> 31;
+        return static_cast<size_t>(x) & mask_;
+    }
+
+    void rehash(size_t capacity) {
+        std::vector<Slot> old_slots(capacity);
+        old_slots.swap(slots_);
+        mask_ = slots_.size() - 1;
+
+        // 新槽位的代数都是0
+        const uint32_t old_generation = generation_;
+        generation_ = 1;
+        size_ = 0;
+
+        for (const auto& slot : old_slots) {
+            if (slot.generation != old_generation) {
+                continue;
+            }
+            for (size_t i = slotOf(slot.hash, slot.timestamp_bits);; i = (i + 1) & mask_) {
+                if (slots_[i].generation != generation_) {
+                    slots_[i] = slot;
+                    slots_[i].generation = generation_;
+                    ++size_;
+                    break;
+                }
+            }
+        }
+    }
+
+    std::vector<Slot> slots_;
+    size_t mask_ = 0;
+    size_t size_ = 0;
+    uint32_t generation_ = 1;
+};
+
+} // namespace afp
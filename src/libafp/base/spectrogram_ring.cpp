@@ -0,0 +1,127 @@
+#include "base/spectrogram_ring.h"
+#include <cstdint>
+#include <cstring>
+#include "base/state_stream.h"
+
+namespace afp {
+
+namespace {
+
+constexpr size_t kCacheLineSize = 64;
+constexpr size_t kFloatsPerCacheLine = kCacheLineSize / sizeof(float);
+
+} // namespace
+
+SpectrogramRing::SpectrogramRing(size_t capacity, size_t bin_count)
+    : bin_count_(bin_count)
+    , row_stride_((bin_count + kFloatsPerCacheLine - 1) / kFloatsPerCacheLine * kFloatsPerCacheLine) {
+    allocate(capacity);
+}
+
+void SpectrogramRing::allocate(size_t capacity) {
+    capacity_ = capacity;
+    storage_.reset(new float[capacity_ * row_stride_ + kFloatsPerCacheLine]);
+    auto address = reinterpret_cast<uintptr_t>(storage_.get());
+    auto aligned = (address + kCacheLineSize - 1) & ~static_cast<uintptr_t>(kCacheLineSize - 1);
+    rows_ = reinterpret_cast<float*>(aligned);
+    timestamps_.assign(capacity_, 0.0);
+    silent_.assign(capacity_, 0);
+    reset();
+}
+
+size_t SpectrogramRing::memoryUsage() const {
+    const size_t storage_bytes = storage_ ? (capacity_ * row_stride_ + kFloatsPerCacheLine) * sizeof(float) : 0;
+    return storage_bytes + timestamps_.capacity() * sizeof(double) + silent_.capacity();
+}
+
+void SpectrogramRing::reserve(size_t capacity) {
+    if (capacity > capacity_) {
+        allocate(capacity);
+    }
+}
+
+float* SpectrogramRing::pushBack(double timestamp) {
+    if (full()) {
+        return nullptr;
+    }
+    const size_t pos = slot(fill_count_);
+    timestamps_[pos] = timestamp;
+    silent_[pos] = 0;
+    ++fill_count_;
+    return rows_ + pos * row_stride_;
+}
+
+bool SpectrogramRing::pushBack(double timestamp, const float* magnitudes) {
+    float* row = pushBack(timestamp);
+    if (!row) {
+        return false;
+    }
+    std::memcpy(row, magnitudes, bin_count_ * sizeof(float));
+    return true;
+}
+
+bool SpectrogramRing::pushBack(const SpectrogramView& source, size_t index) {
+    if (source.silent(index)) {
+        return pushSilent(source.timestamp(index));
+    }
+    return pushBack(source.timestamp(index), source.magnitudes(index));
+}
+
+bool SpectrogramRing::pushSilent(double timestamp) {
+    float* row = pushBack(timestamp);
+    if (!row) {
+        return false;
+    }
+    std::memset(row, 0, bin_count_ * sizeof(float));
+    silent_[slot(fill_count_ - 1)] = 1;
+    return true;
+}
+
+void SpectrogramRing::moveWindow(size_t count) {
+    if (count >= fill_count_) {
+        reset();
+        return;
+    }
+    read_pos_ = slot(count);
+    fill_count_ -= count;
+}
+
+void SpectrogramRing::reset() {
+    read_pos_ = 0;
+    fill_count_ = 0;
+}
+
+void SpectrogramRing::saveState(StateWriter& writer) const {
+    writer.writeVarint(bin_count_);
+    writer.writeVarint(fill_count_);
+    for (size_t i = 0; i < fill_count_; ++i) {
+        writer.writeDouble(timestamp(i));
+        writer.writeBool(silent(i));
+        if (!silent(i)) {
+            writer.writeFloats(magnitudes(i), bin_count_);
+        }
+    }
+}
+
+void SpectrogramRing::restoreState(StateReader& reader) {
+    if (reader.readVarint() != bin_count_) {
+        reader.fail();
+    }
+    // 每帧至少有时间戳和静音标记共9个字节，分配之前按剩余数据量校验帧数
+    const size_t count = reader.readCount(reader.remaining() / 9);
+    if (!reader.ok()) {
+        return;
+    }
+    reserve(count);
+    reset();
+    for (size_t i = 0; i < count && reader.ok(); ++i) {
+        const double frame_timestamp = reader.readDouble();
+        if (reader.readBool()) {
+            pushSilent(frame_timestamp);
+        } else {
+            reader.readFloats(pushBack(frame_timestamp), bin_count_);
+        }
+    }
+}
+
+} // namespace afp
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace afp {
+
+class SpectrogramRing;
+class StateWriter;
+class StateReader;
+
+// 频谱的只读视图，不持有数据；下标相对于最早的帧
+class SpectrogramView {
+public:
+    SpectrogramView() = default;
+    explicit SpectrogramView(const SpectrogramRing* ring) : ring_(ring) {}
+
+    inline size_t size() const;
+    inline size_t binCount() const;
+    inline double timestamp(size_t index) const;
+    inline const float* magnitudes(size_t index) const;
+    inline bool silent(size_t index) const;
+
+private:
+    const SpectrogramRing* ring_ = nullptr;
+};
+
+// 预分配的二维频谱环形缓冲（时间 × bin）
+// 所有帧的幅度存放在一块连续内存中，每帧的起始地址按缓存行对齐；写入和滑动窗口都不分配内存
+class SpectrogramRing {
+public:
+    SpectrogramRing(size_t capacity, size_t bin_count);
+
+    // 禁用拷贝构造和赋值
+    SpectrogramRing(const SpectrogramRing&) = delete;
+    SpectrogramRing& operator=(const SpectrogramRing&) = delete;
+
+    // 容量不足时重新分配并清空，容量足够时什么也不做
+    void reserve(size_t capacity);
+
+    // 在末尾追加一帧，返回该帧幅度的写入位置，由调用方填充binCount()个值；已满时返回nullptr
+    float* pushBack(double timestamp);
+
+    // 在末尾追加一帧并复制幅度，已满时返回false
+    bool pushBack(double timestamp, const float* magnitudes);
+
+    // 在末尾追加source中的第index帧，静音标记一并复制，已满时返回false
+    bool pushBack(const SpectrogramView& source, size_t index);
+
+    // 在末尾追加一个静音帧（幅度全为0，未做FFT），已满时返回false
+    bool pushSilent(double timestamp);
+
+    // 移动窗口，移除最早的count帧
+    void moveWindow(size_t count);
+
+    // 清空所有帧
+    void reset();
+
+    // 保存/恢复所有帧（时间戳、静音标记和幅度，静音帧不保存幅度），恢复时容量不足则扩容，bin数必须相同
+    void saveState(StateWriter& writer) const;
+    void restoreState(StateReader& reader);
+
+    size_t size() const { return fill_count_; }
+    size_t capacity() const { return capacity_; }
+    size_t binCount() const { return bin_count_; }
+
+    // 幅度存储区、时间戳和静音标记占用的内存（字节）
+    size_t memoryUsage() const;
+    bool empty() const { return fill_count_ == 0; }
+    bool full() const { return fill_count_ == capacity_; }
+
+    // 获取指定帧的时间戳和幅度（相对于最早的帧）
+    double timestamp(size_t index) const { return timestamps_[slot(index)]; }
+    const float* magnitudes(size_t index) const { return rows_ + slot(index) * row_stride_; }
+    bool silent(size_t index) const { return silent_[slot(index)] != 0; }
+
+    SpectrogramView view() const { return SpectrogramView(this); }
+
+private:
+    void allocate(size_t capacity);
+
+    size_t slot(size_t index) const {
+        size_t pos = read_pos_ + index;
+        return pos >= capacity_ ? pos - capacity_ : pos;
+    }
+
+    size_t capacity_ = 0;
+    size_t bin_count_;
+    size_t row_stride_;                  // 每帧占用的float数，向上取整到缓存行
+    std::unique_ptr<float[]> storage_;   // 多分配一个缓存行用于对齐
+    float* rows_ = nullptr;              // 第一帧的起始地址（已对齐）
+    std::vector<double> timestamps_;
+    std::vector<uint8_t> silent_;        // 被静音门限跳过的帧
+    size_t read_pos_ = 0;
+    size_t fill_count_ = 0;
+};
+
+size_t SpectrogramView::size() const { return ring_ ? ring_->size() : 0; }
+size_t SpectrogramView::binCount() const { return ring_ ? ring_->binCount() : 0; }
+double SpectrogramView::timestamp(size_t index) const { return ring_->timestamp(index); }
+const float* SpectrogramView::magnitudes(size_t index) const { return ring_->magnitudes(index); }
+bool SpectrogramView::silent(size_t index) const { return ring_->silent(index); }
+
+} // namespace afp
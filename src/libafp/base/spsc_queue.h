@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace afp {
+
+// 单生产者单消费者的无锁有界队列
+// 槽位在构造时一次分配（容量向上取2的幂），元素以移动方式写入和取出，入队出队都不分配内存、不加锁。
+// 生产者只写tail_、消费者只写head_，跨线程的可见性由release/acquire保证。
+template<typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity)
+        : slots_(roundUpPowerOfTwo(capacity))
+        , mask_(slots_.size() - 1) {
+    }
+
+    // 禁用拷贝构造和赋值
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // 生产者调用：队列已满时返回false，element保持不变
+    bool tryPush(T&& element) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) >= slots_.size()) {
+            return false;
+        }
+        slots_[tail & mask_] = std::move(element);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 消费者调用：队列为空时返回false
+    bool tryPop(T& element) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        element = std::move(slots_[head & mask_]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 当前元素数量，另一线程同时读写时只是近似值
+    size_t size() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+    bool empty() const { return size() == 0; }
+
+    size_t capacity() const { return slots_.size(); }
+
+    // 槽位数组占用的内存（字节），不含元素自身持有的堆内存
+    size_t memoryUsage() const { return slots_.capacity() * sizeof(T); }
+
+private:
+    static size_t roundUpPowerOfTwo(size_t value) {
+        size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    std::vector<T> slots_;
+    size_t mask_;
+    // 生产者和消费者的下标分开放在不同的缓存行上，避免伪共享
+    alignas(64) std::atomic<size_t> head_{0};  // 下一个读取位置，只由消费者写
+    alignas(64) std::atomic<size_t> tail_{0};  // 下一个写入位置，只由生产者写
+};
+
+} // namespace afp
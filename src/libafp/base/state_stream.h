@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace afp {
+
+// 流状态检查点的二进制写入
+// 无符号整数用varint，有符号整数先zigzag再varint；float/double按小端序的IEEE 754位存储，与主机字节序无关，
+// 浮点数原样保存，恢复后的计算结果与保存前逐位一致
+class StateWriter {
+public:
+    explicit StateWriter(std::vector<uint8_t>& out) : out_(out) {}
+
+    void writeVarint(uint64_t value) {
+        while (value >= 0x80) {
+            out_.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out_.push_back(static_cast<uint8_t>(value));
+    }
+
+    void writeSigned(int64_t value) {
+        writeVarint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    }
+
+    void writeBool(bool value) { out_.push_back(value ? 1 : 0); }
+
+    void writeFloat(float value) {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        writeFixed(bits, sizeof(bits));
+    }
+
+    void writeDouble(double value) {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        writeFixed(bits, sizeof(bits));
+    }
+
+    // 写入count个float，不写入数量
+    void writeFloats(const float* values, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            writeFloat(values[i]);
+        }
+    }
+
+private:
+    void writeFixed(uint64_t bits, size_t bytes) {
+        for (size_t i = 0; i < bytes; ++i) {
+            out_.push_back(static_cast<uint8_t>(bits >> (8 * i)));
+        }
+    }
+
+    std::vector<uint8_t>& out_;
+};
+
+// 流状态检查点的二进制读取，格式见StateWriter
+// 任何一次读取越界或数值超出调用方给出的上限后进入失败状态，之后的读取都返回0，由调用方在最后检查ok()
+class StateReader {
+public:
+    StateReader(const uint8_t* data, size_t size) : cursor_(data), end_(data + size) {}
+
+    bool ok() const { return ok_; }
+    bool atEnd() const { return cursor_ == end_; }
+    size_t remaining() const { return static_cast<size_t>(end_ - cursor_); }
+
+    // 标记数据不合法（例如与当前配置不一致）
+    void fail() { ok_ = false; }
+
+    uint64_t readVarint() {
+        uint64_t value = 0;
+        for (int shift = 0; ok_ && shift < 64; shift += 7) {
+            if (cursor_ >= end_) {
+                break;
+            }
+            const uint8_t byte = *cursor_++;
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                return value;
+            }
+        }
+        ok_ = false;
+        return 0;
+    }
+
+    // 读取一个不超过limit的数量，超过时进入失败状态并返回0，用于在分配内存之前校验长度
+    size_t readCount(size_t limit) {
+        const uint64_t value = readVarint();
+        if (value > limit) {
+            ok_ = false;
+            return 0;
+        }
+        return static_cast<size_t>(value);
+    }
+
+    int64_t readSigned() {
+        const uint64_t value = readVarint();
+        return static_cast<int64_t>((value >> 1) ^ (~(value & 1) + 1));
+    }
+
+    bool readBool() {
+        const uint64_t value = readFixed(1);
+        if (value > 1) {
+            ok_ = false;
+        }
+        return value == 1;
+    }
+
+    float readFloat() {
+        const uint32_t bits = static_cast<uint32_t>(readFixed(sizeof(uint32_t)));
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    double readDouble() {
+        const uint64_t bits = readFixed(sizeof(uint64_t));
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    // 读取count个float，数据不足时进入失败状态，values不变
+    void readFloats(float* values, size_t count) {
+        if (!ok_ || static_cast<size_t>(end_ - cursor_) / sizeof(uint32_t) < count) {
+            ok_ = false;
+            return;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            values[i] = readFloat();
+        }
+    }
+
+private:
+    uint64_t readFixed(size_t bytes) {
+        if (!ok_ || static_cast<size_t>(end_ - cursor_) < bytes) {
+            ok_ = false;
+            return 0;
+        }
+        uint64_t bits = 0;
+        for (size_t i = 0; i < bytes; ++i) {
+            bits |= static_cast<uint64_t>(cursor_[i]) << (8 * i);
+        }
+        cursor_ += bytes;
+        return bits;
+    }
+
+    const uint8_t* cursor_;
+    const uint8_t* end_;
+    bool ok_ = true;
+};
+
+} // namespace afp
@@ -0,0 +1,156 @@
+#include "base/trace_ring.h"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace afp {
+
+namespace {
+
+uint64_t bitsOf(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+double doubleOf(uint64_t bits) {
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+} // namespace
+
+void TraceRing::enable(size_t capacity) {
+    if (!slots_) {
+        size_t slot_count = 1;
+        while (slot_count < capacity) {
+            slot_count *= 2;
+        }
+        slots_.reset(new Slot[slot_count]);
+        mask_ = slot_count - 1;
+    }
+    // 写入线程以acquire读取开关，看到开启时一定能看到分配好的槽位
+    enabled_.store(true, std::memory_order_release);
+}
+
+uint64_t TraceRing::now() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+uint32_t TraceRing::currentThreadId() {
+    static std::atomic<uint32_t> next_thread_id{1};
+    thread_local const uint32_t thread_id = next_thread_id.fetch_add(1, std::memory_order_relaxed);
+    return thread_id;
+}
+
+void TraceRing::write(const TraceEventDesc& desc, char phase, uint64_t timestamp_ns,
+                      uint32_t count, double value_a, double value_b) {
+    const uint64_t index = head_.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = slots_[index & mask_];
+
+    slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    const uint64_t packed = static_cast<uint64_t>(static_cast<uint8_t>(phase))
+                          | (static_cast<uint64_t>(currentThreadId() & 0xFFFFFF) << 8)
+                          | (static_cast<uint64_t>(count) << 32);
+    slot.words[0].store(timestamp_ns, std::memory_order_relaxed);
+    slot.words[1].store(reinterpret_cast<uintptr_t>(&desc), std::memory_order_relaxed);
+    slot.words[2].store(packed, std::memory_order_relaxed);
+    slot.words[3].store(bitsOf(value_a), std::memory_order_relaxed);
+    slot.words[4].store(bitsOf(value_b), std::memory_order_relaxed);
+
+    slot.sequence.store(2 * index + 2, std::memory_order_release);
+}
+
+void TraceRing::appendChromeEvents(std::ostream& out, int pid, const char* process_name, bool& first) const {
+    auto separator = [&]() {
+        out << (first ? "\n" : ",\n");
+        first = false;
+    };
+
+    separator();
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid
+        << ",\"args\":{\"name\":\"" << process_name << "\"}}";
+
+    if (!slots_) {
+        return;
+    }
+
+    const uint64_t head = head_.load(std::memory_order_acquire);
+    const uint64_t capacity = mask_ + 1;
+    const uint64_t begin = head > capacity ? head - capacity : 0;
+    for (uint64_t index = begin; index < head; ++index) {
+        const Slot& slot = slots_[index & mask_];
+        const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence != 2 * index + 2) {
+            continue;
+        }
+
+        uint64_t words[kWordCount];
+        for (size_t i = 0; i < kWordCount; ++i) {
+            words[i] = slot.words[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != sequence) {
+            continue;
+        }
+
+        const auto* desc = reinterpret_cast<const TraceEventDesc*>(static_cast<uintptr_t>(words[1]));
+        const char phase = static_cast<char>(words[2] & 0xFF);
+        const uint32_t thread_id = static_cast<uint32_t>((words[2] >> 8) & 0xFFFFFF);
+        const uint32_t count = static_cast<uint32_t>(words[2] >> 32);
+
+        separator();
+        out << "{\"name\":\"" << desc->name << "\",\"cat\":\"" << desc->category
+            << "\",\"ph\":\"" << phase << "\",\"ts\":" << static_cast<double>(words[0]) / 1000.0
+            << ",\"pid\":" << pid << ",\"tid\":" << thread_id;
+        if (phase == kInstant) {
+            out << ",\"s\":\"t\"";
+        }
+
+        out << ",\"args\":{";
+        bool first_arg = true;
+        auto arg = [&](const char* name, auto value) {
+            if (!name) {
+                return;
+            }
+            out << (first_arg ? "" : ",") << "\"" << name << "\":" << value;
+            first_arg = false;
+        };
+        arg(desc->count_arg, count);
+        arg(desc->value_arg_a, doubleOf(words[3]));
+        arg(desc->value_arg_b, doubleOf(words[4]));
+        out << "}}";
+    }
+}
+
+bool TraceRing::writeChromeTrace(const std::string& filename,
+                                 const std::vector<std::pair<const TraceRing*, const char*>>& rings) {
+    std::ofstream file(filename, std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "无法写入追踪文件: " << filename << std::endl;
+        return false;
+    }
+
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (size_t i = 0; i < rings.size(); ++i) {
+        rings[i].first->appendChromeEvents(file, static_cast<int>(i + 1), rings[i].second, first);
+    }
+    file << "\n]}\n";
+
+    file.flush();
+    if (!file.good()) {
+        std::cerr << "写入追踪文件失败: " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace afp
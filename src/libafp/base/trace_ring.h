@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace afp {
+
+// 追踪事件的静态描述，名称和参数名都是字符串字面量，事件中只保存描述的地址
+// 参数名为空时导出时省略该参数
+struct TraceEventDesc {
+    const char* name;
+    const char* category;
+    const char* count_arg;      // 整数参数
+    const char* value_arg_a;    // 两个浮点参数
+    const char* value_arg_b;
+};
+
+// 定长的二进制追踪事件环：多个线程可同时写入，不加锁，写满后覆盖最旧的事件
+// 关闭时record只有一次原子读取和一次分支；开启后每个事件是一次fetch_add和几次relaxed原子存储
+// 每个槽位带序号，导出时跳过正在被覆盖的槽位，导出可以与写入同时进行
+class TraceRing {
+public:
+    // 与Chrome trace的事件类型相同
+    static constexpr char kBegin = 'B';
+    static constexpr char kEnd = 'E';
+    static constexpr char kInstant = 'i';
+
+    TraceRing() = default;
+
+    TraceRing(const TraceRing&) = delete;
+    TraceRing& operator=(const TraceRing&) = delete;
+
+    // 开启记录，capacity向上取整为2的幂；容量在第一次开启时确定，之后的调用只打开开关
+    void enable(size_t capacity);
+
+    void disable() { enabled_.store(false, std::memory_order_relaxed); }
+
+    bool enabled() const { return enabled_.load(std::memory_order_acquire); }
+
+    // 槽位占用的内存（字节），从未开启时为0
+    size_t memoryUsage() const { return slots_ ? (mask_ + 1) * sizeof(Slot) : 0; }
+
+    // 单调时钟的当前时间（纳秒），与各阶段计时使用同一时钟
+    static uint64_t now();
+
+    void record(const TraceEventDesc& desc, char phase, uint64_t timestamp_ns,
+                uint32_t count = 0, double value_a = 0.0, double value_b = 0.0) {
+        if (!enabled()) {
+            return;
+        }
+        write(desc, phase, timestamp_ns, count, value_a, value_b);
+    }
+
+    // 在当前时间记录一个瞬时事件
+    void instant(const TraceEventDesc& desc, uint32_t count = 0, double value_a = 0.0, double value_b = 0.0) {
+        if (!enabled()) {
+            return;
+        }
+        write(desc, kInstant, now(), count, value_a, value_b);
+    }
+
+    // 以Chrome trace JSON格式（chrome://tracing和Perfetto都可打开）写出一组事件环，每个事件环是一个进程
+    static bool writeChromeTrace(const std::string& filename,
+                                 const std::vector<std::pair<const TraceRing*, const char*>>& rings);
+
+private:
+    // 事件按5个字存储：时间戳、描述地址、类型|线程号|整数参数、两个浮点参数的位模式
+    static constexpr size_t kWordCount = 5;
+
+    struct Slot {
+        std::atomic<uint64_t> sequence{0};     // 写入第n个事件期间为2n+1，写完为2n+2
+        std::atomic<uint64_t> words[kWordCount]{};
+    };
+
+    void write(const TraceEventDesc& desc, char phase, uint64_t timestamp_ns,
+               uint32_t count, double value_a, double value_b);
+
+    void appendChromeEvents(std::ostream& out, int pid, const char* process_name, bool& first) const;
+
+    // 当前线程的编号，从1开始按第一次记录的先后分配
+    static uint32_t currentThreadId();
+
+    std::unique_ptr<Slot[]> slots_;
+    size_t mask_ = 0;
+    std::atomic<uint64_t> head_{0};
+    std::atomic<bool> enabled_{false};
+};
+
+} // namespace afp
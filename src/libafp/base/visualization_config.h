@@ -7,6 +7,18 @@ namespace afp {
 struct VisualizationConfig {
     bool collectVisualizationData_ = false;
     VisualizationData visualizationData_;
+    VisualizationLimits limits_;
+    VisualizationSampler peakSampler_;
+    VisualizationSampler pointSampler_;
+
+    // 按limits_采样追加峰值和指纹点
+    void addPeak(uint32_t frequency, double timestamp, float magnitude) {
+        peakSampler_.append(visualizationData_.allPeaks, std::make_tuple(frequency, timestamp, magnitude), limits_);
+    }
+
+    void addFingerprintPoint(uint32_t frequency, double timestamp, uint32_t hash) {
+        pointSampler_.append(visualizationData_.fingerprintPoints, std::make_tuple(frequency, timestamp, hash), limits_);
+    }
 };
 
 }
\ No newline at end of file
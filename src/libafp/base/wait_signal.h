@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+namespace afp {
+
+// 无锁队列两端之间的等待/通知：等待方在条件不满足时阻塞在条件变量上，
+// 通知方在改变条件（入队、出队、更新计数）之后调用notify，没有等待方时只多一次原子读，不加锁。
+// 等待方先登记再在锁内检查条件，通知方先改变条件再检查登记，两边之间有seq_cst栅栏，不会丢失唤醒
+class WaitSignal {
+public:
+    WaitSignal() = default;
+
+    WaitSignal(const WaitSignal&) = delete;
+    WaitSignal& operator=(const WaitSignal&) = delete;
+
+    // 唤醒所有正在等待的线程，让它们重新检查条件
+    void notify() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters_.load(std::memory_order_relaxed) == 0) {
+            return;
+        }
+        {
+            // 等待方在锁内检查条件后才进入等待，加锁保证通知不会落在检查和等待之间
+            std::lock_guard<std::mutex> lock(mutex_);
+        }
+        cv_.notify_all();
+    }
+
+    // 阻塞直到ready()返回true
+    template <typename Ready>
+    void wait(Ready ready) {
+        if (ready()) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        waiters_.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        cv_.wait(lock, ready);
+        waiters_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // 阻塞直到ready()返回true或到达deadline，返回ready()的最终结果
+    template <typename Ready, typename Clock, typename Duration>
+    bool waitUntil(const std::chrono::time_point<Clock, Duration>& deadline, Ready ready) {
+        if (ready()) {
+            return true;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        waiters_.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const bool result = cv_.wait_until(lock, deadline, ready);
+        waiters_.fetch_sub(1, std::memory_order_relaxed);
+        return result;
+    }
+
+private:
+    std::atomic<size_t> waiters_{0};
+    std::mutex mutex_;
+    std::condition_variable cv_;
+};
+
+} // namespace afp
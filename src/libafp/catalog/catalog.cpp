@@ -2,13 +2,149 @@
 #include <fstream>
 #include <cstring>
 #include <iostream>
+#include "base/mapped_file.h"
+#include "base/memory_accounting.h"
+#include "catalog/packed_signature.h"
 
 namespace afp {
 
+struct Catalog::ByteCursor {
+    const uint8_t* data;
+    size_t size;
+    size_t offset = 0;
+
+    size_t remaining() const { return size - offset; }
+
+    // 读取count字节到out，剩余数据不足时返回false，位置不变
+    bool read(void* out, size_t count) {
+        const uint8_t* bytes = take(count);
+        if (!bytes) {
+            return false;
+        }
+        std::memcpy(out, bytes, count);
+        return true;
+    }
+
+    // 跳过count字节并返回其起始地址，剩余数据不足时返回nullptr，位置不变
+    const uint8_t* take(size_t count) {
+        if (remaining() < count) {
+            return nullptr;
+        }
+        const uint8_t* bytes = data + offset;
+        offset += count;
+        return bytes;
+    }
+};
+
 void Catalog::addSignature(const std::vector<SignaturePoint>& signature, 
                          const MediaItem& mediaItem) {
-    signatures_.push_back(signature);
+    // 保持指纹点原有顺序，点的下标与调用方传入的一致
+    signatures_.push_back(PackedSignature::pack(signature, true, false));
     mediaItems_.push_back(mediaItem);
+
+    // 内容已变化，之前加载的倒排索引失效
+    index_.reset();
+    invalidateCaches();
+}
+
+void Catalog::invalidateCaches() {
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    sideTables_.clear();
+    expanded_.clear();
+    expanded_.shrink_to_fit();
+    expandedValid_ = false;
+}
+
+std::vector<SignaturePoint> Catalog::unpackSignature(size_t index) const {
+    const auto& packed = signatures_[index];
+    std::vector<uint32_t> frequencies;
+    std::vector<uint32_t> amplitudes;
+    const bool hasSideTables = packed.hasSideTables() && packed.decodeSideTables(frequencies, amplitudes);
+
+    std::vector<SignaturePoint> signature(packed.size());
+    for (size_t i = 0; i < packed.size(); ++i) {
+        signature[i].hash = packed.hash(i);
+        signature[i].timestamp = packed.timestamp(i);
+        signature[i].frequency = hasSideTables ? frequencies[i] : 0;
+        signature[i].amplitude = hasSideTables ? amplitudes[i] : 0;
+    }
+    return signature;
+}
+
+SignaturePoint Catalog::signaturePoint(size_t index, size_t pointIndex) const {
+    const auto& packed = signatures_[index];
+    SignaturePoint point{};
+    point.hash = packed.hash(pointIndex);
+    point.timestamp = packed.timestamp(pointIndex);
+    if (packed.sideTablesDecoded()) {
+        point.frequency = packed.frequency(pointIndex);
+        point.amplitude = packed.amplitude(pointIndex);
+        return point;
+    }
+
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    if (sideTables_.size() != signatures_.size()) {
+        sideTables_.resize(signatures_.size());
+    }
+    auto& tables = sideTables_[index];
+    if (!tables) {
+        tables = std::make_unique<SideTables>();
+        // 加载时已校验过长度，解码失败说明附表内容损坏，此时按没有附表处理
+        if (!packed.decodeSideTables(tables->frequencies, tables->amplitudes)) {
+            tables->frequencies.assign(packed.size(), 0);
+            tables->amplitudes.assign(packed.size(), 0);
+        }
+    }
+    point.frequency = tables->frequencies[pointIndex];
+    point.amplitude = tables->amplitudes[pointIndex];
+    return point;
+}
+
+const std::vector<std::vector<SignaturePoint>>& Catalog::signatures() const {
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    if (!expandedValid_) {
+        expanded_.resize(signatures_.size());
+        for (size_t i = 0; i < signatures_.size(); ++i) {
+            expanded_[i] = unpackSignature(i);
+        }
+        expandedValid_ = true;
+    }
+    return expanded_;
+}
+
+CatalogMemoryUsage Catalog::memoryUsage() const {
+    CatalogMemoryUsage usage;
+    usage.signatureCount = signatures_.size();
+    usage.signatureBytes = heapBytes(signatures_);
+    for (const auto& signature : signatures_) {
+        usage.signaturePointCount += signature.size();
+        usage.signatureBytes += signature.memoryUsage();
+    }
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex_);
+        usage.signatureBytes += heapBytes(sideTables_);
+        for (const auto& tables : sideTables_) {
+            if (tables) {
+                usage.signatureBytes += sizeof(SideTables) + heapBytes(tables->frequencies) +
+                                        heapBytes(tables->amplitudes);
+            }
+        }
+        usage.expandedBytes = heapBytes(expanded_);
+        for (const auto& signature : expanded_) {
+            usage.expandedBytes += heapBytes(signature);
+        }
+    }
+
+    usage.mediaItemCount = mediaItems_.size();
+    usage.mediaItemBytes = heapBytes(mediaItems_);
+    for (const auto& mediaItem : mediaItems_) {
+        usage.mediaItemBytes += heapBytes(mediaItem.title()) + heapBytes(mediaItem.subtitle()) +
+                                heapBytes(mediaItem.customInfo());
+        for (const auto& [key, value] : mediaItem.customInfo()) {
+            usage.mediaItemBytes += heapBytes(key) + heapBytes(value);
+        }
+    }
+    return usage;
 }
 
 bool Catalog::saveToFile(const std::string& filename) const {
@@ -36,39 +172,47 @@ bool Catalog::saveToFile(const std::string& filename) const {
               << ", 条目数量=" << header.numEntries 
               << ", 大小=" << sizeof(header) << "字节" << std::endl;
 
+    // 紧凑编码所有指纹，指纹点按哈希重排，倒排索引基于重排后的顺序构建
+    std::vector<std::vector<uint8_t>> encodedEntries(signatures_.size());
+    std::vector<PackedSignature> storedSignatures(signatures_.size());
+    for (size_t i = 0; i < signatures_.size(); ++i) {
+        storedSignatures[i] = PackedSignature::pack(unpackSignature(i), storeSideTables_);
+        storedSignatures[i].encode(encodedEntries[i]);
+    }
+
     // 写入所有条目
     for (size_t i = 0; i < signatures_.size(); ++i) {
+        const auto& signature = signatures_[i];
         std::cout << "保存指纹 #" << i << " (" << mediaItems_[i].title() 
-                  << "), 指纹点数量: " << signatures_[i].size() << std::endl;
+                  << "), 指纹点数量: " << signature.size() << std::endl;
                   
         // 打印前几个哈希值用于调试
-        if (!signatures_[i].empty()) {
+        if (signature.size() > 0) {
             std::cout << "  前5个哈希值: ";
-            for (size_t j = 0; j < std::min(size_t(5), signatures_[i].size()); ++j) {
-                std::cout << "0x" << std::hex << signatures_[i][j].hash << std::dec << " ";
+            for (size_t j = 0; j < std::min(size_t(5), signature.size()); ++j) {
+                std::cout << "0x" << std::hex << signature.hash(j) << std::dec << " ";
             }
             std::cout << std::endl;
         }
         
         // 检查指纹是否为空
-        if (signatures_[i].empty()) {
+        if (signature.size() == 0) {
             std::cerr << "警告: 指纹 #" << i << " (" << mediaItems_[i].title() << ") 是空的" << std::endl;
         }
         
-        // 写入签名点数量
-        uint32_t numPoints = static_cast<uint32_t>(signatures_[i].size());
-        file.write(reinterpret_cast<const char*>(&numPoints), sizeof(numPoints));
+        // 写入紧凑编码长度和数据
+        const auto& encoded = encodedEntries[i];
+        uint32_t encodedSize = static_cast<uint32_t>(encoded.size());
+        file.write(reinterpret_cast<const char*>(&encodedSize), sizeof(encodedSize));
         if (!file.good()) {
-            std::cerr << "写入指纹点数量失败" << std::endl;
+            std::cerr << "写入指纹编码长度失败" << std::endl;
             return false;
         }
 
-        // 写入签名点数据
-        if (numPoints > 0) {
-            size_t dataSize = numPoints * sizeof(SignaturePoint);
-            file.write(reinterpret_cast<const char*>(signatures_[i].data()), dataSize);
+        if (encodedSize > 0) {
+            file.write(reinterpret_cast<const char*>(encoded.data()), encodedSize);
             if (!file.good()) {
-                std::cerr << "写入指纹点数据失败 (尝试写入 " << dataSize << " 字节)" << std::endl;
+                std::cerr << "写入指纹编码数据失败 (尝试写入 " << encodedSize << " 字节)" << std::endl;
                 return false;
             }
         }
@@ -168,6 +312,12 @@ bool Catalog::saveToFile(const std::string& filename) const {
         std::cerr << "写入校验和失败" << std::endl;
         return false;
     }
+
+    // 写入倒排索引段
+    if (!writeIndexSection(file, storedSignatures)) {
+        std::cerr << "写入倒排索引段失败" << std::endl;
+        return false;
+    }
     
     // 获取文件大小
     size_t fileSize = file.tellp();
@@ -177,16 +327,15 @@ bool Catalog::saveToFile(const std::string& filename) const {
 }
 
 bool Catalog::loadFromFile(const std::string& filename) {
-    std::ifstream file(filename, std::ios::binary);
-    if (!file.is_open()) {
+    // 整个文件只映射一次，条目从映射内容中解析，v2及以上格式的倒排索引段直接引用同一份映射
+    auto mappedFile = std::make_shared<MappedFile>();
+    if (!mappedFile->open(filename)) {
         std::cerr << "无法打开文件进行读取: " << filename << std::endl;
         return false;
     }
 
     // 检查文件大小
-    file.seekg(0, std::ios::end);
-    size_t fileSize = file.tellg();
-    file.seekg(0, std::ios::beg);
+    const size_t fileSize = mappedFile->size();
     
     std::cout << "文件大小: " << fileSize << " 字节" << std::endl;
     
@@ -197,21 +346,23 @@ bool Catalog::loadFromFile(const std::string& filename) {
     }
 
     // 读取文件头
+    ByteCursor cursor{mappedFile->data(), fileSize};
     FileHeader header;
-    file.read(reinterpret_cast<char*>(&header), sizeof(header));
-    if (!file.good()) {
+    if (!cursor.read(&header, sizeof(header))) {
         std::cerr << "读取文件头失败" << std::endl;
         return false;
     }
 
     // 检查版本
-    if (header.version != kFileVersion) {
-        std::cerr << "文件版本不匹配: 期望 " << kFileVersion << ", 实际 " << header.version << std::endl;
+    if (header.version != kFileVersion && header.version != kFileVersionV2 && 
+        header.version != kFileVersionV1) {
+        std::cerr << "文件版本不匹配: 期望 " << kFileVersionV1 << " 到 " << kFileVersion 
+                 << ", 实际 " << header.version << std::endl;
         return false;
     }
 
     // 检查条目数量是否合理
-    if (header.numEntries > 1000) {  // 设置一个合理的上限
+    if (header.numEntries > kMaxEntries) {  // 设置一个合理的上限
         std::cerr << "警告: 条目数量异常大 (" << header.numEntries 
                  << ")，可能是文件损坏或格式错误" << std::endl;
         return false;
@@ -222,14 +373,19 @@ bool Catalog::loadFromFile(const std::string& filename) {
     // 清空现有数据
     signatures_.clear();
     mediaItems_.clear();
+    index_.reset();
+    mappedFiles_.clear();
+    invalidateCaches();
+    // 延迟解码的附表引用映射内容
+    mappedFiles_.push_back(mappedFile);
 
     // 读取所有条目
     for (uint32_t i = 0; i < header.numEntries; ++i) {
-        std::vector<SignaturePoint> signature;
+        PackedSignature signature;
         MediaItem mediaItem;
         
         std::cout << "开始读取条目 #" << i << std::endl;
-        if (!readEntry(file, signature, mediaItem)) {
+        if (!readEntry(cursor, signature, mediaItem, header.version)) {
             std::cerr << "读取条目 #" << i << " 失败" << std::endl;
             return false;
         }
@@ -238,10 +394,10 @@ bool Catalog::loadFromFile(const std::string& filename) {
                   << "), 指纹点数量: " << signature.size() << std::endl;
                   
         // 打印前几个哈希值用于调试
-        if (!signature.empty()) {
+        if (signature.size() > 0) {
             std::cout << "  前5个哈希值: ";
             for (size_t j = 0; j < std::min(size_t(5), signature.size()); ++j) {
-                std::cout << "0x" << std::hex << signature[j].hash << std::dec << " ";
+                std::cout << "0x" << std::hex << signature.hash(j) << std::dec << " ";
             }
             std::cout << std::endl;
         }
@@ -251,25 +407,63 @@ bool Catalog::loadFromFile(const std::string& filename) {
     }
 
     // 检查校验和
-    if (file.tellg() + static_cast<std::streampos>(sizeof(uint32_t)) <= fileSize) {
+    bool checksumRead = false;
+    if (cursor.remaining() >= sizeof(uint32_t)) {
         uint32_t expectedChecksum = static_cast<uint32_t>(signatures_.size());
         uint32_t fileChecksum = 0;
-        file.read(reinterpret_cast<char*>(&fileChecksum), sizeof(fileChecksum));
+        checksumRead = cursor.read(&fileChecksum, sizeof(fileChecksum));
         
-        if (!file.good()) {
-            std::cerr << "警告: 读取校验和失败" << std::endl;
-        } else if (fileChecksum != expectedChecksum) {
+        if (fileChecksum != expectedChecksum) {
             std::cerr << "警告: 校验和不匹配，数据可能已损坏 (期望: " 
                      << expectedChecksum << ", 实际: " << fileChecksum << ")" << std::endl;
         }
     } else {
         std::cerr << "警告: 文件不包含校验和" << std::endl;
     }
+
+    // v2及以上格式：引用映射中文件末尾的倒排索引段，失败时由匹配器自行构建索引
+    if (header.version >= kFileVersionV2) {
+        if (checksumRead && mapIndexSection(mappedFile, cursor.offset)) {
+            std::cout << "已映射预构建倒排索引: 唯一哈希值数量 " << index_->hashCount()
+                      << ", 倒排记录数量 " << index_->postingCount() << std::endl;
+        } else {
+            std::cerr << "警告: 映射倒排索引段失败，将在匹配时重新构建索引" << std::endl;
+            index_.reset();
+        }
+    }
     
     std::cout << "指纹数据库加载成功，总计 " << signatures_.size() << " 个指纹" << std::endl;
     return !signatures_.empty();  // 只有至少加载了一个指纹才算成功
 }
 
+bool Catalog::appendFromFile(const std::string& filename) {
+    if (signatures_.empty()) {
+        return loadFromFile(filename);
+    }
+
+    Catalog segment;
+    if (!segment.loadFromFile(filename)) {
+        return false;
+    }
+
+    signatures_.reserve(signatures_.size() + segment.signatures_.size());
+    mediaItems_.reserve(mediaItems_.size() + segment.mediaItems_.size());
+    for (size_t i = 0; i < segment.signatures_.size(); ++i) {
+        signatures_.push_back(std::move(segment.signatures_[i]));
+        mediaItems_.push_back(std::move(segment.mediaItems_[i]));
+    }
+    // 移动后的指纹仍引用该段的映射
+    mappedFiles_.insert(mappedFiles_.end(), segment.mappedFiles_.begin(), segment.mappedFiles_.end());
+
+    // 下标已变化，各段的倒排索引不能直接复用
+    index_.reset();
+    invalidateCaches();
+
+    std::cout << "已追加 " << segment.signatures_.size() << " 个指纹，总计 " 
+              << signatures_.size() << " 个指纹" << std::endl;
+    return true;
+}
+
 bool Catalog::writeHeader(std::ofstream& file) const {
     FileHeader header;
     header.version = kFileVersion;
@@ -282,15 +476,14 @@ bool Catalog::writeHeader(std::ofstream& file) const {
 bool Catalog::writeEntry(std::ofstream& file, 
                         const std::vector<SignaturePoint>& signature,
                         const MediaItem& mediaItem) const {
-    // 写入签名点数量
-    uint32_t numPoints = static_cast<uint32_t>(signature.size());
-    file.write(reinterpret_cast<const char*>(&numPoints), sizeof(numPoints));
+    // 写入紧凑编码长度和数据
+    std::vector<uint8_t> encoded;
+    PackedSignature::pack(signature, storeSideTables_).encode(encoded);
+    uint32_t encodedSize = static_cast<uint32_t>(encoded.size());
+    file.write(reinterpret_cast<const char*>(&encodedSize), sizeof(encodedSize));
     if (!file.good()) return false;
-
-    // 写入签名点数据
-    if (numPoints > 0) {
-        file.write(reinterpret_cast<const char*>(signature.data()), 
-                  numPoints * sizeof(SignaturePoint));
+    if (encodedSize > 0) {
+        file.write(reinterpret_cast<const char*>(encoded.data()), encodedSize);
         if (!file.good()) return false;
     }
 
@@ -366,14 +559,15 @@ bool Catalog::readHeader(std::ifstream& file, FileHeader& header) const {
     }
     
     // 检查版本
-    if (header.version != kFileVersion) {
+    if (header.version != kFileVersion && header.version != kFileVersionV2 && 
+        header.version != kFileVersionV1) {
         std::cerr << "错误: 无效的文件版本 " << header.version 
-                 << " (期望 " << kFileVersion << ")" << std::endl;
+                 << " (期望 " << kFileVersionV1 << " 到 " << kFileVersion << ")" << std::endl;
         return false;
     }
     
     // 检查条目数是否合理
-    if (header.numEntries > 1000) {
+    if (header.numEntries > kMaxEntries) {
         std::cerr << "错误: 条目数量异常大 (" << header.numEntries << ")" << std::endl;
         return false;
     }
@@ -381,55 +575,20 @@ bool Catalog::readHeader(std::ifstream& file, FileHeader& header) const {
     return true;
 }
 
-bool Catalog::readEntry(std::ifstream& file,
-                       std::vector<SignaturePoint>& signature,
-                       MediaItem& mediaItem) {
-    // 读取签名点数量
-    uint32_t numPoints;
-    file.read(reinterpret_cast<char*>(&numPoints), sizeof(numPoints));
-    if (!file.good()) {
-        std::cerr << "错误: 读取指纹点数量失败" << std::endl;
+bool Catalog::readEntry(ByteCursor& cursor,
+                       PackedSignature& signature,
+                       MediaItem& mediaItem,
+                       uint32_t version) {
+    // v3为紧凑编码，v1/v2为SignaturePoint原始内存布局
+    const bool pointsRead = version >= kFileVersion ? readCompactPoints(cursor, signature) 
+                                                    : readRawPoints(cursor, signature);
+    if (!pointsRead) {
         return false;
     }
-    
-    // 检查数量是否合理
-    if (numPoints > 1000000) { // 设置一个合理的上限
-        std::cerr << "错误: 指纹点数量异常大 (" << numPoints << ")，可能是文件损坏" << std::endl;
-        return false;
-    }
-    
-    std::cout << "  读取到指纹点数量: " << numPoints << std::endl;
-
-    // 读取签名点数据
-    signature.resize(numPoints);
-    if (numPoints > 0) {
-        // 计算需要读取的数据大小
-        size_t dataSize = numPoints * sizeof(SignaturePoint);
-        
-        // 检查是否超出了文件剩余长度
-        std::streampos currentPos = file.tellg();
-        file.seekg(0, std::ios::end);
-        std::streampos endPos = file.tellg();
-        file.seekg(currentPos);
-        
-        if (currentPos + static_cast<std::streampos>(dataSize) > endPos) {
-            std::cerr << "错误: 指纹点数据超出文件范围 (需要读取 " << dataSize 
-                     << " 字节，但文件只剩 " << (endPos - currentPos) << " 字节)" << std::endl;
-            return false;
-        }
-        
-        file.read(reinterpret_cast<char*>(signature.data()), dataSize);
-        if (!file.good()) {
-            std::cerr << "错误: 读取指纹点数据失败 (期望读取 " << numPoints 
-                     << " 个点，每个点 " << sizeof(SignaturePoint) << " 字节)" << std::endl;
-            return false;
-        }
-    }
 
     // 读取标题
     uint32_t titleLen;
-    file.read(reinterpret_cast<char*>(&titleLen), sizeof(titleLen));
-    if (!file.good()) {
+    if (!cursor.read(&titleLen, sizeof(titleLen))) {
         std::cerr << "错误: 读取标题长度失败" << std::endl;
         return false;
     }
@@ -444,8 +603,7 @@ bool Catalog::readEntry(std::ifstream& file,
     
     if (titleLen > 0) {
         std::string title(titleLen, '\0');
-        file.read(&title[0], titleLen);
-        if (!file.good()) {
+        if (!cursor.read(&title[0], titleLen)) {
             std::cerr << "错误: 读取标题内容失败" << std::endl;
             return false;
         }
@@ -454,8 +612,7 @@ bool Catalog::readEntry(std::ifstream& file,
 
     // 读取副标题
     uint32_t subtitleLen;
-    file.read(reinterpret_cast<char*>(&subtitleLen), sizeof(subtitleLen));
-    if (!file.good()) {
+    if (!cursor.read(&subtitleLen, sizeof(subtitleLen))) {
         std::cerr << "错误: 读取副标题长度失败" << std::endl;
         return false;
     }
@@ -464,8 +621,7 @@ bool Catalog::readEntry(std::ifstream& file,
     
     if (subtitleLen > 0) {
         std::string subtitle(subtitleLen, '\0');
-        file.read(&subtitle[0], subtitleLen);
-        if (!file.good()) {
+        if (!cursor.read(&subtitle[0], subtitleLen)) {
             std::cerr << "错误: 读取副标题内容失败" << std::endl;
             return false;
         }
@@ -474,8 +630,7 @@ bool Catalog::readEntry(std::ifstream& file,
 
     // 读取通道数量
     uint32_t channelCount;
-    file.read(reinterpret_cast<char*>(&channelCount), sizeof(channelCount));
-    if (!file.good()) {
+    if (!cursor.read(&channelCount, sizeof(channelCount))) {
         std::cerr << "错误: 读取通道数量失败" << std::endl;
         return false;
     }
@@ -483,8 +638,7 @@ bool Catalog::readEntry(std::ifstream& file,
 
     // 读取自定义信息数量
     uint32_t numCustomInfo;
-    file.read(reinterpret_cast<char*>(&numCustomInfo), sizeof(numCustomInfo));
-    if (!file.good()) {
+    if (!cursor.read(&numCustomInfo, sizeof(numCustomInfo))) {
         std::cerr << "错误: 读取自定义信息数量失败" << std::endl;
         return false;
     }
@@ -494,8 +648,7 @@ bool Catalog::readEntry(std::ifstream& file,
     // 读取自定义信息
     for (uint32_t i = 0; i < numCustomInfo; ++i) {
         uint32_t keyLen;
-        file.read(reinterpret_cast<char*>(&keyLen), sizeof(keyLen));
-        if (!file.good()) {
+        if (!cursor.read(&keyLen, sizeof(keyLen))) {
             std::cerr << "错误: 读取自定义信息键长度失败" << std::endl;
             return false;
         }
@@ -503,16 +656,14 @@ bool Catalog::readEntry(std::ifstream& file,
         std::string key;
         if (keyLen > 0) {
             key.resize(keyLen);
-            file.read(&key[0], keyLen);
-            if (!file.good()) {
+            if (!cursor.read(&key[0], keyLen)) {
                 std::cerr << "错误: 读取自定义信息键失败" << std::endl;
                 return false;
             }
         }
 
         uint32_t valueLen;
-        file.read(reinterpret_cast<char*>(&valueLen), sizeof(valueLen));
-        if (!file.good()) {
+        if (!cursor.read(&valueLen, sizeof(valueLen))) {
             std::cerr << "错误: 读取自定义信息值长度失败" << std::endl;
             return false;
         }
@@ -520,8 +671,7 @@ bool Catalog::readEntry(std::ifstream& file,
         std::string value;
         if (valueLen > 0) {
             value.resize(valueLen);
-            file.read(&value[0], valueLen);
-            if (!file.good()) {
+            if (!cursor.read(&value[0], valueLen)) {
                 std::cerr << "错误: 读取自定义信息值失败" << std::endl;
                 return false;
             }
@@ -533,4 +683,157 @@ bool Catalog::readEntry(std::ifstream& file,
     return true;
 }
 
-} // namespace afp 
\ No newline at end of file
+bool Catalog::readRawPoints(ByteCursor& cursor, PackedSignature& packed) {
+    // 读取签名点数量
+    uint32_t numPoints;
+    if (!cursor.read(&numPoints, sizeof(numPoints))) {
+        std::cerr << "错误: 读取指纹点数量失败" << std::endl;
+        return false;
+    }
+    
+    // 检查数量是否合理
+    if (numPoints > 1000000) { // 设置一个合理的上限
+        std::cerr << "错误: 指纹点数量异常大 (" << numPoints << ")，可能是文件损坏" << std::endl;
+        return false;
+    }
+    
+    std::cout << "  读取到指纹点数量: " << numPoints << std::endl;
+
+    // 读取签名点数据
+    std::vector<SignaturePoint> signature(numPoints);
+    if (numPoints > 0) {
+        // 计算需要读取的数据大小
+        size_t dataSize = numPoints * sizeof(SignaturePoint);
+        
+        // 检查是否超出了文件剩余长度
+        if (!cursor.read(signature.data(), dataSize)) {
+            std::cerr << "错误: 指纹点数据超出文件范围 (需要读取 " << dataSize 
+                     << " 字节，但文件只剩 " << cursor.remaining() << " 字节)" << std::endl;
+            return false;
+        }
+    }
+
+    // 保持文件中的点顺序，v2的倒排索引段基于该顺序
+    packed = PackedSignature::pack(signature, true, false);
+    return true;
+}
+
+bool Catalog::readCompactPoints(ByteCursor& cursor, PackedSignature& packed) {
+    // 读取编码长度
+    uint32_t encodedSize;
+    if (!cursor.read(&encodedSize, sizeof(encodedSize))) {
+        std::cerr << "错误: 读取指纹编码长度失败" << std::endl;
+        return false;
+    }
+
+    // 检查是否超出了文件剩余长度，编码数据直接在映射内容上解码
+    const uint8_t* encoded = cursor.take(encodedSize);
+    if (!encoded) {
+        std::cerr << "错误: 指纹编码数据超出文件范围 (需要读取 " << encodedSize 
+                 << " 字节，但文件只剩 " << cursor.remaining() << " 字节)" << std::endl;
+        return false;
+    }
+
+    // 附表只校验长度，按需解码时再读取映射内容
+    if (!PackedSignature::decode(encoded, encodedSize, packed, false)) {
+        std::cerr << "错误: 指纹编码数据不合法，可能是文件损坏" << std::endl;
+        return false;
+    }
+
+    if (packed.size() > 1000000) { // 设置一个合理的上限
+        std::cerr << "错误: 指纹点数量异常大 (" << packed.size() << ")，可能是文件损坏" << std::endl;
+        return false;
+    }
+
+    std::cout << "  读取到指纹点数量: " << packed.size() << " (编码大小: " << encodedSize << " 字节)" << std::endl;
+    return true;
+}
+
+bool Catalog::writeIndexSection(std::ofstream& file, 
+                               const std::vector<PackedSignature>& storedSignatures) const {
+    // 索引必须与写入文件的指纹点顺序一致，因此基于紧凑编码重排后的指纹构建
+    std::vector<SignatureView> views;
+    views.reserve(storedSignatures.size());
+    for (const auto& signature : storedSignatures) {
+        views.push_back(signature.view());
+    }
+    auto index = std::make_shared<CatalogIndex>(views);
+
+    // 对齐到8字节，保证mmap后各数组按自然对齐访问
+    const uint64_t padding = 0;
+    const auto pos = static_cast<size_t>(file.tellp());
+    const size_t paddingSize = (8 - pos % 8) % 8;
+    file.write(reinterpret_cast<const char*>(&padding), paddingSize);
+
+    IndexSectionHeader sectionHeader;
+    sectionHeader.magic = kIndexSectionMagic;
+    sectionHeader.hashCount = static_cast<uint32_t>(index->hashCount());
+    sectionHeader.postingCount = static_cast<uint64_t>(index->postingCount());
+    file.write(reinterpret_cast<const char*>(&sectionHeader), sizeof(sectionHeader));
+
+    file.write(reinterpret_cast<const char*>(index->hashes()), 
+              index->hashCount() * sizeof(uint32_t));
+    file.write(reinterpret_cast<const char*>(index->offsets()), 
+              (index->hashCount() + 1) * sizeof(uint32_t));
+    file.write(reinterpret_cast<const char*>(index->postings()), 
+              index->postingCount() * sizeof(IndexPosting));
+    if (!file.good()) {
+        return false;
+    }
+
+    std::cout << "写入倒排索引段: 唯一哈希值数量=" << sectionHeader.hashCount 
+              << ", 倒排记录数量=" << sectionHeader.postingCount << std::endl;
+    return true;
+}
+
+bool Catalog::mapIndexSection(const std::shared_ptr<MappedFile>& mappedFile, size_t sectionOffset) {
+    const uint8_t* base = mappedFile->data();
+    const size_t fileSize = mappedFile->size();
+
+    // 跳过对齐填充
+    size_t offset = (sectionOffset + 7) / 8 * 8;
+    if (offset + sizeof(IndexSectionHeader) > fileSize) {
+        std::cerr << "错误: 文件不包含倒排索引段" << std::endl;
+        return false;
+    }
+
+    IndexSectionHeader sectionHeader;
+    std::memcpy(&sectionHeader, base + offset, sizeof(sectionHeader));
+    offset += sizeof(sectionHeader);
+
+    if (sectionHeader.magic != kIndexSectionMagic) {
+        std::cerr << "错误: 倒排索引段标识不匹配" << std::endl;
+        return false;
+    }
+
+    // 校验各数组长度不超出文件范围
+    const size_t hashCount = sectionHeader.hashCount;
+    const size_t postingCount = static_cast<size_t>(sectionHeader.postingCount);
+    const size_t hashesSize = hashCount * sizeof(uint32_t);
+    const size_t offsetsSize = (hashCount + 1) * sizeof(uint32_t);
+    const size_t postingsSize = postingCount * sizeof(IndexPosting);
+    if (offset + hashesSize + offsetsSize + postingsSize > fileSize) {
+        std::cerr << "错误: 倒排索引段数据超出文件范围" << std::endl;
+        return false;
+    }
+
+    const auto* hashes = reinterpret_cast<const uint32_t*>(base + offset);
+    const auto* offsets = reinterpret_cast<const uint32_t*>(base + offset + hashesSize);
+    const auto* postings = reinterpret_cast<const IndexPosting*>(base + offset + hashesSize + offsetsSize);
+
+    // 倒排记录总数必须与指纹点总数一致
+    size_t totalPoints = 0;
+    for (const auto& signature : signatures_) {
+        totalPoints += signature.size();
+    }
+    if (offsets[hashCount] != postingCount || postingCount != totalPoints) {
+        std::cerr << "错误: 倒排索引段与指纹数据不一致 (倒排记录数量: " << postingCount 
+                 << ", 指纹点数量: " << totalPoints << ")" << std::endl;
+        return false;
+    }
+
+    index_ = std::make_shared<CatalogIndex>(hashes, offsets, postings, hashCount, postingCount, mappedFile);
+    return true;
+}
+
+} // namespace afp
@@ -2,13 +2,18 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 #include "signature/signature_generator.h"
 #include "afp/media_item.h"
 #include "afp/icatalog.h"
+#include "catalog/catalog_index.h"
+#include "catalog/packed_signature.h"
 
 namespace afp {
 
+class MappedFile;
+
 class Catalog : public ICatalog {
 public:
     Catalog() = default;
@@ -22,21 +27,59 @@ public:
     bool saveToFile(const std::string& filename) const override;
 
     // 从文件反序列化
+    // 整个文件只mmap映射一次：条目直接从映射内容解码为紧凑表示，倒排索引段原地使用；
+    // 频率/振幅附表不解码，保持映射并在第一次访问时按需解码
     bool loadFromFile(const std::string& filename) override;
 
-    // 获取所有指纹
-    const std::vector<std::vector<SignaturePoint>>& signatures() const override {
-        return signatures_;
+    // 从文件反序列化并追加到现有内容之后
+    // 当前为空时直接沿用该文件的预构建倒排索引，否则索引失效，由匹配器重新构建
+    bool appendFromFile(const std::string& filename) override;
+
+    size_t signatureCount() const override {
+        return signatures_.size();
+    }
+
+    SignatureView signatureView(size_t index) const override {
+        return signatures_[index].view();
     }
 
+    SignaturePoint signaturePoint(size_t index, size_t pointIndex) const override;
+
+    // 获取所有指纹，第一次调用时展开并缓存
+    const std::vector<std::vector<SignaturePoint>>& signatures() const override;
+
     // 获取所有媒体信息
     const std::vector<MediaItem>& mediaItems() const override {
         return mediaItems_;
     }
 
+    // 指纹和媒体信息占用的内存
+    CatalogMemoryUsage memoryUsage() const override;
+
+    // 保存时是否写入频率/振幅附表（仅用于调试和可视化，关闭后文件更小），默认写入
+    void setStoreSideTables(bool store) {
+        storeSideTables_ = store;
+    }
+
+    // 获取从文件加载的预构建倒排索引（直接引用mmap映射的文件内容），没有时返回nullptr
+    std::shared_ptr<const CatalogIndex> index() const {
+        return index_;
+    }
+
 private:
     // 文件格式版本
-    static constexpr uint32_t kFileVersion = 1;
+    // v1: 文件头 + 条目 + 校验和
+    // v2: 在v1的内容之后追加按哈希排序的倒排索引段，加载时mmap映射后直接使用
+    // v3: 条目中的指纹点改为PackedSignature紧凑编码（哈希差分 + 时间戳表下标 + 可选附表），倒排索引段同v2
+    static constexpr uint32_t kFileVersionV1 = 1;
+    static constexpr uint32_t kFileVersionV2 = 2;
+    static constexpr uint32_t kFileVersion = 3;
+
+    // 单个文件的条目数量上限，合并后的目录段可能包含大量条目
+    static constexpr uint32_t kMaxEntries = 1000000;
+
+    // 倒排索引段标识 'AFPI'
+    static constexpr uint32_t kIndexSectionMagic = 0x49504641;
 
     // 文件头部结构
     struct FileHeader {
@@ -44,19 +87,58 @@ private:
         uint32_t numEntries;
     };
 
+    // 倒排索引段头部结构，紧随其后依次为:
+    // uint32_t hashes[hashCount] | uint32_t offsets[hashCount + 1] | IndexPosting postings[postingCount]
+    struct IndexSectionHeader {
+        uint32_t magic;
+        uint32_t hashCount;
+        uint64_t postingCount;
+    };
+
     // 序列化辅助函数
     bool writeHeader(std::ofstream& file) const;
     bool writeEntry(std::ofstream& file, 
                    const std::vector<SignaturePoint>& signature,
                    const MediaItem& mediaItem) const;
+    // 在映射的文件内容上顺序读取，定义见catalog.cpp
+    struct ByteCursor;
+
     bool readHeader(std::ifstream& file, FileHeader& header) const;
-    bool readEntry(std::ifstream& file,
-                  std::vector<SignaturePoint>& signature,
-                  MediaItem& mediaItem);
+    bool readEntry(ByteCursor& cursor,
+                  PackedSignature& signature,
+                  MediaItem& mediaItem,
+                  uint32_t version);
+    bool readRawPoints(ByteCursor& cursor, PackedSignature& signature);
+    bool readCompactPoints(ByteCursor& cursor, PackedSignature& signature);
+    bool writeIndexSection(std::ofstream& file, 
+                          const std::vector<PackedSignature>& storedSignatures) const;
+    bool mapIndexSection(const std::shared_ptr<MappedFile>& mappedFile, size_t sectionOffset);
+
+    // 展开第index条指纹，附表尚未解码时临时解码，不写入缓存
+    std::vector<SignaturePoint> unpackSignature(size_t index) const;
+
+    // 内容变化后清空按需解码和展开的缓存
+    void invalidateCaches();
 
 private:
-    std::vector<std::vector<SignaturePoint>> signatures_;
+    // 按需解码的频率/振幅附表
+    struct SideTables {
+        std::vector<uint32_t> frequencies;
+        std::vector<uint32_t> amplitudes;
+    };
+
+    std::vector<PackedSignature> signatures_;
     std::vector<MediaItem> mediaItems_;
+    std::shared_ptr<const CatalogIndex> index_;
+    // 加载的文件映射，延迟解码的附表引用其中的内容
+    std::vector<std::shared_ptr<MappedFile>> mappedFiles_;
+    bool storeSideTables_ = true;
+
+    // 以下为const方法中按需填充的缓存，由cacheMutex_保护
+    mutable std::mutex cacheMutex_;
+    mutable std::vector<std::unique_ptr<SideTables>> sideTables_;   // 下标同signatures_，未解码时为空
+    mutable std::vector<std::vector<SignaturePoint>> expanded_;     // signatures()的展开结果
+    mutable bool expandedValid_ = false;
 };
 
 } // namespace afp 
\ No newline at end of file
@@ -0,0 +1,397 @@
+#include "catalog_index.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include "catalog/catalog.h"
+#include "base/memory_accounting.h"
+
+namespace afp {
+
+namespace {
+
+inline void prefetchRead(const void* address) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address);
+#else
+    (void)address;
+#endif
+}
+
+} // namespace
+
+std::shared_ptr<const CatalogIndex> CatalogIndex::fromCatalog(const std::shared_ptr<ICatalog>& catalog,
+                                                             const CatalogIndexOptions& options) {
+    // 如果catalog从v2及以上文件加载，直接使用文件中预构建并排好序的倒排索引
+    if (auto concreteCatalog = std::dynamic_pointer_cast<Catalog>(catalog)) {
+        if (auto index = concreteCatalog->index()) {
+            if (!options.suppressesHashes()) {
+                return index;
+            }
+            return std::make_shared<CatalogIndex>(index->hashes(), index->offsets(), index->postings(),
+                                                  index->hashCount(), index->postingCount(), index, options);
+        }
+    }
+
+    // 否则在内存中构建CSR倒排索引：唯一哈希数组 + 偏移数组 + 连续的倒排记录数组
+    return std::make_shared<CatalogIndex>(viewsOf(*catalog), options);
+}
+
+std::vector<SignatureView> CatalogIndex::viewsOf(const ICatalog& catalog) {
+    std::vector<SignatureView> views;
+    views.reserve(catalog.signatureCount());
+    for (size_t i = 0; i < catalog.signatureCount(); ++i) {
+        views.push_back(catalog.signatureView(i));
+    }
+    return views;
+}
+
+CatalogIndex::CatalogIndex(const std::vector<SignatureView>& signatures,
+                           const CatalogIndexOptions& options) {
+    struct Entry {
+        uint32_t hash;
+        IndexPosting posting;
+    };
+
+    size_t totalPoints = 0;
+    for (const auto& signature : signatures) {
+        totalPoints += signature.size();
+    }
+
+    std::vector<Entry> entries;
+    entries.reserve(totalPoints);
+    for (size_t i = 0; i < signatures.size(); ++i) {
+        const auto& signature = signatures[i];
+        for (size_t j = 0; j < signature.size(); ++j) {
+            entries.push_back(Entry{signature.hash(j),
+                                    IndexPosting{static_cast<uint32_t>(i), static_cast<uint32_t>(j)}});
+        }
+    }
+
+    // 按哈希排序；同一哈希内保持(signatureIndex, pointIndex)的插入顺序
+    std::stable_sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.hash < b.hash;
+    });
+
+    ownedPostings_.reserve(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (i == 0 || entries[i].hash != entries[i - 1].hash) {
+            ownedHashes_.push_back(entries[i].hash);
+            ownedOffsets_.push_back(static_cast<uint32_t>(ownedPostings_.size()));
+        }
+        ownedPostings_.push_back(entries[i].posting);
+    }
+    ownedOffsets_.push_back(static_cast<uint32_t>(ownedPostings_.size()));
+
+    hashes_ = ownedHashes_.data();
+    offsets_ = ownedOffsets_.data();
+    postings_ = ownedPostings_.data();
+    hashCount_ = ownedHashes_.size();
+    postingCount_ = ownedPostings_.size();
+
+    markStopHashes(options);
+    buildFilter();
+}
+
+CatalogIndex::CatalogIndex(const uint32_t* hashes,
+                           const uint32_t* offsets,
+                           const IndexPosting* postings,
+                           size_t hashCount,
+                           size_t postingCount,
+                           std::shared_ptr<const void> holder,
+                           const CatalogIndexOptions& options)
+    : holder_(std::move(holder))
+    , hashes_(hashes)
+    , offsets_(offsets)
+    , postings_(postings)
+    , hashCount_(hashCount)
+    , postingCount_(postingCount) {
+    markStopHashes(options);
+    buildFilter();
+}
+
+std::shared_ptr<const CatalogIndex> CatalogIndex::partition(const std::vector<SignatureView>& signatures,
+                                                            const ICatalogIndex& full,
+                                                            size_t shardIndex, size_t shardCount) {
+    struct Entry {
+        uint32_t hash;
+        IndexPosting posting;
+    };
+
+    std::vector<Entry> entries;
+    for (size_t i = shardIndex; i < signatures.size(); i += shardCount) {
+        const auto& signature = signatures[i];
+        for (size_t j = 0; j < signature.size(); ++j) {
+            entries.push_back(Entry{signature.hash(j),
+                                    IndexPosting{static_cast<uint32_t>(i), static_cast<uint32_t>(j)}});
+        }
+    }
+    std::stable_sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.hash < b.hash;
+    });
+
+    // 本分片的唯一哈希在full中查找，未命中的是停用哈希
+    std::vector<uint32_t> uniqueHashes;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (i == 0 || entries[i].hash != entries[i - 1].hash) {
+            uniqueHashes.push_back(entries[i].hash);
+        }
+    }
+    std::vector<std::pair<const IndexPosting*, const IndexPosting*>> ranges(uniqueHashes.size());
+    full.findBatch(uniqueHashes.data(), uniqueHashes.size(), ranges.data());
+
+    std::shared_ptr<CatalogIndex> index(new CatalogIndex());
+    index->ownedPostings_.reserve(entries.size());
+    size_t unique = 0;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (i > 0 && entries[i].hash != entries[i - 1].hash) {
+            ++unique;
+        }
+        if (ranges[unique].first == ranges[unique].second) {
+            continue;
+        }
+        if (index->ownedHashes_.empty() || index->ownedHashes_.back() != entries[i].hash) {
+            index->ownedHashes_.push_back(entries[i].hash);
+            index->ownedOffsets_.push_back(static_cast<uint32_t>(index->ownedPostings_.size()));
+        }
+        index->ownedPostings_.push_back(entries[i].posting);
+    }
+    index->ownedOffsets_.push_back(static_cast<uint32_t>(index->ownedPostings_.size()));
+
+    index->hashes_ = index->ownedHashes_.data();
+    index->offsets_ = index->ownedOffsets_.data();
+    index->postings_ = index->ownedPostings_.data();
+    index->hashCount_ = index->ownedHashes_.size();
+    index->postingCount_ = index->ownedPostings_.size();
+    index->buildFilter();
+    return index;
+}
+
+std::shared_ptr<const CatalogIndex> CatalogIndex::replicate() const {
+    std::shared_ptr<CatalogIndex> replica(new CatalogIndex());
+    replica->ownedHashes_.assign(hashes_, hashes_ + hashCount_);
+    replica->ownedOffsets_.assign(offsets_, offsets_ + hashCount_ + 1);
+    replica->ownedPostings_.assign(postings_, postings_ + postingCount_);
+    replica->hashes_ = replica->ownedHashes_.data();
+    replica->offsets_ = replica->ownedOffsets_.data();
+    replica->postings_ = replica->ownedPostings_.data();
+    replica->hashCount_ = hashCount_;
+    replica->postingCount_ = postingCount_;
+    replica->stopHashes_ = stopHashes_;
+    replica->stopHashCount_ = stopHashCount_;
+    replica->stopPostingCount_ = stopPostingCount_;
+    replica->filterWords_ = filterWords_;
+    replica->filterShift_ = filterShift_;
+    return replica;
+}
+
+size_t CatalogIndex::documentFrequencyAt(size_t i) const {
+    // 同一哈希的记录按signatureIndex升序排列，统计不同的signatureIndex即可
+    size_t documentFrequency = 0;
+    for (uint32_t k = offsets_[i]; k < offsets_[i + 1]; ++k) {
+        if (k == offsets_[i] || postings_[k].signatureIndex != postings_[k - 1].signatureIndex) {
+            ++documentFrequency;
+        }
+    }
+    return documentFrequency;
+}
+
+void CatalogIndex::markStopHashes(const CatalogIndexOptions& options) {
+    stopHashes_.clear();
+    stopHashCount_ = 0;
+    stopPostingCount_ = 0;
+    if (!options.suppressesHashes()) {
+        return;
+    }
+
+    stopHashes_.assign(hashCount_, 0);
+    for (size_t i = 0; i < hashCount_; ++i) {
+        const size_t postingCount = postingCountAt(i);
+        const bool tooManyPostings = options.maxPostingsPerHash > 0 && postingCount > options.maxPostingsPerHash;
+        // 文档频率不会超过倒排记录数量，记录数量不超过阈值时无需逐条统计
+        const bool tooManyDocuments = options.maxDocumentFrequency > 0 && postingCount > options.maxDocumentFrequency &&
+                                      documentFrequencyAt(i) > options.maxDocumentFrequency;
+        if (tooManyPostings || tooManyDocuments) {
+            stopHashes_[i] = 1;
+            ++stopHashCount_;
+            stopPostingCount_ += postingCount;
+        }
+    }
+
+    if (stopHashCount_ > 0) {
+        std::cout << "停用哈希数量: " << stopHashCount_ << ", 停用倒排记录数量: " << stopPostingCount_
+                  << " (文档频率上限: " << options.maxDocumentFrequency
+                  << ", 倒排记录上限: " << options.maxPostingsPerHash << ")" << std::endl;
+    }
+}
+
+bool CatalogIndex::writeStatistics(const std::string& filename, size_t topHashCount) const {
+    std::ofstream file(filename, std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "无法写入哈希统计文件: " << filename << std::endl;
+        return false;
+    }
+
+    struct HashStat {
+        uint32_t hash;
+        size_t postingCount;
+        size_t documentFrequency;
+    };
+
+    // 按2的幂分桶统计倒排记录长度和文档频率的分布
+    std::map<size_t, size_t> postingHistogram;
+    std::map<size_t, size_t> documentHistogram;
+    std::vector<HashStat> stats;
+    stats.reserve(hashCount_);
+    auto bucketOf = [](size_t value) {
+        size_t bucket = 1;
+        while (bucket * 2 <= value) {
+            bucket *= 2;
+        }
+        return bucket;
+    };
+    for (size_t i = 0; i < hashCount_; ++i) {
+        HashStat stat{hashes_[i], postingCountAt(i), documentFrequencyAt(i)};
+        postingHistogram[bucketOf(stat.postingCount)] += 1;
+        documentHistogram[bucketOf(stat.documentFrequency)] += 1;
+        stats.push_back(stat);
+    }
+
+    const size_t topCount = std::min(topHashCount, stats.size());
+    std::partial_sort(stats.begin(), stats.begin() + topCount, stats.end(), [](const HashStat& a, const HashStat& b) {
+        return a.postingCount != b.postingCount ? a.postingCount > b.postingCount : a.hash < b.hash;
+    });
+
+    file << "# AFP hash statistics\n";
+    file << "hash_count " << hashCount_ << "\n";
+    file << "posting_count " << postingCount_ << "\n";
+    file << "# posting_length_bucket hash_count  (bucket [n, 2n))\n";
+    for (const auto& [bucket, count] : postingHistogram) {
+        file << "postings " << bucket << " " << count << "\n";
+    }
+    file << "# document_frequency_bucket hash_count  (bucket [n, 2n))\n";
+    for (const auto& [bucket, count] : documentHistogram) {
+        file << "df " << bucket << " " << count << "\n";
+    }
+    file << "# top hashes: hash posting_count document_frequency\n";
+    for (size_t i = 0; i < topCount; ++i) {
+        file << "top 0x" << std::hex << std::setw(8) << std::setfill('0') << stats[i].hash << std::dec
+             << " " << stats[i].postingCount << " " << stats[i].documentFrequency << "\n";
+    }
+
+    return file.good();
+}
+
+void CatalogIndex::buildFilter() {
+    uint32_t bitsLog2 = kMinFilterBitsLog2;
+    while (bitsLog2 < kMaxFilterBitsLog2 && (size_t(1) << bitsLog2) < hashCount_ * kFilterBitsPerHash) {
+        ++bitsLog2;
+    }
+
+    filterShift_ = 32 - bitsLog2;
+    filterWords_.assign((size_t(1) << bitsLog2) / 64, 0);
+    for (size_t i = 0; i < hashCount_; ++i) {
+        if (!stopHashes_.empty() && stopHashes_[i]) {
+            continue;
+        }
+        const uint32_t slot = filterSlot(hashes_[i]);
+        filterWords_[slot >> 6] |= uint64_t(1) << (slot & 63);
+    }
+}
+
+IndexMemoryUsage CatalogIndex::memoryUsage() const {
+    IndexMemoryUsage usage;
+    usage.hashCount = hashCount_;
+    usage.postingCount = postingCount_;
+    if (holder_) {
+        usage.bucketBytes = hashCount_ * sizeof(uint32_t) + (hashCount_ + 1) * sizeof(uint32_t);
+        usage.postingBytes = postingCount_ * sizeof(IndexPosting);
+        usage.mappedBytes = usage.bucketBytes + usage.postingBytes;
+    } else {
+        usage.bucketBytes = heapBytes(ownedHashes_) + heapBytes(ownedOffsets_);
+        usage.postingBytes = heapBytes(ownedPostings_);
+    }
+    usage.overheadBytes = heapBytes(stopHashes_) + heapBytes(filterWords_);
+    return usage;
+}
+
+std::pair<const IndexPosting*, const IndexPosting*> CatalogIndex::find(uint32_t hash) const {
+    // 位图中没有对应位时一定未命中，跳过二分查找
+    const uint32_t slot = filterSlot(hash);
+    if ((filterWords_[slot >> 6] & (uint64_t(1) << (slot & 63))) == 0) {
+        return {nullptr, nullptr};
+    }
+
+    const uint32_t* end = hashes_ + hashCount_;
+    const uint32_t* it = std::lower_bound(hashes_, end, hash);
+    if (it == end || *it != hash) {
+        return {nullptr, nullptr};
+    }
+
+    const size_t i = static_cast<size_t>(it - hashes_);
+    if (!stopHashes_.empty() && stopHashes_[i]) {
+        return {nullptr, nullptr};
+    }
+    return {postings_ + offsets_[i], postings_ + offsets_[i + 1]};
+}
+
+void CatalogIndex::findBatch(const uint32_t* hashes, size_t count,
+                             std::pair<const IndexPosting*, const IndexPosting*>* ranges) const {
+    size_t positions[kLookupGroup];
+    size_t groupSize = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const uint32_t slot = filterSlot(hashes[i]);
+        if (hashCount_ == 0 || (filterWords_[slot >> 6] & (uint64_t(1) << (slot & 63))) == 0) {
+            ranges[i] = {nullptr, nullptr};
+            continue;
+        }
+        positions[groupSize++] = i;
+        if (groupSize == kLookupGroup) {
+            findGroup(hashes, positions, groupSize, ranges);
+            groupSize = 0;
+        }
+    }
+    if (groupSize > 0) {
+        findGroup(hashes, positions, groupSize, ranges);
+    }
+}
+
+void CatalogIndex::findGroup(const uint32_t* hashes, const size_t* positions, size_t groupSize,
+                             std::pair<const IndexPosting*, const IndexPosting*>* ranges) const {
+    // 无分支的lower_bound：每一级所有查找的剩余区间长度相同，区间起点各自前进
+    const uint32_t* base[kLookupGroup];
+    for (size_t g = 0; g < groupSize; ++g) {
+        base[g] = hashes_;
+    }
+    size_t remaining = hashCount_;
+    while (remaining > 1) {
+        const size_t half = remaining / 2;
+        const size_t nextHalf = (remaining - half) / 2;
+        for (size_t g = 0; g < groupSize; ++g) {
+            base[g] = base[g][half] < hashes[positions[g]] ? base[g] + half : base[g];
+            prefetchRead(base[g] + nextHalf);
+        }
+        remaining -= half;
+    }
+
+    const uint32_t* end = hashes_ + hashCount_;
+    for (size_t g = 0; g < groupSize; ++g) {
+        const uint32_t hash = hashes[positions[g]];
+        const uint32_t* it = base[g] + (*base[g] < hash ? 1 : 0);
+        auto& range = ranges[positions[g]];
+        if (it == end || *it != hash) {
+            range = {nullptr, nullptr};
+            continue;
+        }
+        const size_t i = static_cast<size_t>(it - hashes_);
+        if (!stopHashes_.empty() && stopHashes_[i]) {
+            range = {nullptr, nullptr};
+            continue;
+        }
+        range = {postings_ + offsets_[i], postings_ + offsets_[i + 1]};
+        prefetchRead(range.first);
+    }
+}
+
+} // namespace afp
@@ -0,0 +1,159 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "afp/icatalog.h"
+#include "afp/icatalog_index.h"
+#include "afp/isignature_generator.h"
+#include "afp/iperformance_config.h"
+
+namespace afp {
+
+// 建索引选项
+// 静音、单音、背景音乐等产生的哈希在目录中大量重复，每次命中都会展开成大量候选session；
+// 超过阈值的哈希作为停用哈希，find时按未命中处理，查询的最坏开销因此有上界
+struct CatalogIndexOptions {
+    size_t maxDocumentFrequency = 0;  // 哈希出现的目标指纹数量上限，0表示不限制
+    size_t maxPostingsPerHash = 0;    // 单个哈希的倒排记录数量上限，0表示不限制
+
+    static CatalogIndexOptions fromMatchingConfig(const MatchingConfig& config) {
+        CatalogIndexOptions options;
+        options.maxDocumentFrequency = config.maxHashDocumentFrequency;
+        options.maxPostingsPerHash = config.maxPostingsPerHash;
+        return options;
+    }
+
+    bool suppressesHashes() const {
+        return maxDocumentFrequency > 0 || maxPostingsPerHash > 0;
+    }
+};
+
+// 哈希值到指纹点的倒排索引
+// 按哈希值排序的唯一哈希数组 + 偏移数组 + 倒排记录数组，同一哈希的记录按(signatureIndex, pointIndex)升序排列
+// 既可以由指纹数据构建（自身持有内存），也可以直接引用外部内存（例如mmap映射的catalog文件）
+// 构建时另外生成一个哈希占用位图，大部分查询哈希在目录中不存在，未命中时只读一个缓存行即可拒绝
+class CatalogIndex : public ICatalogIndex {
+public:
+    // 获取catalog的倒排索引：优先复用从文件映射的预构建索引，否则从指纹数据构建
+    // 设置了停用哈希选项时，在映射的索引之上套一层带停用标记的视图，不拷贝倒排数据
+    static std::shared_ptr<const CatalogIndex> fromCatalog(const std::shared_ptr<ICatalog>& catalog,
+                                                           const CatalogIndexOptions& options = {});
+
+
+    // catalog中各指纹的紧凑视图，下标同catalog
+    static std::vector<SignatureView> viewsOf(const ICatalog& catalog);
+
+    // 从指纹数据构建索引
+    explicit CatalogIndex(const std::vector<SignatureView>& signatures,
+                          const CatalogIndexOptions& options = {});
+
+    // 引用外部内存，不拷贝；holder负责保持外部内存的生命周期
+    CatalogIndex(const uint32_t* hashes,
+                 const uint32_t* offsets,
+                 const IndexPosting* postings,
+                 size_t hashCount,
+                 size_t postingCount,
+                 std::shared_ptr<const void> holder,
+                 const CatalogIndexOptions& options = {});
+
+    // 禁用拷贝构造和赋值，内部指针可能指向自身持有的数据
+    CatalogIndex(const CatalogIndex&) = delete;
+    CatalogIndex& operator=(const CatalogIndex&) = delete;
+
+    // 目录分片的索引：只收录下标对shardCount取模等于shardIndex的目标指纹，倒排记录中仍是catalog中的下标
+    // 在full中停用的哈希不收录，查找结果等于full的结果中属于本分片的部分，顺序不变
+    static std::shared_ptr<const CatalogIndex> partition(const std::vector<SignatureView>& signatures,
+                                                         const ICatalogIndex& full,
+                                                         size_t shardIndex, size_t shardCount);
+
+    // 在调用线程上把哈希、倒排记录、停用标记和位图复制到新分配的内存，查询结果与原索引完全相同
+    // 按首次访问分配物理页的系统上，在绑定到某个NUMA节点的线程上调用即得到该节点本地的副本
+    std::shared_ptr<const CatalogIndex> replicate() const;
+
+    // 查找哈希值对应的倒排记录，返回[begin, end)，未命中时begin == end
+    std::pair<const IndexPosting*, const IndexPosting*> find(uint32_t hash) const override;
+
+    // 通过位图的哈希每kLookupGroup个一组做无分支二分查找，组内的查找逐级交替推进，
+    // 每一级预取各自下一次比较的位置，多个缓存未命中同时在途；命中时预取倒排记录的开头
+    void findBatch(const uint32_t* hashes, size_t count,
+                   std::pair<const IndexPosting*, const IndexPosting*>* ranges) const override;
+
+    // 原始数组访问，用于序列化
+    const uint32_t* hashes() const { return hashes_; }
+    const uint32_t* offsets() const { return offsets_; }
+    const IndexPosting* postings() const { return postings_; }
+
+    size_t hashCount() const override { return hashCount_; }
+    size_t postingCount() const override { return postingCount_; }
+    bool empty() const override { return postingCount_ == 0; }
+
+    // 映射模式下哈希和倒排数组计入mappedBytes
+    IndexMemoryUsage memoryUsage() const override;
+
+    // 第i个唯一哈希的倒排记录数量和出现的目标指纹数量
+    size_t postingCountAt(size_t i) const { return offsets_[i + 1] - offsets_[i]; }
+    size_t documentFrequencyAt(size_t i) const;
+
+    // 停用哈希数量及其倒排记录数量
+    size_t stopHashCount() const { return stopHashCount_; }
+    size_t stopPostingCount() const { return stopPostingCount_; }
+
+    // 哈希统计文件后缀，统计文件与catalog文件放在一起
+    static constexpr const char* kStatisticsFileSuffix = ".hashstats";
+
+    // 把倒排记录长度统计写入文本文件（保存在catalog文件旁边，用于选择停用阈值）
+    bool writeStatistics(const std::string& filename, size_t topHashCount = 100) const;
+
+private:
+    CatalogIndex() = default;
+
+    // 占用位图的位数范围：至少4K位，最多2^24位（2MB，可放入L2/L3缓存）
+    static constexpr uint32_t kMinFilterBitsLog2 = 12;
+    static constexpr uint32_t kMaxFilterBitsLog2 = 24;
+    // 每个唯一哈希值占用的位数，对应约6%的误判率
+    static constexpr size_t kFilterBitsPerHash = 16;
+    // findBatch中交错推进的查找数
+    static constexpr size_t kLookupGroup = 16;
+
+    // 一组通过位图的哈希的交错二分查找，positions是它们在批中的下标
+    void findGroup(const uint32_t* hashes, const size_t* positions, size_t groupSize,
+                   std::pair<const IndexPosting*, const IndexPosting*>* ranges) const;
+
+    // 按选项标记停用哈希
+    void markStopHashes(const CatalogIndexOptions& options);
+
+    // 由唯一哈希数组构建占用位图，停用哈希不写入位图
+    void buildFilter();
+
+    // 哈希值在位图中的位置：先乘法散列打散结构化的哈希位（高位是锚点频率），再取高位
+    uint32_t filterSlot(uint32_t hash) const {
+        return (hash * 0x9E3779B1u) >> filterShift_;
+    }
+
+    // 自身持有的数据（构建模式）
+    std::vector<uint32_t> ownedHashes_;
+    std::vector<uint32_t> ownedOffsets_;
+    std::vector<IndexPosting> ownedPostings_;
+
+    // 外部内存持有者（映射模式）
+    std::shared_ptr<const void> holder_;
+
+    const uint32_t* hashes_ = nullptr;
+    const uint32_t* offsets_ = nullptr;        // 长度为hashCount_ + 1
+    const IndexPosting* postings_ = nullptr;
+    size_t hashCount_ = 0;
+    size_t postingCount_ = 0;
+
+    // 停用标记，未设置停用选项时为空
+    std::vector<uint8_t> stopHashes_;
+    size_t stopHashCount_ = 0;
+    size_t stopPostingCount_ = 0;
+
+    // 哈希占用位图
+    std::vector<uint64_t> filterWords_;
+    uint32_t filterShift_ = 32;
+};
+
+} // namespace afp
@@ -0,0 +1,29 @@
+#include "catalog/catalog_partition.h"
+#include "catalog/catalog.h"
+
+namespace afp {
+
+std::vector<std::shared_ptr<ICatalog>> CatalogPartition::partition(const ICatalog& catalog, size_t shardCount) {
+    std::vector<std::shared_ptr<ICatalog>> shards;
+    shards.reserve(shardCount);
+    for (size_t i = 0; i < shardCount; ++i) {
+        shards.push_back(std::make_shared<Catalog>());
+    }
+    if (shardCount == 0) {
+        return shards;
+    }
+
+    const auto& mediaItems = catalog.mediaItems();
+    std::vector<SignaturePoint> signature;
+    for (size_t i = 0; i < catalog.signatureCount(); ++i) {
+        // 逐条展开，点的顺序与catalog一致，分片中的pointIndex不变
+        signature.resize(catalog.signatureView(i).size());
+        for (size_t j = 0; j < signature.size(); ++j) {
+            signature[j] = catalog.signaturePoint(i, j);
+        }
+        shards[shardOf(static_cast<uint32_t>(i), shardCount)]->addSignature(signature, mediaItems[i]);
+    }
+    return shards;
+}
+
+} // namespace afp
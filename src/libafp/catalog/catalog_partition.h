@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "afp/icatalog.h"
+
+namespace afp {
+
+// 按目标指纹的全局id把catalog划分为若干分片
+// 全局id为g的指纹属于第g % shardCount个分片，在该分片catalog中的下标为g / shardCount；
+// 轮转划分使各分片的指纹数量最多相差1，分片内的下标顺序与全局id顺序一致
+class CatalogPartition {
+public:
+    static size_t shardOf(uint32_t signatureId, size_t shardCount) {
+        return signatureId % shardCount;
+    }
+
+    static size_t localIndexOf(uint32_t signatureId, size_t shardCount) {
+        return signatureId / shardCount;
+    }
+
+    static uint32_t signatureIdOf(size_t localIndex, size_t shardIndex, size_t shardCount) {
+        return static_cast<uint32_t>(localIndex * shardCount + shardIndex);
+    }
+
+    // 复制catalog的指纹和媒体信息，生成shardCount个分片catalog；shardCount为0时返回空
+    static std::vector<std::shared_ptr<ICatalog>> partition(const ICatalog& catalog, size_t shardCount);
+};
+
+} // namespace afp
@@ -0,0 +1,35 @@
+#include "afp/catalog_publisher.h"
+#include <iostream>
+#include "catalog/catalog_index.h"
+
+namespace afp {
+
+bool CatalogPublisher::publish(std::shared_ptr<ICatalog> catalog, std::shared_ptr<const ICatalogIndex> index) {
+    if (!catalog) {
+        std::cerr << "发布目录快照失败: catalog为空" << std::endl;
+        return false;
+    }
+
+    // 索引构建在发布方完成，匹配线程切换时不需要重建
+    if (!index) {
+        index = CatalogIndex::fromCatalog(catalog);
+    }
+
+    auto snapshot = std::make_shared<CatalogSnapshot>();
+    snapshot->catalog = std::move(catalog);
+    snapshot->index = std::move(index);
+    snapshot->version = nextVersion_++;
+
+    std::shared_ptr<const CatalogSnapshot> published = std::move(snapshot);
+    std::atomic_store(&snapshot_, published);
+
+    std::cout << "已发布目录快照 #" << published->version 
+              << " (指纹数量: " << published->catalog->signatureCount() << ")" << std::endl;
+    return true;
+}
+
+std::shared_ptr<const CatalogSnapshot> CatalogPublisher::current() const {
+    return std::atomic_load(&snapshot_);
+}
+
+} // namespace afp
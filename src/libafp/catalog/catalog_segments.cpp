@@ -0,0 +1,207 @@
+#include "catalog/catalog_segments.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include "catalog/catalog.h"
+#include "catalog/catalog_index.h"
+
+namespace fs = std::filesystem;
+
+namespace afp {
+
+CatalogSegments::CatalogSegments(const std::string& directory)
+    : directory_(directory) {
+}
+
+bool CatalogSegments::appendSegment(const ICatalog& catalog) const {
+    if (catalog.signatureCount() == 0) {
+        std::cerr << "没有需要追加的指纹" << std::endl;
+        return false;
+    }
+
+    std::error_code ec;
+    fs::create_directories(directory_, ec);
+    if (ec) {
+        std::cerr << "无法创建目录: " << directory_ << " (" << ec.message() << ")" << std::endl;
+        return false;
+    }
+
+    std::vector<std::string> segments;
+    if (!listSegments(segments)) {
+        return false;
+    }
+
+    // 先完整写出新段，再更新清单，中途失败不会影响已有的段
+    std::string segment = nextSegmentName(segments);
+    if (!catalog.saveToFile(segmentPath(segment))) {
+        std::cerr << "写入目录段失败: " << segment << std::endl;
+        return false;
+    }
+
+    segments.push_back(segment);
+    if (!writeManifest(segments)) {
+        removeSegment(segment, ec);
+        return false;
+    }
+
+    std::cout << "已追加目录段: " << segment << " (" << catalog.signatureCount()
+              << " 个指纹)，当前段数量: " << segments.size() << std::endl;
+    return true;
+}
+
+bool CatalogSegments::load(ICatalog& catalog) const {
+    std::vector<std::string> segments;
+    if (!listSegments(segments)) {
+        return false;
+    }
+
+    if (segments.empty()) {
+        std::cerr << "目录中没有任何段: " << directory_ << std::endl;
+        return false;
+    }
+
+    for (const auto& segment : segments) {
+        std::cout << "加载目录段: " << segment << std::endl;
+        if (!catalog.appendFromFile(segmentPath(segment))) {
+            std::cerr << "加载目录段失败: " << segment << std::endl;
+            return false;
+        }
+    }
+
+    std::cout << "已加载 " << segments.size() << " 个目录段，总计 "
+              << catalog.signatureCount() << " 个指纹" << std::endl;
+    return true;
+}
+
+bool CatalogSegments::compact(bool storeSideTables) const {
+    std::vector<std::string> segments;
+    if (!listSegments(segments)) {
+        return false;
+    }
+
+    if (segments.empty()) {
+        std::cerr << "目录中没有任何段: " << directory_ << std::endl;
+        return false;
+    }
+
+    Catalog merged;
+    if (!load(merged)) {
+        return false;
+    }
+    merged.setStoreSideTables(storeSideTables);
+
+    // 合并后的段重新写入紧凑编码和倒排索引段，加载时可直接映射索引
+    std::string segment = nextSegmentName(segments);
+    if (!merged.saveToFile(segmentPath(segment))) {
+        std::cerr << "写入合并后的目录段失败: " << segment << std::endl;
+        return false;
+    }
+
+    if (!writeManifest({segment})) {
+        std::error_code ec;
+        removeSegment(segment, ec);
+        return false;
+    }
+
+    // 清单切换完成后再删除旧段，已映射旧段的读取方不受影响
+    for (const auto& old_segment : segments) {
+        std::error_code ec;
+        removeSegment(old_segment, ec);
+        if (ec) {
+            std::cerr << "警告: 删除旧目录段失败: " << old_segment << " (" << ec.message() << ")" << std::endl;
+        }
+    }
+
+    std::cout << "已合并 " << segments.size() << " 个目录段为 " << segment
+              << "，总计 " << merged.signatureCount() << " 个指纹" << std::endl;
+    return true;
+}
+
+bool CatalogSegments::listSegments(std::vector<std::string>& segments) const {
+    segments.clear();
+
+    std::string manifest_path = segmentPath(kManifestFileName);
+    if (!fs::exists(manifest_path)) {
+        // 新目录尚无清单
+        return true;
+    }
+
+    std::ifstream file(manifest_path);
+    if (!file.is_open()) {
+        std::cerr << "无法打开清单文件: " << manifest_path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    if (!std::getline(file, line) || line != kManifestMagic) {
+        std::cerr << "清单文件格式错误: " << manifest_path << std::endl;
+        return false;
+    }
+
+    while (std::getline(file, line)) {
+        if (!line.empty()) {
+            segments.push_back(line);
+        }
+    }
+    return true;
+}
+
+bool CatalogSegments::writeManifest(const std::vector<std::string>& segments) const {
+    std::string manifest_path = segmentPath(kManifestFileName);
+    std::string temp_path = manifest_path + ".tmp";
+
+    {
+        std::ofstream file(temp_path, std::ios::trunc);
+        if (!file.is_open()) {
+            std::cerr << "无法写入清单文件: " << temp_path << std::endl;
+            return false;
+        }
+
+        file << kManifestMagic << "\n";
+        for (const auto& segment : segments) {
+            file << segment << "\n";
+        }
+
+        file.flush();
+        if (!file.good()) {
+            std::cerr << "写入清单文件失败: " << temp_path << std::endl;
+            return false;
+        }
+    }
+
+    // 重命名是原子操作，读取方看到的要么是旧清单要么是新清单
+    if (std::rename(temp_path.c_str(), manifest_path.c_str()) != 0) {
+        std::cerr << "替换清单文件失败: " << manifest_path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::string CatalogSegments::nextSegmentName(const std::vector<std::string>& segments) const {
+    // 段文件名为 segment_<序号>.afp，序号单调递增，合并后的段也使用新序号
+    unsigned int next_sequence = 0;
+    for (const auto& segment : segments) {
+        unsigned int sequence = 0;
+        if (std::sscanf(segment.c_str(), "segment_%u.afp", &sequence) == 1 && sequence >= next_sequence) {
+            next_sequence = sequence + 1;
+        }
+    }
+
+    char name[64];
+    std::snprintf(name, sizeof(name), "segment_%06u.afp", next_sequence);
+    return name;
+}
+
+void CatalogSegments::removeSegment(const std::string& segment, std::error_code& ec) const {
+    // 同时删除该段的哈希统计文件（如果生成过），不留下失效的统计
+    std::error_code sidecar_ec;
+    fs::remove(segmentPath(segment) + CatalogIndex::kStatisticsFileSuffix, sidecar_ec);
+    fs::remove(segmentPath(segment), ec);
+}
+
+std::string CatalogSegments::segmentPath(const std::string& segment) const {
+    return (fs::path(directory_) / segment).string();
+}
+
+} // namespace afp
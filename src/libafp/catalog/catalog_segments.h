@@ -0,0 +1,48 @@
+#pragma once
+#include <string>
+#include <system_error>
+#include <vector>
+#include "afp/icatalog.h"
+
+namespace afp {
+
+// 分段存储的指纹目录
+// 目录是一个文件夹，包含若干独立的段文件（每个段都是完整的catalog文件）和一个清单文件，
+// 清单按顺序列出当前有效的段。新增内容只写入一个新段并更新清单，写入开销只与新增内容大小有关；
+// 读取时按清单顺序把所有段追加加载到一个catalog中；合并(compact)把所有段重写为一个段。
+// 清单通过写临时文件再重命名的方式原子替换，读取方始终看到完整的段列表。
+// 同一时间只允许一个写入方（追加或合并），读取方可以与写入方并发。
+class CatalogSegments {
+public:
+    explicit CatalogSegments(const std::string& directory);
+
+    // 把catalog的内容写为一个新段并追加到清单末尾
+    bool appendSegment(const ICatalog& catalog) const;
+
+    // 按清单顺序加载所有段，追加到catalog现有内容之后
+    bool load(ICatalog& catalog) const;
+
+    // 把所有段合并为一个段，storeSideTables为false时合并后的段不保存频率/振幅附表
+    bool compact(bool storeSideTables = true) const;
+
+    // 读取清单中的段文件名（相对目录）
+    bool listSegments(std::vector<std::string>& segments) const;
+
+    const std::string& directory() const { return directory_; }
+
+private:
+    // 清单文件名及首行标识
+    static constexpr const char* kManifestFileName = "MANIFEST";
+    static constexpr const char* kManifestMagic = "AFPSEGMENTS 1";
+
+    bool writeManifest(const std::vector<std::string>& segments) const;
+    std::string nextSegmentName(const std::vector<std::string>& segments) const;
+    // 删除段文件及其统计文件，ec为删除段文件的结果
+    void removeSegment(const std::string& segment, std::error_code& ec) const;
+    std::string segmentPath(const std::string& segment) const;
+
+private:
+    std::string directory_;
+};
+
+} // namespace afp
@@ -0,0 +1,230 @@
+#include "packed_signature.h"
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+namespace afp {
+
+namespace {
+
+// 附表标志位
+constexpr uint8_t kFlagSideTables = 0x01;
+
+void writeVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+bool readVarint(const uint8_t*& cursor, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (cursor >= end) {
+            return false;
+        }
+        const uint8_t byte = *cursor++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t zigzagEncode(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t zigzagDecode(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// 依次读取count个频率和count个振幅
+bool readSideTables(const uint8_t*& cursor, const uint8_t* end, size_t count,
+                    std::vector<uint32_t>& frequencies, std::vector<uint32_t>& amplitudes) {
+    frequencies.resize(count);
+    amplitudes.resize(count);
+    for (auto* table : {&frequencies, &amplitudes}) {
+        for (size_t i = 0; i < count; ++i) {
+            uint64_t value = 0;
+            if (!readVarint(cursor, end, value) || value > UINT32_MAX) {
+                return false;
+            }
+            (*table)[i] = static_cast<uint32_t>(value);
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+PackedSignature PackedSignature::pack(const std::vector<SignaturePoint>& signature, bool keepSideTables,
+                                      bool sortByHash) {
+    PackedSignature packed;
+    packed.hasSideTables_ = keepSideTables;
+
+    // 去重时间戳表
+    packed.timestamps_.reserve(signature.size());
+    for (const auto& point : signature) {
+        packed.timestamps_.push_back(point.timestamp);
+    }
+    std::sort(packed.timestamps_.begin(), packed.timestamps_.end());
+    packed.timestamps_.erase(std::unique(packed.timestamps_.begin(), packed.timestamps_.end()),
+                             packed.timestamps_.end());
+    packed.timestamps_.shrink_to_fit();
+
+    // 按哈希稳定排序，同一哈希内保持原有顺序
+    std::vector<uint32_t> order(signature.size());
+    std::iota(order.begin(), order.end(), 0);
+    if (sortByHash) {
+        std::stable_sort(order.begin(), order.end(), [&signature](uint32_t a, uint32_t b) {
+            return signature[a].hash < signature[b].hash;
+        });
+    }
+
+    packed.hashes_.reserve(signature.size());
+    packed.timeIndices_.reserve(signature.size());
+    if (keepSideTables) {
+        packed.frequencies_.reserve(signature.size());
+        packed.amplitudes_.reserve(signature.size());
+    }
+    for (const auto i : order) {
+        const auto& point = signature[i];
+        const auto timeIt = std::lower_bound(packed.timestamps_.begin(), packed.timestamps_.end(), point.timestamp);
+        packed.hashes_.push_back(point.hash);
+        packed.timeIndices_.push_back(static_cast<uint32_t>(timeIt - packed.timestamps_.begin()));
+        if (keepSideTables) {
+            packed.frequencies_.push_back(point.frequency);
+            packed.amplitudes_.push_back(point.amplitude);
+        }
+    }
+
+    return packed;
+}
+
+SignatureView PackedSignature::view() const {
+    return SignatureView{hashes_.data(), timeIndices_.data(), timestamps_.data(), hashes_.size()};
+}
+
+bool PackedSignature::decodeSideTables(std::vector<uint32_t>& frequencies, std::vector<uint32_t>& amplitudes) const {
+    if (sideTablesDecoded()) {
+        frequencies = frequencies_;
+        amplitudes = amplitudes_;
+        return true;
+    }
+    const uint8_t* cursor = deferredSideTables_;
+    return readSideTables(cursor, deferredSideTables_ + deferredSideTablesSize_, size(), frequencies, amplitudes);
+}
+
+void PackedSignature::encode(std::vector<uint8_t>& out) const {
+    out.clear();
+    out.reserve(size() * (hasSideTables_ ? 10 : 5) + timestamps_.size() * sizeof(double) + 16);
+
+    writeVarint(out, size());
+    out.push_back(hasSideTables_ ? kFlagSideTables : 0);
+
+    // 时间戳表按原始double存储，保证还原后逐位一致
+    writeVarint(out, timestamps_.size());
+    const size_t tableOffset = out.size();
+    out.resize(tableOffset + timestamps_.size() * sizeof(double));
+    if (!timestamps_.empty()) {
+        std::memcpy(out.data() + tableOffset, timestamps_.data(), timestamps_.size() * sizeof(double));
+    }
+
+    // 哈希已排序，差分非负；时间戳下标差分可能为负，使用zigzag
+    uint32_t prevHash = 0;
+    int64_t prevTimeIndex = 0;
+    for (size_t i = 0; i < size(); ++i) {
+        writeVarint(out, hashes_[i] - prevHash);
+        writeVarint(out, zigzagEncode(static_cast<int64_t>(timeIndices_[i]) - prevTimeIndex));
+        prevHash = hashes_[i];
+        prevTimeIndex = timeIndices_[i];
+    }
+
+    if (hasSideTables_) {
+        for (const auto frequency : frequencies_) {
+            writeVarint(out, frequency);
+        }
+        for (const auto amplitude : amplitudes_) {
+            writeVarint(out, amplitude);
+        }
+    }
+}
+
+bool PackedSignature::decode(const uint8_t* data, size_t size, PackedSignature& packed, bool decodeSideTables) {
+    const uint8_t* cursor = data;
+    const uint8_t* end = data + size;
+
+    uint64_t pointCount = 0;
+    if (!readVarint(cursor, end, pointCount) || cursor >= end) {
+        return false;
+    }
+    // 每个点至少占2字节，用于拒绝损坏的长度
+    if (pointCount > size / 2) {
+        return false;
+    }
+    const uint8_t flags = *cursor++;
+
+    uint64_t timestampCount = 0;
+    if (!readVarint(cursor, end, timestampCount)) {
+        return false;
+    }
+    if (timestampCount > static_cast<uint64_t>(end - cursor) / sizeof(double)) {
+        return false;
+    }
+
+    packed = PackedSignature();
+    packed.hasSideTables_ = (flags & kFlagSideTables) != 0;
+    packed.timestamps_.resize(timestampCount);
+    if (timestampCount > 0) {
+        std::memcpy(packed.timestamps_.data(), cursor, timestampCount * sizeof(double));
+    }
+    cursor += timestampCount * sizeof(double);
+
+    packed.hashes_.resize(pointCount);
+    packed.timeIndices_.resize(pointCount);
+    uint64_t hash = 0;
+    int64_t timeIndex = 0;
+    for (size_t i = 0; i < pointCount; ++i) {
+        uint64_t hashDelta = 0;
+        uint64_t timeDelta = 0;
+        if (!readVarint(cursor, end, hashDelta) || !readVarint(cursor, end, timeDelta)) {
+            return false;
+        }
+        hash += hashDelta;
+        timeIndex += zigzagDecode(timeDelta);
+        if (hash > UINT32_MAX || timeIndex < 0 || static_cast<uint64_t>(timeIndex) >= timestampCount) {
+            return false;
+        }
+        packed.hashes_[i] = static_cast<uint32_t>(hash);
+        packed.timeIndices_[i] = static_cast<uint32_t>(timeIndex);
+    }
+
+    if (packed.hasSideTables_) {
+        if (decodeSideTables) {
+            if (!readSideTables(cursor, end, pointCount, packed.frequencies_, packed.amplitudes_)) {
+                return false;
+            }
+        } else {
+            // 附表是指纹的剩余部分，每个值至少1字节
+            if (static_cast<uint64_t>(end - cursor) < 2 * pointCount) {
+                return false;
+            }
+            packed.deferredSideTables_ = cursor;
+            packed.deferredSideTablesSize_ = static_cast<size_t>(end - cursor);
+            cursor = end;
+        }
+    }
+
+    return cursor == end;
+}
+
+size_t PackedSignature::memoryUsage() const {
+    return timestamps_.capacity() * sizeof(double) +
+           (hashes_.capacity() + timeIndices_.capacity() +
+            frequencies_.capacity() + amplitudes_.capacity()) * sizeof(uint32_t);
+}
+
+} // namespace afp
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "afp/icatalog.h"
+#include "afp/isignature_generator.h"
+
+namespace afp {
+
+// 紧凑的指纹表示（SoA），既是catalog文件v3的条目编码，也是catalog在内存中的指纹表示
+// 时间戳不逐点存储double，而是存储到去重时间戳表中的下标
+// （同一锚点帧生成的指纹点共享时间戳，去重后的表远小于点数，且还原结果与原始值逐位一致）
+// 频率/振幅只用于调试和可视化，作为可选附表存储；从文件解码时可以暂不解码附表，只记录其在编码数据中的位置
+class PackedSignature {
+public:
+    PackedSignature() = default;
+
+    // 打包指纹，keepSideTables为false时丢弃频率/振幅
+    // sortByHash为true时指纹点按哈希稳定排序（文件编码要求）；为false时保持原有顺序，点的下标不变
+    static PackedSignature pack(const std::vector<SignaturePoint>& signature, bool keepSideTables = true,
+                                bool sortByHash = true);
+
+    // 获取单个指纹点信息
+    size_t size() const { return hashes_.size(); }
+    uint32_t hash(size_t i) const { return hashes_[i]; }
+    double timestamp(size_t i) const { return timestamps_[timeIndices_[i]]; }
+
+    // 哈希和时间戳的只读视图，指向本对象的数据
+    SignatureView view() const;
+
+    // 是否包含频率/振幅附表（含尚未解码的附表）
+    bool hasSideTables() const { return hasSideTables_; }
+
+    // 附表是否已解码到内存；为false且hasSideTables()时用decodeSideTables按需解码
+    bool sideTablesDecoded() const { return !hasSideTables_ || deferredSideTables_ == nullptr; }
+
+    // 已解码的附表，sideTablesDecoded()为true时才可访问
+    uint32_t frequency(size_t i) const { return hasSideTables_ ? frequencies_[i] : 0; }
+    uint32_t amplitude(size_t i) const { return hasSideTables_ ? amplitudes_[i] : 0; }
+
+    // 从编码数据中解码延迟的附表，不修改本对象；编码数据必须仍然有效
+    bool decodeSideTables(std::vector<uint32_t>& frequencies, std::vector<uint32_t>& amplitudes) const;
+
+    // 序列化为变长编码：哈希差分varint + 时间戳下标zigzag差分varint + 可选附表varint
+    // 要求指纹点按哈希排序（pack的sortByHash为true）且附表已解码
+    void encode(std::vector<uint8_t>& out) const;
+
+    // 从变长编码还原，数据不完整或不合法时返回false
+    // decodeSideTables为false时只校验附表的长度而不解码，之后由decodeSideTables按需解码，调用方需保持data有效
+    static bool decode(const uint8_t* data, size_t size, PackedSignature& packed, bool decodeSideTables = true);
+
+    // 内存占用（字节），不含延迟附表的编码数据
+    size_t memoryUsage() const;
+
+private:
+    std::vector<double> timestamps_;     // 去重并升序排列的时间戳表
+    std::vector<uint32_t> hashes_;
+    std::vector<uint32_t> timeIndices_;  // 指向timestamps_的下标
+    std::vector<uint32_t> frequencies_;  // 可选附表：频率
+    std::vector<uint32_t> amplitudes_;   // 可选附表：振幅
+    bool hasSideTables_ = false;
+    const uint8_t* deferredSideTables_ = nullptr;   // 尚未解码的附表编码数据
+    size_t deferredSideTablesSize_ = 0;
+};
+
+} // namespace afp
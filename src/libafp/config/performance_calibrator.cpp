@@ -0,0 +1,190 @@
+#include "config/performance_calibrator.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include "signature_generation_pipeline/signature_generation_pipeline.h"
+
+namespace afp {
+
+namespace {
+
+constexpr const char* kCacheMagic = "AFP-CALIBRATION-1";
+constexpr double kBenchmarkSeconds = 3.0;       // 每次测试的音频时长
+constexpr double kChunkSeconds = 0.1;           // 每次输入的音频时长，与实时流的输入粒度相近
+constexpr int kBenchmarkRuns = 2;
+
+// 参与调优的匹配配置；生成配置用于离线建库，不按实时性选择
+constexpr PlatformType kCandidates[] = {PlatformType::Mobile, PlatformType::Desktop, PlatformType::Server};
+
+} // namespace
+
+PerformanceCalibrator::PerformanceCalibrator(const CalibrationRequest& request, const PerformanceConfigOptions& options)
+    : request_(request)
+    , options_(options) {
+    // 测量配置全量处理的实时率，测试中途降级会使结果偏低
+    options_.adaptiveDegradation = false;
+    request_.streamCount = std::max<size_t>(1, request_.streamCount);
+    request_.channels = std::max<uint32_t>(1, request_.channels);
+}
+
+CalibrationResult PerformanceCalibrator::run() {
+    CalibrationResult result;
+    if (!request_.cachePath.empty() && loadCache(result)) {
+        return result;
+    }
+
+    std::vector<Measurement> measurements;
+    for (PlatformType platform : kCandidates) {
+        measurements.push_back(Measurement{platform, measure(platform)});
+    }
+    result = select(std::move(measurements));
+
+    if (!request_.cachePath.empty()) {
+        saveCache(result);
+    }
+    return result;
+}
+
+double PerformanceCalibrator::measure(PlatformType platform) const {
+    const auto config = PerformanceConfigFactory::getConfig(platform, options_);
+    const auto format = std::make_shared<PCMFormat>(request_.sampleRate, SampleFormat::S16, request_.channels, Endianness::Little,
+        request_.channels == 1 ? ChannelLayout::Mono : ChannelLayout::Stereo);
+    const std::vector<int16_t> audio = synthesizeAudio();
+    const size_t chunk_samples = static_cast<size_t>(kChunkSeconds * request_.sampleRate) * request_.channels;
+
+    double best_seconds = 0.0;
+    for (int run = 0; run < kBenchmarkRuns; ++run) {
+        SignatureGenerationPipeline pipeline(config, format, [](const std::vector<SignaturePoint>&) {});
+        VisualizationConfig visualization_config;
+        pipeline.attachVisualizationConfig(&visualization_config);
+        // 测量的是配置本身的开销，不能让降级改变工作量
+        pipeline.disableDegradation();
+
+        const auto start_time = std::chrono::steady_clock::now();
+        double timestamp = 0.0;
+        for (size_t offset = 0; offset < audio.size(); offset += chunk_samples) {
+            const size_t count = std::min(chunk_samples, audio.size() - offset);
+            pipeline.appendStreamBuffer(audio.data() + offset, count * sizeof(int16_t), timestamp);
+            timestamp += static_cast<double>(count / request_.channels) / request_.sampleRate;
+        }
+        pipeline.flush();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+
+        if (run == 0 || elapsed.count() < best_seconds) {
+            best_seconds = elapsed.count();
+        }
+    }
+
+    return best_seconds / kBenchmarkSeconds;
+}
+
+std::vector<int16_t> PerformanceCalibrator::synthesizeAudio() const {
+    // 两个调频的音调加上固定种子的噪声，频谱中有持续变化的峰值，峰值检测和hash计算的工作量接近真实音乐
+    const size_t frame_count = static_cast<size_t>(kBenchmarkSeconds * request_.sampleRate);
+    std::vector<int16_t> audio(frame_count * request_.channels);
+    uint32_t noise_state = 0x12345678u;
+    for (size_t i = 0; i < frame_count; ++i) {
+        const double t = static_cast<double>(i) / request_.sampleRate;
+        for (uint32_t channel = 0; channel < request_.channels; ++channel) {
+            noise_state = noise_state * 1664525u + 1013904223u;
+            const double noise = (static_cast<double>(noise_state >> 8) / (1u << 24) - 0.5) * 4000.0;
+            const double tone1 = 6000.0 * std::sin(2.0 * M_PI * (440.0 + 100.0 * channel + 200.0 * std::sin(t)) * t);
+            const double tone2 = 4000.0 * std::sin(2.0 * M_PI * (1234.0 + 50.0 * channel) * t * (1.0 + 0.1 * std::sin(3.0 * t)));
+            audio[i * request_.channels + channel] = static_cast<int16_t>(std::max(-32000.0, std::min(32000.0, tone1 + tone2 + noise)));
+        }
+    }
+    return audio;
+}
+
+CalibrationResult PerformanceCalibrator::select(std::vector<Measurement> measurements) const {
+    // 实测开销越大的配置分析越密集，按开销从大到小选第一个满足要求的
+    std::sort(measurements.begin(), measurements.end(), [](const Measurement& a, const Measurement& b) {
+        return a.realtimeFactor > b.realtimeFactor;
+    });
+
+    CalibrationResult result;
+    const Measurement* chosen = &measurements.back();
+    for (const auto& measurement : measurements) {
+        if (measurement.realtimeFactor * request_.streamCount <= request_.targetRealtimeFactor) {
+            chosen = &measurement;
+            break;
+        }
+    }
+    result.platform = chosen->platform;
+    result.realtimeFactor = chosen->realtimeFactor;
+    result.fromCache = false;
+    return result;
+}
+
+std::string PerformanceCalibrator::cacheKey() const {
+    std::ostringstream key;
+    key << "target=" << request_.targetRealtimeFactor
+        << " streams=" << request_.streamCount
+        << " rate=" << request_.sampleRate
+        << " channels=" << request_.channels
+        << " decimation=" << options_.enableDecimation
+        << " latency_budget=" << options_.streamingLatencyBudgetMs
+        << " threads=" << std::thread::hardware_concurrency();
+    return key.str();
+}
+
+bool PerformanceCalibrator::loadCache(CalibrationResult& result) const {
+    std::ifstream file(request_.cachePath);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::string magic;
+    std::string key;
+    if (!std::getline(file, magic) || magic != kCacheMagic ||
+        !std::getline(file, key) || key != cacheKey()) {
+        return false;
+    }
+
+    int platform = 0;
+    double realtime_factor = 0.0;
+    if (!(file >> platform >> realtime_factor)) {
+        return false;
+    }
+    if (std::find(std::begin(kCandidates), std::end(kCandidates), static_cast<PlatformType>(platform)) == std::end(kCandidates)) {
+        return false;
+    }
+
+    result.platform = static_cast<PlatformType>(platform);
+    result.realtimeFactor = realtime_factor;
+    result.fromCache = true;
+    return true;
+}
+
+void PerformanceCalibrator::saveCache(const CalibrationResult& result) const {
+    const std::string temp_path = request_.cachePath + ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::trunc);
+        if (!file.is_open()) {
+            std::cerr << "无法写入校准缓存: " << temp_path << std::endl;
+            return;
+        }
+
+        file << kCacheMagic << "\n"
+             << cacheKey() << "\n"
+             << static_cast<int>(result.platform) << " " << result.realtimeFactor << "\n";
+
+        file.flush();
+        if (!file.good()) {
+            std::cerr << "写入校准缓存失败: " << temp_path << std::endl;
+            return;
+        }
+    }
+
+    // 重命名是原子操作，并发启动的进程读到的要么是旧缓存要么是新缓存
+    if (std::rename(temp_path.c_str(), request_.cachePath.c_str()) != 0) {
+        std::cerr << "替换校准缓存失败: " << request_.cachePath << std::endl;
+    }
+}
+
+} // namespace afp
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "afp/performance_config_factory.h"
+
+namespace afp {
+
+// 硬件自动调优的实现：基准测试各候选配置，按实测实时率选择，并读写缓存文件
+class PerformanceCalibrator {
+public:
+    PerformanceCalibrator(const CalibrationRequest& request, const PerformanceConfigOptions& options);
+
+    CalibrationResult run();
+
+private:
+    struct Measurement {
+        PlatformType platform;
+        double realtimeFactor;      // 单个流的处理时间与音频时长之比
+    };
+
+    // 用合成音频测量一个配置的实时率，取多次运行的最小值以排除调度抖动
+    double measure(PlatformType platform) const;
+
+    // 生成基准测试用的合成音频（S16交错），内容固定，保证各次测试的工作量相同
+    std::vector<int16_t> synthesizeAudio() const;
+
+    // 从测量结果中选择满足要求的处理量最大的配置
+    CalibrationResult select(std::vector<Measurement> measurements) const;
+
+    // 缓存的键：请求参数和CPU线程数，任何一项变化都需要重新测试
+    std::string cacheKey() const;
+    bool loadCache(CalibrationResult& result) const;
+    void saveCache(const CalibrationResult& result) const;
+
+    CalibrationRequest request_;
+    PerformanceConfigOptions options_;  // 基准测试使用的配置选项，自适应降级始终关闭
+};
+
+} // namespace afp
@@ -1,25 +1,57 @@
 #include "afp/performance_config_factory.h"
 #include "performance_config.h"
+#include "performance_calibrator.h"
 
 namespace afp {
 
-std::shared_ptr<IPerformanceConfig> PerformanceConfigFactory::getConfig(PlatformType platform) {
+std::shared_ptr<IPerformanceConfig> PerformanceConfigFactory::getConfig(PlatformType platform,
+                                                                        const PerformanceConfigOptions& options) {
+    std::shared_ptr<IPerformanceConfig> config;
     switch (platform) {
         case PlatformType::Mobile:
-            return createMobileConfig();
+            config = createMobileConfig();
+            break;
         case PlatformType::Desktop:
-            return createDesktopConfig();
+            config = createDesktopConfig();
+            break;
         case PlatformType::Server:
-            return createServerConfig();
+            config = createServerConfig();
+            break;
         case PlatformType::Mobile_Gen:
-            return createMobileGenConfig();
+            config = createMobileGenConfig();
+            break;
         case PlatformType::Desktop_Gen:
-            return createDesktopGenConfig();
+            config = createDesktopGenConfig();
+            break;
         case PlatformType::Server_Gen:
-            return createServerGenConfig();
+            config = createServerGenConfig();
+            break;
+        case PlatformType::Mobile_LowEnd:
+            config = createMobileLowEndConfig();
+            break;
         default:
-            return createDesktopConfig();
+            config = createDesktopConfig();
+            break;
     }
+
+    auto& concrete = static_cast<PerformanceConfig&>(*config);
+    concrete.fftConfig_.enableDecimation = options.enableDecimation;
+    if (!options.adaptiveDegradation) {
+        concrete.signatureGenerationConfig_.targetRealtimeFactor = 0.0;
+    }
+    if (options.streamingLatencyBudgetMs > 0.0) {
+        concrete.signatureGenerationConfig_.streamingLatencyBudgetMs = options.streamingLatencyBudgetMs;
+    }
+    return config;
+}
+
+std::shared_ptr<IPerformanceConfig> PerformanceConfigFactory::calibrate(const CalibrationRequest& request, CalibrationResult* result,
+                                                                        const PerformanceConfigOptions& options) {
+    const CalibrationResult calibration = PerformanceCalibrator(request, options).run();
+    if (result) {
+        *result = calibration;
+    }
+    return getConfig(calibration.platform, options);
 }
 
 std::shared_ptr<IPerformanceConfig> PerformanceConfigFactory::createMobileConfig() {
@@ -28,6 +60,11 @@ std::shared_ptr<IPerformanceConfig> PerformanceConfigFactory::createMobileConfig
     // FFT配置 - 移动端使用较小的窗口以节省内存和计算资源
     config->fftConfig_.fftSize = 4096;    // 较小的FFT窗口
     config->fftConfig_.hopSize = 441;     // 0.01秒/帧 (44.1kHz采样率下约为441样本)
+    config->fftConfig_.enableDecimation = false; // 不降采样，见PerformanceConfigOptions::enableDecimation
+    config->fftConfig_.fastLogMagnitude = true;  // 向量化的功率域对数幅度
+    config->fftConfig_.silenceGateRms = 1e-4f;   // 约-80dBFS以下视为静音
+    config->fftConfig_.fixedPointFft = false;    // 浮点FFT
+    config->fftConfig_.magnitudeQuantizationBits = 0;  // 不量化幅度
     
     // 峰值检测配置 - 针对每帧3-5个峰值的要求优化
     config->peakDetectionConfig_.localMaxRange = 5;        // 较小的本地最大值范围
@@ -59,6 +96,8 @@ std::shared_ptr<IPerformanceConfig> PerformanceConfigFactory::createMobileConfig
     
     // 扩展三帧选取配置 - 移动端
     config->signatureGenerationConfig_.symmetricFrameRange = 2;    // 移动端对称范围2，生成(x-2,x,x+2)到(x-1,x,x+1)
+    config->signatureGenerationConfig_.streamingLatencyBudgetMs = 0.0; // 关闭低延迟流式模式
+    config->signatureGenerationConfig_.targetRealtimeFactor = 0.8;      // 处理时间超过音频时长的80%时逐级降级
     
     // 匹配配置 - 移动端使用较严格的参数以减少内存使用
     config->matchingConfig_.maxCandidates = 200;            // 较少的候选结果
@@ -68,6 +107,11 @@ std::shared_ptr<IPerformanceConfig> PerformanceConfigFactory::createMobileConfig
     config->matchingConfig_.minMatchesRequired = 5;       // 减少最小匹配点数要求
     config->matchingConfig_.minMatchesUniqueTimestampRequired = 3; // 移动端至少3个不同时间戳
     config->matchingConfig_.offsetTolerance = 0.1;        // 较大的时间偏移容忍度
+    config->matchingConfig_.maxHashDocumentFrequency = 500;  // 出现在超过500个目标指纹中的哈希作为停用哈希
+    config->matchingConfig_.maxPostingsPerHash = 2048;       // 倒排记录超过2048条的哈希作为停用哈希
+    config->matchingConfig_.coarseVoteTopMedia = 32;          // 每批只有得票最高的32个目标指纹进入session匹配
+    config->matchingConfig_.coarseVoteBucketMs = 250;        // 粗偏移桶宽250ms，计票时合并相邻两个桶
+    config->matchingConfig_.materializeMatchedPoints = true;   // 匹配结果中直接生成matchedPoints
     
     return config;
 }
@@ -79,6 +123,11 @@ std::shared_ptr<IPerformanceConfig> PerformanceConfigFactory::createMobileGenCon
     // FFT配置 - 生成模式使用更大的窗口以获得更好的频率分辨率
     config->fftConfig_.fftSize = 4096;    // 增大FFT窗口提高频率分辨率
     config->fftConfig_.hopSize = 441;     // 更密集的分析
+    config->fftConfig_.enableDecimation = false; // 不降采样，见PerformanceConfigOptions::enableDecimation
+    config->fftConfig_.fastLogMagnitude = true;  // 向量化的功率域对数幅度
+    config->fftConfig_.silenceGateRms = 1e-4f;   // 约-80dBFS以下视为静音
+    config->fftConfig_.fixedPointFft = false;    // 浮点FFT
+    config->fftConfig_.magnitudeQuantizationBits = 0;  // 不量化幅度
     
     // 峰值检测配置 - 生成模式优先精度，使用更严格的参数
     config->peakDetectionConfig_.localMaxRange = 5;        // 更大的本地最大值范围
@@ -110,6 +159,8 @@ std::shared_ptr<IPerformanceConfig> PerformanceConfigFactory::createMobileGenCon
     
     // 扩展三帧选取配置 - 生成模式使用更大范围
     config->signatureGenerationConfig_.symmetricFrameRange = 2;    // 扩大对称范围
+    config->signatureGenerationConfig_.streamingLatencyBudgetMs = 0.0; // 关闭低延迟流式模式
+    config->signatureGenerationConfig_.targetRealtimeFactor = 0.0;      // 离线生成指纹库，不降级
     
     // 匹配配置 - 生成模式不直接用于匹配，但保持合理设置
     config->matchingConfig_.maxCandidates = 200;            // 较少的候选结果
@@ -119,16 +170,35 @@ std::shared_ptr<IPerformanceConfig> PerformanceConfigFactory::createMobileGenCon
     config->matchingConfig_.minMatchesRequired = 5;       // 减少最小匹配点数要求
     config->matchingConfig_.minMatchesUniqueTimestampRequired = 3; // 移动端至少3个不同时间戳
     config->matchingConfig_.offsetTolerance = 0.1;        // 较大的时间偏移容忍度
+    config->matchingConfig_.maxHashDocumentFrequency = 500;  // 出现在超过500个目标指纹中的哈希作为停用哈希
+    config->matchingConfig_.maxPostingsPerHash = 2048;       // 倒排记录超过2048条的哈希作为停用哈希
+    config->matchingConfig_.coarseVoteTopMedia = 32;          // 每批只有得票最高的32个目标指纹进入session匹配
+    config->matchingConfig_.coarseVoteBucketMs = 250;        // 粗偏移桶宽250ms，计票时合并相邻两个桶
+    config->matchingConfig_.materializeMatchedPoints = true;   // 匹配结果中直接生成matchedPoints
     
     return config;
 }
 
+std::shared_ptr<IPerformanceConfig> PerformanceConfigFactory::createMobileLowEndConfig() {
+    // 在移动端匹配配置的基础上只改频谱的数值表示，峰值检测、指纹生成和匹配参数不变，仍与Mobile_Gen的目录匹配
+    const auto mobile = createMobileConfig();
+    auto config = std::unique_ptr<PerformanceConfig>(new PerformanceConfig(static_cast<const PerformanceConfig&>(*mobile)));
+    config->fftConfig_.fixedPointFft = true;            // Q15块浮点FFT
+    config->fftConfig_.magnitudeQuantizationBits = 16;  // 1/256dB步长，幅度可存为uint16
+    return config;
+}
+
 std::shared_ptr<IPerformanceConfig> PerformanceConfigFactory::createDesktopConfig() {
     auto config = std::unique_ptr<PerformanceConfig>(new PerformanceConfig());
     
     // FFT配置 - PC端使用中等大小的窗口
     config->fftConfig_.fftSize = 2048;    // 中等FFT窗口
     config->fftConfig_.hopSize = 512;     // 中等帧移
+    config->fftConfig_.enableDecimation = false; // 不降采样，见PerformanceConfigOptions::enableDecimation
+    config->fftConfig_.fastLogMagnitude = true;  // 向量化的功率域对数幅度
+    config->fftConfig_.silenceGateRms = 1e-4f;   // 约-80dBFS以下视为静音
+    config->fftConfig_.fixedPointFft = false;    // 浮点FFT
+    config->fftConfig_.magnitudeQuantizationBits = 0;  // 不量化幅度
     
     // 峰值检测配置 - PC端使用中等参数
     config->peakDetectionConfig_.localMaxRange = 3;        // 中等本地最大值范围
@@ -160,6 +230,8 @@ std::shared_ptr<IPerformanceConfig> PerformanceConfigFactory::createDesktopConfi
     
     // 扩展三帧选取配置 - 桌面端
     config->signatureGenerationConfig_.symmetricFrameRange = 3;    // 桌面端对称范围3，生成(x-3,x,x+3)到(x-1,x,x+1)
+    config->signatureGenerationConfig_.streamingLatencyBudgetMs = 0.0; // 关闭低延迟流式模式
+    config->signatureGenerationConfig_.targetRealtimeFactor = 0.8;      // 处理时间超过音频时长的80%时逐级降级
     
     // 匹配配置 - PC端使用中等参数
     config->matchingConfig_.maxCandidates = 50;            // 中等候选结果数
@@ -169,6 +241,11 @@ std::shared_ptr<IPerformanceConfig> PerformanceConfigFactory::createDesktopConfi
     config->matchingConfig_.minMatchesRequired = 15;       // 中等最小匹配点数
     config->matchingConfig_.minMatchesUniqueTimestampRequired = 8; // 桌面端至少8个不同时间戳
     config->matchingConfig_.offsetTolerance = 0.1;         // 中等时间偏移容忍度
+    config->matchingConfig_.maxHashDocumentFrequency = 1000;  // 出现在超过1000个目标指纹中的哈希作为停用哈希
+    config->matchingConfig_.maxPostingsPerHash = 4096;       // 倒排记录超过4096条的哈希作为停用哈希
+    config->matchingConfig_.coarseVoteTopMedia = 64;          // 每批只有得票最高的64个目标指纹进入session匹配
+    config->matchingConfig_.coarseVoteBucketMs = 250;        // 粗偏移桶宽250ms，计票时合并相邻两个桶
+    config->matchingConfig_.materializeMatchedPoints = true;   // 匹配结果中直接生成matchedPoints
     
     return config;
 }
@@ -179,6 +256,11 @@ std::shared_ptr<IPerformanceConfig> PerformanceConfigFactory::createServerConfig
     // FFT配置 - 服务器端使用较大的窗口以获得更好的频率分辨率
     config->fftConfig_.fftSize = 4096;    // 较大的FFT窗口
     config->fftConfig_.hopSize = 1024;    // 较大的帧移
+    config->fftConfig_.enableDecimation = false; // 不降采样，见PerformanceConfigOptions::enableDecimation
+    config->fftConfig_.fastLogMagnitude = true;  // 向量化的功率域对数幅度
+    config->fftConfig_.silenceGateRms = 1e-4f;   // 约-80dBFS以下视为静音
+    config->fftConfig_.fixedPointFft = false;    // 浮点FFT
+    config->fftConfig_.magnitudeQuantizationBits = 0;  // 不量化幅度
     
     // 峰值检测配置 - 服务器端使用较严格的参数
     config->peakDetectionConfig_.localMaxRange = 4;        // 较大的本地最大值范围
@@ -210,6 +292,8 @@ std::shared_ptr<IPerformanceConfig> PerformanceConfigFactory::createServerConfig
     
     // 扩展三帧选取配置 - 服务器端
     config->signatureGenerationConfig_.symmetricFrameRange = 4;    // 服务器端对称范围4，生成(x-4,x,x+4)到(x-1,x,x+1)
+    config->signatureGenerationConfig_.streamingLatencyBudgetMs = 0.0; // 关闭低延迟流式模式
+    config->signatureGenerationConfig_.targetRealtimeFactor = 0.8;      // 处理时间超过音频时长的80%时逐级降级
     
     // 匹配配置 - 服务器端使用较宽松的参数
     config->matchingConfig_.maxCandidates = 100;           // 较多的候选结果
@@ -219,6 +303,11 @@ std::shared_ptr<IPerformanceConfig> PerformanceConfigFactory::createServerConfig
     config->matchingConfig_.minMatchesRequired = 10;       // 较少的最小匹配点数
     config->matchingConfig_.minMatchesUniqueTimestampRequired = 6; // 服务器端至少6个不同时间戳
     config->matchingConfig_.offsetTolerance = 0.05;        // 较小的时间偏移容忍度
+    config->matchingConfig_.maxHashDocumentFrequency = 5000;  // 出现在超过5000个目标指纹中的哈希作为停用哈希
+    config->matchingConfig_.maxPostingsPerHash = 16384;       // 倒排记录超过16384条的哈希作为停用哈希
+    config->matchingConfig_.coarseVoteTopMedia = 256;         // 每批只有得票最高的256个目标指纹进入session匹配
+    config->matchingConfig_.coarseVoteBucketMs = 250;        // 粗偏移桶宽250ms，计票时合并相邻两个桶
+    config->matchingConfig_.materializeMatchedPoints = false;   // 服务器端的结果消费者很少读取匹配点，按需通过matchedPointIndices展开
     
     return config;
 }
@@ -230,6 +319,11 @@ std::shared_ptr<IPerformanceConfig> PerformanceConfigFactory::createDesktopGenCo
     // FFT配置 - 生成模式使用更大的窗口
     config->fftConfig_.fftSize = 4096;    // 大FFT窗口提高分辨率
     config->fftConfig_.hopSize = 1024;    // 更密集的分析
+    config->fftConfig_.enableDecimation = false; // 不降采样，见PerformanceConfigOptions::enableDecimation
+    config->fftConfig_.fastLogMagnitude = true;  // 向量化的功率域对数幅度
+    config->fftConfig_.silenceGateRms = 1e-4f;   // 约-80dBFS以下视为静音
+    config->fftConfig_.fixedPointFft = false;    // 浮点FFT
+    config->fftConfig_.magnitudeQuantizationBits = 0;  // 不量化幅度
     
     // 峰值检测配置 - 桌面生成模式优先精度
     config->peakDetectionConfig_.localMaxRange = 7;        // 更大的本地最大值范围
@@ -261,6 +355,8 @@ std::shared_ptr<IPerformanceConfig> PerformanceConfigFactory::createDesktopGenCo
     
     // 扩展三帧选取配置 - 桌面生成模式
     config->signatureGenerationConfig_.symmetricFrameRange = 5;    // 更大的对称范围
+    config->signatureGenerationConfig_.streamingLatencyBudgetMs = 0.0; // 关闭低延迟流式模式
+    config->signatureGenerationConfig_.targetRealtimeFactor = 0.0;      // 离线生成指纹库，不降级
     
     // 匹配配置 - 桌面生成模式设置
     config->matchingConfig_.maxCandidates = 100;           // 较多候选结果
@@ -270,6 +366,11 @@ std::shared_ptr<IPerformanceConfig> PerformanceConfigFactory::createDesktopGenCo
     config->matchingConfig_.minMatchesRequired = 12;       // 适中的最小匹配点数
     config->matchingConfig_.minMatchesUniqueTimestampRequired = 6; // 适中的唯一时间戳要求
     config->matchingConfig_.offsetTolerance = 0.08;        // 适中的时间偏移容忍度
+    config->matchingConfig_.maxHashDocumentFrequency = 1000;  // 出现在超过1000个目标指纹中的哈希作为停用哈希
+    config->matchingConfig_.maxPostingsPerHash = 4096;       // 倒排记录超过4096条的哈希作为停用哈希
+    config->matchingConfig_.coarseVoteTopMedia = 64;          // 每批只有得票最高的64个目标指纹进入session匹配
+    config->matchingConfig_.coarseVoteBucketMs = 250;        // 粗偏移桶宽250ms，计票时合并相邻两个桶
+    config->matchingConfig_.materializeMatchedPoints = true;   // 匹配结果中直接生成matchedPoints
     
     return config;
 }
@@ -280,6 +381,11 @@ std::shared_ptr<IPerformanceConfig> PerformanceConfigFactory::createServerGenCon
     // FFT配置 - 服务器生成模式使用最大窗口获得最佳分辨率
     config->fftConfig_.fftSize = 8192;    // 最大FFT窗口
     config->fftConfig_.hopSize = 2048;    // 非常密集的分析
+    config->fftConfig_.enableDecimation = false; // 不降采样，见PerformanceConfigOptions::enableDecimation
+    config->fftConfig_.fastLogMagnitude = true;  // 向量化的功率域对数幅度
+    config->fftConfig_.silenceGateRms = 1e-4f;   // 约-80dBFS以下视为静音
+    config->fftConfig_.fixedPointFft = false;    // 浮点FFT
+    config->fftConfig_.magnitudeQuantizationBits = 0;  // 不量化幅度
     
     // 峰值检测配置 - 服务器生成模式追求最高精度
     config->peakDetectionConfig_.localMaxRange = 8;        // 最大的本地最大值范围
@@ -311,6 +417,8 @@ std::shared_ptr<IPerformanceConfig> PerformanceConfigFactory::createServerGenCon
     
     // 扩展三帧选取配置 - 服务器生成模式
     config->signatureGenerationConfig_.symmetricFrameRange = 6;    // 最大的对称范围
+    config->signatureGenerationConfig_.streamingLatencyBudgetMs = 0.0; // 关闭低延迟流式模式
+    config->signatureGenerationConfig_.targetRealtimeFactor = 0.0;      // 离线生成指纹库，不降级
     
     // 匹配配置 - 服务器生成模式设置
     config->matchingConfig_.maxCandidates = 150;           // 最多候选结果
@@ -320,6 +428,11 @@ std::shared_ptr<IPerformanceConfig> PerformanceConfigFactory::createServerGenCon
     config->matchingConfig_.minMatchesRequired = 8;        // 较少的最小匹配点数
     config->matchingConfig_.minMatchesUniqueTimestampRequired = 4; // 较少的唯一时间戳要求
     config->matchingConfig_.offsetTolerance = 0.06;        // 更严格的时间偏移容忍度
+    config->matchingConfig_.maxHashDocumentFrequency = 5000;  // 出现在超过5000个目标指纹中的哈希作为停用哈希
+    config->matchingConfig_.maxPostingsPerHash = 16384;       // 倒排记录超过16384条的哈希作为停用哈希
+    config->matchingConfig_.coarseVoteTopMedia = 256;         // 每批只有得票最高的256个目标指纹进入session匹配
+    config->matchingConfig_.coarseVoteBucketMs = 250;        // 粗偏移桶宽250ms，计票时合并相邻两个桶
+    config->matchingConfig_.materializeMatchedPoints = false;   // 服务器端的结果消费者很少读取匹配点，按需通过matchedPointIndices展开
     
     return config;
 }
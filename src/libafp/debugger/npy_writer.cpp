@@ -0,0 +1,65 @@
+#include "debugger/npy_writer.h"
+#include <cstring>
+#include <sstream>
+
+namespace afp {
+
+namespace {
+
+// 文件头总长度（魔数、版本、头长度和描述字典），NumPy要求按64字节对齐；
+// 足够容纳任意64位元素个数，回填时长度不变
+constexpr size_t kHeaderBytes = 128;
+constexpr size_t kPreambleBytes = 10;  // "\x93NUMPY" + 版本(2) + 头长度(2)
+
+bool isLittleEndianHost() {
+    const uint16_t probe = 1;
+    uint8_t firstByte;
+    std::memcpy(&firstByte, &probe, 1);
+    return firstByte == 1;
+}
+
+} // namespace
+
+NpyWriter::~NpyWriter() {
+    close();
+}
+
+bool NpyWriter::open(const std::string& filename, const char* typeDescr) {
+    typeDescr_ = std::string(isLittleEndianHost() ? "<" : ">") + typeDescr;
+    count_ = 0;
+    file_.open(filename, std::ios::binary | std::ios::trunc);
+    if (!file_.is_open()) {
+        return false;
+    }
+    writeHeader();
+    return static_cast<bool>(file_);
+}
+
+void NpyWriter::writeHeader() {
+    std::ostringstream dict;
+    dict << "{'descr': '" << typeDescr_ << "', 'fortran_order': False, 'shape': (" << count_ << ",), }";
+    std::string header = dict.str();
+    header.resize(kHeaderBytes - kPreambleBytes - 1, ' ');
+    header += '\n';
+
+    const uint16_t headerLength = static_cast<uint16_t>(header.size());
+    const char preamble[kPreambleBytes] = {
+        '\x93', 'N', 'U', 'M', 'P', 'Y', 1, 0,
+        static_cast<char>(headerLength & 0xFF), static_cast<char>(headerLength >> 8)
+    };
+    file_.write(preamble, sizeof(preamble));
+    file_.write(header.data(), static_cast<std::streamsize>(header.size()));
+}
+
+bool NpyWriter::close() {
+    if (!file_.is_open()) {
+        return true;
+    }
+    file_.seekp(0);
+    writeHeader();
+    const bool ok = static_cast<bool>(file_);
+    file_.close();
+    return ok;
+}
+
+} // namespace afp
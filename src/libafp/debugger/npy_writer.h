@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+namespace afp {
+
+// 一维.npy数组（NumPy格式1.0）的流式写入，Python端可以用numpy.load(mmap_mode='r')直接映射
+// 文件头预留固定长度，数据按块追加，close()时回填元素个数，写入过程中不需要知道总长度
+class NpyWriter {
+public:
+    NpyWriter() = default;
+    ~NpyWriter();
+
+    NpyWriter(const NpyWriter&) = delete;
+    NpyWriter& operator=(const NpyWriter&) = delete;
+
+    // 打开文件并写入文件头，T为uint32_t、float或double
+    template<typename T>
+    bool open(const std::string& filename) {
+        return open(filename, descr<T>());
+    }
+
+    // 追加count个元素
+    template<typename T>
+    void append(const T* values, size_t count) {
+        file_.write(reinterpret_cast<const char*>(values), static_cast<std::streamsize>(count * sizeof(T)));
+        count_ += count;
+    }
+
+    // 回填元素个数并关闭文件，写入出错时返回false
+    bool close();
+
+private:
+    // NumPy类型描述中的类型和字节数部分，字节序在open中按主机字节序补上
+    template<typename T> static const char* descr();
+
+    bool open(const std::string& filename, const char* typeDescr);
+
+    void writeHeader();
+
+    std::ofstream file_;
+    std::string typeDescr_;
+    uint64_t count_ = 0;
+};
+
+template<> inline const char* NpyWriter::descr<uint32_t>() { return "u4"; }
+template<> inline const char* NpyWriter::descr<float>() { return "f4"; }
+template<> inline const char* NpyWriter::descr<double>() { return "f8"; }
+
+} // namespace afp
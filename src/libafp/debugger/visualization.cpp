@@ -1,4 +1,8 @@
 #include "debugger/visualization.h"
+#include "debugger/npy_writer.h"
+#include "base/json_string.h"
+#include <algorithm>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <sstream>
@@ -9,17 +13,79 @@
 
 namespace afp {
 
+namespace {
+
+// 每次从行数据中取出一列的元素个数，避免为整列分配临时数组
+constexpr size_t kColumnBlockSize = 4096;
+
+// 把rows的第Field个字段写为directory/name.npy
+template<size_t Field, typename Row>
+bool writeColumn(const std::string& directory, const std::string& name, const std::vector<Row>& rows) {
+    using Value = std::tuple_element_t<Field, Row>;
+    NpyWriter writer;
+    if (!writer.template open<Value>((std::filesystem::path(directory) / (name + ".npy")).string())) {
+        std::cerr << "Failed to open column: " << name << std::endl;
+        return false;
+    }
+    Value block[kColumnBlockSize];
+    for (size_t start = 0; start < rows.size(); start += kColumnBlockSize) {
+        const size_t count = std::min(kColumnBlockSize, rows.size() - start);
+        for (size_t i = 0; i < count; ++i) {
+            block[i] = std::get<Field>(rows[start + i]);
+        }
+        writer.append(block, count);
+    }
+    return writer.close();
+}
+
+template<typename Value, typename Getter>
+bool writeSessionColumn(const std::string& directory, const std::string& name,
+                        const std::vector<SessionData>& sessions, Getter&& get) {
+    std::vector<Value> values;
+    values.reserve(sessions.size());
+    for (const auto& session : sessions) {
+        values.push_back(get(session));
+    }
+    NpyWriter writer;
+    if (!writer.open<Value>((std::filesystem::path(directory) / (name + ".npy")).string())) {
+        std::cerr << "Failed to open column: " << name << std::endl;
+        return false;
+    }
+    writer.append(values.data(), values.size());
+    return writer.close();
+}
+
+bool createColumnDirectory(const std::string& directory) {
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error || !std::filesystem::is_directory(directory)) {
+        std::cerr << "Failed to create directory: " << directory << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
 Visualizer::Visualizer() {}
 
 Visualizer::~Visualizer() {}
 
-// Singleton instance
-Visualizer& Visualizer::getInstance() {
-    static Visualizer instance;
-    return instance;
+bool Visualizer::isColumnarPath(const std::string& filename) {
+    const std::string extension = kColumnarExtension;
+    std::string path = filename;
+    while (!path.empty() && (path.back() == '/' || path.back() == '\\')) {
+        path.pop_back();
+    }
+    return path.size() > extension.size() &&
+           path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
 }
 
 bool Visualizer::saveVisualization(const VisualizationData& data, const std::string& filename) {
+    if (isColumnarPath(filename)) {
+        return saveVisualizationColumns(data, filename);
+    }
+
     // Create and open a JSON file to save the data
     std::ofstream file(filename);
     if (!file.is_open()) {
@@ -89,6 +155,10 @@ bool Visualizer::saveVisualization(const VisualizationData& data, const std::str
 }
 
 bool Visualizer::saveSessionsData(const std::vector<SessionData>& sessions, const std::string& filename) {
+    if (isColumnarPath(filename)) {
+        return saveSessionsColumns(sessions, filename);
+    }
+
     // Create and open a JSON file to save the sessions data
     std::ofstream file(filename);
     if (!file.is_open()) {
@@ -119,4 +189,87 @@ bool Visualizer::saveSessionsData(const std::vector<SessionData>& sessions, cons
     return true;
 }
 
+bool Visualizer::saveVisualizationColumns(const VisualizationData& data, const std::string& directory) {
+    if (!createColumnDirectory(directory)) {
+        return false;
+    }
+
+    bool ok = writeColumn<0>(directory, "allPeaks.frequency", data.allPeaks) &&
+              writeColumn<1>(directory, "allPeaks.time", data.allPeaks) &&
+              writeColumn<2>(directory, "allPeaks.amplitude", data.allPeaks) &&
+              writeColumn<0>(directory, "fingerprintPoints.frequency", data.fingerprintPoints) &&
+              writeColumn<1>(directory, "fingerprintPoints.time", data.fingerprintPoints) &&
+              writeColumn<2>(directory, "fingerprintPoints.hash", data.fingerprintPoints);
+    // 与JSON格式相同，没有匹配点时不写matchedPoints
+    const bool hasMatchedPoints = !data.matchedPoints.empty();
+    if (ok && hasMatchedPoints) {
+        ok = writeColumn<0>(directory, "matchedPoints.frequency", data.matchedPoints) &&
+             writeColumn<1>(directory, "matchedPoints.time", data.matchedPoints) &&
+             writeColumn<2>(directory, "matchedPoints.hash", data.matchedPoints) &&
+             writeColumn<3>(directory, "matchedPoints.session", data.matchedPoints);
+    }
+    if (!ok) {
+        return false;
+    }
+
+    std::ofstream meta(std::filesystem::path(directory) / "meta.json");
+    meta << "{\n";
+    meta << "  \"format\": \"afp-columns\",\n";
+    meta << "  \"kind\": \"visualization\",\n";
+    meta << "  \"title\": " << jsonString(data.title) << ",\n";
+    meta << "  \"duration\": " << data.duration << ",\n";
+    if (!data.audioFilePath.empty()) {
+        meta << "  \"audioFilePath\": " << jsonString(data.audioFilePath) << ",\n";
+    }
+    meta << "  \"tables\": {\n";
+    meta << "    \"allPeaks\": [\"frequency\", \"time\", \"amplitude\"],\n";
+    meta << "    \"fingerprintPoints\": [\"frequency\", \"time\", \"hash\"]";
+    if (hasMatchedPoints) {
+        meta << ",\n    \"matchedPoints\": [\"frequency\", \"time\", \"hash\", \"session\"]";
+    }
+    meta << "\n  }\n}\n";
+    if (!meta) {
+        std::cerr << "Failed to write meta.json: " << directory << std::endl;
+        return false;
+    }
+
+    std::cout << "Visualization data saved to: " << directory << std::endl;
+    return true;
+}
+
+bool Visualizer::saveSessionsColumns(const std::vector<SessionData>& sessions, const std::string& directory) {
+    if (!createColumnDirectory(directory)) {
+        return false;
+    }
+
+    const bool ok =
+        writeSessionColumn<uint32_t>(directory, "sessions.id", sessions, [](const SessionData& s) { return s.id; }) &&
+        writeSessionColumn<uint32_t>(directory, "sessions.matchCount", sessions, [](const SessionData& s) { return s.matchCount; }) &&
+        writeSessionColumn<double>(directory, "sessions.confidence", sessions, [](const SessionData& s) { return s.confidence; });
+    if (!ok) {
+        return false;
+    }
+
+    // 字符串列写入meta.json
+    std::ofstream meta(std::filesystem::path(directory) / "meta.json");
+    meta << "{\n";
+    meta << "  \"format\": \"afp-columns\",\n";
+    meta << "  \"kind\": \"sessions\",\n";
+    meta << "  \"tables\": {\n";
+    meta << "    \"sessions\": [\"id\", \"matchCount\", \"confidence\"]\n";
+    meta << "  },\n";
+    meta << "  \"mediaTitle\": [";
+    for (size_t i = 0; i < sessions.size(); ++i) {
+        meta << (i ? ", " : "") << jsonString(sessions[i].mediaTitle);
+    }
+    meta << "]\n}\n";
+    if (!meta) {
+        std::cerr << "Failed to write meta.json: " << directory << std::endl;
+        return false;
+    }
+
+    std::cout << "Sessions data saved to: " << directory << std::endl;
+    return true;
+}
+
 } // namespace afp 
\ No newline at end of file
@@ -1,8 +1,11 @@
 #pragma once
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <map>
 #include <memory>
+#include <tuple>
+#include <cstdint>
 
 namespace afp {
 
@@ -25,6 +28,49 @@ struct VisualizationData {
     std::string audioFilePath;
 };
 
+// 可视化数据的采样和上限，长时间运行（如线上灰度）时开启，使内存和CPU开销不随流的时长增长
+// 默认全部不限制，与之前逐点全量收集相同
+struct VisualizationLimits {
+    size_t pointStride = 1;         // 峰值和指纹点每k个保留1个
+    double windowSeconds = 0.0;     // 峰值、指纹点和session匹配明细只保留最近T秒，0表示不限制
+    size_t maxSessions = 0;         // session匹配历史只保留匹配明细最多的N个session，0表示不限制
+
+    bool unlimited() const {
+        return pointStride <= 1 && windowSeconds <= 0.0 && maxSessions == 0;
+    }
+};
+
+// 一张可视化表（allPeaks、fingerprintPoints等，第二个字段为时间戳）的采样状态
+// 行数达到trimAt时一次性删除时间窗口之外的行，并把trimAt设为剩余行数的两倍，
+// 均摊到每行为O(1)，行数不超过窗口内行数的两倍
+struct VisualizationSampler {
+    size_t seen = 0;
+    size_t trimAt = 0;
+
+    template<typename Row>
+    void append(std::vector<Row>& rows, const Row& row, const VisualizationLimits& limits) {
+        if (seen++ % std::max<size_t>(limits.pointStride, 1) != 0) {
+            return;
+        }
+        rows.push_back(row);
+        if (limits.windowSeconds <= 0.0 || rows.size() < trimAt) {
+            return;
+        }
+        const double cutoff = std::get<1>(row) - limits.windowSeconds;
+        rows.erase(std::remove_if(rows.begin(), rows.end(), [cutoff](const Row& r) {
+            return std::get<1>(r) < cutoff;
+        }), rows.end());
+        trimAt = std::max<size_t>(rows.size() * 2, kMinTrimRows);
+    }
+
+    void reset() {
+        seen = 0;
+        trimAt = 0;
+    }
+
+    static constexpr size_t kMinTrimRows = 1024;
+};
+
 // Structure to store top matching sessions for visualization
 struct SessionData {
     uint32_t id;
@@ -39,17 +85,21 @@ public:
     ~Visualizer();
     
     // Save visualization data to a JSON file (no Python script generation)
+    // 文件名以kColumnarExtension结尾时按列式格式保存，见isColumnarPath
     static bool saveVisualization(const VisualizationData& data, const std::string& filename);
     
     // Save top matching sessions data to a JSON file
+    // 文件名以kColumnarExtension结尾时按列式格式保存
     static bool saveSessionsData(const std::vector<SessionData>& sessions, const std::string& filename);
-    
-    // Get singleton instance
-    static Visualizer& getInstance();
+
+    // 列式格式：路径是一个目录，每个字段一个.npy一维数组（如allPeaks.time.npy），逐块流式写入，
+    // 标题等标量写入meta.json；Python端用numpy.load(mmap_mode='r')映射，长录音的写入和加载不再经过文本
+    static constexpr const char* kColumnarExtension = ".columns";
+    static bool isColumnarPath(const std::string& filename);
     
 private:
-    // Visualization data storage
-    std::map<std::string, VisualizationData> dataStore_;
+    static bool saveVisualizationColumns(const VisualizationData& data, const std::string& directory);
+    static bool saveSessionsColumns(const std::vector<SessionData>& sessions, const std::string& directory);
 };
 
 } // namespace afp 
@@ -9,6 +9,8 @@ public:
     ~AccelerateFFT() override;
     bool init(size_t size) override;
     bool transform(const float* input, std::complex<float>* output) override;
+    bool transformReal(const float* input, std::complex<float>* output) override;
+    bool transformBatch(const float* inputs, size_t count, std::complex<float>* outputs) override;
 
 private:
     size_t size_ = 0;
@@ -17,6 +19,9 @@ private:
     std::vector<float> split_real_;
     std::vector<float> split_imag_;
     DSPSplitComplex split_complex_;
+    // 批量变换的分离复数缓冲区，各窗口相隔size/2
+    std::vector<float> batch_real_;
+    std::vector<float> batch_imag_;
 };
 
 } // namespace afp 
\ No newline at end of file
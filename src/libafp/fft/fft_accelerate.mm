@@ -46,4 +46,60 @@ bool AccelerateFFT::transform(const float* input, std::complex<float>* output) {
     return true;
 }
 
+bool AccelerateFFT::transformReal(const float* input, std::complex<float>* output) {
+    const size_t half = size_ / 2;
+    vDSP_ctoz(reinterpret_cast<const DSPComplex*>(input), 2, &split_complex_, 1, half);
+
+    // zrip把奈奎斯特bin的实部打包在imagp[0]中
+    vDSP_fft_zrip(fft_setup_, &split_complex_, 1, log2n_, FFT_FORWARD);
+
+    float scale = 1.0f / (2 * size_);
+    vDSP_vsmul(split_complex_.realp, 1, &scale, split_complex_.realp, 1, half);
+    vDSP_vsmul(split_complex_.imagp, 1, &scale, split_complex_.imagp, 1, half);
+
+    const float nyquist = split_complex_.imagp[0];
+    split_complex_.imagp[0] = 0.0f;
+
+    // 分离复数直接写回交错格式
+    vDSP_ztoc(&split_complex_, 1, reinterpret_cast<DSPComplex*>(output), 2, half);
+    output[half] = std::complex<float>(nyquist, 0.0f);
+
+    return true;
+}
+
+bool AccelerateFFT::transformBatch(const float* inputs, size_t count, std::complex<float>* outputs) {
+    if (count == 0) {
+        return true;
+    }
+
+    const size_t half = size_ / 2;
+    const size_t bins = half + 1;
+    batch_real_.resize(half * count);
+    batch_imag_.resize(half * count);
+    DSPSplitComplex batch = {batch_real_.data(), batch_imag_.data()};
+
+    for (size_t i = 0; i < count; ++i) {
+        DSPSplitComplex window = {batch.realp + i * half, batch.imagp + i * half};
+        vDSP_ctoz(reinterpret_cast<const DSPComplex*>(inputs + i * size_), 2, &window, 1, half);
+    }
+
+    // 一次调用完成所有窗口的变换
+    vDSP_fftm_zrip(fft_setup_, &batch, 1, half, log2n_, count, FFT_FORWARD);
+
+    float scale = 1.0f / (2 * size_);
+    vDSP_vsmul(batch.realp, 1, &scale, batch.realp, 1, half * count);
+    vDSP_vsmul(batch.imagp, 1, &scale, batch.imagp, 1, half * count);
+
+    for (size_t i = 0; i < count; ++i) {
+        DSPSplitComplex window = {batch.realp + i * half, batch.imagp + i * half};
+        const float nyquist = window.imagp[0];
+        window.imagp[0] = 0.0f;
+        std::complex<float>* output = outputs + i * bins;
+        vDSP_ztoc(&window, 1, reinterpret_cast<DSPComplex*>(output), 2, half);
+        output[half] = std::complex<float>(nyquist, 0.0f);
+    }
+
+    return true;
+}
+
 } // namespace afp 
\ No newline at end of file
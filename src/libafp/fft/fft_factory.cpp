@@ -1,28 +1,72 @@
 #include "fft_interface.h"
+#include "fft_fixed_point.h"
 
 #if defined(__APPLE__)
 #include "fft_accelerate.h"
 #elif defined(__ANDROID__)
+#if defined(AFP_HAVE_NE10)
 #include "fft_ne10.h"
+#endif
+#include "fft_native.h"
 #else
-#include "fft_kiss.h"
+#if defined(_WIN32)
+#include "fft_mkl.h"
+#endif
+#if defined(AFP_HAVE_FFTW)
+#include "fft_fftw.h"
+#endif
+#include "fft_native.h"
 #endif
 
 namespace afp {
 
+namespace {
+
+template<typename T>
+std::unique_ptr<FFTInterface> tryCreate(size_t size) {
+    auto fft = std::make_unique<T>();
+    if (!fft->init(size)) {
+        return nullptr;
+    }
+    return fft;
+}
+
+} // namespace
+
 std::unique_ptr<FFTInterface> FFTFactory::create(size_t size) {
 #if defined(__APPLE__)
-    auto fft = std::make_unique<AccelerateFFT>();
+    return tryCreate<AccelerateFFT>(size);
 #elif defined(__ANDROID__)
-    auto fft = std::make_unique<Ne10FFT>();
+    std::unique_ptr<FFTInterface> fft;
+#if defined(AFP_HAVE_NE10)
+    fft = tryCreate<Ne10FFT>(size);
+#endif
+    if (!fft) {
+        fft = tryCreate<NativeFFT>(size);
+    }
+    return fft;
 #else
-    auto fft = std::make_unique<KissFFT>();
+    // 按优先级依次尝试编译进来的后端，初始化失败（如不支持的大小）时退回下一个，内置实现兜底
+    std::unique_ptr<FFTInterface> fft;
+#if defined(_WIN32)
+    if (!fft) {
+        fft = tryCreate<MKLFFT>(size);
+    }
 #endif
-
-    if (!fft->init(size)) {
-        return nullptr;
+#if defined(AFP_HAVE_FFTW)
+    if (!fft) {
+        fft = tryCreate<FFTWFFT>(size);
+    }
+#endif
+    if (!fft) {
+        fft = tryCreate<NativeFFT>(size);
     }
     return fft;
+#endif
+}
+
+std::unique_ptr<FFTInterface> FFTFactory::createFixedPoint(size_t size) {
+    return tryCreate<FixedPointFFT>(size);
 }
 
-} // namespace afp 
\ No newline at end of file
+} // namespace afp
\ No newline at end of file
@@ -0,0 +1,71 @@
+#include "fft_fftw.h"
+#include <algorithm>
+#include <mutex>
+
+namespace afp {
+
+namespace {
+
+// FFTW的规划器不是线程安全的，创建和销毁计划需要串行
+std::mutex& plannerMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+} // namespace
+
+FFTWFFT::~FFTWFFT() {
+    std::lock_guard<std::mutex> lock(plannerMutex());
+    if (plan_) {
+        fftwf_destroy_plan(plan_);
+    }
+    fftwf_free(input_buffer_);
+    fftwf_free(output_buffer_);
+}
+
+bool FFTWFFT::init(size_t size) {
+    if (size < 2) {
+        return false;
+    }
+    size_ = size;
+
+    std::lock_guard<std::mutex> lock(plannerMutex());
+    input_buffer_ = fftwf_alloc_real(size_);
+    output_buffer_ = fftwf_alloc_complex(size_ / 2 + 1);
+    if (!input_buffer_ || !output_buffer_) {
+        return false;
+    }
+
+    plan_ = fftwf_plan_dft_r2c_1d(static_cast<int>(size_), input_buffer_, output_buffer_, FFTW_MEASURE);
+    return plan_ != nullptr;
+}
+
+bool FFTWFFT::transform(const float* input, std::complex<float>* output) {
+    return transformReal(input, output);
+}
+
+bool FFTWFFT::transformReal(const float* input, std::complex<float>* output) {
+    // 计划绑定在对齐的缓冲区上，调用方的缓冲区不保证对齐，先复制再执行
+    std::copy(input, input + size_, input_buffer_);
+    fftwf_execute(plan_);
+
+    // FFTW不缩放，按1/size缩放以与其他后端一致
+    const float scale = 1.0f / static_cast<float>(size_);
+    for (size_t i = 0; i <= size_ / 2; ++i) {
+        output[i] = std::complex<float>(output_buffer_[i][0] * scale, output_buffer_[i][1] * scale);
+    }
+    return true;
+}
+
+bool FFTWFFT::transformBatch(const float* inputs, size_t count, std::complex<float>* outputs) {
+    // 计划按单个窗口规划，批量时依次执行；计划和对齐缓冲区在各窗口之间保持在缓存中
+    const size_t bins = size_ / 2 + 1;
+    for (size_t i = 0; i < count; ++i) {
+        if (!transformReal(inputs + i * size_, outputs + i * bins)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace afp
@@ -0,0 +1,24 @@
+#pragma once
+#include "fft_interface.h"
+#include <fftw3.h>
+
+namespace afp {
+
+// 基于FFTW的实数FFT，检测到fftw3f时编译（定义AFP_HAVE_FFTW）
+// 按大小规划一次r2c变换（FFTW_MEASURE），之后每次变换只执行规划好的计划
+class FFTWFFT : public FFTInterface {
+public:
+    ~FFTWFFT() override;
+    bool init(size_t size) override;
+    bool transform(const float* input, std::complex<float>* output) override;
+    bool transformReal(const float* input, std::complex<float>* output) override;
+    bool transformBatch(const float* inputs, size_t count, std::complex<float>* outputs) override;
+
+private:
+    size_t size_ = 0;
+    fftwf_plan plan_ = nullptr;
+    float* input_buffer_ = nullptr;           // FFTW分配的对齐缓冲区
+    fftwf_complex* output_buffer_ = nullptr;
+};
+
+} // namespace afp
@@ -0,0 +1,171 @@
+#include "fft_fixed_point.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace afp {
+
+namespace {
+
+// 蝶形运算前各分量的上限：|a| + |w*b| < 8192 * (1 + √2) < 32768，不会溢出int16
+constexpr int32_t kStageHeadroom = 8192;
+// 输入归一化后最大值所在区间[2^(kInputBits-1), 2^kInputBits)
+constexpr int kInputBits = 13;
+
+int16_t toQ15(double value) {
+    return static_cast<int16_t>(std::clamp<long>(std::lround(value * 32768.0), -32768, 32767));
+}
+
+} // namespace
+
+bool FixedPointFFT::init(size_t size) {
+    if (size < 4 || (size & (size - 1)) != 0) {
+        return false;
+    }
+
+    size_ = size;
+    half_ = size / 2;
+
+    size_t log2_half = 0;
+    while ((static_cast<size_t>(1) << log2_half) < half_) {
+        ++log2_half;
+    }
+    bit_reverse_.resize(half_);
+    for (size_t i = 0; i < half_; ++i) {
+        size_t reversed = 0;
+        for (size_t bit = 0; bit < log2_half; ++bit) {
+            if (i & (static_cast<size_t>(1) << bit)) {
+                reversed |= static_cast<size_t>(1) << (log2_half - 1 - bit);
+            }
+        }
+        bit_reverse_[i] = static_cast<uint32_t>(reversed);
+    }
+
+    stage_twiddle_real_.resize(half_ > 1 ? half_ - 1 : 1);
+    stage_twiddle_imag_.resize(stage_twiddle_real_.size());
+    for (size_t h = 1; h < half_; h *= 2) {
+        for (size_t j = 0; j < h; ++j) {
+            const double angle = -M_PI * static_cast<double>(j) / static_cast<double>(h);
+            stage_twiddle_real_[h - 1 + j] = toQ15(std::cos(angle));
+            stage_twiddle_imag_[h - 1 + j] = toQ15(std::sin(angle));
+        }
+    }
+
+    split_twiddle_real_.resize(half_ + 1);
+    split_twiddle_imag_.resize(half_ + 1);
+    for (size_t k = 0; k <= half_; ++k) {
+        const double angle = -2.0 * M_PI * static_cast<double>(k) / static_cast<double>(size_);
+        split_twiddle_real_[k] = toQ15(std::cos(angle));
+        split_twiddle_imag_[k] = toQ15(std::sin(angle));
+    }
+
+    work_real_.resize(half_);
+    work_imag_.resize(half_);
+    return true;
+}
+
+bool FixedPointFFT::transform(const float* input, std::complex<float>* output) {
+    return transformReal(input, output);
+}
+
+void FixedPointFFT::shiftWork(int shift) {
+    const int32_t round = 1 << (shift - 1);
+    for (size_t i = 0; i < half_; ++i) {
+        work_real_[i] = static_cast<int16_t>((work_real_[i] + round) >> shift);
+        work_imag_[i] = static_cast<int16_t>((work_imag_[i] + round) >> shift);
+    }
+}
+
+bool FixedPointFFT::transformReal(const float* input, std::complex<float>* output) {
+    float input_max = 0.0f;
+    for (size_t i = 0; i < size_; ++i) {
+        input_max = std::max(input_max, std::fabs(input[i]));
+    }
+    if (!(input_max > 0.0f)) {
+        std::fill(output, output + half_ + 1, std::complex<float>(0.0f, 0.0f));
+        return true;
+    }
+
+    // 整个窗口共用的指数：定点值 × 2^exponent = 实际值
+    int input_exponent = 0;
+    std::frexp(input_max, &input_exponent);
+    const int input_shift = kInputBits - input_exponent;
+    int exponent = -input_shift;
+
+    int16_t* re = work_real_.data();
+    int16_t* im = work_imag_.data();
+
+    // 偶数下标样本作实部、奇数下标样本作虚部，量化与位反转重排一起完成
+    for (size_t i = 0; i < half_; ++i) {
+        const uint32_t target = bit_reverse_[i];
+        re[target] = static_cast<int16_t>(std::lrint(std::ldexp(input[2 * i], input_shift)));
+        im[target] = static_cast<int16_t>(std::lrint(std::ldexp(input[2 * i + 1], input_shift)));
+    }
+
+    // 基2按时间抽取的蝶形运算
+    for (size_t h = 1; h < half_; h *= 2) {
+        int32_t stage_max = 0;
+        for (size_t i = 0; i < half_; ++i) {
+            stage_max = std::max(stage_max, std::max(std::abs(static_cast<int32_t>(re[i])), std::abs(static_cast<int32_t>(im[i]))));
+        }
+        int shift = 0;
+        while ((stage_max >> shift) >= kStageHeadroom) {
+            ++shift;
+        }
+        if (shift > 0) {
+            shiftWork(shift);
+            exponent += shift;
+        }
+
+        const int16_t* wr = stage_twiddle_real_.data() + h - 1;
+        const int16_t* wi = stage_twiddle_imag_.data() + h - 1;
+        for (size_t start = 0; start < half_; start += 2 * h) {
+            int16_t* ar = re + start;
+            int16_t* ai = im + start;
+            int16_t* br = ar + h;
+            int16_t* bi = ai + h;
+            for (size_t j = 0; j < h; ++j) {
+                // Q15乘法，四舍五入
+                const int32_t tr = (br[j] * wr[j] - bi[j] * wi[j] + (1 << 14)) >> 15;
+                const int32_t ti = (br[j] * wi[j] + bi[j] * wr[j] + (1 << 14)) >> 15;
+                const int32_t a_r = ar[j];
+                const int32_t a_i = ai[j];
+                br[j] = static_cast<int16_t>(a_r - tr);
+                bi[j] = static_cast<int16_t>(a_i - ti);
+                ar[j] = static_cast<int16_t>(a_r + tr);
+                ai[j] = static_cast<int16_t>(a_i + ti);
+            }
+        }
+    }
+
+    // 拆分实数频谱，公式见NativeFFT；和差在int32中计算，旋转在int64中累加后舍入
+    const float scale = std::ldexp(1.0f / static_cast<float>(size_), exponent);
+    output[0] = std::complex<float>(static_cast<float>(re[0] + im[0]) * scale, 0.0f);
+    output[half_] = std::complex<float>(static_cast<float>(re[0] - im[0]) * scale, 0.0f);
+    const float half_scale = 0.5f * scale;
+    for (size_t k = 1; k < half_; ++k) {
+        const size_t mirror = half_ - k;
+        const int32_t even_r = re[k] + re[mirror];
+        const int32_t even_i = im[k] - im[mirror];
+        const int32_t odd_r = im[k] + im[mirror];
+        const int32_t odd_i = re[mirror] - re[k];
+        const int64_t wr = split_twiddle_real_[k];
+        const int64_t wi = split_twiddle_imag_[k];
+        const int64_t rot_r = (wr * odd_r - wi * odd_i + (1 << 14)) >> 15;
+        const int64_t rot_i = (wr * odd_i + wi * odd_r + (1 << 14)) >> 15;
+        output[k] = std::complex<float>(static_cast<float>(even_r + rot_r) * half_scale,
+                                        static_cast<float>(even_i + rot_i) * half_scale);
+    }
+
+    return true;
+}
+
+bool FixedPointFFT::transformBatch(const float* inputs, size_t count, std::complex<float>* outputs) {
+    const size_t bins = half_ + 1;
+    for (size_t i = 0; i < count; ++i) {
+        transformReal(inputs + i * size_, outputs + i * bins);
+    }
+    return true;
+}
+
+} // namespace afp
@@ -0,0 +1,37 @@
+#pragma once
+#include "fft_interface.h"
+#include <cstdint>
+#include <vector>
+
+namespace afp {
+
+// Q15定点实数FFT，面向没有高效浮点单元的低端设备（FFTConfig::fixedPointFft）
+// 与NativeFFT相同的结构：size点实数输入打包成size/2点复数做基2迭代FFT，再拆分出实数序列的频谱；
+// 工作区和旋转因子都是int16，乘法在int32中完成后舍入回Q15
+// 块浮点：输入按整个窗口的最大值归一化到[4096, 8192)，每一级之前最大分量不小于8192时整体右移，
+// 保证蝶形运算不溢出，移位次数累计为整个窗口共用的指数；只在接口边界与float互转
+// 输出按1/size缩放，与其他后端一致；与浮点FFT的差异来自Q15量化，约在最大bin以下70dB处，
+// 不影响分位数阈值以上的峰值；size必须是2的幂且不小于4
+class FixedPointFFT : public FFTInterface {
+public:
+    bool init(size_t size) override;
+    bool transform(const float* input, std::complex<float>* output) override;
+    bool transformReal(const float* input, std::complex<float>* output) override;
+    bool transformBatch(const float* inputs, size_t count, std::complex<float>* outputs) override;
+
+private:
+    // 把工作区右移shift位（四舍五入）
+    void shiftWork(int shift);
+
+    size_t size_ = 0;
+    size_t half_ = 0;                       // 复数FFT的点数
+    std::vector<uint32_t> bit_reverse_;     // 复数FFT输入的位反转下标
+    std::vector<int16_t> stage_twiddle_real_;  // 各级旋转因子（Q15），长度为h的一级从下标h-1开始
+    std::vector<int16_t> stage_twiddle_imag_;
+    std::vector<int16_t> split_twiddle_real_;  // 拆分实数频谱用的旋转因子 e^{-2πik/size}（Q15）
+    std::vector<int16_t> split_twiddle_imag_;
+    std::vector<int16_t> work_real_;
+    std::vector<int16_t> work_imag_;
+};
+
+} // namespace afp
@@ -1,6 +1,7 @@
 #pragma once
 #include <vector>
 #include <complex>
+#include <memory>
 
 namespace afp {
 
@@ -9,11 +10,21 @@ public:
     virtual ~FFTInterface() = default;
     virtual bool init(size_t size) = 0;
     virtual bool transform(const float* input, std::complex<float>* output) = 0;
+    // 实数输入的FFT：output只写入非负频率的size/2+1个bin（含直流和奈奎斯特，两者虚部为0），
+    // 负频率部分与之共轭对称，不再计算和输出
+    virtual bool transformReal(const float* input, std::complex<float>* output) = 0;
+    // 批量实数FFT：inputs依次存放count个size点的窗口，outputs依次存放count组size/2+1个bin
+    // 同时就绪的多个窗口（多个hop、多个通道）一次变换，分摊每次调用的开销
+    virtual bool transformBatch(const float* inputs, size_t count, std::complex<float>* outputs) = 0;
 };
 
+// 没有GPU（CUDA/Metal）后端：离线生成要求与CPU流水线逐位一致的输出，而GPU的FFT和对数等超越函数结果不可逐位复现，
+// 下游的峰值选取和哈希依赖精确的浮点比较；批量建库请用generate的--jobs（多文件）和--segment-parallel（长文件）
 class FFTFactory {
 public:
     static std::unique_ptr<FFTInterface> create(size_t size);
+    // Q15定点实现（FixedPointFFT），各平台通用；大小不支持时返回nullptr
+    static std::unique_ptr<FFTInterface> createFixedPoint(size_t size);
 };
 
 } // namespace afp 
\ No newline at end of file
@@ -7,6 +7,9 @@ MKLFFT::~MKLFFT() {
     if (descriptor_) {
         DftiFreeDescriptor(&descriptor_);
     }
+    if (batch_descriptor_) {
+        DftiFreeDescriptor(&batch_descriptor_);
+    }
 }
 
 bool MKLFFT::init(size_t size) {
@@ -22,8 +25,12 @@ bool MKLFFT::init(size_t size) {
     );
     if (status != DFTI_NO_ERROR) return false;
 
-    // 设置输出格式为 COMPLEX
-    status = DftiSetValue(descriptor_, DFTI_PACKED_FORMAT, DFTI_PACK_FORMAT);
+    // 输出为size/2+1个交错复数（CCE格式），与std::complex<float>布局一致，可直接写入调用方的缓冲区
+    status = DftiSetValue(descriptor_, DFTI_CONJUGATE_EVEN_STORAGE, DFTI_COMPLEX_COMPLEX);
+    if (status != DFTI_NO_ERROR) return false;
+
+    // 非原地变换，输入不需要先复制到工作缓冲区
+    status = DftiSetValue(descriptor_, DFTI_PLACEMENT, DFTI_NOT_INPLACE);
     if (status != DFTI_NO_ERROR) return false;
 
     // 设置正向变换缩放因子
@@ -35,31 +42,65 @@ bool MKLFFT::init(size_t size) {
     status = DftiCommitDescriptor(descriptor_);
     if (status != DFTI_NO_ERROR) return false;
 
-    // 分配工作缓冲区
-    work_buffer_.resize(size_ + 2);  // 额外空间用于复数输出
-    
     return true;
 }
 
 bool MKLFFT::transform(const float* input, std::complex<float>* output) {
-    // 复制输入数据到工作缓冲区
-    std::copy(input, input + size_, work_buffer_.data());
+    // 输出与原先的打包格式解包后一致：0到size/2的bin
+    return transformReal(input, output);
+}
 
-    // 执行 FFT
-    MKL_LONG status = DftiComputeForward(descriptor_, work_buffer_.data());
-    if (status != DFTI_NO_ERROR) return false;
+bool MKLFFT::transformReal(const float* input, std::complex<float>* output) {
+    // 非原地变换不会修改输入
+    MKL_LONG status = DftiComputeForward(descriptor_, const_cast<float*>(input), output);
+    return status == DFTI_NO_ERROR;
+}
 
-    // 转换 MKL 的打包格式到标准复数格式
-    output[0] = std::complex<float>(work_buffer_[0], 0.0f);
-    for (size_t i = 1; i < size_/2; ++i) {
-        output[i] = std::complex<float>(
-            work_buffer_[2*i-1],
-            work_buffer_[2*i]
-        );
+bool MKLFFT::prepareBatchDescriptor(size_t count) {
+    if (batch_descriptor_ && batch_count_ == count) {
+        return true;
+    }
+    if (batch_descriptor_) {
+        DftiFreeDescriptor(&batch_descriptor_);
+        batch_count_ = 0;
     }
-    output[size_/2] = std::complex<float>(work_buffer_[size_], 0.0f);
 
+    MKL_LONG status = DftiCreateDescriptor(&batch_descriptor_, DFTI_SINGLE, DFTI_REAL, 1, size_);
+    if (status != DFTI_NO_ERROR) return false;
+    status = DftiSetValue(batch_descriptor_, DFTI_CONJUGATE_EVEN_STORAGE, DFTI_COMPLEX_COMPLEX);
+    if (status != DFTI_NO_ERROR) return false;
+    status = DftiSetValue(batch_descriptor_, DFTI_PLACEMENT, DFTI_NOT_INPLACE);
+    if (status != DFTI_NO_ERROR) return false;
+    status = DftiSetValue(batch_descriptor_, DFTI_FORWARD_SCALE, 1.0f / size_);
+    if (status != DFTI_NO_ERROR) return false;
+
+    // 各窗口在输入中相隔size个实数，在输出中相隔size/2+1个复数
+    status = DftiSetValue(batch_descriptor_, DFTI_NUMBER_OF_TRANSFORMS, static_cast<MKL_LONG>(count));
+    if (status != DFTI_NO_ERROR) return false;
+    status = DftiSetValue(batch_descriptor_, DFTI_INPUT_DISTANCE, static_cast<MKL_LONG>(size_));
+    if (status != DFTI_NO_ERROR) return false;
+    status = DftiSetValue(batch_descriptor_, DFTI_OUTPUT_DISTANCE, static_cast<MKL_LONG>(size_ / 2 + 1));
+    if (status != DFTI_NO_ERROR) return false;
+
+    status = DftiCommitDescriptor(batch_descriptor_);
+    if (status != DFTI_NO_ERROR) return false;
+
+    batch_count_ = count;
     return true;
 }
 
+bool MKLFFT::transformBatch(const float* inputs, size_t count, std::complex<float>* outputs) {
+    if (count == 0) {
+        return true;
+    }
+    if (count == 1) {
+        return transformReal(inputs, outputs);
+    }
+    if (!prepareBatchDescriptor(count)) {
+        return false;
+    }
+    MKL_LONG status = DftiComputeForward(batch_descriptor_, const_cast<float*>(inputs), outputs);
+    return status == DFTI_NO_ERROR;
+}
+
 } // namespace afp 
\ No newline at end of file
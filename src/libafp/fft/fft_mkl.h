@@ -9,11 +9,17 @@ public:
     ~MKLFFT() override;
     bool init(size_t size) override;
     bool transform(const float* input, std::complex<float>* output) override;
+    bool transformReal(const float* input, std::complex<float>* output) override;
+    bool transformBatch(const float* inputs, size_t count, std::complex<float>* outputs) override;
 
 private:
     size_t size_ = 0;
     DFTI_DESCRIPTOR_HANDLE descriptor_ = nullptr;
-    std::vector<float> work_buffer_;
+    // 批量变换的描述符，变换数量在提交时固定，数量变化时重新创建
+    DFTI_DESCRIPTOR_HANDLE batch_descriptor_ = nullptr;
+    size_t batch_count_ = 0;
+
+    bool prepareBatchDescriptor(size_t count);
 };
 
 } // namespace afp 
\ No newline at end of file
@@ -0,0 +1,30 @@
+#pragma once
+#include "fft_interface.h"
+#include <vector>
+
+namespace afp {
+
+// 不依赖第三方库的实数FFT，桌面和服务器平台的默认实现
+// size点实数输入打包成size/2点复数做基2迭代FFT，再拆分出实数序列的频谱
+// 复数数据按实部、虚部分开存放，每一级的旋转因子连续存放，蝶形运算的内层循环可由编译器向量化
+// 输出按1/size缩放，与Accelerate、MKL后端一致；size必须是2的幂且不小于4
+class NativeFFT : public FFTInterface {
+public:
+    bool init(size_t size) override;
+    bool transform(const float* input, std::complex<float>* output) override;
+    bool transformReal(const float* input, std::complex<float>* output) override;
+    bool transformBatch(const float* inputs, size_t count, std::complex<float>* outputs) override;
+
+private:
+    size_t size_ = 0;
+    size_t half_ = 0;                       // 复数FFT的点数
+    std::vector<uint32_t> bit_reverse_;     // 复数FFT输入的位反转下标
+    std::vector<float> stage_twiddle_real_;  // 各级旋转因子，长度为h的一级从下标h-1开始
+    std::vector<float> stage_twiddle_imag_;
+    std::vector<float> split_twiddle_real_;  // 拆分实数频谱用的旋转因子 e^{-2πik/size}
+    std::vector<float> split_twiddle_imag_;
+    std::vector<float> work_real_;
+    std::vector<float> work_imag_;
+};
+
+} // namespace afp
@@ -0,0 +1,55 @@
+#include "fft_ne10.h"
+#include <algorithm>
+
+namespace afp {
+
+Ne10FFT::~Ne10FFT() {
+    if (cfg_) {
+        ne10_fft_destroy_r2c_float32(cfg_);
+    }
+}
+
+bool Ne10FFT::init(size_t size) {
+    // Ne10的r2c变换要求点数是2的幂
+    if (size < 4 || (size & (size - 1)) != 0) {
+        return false;
+    }
+    size_ = size;
+
+    cfg_ = ne10_fft_alloc_r2c_float32(static_cast<ne10_int32_t>(size_));
+    if (!cfg_) {
+        return false;
+    }
+    buffer_.resize(size_);
+    output_.resize(size_ / 2 + 1);
+    return true;
+}
+
+bool Ne10FFT::transform(const float* input, std::complex<float>* output) {
+    return transformReal(input, output);
+}
+
+bool Ne10FFT::transformReal(const float* input, std::complex<float>* output) {
+    std::copy(input, input + size_, buffer_.begin());
+    ne10_fft_r2c_1d_float32_neon(output_.data(), buffer_.data(), cfg_);
+
+    // Ne10正变换不缩放，按1/size缩放以与其他后端一致
+    const float scale = 1.0f / static_cast<float>(size_);
+    for (size_t i = 0; i <= size_ / 2; ++i) {
+        output[i] = std::complex<float>(output_[i].r * scale, output_[i].i * scale);
+    }
+    return true;
+}
+
+bool Ne10FFT::transformBatch(const float* inputs, size_t count, std::complex<float>* outputs) {
+    // 配置按单个窗口分配，批量时依次执行，旋转因子表在各窗口之间保持在缓存中
+    const size_t bins = size_ / 2 + 1;
+    for (size_t i = 0; i < count; ++i) {
+        if (!transformReal(inputs + i * size_, outputs + i * bins)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace afp
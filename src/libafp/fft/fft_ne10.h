@@ -1,19 +1,26 @@
 #pragma once
 #include "fft_interface.h"
 #include <Ne10.h>
+#include <vector>
 
 namespace afp {
 
+// 基于Ne10的实数FFT，Android平台在third_party/Ne10存在时编译（定义AFP_HAVE_NE10）
+// 按大小分配一次r2c配置，之后每次变换直接调用NEON实现；size必须是2的幂，不支持的大小初始化失败，由工厂退回内置实现
+// 输出按1/size缩放，与其他后端一致
 class Ne10FFT : public FFTInterface {
 public:
     ~Ne10FFT() override;
     bool init(size_t size) override;
     bool transform(const float* input, std::complex<float>* output) override;
+    bool transformReal(const float* input, std::complex<float>* output) override;
+    bool transformBatch(const float* inputs, size_t count, std::complex<float>* outputs) override;
 
 private:
     size_t size_ = 0;
-    ne10_fft_cfg_float32_t cfg_ = nullptr;
-    std::vector<ne10_float32_t> buffer_;
+    ne10_fft_r2c_cfg_float32_t cfg_ = nullptr;
+    std::vector<ne10_float32_t> buffer_;           // Ne10的输入参数不是const，先复制到这里
+    std::vector<ne10_fft_cpx_float32_t> output_;   // size/2+1个bin
 };
 
-} // namespace afp 
\ No newline at end of file
+} // namespace afp
@@ -1,10 +1,18 @@
 #pragma once
 
 #include <memory>
+#include <string>
+#include <vector>
 #include "afp/icatalog.h"
+#include "afp/icatalog_index.h"
+#include "afp/catalog_publisher.h"
 #include "afp/isignature_generator.h"
 #include "afp/imatcher.h"
+#include "afp/imatch_engine.h"
+#include "afp/icatalog_shard.h"
 #include "afp/iperformance_config.h"
+#include "afp/performance_config_factory.h"
+#include "afp/signature_batch.h"
 
 namespace afp::interface {
 
@@ -18,7 +26,14 @@ std::shared_ptr<ISignatureGenerator> createSignatureGenerator(
 
 // 创建PerformanceConfig对象
 std::shared_ptr<IPerformanceConfig> createPerformanceConfig(
-    PlatformType platform);
+    PlatformType platform,
+    const PerformanceConfigOptions& options = {});
+
+// 按本机的实测性能选择PerformanceConfig对象，见PerformanceConfigFactory::calibrate
+std::shared_ptr<IPerformanceConfig> calibratePerformanceConfig(
+    const CalibrationRequest& request,
+    CalibrationResult* result = nullptr,
+    const PerformanceConfigOptions& options = {});
 
 // 创建Matcher对象
 std::shared_ptr<IMatcher> createMatcher(
@@ -26,4 +41,77 @@ std::shared_ptr<IMatcher> createMatcher(
     std::shared_ptr<IPerformanceConfig> config,
     const PCMFormat& format);
 
+// 创建CatalogIndex对象：由catalog构建一次只读倒排索引，可传给多个createMatcher共享
+std::shared_ptr<const ICatalogIndex> createCatalogIndex(
+    std::shared_ptr<ICatalog> catalog);
+
+// 创建CatalogIndex对象，按config的匹配配置忽略停用哈希（maxHashDocumentFrequency/maxPostingsPerHash）
+std::shared_ptr<const ICatalogIndex> createCatalogIndex(
+    std::shared_ptr<ICatalog> catalog,
+    std::shared_ptr<IPerformanceConfig> config);
+
+// 把catalog的倒排记录长度统计（不忽略停用哈希）写入文本文件，用于选择停用哈希阈值
+// 保存catalog时不会自动生成统计文件，惯例是保存在catalog文件旁边、文件名加".hashstats"后缀
+bool writeCatalogIndexStatistics(std::shared_ptr<ICatalog> catalog, const std::string& filename);
+
+// 复制一份倒排索引，见CatalogIndex::replicate：在绑定到某个NUMA节点的线程上调用，得到该节点本地内存中的副本，
+// 该节点上的Matcher/MatchEngine共享这份副本，查询时不再跨节点访问索引；index不是由createCatalogIndex创建时返回nullptr
+std::shared_ptr<const ICatalogIndex> replicateCatalogIndex(
+    std::shared_ptr<const ICatalogIndex> index);
+
+// 创建共享倒排索引的Matcher对象，index必须由同一个catalog构建
+std::shared_ptr<IMatcher> createMatcher(
+    std::shared_ptr<ICatalog> catalog,
+    std::shared_ptr<const ICatalogIndex> index,
+    std::shared_ptr<IPerformanceConfig> config,
+    const PCMFormat& format);
+
+// 创建目录快照发布器，用于在Matcher运行期间热替换catalog及其索引
+std::shared_ptr<CatalogPublisher> createCatalogPublisher();
+
+// 创建跟随发布器快照的Matcher对象，publisher必须已发布过快照
+std::shared_ptr<IMatcher> createMatcher(
+    std::shared_ptr<CatalogPublisher> publisher,
+    std::shared_ptr<IPerformanceConfig> config,
+    const PCMFormat& format);
+
+// 创建多路流匹配引擎，所有流共享index；index为空时由catalog构建一次
+std::shared_ptr<IMatchEngine> createMatchEngine(
+    std::shared_ptr<ICatalog> catalog,
+    std::shared_ptr<const ICatalogIndex> index,
+    std::shared_ptr<IPerformanceConfig> config);
+
+// 创建跟随发布器快照的多路流匹配引擎，publisher必须已发布过快照
+std::shared_ptr<IMatchEngine> createMatchEngine(
+    std::shared_ptr<CatalogPublisher> publisher,
+    std::shared_ptr<IPerformanceConfig> config);
+
+// 把catalog按目标指纹的全局id划分为shardCount个分片catalog（全局id为g的指纹属于第g % shardCount个分片），
+// 各分片可分别saveToFile后部署到不同节点，见ICatalogShard
+std::vector<std::shared_ptr<ICatalog>> partitionCatalog(const ICatalog& catalog, size_t shardCount);
+
+// 创建服务一个目录分片的ICatalogShard，catalog为partitionCatalog生成的第shardIndex个分片；
+// index为空时由catalog按config的匹配配置构建
+std::shared_ptr<ICatalogShard> createCatalogShard(
+    std::shared_ptr<ICatalog> catalog,
+    std::shared_ptr<const ICatalogIndex> index,
+    std::shared_ptr<IPerformanceConfig> config,
+    size_t shardIndex,
+    size_t shardCount);
+
+// 创建散射-聚合匹配前端，shards[i]的shardIndex()必须为i、shardCount()为shards.size()，不满足时返回nullptr；
+// 分片可以是本进程的createCatalogShard，也可以是调用方实现的远程代理
+std::shared_ptr<IScatterGatherMatcher> createScatterGatherMatcher(
+    std::vector<std::shared_ptr<ICatalogShard>> shards,
+    std::shared_ptr<IPerformanceConfig> config);
+
+// 把catalog的内容作为一个新段追加到分段目录directory中，目录不存在时自动创建
+bool appendCatalogSegment(const std::string& directory, const ICatalog& catalog);
+
+// 按顺序加载分段目录中的所有段，失败时返回nullptr
+std::shared_ptr<ICatalog> loadCatalogSegments(const std::string& directory);
+
+// 把分段目录中的所有段合并为一个段（离线执行，不能与追加同时进行）
+bool compactCatalogSegments(const std::string& directory, bool storeSideTables = true);
+
 } // namespace afp::interface 
\ No newline at end of file
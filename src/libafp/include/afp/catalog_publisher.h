@@ -0,0 +1,40 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include "afp/icatalog.h"
+#include "afp/icatalog_index.h"
+
+namespace afp {
+
+// 目录快照：catalog及其倒排索引，发布后不可变
+struct CatalogSnapshot {
+    std::shared_ptr<ICatalog> catalog;
+    std::shared_ptr<const ICatalogIndex> index;
+    uint64_t version;  // 发布序号，从1开始递增
+};
+
+// 目录快照发布器（RCU风格）
+// 更新目录时在后台构建好新的catalog和索引后调用publish原子替换当前快照，正在运行的Matcher
+// 在处理下一个音频缓冲时切换到新快照，无需销毁重建；旧快照由shared_ptr引用计数管理，
+// 不再被任何Matcher及其进行中的session持有时自动释放
+class CatalogPublisher {
+public:
+    CatalogPublisher() = default;
+
+    // 禁用拷贝构造和赋值
+    CatalogPublisher(const CatalogPublisher&) = delete;
+    CatalogPublisher& operator=(const CatalogPublisher&) = delete;
+
+    // 发布新快照，index为空时在调用线程上由catalog构建；catalog为空时返回false
+    bool publish(std::shared_ptr<ICatalog> catalog, std::shared_ptr<const ICatalogIndex> index = nullptr);
+
+    // 获取当前快照，尚未发布时返回nullptr
+    std::shared_ptr<const CatalogSnapshot> current() const;
+
+private:
+    std::shared_ptr<const CatalogSnapshot> snapshot_;  // 只通过std::atomic_load/std::atomic_store访问
+    std::atomic<uint64_t> nextVersion_{1};
+};
+
+} // namespace afp
@@ -1,11 +1,32 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include "afp/isignature_generator.h"
 #include "afp/media_item.h"
+#include "afp/memory_usage.h"
 
 namespace afp {
 
+// 目录中一条指纹的只读紧凑视图（SoA）：逐点存储哈希和时间戳表下标，时间戳去重后单独成表
+// 指向catalog内部的数据，catalog被修改（addSignature、loadFromFile、appendFromFile）后失效
+struct SignatureView {
+    const uint32_t* hashes = nullptr;
+    const uint32_t* timeIndices = nullptr;
+    const double* timestamps = nullptr;     // 去重时间戳表
+    size_t count = 0;
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    uint32_t hash(size_t i) const { return hashes[i]; }
+    double timestamp(size_t i) const { return timestamps[timeIndices[i]]; }
+};
+
+// 指纹目录
+// 指纹在内存中以紧凑表示存放，匹配器和倒排索引通过signatureView读取，频率/振幅附表按需解码
+// 加载或添加完成后只读：const方法可在多个线程上并发调用（按需解码和展开的内容在内部加锁），
+// 多个线程上的Matcher/MatchEngine可共享同一个catalog；addSignature、loadFromFile、appendFromFile不能与任何线程上的读取并发
 class ICatalog {
 public:
     virtual ~ICatalog() = default;
@@ -20,11 +41,27 @@ public:
     // 从文件反序列化
     virtual bool loadFromFile(const std::string& filename) = 0;
 
-    // 获取所有指纹
+    // 从文件反序列化并追加到现有内容之后（用于加载多个目录段）
+    virtual bool appendFromFile(const std::string& filename) = 0;
+
+    // 指纹数量
+    virtual size_t signatureCount() const = 0;
+
+    // 第index条指纹的紧凑视图，不含频率/振幅
+    virtual SignatureView signatureView(size_t index) const = 0;
+
+    // 第index条指纹的第pointIndex个指纹点；频率/振幅附表在第一次访问该指纹时解码，没有附表时为0
+    virtual SignaturePoint signaturePoint(size_t index, size_t pointIndex) const = 0;
+
+    // 获取所有指纹的SignaturePoint数组
+    // 第一次调用时由紧凑表示展开并缓存，每点24字节，远大于紧凑表示；只用于调试输出，匹配和建索引不调用
     virtual const std::vector<std::vector<SignaturePoint>>& signatures() const = 0;
 
     // 获取所有媒体信息
     virtual const std::vector<MediaItem>& mediaItems() const = 0;
+
+    // 指纹和媒体信息占用的内存，不含倒排索引（见ICatalogIndex::memoryUsage）
+    virtual CatalogMemoryUsage memoryUsage() const = 0;
 };
 
 } // namespace afp 
\ No newline at end of file
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include "afp/memory_usage.h"
+
+namespace afp {
+
+// 倒排记录：指向catalog中某个指纹点
+struct IndexPosting {
+    uint32_t signatureIndex;  // 目标指纹在catalog中的下标
+    uint32_t pointIndex;      // 指纹点在目标指纹中的下标
+};
+
+// 只读的哈希倒排索引
+// 由catalog构建一次后通过shared_ptr在多个Matcher之间共享，构建后不可变，并发查询无需加锁
+// 索引中的下标指向构建时的catalog，构建索引后不应再修改该catalog
+// 多路CPU插槽的机器上可用replicateCatalogIndex为每个NUMA节点复制一份，避免跨节点访问
+class ICatalogIndex {
+public:
+    virtual ~ICatalogIndex() = default;
+
+    // 查找哈希值对应的倒排记录，返回[begin, end)，未命中时begin == end
+    virtual std::pair<const IndexPosting*, const IndexPosting*> find(uint32_t hash) const = 0;
+
+    // 批量查找count个哈希，第i个结果写入ranges[i]，与逐个调用find的结果相同
+    // hashes按升序排列且去重时相邻的查找沿索引的同一段前进，缓存命中率最高；实现可以交错多个查找并预取
+    virtual void findBatch(const uint32_t* hashes, size_t count,
+                           std::pair<const IndexPosting*, const IndexPosting*>* ranges) const {
+        for (size_t i = 0; i < count; ++i) {
+            ranges[i] = find(hashes[i]);
+        }
+    }
+
+    // 唯一哈希值数量
+    virtual size_t hashCount() const = 0;
+
+    // 倒排记录数量（等于catalog中的指纹点总数）
+    virtual size_t postingCount() const = 0;
+
+    // 是否为空
+    virtual bool empty() const = 0;
+
+    // 哈希数组、倒排记录和辅助结构占用的内存
+    virtual IndexMemoryUsage memoryUsage() const = 0;
+};
+
+} // namespace afp
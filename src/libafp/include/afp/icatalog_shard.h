@@ -0,0 +1,81 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "afp/imatcher.h"
+#include "afp/imatch_engine.h"
+
+namespace afp {
+
+// 分片对一批查询指纹点的粗筛候选
+struct ShardVote {
+    uint32_t signatureId;  // 目标指纹的全局id
+    uint32_t score;        // 本批得分，见MatchingConfig::coarseVoteTopMedia
+};
+
+// 分片判定的匹配结果
+struct ShardMatch {
+    uint32_t signatureId;  // 目标指纹的全局id
+    MatchResult result;    // mediaItem和targetCatalog指向分片的catalog，跨节点传输时由调用方按signatureId换成本地的媒体信息
+};
+
+// 目录分片：catalog按目标指纹的全局id划分为shardCount份（见interface::partitionCatalog），
+// 每个分片有自己的catalog和倒排索引，可部署在不同节点上，单个节点只需容纳一个分片
+// 前端（IScatterGatherMatcher）把每批查询指纹点发给所有分片，分两步完成匹配：
+//   1. vote：分片查找本批指纹点并按目标指纹粗筛计票，返回本分片得分最高的候选
+//   2. match：前端把各分片的候选合并为全局前coarseVoteTopMedia名，分片只对其中属于自己的目标指纹做session匹配和
+//      minMatchesRequired/置信度判定，返回匹配结果
+// 粗筛的全局排名与不分片时相同；session数量上限（maxCandidates）按每个分片的每路流计
+// 同一路流的两步必须成对依次调用；不同的分片对象可在不同线程上并发调用，同一个分片对象不是线程安全的
+// 跨节点部署时由调用方实现转发请求的ICatalogShard代理，查询指纹点可用SignatureBatchCodec编码
+class ICatalogShard {
+public:
+    virtual ~ICatalogShard() = default;
+
+    // 本分片的序号和分片总数
+    virtual size_t shardIndex() const = 0;
+    virtual size_t shardCount() const = 0;
+
+    // 添加一路流，channelCount为查询音频的通道数（用于置信度计算）；streamId已存在时返回false
+    virtual bool addStream(StreamId streamId, size_t channelCount) = 0;
+
+    // 移除一路流及其session，streamId不存在时返回false
+    virtual bool removeStream(StreamId streamId) = 0;
+
+    // 第一步：查找一批查询指纹点并计票，本分片的候选按signatureId升序写入votes，未开启粗筛时为空
+    // 本批的查找结果保留到match；streamId不存在时返回false
+    virtual bool vote(StreamId streamId, const SignaturePoint* points, size_t count, std::vector<ShardVote>& votes) = 0;
+
+    // 第二步：selected为全局前K名中属于本分片的signatureId（升序），未开启粗筛时忽略；
+    // 本批判定的匹配结果写入matches；streamId不存在或之前没有调用vote时返回false
+    virtual bool match(StreamId streamId, const uint32_t* selected, size_t selectedCount,
+                       std::vector<ShardMatch>& matches) = 0;
+};
+
+// 散射-聚合匹配前端：每批查询指纹点并行发给所有分片，合并各分片的粗筛候选后再并行完成session匹配，
+// 按signatureId的顺序通知各分片的匹配结果；catalog的容量随分片（节点）数扩展，单批的匹配延迟取决于最慢的分片
+// 不是线程安全的
+class IScatterGatherMatcher {
+public:
+    using MatchCallback = std::function<void(StreamId, const ShardMatch&)>;
+
+    virtual ~IScatterGatherMatcher() = default;
+
+    // 在所有分片上添加一路流，任一分片失败时撤销已添加的分片并返回false
+    virtual bool addStream(StreamId streamId, size_t channelCount) = 0;
+
+    // 在所有分片上移除一路流，streamId不存在时返回false
+    virtual bool removeStream(StreamId streamId) = 0;
+
+    // 匹配一路流的一批查询指纹点，时间戳需接着该流之前的输入递增；streamId不存在或分片请求失败时返回false
+    virtual bool appendSignaturePoints(StreamId streamId, const SignaturePoint* points, size_t count) = 0;
+
+    // 用SignatureBatchCodec编码的查询指纹点批次匹配一路流，其余同appendSignaturePoints
+    virtual bool appendSignatureBatch(StreamId streamId, const uint8_t* data, size_t size) = 0;
+
+    // 设置匹配回调，在调用appendSignaturePoints的线程上调用
+    virtual void setMatchCallback(MatchCallback callback) = 0;
+};
+
+} // namespace afp
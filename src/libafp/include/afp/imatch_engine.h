@@ -0,0 +1,97 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "afp/imatcher.h"
+#include "afp/pcm_format.h"
+
+namespace afp {
+
+using StreamId = uint64_t;
+
+// 批量输入中的一个音频缓冲
+struct StreamBuffer {
+    StreamId streamId;
+    const void* buffer;
+    size_t bufferSize;
+    double startTimestamp;
+};
+
+// 多路流匹配引擎：一个对象服务多路音频流，所有流共享同一个catalog及其倒排索引
+// 每路流只保留自己的指纹生成状态；session状态（SignatureMatcher）在流有进行中的session时才占用，
+// 没有session时归还到引擎的池中供其他流复用，空闲流不再持有完整的匹配器
+// 不是线程安全的；回调中不能添加或移除流；多个线程可各自使用一个引擎，共享只读的catalog、索引和配置时无需加锁
+class IMatchEngine {
+public:
+    using MatchCallback = std::function<void(StreamId, const MatchResult&)>;
+    using StatsCallback = std::function<void(StreamId, const MatchStats&)>;
+
+    virtual ~IMatchEngine() = default;
+
+    // 添加一路流，streamId已存在时返回false
+    virtual bool addStream(StreamId streamId, const PCMFormat& format) = 0;
+
+    // 移除一路流及其所有状态，streamId不存在时返回false
+    virtual bool removeStream(StreamId streamId) = 0;
+
+    // 把一路流的检查点追加到out，格式与IMatcher::saveCheckpoint相同，用于把流迁移到其他引擎或匹配器；
+    // 之后照常输入可继续在本引擎上处理，也可移除本路流；streamId不存在时返回false
+    virtual bool saveStreamCheckpoint(StreamId streamId, std::vector<uint8_t>& out) = 0;
+
+    // 从检查点添加一路流，之后接着保存时的位置输入音频，匹配结果与未迁移的流一致
+    // streamId已存在、格式或配置与保存时不一致、数据不合法时返回false，此时不添加流
+    virtual bool restoreStream(StreamId streamId, const PCMFormat& format, const uint8_t* data, size_t size) = 0;
+
+    // 挂起一路流的指纹生成：把生成器的流状态（只含仍在分析窗口内的帧和未处理完的样本）保存下来后释放生成器，
+    // 挂起的流只占用这份状态，不再持有FFT和峰值检测的缓冲；下次输入音频或保存检查点时自动恢复，结果与未挂起时一致
+    // 适用于长时间没有输入的流；已挂起时返回true，streamId不存在时返回false
+    virtual bool suspendStream(StreamId streamId) = 0;
+
+    // 添加一路流的音频数据并立即匹配
+    virtual bool appendStreamBuffer(StreamId streamId,
+                                    const void* buffer,
+                                    size_t bufferSize,
+                                    double startTimestamp) = 0;
+
+    // 批量添加多路流的音频数据：先为所有流生成指纹，再依次匹配，匹配阶段连续访问同一份索引
+    // 同一路流可出现多次，按顺序拼接；返回处理成功的缓冲数量
+    virtual size_t appendStreamBuffers(const StreamBuffer* buffers, size_t count) = 0;
+
+    // 用已生成的查询指纹点（例如在客户端生成）匹配一路流，不经过该流的生成器；
+    // 时间戳需接着该流之前的输入递增，同一路流不应混用音频和指纹点输入；streamId不存在时返回false
+    virtual bool appendSignaturePoints(StreamId streamId, const SignaturePoint* points, size_t count) = 0;
+
+    // 用SignatureBatchCodec编码的查询指纹点批次匹配一路流，其余同appendSignaturePoints；
+    // streamId不存在或批次数据不合法时返回false
+    virtual bool appendSignatureBatch(StreamId streamId, const uint8_t* data, size_t size) = 0;
+
+    // 设置匹配回调，回调参数带有产生结果的streamId
+    virtual void setMatchCallback(MatchCallback callback) = 0;
+
+    // 设置诊断日志级别，默认Quiet
+    virtual void setLogLevel(MatcherLogLevel level) = 0;
+
+    // 设置统计回调，每路流每次匹配后调用一次，为空时不回调
+    virtual void setStatsCallback(StatsCallback callback) = 0;
+
+    // 流的数量
+    virtual size_t streamCount() const = 0;
+
+    // 持有session状态的流数量
+    virtual size_t activeStreamCount() const = 0;
+
+    // 已挂起指纹生成的流数量
+    virtual size_t suspendedStreamCount() const = 0;
+
+    // 所有流及匹配器池占用的内存，不含共享的catalog和索引
+    virtual MatchEngineMemoryUsage memoryUsage() const = 0;
+
+    // 一路流的延迟直方图，见MatchLatencyStats；processingMicros按批记录该流的指纹生成和匹配耗时
+    // streamId不存在时返回false；移除流时统计随之丢弃
+    virtual bool latencyStats(StreamId streamId, MatchLatencyStats& stats) const = 0;
+
+    // 所有流合并后的延迟直方图
+    virtual MatchLatencyStats latencyStats() const = 0;
+};
+
+} // namespace afp
@@ -1,8 +1,12 @@
 #pragma once
 #include <functional>
 #include <memory>
+#include <string>
+#include <vector>
+#include "afp/icatalog.h"
 #include "afp/media_item.h"
 #include "afp/isignature_generator.h"
+#include "afp/latency_histogram.h"
 
 namespace afp {
 
@@ -10,15 +14,76 @@ struct MatchResult {
     const MediaItem *mediaItem;
     double offset;           // 时间偏移（秒）
     double confidence;       // 匹配置信度
-    std::vector<SignaturePoint> matchedPoints;  // 匹配的点
+    std::vector<SignaturePoint> matchedPoints;  // 匹配的点，MatchingConfig::materializeMatchedPoints为false时为空
     size_t matchCount;
     size_t uniqueTimestampMatchCount;
     size_t id;               // 唯一标识符
+
+    // 匹配点的延迟视图：命中的源点在目标指纹中的下标，与matchedPoints一一对应
+    // 目标指纹是targetCatalog中的第targetSignatureIndex条，展开前需保证catalog仍然有效（与mediaItem相同）
+    const ICatalog* targetCatalog = nullptr;
+    size_t targetSignatureIndex = 0;
+    std::shared_ptr<const std::vector<uint32_t>> matchedPointIndices;
+
+    // 按需生成匹配点，matchedPoints已生成时直接返回其副本
+    std::vector<SignaturePoint> expandMatchedPoints() const {
+        if (!matchedPoints.empty() || !targetCatalog || !matchedPointIndices) {
+            return matchedPoints;
+        }
+        std::vector<SignaturePoint> points;
+        points.reserve(matchedPointIndices->size());
+        for (const auto pointIndex : *matchedPointIndices) {
+            points.push_back(targetCatalog->signaturePoint(targetSignatureIndex, pointIndex));
+        }
+        return points;
+    }
+};
+
+// 匹配器的诊断日志级别
+enum class MatcherLogLevel {
+    Quiet = 0,     // 不输出任何诊断信息，也不做只为日志服务的排序/统计
+    Info = 1,      // 输出目录切换、匹配成功等低频事件
+    Verbose = 2,   // 输出每次调用的查询指纹详情、候选列表及session的创建/合并/淘汰（需定义ENABLED_DIAGNOSE）
+};
+
+// 每次处理音频缓冲后的结构化统计，计数只包含本次调用
+struct MatchStats {
+    double timestamp = 0.0;            // 本次最后一个查询指纹点的时间戳
+    size_t queryPointCount = 0;        // 查询指纹点数
+    size_t queryHitCount = 0;          // 命中索引的查询指纹点数
+    size_t postingHitCount = 0;        // 命中的倒排记录数
+    size_t coarsePrunedPostingCount = 0; // 被粗筛投票过滤掉的倒排记录数
+    size_t resolvedSkippedPostingCount = 0; // 落在已通知session偏移附近、直接跳过的倒排记录数
+    size_t newSessionCount = 0;        // 新建的session数
+    size_t mergedSessionCount = 0;     // 合并到已有session的候选及被全局合并的session数
+    size_t evictedSessionCount = 0;    // 因计分淘汰被替换的session数
+    size_t rejectedSessionCount = 0;   // 因分数过低被忽略的候选数
+    size_t expiredSessionCount = 0;    // 过期移除的session数
+    size_t notifiedMatchCount = 0;     // 通知的匹配结果数
+    size_t activeSessionCount = 0;     // 处理后的活跃session数
 };
 
+// 匹配器的累计性能统计快照，见IMatcher::performanceStats
+struct MatcherPerformanceStats {
+    GeneratorPerformanceStats generator;    // 查询指纹生成的统计
+    uint64_t matchNanoseconds = 0;          // 倒排查找、session更新和结果通知的耗时
+    uint64_t queryPointCount = 0;           // 以下计数是各次调用的MatchStats之和
+    uint64_t queryHitCount = 0;
+    uint64_t postingHitCount = 0;
+    uint64_t newSessionCount = 0;
+    uint64_t evictedSessionCount = 0;
+    uint64_t notifiedMatchCount = 0;
+    size_t activeSessionCount = 0;          // 最近一次处理后的活跃session数
+    double realtimeFactor = 0.0;            // 生成和匹配在调用线程上的总耗时与音频时长之比
+};
+
+// 单路流匹配器，不是线程安全的：同一个对象同时只能由一个线程调用（performanceStats和结果队列的消费端除外）
+// 库中没有可变的全局状态，session只按指纹id引用目标，与catalog的内存地址无关；
+// 每个线程使用各自的匹配器、共享只读的catalog、索引和配置时无需加锁
 class IMatcher {
 public:
     using MatchCallback = std::function<void(const MatchResult&)>;
+    using StatsCallback = std::function<void(const MatchStats&)>;
 
     virtual ~IMatcher() = default;
 
@@ -29,6 +94,61 @@ public:
 
     // 设置匹配回调
     virtual void setMatchCallback(MatchCallback callback) = 0;
+
+    // 设置诊断日志级别，默认Verbose；生产环境使用Quiet
+    virtual void setLogLevel(MatcherLogLevel level) = 0;
+
+    // 设置统计回调，每次处理音频缓冲后调用一次，为空时不回调
+    virtual void setStatsCallback(StatsCallback callback) = 0;
+
+    // 获取累计性能统计的快照，计数以relaxed原子操作累加，可在任意线程上读取，不需要设置统计回调
+    virtual MatcherPerformanceStats performanceStats() const = 0;
+
+    // 查询指纹生成、session状态、匹配明细和结果队列占用的内存，不含共享的catalog和索引
+    // 需在调用appendStreamBuffer的线程上、两次调用之间读取
+    virtual MatcherMemoryUsage memoryUsage() const = 0;
+
+    // 检测延迟和每次调用的处理耗时直方图，见MatchLatencyStats；需在调用appendStreamBuffer的线程上、两次调用之间读取
+    virtual MatchLatencyStats latencyStats() const = 0;
+
+    // 清空延迟直方图，例如调整匹配阈值后重新统计
+    virtual void resetLatencyStats() = 0;
+
+    // 开启事件追踪：查询指纹生成各阶段的事件，以及每次匹配的耗时和session的创建、淘汰、合并、通知、过期，
+    // 分别记录到生成流水线和匹配器各自容量为capacity个事件的定长环形缓冲；capacity为0时关闭
+    virtual void enableTracing(size_t capacity) = 0;
+
+    // 把两个追踪缓冲中的事件以Chrome trace JSON格式写入同一个文件（生成和匹配各为一个进程）
+    virtual bool dumpTrace(const std::string& filename) const = 0;
+
+    // 设置查询侧匹配的线程数，threads > 1时倒排记录按目标指纹分片并行处理，适用于整段文件的离线匹配
+    // 应在第一次appendStreamBuffer之前设置；多线程时不收集可视化数据
+    // 各分片持有一份只含自己倒排记录的索引，合计约多占用一份索引的内存（MatcherMemoryUsage::shardIndexBytes）
+    virtual void setMatchThreads(size_t threads) = 0;
+
+    // 开启异步结果队列：之后匹配结果以移动方式写入容量为capacity的单生产者单消费者无锁队列，
+    // appendStreamBuffer不再同步调用匹配回调，也不会因消费者而阻塞；队列已满时丢弃新结果并计数
+    // 应在第一次appendStreamBuffer之前调用，只能有一个消费者线程
+    virtual void enableResultQueue(size_t capacity) = 0;
+
+    // 消费者线程调用：取出一个匹配结果，队列为空或未开启队列时立即返回false
+    virtual bool pollMatchResult(MatchResult& result) = 0;
+
+    // 消费者线程调用：最多等待timeoutSeconds秒，期间取到匹配结果时返回true
+    virtual bool waitMatchResult(MatchResult& result, double timeoutSeconds) = 0;
+
+    // 因队列已满被丢弃的匹配结果数量
+    virtual size_t droppedMatchResultCount() const = 0;
+
+    // 把流的检查点追加到out：查询指纹生成各阶段的缓冲和进行中的session，用于把流迁移到另一个进程或节点，
+    // 恢复后不需要重新填满FFT、峰值检测和长帧窗口，也不丢失已累积的session
+    // session按catalog中指纹的下标引用目标，恢复端需使用相同的catalog（或以它为前缀的快照）和配置
+    // 需在调用appendStreamBuffer的线程上、两次调用之间调用
+    virtual bool saveCheckpoint(std::vector<uint8_t>& out) = 0;
+
+    // 在第一次appendStreamBuffer之前恢复saveCheckpoint保存的检查点，之后接着保存时的位置输入音频，
+    // 匹配结果与未迁移的流一致；格式、配置不一致或数据不合法时返回false，匹配器保持刚构建时的状态
+    virtual bool restoreCheckpoint(const uint8_t* data, size_t size) = 0;
 };
 
 } // namespace afp 
\ No newline at end of file
@@ -12,13 +12,32 @@ enum class PlatformType {
     Server,     // 服务器端 - 匹配模式
     Mobile_Gen, // 移动端 - 生成模式 (优先精度)
     Desktop_Gen,// PC端 - 生成模式 (优先精度)
-    Server_Gen  // 服务器端 - 生成模式 (优先精度)
+    Server_Gen, // 服务器端 - 生成模式 (优先精度)
+    Mobile_LowEnd // 低端移动设备 - 匹配模式 (定点FFT、16位量化幅度，与Mobile_Gen的目录匹配)
 };
 
 // FFT相关配置
 struct FFTConfig {
     size_t fftSize;        // FFT窗口大小
     size_t hopSize;        // 帧移大小
+    // FFT前按最大频率低通并降采样，fftSize和hopSize按同一倍数缩小，时间和频率分辨率不变
+    // 只在fftSize、hopSize和采样率都能被降采样倍数整除时生效；各平台配置默认关闭，见PerformanceConfigOptions
+    bool enableDecimation;
+    // 幅度谱使用功率域和向量化的近似对数计算，与逐bin的std::abs+log10相差不到1e-3dB
+    // 生成和匹配两端应使用相同的设置
+    bool fastLogMagnitude;
+    // 静音门限：FFT输入（预加重、降采样之后）窗口的RMS低于此值时不做FFT，直接生成幅度全为0的短帧，
+    // 检测窗口内全是这样的短帧时也跳过峰值提取，时间戳照常推进。0表示关闭
+    // 生成和匹配两端应使用相同的设置
+    float silenceGateRms;
+    // 使用Q15块浮点的定点FFT（见fft/fft_fixed_point.h），面向没有高效浮点单元的低端设备
+    // 可与浮点配置生成的目录匹配：test_pcm上浮点FFT生成的(哈希, 时间戳)约98%在定点FFT下保持不变
+    bool fixedPointFft;
+    // 对数幅度的量化位数：0表示不量化；16时量化到[0, 256)dB上步长1/256dB的网格，8时量化到[0, 128)dB上步长0.5dB的网格
+    // 量化后的幅度可以无损存为uint16/uint8，峰值检测中的比较与在整数频谱上比较等价
+    // 16位与浮点目录兼容（与定点FFT一起时test_pcm上约97%的哈希不变）；8位时相邻bin大量相等，
+    // 只剩约15%的哈希不变，只能用于生成和匹配两端都使用8位的场合
+    uint32_t magnitudeQuantizationBits;
 };
 
 // 峰值检测配置
@@ -54,6 +73,19 @@ struct SignatureGenerationConfig {
     
     // 扩展三帧选取配置
     size_t symmetricFrameRange;   // 对称帧范围n，生成(x-n,x,x+n)到(x-1,x,x+1)的组合
+
+    // 低延迟流式模式的延迟预算（毫秒），0表示关闭，用于实时同步等需要尽快得到指纹点的场景
+    // 开启后输入按帧移为粒度送入流水线；三帧组合(x-d,x,x+d)在最新的x+d帧到达时立即生成，而不是等到x+n帧，
+    // 生成的组合与对称方式相同，因此与关闭时生成的指纹库兼容；
+    // 预算小于固定开销（输入帧移、峰值检测的时间保护区、长帧时长和一个长帧的组合等待）与峰值检测窗口之和时，缩短峰值检测窗口
+    // 各平台配置默认关闭，通过PerformanceConfigOptions::streamingLatencyBudgetMs开启
+    double streamingLatencyBudgetMs;
+
+    // 自适应降级：处理时间与音频时长之比（实时率）的目标上限，0表示关闭
+    // 每处理约1秒音频评估一次，超过目标时逐级把maxPeaksPerFrameLimit、maxTripleFrameCombinations和symmetricFrameRange减半，
+    // 低于目标的一半时逐级恢复；降级只减少峰值和组合的数量，生成的hash与不降级时兼容
+    // 匹配平台配置默认开启，离线处理可用PerformanceConfigOptions::adaptiveDegradation关闭
+    double targetRealtimeFactor;
 };
 
 // 匹配配置
@@ -65,8 +97,19 @@ struct MatchingConfig {
     size_t minMatchesRequired;    // 最小匹配点数要求
     size_t minMatchesUniqueTimestampRequired; // 最小unique时间戳数量要求
     double offsetTolerance;       // 时间偏移容忍度 (秒)
+    // 停用哈希：静音、单音、背景音乐等产生的哈希在目录中大量重复，每次命中都会展开成大量候选session
+    // 建索引时统计每个哈希的倒排记录，超过阈值的哈希在查询时直接忽略，0表示不限制
+    size_t maxHashDocumentFrequency; // 哈希出现的目标指纹数量上限
+    size_t maxPostingsPerHash;       // 单个哈希的倒排记录数量上限
+    // 粗筛投票：每批查询先按(目标指纹, 粗偏移桶)计票，只有得票最高的若干目标指纹进入session匹配，
+    // 已有session的目标指纹不受影响；0表示不做粗筛
+    size_t coarseVoteTopMedia;       // 每批进入session匹配的目标指纹数量
+    size_t coarseVoteBucketMs;       // 粗偏移桶宽度（毫秒）
+    // 是否在匹配结果中直接生成matchedPoints；为false时只附带命中下标，由调用方按需展开
+    bool materializeMatchedPoints;
 };
 
+// 性能配置，创建后只读，可在多个线程之间共享
 class IPerformanceConfig {
 public:
     virtual ~IPerformanceConfig() = default;
@@ -1,5 +1,9 @@
 #pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
 #include <vector>
+#include "afp/memory_usage.h"
 #include "afp/pcm_format.h"
 
 namespace afp {
@@ -11,8 +15,48 @@ struct SignaturePoint {
     uint32_t amplitude;      // 振幅
 };
 
+// 自适应降级的状态，降级级别变化时报告，见SignatureGenerationConfig::targetRealtimeFactor
+struct DegradationStats {
+    double realtimeFactor;              // 触发变化的评估周期内处理时间与音频时长之比
+    size_t level;                       // 变化后的降级级别，0表示按配置全量处理
+    size_t maxPeaksPerFrame;            // 变化后生效的每帧最多峰值数
+    size_t maxTripleFrameCombinations;  // 变化后生效的每个三帧窗口最多组合数
+    size_t symmetricFrameRange;         // 变化后生效的对称帧范围
+};
+
+// 流水线中一个阶段的累计统计
+struct PipelinePhaseStats {
+    uint64_t nanoseconds = 0;   // 阶段自身的耗时，不含它同步调用的下游阶段
+    uint64_t itemsIn = 0;       // 输入的数量，单位见GeneratorPerformanceStats中各阶段的说明
+    uint64_t itemsOut = 0;      // 输出的数量
+};
+
+// 指纹生成的累计性能统计快照，见ISignatureGenerator::performanceStats
+// 各项由所在线程以relaxed原子操作累加，线程模式下读取时后台线程可能正在更新，各项之间不保证严格一致
+struct GeneratorPerformanceStats {
+    PipelinePhaseStats channelSplit;        // 输入：样本数（各通道合计，下同），输出：送入下一阶段的样本数
+    PipelinePhaseStats emphasis;            // 输入/输出：样本数
+    PipelinePhaseStats decimation;          // 输入：样本数，输出：降采样后的样本数
+    PipelinePhaseStats fft;                 // 输入：样本数，输出：短帧数
+    PipelinePhaseStats peakDetection;       // 输入：短帧数，输出：峰值数
+    PipelinePhaseStats longFrameBuilding;   // 输入：峰值数，输出：长帧数
+    PipelinePhaseStats hashComputation;     // 输入：长帧数，输出：指纹点数
+    uint64_t silentWindowCount = 0;         // 短帧中因静音跳过FFT的数量
+    uint64_t handoffNanoseconds = 0;        // 线程模式下FFT阶段把短帧交给后台线程的耗时，包括队列满时的等待
+    uint64_t deliveryNanoseconds = 0;       // 把指纹点交给输出回调的耗时
+    double audioSeconds = 0.0;              // 已输入的音频时长
+    double processingSeconds = 0.0;         // appendStreamBuffer和flush在调用线程上的总耗时
+    double realtimeFactor = 0.0;            // processingSeconds与audioSeconds之比
+    size_t degradationLevel = 0;            // 当前的自适应降级级别
+};
+
+// 指纹生成器，不是线程安全的：同一个对象同时只能由一个线程调用（performanceStats除外）
+// 库中没有可变的全局状态，各线程使用各自的生成器时无需加锁
 class ISignatureGenerator {
 public:
+    using SignatureSink = std::function<void(const std::vector<SignaturePoint>&)>;
+    using DegradationCallback = std::function<void(const DegradationStats&)>;
+
     virtual ~ISignatureGenerator() = default;
 
     // 初始化生成器
@@ -28,9 +72,50 @@ public:
 
     // 获取生成的指纹
     virtual std::vector<SignaturePoint> signature() const = 0;
+
+    // 移出已生成的指纹（不拷贝），移出后内部不再保留
+    virtual std::vector<SignaturePoint> takeSignature() = 0;
+
+    // 设置指纹点输出回调：设置后每批新生成的指纹点直接交给回调，不再在内部累积
+    // 内存占用只与流水线窗口相关；传入空回调恢复内部累积
+    virtual void setSignatureSink(SignatureSink sink) = 0;
     
     // 重置所有已生成的签名
     virtual void resetSignatures() = 0;
+
+    // 设置自适应降级的状态回调，降级级别每次变化时在appendStreamBuffer的调用线程上调用；传入空回调取消
+    virtual void setDegradationCallback(DegradationCallback callback) = 0;
+
+    // 获取累计性能统计的快照，可在任意线程上调用，init之前返回全零
+    virtual GeneratorPerformanceStats performanceStats() const = 0;
+
+    // 流水线各阶段缓冲和内部累积的指纹点占用的内存
+    // 需在调用appendStreamBuffer的线程上、两次调用之间读取；启用流水线线程模式时在flush之后读取
+    virtual GeneratorMemoryUsage memoryUsage() const = 0;
+
+    // 开启事件追踪：各阶段的进出、FFT窗口、峰值检测窗口和输出的指纹点数记录到容量为capacity个事件的定长环形缓冲，
+    // 写满后覆盖最旧的事件；关闭时每个记录点只有一次原子读取和分支。capacity为0时关闭，容量在第一次开启时确定
+    virtual void enableTracing(size_t capacity) = 0;
+
+    // 把追踪缓冲中的事件以Chrome trace JSON格式写入文件，可用chrome://tracing或Perfetto打开，可在处理过程中调用
+    virtual bool dumpTrace(const std::string& filename) const = 0;
+
+    // 启用流水线线程模式：FFT及之前在调用线程上执行，峰值检测和hash计算在后台线程上执行，两者通过无锁队列衔接
+    // 指纹点仍在调用线程上输出，但可能延后到之后的appendStreamBuffer或flush；flush之后的结果与同步模式完全一致
+    // 需在init之前调用
+    virtual void enablePipelineThreading(bool enable) = 0;
+
+    // 启用通道并行：多声道音频的峰值检测、长帧构建和hash计算按通道分发到工作线程，输出与逐通道处理完全一致
+    // 需在init之前调用
+    virtual void enableChannelParallelism(bool enable) = 0;
+
+    // 把流的生成状态（各阶段的缓冲、尚未凑满的样本和长帧等）追加到out，用于把流迁移到另一个生成器后无缝继续
+    // 线程模式下先等待后台线程处理完已提交的数据，期间生成的指纹点照常输出；init之前返回false
+    virtual bool saveState(std::vector<uint8_t>& out) = 0;
+
+    // 在init之后、输入任何数据之前恢复saveState保存的状态，之后的输出与未迁移的流逐位一致
+    // 格式或配置与保存时不一致、数据不合法时返回false，生成器保持原状
+    virtual bool restoreState(const uint8_t* data, size_t size) = 0;
 };
 
 } // namespace afp 
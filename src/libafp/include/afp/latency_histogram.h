@@ -0,0 +1,139 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace afp {
+
+// HDR风格的延迟直方图：对数线性分桶，每个2的幂区间再均分为kSubBucketCount个子桶，
+// 任意值的相对误差不超过1/kSubBucketCount（约3%）；小于2*kSubBucketCount的值精确记录
+// 固定大小、不分配堆内存，记录为O(1)；超过kMaxValue的值按kMaxValue记录
+// 不是线程安全的
+class LatencyHistogram {
+public:
+    static constexpr uint32_t kSubBucketBits = 5;
+    static constexpr uint64_t kSubBucketCount = uint64_t{1} << kSubBucketBits;
+    static constexpr uint32_t kMaxValueBits = 40;
+    static constexpr uint64_t kMaxValue = (uint64_t{1} << kMaxValueBits) - 1;
+    static constexpr size_t kBucketCount = (kMaxValueBits - kSubBucketBits) * kSubBucketCount + kSubBucketCount;
+
+    void record(uint64_t value) {
+        value = std::min(value, kMaxValue);
+        ++counts_[bucketIndex(value)];
+        ++count_;
+        sum_ += value;
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+    }
+
+    // 合并另一个直方图的所有记录
+    void merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < kBucketCount; ++i) {
+            counts_[i] += other.counts_[i];
+        }
+        count_ += other.count_;
+        sum_ += other.sum_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+
+    void reset() {
+        *this = LatencyHistogram();
+    }
+
+    uint64_t count() const { return count_; }
+    uint64_t min() const { return count_ ? min_ : 0; }
+    uint64_t max() const { return max_; }
+    double mean() const { return count_ ? static_cast<double>(sum_) / static_cast<double>(count_) : 0.0; }
+
+    // 百分位数（0-100），返回对应子桶的上界，不超过记录到的最大值；没有记录时返回0
+    uint64_t valueAtPercentile(double percentile) const {
+        if (count_ == 0) {
+            return 0;
+        }
+        percentile = std::min(std::max(percentile, 0.0), 100.0);
+        auto target = static_cast<uint64_t>(percentile / 100.0 * static_cast<double>(count_) + 0.5);
+        target = std::max<uint64_t>(target, 1);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBucketCount; ++i) {
+            seen += counts_[i];
+            if (seen >= target) {
+                return std::min(std::max(bucketUpperBound(i), min_), max_);
+            }
+        }
+        return max_;
+    }
+
+    // 按子桶遍历所有非空的记录：visitor(lowerBound, upperBound, count)
+    template<typename Visitor>
+    void forEachBucket(Visitor&& visitor) const {
+        for (size_t i = 0; i < kBucketCount; ++i) {
+            if (counts_[i] != 0) {
+                visitor(bucketLowerBound(i), bucketUpperBound(i), counts_[i]);
+            }
+        }
+    }
+
+private:
+    // 小于2*kSubBucketCount的值直接作下标；更大的值按最高位确定区间，取最高kSubBucketBits+1位作子桶
+    static size_t bucketIndex(uint64_t value) {
+        if (value < 2 * kSubBucketCount) {
+            return static_cast<size_t>(value);
+        }
+        uint32_t msb = 63;
+        while ((value >> msb) == 0) {
+            --msb;
+        }
+        const uint32_t shift = msb - kSubBucketBits;
+        return static_cast<size_t>(shift * kSubBucketCount + (value >> shift));
+    }
+
+    static uint64_t bucketLowerBound(size_t index) {
+        if (index < 2 * kSubBucketCount) {
+            return index;
+        }
+        const uint64_t shift = index / kSubBucketCount - 1;
+        return (index - shift * kSubBucketCount) << shift;
+    }
+
+    static uint64_t bucketUpperBound(size_t index) {
+        if (index < 2 * kSubBucketCount) {
+            return index;
+        }
+        const uint64_t shift = index / kSubBucketCount - 1;
+        return ((index - shift * kSubBucketCount + 1) << shift) - 1;
+    }
+
+    std::array<uint64_t, kBucketCount> counts_{};
+    uint64_t count_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t min_ = std::numeric_limits<uint64_t>::max();
+    uint64_t max_ = 0;
+};
+
+// 检测延迟统计，见IMatcher::latencyStats
+struct MatchLatencyStats {
+    // 每个通知的匹配结果：从session第一次被命中的那次调用开始，到结果通知为止的挂钟耗时（微秒）
+    LatencyHistogram detectionWallMicros;
+    // 每个通知的匹配结果：session最早命中的查询时间戳到通知时最新查询时间戳的音频时长（毫秒），
+    // 即曲目开始被命中后还需要多少音频才能满足minMatchesRequired和minMatchesUniqueTimestampRequired
+    LatencyHistogram detectionAudioMillis;
+    // 每次appendStreamBuffer的处理耗时（微秒），包括指纹生成和匹配
+    LatencyHistogram processingMicros;
+
+    void merge(const MatchLatencyStats& other) {
+        detectionWallMicros.merge(other.detectionWallMicros);
+        detectionAudioMillis.merge(other.detectionAudioMillis);
+        processingMicros.merge(other.processingMicros);
+    }
+
+    void reset() {
+        detectionWallMicros.reset();
+        detectionAudioMillis.reset();
+        processingMicros.reset();
+    }
+};
+
+} // namespace afp
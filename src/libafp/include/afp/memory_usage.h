@@ -0,0 +1,83 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace afp {
+
+// 内存占用报告，单位均为字节，用于容量规划和发现无限增长
+// 容器按容量（而不是元素个数）计算；基于节点的容器按元素大小加节点开销估算，计数分配器管理的部分是精确值
+// 只统计堆内存和映射的文件内存，不含对象本身；FFT后端等第三方库内部的内存不计入
+
+// 目录的内存占用，见ICatalog::memoryUsage
+struct CatalogMemoryUsage {
+    size_t signatureCount = 0;
+    size_t signaturePointCount = 0;
+    uint64_t signatureBytes = 0;    // 各指纹的紧凑表示：哈希、时间戳表下标、去重时间戳表和已解码的频率/振幅附表
+    uint64_t expandedBytes = 0;     // ICatalog::signatures()展开的SignaturePoint数组，未调用时为0
+    size_t mediaItemCount = 0;
+    uint64_t mediaItemBytes = 0;    // 媒体信息，包括标题、副标题和自定义信息的字符串
+
+    uint64_t totalBytes() const { return signatureBytes + expandedBytes + mediaItemBytes; }
+};
+
+// 倒排索引的内存占用，见ICatalogIndex::memoryUsage
+struct IndexMemoryUsage {
+    size_t hashCount = 0;
+    size_t postingCount = 0;
+    uint64_t bucketBytes = 0;       // 唯一哈希数组和每个哈希的倒排起点数组
+    uint64_t postingBytes = 0;      // 倒排记录数组
+    uint64_t overheadBytes = 0;     // 哈希占用位图和停用标记
+    uint64_t mappedBytes = 0;       // bucketBytes和postingBytes中直接映射自catalog文件、不占用堆的部分
+
+    uint64_t totalBytes() const { return bucketBytes + postingBytes + overheadBytes; }
+};
+
+// 一路流的指纹生成流水线的内存占用，见ISignatureGenerator::memoryUsage
+struct GeneratorMemoryUsage {
+    uint64_t inputBufferBytes = 0;      // 通道缓冲、降采样滤波器和FFT前的样本环形缓冲
+    uint64_t fftBytes = 0;              // 窗函数、FFT批处理缓冲、静音门限和短帧
+    uint64_t peakDetectionBytes = 0;    // 峰值检测的短帧缓存、峰值提取器、频段状态和配额缓冲
+    uint64_t longFrameBytes = 0;        // 长帧构建的峰值缓冲和长帧
+    uint64_t hashBytes = 0;             // hash计算的长帧环形缓冲、三帧组合去重集合和输出缓冲
+    uint64_t handoffBytes = 0;          // 线程模式下的短帧交接块和指纹点队列
+    uint64_t signatureBytes = 0;        // 生成器内部累积的指纹点，设置输出回调后不再增长
+    uint64_t traceBytes = 0;            // 事件追踪缓冲
+
+    uint64_t totalBytes() const {
+        return inputBufferBytes + fftBytes + peakDetectionBytes + longFrameBytes + hashBytes +
+               handoffBytes + signatureBytes + traceBytes;
+    }
+};
+
+// 匹配器的内存占用，见IMatcher::memoryUsage
+struct MatcherMemoryUsage {
+    GeneratorMemoryUsage generator;     // 查询指纹的生成
+    uint64_t queryBufferBytes = 0;      // 本批查询指纹点、倒排命中范围和粗筛计票
+    size_t sessionCount = 0;
+    uint64_t sessionBytes = 0;          // session表、命中点下标、合并顺序、分数堆和过期时间轮
+    uint64_t historyBytes = 0;          // 只在收集可视化数据时记录的匹配明细和session历史
+    uint64_t historyPeakBytes = 0;      // 匹配明细和session历史的峰值（计数分配器记录）
+    uint64_t resultBytes = 0;           // 待通知的匹配结果和异步结果队列
+    uint64_t traceBytes = 0;            // 匹配侧的事件追踪缓冲
+    uint64_t shardIndexBytes = 0;       // 多线程匹配时各分片自己的索引，见IMatcher::setMatchThreads
+
+    uint64_t totalBytes() const {
+        return generator.totalBytes() + queryBufferBytes + sessionBytes + historyBytes + resultBytes + traceBytes +
+               shardIndexBytes;
+    }
+};
+
+// 多路流匹配引擎的内存占用，见IMatchEngine::memoryUsage；共享的catalog和索引不计入
+struct MatchEngineMemoryUsage {
+    size_t streamCount = 0;
+    size_t activeStreamCount = 0;       // 持有session状态的流
+    MatcherMemoryUsage streams;         // 所有流的生成器和持有的匹配器之和
+    size_t idleMatcherCount = 0;
+    uint64_t idleMatcherBytes = 0;      // 池中已重置、保留容量待复用的匹配器
+    size_t suspendedStreamCount = 0;
+    uint64_t suspendedStateBytes = 0;   // 挂起的流保存的生成器状态，见IMatchEngine::suspendStream
+
+    uint64_t totalBytes() const { return streams.totalBytes() + idleMatcherBytes + suspendedStateBytes; }
+};
+
+} // namespace afp
@@ -1,9 +1,41 @@
 #pragma once
 #include <memory>
+#include <string>
 #include "afp/iperformance_config.h"
 
 namespace afp {
 
+// 在平台配置之上调整的选项，默认值与平台配置一致
+struct PerformanceConfigOptions {
+    // FFT前降采样（见FFTConfig::enableDecimation），默认关闭
+    // 降采样改变生成的指纹，已有的目录按关闭生成；目录和查询两端须使用相同的设置
+    bool enableDecimation = false;
+    // 自适应降级（见SignatureGenerationConfig::targetRealtimeFactor），为true时按平台配置
+    // 离线处理文件（批量匹配、评测）时应关闭，结果不随机器负载变化
+    bool adaptiveDegradation = true;
+    // 低延迟流式模式的延迟预算（毫秒，见SignatureGenerationConfig::streamingLatencyBudgetMs），0表示关闭，各平台默认关闭
+    // 只缩短指纹生成的延迟；端到端的检测时间主要取决于session积累到minMatchesRequired个命中所需的音频时长，
+    // 实测预算300ms/500ms时平均检测时间从1.443s降到1.379s/1.351s（约4%~6%），p99基本不变
+    // 预算较小时峰值检测窗口缩短，生成的指纹点减少；只应用于匹配端，生成目录时保持关闭
+    double streamingLatencyBudgetMs = 0.0;
+};
+
+// 硬件自动调优的要求
+struct CalibrationRequest {
+    double targetRealtimeFactor = 0.5;  // 所有流合计的处理时间与音频时长之比的上限
+    size_t streamCount = 1;             // 需要同时处理的流数
+    uint32_t sampleRate = 44100;        // 输入采样率
+    uint32_t channels = 1;              // 每个流的声道数
+    std::string cachePath;              // 校准结果的缓存文件，为空时每次都重新测试
+};
+
+// 硬件自动调优的结果
+struct CalibrationResult {
+    PlatformType platform = PlatformType::Desktop; // 选中的配置
+    double realtimeFactor = 0.0;        // 选中的配置单个流的实测实时率
+    bool fromCache = false;             // 结果是否来自缓存文件
+};
+
 class PerformanceConfigFactory {
 public:
     // 禁用构造函数和析构函数
@@ -11,13 +43,22 @@ public:
     ~PerformanceConfigFactory() = delete;
 
     // 获取指定平台的配置
-    static std::shared_ptr<IPerformanceConfig> getConfig(PlatformType platform);
+    static std::shared_ptr<IPerformanceConfig> getConfig(PlatformType platform,
+                                                         const PerformanceConfigOptions& options = {});
+
+    // 硬件自动调优：在本机上用合成音频对各匹配配置（Mobile/Desktop/Server）做短时基准测试，
+    // 返回满足 单流实时率 × streamCount <= targetRealtimeFactor 的配置中处理量最大的一个，都不满足时返回处理量最小的一个
+    // 结果按请求参数、options和CPU线程数缓存到cachePath，之后相同的请求直接读取缓存；result不为空时写入选择结果
+    // options同getConfig，既用于基准测试（降采样等改变处理量），也应用于返回的配置
+    static std::shared_ptr<IPerformanceConfig> calibrate(const CalibrationRequest& request, CalibrationResult* result = nullptr,
+                                                         const PerformanceConfigOptions& options = {});
 
 private:
     // 创建不同平台的配置
     static std::shared_ptr<IPerformanceConfig> createMobileConfig();
     static std::shared_ptr<IPerformanceConfig> createDesktopConfig();
     static std::shared_ptr<IPerformanceConfig> createServerConfig();
+    static std::shared_ptr<IPerformanceConfig> createMobileLowEndConfig();
     
     // 创建生成模式的配置 (优先精度)
     static std::shared_ptr<IPerformanceConfig> createMobileGenConfig();
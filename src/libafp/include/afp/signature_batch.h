@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "afp/isignature_generator.h"
+#include "afp/iperformance_config.h"
+#include "afp/pcm_format.h"
+
+namespace afp {
+
+// 查询指纹点批次的紧凑线路格式：设备端用ISignatureGenerator生成指纹点，只上传指纹点，
+// 服务端用IMatchEngine::appendSignatureBatch直接匹配，不需要上传PCM
+//
+// 时间戳按帧移量化为整数刻度（指纹点的时间戳都是短帧时间戳，落在帧移的整数倍上），
+// 指纹点按(刻度, 哈希)排序后分组：刻度差分varint + 组内点数varint + 组内哈希差分varint；
+// 频率和振幅只用于诊断，不传输，解码后为0
+// 每个指纹点约4字节，按每秒一两百个指纹点计，上传量为每秒几百字节（44.1kHz 16位单声道PCM约88KB/s）
+class SignatureBatchCodec {
+public:
+    // 指纹点时间戳的量化步长（秒）：帧移除以输入采样率，生成端和编码端应使用相同的配置和格式
+    static double timeStep(const IPerformanceConfig& config, const PCMFormat& format) {
+        return static_cast<double>(config.getFFTConfig().hopSize) / format.sampleRate();
+    }
+
+    // 编码一批指纹点，timeStep必须大于0；输出覆盖out
+    static void encode(const SignaturePoint* points, size_t count, double timeStep, std::vector<uint8_t>& out);
+
+    // 解码一批指纹点，按(时间戳, 哈希)升序输出到points；数据不完整或不合法时返回false
+    static bool decode(const uint8_t* data, size_t size, std::vector<SignaturePoint>& points);
+};
+
+} // namespace afp
@@ -1,8 +1,14 @@
 #include "afp/afp_interface.h"
 #include "catalog/catalog.h"
+#include "catalog/catalog_index.h"
+#include "catalog/catalog_segments.h"
+#include "catalog/catalog_partition.h"
 #include "signature/signature_generator.h"
 #include "afp/performance_config_factory.h"
 #include "matcher/matcher.h"
+#include "matcher/match_engine.h"
+#include "matcher/catalog_shard.h"
+#include "matcher/scatter_gather_matcher.h"
 
 namespace afp {
 
@@ -18,8 +24,16 @@ std::shared_ptr<ISignatureGenerator> createSignatureGenerator(
 }
 
 std::shared_ptr<IPerformanceConfig> createPerformanceConfig(
-    PlatformType platform) {
-    return PerformanceConfigFactory::getConfig(platform);
+    PlatformType platform,
+    const PerformanceConfigOptions& options) {
+    return PerformanceConfigFactory::getConfig(platform, options);
+}
+
+std::shared_ptr<IPerformanceConfig> calibratePerformanceConfig(
+    const CalibrationRequest& request,
+    CalibrationResult* result,
+    const PerformanceConfigOptions& options) {
+    return PerformanceConfigFactory::calibrate(request, result, options);
 }
 
 std::shared_ptr<IMatcher> createMatcher(
@@ -29,6 +43,105 @@ std::shared_ptr<IMatcher> createMatcher(
     return std::make_shared<Matcher>(catalog, config, format);
 }
 
+std::shared_ptr<const ICatalogIndex> createCatalogIndex(
+    std::shared_ptr<ICatalog> catalog) {
+    return CatalogIndex::fromCatalog(catalog);
+}
+
+std::shared_ptr<const ICatalogIndex> createCatalogIndex(
+    std::shared_ptr<ICatalog> catalog,
+    std::shared_ptr<IPerformanceConfig> config) {
+    return CatalogIndex::fromCatalog(catalog, CatalogIndexOptions::fromMatchingConfig(config->getMatchingConfig()));
+}
+
+bool writeCatalogIndexStatistics(std::shared_ptr<ICatalog> catalog, const std::string& filename) {
+    return CatalogIndex::fromCatalog(catalog)->writeStatistics(filename);
+}
+
+std::shared_ptr<const ICatalogIndex> replicateCatalogIndex(
+    std::shared_ptr<const ICatalogIndex> index) {
+    auto concreteIndex = std::dynamic_pointer_cast<const CatalogIndex>(index);
+    if (!concreteIndex) {
+        return nullptr;
+    }
+    return concreteIndex->replicate();
+}
+
+std::shared_ptr<IMatcher> createMatcher(
+    std::shared_ptr<ICatalog> catalog,
+    std::shared_ptr<const ICatalogIndex> index,
+    std::shared_ptr<IPerformanceConfig> config,
+    const PCMFormat& format) {
+    return std::make_shared<Matcher>(catalog, config, format, std::move(index));
+}
+
+std::shared_ptr<CatalogPublisher> createCatalogPublisher() {
+    return std::make_shared<CatalogPublisher>();
+}
+
+std::shared_ptr<IMatcher> createMatcher(
+    std::shared_ptr<CatalogPublisher> publisher,
+    std::shared_ptr<IPerformanceConfig> config,
+    const PCMFormat& format) {
+    return std::make_shared<Matcher>(std::move(publisher), config, format);
+}
+
+std::shared_ptr<IMatchEngine> createMatchEngine(
+    std::shared_ptr<ICatalog> catalog,
+    std::shared_ptr<const ICatalogIndex> index,
+    std::shared_ptr<IPerformanceConfig> config) {
+    return std::make_shared<MatchEngine>(std::move(catalog), std::move(index), std::move(config));
+}
+
+std::shared_ptr<IMatchEngine> createMatchEngine(
+    std::shared_ptr<CatalogPublisher> publisher,
+    std::shared_ptr<IPerformanceConfig> config) {
+    return std::make_shared<MatchEngine>(std::move(publisher), std::move(config));
+}
+
+std::vector<std::shared_ptr<ICatalog>> partitionCatalog(const ICatalog& catalog, size_t shardCount) {
+    return CatalogPartition::partition(catalog, shardCount);
+}
+
+std::shared_ptr<ICatalogShard> createCatalogShard(
+    std::shared_ptr<ICatalog> catalog,
+    std::shared_ptr<const ICatalogIndex> index,
+    std::shared_ptr<IPerformanceConfig> config,
+    size_t shardIndex,
+    size_t shardCount) {
+    return std::make_shared<CatalogShard>(catalog, std::move(index), config, shardIndex, shardCount);
+}
+
+std::shared_ptr<IScatterGatherMatcher> createScatterGatherMatcher(
+    std::vector<std::shared_ptr<ICatalogShard>> shards,
+    std::shared_ptr<IPerformanceConfig> config) {
+    for (size_t i = 0; i < shards.size(); ++i) {
+        if (!shards[i] || shards[i]->shardIndex() != i || shards[i]->shardCount() != shards.size()) {
+            return nullptr;
+        }
+    }
+    if (shards.empty()) {
+        return nullptr;
+    }
+    return std::make_shared<ScatterGatherMatcher>(std::move(shards), config);
+}
+
+bool appendCatalogSegment(const std::string& directory, const ICatalog& catalog) {
+    return CatalogSegments(directory).appendSegment(catalog);
+}
+
+std::shared_ptr<ICatalog> loadCatalogSegments(const std::string& directory) {
+    auto catalog = std::make_shared<Catalog>();
+    if (!CatalogSegments(directory).load(*catalog)) {
+        return nullptr;
+    }
+    return catalog;
+}
+
+bool compactCatalogSegments(const std::string& directory, bool storeSideTables) {
+    return CatalogSegments(directory).compact(storeSideTables);
+}
+
 } // namespace interface
 
 } // namespace afp 
\ No newline at end of file
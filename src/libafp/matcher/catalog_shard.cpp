@@ -0,0 +1,94 @@
+#include "matcher/catalog_shard.h"
+#include "catalog/catalog_index.h"
+#include "catalog/catalog_partition.h"
+
+namespace afp {
+
+CatalogShard::CatalogShard(std::shared_ptr<ICatalog> catalog, std::shared_ptr<const ICatalogIndex> index,
+                           std::shared_ptr<IPerformanceConfig> config, size_t shardIndex, size_t shardCount)
+    : catalog_(std::move(catalog))
+    , index_(std::move(index))
+    , config_(std::move(config))
+    , shardIndex_(shardIndex)
+    , shardCount_(shardCount) {
+    if (!index_) {
+        index_ = CatalogIndex::fromCatalog(catalog_, CatalogIndexOptions::fromMatchingConfig(config_->getMatchingConfig()));
+    }
+}
+
+CatalogShard::~CatalogShard() = default;
+
+bool CatalogShard::addStream(StreamId streamId, size_t channelCount) {
+    if (streams_.count(streamId) != 0) {
+        return false;
+    }
+
+    auto stream = std::make_unique<StreamState>();
+    stream->matcher = std::make_unique<SignatureMatcher>(catalog_, config_, index_);
+    stream->matcher->setLogLevel(MatcherLogLevel::Quiet);
+    stream->channelCount = channelCount;
+    // 判定的结果先收集起来，由match一并返回
+    auto* results = &stream->results;
+    stream->matcher->setMatchResultSink([results](MatchResult&& result) {
+        results->push_back(std::move(result));
+    });
+    streams_.emplace(streamId, std::move(stream));
+    return true;
+}
+
+bool CatalogShard::removeStream(StreamId streamId) {
+    return streams_.erase(streamId) != 0;
+}
+
+bool CatalogShard::vote(StreamId streamId, const SignaturePoint* points, size_t count, std::vector<ShardVote>& votes) {
+    votes.clear();
+    auto it = streams_.find(streamId);
+    if (it == streams_.end()) {
+        return false;
+    }
+
+    auto& stream = *it->second;
+    stream.queryPoints.assign(points, points + count);
+    stream.matcher->voteQuerySignature(stream.queryPoints, stream.candidates);
+    stream.voted = true;
+
+    votes.reserve(stream.candidates.size());
+    for (const auto& [signatureIndex, score] : stream.candidates) {
+        votes.push_back(ShardVote{CatalogPartition::signatureIdOf(signatureIndex, shardIndex_, shardCount_), score});
+    }
+    return true;
+}
+
+bool CatalogShard::match(StreamId streamId, const uint32_t* selected, size_t selectedCount,
+                         std::vector<ShardMatch>& matches) {
+    matches.clear();
+    auto it = streams_.find(streamId);
+    if (it == streams_.end() || !it->second->voted) {
+        return false;
+    }
+
+    auto& stream = *it->second;
+    stream.voted = false;
+    stream.selected.clear();
+    for (size_t i = 0; i < selectedCount; ++i) {
+        if (CatalogPartition::shardOf(selected[i], shardCount_) == shardIndex_) {
+            stream.selected.push_back(static_cast<uint32_t>(CatalogPartition::localIndexOf(selected[i], shardCount_)));
+        }
+    }
+
+    stream.results.clear();
+    stream.matcher->matchVotedQuerySignature(stream.queryPoints, stream.selected, stream.channelCount);
+
+    // 结果中的mediaItem指向本分片catalog，由其下标换算全局id
+    const auto* mediaItems = catalog_->mediaItems().data();
+    matches.reserve(stream.results.size());
+    for (auto& result : stream.results) {
+        const auto signatureIndex = static_cast<size_t>(result.mediaItem - mediaItems);
+        matches.push_back(ShardMatch{CatalogPartition::signatureIdOf(signatureIndex, shardIndex_, shardCount_),
+                                     std::move(result)});
+    }
+    stream.results.clear();
+    return true;
+}
+
+} // namespace afp
@@ -0,0 +1,52 @@
+#pragma once
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "signature/signature_matcher.h"
+#include "afp/icatalog.h"
+#include "afp/icatalog_index.h"
+#include "afp/icatalog_shard.h"
+#include "afp/iperformance_config.h"
+
+namespace afp {
+
+// 在一个节点上服务一个目录分片，每路流持有自己的SignatureMatcher，所有流共享分片的catalog和倒排索引
+class CatalogShard : public ICatalogShard {
+public:
+    // index为空时由catalog按config的匹配配置构建一次
+    CatalogShard(std::shared_ptr<ICatalog> catalog, std::shared_ptr<const ICatalogIndex> index,
+                 std::shared_ptr<IPerformanceConfig> config, size_t shardIndex, size_t shardCount);
+    ~CatalogShard() override;
+
+    size_t shardIndex() const override { return shardIndex_; }
+    size_t shardCount() const override { return shardCount_; }
+
+    bool addStream(StreamId streamId, size_t channelCount) override;
+    bool removeStream(StreamId streamId) override;
+
+    bool vote(StreamId streamId, const SignaturePoint* points, size_t count, std::vector<ShardVote>& votes) override;
+
+    bool match(StreamId streamId, const uint32_t* selected, size_t selectedCount,
+               std::vector<ShardMatch>& matches) override;
+
+private:
+    struct StreamState {
+        std::unique_ptr<SignatureMatcher> matcher;
+        size_t channelCount = 1;
+        bool voted = false;                                  // 已调用vote，等待match
+        std::vector<SignaturePoint> queryPoints;             // 本批查询指纹点，vote到match之间保留
+        std::vector<std::pair<uint32_t, uint32_t>> candidates;
+        std::vector<uint32_t> selected;                      // 分片内下标
+        std::vector<MatchResult> results;                    // 本批判定的匹配结果
+    };
+
+    std::shared_ptr<ICatalog> catalog_;
+    std::shared_ptr<const ICatalogIndex> index_;
+    std::shared_ptr<IPerformanceConfig> config_;
+    size_t shardIndex_;
+    size_t shardCount_;
+    std::unordered_map<StreamId, std::unique_ptr<StreamState>> streams_;
+};
+
+} // namespace afp
@@ -0,0 +1,393 @@
+#include "matcher/match_engine.h"
+#include "catalog/catalog_index.h"
+#include "base/trace_ring.h"
+#include <iostream>
+#include "base/memory_accounting.h"
+#include "afp/signature_batch.h"
+#include "matcher/stream_checkpoint.h"
+
+namespace afp {
+
+MatchEngine::MatchEngine(std::shared_ptr<ICatalog> catalog, std::shared_ptr<const ICatalogIndex> index,
+                         std::shared_ptr<IPerformanceConfig> config)
+    : catalog_(std::move(catalog))
+    , index_(std::move(index))
+    , config_(std::move(config)) {
+    if (!index_) {
+        index_ = CatalogIndex::fromCatalog(catalog_, CatalogIndexOptions::fromMatchingConfig(config_->getMatchingConfig()));
+    }
+}
+
+MatchEngine::MatchEngine(std::shared_ptr<CatalogPublisher> publisher, std::shared_ptr<IPerformanceConfig> config)
+    : publisher_(std::move(publisher))
+    , config_(std::move(config)) {
+    snapshot_ = publisher_->current();
+    catalog_ = snapshot_->catalog;
+    index_ = snapshot_->index;
+}
+
+MatchEngine::~MatchEngine() = default;
+
+void MatchEngine::setLogLevel(MatcherLogLevel level) {
+    logLevel_ = level;
+    for (const auto& stream : streams_) {
+        if (stream->matcher) {
+            stream->matcher->setLogLevel(level);
+        }
+    }
+    for (const auto& matcher : idleMatchers_) {
+        matcher->setLogLevel(level);
+    }
+}
+
+void MatchEngine::refreshSnapshot() {
+    if (!publisher_) {
+        return;
+    }
+
+    auto snapshot = publisher_->current();
+    if (!snapshot || snapshot == snapshot_) {
+        return;
+    }
+
+    // 持有session的流迁移到新快照，池中的空闲匹配器仍指向旧目录，直接丢弃
+    for (const auto& stream : streams_) {
+        if (stream->matcher) {
+            stream->matcher->updateCatalog(snapshot->catalog, snapshot->index);
+        }
+    }
+    idleMatchers_.clear();
+
+    catalog_ = snapshot->catalog;
+    index_ = snapshot->index;
+    snapshot_ = std::move(snapshot);
+
+    if (logLevel_ >= MatcherLogLevel::Info) {
+        std::cout << "多路匹配引擎已切换到新的目录快照 (版本: " << snapshot_->version
+                  << ", 持有session的流数量: " << activeStreamCount_ << ")" << std::endl;
+    }
+}
+
+MatchEngine::StreamState* MatchEngine::findStream(StreamId streamId) {
+    auto it = streamSlots_.find(streamId);
+    if (it == streamSlots_.end()) {
+        return nullptr;
+    }
+    return streams_[it->second].get();
+}
+
+bool MatchEngine::addStream(StreamId streamId, const PCMFormat& format) {
+    if (streamSlots_.count(streamId) != 0) {
+        return false;
+    }
+
+    auto generator = std::make_unique<SignatureGenerator>(config_);
+    if (!generator->init(format)) {
+        return false;
+    }
+
+    uint32_t slot;
+    if (!freeStreams_.empty()) {
+        slot = freeStreams_.back();
+        freeStreams_.pop_back();
+    } else {
+        slot = static_cast<uint32_t>(streams_.size());
+        streams_.push_back(std::make_unique<StreamState>());
+    }
+
+    auto* stream = streams_[slot].get();
+    stream->id = streamId;
+    stream->format = format;
+    stream->newQueryPoints.clear();
+    stream->pending = false;
+    stream->latency.reset();
+    bindGenerator(*stream, std::move(generator));
+
+    streamSlots_.emplace(streamId, slot);
+    return true;
+}
+
+void MatchEngine::bindGenerator(StreamState& stream, std::unique_ptr<SignatureGenerator> generator) {
+    stream.generator = std::move(generator);
+    // 新生成的指纹点直接流入本路流的缓冲，流状态对象的地址在池中保持不变
+    auto* target = &stream;
+    stream.generator->setSignatureSink([target](const std::vector<SignaturePoint>& points) {
+        target->newQueryPoints.insert(target->newQueryPoints.end(), points.begin(), points.end());
+    });
+}
+
+bool MatchEngine::suspendStream(StreamId streamId) {
+    auto* stream = findStream(streamId);
+    if (!stream) {
+        return false;
+    }
+    if (!stream->generator) {
+        return true;
+    }
+
+    // 保存的状态只含仍在窗口内的帧，远小于生成器按容量分配的FFT和峰值检测缓冲
+    stream->suspendedState.clear();
+    if (!stream->generator->saveState(stream->suspendedState)) {
+        return false;
+    }
+    stream->suspendedState.shrink_to_fit();
+    stream->generator.reset();
+    std::vector<SignaturePoint>().swap(stream->newQueryPoints);
+    ++suspendedStreamCount_;
+    return true;
+}
+
+bool MatchEngine::resumeStream(StreamState& stream) {
+    if (stream.generator) {
+        return true;
+    }
+
+    auto generator = std::make_unique<SignatureGenerator>(config_);
+    if (!generator->init(stream.format) ||
+        !generator->restoreState(stream.suspendedState.data(), stream.suspendedState.size())) {
+        std::cerr << "恢复挂起的流失败 (streamId: " << stream.id << ")" << std::endl;
+        return false;
+    }
+    bindGenerator(stream, std::move(generator));
+    std::vector<uint8_t>().swap(stream.suspendedState);
+    --suspendedStreamCount_;
+    return true;
+}
+
+bool MatchEngine::removeStream(StreamId streamId) {
+    auto it = streamSlots_.find(streamId);
+    if (it == streamSlots_.end()) {
+        return false;
+    }
+
+    const auto slot = it->second;
+    auto& stream = *streams_[slot];
+    if (stream.matcher) {
+        stream.matcher->reset();
+        idleMatchers_.push_back(std::move(stream.matcher));
+        --activeStreamCount_;
+    }
+    if (!stream.generator) {
+        std::vector<uint8_t>().swap(stream.suspendedState);
+        --suspendedStreamCount_;
+    }
+    stream.generator.reset();
+    stream.newQueryPoints.clear();
+    stream.pending = false;
+
+    streamSlots_.erase(it);
+    freeStreams_.push_back(slot);
+    return true;
+}
+
+bool MatchEngine::saveStreamCheckpoint(StreamId streamId, std::vector<uint8_t>& out) {
+    auto* stream = findStream(streamId);
+    if (!stream) {
+        return false;
+    }
+    // 没有session的流临时借用池中的匹配器写出空的session状态，格式与持有匹配器时相同
+    if (!stream->matcher) {
+        acquireMatcher(*stream);
+    }
+    // 挂起的流直接写出保存的生成器状态，不必恢复生成器
+    bool saved = true;
+    if (stream->generator) {
+        saved = afp::saveStreamCheckpoint(*stream->generator, *stream->matcher, out);
+    } else {
+        afp::saveStreamCheckpoint(stream->suspendedState, *stream->matcher, out);
+    }
+    releaseMatcherIfIdle(*stream);
+    return saved;
+}
+
+bool MatchEngine::restoreStream(StreamId streamId, const PCMFormat& format, const uint8_t* data, size_t size) {
+    refreshSnapshot();
+    if (!addStream(streamId, format)) {
+        return false;
+    }
+    auto* stream = findStream(streamId);
+    acquireMatcher(*stream);
+    if (!restoreStreamCheckpoint(*stream->generator, *stream->matcher, data, size)) {
+        removeStream(streamId);
+        return false;
+    }
+    releaseMatcherIfIdle(*stream);
+    return true;
+}
+
+void MatchEngine::acquireMatcher(StreamState& stream) {
+    if (!idleMatchers_.empty()) {
+        stream.matcher = std::move(idleMatchers_.back());
+        idleMatchers_.pop_back();
+    } else {
+        stream.matcher = std::make_unique<SignatureMatcher>(catalog_, config_, index_);
+        stream.matcher->setLogLevel(logLevel_);
+    }
+    ++activeStreamCount_;
+
+    // 回调按流绑定，匹配器换到其他流时重新设置
+    const auto streamId = stream.id;
+    stream.matcher->setMatchNotifyCallback([this, streamId](const MatchResult& result) {
+        if (matchCallback_) {
+            matchCallback_(streamId, result);
+        }
+    });
+    stream.matcher->setStatsCallback([this, streamId](const MatchStats& stats) {
+        if (statsCallback_) {
+            statsCallback_(streamId, stats);
+        }
+    });
+    stream.matcher->setLatencyStats(&stream.latency);
+}
+
+void MatchEngine::releaseMatcherIfIdle(StreamState& stream) {
+    if (!stream.matcher || stream.matcher->sessionCount() != 0) {
+        return;
+    }
+    stream.matcher->reset();
+    idleMatchers_.push_back(std::move(stream.matcher));
+    --activeStreamCount_;
+}
+
+void MatchEngine::matchStream(StreamState& stream) {
+    stream.pending = false;
+    if (stream.newQueryPoints.empty()) {
+        stream.latency.processingMicros.record(stream.batchNanoseconds / 1000);
+        return;
+    }
+    const auto matchStart = TraceRing::now();
+    if (!stream.matcher) {
+        acquireMatcher(stream);
+    }
+    stream.matcher->processQuerySignature(stream.newQueryPoints, stream.format.channels());
+    stream.newQueryPoints.clear();
+    releaseMatcherIfIdle(stream);
+    stream.latency.processingMicros.record((stream.batchNanoseconds + TraceRing::now() - matchStart) / 1000);
+}
+
+bool MatchEngine::appendStreamBuffer(StreamId streamId,
+                                     const void* buffer,
+                                     size_t bufferSize,
+                                     double startTimestamp) {
+    const StreamBuffer streamBuffer{streamId, buffer, bufferSize, startTimestamp};
+    return appendStreamBuffers(&streamBuffer, 1) == 1;
+}
+
+MatchEngineMemoryUsage MatchEngine::memoryUsage() const {
+    MatchEngineMemoryUsage usage;
+    usage.streamCount = streamSlots_.size();
+    usage.activeStreamCount = activeStreamCount_;
+    usage.suspendedStreamCount = suspendedStreamCount_;
+
+    auto& total = usage.streams;
+    for (const auto& stream : streams_) {
+        total.queryBufferBytes += heapBytes(stream->newQueryPoints);
+        usage.suspendedStateBytes += heapBytes(stream->suspendedState);
+        if (stream->generator) {
+            const auto generator = stream->generator->memoryUsage();
+            total.generator.inputBufferBytes += generator.inputBufferBytes;
+            total.generator.fftBytes += generator.fftBytes;
+            total.generator.peakDetectionBytes += generator.peakDetectionBytes;
+            total.generator.longFrameBytes += generator.longFrameBytes;
+            total.generator.hashBytes += generator.hashBytes;
+            total.generator.handoffBytes += generator.handoffBytes;
+            total.generator.signatureBytes += generator.signatureBytes;
+            total.generator.traceBytes += generator.traceBytes;
+        }
+        if (stream->matcher) {
+            stream->matcher->addMemoryUsage(total);
+        }
+    }
+
+    MatcherMemoryUsage idle;
+    for (const auto& matcher : idleMatchers_) {
+        matcher->addMemoryUsage(idle);
+    }
+    usage.idleMatcherCount = idleMatchers_.size();
+    usage.idleMatcherBytes = idle.totalBytes();
+    return usage;
+}
+
+bool MatchEngine::appendSignaturePoints(StreamId streamId, const SignaturePoint* points, size_t count) {
+    refreshSnapshot();
+
+    auto* stream = findStream(streamId);
+    if (!stream) {
+        return false;
+    }
+    stream->newQueryPoints.assign(points, points + count);
+    stream->batchNanoseconds = 0;
+    matchStream(*stream);
+    return true;
+}
+
+bool MatchEngine::appendSignatureBatch(StreamId streamId, const uint8_t* data, size_t size) {
+    refreshSnapshot();
+
+    auto* stream = findStream(streamId);
+    if (!stream) {
+        return false;
+    }
+    // 直接解码到流的查询缓冲，复用其容量
+    if (!SignatureBatchCodec::decode(data, size, stream->newQueryPoints)) {
+        return false;
+    }
+    stream->batchNanoseconds = 0;
+    matchStream(*stream);
+    return true;
+}
+
+bool MatchEngine::latencyStats(StreamId streamId, MatchLatencyStats& stats) const {
+    auto it = streamSlots_.find(streamId);
+    if (it == streamSlots_.end()) {
+        return false;
+    }
+    stats = streams_[it->second]->latency;
+    return true;
+}
+
+MatchLatencyStats MatchEngine::latencyStats() const {
+    MatchLatencyStats stats;
+    for (const auto& slot : streamSlots_) {
+        stats.merge(streams_[slot.second]->latency);
+    }
+    return stats;
+}
+
+size_t MatchEngine::appendStreamBuffers(const StreamBuffer* buffers, size_t count) {
+    refreshSnapshot();
+
+    // 第一阶段：为所有流生成指纹，新指纹点累积在各自的缓冲中
+    size_t appendedCount = 0;
+    batch_.clear();
+    for (size_t i = 0; i < count; ++i) {
+        auto* stream = findStream(buffers[i].streamId);
+        if (!stream) {
+            continue;
+        }
+        if (!resumeStream(*stream)) {
+            continue;
+        }
+        if (!stream->pending) {
+            stream->pending = true;
+            stream->newQueryPoints.clear();
+            stream->batchNanoseconds = 0;
+            batch_.push_back(stream);
+        }
+        const auto generateStart = TraceRing::now();
+        if (stream->generator->appendStreamBuffer(buffers[i].buffer, buffers[i].bufferSize, buffers[i].startTimestamp)) {
+            ++appendedCount;
+        }
+        stream->batchNanoseconds += TraceRing::now() - generateStart;
+    }
+
+    // 第二阶段：依次匹配各路流，所有流查询同一份索引，热点倒排记录在流之间保持在缓存中
+    for (auto* stream : batch_) {
+        matchStream(*stream);
+    }
+    batch_.clear();
+
+    return appendedCount;
+}
+
+} // namespace afp
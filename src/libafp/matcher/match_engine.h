@@ -0,0 +1,127 @@
+#pragma once
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "signature/signature_generator.h"
+#include "signature/signature_matcher.h"
+#include "afp/icatalog.h"
+#include "afp/icatalog_index.h"
+#include "afp/catalog_publisher.h"
+#include "afp/imatch_engine.h"
+#include "afp/pcm_format.h"
+
+namespace afp {
+
+class MatchEngine : public IMatchEngine {
+public:
+    // index为空时由catalog按config的匹配配置构建一次，所有流共享
+    MatchEngine(std::shared_ptr<ICatalog> catalog, std::shared_ptr<const ICatalogIndex> index,
+                std::shared_ptr<IPerformanceConfig> config);
+
+    // 跟随发布器的目录快照：每次添加音频数据前检查是否有新快照并切换所有流，publisher必须已发布过快照
+    MatchEngine(std::shared_ptr<CatalogPublisher> publisher, std::shared_ptr<IPerformanceConfig> config);
+    ~MatchEngine() override;
+
+    bool addStream(StreamId streamId, const PCMFormat& format) override;
+    bool removeStream(StreamId streamId) override;
+
+    bool saveStreamCheckpoint(StreamId streamId, std::vector<uint8_t>& out) override;
+
+    bool restoreStream(StreamId streamId, const PCMFormat& format, const uint8_t* data, size_t size) override;
+
+    bool suspendStream(StreamId streamId) override;
+
+    bool appendStreamBuffer(StreamId streamId,
+                            const void* buffer,
+                            size_t bufferSize,
+                            double startTimestamp) override;
+
+    size_t appendStreamBuffers(const StreamBuffer* buffers, size_t count) override;
+
+    bool appendSignaturePoints(StreamId streamId, const SignaturePoint* points, size_t count) override;
+
+    bool appendSignatureBatch(StreamId streamId, const uint8_t* data, size_t size) override;
+
+    void setMatchCallback(MatchCallback callback) override {
+        matchCallback_ = std::move(callback);
+    }
+
+    void setLogLevel(MatcherLogLevel level) override;
+
+    void setStatsCallback(StatsCallback callback) override {
+        statsCallback_ = std::move(callback);
+    }
+
+    size_t streamCount() const override {
+        return streamSlots_.size();
+    }
+
+    size_t activeStreamCount() const override {
+        return activeStreamCount_;
+    }
+
+    size_t suspendedStreamCount() const override {
+        return suspendedStreamCount_;
+    }
+
+    MatchEngineMemoryUsage memoryUsage() const override;
+
+    bool latencyStats(StreamId streamId, MatchLatencyStats& stats) const override;
+
+    MatchLatencyStats latencyStats() const override;
+
+private:
+    // 每路流的状态，放在按下标复用的池中，移除的流保留外壳及缓冲容量
+    struct StreamState {
+        StreamId id = 0;
+        PCMFormat format;
+        std::unique_ptr<SignatureGenerator> generator;  // 挂起时为空，状态保存在suspendedState中
+        std::vector<uint8_t> suspendedState;             // 挂起时保存的生成器状态
+        std::unique_ptr<SignatureMatcher> matcher;  // 只在有进行中的session时持有
+        std::vector<SignaturePoint> newQueryPoints;  // 生成器本次输出的新指纹点
+        bool pending = false;                        // 本批中有新数据，等待匹配
+        uint64_t batchNanoseconds = 0;               // 本批指纹生成的耗时，匹配后与匹配耗时一起记入processingMicros
+        MatchLatencyStats latency;                   // 延迟直方图，检测延迟由持有的匹配器记录
+    };
+
+    // 切换到发布器的最新快照
+    void refreshSnapshot();
+
+    StreamState* findStream(StreamId streamId);
+
+    // 把已初始化的生成器交给流，新指纹点输出到流的查询缓冲
+    void bindGenerator(StreamState& stream, std::unique_ptr<SignatureGenerator> generator);
+
+    // 挂起的流重新创建生成器并恢复保存的状态
+    bool resumeStream(StreamState& stream);
+
+    // 为流分配匹配器，优先复用池中空闲的匹配器
+    void acquireMatcher(StreamState& stream);
+
+    // 流没有进行中的session时把匹配器归还到池中
+    void releaseMatcherIfIdle(StreamState& stream);
+
+    // 用本批新生成的指纹点匹配一路流
+    void matchStream(StreamState& stream);
+
+    std::shared_ptr<CatalogPublisher> publisher_;
+    std::shared_ptr<const CatalogSnapshot> snapshot_;
+    std::shared_ptr<ICatalog> catalog_;
+    std::shared_ptr<const ICatalogIndex> index_;
+    std::shared_ptr<IPerformanceConfig> config_;
+
+    std::vector<std::unique_ptr<StreamState>> streams_;   // 流状态池
+    std::vector<uint32_t> freeStreams_;                   // 空闲的流状态下标
+    std::unordered_map<StreamId, uint32_t> streamSlots_;  // streamId到流状态下标
+    std::vector<std::unique_ptr<SignatureMatcher>> idleMatchers_;  // 已重置、可复用的匹配器
+    size_t activeStreamCount_ = 0;
+    size_t suspendedStreamCount_ = 0;
+
+    std::vector<StreamState*> batch_;  // 本批待匹配的流，按首次出现的顺序
+
+    MatchCallback matchCallback_;
+    StatsCallback statsCallback_;
+    MatcherLogLevel logLevel_ = MatcherLogLevel::Quiet;
+};
+
+} // namespace afp
@@ -1,66 +1,217 @@
 #include "matcher.h"
 #include "debugger/audio_debugger.h"
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <set>
+#include <unordered_set>
+#include "base/memory_accounting.h"
+#include "matcher/stream_checkpoint.h"
 
 namespace afp {
 
-Matcher::Matcher(std::shared_ptr<ICatalog> catalog, std::shared_ptr<IPerformanceConfig> config, const PCMFormat& format)
+namespace {
+
+const TraceEventDesc kMatchTraceEvent = {"Match", "matcher", "query_points", nullptr, nullptr};
+
+} // namespace
+
+Matcher::Matcher(std::shared_ptr<ICatalog> catalog, std::shared_ptr<IPerformanceConfig> config, const PCMFormat& format,
+                 std::shared_ptr<const ICatalogIndex> index)
     : catalog_(catalog)
     , format_(format) {
     generator_ = std::make_unique<SignatureGenerator>(config);
     generator_->init(format);
+
+    // 新生成的指纹点直接流入匹配器，生成器内部不再累积历史指纹
+    generator_->setSignatureSink([this](const std::vector<SignaturePoint>& points) {
+        newQueryPoints_.insert(newQueryPoints_.end(), points.begin(), points.end());
+    });
     
     // 将目录传递给SignatureMatcher，让它预处理目标签名
-    signatureMatcher_ = std::make_unique<SignatureMatcher>(catalog, config);
+    signatureMatcher_ = std::make_unique<SignatureMatcher>(catalog, config, std::move(index));
+    signatureMatcher_->setTraceRing(&trace_);
+    signatureMatcher_->setLatencyStats(&latencyStats_);
+}
+
+Matcher::Matcher(std::shared_ptr<CatalogPublisher> publisher, std::shared_ptr<IPerformanceConfig> config, const PCMFormat& format)
+    : Matcher(publisher, publisher->current(), config, format) {
+}
+
+Matcher::Matcher(std::shared_ptr<CatalogPublisher> publisher, std::shared_ptr<const CatalogSnapshot> snapshot,
+                 std::shared_ptr<IPerformanceConfig> config, const PCMFormat& format)
+    : Matcher(snapshot->catalog, config, format, snapshot->index) {
+    publisher_ = std::move(publisher);
+    snapshot_ = std::move(snapshot);
 }
 
 Matcher::~Matcher() = default;
 
+void Matcher::refreshSnapshot() {
+    if (!publisher_) {
+        return;
+    }
+
+    auto snapshot = publisher_->current();
+    if (!snapshot || snapshot == snapshot_) {
+        return;
+    }
+
+    // 进行中的session由SignatureMatcher迁移或保留在旧快照上，切换不需要重建匹配器
+    signatureMatcher_->updateCatalog(snapshot->catalog, snapshot->index);
+    catalog_ = snapshot->catalog;
+    snapshot_ = std::move(snapshot);
+}
+
+void Matcher::enableResultQueue(size_t capacity) {
+    resultQueue_ = std::make_unique<SpscQueue<MatchResult>>(std::max<size_t>(capacity, 1));
+    // 结果直接移动进队列，队列已满时丢弃，匹配线程不等待消费者
+    signatureMatcher_->setMatchResultSink([this](MatchResult&& result) {
+        if (!resultQueue_->tryPush(std::move(result))) {
+            droppedResultCount_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        resultSignal_.notify();
+    });
+}
+
+bool Matcher::pollMatchResult(MatchResult& result) {
+    return resultQueue_ && resultQueue_->tryPop(result);
+}
+
+bool Matcher::waitMatchResult(MatchResult& result, double timeoutSeconds) {
+    if (!resultQueue_) {
+        return false;
+    }
+    // 队列为空时阻塞到匹配线程入队通知或超时
+    const auto deadline = std::chrono::steady_clock::now() +
+                          std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                              std::chrono::duration<double>(timeoutSeconds));
+    while (!resultQueue_->tryPop(result)) {
+        if (!resultSignal_.waitUntil(deadline, [this] { return !resultQueue_->empty(); })) {
+            return false;
+        }
+    }
+    return true;
+}
+
 bool Matcher::appendStreamBuffer(const void* buffer, 
                               size_t bufferSize,
                               double startTimestamp) {
+    const auto callStart = TraceRing::now();
+    refreshSnapshot();
+
+    newQueryPoints_.clear();
     if (!generator_->appendStreamBuffer(buffer, bufferSize, startTimestamp)) {
         return false;
     }
 
-    // 获取生成的查询指纹
-    const auto& querySignature = generator_->signature();
+    // 本次新生成的查询指纹，历史指纹点已在之前的调用中参与过投票
+    const auto& querySignature = newQueryPoints_;
 
-    std::unordered_set<uint32_t> unique_hash_set;
-    for (const auto& point : querySignature) {
-        unique_hash_set.insert(point.hash);
-    }
-
-    std::unordered_set<std::string> unique_hash_timestamp_set;
-    for (const auto& point : querySignature) {
-        unique_hash_timestamp_set.insert(std::to_string(point.hash) + "_" + std::to_string(point.timestamp));
-    }
-    
+#ifdef ENABLED_DIAGNOSE
     // 仅在调试模式下打印详情
-    std::cout << "生成查询指纹点数: " << querySignature.size() << std::endl;
-    std::cout << "唯一哈希值数量: " << unique_hash_set.size() << std::endl;
-    std::cout << "唯一哈希值+时间戳数量: " << unique_hash_timestamp_set.size() << std::endl;
-    AudioDebugger::printSignatureDetails(querySignature);
+    if (logLevel_ >= MatcherLogLevel::Verbose) {
+        std::unordered_set<uint32_t> unique_hash_set;
+        std::set<std::pair<uint32_t, double>> unique_hash_timestamp_set;
+        for (const auto& point : querySignature) {
+            unique_hash_set.insert(point.hash);
+            unique_hash_timestamp_set.emplace(point.hash, point.timestamp);
+        }
 
-
-    // 按所有point的时间排序，输出前100个point的hash和timestamp
-    std::vector<std::pair<uint32_t, double>> points;
-    for (const auto& point : querySignature) {
-        points.emplace_back(point.hash, point.timestamp);
+        std::cout << "生成查询指纹点数: " << querySignature.size() << std::endl;
+        std::cout << "唯一哈希值数量: " << unique_hash_set.size() << std::endl;
+        std::cout << "唯一哈希值+时间戳数量: " << unique_hash_timestamp_set.size() << std::endl;
+        AudioDebugger::printSignatureDetails(querySignature);
     }
-    std::sort(points.begin(), points.end(), [](const auto& a, const auto& b) {
-        return a.second < b.second;
-    });
-    // std::cout << "rrr query: 按所有point的时间排序，输出前100个point的hash和timestamp" << std::endl;
-    // for (size_t i = 0; i < std::min(points.size(), size_t(300)); ++i) {
-    //     std::cout << "rrr  [" << i + 1 << "] hash: 0x" << std::hex << points[i].first << std::dec 
-    //               << ", timestamp: " << points[i].second << std::endl;
-    // }
+#endif
 
     // 将查询指纹传递给SignatureMatcher处理，并传入通道数量
+    const auto queryPointCount = static_cast<uint32_t>(querySignature.size());
+    const auto matchStart = TraceRing::now();
+    trace_.record(kMatchTraceEvent, TraceRing::kBegin, matchStart, queryPointCount);
     signatureMatcher_->processQuerySignature(querySignature, format_.channels());
+    const auto matchEnd = TraceRing::now();
+    trace_.record(kMatchTraceEvent, TraceRing::kEnd, matchEnd, queryPointCount);
+    recordMatchStats(matchEnd - matchStart);
+    latencyStats_.processingMicros.record((TraceRing::now() - callStart) / 1000);
     
     return true;
 }
 
+void Matcher::recordMatchStats(uint64_t matchNanoseconds) {
+    auto add = [](std::atomic<uint64_t>& counter, uint64_t value) {
+        counter.fetch_add(value, std::memory_order_relaxed);
+    };
+    const auto& stats = signatureMatcher_->lastStats();
+    add(counters_.matchNanoseconds, matchNanoseconds);
+    add(counters_.queryPointCount, stats.queryPointCount);
+    add(counters_.queryHitCount, stats.queryHitCount);
+    add(counters_.postingHitCount, stats.postingHitCount);
+    add(counters_.newSessionCount, stats.newSessionCount);
+    add(counters_.evictedSessionCount, stats.evictedSessionCount);
+    add(counters_.notifiedMatchCount, stats.notifiedMatchCount);
+    counters_.activeSessionCount.store(signatureMatcher_->sessionCount(), std::memory_order_relaxed);
+}
+
+void Matcher::enableTracing(size_t capacity) {
+    generator_->enableTracing(capacity);
+    if (capacity == 0) {
+        trace_.disable();
+        return;
+    }
+    trace_.enable(capacity);
+}
+
+bool Matcher::dumpTrace(const std::string& filename) const {
+    return TraceRing::writeChromeTrace(filename, {{generator_->traceRing(), "signature generation"}, {&trace_, "matching"}});
+}
+
+bool Matcher::saveCheckpoint(std::vector<uint8_t>& out) {
+    return saveStreamCheckpoint(*generator_, *signatureMatcher_, out);
+}
+
+bool Matcher::restoreCheckpoint(const uint8_t* data, size_t size) {
+    refreshSnapshot();
+    if (!restoreStreamCheckpoint(*generator_, *signatureMatcher_, data, size)) {
+        return false;
+    }
+    counters_.activeSessionCount.store(signatureMatcher_->sessionCount(), std::memory_order_relaxed);
+    return true;
+}
+
+MatcherMemoryUsage Matcher::memoryUsage() const {
+    MatcherMemoryUsage usage;
+    usage.generator = generator_->memoryUsage();
+    usage.queryBufferBytes = heapBytes(newQueryPoints_);
+    signatureMatcher_->addMemoryUsage(usage);
+    if (resultQueue_) {
+        usage.resultBytes += resultQueue_->memoryUsage();
+    }
+    usage.traceBytes = trace_.memoryUsage();
+    return usage;
+}
+
+MatcherPerformanceStats Matcher::performanceStats() const {
+    auto load = [](const std::atomic<uint64_t>& counter) {
+        return counter.load(std::memory_order_relaxed);
+    };
+
+    MatcherPerformanceStats stats;
+    stats.generator = generator_->performanceStats();
+    stats.matchNanoseconds = load(counters_.matchNanoseconds);
+    stats.queryPointCount = load(counters_.queryPointCount);
+    stats.queryHitCount = load(counters_.queryHitCount);
+    stats.postingHitCount = load(counters_.postingHitCount);
+    stats.newSessionCount = load(counters_.newSessionCount);
+    stats.evictedSessionCount = load(counters_.evictedSessionCount);
+    stats.notifiedMatchCount = load(counters_.notifiedMatchCount);
+    stats.activeSessionCount = counters_.activeSessionCount.load(std::memory_order_relaxed);
+    if (stats.generator.audioSeconds > 0.0) {
+        const double processingSeconds = stats.generator.processingSeconds + static_cast<double>(stats.matchNanoseconds) * 1e-9;
+        stats.realtimeFactor = processingSeconds / stats.generator.audioSeconds;
+    }
+    return stats;
+}
+
 } // namespace afp 
\ No newline at end of file
@@ -1,4 +1,5 @@
 #pragma once
+#include <atomic>
 #include <functional>
 #include <memory>
 #include "signature/signature_generator.h"
@@ -8,6 +9,11 @@
 #include "config/performance_config.h"
 #include "afp/pcm_format.h"
 #include "afp/imatcher.h"
+#include "afp/icatalog_index.h"
+#include "afp/catalog_publisher.h"
+#include "base/spsc_queue.h"
+#include "base/wait_signal.h"
+#include "base/trace_ring.h"
 
 namespace afp {
 
@@ -15,7 +21,11 @@ class Matcher : public IMatcher {
 public:
     using MatchCallback = std::function<void(const MatchResult&)>;
 
-    Matcher(std::shared_ptr<ICatalog> catalog, std::shared_ptr<IPerformanceConfig> config, const PCMFormat& format);
+    Matcher(std::shared_ptr<ICatalog> catalog, std::shared_ptr<IPerformanceConfig> config, const PCMFormat& format,
+            std::shared_ptr<const ICatalogIndex> index = nullptr);
+
+    // 跟随发布器的目录快照：每个音频缓冲开始时检查是否有新快照并原子切换，publisher必须已发布过快照
+    Matcher(std::shared_ptr<CatalogPublisher> publisher, std::shared_ptr<IPerformanceConfig> config, const PCMFormat& format);
     ~Matcher() override;
 
     // 添加音频数据
@@ -29,14 +39,100 @@ public:
         signatureMatcher_->setMatchNotifyCallback(callback);
     }
 
+    // 设置诊断日志级别
+    void setLogLevel(MatcherLogLevel level) override {
+        logLevel_ = level;
+        signatureMatcher_->setLogLevel(level);
+    }
+
+    // 设置统计回调
+    void setStatsCallback(StatsCallback callback) override {
+        signatureMatcher_->setStatsCallback(std::move(callback));
+    }
+
+    // 设置查询侧匹配的线程数
+    void setMatchThreads(size_t threads) override {
+        signatureMatcher_->setMatchThreads(threads);
+    }
+
+    // 开启异步结果队列
+    void enableResultQueue(size_t capacity) override;
+
+    bool pollMatchResult(MatchResult& result) override;
+
+    bool waitMatchResult(MatchResult& result, double timeoutSeconds) override;
+
+    size_t droppedMatchResultCount() const override {
+        return droppedResultCount_.load(std::memory_order_relaxed);
+    }
+
+    MatcherPerformanceStats performanceStats() const override;
+
+    MatcherMemoryUsage memoryUsage() const override;
+
+    MatchLatencyStats latencyStats() const override {
+        return latencyStats_;
+    }
+
+    void resetLatencyStats() override {
+        latencyStats_.reset();
+    }
+
+    void enableTracing(size_t capacity) override;
+
+    bool dumpTrace(const std::string& filename) const override;
+
+    bool saveCheckpoint(std::vector<uint8_t>& out) override;
+
+    bool restoreCheckpoint(const uint8_t* data, size_t size) override;
+
     std::unique_ptr<SignatureMatcher> signatureMatcher_;
 
 private:
+    Matcher(std::shared_ptr<CatalogPublisher> publisher, std::shared_ptr<const CatalogSnapshot> snapshot,
+            std::shared_ptr<IPerformanceConfig> config, const PCMFormat& format);
+
+    // 切换到发布器的最新快照
+    void refreshSnapshot();
+
+    std::shared_ptr<CatalogPublisher> publisher_;
+    std::shared_ptr<const CatalogSnapshot> snapshot_;  // 当前使用的快照，切换前一直持有
     std::shared_ptr<ICatalog> catalog_;
     PCMFormat format_;  // 存储音频格式信息，包括通道数
     std::unique_ptr<SignatureGenerator> generator_;
     
     MatchCallback matchCallback_;
+    MatcherLogLevel logLevel_ = MatcherLogLevel::Verbose;
+
+    // 异步结果队列，开启后由匹配线程写入、消费者线程读取
+    std::unique_ptr<SpscQueue<MatchResult>> resultQueue_;
+    // 结果入队时通知阻塞在waitMatchResult中的消费者
+    WaitSignal resultSignal_;
+    std::atomic<size_t> droppedResultCount_{0};
+
+    // 流式匹配：生成器通过输出回调把新指纹点直接写入这里，每次调用后清空
+    std::vector<SignaturePoint> newQueryPoints_;
+
+    // 匹配侧的累计计数，调用线程以relaxed原子操作更新，performanceStats可在其他线程上读取
+    struct PerformanceCounters {
+        std::atomic<uint64_t> matchNanoseconds{0};
+        std::atomic<uint64_t> queryPointCount{0};
+        std::atomic<uint64_t> queryHitCount{0};
+        std::atomic<uint64_t> postingHitCount{0};
+        std::atomic<uint64_t> newSessionCount{0};
+        std::atomic<uint64_t> evictedSessionCount{0};
+        std::atomic<uint64_t> notifiedMatchCount{0};
+        std::atomic<size_t> activeSessionCount{0};
+    };
+    PerformanceCounters counters_;
+
+    // 匹配侧的事件追踪，生成侧的在generator_的流水线中
+    TraceRing trace_;
+
+    // 检测延迟由signatureMatcher_在通知结果时记录，处理耗时在appendStreamBuffer返回前记录
+    MatchLatencyStats latencyStats_;
+
+    void recordMatchStats(uint64_t matchNanoseconds);
 };
 
 } // namespace afp 
\ No newline at end of file
@@ -0,0 +1,118 @@
+#include "matcher/scatter_gather_matcher.h"
+#include <algorithm>
+#include "afp/signature_batch.h"
+
+namespace afp {
+
+ScatterGatherMatcher::ScatterGatherMatcher(std::vector<std::shared_ptr<ICatalogShard>> shards,
+                                           std::shared_ptr<IPerformanceConfig> config)
+    : shards_(std::move(shards))
+    , topMedia_(config->getMatchingConfig().coarseVoteTopMedia)
+    , shardRunner_(std::make_unique<ChannelTaskRunner>(shards_.empty() ? 0 : shards_.size() - 1))
+    , shardVotes_(shards_.size())
+    , shardMatches_(shards_.size())
+    , shardSucceeded_(shards_.size(), 0) {
+}
+
+ScatterGatherMatcher::~ScatterGatherMatcher() = default;
+
+template <typename Request>
+bool ScatterGatherMatcher::scatter(const Request& request) {
+    if (shards_.empty()) {
+        return false;
+    }
+    // 各分片的请求只写入自己的应答缓冲，不需要加锁
+    shardRunner_->run(shards_.size(), [&](size_t shardIndex) { shardSucceeded_[shardIndex] = request(shardIndex); });
+    return std::all_of(shardSucceeded_.begin(), shardSucceeded_.end(), [](uint8_t ok) { return ok != 0; });
+}
+
+bool ScatterGatherMatcher::addStream(StreamId streamId, size_t channelCount) {
+    if (streams_.count(streamId) != 0) {
+        return false;
+    }
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        if (!shards_[i]->addStream(streamId, channelCount)) {
+            for (size_t j = 0; j < i; ++j) {
+                shards_[j]->removeStream(streamId);
+            }
+            return false;
+        }
+    }
+    streams_.insert(streamId);
+    return true;
+}
+
+bool ScatterGatherMatcher::removeStream(StreamId streamId) {
+    if (streams_.erase(streamId) == 0) {
+        return false;
+    }
+    for (const auto& shard : shards_) {
+        shard->removeStream(streamId);
+    }
+    return true;
+}
+
+void ScatterGatherMatcher::selectGlobalTop() {
+    mergedVotes_.clear();
+    for (const auto& votes : shardVotes_) {
+        mergedVotes_.insert(mergedVotes_.end(), votes.begin(), votes.end());
+    }
+    // 每个分片返回的是本分片的前topMedia_名，全局前topMedia_名必然在其中
+    if (mergedVotes_.size() > topMedia_) {
+        std::nth_element(mergedVotes_.begin(), mergedVotes_.begin() + static_cast<std::ptrdiff_t>(topMedia_),
+                         mergedVotes_.end(), [](const ShardVote& a, const ShardVote& b) {
+                             return a.score != b.score ? a.score > b.score : a.signatureId < b.signatureId;
+                         });
+        mergedVotes_.resize(topMedia_);
+    }
+    selected_.clear();
+    for (const auto& vote : mergedVotes_) {
+        selected_.push_back(vote.signatureId);
+    }
+    std::sort(selected_.begin(), selected_.end());
+}
+
+bool ScatterGatherMatcher::appendSignaturePoints(StreamId streamId, const SignaturePoint* points, size_t count) {
+    if (streams_.count(streamId) == 0) {
+        return false;
+    }
+
+    // 第一步：各分片查找并计票
+    if (!scatter([&](size_t i) { return shards_[i]->vote(streamId, points, count, shardVotes_[i]); })) {
+        return false;
+    }
+    selectGlobalTop();
+
+    // 第二步：各分片只匹配全局前K名中属于自己的目标指纹，id按分片轮转划分，分片从升序的selected_中自行挑选
+    if (!scatter([&](size_t i) {
+            return shards_[i]->match(streamId, selected_.data(), selected_.size(), shardMatches_[i]);
+        })) {
+        return false;
+    }
+
+    if (!matchCallback_) {
+        return true;
+    }
+    orderedMatches_.clear();
+    for (const auto& matches : shardMatches_) {
+        for (const auto& match : matches) {
+            orderedMatches_.push_back(&match);
+        }
+    }
+    std::stable_sort(orderedMatches_.begin(), orderedMatches_.end(), [](const ShardMatch* a, const ShardMatch* b) {
+        return a->signatureId < b->signatureId;
+    });
+    for (const auto* match : orderedMatches_) {
+        matchCallback_(streamId, *match);
+    }
+    return true;
+}
+
+bool ScatterGatherMatcher::appendSignatureBatch(StreamId streamId, const uint8_t* data, size_t size) {
+    if (!SignatureBatchCodec::decode(data, size, decodedPoints_)) {
+        return false;
+    }
+    return appendSignaturePoints(streamId, decodedPoints_.data(), decodedPoints_.size());
+}
+
+} // namespace afp
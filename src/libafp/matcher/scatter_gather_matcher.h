@@ -0,0 +1,55 @@
+#pragma once
+#include <memory>
+#include <unordered_set>
+#include <vector>
+#include "afp/icatalog_shard.h"
+#include "afp/iperformance_config.h"
+#include "base/channel_task_runner.h"
+
+namespace afp {
+
+// 散射-聚合前端，见IScatterGatherMatcher
+// 每批的两步请求在各分片上并行执行：调用线程和shards.size()-1个常驻工作线程共同执行
+class ScatterGatherMatcher : public IScatterGatherMatcher {
+public:
+    // shards[i]的shardIndex()必须为i，shardCount()为shards.size()
+    ScatterGatherMatcher(std::vector<std::shared_ptr<ICatalogShard>> shards, std::shared_ptr<IPerformanceConfig> config);
+    ~ScatterGatherMatcher() override;
+
+    bool addStream(StreamId streamId, size_t channelCount) override;
+    bool removeStream(StreamId streamId) override;
+
+    bool appendSignaturePoints(StreamId streamId, const SignaturePoint* points, size_t count) override;
+
+    bool appendSignatureBatch(StreamId streamId, const uint8_t* data, size_t size) override;
+
+    void setMatchCallback(MatchCallback callback) override {
+        matchCallback_ = std::move(callback);
+    }
+
+private:
+    // 在每个分片上并行执行request(shardIndex)，全部成功时返回true
+    template <typename Request>
+    bool scatter(const Request& request);
+
+    // 把各分片的候选合并为全局前topMedia_名，同分时全局id小的优先（与不分片时的粗筛排名一致），结果按id升序
+    void selectGlobalTop();
+
+    std::vector<std::shared_ptr<ICatalogShard>> shards_;
+    size_t topMedia_;
+    // 各批的vote和match复用同一组工作线程
+    std::unique_ptr<ChannelTaskRunner> shardRunner_;
+    std::unordered_set<StreamId> streams_;
+    MatchCallback matchCallback_;
+
+    // 按分片的请求和应答缓冲，批之间复用
+    std::vector<std::vector<ShardVote>> shardVotes_;
+    std::vector<std::vector<ShardMatch>> shardMatches_;
+    std::vector<uint8_t> shardSucceeded_;
+    std::vector<ShardVote> mergedVotes_;
+    std::vector<uint32_t> selected_;
+    std::vector<SignaturePoint> decodedPoints_;
+    std::vector<const ShardMatch*> orderedMatches_;
+};
+
+} // namespace afp
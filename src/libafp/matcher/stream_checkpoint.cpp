@@ -0,0 +1,55 @@
+#include "matcher/stream_checkpoint.h"
+#include "base/state_stream.h"
+
+namespace afp {
+
+namespace {
+
+// 检查点的格式版本，格式变化时递增
+constexpr uint64_t kCheckpointVersion = 1;
+
+} // namespace
+
+bool saveStreamCheckpoint(SignatureGenerator& generator, const SignatureMatcher& matcher, std::vector<uint8_t>& out) {
+    std::vector<uint8_t> generatorState;
+    if (!generator.saveState(generatorState)) {
+        return false;
+    }
+    saveStreamCheckpoint(generatorState, matcher, out);
+    return true;
+}
+
+void saveStreamCheckpoint(const std::vector<uint8_t>& generatorState, const SignatureMatcher& matcher,
+                          std::vector<uint8_t>& out) {
+    StateWriter writer(out);
+    writer.writeVarint(kCheckpointVersion);
+    writer.writeVarint(generatorState.size());
+    out.insert(out.end(), generatorState.begin(), generatorState.end());
+    matcher.saveState(writer);
+}
+
+bool restoreStreamCheckpoint(SignatureGenerator& generator, SignatureMatcher& matcher, const uint8_t* data, size_t size) {
+    StateReader reader(data, size);
+    if (reader.readVarint() != kCheckpointVersion) {
+        return false;
+    }
+    const size_t generatorStateSize = reader.readCount(reader.remaining());
+    if (!reader.ok()) {
+        return false;
+    }
+    const uint8_t* generatorState = data + (size - reader.remaining());
+    StateReader matcherReader(generatorState + generatorStateSize, reader.remaining() - generatorStateSize);
+
+    // 先恢复session，失败时匹配器已回到reset之后的状态；生成器只在全部成功时替换
+    if (!matcher.restoreState(matcherReader) || !matcherReader.atEnd()) {
+        matcher.reset();
+        return false;
+    }
+    if (!generator.restoreState(generatorState, generatorStateSize)) {
+        matcher.reset();
+        return false;
+    }
+    return true;
+}
+
+} // namespace afp
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "signature/signature_generator.h"
+#include "signature/signature_matcher.h"
+
+namespace afp {
+
+// 单路流的检查点，Matcher和MatchEngine共用同一格式，可以互相迁移：
+// 格式版本、查询指纹生成的状态（带长度）、SignatureMatcher的session状态
+
+// 把生成器和匹配器的状态追加到out，生成器未初始化时返回false
+bool saveStreamCheckpoint(SignatureGenerator& generator, const SignatureMatcher& matcher, std::vector<uint8_t>& out);
+
+// 同上，生成器的状态已由SignatureGenerator::saveState保存在generatorState中（如挂起的流）
+void saveStreamCheckpoint(const std::vector<uint8_t>& generatorState, const SignatureMatcher& matcher,
+                          std::vector<uint8_t>& out);
+
+// 恢复检查点，生成器需已init且尚未输入数据；失败时生成器保持原状，匹配器回到reset之后的状态
+bool restoreStreamCheckpoint(SignatureGenerator& generator, SignatureMatcher& matcher, const uint8_t* data, size_t size);
+
+} // namespace afp
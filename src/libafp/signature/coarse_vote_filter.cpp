@@ -0,0 +1,126 @@
+#include "signature/coarse_vote_filter.h"
+#include <algorithm>
+
+namespace afp {
+
+CoarseVoteFilter::CoarseVoteFilter(size_t topMedia, size_t bucketMs)
+    : topMedia_(topMedia)
+    , bucketMs_(static_cast<int64_t>(std::max<size_t>(1, bucketMs))) {
+}
+
+void CoarseVoteFilter::reset(size_t signatureCount) {
+    votes_.clear();
+    touched_.clear();
+    scores_.assign(enabled() ? signatureCount : 0, 0);
+    passed_.assign(enabled() ? signatureCount : 0, 0);
+    selectedCount_ = 0;
+}
+
+void CoarseVoteFilter::beginBatch() {
+    for (const auto signatureIndex : touched_) {
+        scores_[signatureIndex] = 0;
+        passed_[signatureIndex] = 0;
+    }
+    touched_.clear();
+    votes_.clear();
+    selectedCount_ = 0;
+}
+
+void CoarseVoteFilter::select() {
+    if (votes_.empty()) {
+        return;
+    }
+
+    // 排序后同一目标指纹的票按偏移桶连续排列
+    std::sort(votes_.begin(), votes_.end());
+
+    size_t i = 0;
+    uint32_t previousBucketCount = 0;
+    uint64_t previousBucket = 0;
+    while (i < votes_.size()) {
+        const uint64_t key = votes_[i];
+        size_t j = i + 1;
+        while (j < votes_.size() && votes_[j] == key) {
+            ++j;
+        }
+
+        const auto signatureIndex = static_cast<uint32_t>(key >> 32);
+        const uint64_t bucket = key & 0xFFFFFFFFull;
+        if (signatureIndex >= scores_.size()) {
+            i = j;
+            continue;
+        }
+
+        const bool firstOfSignature = i == 0 || (votes_[i - 1] >> 32) != signatureIndex;
+        if (firstOfSignature) {
+            touched_.push_back(signatureIndex);
+            previousBucketCount = 0;
+        }
+
+        // 与前一个相邻桶合并，容忍偏移跨越桶边界
+        const auto count = static_cast<uint32_t>(j - i);
+        const uint32_t windowCount = count + (!firstOfSignature && previousBucket + 1 == bucket ? previousBucketCount : 0);
+        scores_[signatureIndex] = std::max(scores_[signatureIndex], windowCount);
+
+        previousBucket = bucket;
+        previousBucketCount = count;
+        i = j;
+    }
+
+    if (touched_.size() <= topMedia_) {
+        for (const auto signatureIndex : touched_) {
+            passed_[signatureIndex] = 1;
+        }
+        selectedCount_ = touched_.size();
+        return;
+    }
+
+    // 选出得分最高的topMedia个目标指纹，同分时下标小的优先
+    ranked_.assign(touched_.begin(), touched_.end());
+    std::nth_element(ranked_.begin(), ranked_.begin() + static_cast<std::ptrdiff_t>(topMedia_), ranked_.end(),
+        [this](uint32_t a, uint32_t b) {
+            return scores_[a] != scores_[b] ? scores_[a] > scores_[b] : a < b;
+        });
+    for (size_t k = 0; k < topMedia_; ++k) {
+        passed_[ranked_[k]] = 1;
+    }
+    selectedCount_ = topMedia_;
+}
+
+void CoarseVoteFilter::selectedCandidates(std::vector<std::pair<uint32_t, uint32_t>>& out) const {
+    out.clear();
+    if (!enabled()) {
+        return;
+    }
+    for (const auto signatureIndex : touched_) {
+        if (passed_[signatureIndex]) {
+            out.emplace_back(signatureIndex, scores_[signatureIndex]);
+        }
+    }
+}
+
+void CoarseVoteFilter::restrictTo(const std::vector<uint32_t>& selected) {
+    if (!enabled()) {
+        return;
+    }
+    // 先把本批通过的位置标为2，selected中仍通过的恢复为1，其余清零
+    for (const auto signatureIndex : touched_) {
+        if (passed_[signatureIndex]) {
+            passed_[signatureIndex] = 2;
+        }
+    }
+    selectedCount_ = 0;
+    for (const auto signatureIndex : selected) {
+        if (signatureIndex < passed_.size() && passed_[signatureIndex] == 2) {
+            passed_[signatureIndex] = 1;
+            ++selectedCount_;
+        }
+    }
+    for (const auto signatureIndex : touched_) {
+        if (passed_[signatureIndex] == 2) {
+            passed_[signatureIndex] = 0;
+        }
+    }
+}
+
+} // namespace afp
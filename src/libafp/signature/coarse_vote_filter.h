@@ -0,0 +1,70 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace afp {
+
+// 粗筛投票：session匹配之前，以很低的代价按目标指纹给本批查询命中计票
+// 每个命中按(目标指纹, 偏移/桶宽)计一票，目标指纹的得分为其相邻两个偏移桶的最大票数之和，
+// 即偏移集中在一个桶宽范围内的命中数。只有得分最高的topMedia个目标指纹通过筛选。
+// 票数保存在按目标指纹下标的稠密数组中，每批只重置被命中过的位置，计票用的排序缓冲在批之间复用。
+class CoarseVoteFilter {
+public:
+    CoarseVoteFilter(size_t topMedia, size_t bucketMs);
+
+    // topMedia为0时不做粗筛
+    bool enabled() const { return topMedia_ > 0; }
+
+    // 目录切换后按新的目标指纹数量重新分配
+    void reset(size_t signatureCount);
+
+    // 开始新一批计票
+    void beginBatch();
+
+    // 为目标指纹signatureIndex在实际偏移offsetMs处计一票
+    void addVote(uint32_t signatureIndex, int32_t offsetMs) {
+        const int64_t bucket = (offsetMs >= 0 ? offsetMs : offsetMs - bucketMs_ + 1) / bucketMs_;
+        votes_.push_back((static_cast<uint64_t>(signatureIndex) << 32) |
+                         static_cast<uint32_t>(bucket + kBucketBias));
+    }
+
+    // 统计本批票数并选出通过筛选的目标指纹
+    void select();
+
+    // 本批通过筛选的目标指纹及其得分(下标, 得分)，按下标升序
+    void selectedCandidates(std::vector<std::pair<uint32_t, uint32_t>>& out) const;
+
+    // 只保留selected（升序）中的目标指纹，其余不再通过；目录分片时由各分片候选合并后的全局排名决定
+    void restrictTo(const std::vector<uint32_t>& selected);
+
+    // 目标指纹是否通过本批筛选
+    bool passes(uint32_t signatureIndex) const {
+        return !enabled() || (signatureIndex < passed_.size() && passed_[signatureIndex]);
+    }
+
+    // 本批得票的目标指纹数量 / 通过筛选的目标指纹数量
+    size_t votedMediaCount() const { return touched_.size(); }
+    size_t selectedMediaCount() const { return selectedCount_; }
+
+    // 计票和排名缓冲占用的内存（字节）
+    size_t memoryUsage() const {
+        return votes_.capacity() * sizeof(uint64_t) + (scores_.capacity() + touched_.capacity() + ranked_.capacity()) * sizeof(uint32_t) +
+               passed_.capacity();
+    }
+
+private:
+    static constexpr int64_t kBucketBias = int64_t(1) << 31;
+
+    size_t topMedia_;
+    int64_t bucketMs_;
+    std::vector<uint64_t> votes_;      // (目标指纹下标 << 32) | 偏移桶
+    std::vector<uint32_t> scores_;     // 按目标指纹下标的得分
+    std::vector<uint8_t> passed_;      // 按目标指纹下标的筛选结果
+    std::vector<uint32_t> touched_;    // 本批得票的目标指纹下标
+    std::vector<uint32_t> ranked_;     // 排名用的缓冲
+    size_t selectedCount_ = 0;
+};
+
+} // namespace afp
@@ -459,6 +459,7 @@ void PeekDetector::erasePeakCache(uint32_t channel, double consumedTimestamp) {
 void PeekDetector::reset() {
     peakCache_.clear();
     slidingWindowMap_.clear();
+    noiseTrackers_.clear();
     std::cout << "[DEBUG-重置] PeekDetector: 已重置所有峰值缓存和滑动窗口状态" << std::endl;
 }
 
@@ -754,57 +755,39 @@ std::vector<float> PeekDetector::estimateBandNoiseLevel(
     std::vector<float> currentNoiseLevel(frequencyBands.size(), 0.0f);
     for (size_t bandIdx = 0; bandIdx < frequencyBands.size(); ++bandIdx) {
         if (!currentBandMagnitudes[bandIdx].empty()) {
-            std::sort(currentBandMagnitudes[bandIdx].begin(), currentBandMagnitudes[bandIdx].end());
-            size_t n = currentBandMagnitudes[bandIdx].size();
-            size_t noiseIndex = n / 4;  // 25分位数
-            currentNoiseLevel[bandIdx] = currentBandMagnitudes[bandIdx][noiseIndex];
+            auto& magnitudes = currentBandMagnitudes[bandIdx];
+            size_t noiseIndex = magnitudes.size() / 4;  // 25分位数
+            std::nth_element(magnitudes.begin(), magnitudes.begin() + noiseIndex, magnitudes.end());
+            currentNoiseLevel[bandIdx] = magnitudes[noiseIndex];
         }
     }
     
-    // 如果有历史噪声数据，结合历史数据进行更准确的估计
-    if (noiseHistory_.find(channel) != noiseHistory_.end() && !noiseHistory_[channel].empty()) {
-        const auto& history = noiseHistory_[channel];
-        const auto& peakConfig = config_->getPeakDetectionConfig();
-        double currentTime = fftResults[wndEndIdx - 1].timestamp;
+    // 如果已有滑动估计，结合历史数据进行更准确的估计
+    auto trackerIt = noiseTrackers_.find(channel);
+    if (trackerIt != noiseTrackers_.end()) {
+        const auto& tracker = trackerIt->second;
         
         std::cout << "[DEBUG-噪声估计] PeekDetector: 通道" << channel 
-                  << "使用" << history.size() << "个历史噪声记录进行估计" << std::endl;
-        
-        // 收集有效的历史噪声数据
-        std::vector<std::vector<float>> historicalNoise(frequencyBands.size());
-        
-        for (const auto& entry : history) {
-            // 只使用时间窗口内的历史数据
-            if (currentTime - entry.timestamp <= peakConfig.noiseEstimationWindow) {
-                for (size_t bandIdx = 0; bandIdx < frequencyBands.size() && bandIdx < entry.bandNoiseLevel.size(); ++bandIdx) {
-                    if (entry.bandNoiseLevel[bandIdx] > 0.0f) {
-                        historicalNoise[bandIdx].push_back(entry.bandNoiseLevel[bandIdx]);
-                    }
-                }
-            }
-        }
+                  << "使用滑动噪声估计" << std::endl;
         
         // 结合当前和历史数据计算最终噪声水平
         for (size_t bandIdx = 0; bandIdx < frequencyBands.size(); ++bandIdx) {
-            if (!historicalNoise[bandIdx].empty()) {
-                // 计算历史噪声的中位数
-                std::sort(historicalNoise[bandIdx].begin(), historicalNoise[bandIdx].end());
-                size_t n = historicalNoise[bandIdx].size();
-                float historicalMedian = historicalNoise[bandIdx][n / 2];
+            if (tracker.hasLevel(bandIdx)) {
+                float historicalLevel = tracker.level(bandIdx);
                 
                 // 加权平均：70%历史数据 + 30%当前数据
                 float historicalWeight = 0.7f;
                 float currentWeight = 0.3f;
                 
                 if (currentNoiseLevel[bandIdx] > 0.0f) {
-                    bandNoiseLevel[bandIdx] = historicalWeight * historicalMedian + 
+                    bandNoiseLevel[bandIdx] = historicalWeight * historicalLevel + 
                                             currentWeight * currentNoiseLevel[bandIdx];
                 } else {
-                    bandNoiseLevel[bandIdx] = historicalMedian;
+                    bandNoiseLevel[bandIdx] = historicalLevel;
                 }
                 
                 std::cout << "[DEBUG-噪声融合] PeekDetector: 频段" << bandIdx+1 
-                          << " 历史中位数: " << historicalMedian 
+                          << " 历史估计: " << historicalLevel 
                           << ", 当前估计: " << currentNoiseLevel[bandIdx]
                           << ", 融合结果: " << bandNoiseLevel[bandIdx] << std::endl;
             } else {
@@ -844,42 +827,19 @@ std::vector<float> PeekDetector::calculateBandSNR(
     return bandSNR;
 }
 
-// 更新噪声历史记录
+// 更新噪声滑动估计，每次的开销与噪声估计窗口的长度无关
 void PeekDetector::updateNoiseHistory(
     uint32_t channel,
     const std::vector<float>& bandNoiseLevel,
     double timestamp) {
     
-    const auto& peakConfig = config_->getPeakDetectionConfig();
-    
-    // 确保通道存在
-    if (noiseHistory_.find(channel) == noiseHistory_.end()) {
-        noiseHistory_[channel] = std::vector<NoiseHistoryEntry>();
+    auto trackerIt = noiseTrackers_.find(channel);
+    if (trackerIt == noiseTrackers_.end()) {
+        const auto& peakConfig = config_->getPeakDetectionConfig();
+        trackerIt = noiseTrackers_.emplace(channel, BandNoiseTracker(peakConfig.noiseEstimationWindow)).first;
     }
     
-    // 添加新的噪声记录
-    NoiseHistoryEntry entry;
-    entry.timestamp = timestamp;
-    entry.bandNoiseLevel = bandNoiseLevel;
-    noiseHistory_[channel].push_back(entry);
-    
-    // 清理过期的噪声记录
-    double expireTime = timestamp - peakConfig.noiseEstimationWindow;
-    auto& history = noiseHistory_[channel];
-    
-    auto it = std::remove_if(history.begin(), history.end(),
-        [expireTime](const NoiseHistoryEntry& entry) {
-            return entry.timestamp < expireTime;
-        });
-    
-    if (it != history.end()) {
-        size_t removedCount = std::distance(it, history.end());
-        history.erase(it, history.end());
-        
-        std::cout << "[DEBUG-噪声历史] PeekDetector: 通道" << channel 
-                  << "清理了" << removedCount << "个过期噪声记录，剩余" 
-                  << history.size() << "个记录" << std::endl;
-    }
+    trackerIt->second.update(bandNoiseLevel, timestamp);
 }
 
 } // namespace afp
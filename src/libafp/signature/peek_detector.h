@@ -1,6 +1,7 @@
 #pragma once
 
 #include "signature_generator.h"
+#include "signature_generation_pipeline/peak_detection/band_noise_tracker.h"
 #include <vector>
 #include <map>
 
@@ -91,7 +92,7 @@ private:
         const std::vector<float>& bandEnergies,
         const std::vector<float>& bandNoiseLevel);
     
-    // 更新噪声历史记录
+    // 用本窗口的噪声估计更新该通道的滑动估计
     void updateNoiseHistory(
         uint32_t channel,
         const std::vector<float>& bandNoiseLevel,
@@ -107,11 +108,7 @@ private:
     bool* collectVisualizationData_;
     VisualizationData* visualizationData_;
     
-    // 噪声估计历史记录
-    struct NoiseHistoryEntry {
-        double timestamp;
-        std::vector<float> bandNoiseLevel;
-    };
-    std::map<uint32_t, std::vector<NoiseHistoryEntry>> noiseHistory_;
+    // 每个通道各频段噪声水平的滑动估计
+    std::map<uint32_t, BandNoiseTracker> noiseTrackers_;
 };
 }
\ No newline at end of file
@@ -0,0 +1,164 @@
+#include "signature/segmented_signature_generator.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <numeric>
+#include <thread>
+#include "signature_generation_pipeline/signature_generation_pipeline.h"
+
+namespace afp {
+
+SegmentedSignatureGenerator::SegmentedSignatureGenerator(std::shared_ptr<IPerformanceConfig> config,
+                                                         const PCMFormat& format,
+                                                         size_t jobs)
+    : config_(config)
+    , format_(format)
+    , jobs_(std::max<size_t>(1, jobs)) {
+    const auto& fft_config = config_->getFFTConfig();
+    const auto& peak_config = config_->getPeakDetectionConfig();
+    const auto& signature_config = config_->getSignatureGenerationConfig();
+
+    blockSampleCount_ = fft_config.fftSize;
+    blockByteCount_ = blockSampleCount_ * format_.frameSize();
+
+    // 段起点必须同时是通道分离的块边界（预加重按块进行）和短帧的起点（短帧按hop滑动）
+    alignBlockCount_ = fft_config.hopSize / std::gcd(fft_config.fftSize, fft_config.hopSize);
+
+    // 预热需要覆盖的上下文：FFT窗口 + 峰值检测窗口及其前后保护帧 + 长帧及对称帧范围，取两倍余量
+    const double sample_rate = static_cast<double>(format_.sampleRate());
+    const double short_frame_duration = static_cast<double>(fft_config.hopSize) / sample_rate;
+    const double context_duration =
+        static_cast<double>(fft_config.fftSize) / sample_rate +
+        peak_config.peakTimeDuration + 2 * peak_config.timeMaxRange * short_frame_duration +
+        (2 * signature_config.symmetricFrameRange + 2) * signature_config.frameDuration;
+    const double block_duration = static_cast<double>(blockSampleCount_) / sample_rate;
+    const size_t context_blocks = static_cast<size_t>(std::ceil(2 * context_duration / block_duration));
+    warmupBlockCount_ = std::max<size_t>(1, (context_blocks + alignBlockCount_ - 1) / alignBlockCount_) * alignBlockCount_;
+}
+
+bool SegmentedSignatureGenerator::generate(const void* buffer,
+                                          size_t bufferSize,
+                                          double startTimestamp,
+                                          std::vector<SignaturePoint>& signature) const {
+    signature.clear();
+    if (!buffer || blockByteCount_ == 0 || format_.channels() == 0 || format_.channels() > max_channel_count) {
+        return false;
+    }
+
+    const auto* data = static_cast<const uint8_t*>(buffer);
+    const size_t total_blocks = bufferSize / blockByteCount_;
+
+    // 每段至少包含4倍预热长度，保证预热开销不超过25%
+    size_t segment_count = std::min(jobs_, total_blocks / (4 * warmupBlockCount_));
+    if (format_.channels() > 1) {
+        segment_count = 1;
+    }
+    segment_count = std::max<size_t>(1, segment_count);
+
+    const size_t total_align_units = (total_blocks + alignBlockCount_ - 1) / alignBlockCount_;
+    const size_t blocks_per_segment = (total_align_units + segment_count - 1) / segment_count * alignBlockCount_;
+
+    std::vector<Segment> segments;
+    for (size_t start_block = 0; segments.empty() || start_block < total_blocks; start_block += blocks_per_segment) {
+        Segment segment;
+        segment.startBlock = start_block;
+        segment.warmupStartBlock = start_block > warmupBlockCount_ ? start_block - warmupBlockCount_ : 0;
+        segment.endByte = std::min(bufferSize, (start_block + blocks_per_segment) * blockByteCount_);
+        segments.push_back(segment);
+    }
+    segments.back().endByte = bufferSize;  // 最后一段包含末尾不足一块的数据
+
+    std::cout << "分段并行生成指纹: 段数=" << segments.size()
+              << ", 每段块数=" << blocks_per_segment
+              << ", 预热块数=" << warmupBlockCount_ << std::endl;
+
+    std::vector<std::vector<SignaturePoint>> segment_signatures(segments.size());
+    if (segments.size() == 1) {
+        generateSegment(data, startTimestamp, segments[0], segment_signatures[0]);
+    } else {
+        std::vector<std::thread> workers;
+        workers.reserve(segments.size());
+        for (size_t i = 0; i < segments.size(); ++i) {
+            workers.emplace_back([&, i]() {
+                generateSegment(data, startTimestamp, segments[i], segment_signatures[i]);
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    // 按段顺序拼接
+    size_t total_points = 0;
+    for (const auto& segment_signature : segment_signatures) {
+        total_points += segment_signature.size();
+    }
+    signature.reserve(total_points);
+    for (auto& segment_signature : segment_signatures) {
+        signature.insert(signature.end(), segment_signature.begin(), segment_signature.end());
+    }
+
+    return true;
+}
+
+void SegmentedSignatureGenerator::generateSegment(const uint8_t* data,
+                                                 double startTimestamp,
+                                                 const Segment& segment,
+                                                 std::vector<SignaturePoint>& signature) const {
+    bool collecting = false;
+    // 多通道输入不分段，用通道并行代替
+    const bool parallel_channels = format_.channels() > 1 && jobs_ > 1;
+    SignatureGenerationPipeline pipeline(config_, std::make_shared<PCMFormat>(format_),
+        [&](const std::vector<SignaturePoint>& points) {
+            if (collecting) {
+                signature.insert(signature.end(), points.begin(), points.end());
+            }
+        },
+        false, parallel_channels);
+
+    VisualizationConfig visualization_config;
+    pipeline.attachVisualizationConfig(&visualization_config);
+    // 离线生成，各段的处理耗时互不相关，按配置全量处理
+    pipeline.disableDegradation();
+
+    // 从中间开始处理时，按完整流推算第一个短帧的时间戳以及所在的峰值检测窗口
+    double segment_timestamp = startTimestamp;
+    if (segment.warmupStartBlock > 0) {
+        const size_t first_window_index = segment.warmupStartBlock * blockSampleCount_ / config_->getFFTConfig().hopSize;
+        segment_timestamp = shortFrameTimestamp(startTimestamp, first_window_index);
+        pipeline.setPeakDetectionWindowOrigin(peakDetectionWindowOrigin(startTimestamp, segment_timestamp));
+    }
+
+    // 预热：输出丢弃
+    const size_t warmup_start_byte = segment.warmupStartBlock * blockByteCount_;
+    const size_t start_byte = segment.startBlock * blockByteCount_;
+    if (start_byte > warmup_start_byte) {
+        pipeline.appendStreamBuffer(data + warmup_start_byte, start_byte - warmup_start_byte, segment_timestamp);
+    }
+
+    // 本段负责输出的部分，按块边界与完整流的输出批次一一对应
+    collecting = true;
+    if (segment.endByte > start_byte) {
+        pipeline.appendStreamBuffer(data + start_byte, segment.endByte - start_byte, segment_timestamp);
+    }
+}
+
+double SegmentedSignatureGenerator::shortFrameTimestamp(double startTimestamp, size_t windowIndex) const {
+    const double hop_duration = static_cast<double>(config_->getFFTConfig().hopSize) / format_.sampleRate();
+    double timestamp = startTimestamp;
+    for (size_t i = 0; i < windowIndex; ++i) {
+        timestamp += hop_duration;
+    }
+    return timestamp;
+}
+
+double SegmentedSignatureGenerator::peakDetectionWindowOrigin(double startTimestamp, double timestamp) const {
+    const double window_duration = config_->getPeakDetectionConfig().peakTimeDuration;
+    double window_start_time = startTimestamp;
+    while (timestamp >= window_start_time + window_duration) {
+        window_start_time += window_duration;
+    }
+    return window_start_time;
+}
+
+} // namespace afp
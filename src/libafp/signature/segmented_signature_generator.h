@@ -0,0 +1,55 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include "afp/iperformance_config.h"
+#include "afp/isignature_generator.h"
+#include "afp/pcm_format.h"
+
+namespace afp {
+
+// 长录音分段并行生成指纹（离线模式）
+// 把一段完整的PCM数据切分为多个段，每段在独立的流水线实例上并行处理，再按顺序拼接各段的输出。
+// 每段向前多处理一段预热数据，覆盖FFT窗口、峰值检测窗口(peakTimeDuration + timeMaxRange)、长帧和symmetricFrameRange的上下文，
+// 预热期间的输出直接丢弃；段边界对齐到FFT块与hop的公倍数，起始时间戳和峰值检测窗口边界按完整流的累加方式推算，
+// 因此拼接结果与单个SignatureGenerator对同一数据调用appendStreamBuffer的结果逐字节一致。
+// 多通道输入的短帧时间戳在通道之间共享累加，无法从中间对齐，此时不分段，改为在单个流水线内按通道并行处理。
+class SegmentedSignatureGenerator {
+public:
+    SegmentedSignatureGenerator(std::shared_ptr<IPerformanceConfig> config, const PCMFormat& format, size_t jobs);
+
+    // 生成整段PCM数据的指纹，startTimestamp为数据第一个样本的时间戳
+    bool generate(const void* buffer,
+                 size_t bufferSize,
+                 double startTimestamp,
+                 std::vector<SignaturePoint>& signature) const;
+
+private:
+    struct Segment {
+        size_t warmupStartBlock;  // 预热起点（块下标，一块为fftSize个样本）
+        size_t startBlock;        // 输出起点
+        size_t endByte;           // 输出终点（字节），最后一段为数据末尾
+    };
+
+    void generateSegment(const uint8_t* data,
+                        double startTimestamp,
+                        const Segment& segment,
+                        std::vector<SignaturePoint>& signature) const;
+
+    // 完整流中第windowIndex个短帧的时间戳（与FftPhase相同的累加方式）
+    double shortFrameTimestamp(double startTimestamp, size_t windowIndex) const;
+
+    // 完整流中包含timestamp的峰值检测窗口起点（与PeakDetectionPhase相同的累加方式）
+    double peakDetectionWindowOrigin(double startTimestamp, double timestamp) const;
+
+private:
+    std::shared_ptr<IPerformanceConfig> config_;
+    PCMFormat format_;
+    size_t jobs_;
+
+    size_t blockSampleCount_;   // 每块样本数，与通道分离阶段的缓冲区大小一致
+    size_t blockByteCount_;
+    size_t alignBlockCount_;    // 段边界对齐的块数：块起点同时也是短帧起点
+    size_t warmupBlockCount_;   // 每段的预热块数
+};
+
+} // namespace afp
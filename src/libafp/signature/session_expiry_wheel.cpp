@@ -0,0 +1,200 @@
+#include "signature/session_expiry_wheel.h"
+#include <algorithm>
+#include <cmath>
+#include "base/state_stream.h"
+
+namespace afp {
+
+SessionExpiryWheel::SessionExpiryWheel(size_t capacity, double tickSeconds)
+    : tickSeconds_(tickSeconds > 0.0 ? tickSeconds : 1.0)
+    , heads_(kLevels * kSlots + 1, SessionTable::kInvalidHandle)
+    , next_(capacity, SessionTable::kInvalidHandle)
+    , prev_(capacity, SessionTable::kInvalidHandle)
+    , bucket_(capacity, kNoBucket)
+    , ticks_(capacity, 0) {
+}
+
+int64_t SessionExpiryWheel::tickOf(double time) const {
+    return static_cast<int64_t>(std::floor(time / tickSeconds_));
+}
+
+uint32_t SessionExpiryWheel::bucketOf(int64_t tick) const {
+    if (tick <= currentTick_) {
+        return kCurrentBucket;
+    }
+    // 找到tick与当前tick高位相同的最低一层，放在该层tick对应的槽中
+    for (size_t level = 0; level < kLevels; ++level) {
+        const int upperShift = kLevelBits * static_cast<int>(level + 1);
+        if ((tick >> upperShift) == (currentTick_ >> upperShift)) {
+            const int shift = kLevelBits * static_cast<int>(level);
+            return static_cast<uint32_t>(level * kSlots + ((tick >> shift) & (kSlots - 1)));
+        }
+    }
+    // 超出时间轮范围，放在最高层最晚才会下放的槽中，下放时重新放置
+    const size_t level = kLevels - 1;
+    const int shift = kLevelBits * static_cast<int>(level);
+    return static_cast<uint32_t>(level * kSlots + (((currentTick_ >> shift) - 1) & (kSlots - 1)));
+}
+
+void SessionExpiryWheel::link(SessionTable::Handle handle, uint32_t bucket) {
+    const auto head = heads_[bucket];
+    next_[handle] = head;
+    prev_[handle] = SessionTable::kInvalidHandle;
+    if (head != SessionTable::kInvalidHandle) {
+        prev_[head] = handle;
+    }
+    heads_[bucket] = handle;
+    bucket_[handle] = bucket;
+    ++size_;
+    if (bucket == kCurrentBucket) {
+        ++currentSize_;
+    }
+}
+
+void SessionExpiryWheel::unlink(SessionTable::Handle handle) {
+    const auto bucket = bucket_[handle];
+    if (bucket == kNoBucket) {
+        return;
+    }
+    if (prev_[handle] != SessionTable::kInvalidHandle) {
+        next_[prev_[handle]] = next_[handle];
+    } else {
+        heads_[bucket] = next_[handle];
+    }
+    if (next_[handle] != SessionTable::kInvalidHandle) {
+        prev_[next_[handle]] = prev_[handle];
+    }
+    bucket_[handle] = kNoBucket;
+    --size_;
+    if (bucket == kCurrentBucket) {
+        --currentSize_;
+    }
+}
+
+void SessionExpiryWheel::schedule(SessionTable::Handle handle, double deadline) {
+    unlink(handle);
+    const int64_t tick = tickOf(deadline);
+    ticks_[handle] = tick;
+    // 轮为空时直接跳到过期tick之前，避免之后逐tick推进空槽
+    if (size_ == 0 && tick - 1 > currentTick_) {
+        currentTick_ = tick - 1;
+    }
+    link(handle, bucketOf(tick));
+}
+
+void SessionExpiryWheel::cancel(SessionTable::Handle handle) {
+    if (handle < bucket_.size()) {
+        unlink(handle);
+    }
+}
+
+void SessionExpiryWheel::clear() {
+    std::fill(heads_.begin(), heads_.end(), SessionTable::kInvalidHandle);
+    std::fill(bucket_.begin(), bucket_.end(), kNoBucket);
+    size_ = 0;
+    currentSize_ = 0;
+}
+
+void SessionExpiryWheel::cascade(uint32_t bucket) {
+    // 先整体摘下链表再逐个放置，超出范围的session可能被放回同一个槽
+    auto handle = heads_[bucket];
+    heads_[bucket] = SessionTable::kInvalidHandle;
+    while (handle != SessionTable::kInvalidHandle) {
+        const auto next = next_[handle];
+        bucket_[handle] = kNoBucket;
+        --size_;
+        link(handle, bucketOf(ticks_[handle]));
+        handle = next;
+    }
+}
+
+void SessionExpiryWheel::drain(uint32_t bucket, std::vector<SessionTable::Handle>& due) {
+    auto handle = heads_[bucket];
+    heads_[bucket] = SessionTable::kInvalidHandle;
+    while (handle != SessionTable::kInvalidHandle) {
+        const auto next = next_[handle];
+        bucket_[handle] = kNoBucket;
+        --size_;
+        if (bucket == kCurrentBucket) {
+            --currentSize_;
+        }
+        due.push_back(handle);
+        handle = next;
+    }
+}
+
+void SessionExpiryWheel::collectDue(double now, std::vector<SessionTable::Handle>& due) {
+    const int64_t target = tickOf(now);
+    while (currentTick_ < target) {
+        if (size_ == currentSize_) {
+            // 各层槽都为空，直接跳到目标tick
+            currentTick_ = target;
+            break;
+        }
+        ++currentTick_;
+        // 从高层到低层，低位全为0的层把当前槽下放
+        for (size_t level = kLevels - 1; level > 0; --level) {
+            const int shift = kLevelBits * static_cast<int>(level);
+            if ((currentTick_ & ((int64_t(1) << shift) - 1)) == 0) {
+                cascade(static_cast<uint32_t>(level * kSlots + ((currentTick_ >> shift) & (kSlots - 1))));
+            }
+        }
+        drain(static_cast<uint32_t>(currentTick_ & (kSlots - 1)), due);
+    }
+    drain(kCurrentBucket, due);
+}
+
+void SessionExpiryWheel::saveState(StateWriter& writer) const {
+    writer.writeSigned(currentTick_);
+    uint32_t bucketCount = 0;
+    for (const auto head : heads_) {
+        bucketCount += head != SessionTable::kInvalidHandle ? 1 : 0;
+    }
+    writer.writeVarint(bucketCount);
+    for (uint32_t bucket = 0; bucket < heads_.size(); ++bucket) {
+        if (heads_[bucket] == SessionTable::kInvalidHandle) {
+            continue;
+        }
+        size_t count = 0;
+        for (auto handle = heads_[bucket]; handle != SessionTable::kInvalidHandle; handle = next_[handle]) {
+            ++count;
+        }
+        writer.writeVarint(bucket);
+        writer.writeVarint(count);
+        for (auto handle = heads_[bucket]; handle != SessionTable::kInvalidHandle; handle = next_[handle]) {
+            writer.writeVarint(handle);
+            writer.writeSigned(ticks_[handle]);
+        }
+    }
+}
+
+void SessionExpiryWheel::restoreState(StateReader& reader, const std::function<bool(SessionTable::Handle)>& isLive) {
+    clear();
+    currentTick_ = reader.readSigned();
+    const size_t bucketCount = reader.readCount(heads_.size());
+    std::vector<SessionTable::Handle> handles;
+    for (size_t i = 0; i < bucketCount && reader.ok(); ++i) {
+        const auto bucket = static_cast<uint32_t>(reader.readCount(heads_.size() - 1));
+        handles.clear();
+        const size_t count = reader.readCount(bucket_.size());
+        for (size_t j = 0; j < count && reader.ok(); ++j) {
+            const auto handle = static_cast<SessionTable::Handle>(reader.readCount(bucket_.size() - 1));
+            const int64_t tick = reader.readSigned();
+            ticks_[handle] = tick;
+            handles.push_back(handle);
+        }
+        // link插入链表头，逆序插入以保持原来的链表顺序；同一个session出现两次视为数据不合法
+        for (auto it = handles.rbegin(); it != handles.rend() && reader.ok(); ++it) {
+            if (bucket_[*it] != kNoBucket) {
+                reader.fail();
+            } else if (isLive(*it)) {
+                link(*it, bucket);
+            }
+        }
+    }
+    if (!reader.ok()) {
+        clear();
+    }
+}
+
+} // namespace afp
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <vector>
+#include "signature/session_table.h"
+
+namespace afp {
+
+// 按过期时间组织session的分层时间轮，用于找出本次调用中可能过期的session
+// 时间按tickSeconds量化为tick，共kLevels层、每层kSlots个槽，第l层一个槽覆盖kSlots^l个tick；
+// 时间前进时高层槽中的session逐层下放，只有到达第0层当前槽的session才会被取出，不需要遍历全部session。
+// 每个session在轮中至多一个条目，用按记录池下标的侵入式双向链表保存，插入、移动、删除都是O(1)。
+// 轮中记录的是调度时的过期时间，session之后继续命中时不必更新；取出后由调用方按实际过期时间判断，
+// 未过期的重新调度即可。过期时间所在tick已到达的session放在单独的当前槽中，每次取出时都会被取出。
+class SessionExpiryWheel {
+public:
+    static constexpr int kLevelBits = 6;
+    static constexpr size_t kSlots = size_t(1) << kLevelBits;
+    static constexpr size_t kLevels = 4;
+
+    // capacity为session记录池容量，tickSeconds为时间量化精度（秒）
+    SessionExpiryWheel(size_t capacity, double tickSeconds);
+
+    // 按过期时间deadline（秒）调度session，已在轮中时移动到新位置
+    void schedule(SessionTable::Handle handle, double deadline);
+
+    // 把session移出时间轮，不在轮中时忽略
+    void cancel(SessionTable::Handle handle);
+
+    // 清空时间轮
+    void clear();
+
+    // 推进到时间now，把调度的过期时间所在tick不晚于now所在tick的session移出时间轮并追加到due
+    // 取出的session不一定都已过期，由调用方按实际过期时间判断
+    void collectDue(double now, std::vector<SessionTable::Handle>& due);
+
+    // 轮中的session数量
+    size_t size() const { return size_; }
+
+    // 保存/恢复当前tick以及每个槽中的session（按链表顺序）和调度的过期tick，恢复后取出的顺序与保存前一致
+    // 恢复时跳过isLive(handle)为false的session；数据不合法时reader进入失败状态
+    void saveState(StateWriter& writer) const;
+    void restoreState(StateReader& reader, const std::function<bool(SessionTable::Handle)>& isLive);
+
+    // 槽和按记录池下标的链表占用的内存（字节）
+    size_t memoryUsage() const {
+        return (heads_.capacity() + next_.capacity() + prev_.capacity()) * sizeof(SessionTable::Handle) +
+               bucket_.capacity() * sizeof(uint32_t) + ticks_.capacity() * sizeof(int64_t);
+    }
+
+private:
+    static constexpr uint32_t kNoBucket = UINT32_MAX;
+    static constexpr uint32_t kCurrentBucket = static_cast<uint32_t>(kLevels * kSlots);
+
+    int64_t tickOf(double time) const;
+
+    // 按当前tick计算tick所在的槽，不晚于当前tick时为kCurrentBucket
+    uint32_t bucketOf(int64_t tick) const;
+
+    void link(SessionTable::Handle handle, uint32_t bucket);
+    void unlink(SessionTable::Handle handle);
+
+    // 把槽中的session按当前tick重新放置
+    void cascade(uint32_t bucket);
+
+    // 把槽中的session全部移出并追加到due
+    void drain(uint32_t bucket, std::vector<SessionTable::Handle>& due);
+
+    double tickSeconds_;
+    int64_t currentTick_ = 0;           // 已处理到的tick，不晚于它的槽都已取出
+    size_t size_ = 0;                   // 轮中的session数量（含当前槽）
+    size_t currentSize_ = 0;            // 当前槽中的session数量
+
+    std::vector<SessionTable::Handle> heads_;   // 每个槽的链表头，最后一个为当前槽
+    std::vector<SessionTable::Handle> next_;    // 以下按记录池下标存放
+    std::vector<SessionTable::Handle> prev_;
+    std::vector<uint32_t> bucket_;              // session所在的槽，不在轮中时为kNoBucket
+    std::vector<int64_t> ticks_;                // session调度的过期tick
+};
+
+} // namespace afp
@@ -0,0 +1,68 @@
+#include "signature/session_score_heap.h"
+#include <algorithm>
+#include <cmath>
+
+namespace afp {
+
+size_t SessionScoreHeap::memoryUsage() const {
+    size_t bytes = frontier_.capacity() * sizeof(size_t);
+    for (const auto& entry : buckets_) {
+        // map节点本身按键值和桶对象估算，不含分配器的额外开销
+        bytes += sizeof(entry) + entry.second.entries.capacity() * sizeof(Entry);
+    }
+    return bytes;
+}
+
+int64_t SessionScoreHeap::bucketOf(double baseScore) {
+    return static_cast<int64_t>(std::floor(baseScore / kBaseBucketWidth));
+}
+
+SessionScoreHeap::Bucket& SessionScoreHeap::bucketFor(double baseScore, double lastMatchTime) {
+    auto& bucket = buckets_[bucketOf(baseScore)];
+    if (bucket.entries.empty() || lastMatchTime > bucket.latestMatchTime) {
+        bucket.latestMatchTime = lastMatchTime;
+    }
+    return bucket;
+}
+
+void SessionScoreHeap::append(double baseScore, double lastMatchTime, SessionTable::Handle handle, uint32_t version) {
+    bucketFor(baseScore, lastMatchTime).entries.push_back(Entry{lastMatchTime, handle, version});
+    ++size_;
+}
+
+void SessionScoreHeap::build() {
+    for (auto& entry : buckets_) {
+        std::make_heap(entry.second.entries.begin(), entry.second.entries.end(), heapLess);
+    }
+}
+
+void SessionScoreHeap::push(double baseScore, double lastMatchTime, SessionTable::Handle handle, uint32_t version) {
+    auto& entries = bucketFor(baseScore, lastMatchTime).entries;
+    entries.push_back(Entry{lastMatchTime, handle, version});
+    std::push_heap(entries.begin(), entries.end(), heapLess);
+    ++size_;
+}
+
+void SessionScoreHeap::pop(Bucket& bucket) {
+    std::pop_heap(bucket.entries.begin(), bucket.entries.end(), heapLess);
+    bucket.entries.pop_back();
+    --size_;
+}
+
+void SessionScoreHeap::pushFrontier(const Bucket& bucket, size_t index) {
+    frontier_.push_back(index);
+    std::push_heap(frontier_.begin(), frontier_.end(), [&bucket](size_t a, size_t b) {
+        return heapLess(bucket.entries[a], bucket.entries[b]);
+    });
+}
+
+size_t SessionScoreHeap::popFrontier(const Bucket& bucket) {
+    std::pop_heap(frontier_.begin(), frontier_.end(), [&bucket](size_t a, size_t b) {
+        return heapLess(bucket.entries[a], bucket.entries[b]);
+    });
+    const size_t index = frontier_.back();
+    frontier_.pop_back();
+    return index;
+}
+
+} // namespace afp
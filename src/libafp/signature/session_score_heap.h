@@ -0,0 +1,146 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <map>
+#include <vector>
+#include "signature/session_table.h"
+
+namespace afp {
+
+// 用于找出当前分数最低的session的索引
+// session分数 = 不含活跃度的基础分 + 活跃度项，基础分只在session变化时改变，活跃度项随最后匹配时间到当前时间的间隔衰减。
+// 条目按基础分分桶（桶宽kBaseBucketWidth，桶的下沿是桶内基础分的下界），桶内是按最后匹配时间排序的小顶堆：
+// 最后匹配时间越早活跃度项越小，所以堆中每个节点的活跃度下界也是其子树的下界。
+// 查询时按基础分从小到大访问各桶、在桶内按最后匹配时间从早到晚访问节点，下界超过已找到的最低分时剪枝，结果与全量扫描一致；
+// 两项下界都与真实分数相差很小，只需重新计算最低分附近少量session的分数，与session总数基本无关。
+// 采用惰性删除：session变化或被移除时不在堆中查找旧条目，而是递增其版本号，旧条目在访问时按版本号识别并跳过。
+class SessionScoreHeap {
+public:
+    // 基础分桶宽，取2的负整数次幂使桶的下沿可精确表示
+    static constexpr double kBaseBucketWidth = 1.0 / 4096;
+
+    struct Entry {
+        double lastMatchTime;
+        SessionTable::Handle handle;
+        uint32_t version;
+    };
+
+    // 清空所有条目
+    void clear() {
+        buckets_.clear();
+        size_ = 0;
+    }
+
+    size_t size() const { return size_; }
+
+    // 各桶和查询缓冲占用的内存（字节）
+    size_t memoryUsage() const;
+    bool empty() const { return size_ == 0; }
+
+    // 追加条目但不调整堆，全部追加完之后调用build()，用于批量重建
+    void append(double baseScore, double lastMatchTime, SessionTable::Handle handle, uint32_t version);
+
+    // 把append()追加的条目整理成堆，O(n)
+    void build();
+
+    // 插入条目，O(log n)
+    void push(double baseScore, double lastMatchTime, SessionTable::Handle handle, uint32_t version);
+
+    // 返回当前分数最低的有效session（分数相同时取记录池下标最小的），没有有效session时返回SessionTable::kInvalidHandle
+    // isCurrent(handle, version)判断条目是否仍对应session的当前状态，score(handle)计算session的当前分数，
+    // activityFloor(lastMatchTime)是最后匹配时间为lastMatchTime的session当前的活跃度项，
+    // 不晚于当前时间时随lastMatchTime单调不减，晚于当前时间时为0
+    template <typename IsCurrent, typename Score, typename ActivityFloor>
+    SessionTable::Handle findLowest(IsCurrent&& isCurrent, Score&& score, ActivityFloor&& activityFloor);
+
+private:
+    struct Bucket {
+        std::vector<Entry> entries;     // 按最后匹配时间的小顶堆
+        double latestMatchTime = 0.0;   // 桶内追加过的条目中最晚的最后匹配时间（含已过期条目）
+    };
+
+    // 分数比较时的容差：下界与分数的求和顺序不同，舍入误差不应导致剪掉分数相同的session
+    static constexpr double kScoreTolerance = 1e-12;
+
+    static int64_t bucketOf(double baseScore);
+
+    static bool earlier(const Entry& a, const Entry& b) {
+        if (a.lastMatchTime != b.lastMatchTime) {
+            return a.lastMatchTime < b.lastMatchTime;
+        }
+        return a.handle < b.handle;
+    }
+
+    // 堆的比较函数，std::*_heap是大顶堆，取反得到小顶堆
+    static bool heapLess(const Entry& a, const Entry& b) {
+        return earlier(b, a);
+    }
+
+    Bucket& bucketFor(double baseScore, double lastMatchTime);
+    void pop(Bucket& bucket);
+    void pushFrontier(const Bucket& bucket, size_t index);
+    size_t popFrontier(const Bucket& bucket);
+
+    std::map<int64_t, Bucket> buckets_;     // 按基础分从小到大
+    size_t size_ = 0;
+    std::vector<size_t> frontier_;          // 查询时在桶内按最后匹配时间顺序访问堆节点用的候选节点下标（小顶堆）
+};
+
+template <typename IsCurrent, typename Score, typename ActivityFloor>
+SessionTable::Handle SessionScoreHeap::findLowest(IsCurrent&& isCurrent, Score&& score, ActivityFloor&& activityFloor) {
+    auto lowestHandle = SessionTable::kInvalidHandle;
+    double lowestScore = 0.0;
+    auto pruned = [&](double lowerBound) {
+        return lowestHandle != SessionTable::kInvalidHandle && lowerBound > lowestScore + kScoreTolerance;
+    };
+
+    for (auto it = buckets_.begin(); it != buckets_.end();) {
+        auto& bucket = it->second;
+        // 先丢弃堆顶的过期条目
+        while (!bucket.entries.empty() && !isCurrent(bucket.entries.front().handle, bucket.entries.front().version)) {
+            pop(bucket);
+        }
+        if (bucket.entries.empty()) {
+            it = buckets_.erase(it);
+            continue;
+        }
+
+        // 之后各桶的基础分下界都不小于本桶，活跃度项不小于0
+        const double baseBound = it->first * kBaseBucketWidth;
+        if (pruned(baseBound)) {
+            break;
+        }
+        // 桶内有条目晚于当前时间时其活跃度项为0，此时latestFloor为0，整个桶只用基础分下界
+        const double latestFloor = activityFloor(bucket.latestMatchTime);
+
+        frontier_.clear();
+        pushFrontier(bucket, 0);
+        while (!frontier_.empty()) {
+            const size_t index = popFrontier(bucket);
+            const auto& entry = bucket.entries[index];
+            // 之后访问的条目最后匹配时间都不早于当前条目，活跃度项不可能更低
+            if (pruned(baseBound + std::min(activityFloor(entry.lastMatchTime), latestFloor))) {
+                break;
+            }
+            if (isCurrent(entry.handle, entry.version)) {
+                const double current = score(entry.handle);
+                if (lowestHandle == SessionTable::kInvalidHandle || current < lowestScore ||
+                    (current == lowestScore && entry.handle < lowestHandle)) {
+                    lowestScore = current;
+                    lowestHandle = entry.handle;
+                }
+            }
+            if (2 * index + 1 < bucket.entries.size()) {
+                pushFrontier(bucket, 2 * index + 1);
+            }
+            if (2 * index + 2 < bucket.entries.size()) {
+                pushFrontier(bucket, 2 * index + 2);
+            }
+        }
+        ++it;
+    }
+    return lowestHandle;
+}
+
+} // namespace afp
@@ -0,0 +1,233 @@
+#include "signature/session_table.h"
+#include <algorithm>
+#include "base/state_stream.h"
+
+namespace afp {
+
+void TimestampWindow::reset(int64_t timestamp) {
+    std::fill(std::begin(bits_), std::end(bits_), 0);
+    newest_ = timestamp;
+    const size_t slot = static_cast<size_t>(timestamp & (kSlots - 1));
+    bits_[slot / 64] |= uint64_t(1) << (slot % 64);
+}
+
+void TimestampWindow::advanceTo(int64_t timestamp) {
+    if (timestamp <= newest_) {
+        return;
+    }
+    if (timestamp - newest_ >= kSlots) {
+        std::fill(std::begin(bits_), std::end(bits_), 0);
+    } else {
+        // 清除移出窗口的时间点所占的槽位（即新进入窗口的时间点复用的槽位）
+        for (int64_t t = newest_ + 1; t <= timestamp; ++t) {
+            const size_t slot = static_cast<size_t>(t & (kSlots - 1));
+            bits_[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+        }
+    }
+    newest_ = timestamp;
+}
+
+bool TimestampWindow::insert(int64_t timestamp) {
+    if (timestamp <= newest_ - kSlots) {
+        return false;  // 早于窗口，视为已出现过
+    }
+    advanceTo(timestamp);
+
+    const size_t slot = static_cast<size_t>(timestamp & (kSlots - 1));
+    const uint64_t mask = uint64_t(1) << (slot % 64);
+    if (bits_[slot / 64] & mask) {
+        return false;
+    }
+    bits_[slot / 64] |= mask;
+    return true;
+}
+
+size_t TimestampWindow::mergeFrom(const TimestampWindow& other) {
+    // 两个窗口对齐到共同的最新时间点后，槽位一一对应，可以按字合并
+    TimestampWindow aligned = other;
+    const int64_t newest = std::max(newest_, other.newest_);
+    advanceTo(newest);
+    aligned.advanceTo(newest);
+
+    size_t added = 0;
+    for (size_t i = 0; i < kWords; ++i) {
+        const uint64_t fresh = aligned.bits_[i] & ~bits_[i];
+        for (uint64_t bits = fresh; bits != 0; bits &= bits - 1) {
+            ++added;
+        }
+        bits_[i] |= fresh;
+    }
+    return added;
+}
+
+void TimestampWindow::saveState(StateWriter& writer) const {
+    writer.writeSigned(newest_);
+    for (const uint64_t word : bits_) {
+        writer.writeVarint(word);
+    }
+}
+
+void TimestampWindow::restoreState(StateReader& reader) {
+    newest_ = reader.readSigned();
+    for (auto& word : bits_) {
+        word = reader.readVarint();
+    }
+}
+
+SessionTable::SessionTable(size_t capacity)
+    : records_(std::max<size_t>(1, capacity))
+    , live_(records_.size(), 0)
+    , size_(0) {
+    size_t slotCount = 1;
+    while (slotCount < 2 * records_.size()) {
+        slotCount <<= 1;
+    }
+    slots_.assign(slotCount, kInvalidHandle);
+    slotMask_ = slotCount - 1;
+
+    freeHandles_.reserve(records_.size());
+    for (size_t handle = records_.size(); handle > 0; --handle) {
+        freeHandles_.push_back(static_cast<Handle>(handle - 1));
+    }
+}
+
+size_t SessionTable::slotOf(const CandidateSessionKey& key) const {
+    uint64_t h = static_cast<uint64_t>(std::hash<CandidateSessionKey>{}(key));
+    h ^= h >> 29;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 32;
+    return static_cast<size_t>(h) & slotMask_;
+}
+
+SessionTable::Handle SessionTable::find(const CandidateSessionKey& key) const {
+    for (size_t slot = slotOf(key); ; slot = (slot + 1) & slotMask_) {
+        const Handle handle = slots_[slot];
+        if (handle == kInvalidHandle) {
+            return kInvalidHandle;
+        }
+        if (records_[handle].key == key) {
+            return handle;
+        }
+    }
+}
+
+void SessionTable::insertSlot(Handle handle) {
+    size_t slot = slotOf(records_[handle].key);
+    while (slots_[slot] != kInvalidHandle) {
+        slot = (slot + 1) & slotMask_;
+    }
+    slots_[slot] = handle;
+}
+
+SessionTable::Handle SessionTable::insert(const SessionRecord& record) {
+    syncFreeHandles();
+    if (freeHandles_.empty()) {
+        return kInvalidHandle;
+    }
+
+    const Handle handle = freeHandles_.back();
+    freeHandles_.pop_back();
+    records_[handle] = record;
+    live_[handle] = 1;
+    ++size_;
+    insertSlot(handle);
+    return handle;
+}
+
+void SessionTable::erase(Handle handle) {
+    if (handle >= records_.size() || !live_[handle]) {
+        return;
+    }
+
+    size_t hole = slotOf(records_[handle].key);
+    while (slots_[hole] != handle) {
+        hole = (hole + 1) & slotMask_;
+    }
+    slots_[hole] = kInvalidHandle;
+
+    // 后移删除：把探测链上后面的元素前移填补空位，保证查找不会提前遇到空槽
+    for (size_t slot = (hole + 1) & slotMask_; slots_[slot] != kInvalidHandle; slot = (slot + 1) & slotMask_) {
+        const size_t home = slotOf(records_[slots_[slot]].key);
+        // home位于(hole, slot]之间时元素仍可从home探测到，无需移动
+        const bool reachable = hole < slot ? (home > hole && home <= slot)
+                                           : (home > hole || home <= slot);
+        if (!reachable) {
+            slots_[hole] = slots_[slot];
+            slots_[slot] = kInvalidHandle;
+            hole = slot;
+        }
+    }
+
+    syncFreeHandles();
+    live_[handle] = 0;
+    --size_;
+    freeHandles_.push_back(handle);
+}
+
+void SessionTable::clear() {
+    std::fill(slots_.begin(), slots_.end(), kInvalidHandle);
+    std::fill(live_.begin(), live_.end(), 0);
+    freeHandles_.clear();
+    for (size_t handle = records_.size(); handle > 0; --handle) {
+        freeHandles_.push_back(static_cast<Handle>(handle - 1));
+    }
+    freeHandlesStale_ = false;
+    size_ = 0;
+}
+
+bool SessionTable::insertAt(Handle handle, const SessionRecord& record) {
+    if (handle >= records_.size() || live_[handle] || find(record.key) != kInvalidHandle) {
+        return false;
+    }
+    records_[handle] = record;
+    live_[handle] = 1;
+    ++size_;
+    insertSlot(handle);
+    freeHandlesStale_ = true;
+    return true;
+}
+
+void SessionTable::syncFreeHandles() const {
+    if (!freeHandlesStale_) {
+        return;
+    }
+    freeHandles_.erase(std::remove_if(freeHandles_.begin(), freeHandles_.end(),
+                                      [this](Handle handle) { return live_[handle] != 0; }),
+                       freeHandles_.end());
+    freeHandlesStale_ = false;
+}
+
+void SessionTable::restoreFreeOrder(const std::vector<Handle>& order) {
+    syncFreeHandles();
+    std::vector<uint8_t> listed(records_.size(), 0);
+    for (const auto handle : order) {
+        if (handle < records_.size() && !live_[handle]) {
+            listed[handle] = 1;
+        }
+    }
+    std::vector<Handle> freeHandles;
+    freeHandles.reserve(records_.size());
+    for (const auto handle : freeHandles_) {
+        if (!listed[handle]) {
+            freeHandles.push_back(handle);
+        }
+    }
+    for (const auto handle : order) {
+        if (handle < records_.size() && listed[handle]) {
+            freeHandles.push_back(handle);
+            listed[handle] = 0;  // 重复的位置只放一次
+        }
+    }
+    freeHandles_.swap(freeHandles);
+}
+
+void SessionTable::rehash() {
+    std::fill(slots_.begin(), slots_.end(), kInvalidHandle);
+    for (Handle handle = 0; handle < records_.size(); ++handle) {
+        if (live_[handle]) {
+            insertSlot(handle);
+        }
+    }
+}
+
+} // namespace afp
@@ -0,0 +1,194 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <functional>
+#include <vector>
+#include "afp/isignature_generator.h"
+#include "afp/media_item.h"
+
+namespace afp {
+
+class StateWriter;
+class StateReader;
+
+// 目标指纹在匹配器内的id：当前catalog中下标为i的指纹的id为该catalog的id起点加i，
+// 切换目录后保留在旧目录快照上的session沿用旧快照的id区间，与新catalog的区间不重叠；
+// session的键、哈希和排序只依赖id，与catalog的内存地址无关
+using SignatureId = uint32_t;
+
+struct CandidateSessionKey {
+    int32_t offset; // ms
+    SignatureId signatureId;
+
+    bool operator==(const CandidateSessionKey& other) const {
+        return offset == other.offset && signatureId == other.signatureId;
+    }
+};
+
+} // namespace afp
+
+
+namespace std {
+    template <>
+    struct hash<afp::CandidateSessionKey> {
+        size_t operator()(const afp::CandidateSessionKey& k) const {
+#if INTPTR_MAX == INT32_MAX  // 32-bit platform
+            uint32_t id_low16 = static_cast<uint32_t>(k.signatureId & 0xFFFF);
+            uint32_t offset_low16 = static_cast<uint32_t>(k.offset & 0xFFFF);
+            return static_cast<size_t>((id_low16 << 16) | offset_low16);
+#else  // 64-bit platform
+            uint64_t offset_low32 = static_cast<uint64_t>(k.offset & 0xFFFFFFFF);
+            return static_cast<size_t>((static_cast<uint64_t>(k.signatureId) << 32) | offset_low32);
+#endif
+        }
+    };
+}
+
+namespace afp {
+
+// 量化时间戳（10ms精度，与原先保留2位小数的集合一致）的滑动位图，用于统计session的unique时间戳数量
+// 只保留最近kSlots个量化时间点，早于窗口的时间戳视为已出现过；
+// 窗口长度(20.48秒)大于各档配置中最长的匹配过期时间(12秒)，流式输入下时间戳基本递增，计数与完整集合一致
+class TimestampWindow {
+public:
+    static constexpr int64_t kSlots = 2048;
+
+    static int64_t quantize(double timestamp) {
+        return std::llround(timestamp * 100.0);
+    }
+
+    // 清空窗口并放入第一个时间戳
+    void reset(int64_t timestamp);
+
+    // 放入一个量化时间戳，之前未出现过时返回true
+    bool insert(int64_t timestamp);
+
+    // 合并另一个窗口中的时间戳，返回新增的时间戳数量
+    size_t mergeFrom(const TimestampWindow& other);
+
+    // 保存/恢复窗口的最新时间点和位图
+    void saveState(StateWriter& writer) const;
+    void restoreState(StateReader& reader);
+
+private:
+    static constexpr size_t kWords = static_cast<size_t>(kSlots / 64);
+
+    // 把窗口前移到以timestamp为最新时间点，清除移出窗口的槽位
+    void advanceTo(int64_t timestamp);
+
+    int64_t newest_ = 0;        // 窗口内最新的量化时间戳，窗口范围为(newest_ - kSlots, newest_]
+    uint64_t bits_[kWords] = {}; // 槽位按量化时间戳对kSlots取模循环使用
+};
+
+// 候选session的紧凑记录，不含任何堆内存，调试用的匹配明细由SignatureMatcher另行保存
+struct SessionRecord {
+    CandidateSessionKey key;            // 时间偏移（毫秒）+ 目标指纹id
+    const MediaItem* mediaItem;         // 目标媒体项
+    uint32_t maxPossibleMatches;        // 最大可能匹配点数
+    uint32_t matchCount;                // 匹配点数量
+    uint32_t uniqueTimestampCount;      // unique时间戳数量
+    uint32_t offsetCount;               // 偏移计数，用于计算平均值
+    int64_t actualOffsetSum;            // 累积的实际时间偏移（毫秒），使用int64_t防止溢出
+    double offsetSquareSum;             // 实际时间偏移的平方和，用于计算偏移一致性
+    double lastMatchTime;               // 最后一次匹配的时间戳
+    double firstMatchTime;              // 最早命中的查询时间戳，用于统计检测延迟
+    uint64_t firstHitNanos;             // 第一次被命中的那次匹配调用的开始时刻（steady clock纳秒）
+    TimestampWindow timestamps;         // unique时间戳位图
+    bool isMatchCountChanged;           // 是否匹配点数量发生变化
+    bool isNotified;                    // 是否已通知
+};
+
+// 固定容量的session表
+// 记录存放在构造时一次分配的记录池中，通过空闲链表复用；键到记录的映射使用线性探测的开放寻址表，
+// 槽位数为容量的2倍以上（2的幂），删除时后移填补空位，不使用墓碑。
+// 遍历按记录池下标顺序进行，与哈希槽布局（指针地址）无关，结果可复现。
+class SessionTable {
+public:
+    using Handle = uint32_t;
+    static constexpr Handle kInvalidHandle = UINT32_MAX;
+
+    explicit SessionTable(size_t capacity);
+
+    size_t size() const { return size_; }
+    size_t capacity() const { return records_.size(); }
+
+    // 记录池和槽位占用的内存（字节）
+    size_t memoryUsage() const {
+        return records_.capacity() * sizeof(SessionRecord) + live_.capacity() +
+               (freeHandles_.capacity() + slots_.capacity()) * sizeof(Handle);
+    }
+    bool empty() const { return size_ == 0; }
+    bool full() const { return size_ >= records_.size(); }
+
+    // 查找键对应的记录，不存在时返回kInvalidHandle
+    Handle find(const CandidateSessionKey& key) const;
+
+    // 插入记录（键必须不存在），表已满时返回kInvalidHandle
+    Handle insert(const SessionRecord& record);
+
+    // 删除记录，记录所占的池位置可被之后的插入复用
+    void erase(Handle handle);
+
+    // 清空所有记录
+    void clear();
+
+    // 外部直接修改了记录的键之后重建哈希槽
+    void rehash();
+
+    // 把记录放到指定的空闲记录池位置（键必须不存在），用于恢复检查点时保持原来的handle；位置无效或已被占用时返回false
+    // O(1)：占用的位置只在live_中标记，空闲栈在下一次用到时统一剔除已占用的位置，连续恢复n个session为O(n)
+    bool insertAt(Handle handle, const SessionRecord& record);
+
+    // 空闲的记录池位置，栈顶（最后一个）最先被插入使用
+    const std::vector<Handle>& freeHandles() const {
+        syncFreeHandles();
+        return freeHandles_;
+    }
+
+    // 按保存时的空闲栈顺序重排空闲位置，order中未空闲的位置忽略，不在order中的空闲位置放在栈底
+    void restoreFreeOrder(const std::vector<Handle>& order);
+
+    // 记录池位置handle上是否有有效记录
+    bool contains(Handle handle) const { return handle < records_.size() && live_[handle]; }
+
+    SessionRecord& at(Handle handle) { return records_[handle]; }
+    const SessionRecord& at(Handle handle) const { return records_[handle]; }
+
+    // 按记录池下标顺序遍历所有有效记录，回调参数为(handle, record)
+    template <typename Func>
+    void forEach(Func&& func) {
+        for (Handle handle = 0; handle < records_.size(); ++handle) {
+            if (live_[handle]) {
+                func(handle, records_[handle]);
+            }
+        }
+    }
+
+    template <typename Func>
+    void forEach(Func&& func) const {
+        for (Handle handle = 0; handle < records_.size(); ++handle) {
+            if (live_[handle]) {
+                func(handle, records_[handle]);
+            }
+        }
+    }
+
+private:
+    size_t slotOf(const CandidateSessionKey& key) const;
+    void insertSlot(Handle handle);
+
+    // 从空闲栈中剔除insertAt占用的位置，其余位置的顺序不变
+    void syncFreeHandles() const;
+
+    std::vector<SessionRecord> records_;   // 记录池
+    std::vector<uint8_t> live_;            // 记录池位置是否有效
+    // 空闲的记录池位置（栈），初始时栈顶为下标0；freeHandlesStale_时可能含有insertAt占用的位置，由syncFreeHandles剔除
+    mutable std::vector<Handle> freeHandles_;
+    mutable bool freeHandlesStale_ = false;
+    std::vector<Handle> slots_;            // 开放寻址槽位，存放记录池下标
+    size_t slotMask_;
+    size_t size_;
+};
+
+} // namespace afp
@@ -0,0 +1,178 @@
+#include "afp/signature_batch.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace afp {
+
+namespace {
+
+constexpr uint8_t kBatchVersion = 1;
+
+// 版本 + 点数 + 基准时间戳 + 量化步长的最小字节数
+constexpr size_t kMinHeaderBytes = 1 + 1 + 2 * sizeof(double);
+
+void writeVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+bool readVarint(const uint8_t*& cursor, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (cursor >= end) {
+            return false;
+        }
+        const uint8_t byte = *cursor++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// double按小端序的IEEE 754位存储，与主机字节序无关
+void writeDouble(std::vector<uint8_t>& out, double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    for (size_t i = 0; i < sizeof(bits); ++i) {
+        out.push_back(static_cast<uint8_t>(bits >> (8 * i)));
+    }
+}
+
+bool readDouble(const uint8_t*& cursor, const uint8_t* end, double& value) {
+    if (end - cursor < static_cast<ptrdiff_t>(sizeof(uint64_t))) {
+        return false;
+    }
+    uint64_t bits = 0;
+    for (size_t i = 0; i < sizeof(bits); ++i) {
+        bits |= static_cast<uint64_t>(cursor[i]) << (8 * i);
+    }
+    cursor += sizeof(bits);
+    std::memcpy(&value, &bits, sizeof(value));
+    return true;
+}
+
+struct QuantizedPoint {
+    uint64_t tick;
+    uint32_t hash;
+};
+
+} // namespace
+
+void SignatureBatchCodec::encode(const SignaturePoint* points, size_t count, double timeStep, std::vector<uint8_t>& out) {
+    out.clear();
+
+    // 基准取最早的时间戳，刻度都为非负
+    double baseTimestamp = 0.0;
+    if (count > 0) {
+        baseTimestamp = points[0].timestamp;
+        for (size_t i = 1; i < count; ++i) {
+            baseTimestamp = std::min(baseTimestamp, points[i].timestamp);
+        }
+    }
+
+    std::vector<QuantizedPoint> quantized(count);
+    for (size_t i = 0; i < count; ++i) {
+        quantized[i].tick = static_cast<uint64_t>(std::llround((points[i].timestamp - baseTimestamp) / timeStep));
+        quantized[i].hash = points[i].hash;
+    }
+    std::sort(quantized.begin(), quantized.end(), [](const QuantizedPoint& a, const QuantizedPoint& b) {
+        return a.tick != b.tick ? a.tick < b.tick : a.hash < b.hash;
+    });
+
+    out.reserve(kMinHeaderBytes + count * 5);
+    out.push_back(kBatchVersion);
+    writeVarint(out, count);
+    writeDouble(out, baseTimestamp);
+    writeDouble(out, timeStep);
+
+    uint64_t prevTick = 0;
+    for (size_t groupStart = 0; groupStart < count; ) {
+        const uint64_t tick = quantized[groupStart].tick;
+        size_t groupEnd = groupStart + 1;
+        while (groupEnd < count && quantized[groupEnd].tick == tick) {
+            ++groupEnd;
+        }
+
+        writeVarint(out, tick - prevTick);
+        writeVarint(out, groupEnd - groupStart);
+        // 组内哈希已升序，第一个哈希相对0差分
+        uint32_t prevHash = 0;
+        for (size_t i = groupStart; i < groupEnd; ++i) {
+            writeVarint(out, quantized[i].hash - prevHash);
+            prevHash = quantized[i].hash;
+        }
+
+        prevTick = tick;
+        groupStart = groupEnd;
+    }
+}
+
+bool SignatureBatchCodec::decode(const uint8_t* data, size_t size, std::vector<SignaturePoint>& points) {
+    const uint8_t* cursor = data;
+    const uint8_t* end = data + size;
+    points.clear();
+
+    if (size < kMinHeaderBytes || *cursor++ != kBatchVersion) {
+        return false;
+    }
+    uint64_t pointCount = 0;
+    double baseTimestamp = 0.0;
+    double timeStep = 0.0;
+    if (!readVarint(cursor, end, pointCount) || !readDouble(cursor, end, baseTimestamp) ||
+        !readDouble(cursor, end, timeStep)) {
+        return false;
+    }
+    // 每个点至少占1字节，用于拒绝损坏的长度
+    if (pointCount > static_cast<uint64_t>(end - cursor) || !std::isfinite(baseTimestamp) ||
+        !std::isfinite(timeStep) || timeStep <= 0.0) {
+        return false;
+    }
+
+    points.reserve(pointCount);
+    uint64_t tick = 0;
+    while (points.size() < pointCount) {
+        uint64_t tickDelta = 0;
+        uint64_t groupSize = 0;
+        if (!readVarint(cursor, end, tickDelta) || !readVarint(cursor, end, groupSize) ||
+            groupSize == 0 || groupSize > pointCount - points.size()) {
+            points.clear();
+            return false;
+        }
+        tick += tickDelta;
+        const double timestamp = baseTimestamp + static_cast<double>(tick) * timeStep;
+
+        uint64_t hash = 0;
+        for (uint64_t i = 0; i < groupSize; ++i) {
+            uint64_t hashDelta = 0;
+            if (!readVarint(cursor, end, hashDelta)) {
+                points.clear();
+                return false;
+            }
+            hash += hashDelta;
+            if (hash > UINT32_MAX) {
+                points.clear();
+                return false;
+            }
+            SignaturePoint point;
+            point.hash = static_cast<uint32_t>(hash);
+            point.timestamp = timestamp;
+            point.frequency = 0;
+            point.amplitude = 0;
+            points.push_back(point);
+        }
+    }
+
+    if (cursor != end) {
+        points.clear();
+        return false;
+    }
+    return true;
+}
+
+} // namespace afp
@@ -12,6 +12,7 @@
 #include "hash_computer.h"
 
 #include "signature_generation_pipeline/signature_generation_pipeline.h"
+#include "base/memory_accounting.h"
 
 /**
  * 签名生成器实现
@@ -33,6 +34,10 @@
 
 namespace afp {
 
+namespace {
+// 生成状态的格式版本，格式变化时递增
+constexpr uint64_t kGeneratorStateVersion = 1;
+}
 
 SignatureGenerator::SignatureGenerator(std::shared_ptr<IPerformanceConfig> config)
     : config_(config)
@@ -43,16 +48,30 @@ SignatureGenerator::SignatureGenerator(std::shared_ptr<IPerformanceConfig> confi
 SignatureGenerator::~SignatureGenerator() = default;
 
 bool SignatureGenerator::init(const PCMFormat& format) {
-    signature_generation_pipeline_ = std::make_unique<SignatureGenerationPipeline>(
-        config_, 
-        std::make_shared<PCMFormat>(format),
-        std::bind(&SignatureGenerator::onSignaturePointsGenerated, this, std::placeholders::_1)
-    );
-    signature_generation_pipeline_->attachVisualizationConfig(&visualization_config_);
+    if (format.channels() == 0 || format.channels() > max_channel_count) {
+        return false;
+    }
+
+    format_ = format;
+    signature_generation_pipeline_ = createPipeline();
 
     return true;
 }
 
+std::unique_ptr<SignatureGenerationPipeline> SignatureGenerator::createPipeline() {
+    auto pipeline = std::make_unique<SignatureGenerationPipeline>(
+        config_, 
+        std::make_shared<PCMFormat>(format_),
+        std::bind(&SignatureGenerator::onSignaturePointsGenerated, this, std::placeholders::_1),
+        pipelineThreading_,
+        channelParallelism_
+    );
+    pipeline->attachVisualizationConfig(&visualization_config_);
+    pipeline->setDegradationCallback(degradationCallback_);
+    pipeline->enableTracing(traceCapacity_);
+    return pipeline;
+}
+
 bool SignatureGenerator::appendStreamBuffer(const void* buffer, size_t bufferSize, double startTimestamp) {
     return signature_generation_pipeline_->appendStreamBuffer(buffer, bufferSize, startTimestamp);
 }
@@ -62,6 +81,12 @@ void SignatureGenerator::flush() {
 }
 
 void SignatureGenerator::onSignaturePointsGenerated(const std::vector<SignaturePoint>& signature_points) {
+    // 设置了输出回调时直接交给消费者，不在内部累积
+    if (signatureSink_) {
+        signatureSink_(signature_points);
+        return;
+    }
+
     signatures_.reserve(signatures_.size() + signature_points.size());
     signatures_.insert(signatures_.end(), signature_points.begin(), signature_points.end());
 }
@@ -70,11 +95,94 @@ std::vector<SignaturePoint> SignatureGenerator::signature() const {
     return signatures_;
 }
 
+std::vector<SignaturePoint> SignatureGenerator::takeSignature() {
+    std::vector<SignaturePoint> signature = std::move(signatures_);
+    signatures_.clear();
+    return signature;
+}
+
+void SignatureGenerator::setSignatureSink(SignatureSink sink) {
+    signatureSink_ = std::move(sink);
+}
+
+void SignatureGenerator::setDegradationCallback(DegradationCallback callback) {
+    degradationCallback_ = std::move(callback);
+    if (signature_generation_pipeline_) {
+        signature_generation_pipeline_->setDegradationCallback(degradationCallback_);
+    }
+}
+
+GeneratorPerformanceStats SignatureGenerator::performanceStats() const {
+    if (!signature_generation_pipeline_) {
+        return GeneratorPerformanceStats{};
+    }
+    return signature_generation_pipeline_->performanceStats();
+}
+
+GeneratorMemoryUsage SignatureGenerator::memoryUsage() const {
+    GeneratorMemoryUsage usage;
+    if (signature_generation_pipeline_) {
+        usage = signature_generation_pipeline_->memoryUsage();
+    }
+    usage.signatureBytes = heapBytes(signatures_);
+    return usage;
+}
+
+void SignatureGenerator::enableTracing(size_t capacity) {
+    traceCapacity_ = capacity;
+    if (signature_generation_pipeline_) {
+        signature_generation_pipeline_->enableTracing(capacity);
+    }
+}
+
+bool SignatureGenerator::dumpTrace(const std::string& filename) const {
+    if (!signature_generation_pipeline_) {
+        return false;
+    }
+    return TraceRing::writeChromeTrace(filename, {{traceRing(), "signature generation"}});
+}
+
+const TraceRing* SignatureGenerator::traceRing() const {
+    return signature_generation_pipeline_ ? &signature_generation_pipeline_->traceRing() : nullptr;
+}
+
 void SignatureGenerator::resetSignatures() {
     signatures_.clear();
 }
 
+void SignatureGenerator::enablePipelineThreading(bool enable) {
+    pipelineThreading_ = enable;
+}
+
+void SignatureGenerator::enableChannelParallelism(bool enable) {
+    channelParallelism_ = enable;
+}
+
 // Save visualization data to file
+bool SignatureGenerator::saveState(std::vector<uint8_t>& out) {
+    if (!signature_generation_pipeline_) {
+        return false;
+    }
+    StateWriter writer(out);
+    writer.writeVarint(kGeneratorStateVersion);
+    signature_generation_pipeline_->saveState(writer);
+    return true;
+}
+
+bool SignatureGenerator::restoreState(const uint8_t* data, size_t size) {
+    if (!signature_generation_pipeline_) {
+        return false;
+    }
+    // 恢复到新建的流水线，全部成功后才替换，失败时原流水线不受影响
+    auto pipeline = createPipeline();
+    StateReader reader(data, size);
+    if (reader.readVarint() != kGeneratorStateVersion || !pipeline->restoreState(reader) || !reader.atEnd()) {
+        return false;
+    }
+    signature_generation_pipeline_ = std::move(pipeline);
+    return true;
+}
+
 bool SignatureGenerator::saveVisualization(const std::string& filename) const {
     if (!visualization_config_.collectVisualizationData_) {
         std::cerr << "Visualization data collection is not enabled" << std::endl;
@@ -81,8 +81,33 @@ public:
 
     std::vector<SignaturePoint> signature() const override;
 
+    std::vector<SignaturePoint> takeSignature() override;
+
+    void setSignatureSink(SignatureSink sink) override;
+
+    void setDegradationCallback(DegradationCallback callback) override;
+
+    GeneratorPerformanceStats performanceStats() const override;
+
+    GeneratorMemoryUsage memoryUsage() const override;
+
+    void enableTracing(size_t capacity) override;
+
+    bool dumpTrace(const std::string& filename) const override;
+
+    // 生成流水线的追踪缓冲，init之前为空
+    const TraceRing* traceRing() const;
+
     void resetSignatures() override;
 
+    void enablePipelineThreading(bool enable) override;
+
+    void enableChannelParallelism(bool enable) override;
+
+    bool saveState(std::vector<uint8_t>& out) override;
+
+    bool restoreState(const uint8_t* data, size_t size) override;
+
 public:
     // Visualization methods
     // Enable/disable visualization data collection
@@ -95,6 +120,11 @@ public:
         return visualization_config_.visualizationData_;
     }
     
+    // 设置可视化数据的采样和上限，见VisualizationLimits
+    void setVisualizationLimits(const VisualizationLimits& limits) {
+        visualization_config_.limits_ = limits;
+    }
+
     // Set title for visualization
     void setVisualizationTitle(const std::string& title) {
         visualization_config_.visualizationData_.title = title;
@@ -109,14 +139,22 @@ public:
     bool saveVisualization(const std::string& filename) const;
 
 private:
+    std::unique_ptr<SignatureGenerationPipeline> createPipeline();
+
     void onSignaturePointsGenerated(const std::vector<SignaturePoint>& signature_points);
 
 private:
     std::shared_ptr<IPerformanceConfig> config_;
 
     std::unique_ptr<SignatureGenerationPipeline> signature_generation_pipeline_;
+    PCMFormat format_;
+    bool pipelineThreading_ = false;
+    bool channelParallelism_ = false;
+    size_t traceCapacity_ = 0;           // init之前开启的追踪在init时生效
 
     std::vector<SignaturePoint> signatures_;
+    SignatureSink signatureSink_;
+    DegradationCallback degradationCallback_;
 private:
     // Visualization data
     VisualizationConfig visualization_config_;
@@ -1,34 +1,56 @@
 #include "signature/signature_matcher.h"
 #include "matcher/matcher.h"
 #include "debugger/audio_debugger.h"
+#include "base/state_stream.h"
 #include <algorithm>
 #include <iostream>
 #include <iomanip>
 #include <cmath>
+#include <limits>
+#include <stdexcept>
 #include <unordered_set>
 #include <sstream>
 
 
 namespace afp {
 
+namespace {
+
+// 计算实际时间偏移（不量化），返回实际时间差(毫秒)
+int32_t calculateActualOffset(double queryTime, double targetTime) {
+    return static_cast<int32_t>((queryTime - targetTime) * 1000);
+}
+
+// session事件，偏移单位为毫秒
+const TraceEventDesc kSessionCreateTraceEvent = {"SessionCreate", "matcher", nullptr, "offset_ms", "query_timestamp"};
+const TraceEventDesc kSessionEvictTraceEvent = {"SessionEvict", "matcher", "match_count", "offset_ms", "query_timestamp"};
+const TraceEventDesc kSessionMergeTraceEvent = {"SessionMerge", "matcher", "match_count", "offset_ms", "merged_offset_ms"};
+const TraceEventDesc kSessionNotifyTraceEvent = {"SessionNotify", "matcher", "match_count", "offset_ms", "confidence"};
+const TraceEventDesc kSessionExpireTraceEvent = {"SessionExpire", "matcher", "match_count", "offset_ms", "last_match_time"};
+
+// session综合分数中活跃度分数的权重，见combineSessionScore
+constexpr double kActivityWeight = 0.35;
+
+} // namespace
+
 
 std::unordered_map<size_t, std::vector<std::pair<size_t, SignatureMatcher::DebugMatchInfo>>> SignatureMatcher::findDuplicateHashes(
-    const std::vector<std::pair<CandidateSessionKey, MatchingCandidate>>& candidates) {
+    const std::vector<SessionTable::Handle>& sessions) {
     
     std::unordered_map<size_t, std::vector<std::pair<size_t, DebugMatchInfo>>> result;
     
     // 遍历所有候选项
-    for (size_t candidateIdx = 0; candidateIdx < candidates.size(); ++candidateIdx) {
-        const auto& candidate = candidates[candidateIdx].second;
+    for (size_t candidateIdx = 0; candidateIdx < sessions.size(); ++candidateIdx) {
+        const auto& matchInfos = sessionMatchInfos_[sessions[candidateIdx]];
         
-        // 用于检测重复的哈希+偏移量组合
-        std::unordered_map<std::string, std::vector<size_t>> hashOffsetPositions;
+        // 用于检测重复的哈希+偏移量组合，键为(哈希 << 32) | 偏移
+        std::unordered_map<uint64_t, std::vector<size_t>> hashOffsetPositions;
         
         // 首先记录每个哈希值和偏移量组合出现的位置
-        for (size_t infoIdx = 0; infoIdx < candidate.matchInfos.size(); ++infoIdx) {
-            const auto& matchInfo = candidate.matchInfos[infoIdx];
+        for (size_t infoIdx = 0; infoIdx < matchInfos.size(); ++infoIdx) {
+            const auto& matchInfo = matchInfos[infoIdx];
             // 创建哈希值和偏移量的组合键
-            std::string hashOffsetKey = matchInfo.hash + "_" + std::to_string(matchInfo.offset);
+            uint64_t hashOffsetKey = (static_cast<uint64_t>(matchInfo.hash) << 32) | static_cast<uint32_t>(matchInfo.offset);
             hashOffsetPositions[hashOffsetKey].push_back(infoIdx);
         }
         
@@ -42,7 +64,7 @@ std::unordered_map<size_t, std::vector<std::pair<size_t, SignatureMatcher::Debug
                 
                 // 记录所有重复的实例
                 for (size_t pos : positions) {
-                    result[candidateIdx].emplace_back(pos, candidate.matchInfos[pos]);
+                    result[candidateIdx].emplace_back(pos, matchInfos[pos]);
                 }
             }
         }
@@ -51,15 +73,6 @@ std::unordered_map<size_t, std::vector<std::pair<size_t, SignatureMatcher::Debug
     return result;
 }
 
-template <typename T>
-std::string hexHashString(const T& value) {
-    std::stringstream ss;
-    ss << " 0x" << std::hex << value;
-    return ss.str();
-}
-
-size_t SignatureMatcher::nextCandidateId_ = 0;
-
 // SignatureMatcher::SignatureMatcher(std::shared_ptr<ICatalog> catalog, std::shared_ptr<IPerformanceConfig> config)
 //     : catalog_(catalog)
 //     , config_(config)
@@ -96,8 +109,10 @@ size_t SignatureMatcher::nextCandidateId_ = 0;
 //     }
 // }
 
-SignatureMatcher::SignatureMatcher(std::shared_ptr<ICatalog> catalog, std::shared_ptr<IPerformanceConfig> config)
+SignatureMatcher::SignatureMatcher(std::shared_ptr<ICatalog> catalog, std::shared_ptr<IPerformanceConfig> config,
+                                   std::shared_ptr<const ICatalogIndex> index)
     : catalog_(catalog)
+    , index_(std::move(index))
     , config_(config)
     , maxCandidates_(config->getMatchingConfig().maxCandidates)
     , maxCandidatesPerSignature_(config->getMatchingConfig().maxCandidatesPerSignature)
@@ -106,52 +121,177 @@ SignatureMatcher::SignatureMatcher(std::shared_ptr<ICatalog> catalog, std::share
     , minMatchesRequired_(config->getMatchingConfig().minMatchesRequired)
     , minMatchesUniqueTimestampRequired_(config->getMatchingConfig().minMatchesUniqueTimestampRequired)
     , offsetTolerance_(config->getMatchingConfig().offsetTolerance)
+    , materializeMatchedPoints_(config->getMatchingConfig().materializeMatchedPoints)
+    , coarseVoteFilter_(config->getMatchingConfig().coarseVoteTopMedia, config->getMatchingConfig().coarseVoteBucketMs)
+    , sessions_(config->getMatchingConfig().maxCandidates)
+    , sessionMatchedPoints_(sessions_.capacity())
+    , sessionMatchInfos_(sessions_.capacity(), makeDebugMatchInfoList())
+    , inMergeOrder_(sessions_.capacity(), 0)
+    , sessionVersions_(sessions_.capacity(), 0)
+    , sessionScoreDirty_(sessions_.capacity(), 0)
+    , expiryWheel_(sessions_.capacity(), matchExpireTime_ / SessionExpiryWheel::kSlots)
     , matchResults_(std::vector<MatchResult>(config->getMatchingConfig().maxCandidates))
-    , expiredCandidateSessionKeys_(std::vector<CandidateSessionKey>(config->getMatchingConfig().maxCandidates)) {
-    
-    // 预处理所有目标签名
-    const auto& signatures = catalog_->signatures();
+    , expiredSessions_(std::vector<SessionTable::Handle>(config->getMatchingConfig().maxCandidates)) {
+    attachCatalog();
+}
+
+void SignatureMatcher::attachCatalog() {
+    // 预处理所有目标签名：缓存各指纹的紧凑视图，匹配时直接读取catalog的紧凑表示
+    signatureViews_ = CatalogIndex::viewsOf(*catalog_);
+    const auto& signatures = signatureViews_;
     const auto& mediaItems = catalog_->mediaItems();
-    
+
     for (size_t i = 0; i < signatures.size(); ++i) {
-        const auto& signature = signatures[i];
-        const auto& mediaItem = mediaItems[i];
-        
-        if (signature.empty()) {
-            std::cerr << "警告: 数据库中的指纹 #" << i << " (" << mediaItem.title() << ") 是空的!" << std::endl;
-            continue;
+        if (signatures[i].empty()) {
+            std::cerr << "警告: 数据库中的指纹 #" << i << " (" << mediaItems[i].title() << ") 是空的!" << std::endl;
         }
+    }
 
-        // todo: 性能提升手段：
-        // 对于单个hash值，不需要vector存储，直接存储
-        // 对于多个hash值，需要vector存储
-        for (const auto& point : signature) {
-            TargetSignatureInfo2 info = {&mediaItem, &point, &signature};
-            if (hash2TargetSignaturesInfoMap_.find(point.hash) != hash2TargetSignaturesInfoMap_.end()) {
-                hash2TargetSignaturesInfoMap_[point.hash].push_back(std::move(info));
-            } else {
-                hash2TargetSignaturesInfoMap_[point.hash] = std::vector<TargetSignatureInfo2>{std::move(info)};
-            }
+    // 共享索引必须由同一个catalog构建，倒排记录数量与指纹点总数不一致时丢弃
+    if (index_) {
+        size_t totalPoints = 0;
+        for (const auto& signature : signatures) {
+            totalPoints += signature.size();
         }
-
-        // 按所有point的时间排序，输出前100个point的hash和timestamp
-        std::vector<std::pair<uint32_t, double>> points;
-        for (const auto& point : signature) {
-            points.emplace_back(point.hash, point.timestamp);
+        if (index_->postingCount() != totalPoints) {
+            std::cerr << "警告: 共享倒排索引与catalog不一致 (倒排记录数量: " << index_->postingCount() 
+                     << ", 指纹点数量: " << totalPoints << ")，将重新构建索引" << std::endl;
+            index_.reset();
         }
-        std::sort(points.begin(), points.end(), [](const auto& a, const auto& b) {
-            return a.second < b.second;
-        });
-        // std::cout << "rrr target: 按所有point的时间排序，输出前100个point的hash和timestamp" << std::endl;
-        // for (size_t i = 0; i < std::min(points.size(), size_t(300)); ++i) {
-        //     std::cout << "rrr  [" << i + 1 << "] hash: 0x" << std::hex << points[i].first << std::dec 
-        //               << ", timestamp: " << points[i].second << std::endl;
-        // }
     }
+    if (!index_) {
+        index_ = CatalogIndex::fromCatalog(catalog_, CatalogIndexOptions::fromMatchingConfig(config_->getMatchingConfig()));
+    }
+    coarseVoteFilter_.reset(signatures.size());
+    rebuildResolvedSignatures();
 
+    if (!logEnabled(MatcherLogLevel::Info)) {
+        return;
+    }
     std::cout << "预处理所有目标签名完成"
               << " (signature数量: " << signatures.size() << ")"
-              << " (唯一哈希值数量: " << hash2TargetSignaturesInfoMap_.size() << ")" << std::endl;
+              << " (唯一哈希值数量: " << index_->hashCount() << ")"
+              << " (倒排记录数量: " << index_->postingCount() << ")" << std::endl;
+}
+
+void SignatureMatcher::updateCatalog(std::shared_ptr<ICatalog> catalog, std::shared_ptr<const ICatalogIndex> index) {
+    if (!catalog || catalog == catalog_) {
+        return;
+    }
+
+    const auto& oldMediaItems = catalog_->mediaItems();
+    const auto& newMediaItems = catalog->mediaItems();
+    const size_t newSignatureCount = catalog->signatureCount();
+
+    // 新目录以旧目录为前缀（追加段、合并段）时，同一下标的指纹为同一内容，进行中的session直接迁移到新目录上
+    std::vector<uint8_t> migratable(catalog_->signatureCount(), 0);
+    for (size_t i = 0; i < std::min(migratable.size(), newSignatureCount); ++i) {
+        migratable[i] = catalog_->signatureView(i).size() == catalog->signatureView(i).size() &&
+                        oldMediaItems[i].title() == newMediaItems[i].title();
+    }
+    auto isMigratable = [&](const SessionRecord& candidate) {
+        const auto signatureIndex = signatureIndexOf(candidate.key.signatureId);
+        return signatureIndex != SIZE_MAX && migratable[signatureIndex];
+    };
+
+    // 无法对应到新目录的session保留在旧目录上，直至过期
+    bool referencesOldCatalog = false;
+    sessions_.forEach([&](SessionTable::Handle, const SessionRecord& candidate) {
+        referencesOldCatalog = referencesOldCatalog || !isMigratable(candidate);
+    });
+
+    // 旧目录仍被session引用时保留其快照，不再被引用后在processQuerySignature中释放
+    if (referencesOldCatalog) {
+        retiredCatalogs_.push_back({catalog_, index_, catalogIdBase_});
+    }
+
+    // 新目录的id区间接在保留的旧快照之后，没有保留的快照时从0开始；
+    // 切换回仍被session引用的旧快照时沿用它的id区间，其上的session重新参与匹配
+    uint64_t newIdBase = 0;
+    auto reused = std::find_if(retiredCatalogs_.begin(), retiredCatalogs_.end(),
+                               [&](const RetiredCatalog& retired) { return retired.catalog == catalog; });
+    if (reused != retiredCatalogs_.end()) {
+        newIdBase = reused->idBase;
+        retiredCatalogs_.erase(reused);
+    } else {
+        for (const auto& retired : retiredCatalogs_) {
+            newIdBase = std::max<uint64_t>(newIdBase, retired.idBase + retired.catalog->signatureCount());
+        }
+    }
+    if (newIdBase + newSignatureCount > std::numeric_limits<SignatureId>::max()) {
+        // id区间耗尽（目录切换极其频繁且旧session长期不过期），放弃保留在旧目录上的session
+        expiredSessions_.clear();
+        sessions_.forEach([&](SessionTable::Handle handle, const SessionRecord& candidate) {
+            if (!isMigratable(candidate)) {
+                expiredSessions_.push_back(handle);
+            }
+        });
+        for (const auto handle : expiredSessions_) {
+            removeSession(handle);
+        }
+        expiredSessions_.clear();
+        retiredCatalogs_.clear();
+        newIdBase = 0;
+    }
+
+    size_t migratedCount = 0;
+    sessions_.forEach([&](SessionTable::Handle, SessionRecord& candidate) {
+        if (!isMigratable(candidate)) {
+            return;
+        }
+        const auto signatureIndex = signatureIndexOf(candidate.key.signatureId);
+        candidate.key.signatureId = static_cast<SignatureId>(newIdBase + signatureIndex);
+        candidate.mediaItem = &newMediaItems[signatureIndex];
+        ++migratedCount;
+    });
+    // 键中的signature id已改变，重建哈希槽
+    sessions_.rehash();
+    // 分数堆按signature分组，下次淘汰时重建
+    scoreHeapsValid_ = false;
+
+    signatureSessions_.clear();
+    sessions_.forEach([this](SessionTable::Handle handle, const SessionRecord&) {
+        indexSession(handle);
+    });
+
+    clearCandidates();
+    catalog_ = std::move(catalog);
+    index_ = std::move(index);
+    catalogIdBase_ = static_cast<SignatureId>(newIdBase);
+    attachCatalog();
+
+    // 分片与本对象共用同一个索引，各自的分片索引重新划分
+    for (const auto& shard : shards_) {
+        shard->updateCatalog(catalog_, index_);
+    }
+    partitionShardIndexes();
+
+    if (logEnabled(MatcherLogLevel::Info)) {
+        std::cout << "已切换到新的目录快照: 迁移session数量 " << migratedCount
+                  << ", 保留在旧目录上的session数量 " << sessions_.size() - migratedCount << std::endl;
+    }
+}
+
+void SignatureMatcher::releaseRetiredCatalogs() {
+    if (retiredCatalogs_.empty()) {
+        return;
+    }
+
+    auto referenced = [this](const RetiredCatalog& retired) {
+        const uint64_t begin = retired.idBase;
+        const uint64_t end = begin + retired.catalog->signatureCount();
+        bool found = false;
+        sessions_.forEach([&](SessionTable::Handle, const SessionRecord& candidate) {
+            if (candidate.key.signatureId >= begin && candidate.key.signatureId < end) {
+                found = true;
+            }
+        });
+        return found;
+    };
+
+    retiredCatalogs_.erase(std::remove_if(retiredCatalogs_.begin(), retiredCatalogs_.end(),
+                                          [&](const RetiredCatalog& retired) { return !referenced(retired); }),
+                           retiredCatalogs_.end());
 }
 
 SignatureMatcher::~SignatureMatcher() = default;
@@ -160,300 +300,532 @@ SignatureMatcher::~SignatureMatcher() = default;
 
 void SignatureMatcher::processQuerySignature(
     const std::vector<SignaturePoint>& querySignature, size_t inputChannelCount) {
-    
-    // 计算实际时间偏移（不量化）
-    auto calculate_actual_offset = [](double queryTime, double targetTime) -> int32_t {
-        return static_cast<int32_t>((queryTime - targetTime) * 1000) ;  // 返回实际时间差(毫秒)
-    };
-    
-
+    if (prepareQueryBatch(querySignature)) {
+        matchQueryBatch(querySignature, inputChannelCount);
+    }
+}
 
-    auto hash_seesion_key_func = [](const afp::CandidateSessionKey& k) {
-        uintptr_t ptr = reinterpret_cast<uintptr_t>(k.signature);
-#if INTPTR_MAX == INT32_MAX  // 32-bit platform
-        uint32_t ptr_low16 = static_cast<uint32_t>(ptr & 0xFFFF);
-        uint32_t offset_low16 = static_cast<uint32_t>(k.offset & 0xFFFF);
-        return static_cast<size_t>((ptr_low16 << 16) | offset_low16);
-#else  // 64-bit platform
-        uint64_t ptr_low32 = static_cast<uint64_t>(ptr & 0xFFFFFFFF);
-        uint64_t offset_low32 = static_cast<uint64_t>(k.offset & 0xFFFFFFFF);
-        return static_cast<size_t>((ptr_low32 << 32) | offset_low32);
-#endif
-    };
+void SignatureMatcher::voteQuerySignature(const std::vector<SignaturePoint>& querySignature,
+                                          std::vector<std::pair<uint32_t, uint32_t>>& candidates) {
+    candidates.clear();
+    if (prepareQueryBatch(querySignature)) {
+        coarseVoteFilter_.selectedCandidates(candidates);
+    }
+}
 
+void SignatureMatcher::matchVotedQuerySignature(const std::vector<SignaturePoint>& querySignature,
+                                                const std::vector<uint32_t>& selected, size_t inputChannelCount) {
+    if (querySignature.empty() || index_->empty()) {
+        return;
+    }
+    coarseVoteFilter_.restrictTo(selected);
+    matchQueryBatch(querySignature, inputChannelCount);
+}
 
+bool SignatureMatcher::prepareQueryBatch(const std::vector<SignaturePoint>& querySignature) {
+    stats_ = MatchStats{};
     if (querySignature.empty()) {
-        return;
+        return false;
     }
-    if (hash2TargetSignaturesInfoMap_.empty()) {
-        return;
+    if (index_->empty()) {
+        return false;
     }
-    
-    // Reset visualization data if collection is enabled
+    batchStartNanos_ = TraceRing::now();
+    for (const auto& shard : shards_) {
+        shard->batchStartNanos_ = batchStartNanos_;
+    }
+
+    // 流式匹配每次只传入新的查询指纹点，可视化数据逐次累积
     if (collectVisualizationData_) {
-        visualizationData_ = VisualizationData();
         visualizationData_.title = "Query Audio";
         
-        // Add all query points to visualization data
+        // Add new query points to visualization data
         for (const auto& point : querySignature) {
-            visualizationData_.fingerprintPoints.emplace_back(
-                point.frequency, point.timestamp, point.hash);
+            pointSampler_.append(visualizationData_.fingerprintPoints,
+                                 std::make_tuple(point.frequency, point.timestamp, point.hash), visualizationLimits_);
             
             // Also add as general peak for better visualization
-            visualizationData_.allPeaks.emplace_back(point.frequency, point.timestamp, point.amplitude / 1000.0f);
+            peakSampler_.append(visualizationData_.allPeaks,
+                                std::make_tuple(point.frequency, point.timestamp, point.amplitude / 1000.0f), visualizationLimits_);
         }
         
         // Set duration to the last timestamp + buffer
         if (!querySignature.empty()) {
-            visualizationData_.duration = querySignature.back().timestamp + 1.0;
+            visualizationData_.duration = std::max(visualizationData_.duration, querySignature.back().timestamp + 1.0);
         }
     }
     
+    // 在CSR索引中查找哈希，命中的倒排记录是连续存储的
+    // 查询点按哈希排序去重后批量查找：重复的哈希只查一次，相邻的查找沿索引的同一段前进；
+    // 结果再按查询点的原始顺序展开，之后的投票和session匹配顺序不变
+    sortedQueryKeys_.clear();
+    for (size_t i = 0; i < querySignature.size(); ++i) {
+        sortedQueryKeys_.push_back(static_cast<uint64_t>(querySignature[i].hash) << 32 | i);
+    }
+    std::sort(sortedQueryKeys_.begin(), sortedQueryKeys_.end());
+    uniqueQueryHashes_.clear();
+    for (const uint64_t key : sortedQueryKeys_) {
+        const auto hash = static_cast<uint32_t>(key >> 32);
+        if (uniqueQueryHashes_.empty() || uniqueQueryHashes_.back() != hash) {
+            uniqueQueryHashes_.push_back(hash);
+        }
+    }
+    uniqueQueryPostings_.resize(uniqueQueryHashes_.size());
+    index_->findBatch(uniqueQueryHashes_.data(), uniqueQueryHashes_.size(), uniqueQueryPostings_.data());
+    queryPostings_.resize(querySignature.size());
+    size_t unique = 0;
+    for (const uint64_t key : sortedQueryKeys_) {
+        if (static_cast<uint32_t>(key >> 32) != uniqueQueryHashes_[unique]) {
+            ++unique;
+        }
+        queryPostings_[static_cast<uint32_t>(key)] = uniqueQueryPostings_[unique];
+    }
+
+    // step0 粗筛：按(目标指纹, 粗偏移桶)计票，选出得票最高的目标指纹
+    if (coarseVoteFilter_.enabled()) {
+        coarseVoteFilter_.beginBatch();
+        for (size_t i = 0; i < querySignature.size(); ++i) {
+            for (auto posting = queryPostings_[i].first; posting != queryPostings_[i].second; ++posting) {
+                const double targetTimestamp = signatureViews_[posting->signatureIndex].timestamp(posting->pointIndex);
+                coarseVoteFilter_.addVote(posting->signatureIndex,
+                                          calculateActualOffset(querySignature[i].timestamp, targetTimestamp));
+            }
+        }
+        coarseVoteFilter_.select();
+#ifdef ENABLED_DIAGNOSE
+        if (logEnabled(MatcherLogLevel::Verbose)) {
+            std::cout << "粗筛投票: 得票目标指纹数 " << coarseVoteFilter_.votedMediaCount()
+                      << ", 通过筛选 " << coarseVoteFilter_.selectedMediaCount() << std::endl;
+        }
+#endif
+    }
+    return true;
+}
+
+void SignatureMatcher::matchQueryBatch(const std::vector<SignaturePoint>& querySignature, size_t inputChannelCount) {
+    if (shards_.empty()) {
+        matchQueryPostings(querySignature, inputChannelCount, queryPostings_, coarseVoteFilter_);
+    } else {
+        matchQueryPostingsInShards(querySignature, inputChannelCount);
+    }
+
+    // 检测延迟：从session第一次被命中到结果通知
+    if (latencyStats_ && !matchDetections_.empty()) {
+        const auto notifyNanos = TraceRing::now();
+        const double notifyTime = querySignature.back().timestamp;
+        for (const auto& detection : matchDetections_) {
+            latencyStats_->detectionWallMicros.record(
+                notifyNanos > detection.firstHitNanos ? (notifyNanos - detection.firstHitNanos) / 1000 : 0);
+            latencyStats_->detectionAudioMillis.record(
+                static_cast<uint64_t>(std::llround(std::max(0.0, notifyTime - detection.firstMatchTime) * 1000.0)));
+        }
+    }
+
+    // Setp3 notify match result
+    if (matchResultSink_) {
+        for (auto& matchResult : matchResults_) {
+            matchResultSink_(std::move(matchResult));
+        }
+    } else {
+        for (const auto& matchResult : matchResults_) {
+            matchNotifyCallback_(matchResult);
+        }
+    }
+
+    if (collectVisualizationData_ && !visualizationLimits_.unlimited()) {
+        trimSessionHistory(querySignature.back().timestamp);
+    }
+
+    // 结构化统计
+    if (statsCallback_) {
+        statsCallback_(stats_);
+    }
+}
+
+void SignatureMatcher::trimSessionHistory(double latestQueryTime) {
+    if (historyMatchCount_ < historyTrimAt_) {
+        return;
+    }
+
+    const auto& limits = visualizationLimits_;
+    if (limits.windowSeconds > 0.0) {
+        const double cutoff = latestQueryTime - limits.windowSeconds;
+        auto isOld = [cutoff](const DebugMatchInfo& info) {
+            return info.queryTime < cutoff;
+        };
+        for (auto& matchInfos : sessionMatchInfos_) {
+            matchInfos.erase(std::remove_if(matchInfos.begin(), matchInfos.end(), isOld), matchInfos.end());
+        }
+        for (auto it = allSessionsHistory_.begin(); it != allSessionsHistory_.end(); ) {
+            auto& matchInfos = it->second;
+            matchInfos.erase(std::remove_if(matchInfos.begin(), matchInfos.end(), isOld), matchInfos.end());
+            it = matchInfos.empty() ? allSessionsHistory_.erase(it) : std::next(it);
+        }
+    }
+
+    // 只保留匹配明细最多的maxSessions个session，与saveSessionsData的排序一致
+    if (limits.maxSessions > 0 && allSessionsHistory_.size() > limits.maxSessions) {
+        std::vector<std::pair<size_t, SessionHistoryMap::iterator>> bySize;
+        bySize.reserve(allSessionsHistory_.size());
+        for (auto it = allSessionsHistory_.begin(); it != allSessionsHistory_.end(); ++it) {
+            bySize.emplace_back(it->second.size(), it);
+        }
+        std::nth_element(bySize.begin(), bySize.begin() + limits.maxSessions, bySize.end(),
+                         [](const auto& a, const auto& b) { return a.first > b.first; });
+        for (auto it = bySize.begin() + limits.maxSessions; it != bySize.end(); ++it) {
+            allSessionsHistory_.erase(it->second);
+        }
+    }
+
+    historyMatchCount_ = 0;
+    for (const auto& [sessionId, matchInfos] : allSessionsHistory_) {
+        historyMatchCount_ += matchInfos.size();
+    }
+    historyTrimAt_ = std::max<size_t>(historyMatchCount_ * 2, VisualizationSampler::kMinTrimRows);
+}
+
+void SignatureMatcher::matchQueryPostingsInShards(
+    const std::vector<SignaturePoint>& querySignature, size_t inputChannelCount) {
+    // 各分片只访问自己的索引和session，共享只读的查询哈希和粗筛结果，不需要加锁
+    shardRunner_->run(shards_.size(), [&](size_t shardIndex) {
+        auto& shard = *shards_[shardIndex];
+        shard.lookupShardPostings(uniqueQueryHashes_, sortedQueryKeys_);
+        shard.matchQueryPostings(querySignature, inputChannelCount, shard.queryPostings_, coarseVoteFilter_);
+    });
+
+    // 按分片顺序汇总结果和统计；查询点相关的计数取自本对象在整个索引中的查找，其余计数累加
+    matchResults_.clear();
+    matchDetections_.clear();
+    stats_ = MatchStats{};
+    stats_.timestamp = querySignature.back().timestamp;
+    stats_.queryPointCount = querySignature.size();
+    for (const auto& postings : queryPostings_) {
+        if (postings.first != postings.second) {
+            ++stats_.queryHitCount;
+        }
+    }
+    for (const auto& shard : shards_) {
+        matchResults_.insert(matchResults_.end(), shard->matchResults_.begin(), shard->matchResults_.end());
+        matchDetections_.insert(matchDetections_.end(), shard->matchDetections_.begin(), shard->matchDetections_.end());
+        const auto& shardStats = shard->stats_;
+        stats_.postingHitCount += shardStats.postingHitCount;
+        stats_.coarsePrunedPostingCount += shardStats.coarsePrunedPostingCount;
+        stats_.resolvedSkippedPostingCount += shardStats.resolvedSkippedPostingCount;
+        stats_.newSessionCount += shardStats.newSessionCount;
+        stats_.mergedSessionCount += shardStats.mergedSessionCount;
+        stats_.evictedSessionCount += shardStats.evictedSessionCount;
+        stats_.rejectedSessionCount += shardStats.rejectedSessionCount;
+        stats_.expiredSessionCount += shardStats.expiredSessionCount;
+        stats_.notifiedMatchCount += shardStats.notifiedMatchCount;
+        stats_.activeSessionCount += shardStats.activeSessionCount;
+    }
+}
+
+void SignatureMatcher::lookupShardPostings(const std::vector<uint32_t>& uniqueHashes,
+                                           const std::vector<uint64_t>& sortedKeys) {
+    uniqueQueryPostings_.resize(uniqueHashes.size());
+    shardPostingIndex_->findBatch(uniqueHashes.data(), uniqueHashes.size(), uniqueQueryPostings_.data());
+    queryPostings_.resize(sortedKeys.size());
+    size_t unique = 0;
+    for (const uint64_t key : sortedKeys) {
+        if (static_cast<uint32_t>(key >> 32) != uniqueHashes[unique]) {
+            ++unique;
+        }
+        queryPostings_[static_cast<uint32_t>(key)] = uniqueQueryPostings_[unique];
+    }
+}
+
+void SignatureMatcher::matchQueryPostings(
+    const std::vector<SignaturePoint>& querySignature, size_t inputChannelCount,
+    const std::vector<QueryPostingRange>& queryPostings, const CoarseVoteFilter& voteFilter) {
+#ifdef ENABLED_DIAGNOSE
+    auto hash_seesion_key_func = [](const afp::CandidateSessionKey& k) {
+        return std::hash<afp::CandidateSessionKey>()(k);
+    };
+#endif
+
+    const auto& mediaItems = catalog_->mediaItems();
+
     int queryPointprint = 0;
     int queryPointHitCount = 0;
 
-    // step1 add/update candidate using actual time offsets
-    for (const auto& queryPoint : querySignature) {
-        ++queryPointprint;
+    stats_ = MatchStats{};
+    stats_.queryPointCount = querySignature.size();
 
-        auto targetIt = hash2TargetSignaturesInfoMap_.find(queryPoint.hash);
-        if (targetIt == hash2TargetSignaturesInfoMap_.end()) {
-            continue;
-        }
-        ++queryPointHitCount;
+    // 处理单个命中的目标指纹点：创建或更新候选session
+    auto processTargetHit = [&](const SignaturePoint& queryPoint, const TargetSignatureInfo2& targetSignaturesInfo) {
+        // 计算实际时间偏移
+        const double targetTimestamp = targetSignaturesInfo.signature->timestamp(targetSignaturesInfo.pointIndex);
+        const auto actualOffset = calculateActualOffset(queryPoint.timestamp, targetTimestamp);
 
-        const auto& targetSignaturesInfoList = targetIt->second;
-        for (const auto& targetSignaturesInfo : targetSignaturesInfoList) {
-            // 计算实际时间偏移
-            const auto actualOffset = calculate_actual_offset(queryPoint.timestamp, targetSignaturesInfo.signaturePoint->timestamp);
+        const auto sessionKey = CandidateSessionKey{
+            .offset = actualOffset,
+            .signatureId = targetSignaturesInfo.signatureId
+        };
 
-            const auto sessionKey = CandidateSessionKey{
-                .offset = actualOffset,
-                .signature = targetSignaturesInfo.signature
+        // 源点的频率/振幅只在记录调试明细时从catalog读取，附表按需解码
+        auto makeDebugMatchInfo = [&]() {
+            const SignaturePoint sourcePoint =
+                catalog_->signaturePoint(targetSignaturesInfo.signatureIndex, targetSignaturesInfo.pointIndex);
+            return DebugMatchInfo { 
+                queryPoint.hash, 
+                queryPoint.timestamp, 
+                targetTimestamp, 
+                actualOffset, 
+                queryPoint.frequency, 
+                queryPoint.amplitude,
+                sourcePoint.frequency,
+                sourcePoint.amplitude,
+                sourcePoint
             };
+        };
 
-            const auto foundCandidate = session2CandidateMap_.find(sessionKey) != session2CandidateMap_.end();
-            if (foundCandidate) {
-                auto& candidate = session2CandidateMap_[sessionKey];
-                if (candidate.isNotified) {
-                    continue;
-                }
-                if (queryPoint.timestamp >= candidate.lastMatchTime || true) {  // todo: 当前不考虑时间戳，直接更新match count
-                    candidate.matchCount += 1;
-                    
-                    // 更新unique时间戳
-                    double roundedTime = std::round(queryPoint.timestamp * 100.0) / 100.0;
-                    bool isNewTimestamp = candidate.uniqueTimestamps.insert(roundedTime).second;
-                    if (isNewTimestamp) {
-                        candidate.uniqueTimestampCount += 1;
-                    }
-                    
-                    // 直接使用targetSignaturesInfo.signaturePoint中的完整信息
-                    const SignaturePoint* sourcePoint = targetSignaturesInfo.signaturePoint;
-                    
-                    candidate.matchInfos.push_back(DebugMatchInfo { 
-                        hexHashString(queryPoint.hash), 
-                        queryPoint.timestamp, 
-                        targetSignaturesInfo.signaturePoint->timestamp, 
-                        actualOffset, 
-                        queryPoint.frequency, 
-                        queryPoint.amplitude,
-                        sourcePoint->frequency,
-                        sourcePoint->amplitude,
-                        *sourcePoint
-                    });
-                    candidate.lastMatchTime = queryPoint.timestamp;
-                    candidate.isMatchCountChanged = true;
-                    
-                    // 累积实际偏移
-                    candidate.actualOffsetSum += actualOffset;
-                    candidate.offsetCount += 1;
-
-                    // std::cout << "rrr update candidate: " << queryPointprint << " hash: 0x" << std::hex << queryPoint.hash << std::dec 
-                    // << ", timestamp: " << queryPoint.timestamp 
-                    // << ", targetSignaturesInfo.signaturePoint->timestamp: " << targetSignaturesInfo.signaturePoint->timestamp 
-                    // << ", actualOffset: " << actualOffset 
-                    // << ", sessionKey: " << hash_seesion_key_func(sessionKey) 
-                    // << ", matchcount: " << candidate.matchCount 
-                    // << ", uniqueTimestampCount: " << candidate.uniqueTimestampCount
-                    // << ", actualOffsetSum: " << candidate.actualOffsetSum
-                    // << ", offsetCount: " << candidate.offsetCount
-                    // << ", averageOffset: " << candidate.actualOffsetSum / candidate.offsetCount 
-                    // << std::endl;
-
-                    // 存储到session历史记录中，用于可视化
-                    if (collectVisualizationData_) {
-                        std::string sessionId = generateSessionId(sessionKey);
-                        allSessionsHistory_[sessionId].push_back(
-                            DebugMatchInfo { 
-                                hexHashString(queryPoint.hash), 
-                                queryPoint.timestamp, 
-                                targetSignaturesInfo.signaturePoint->timestamp, 
-                                actualOffset, 
-                                queryPoint.frequency, 
-                                queryPoint.amplitude,
-                                sourcePoint->frequency,
-                                sourcePoint->amplitude,
-                                *sourcePoint
-                            });
-                    }
+        // 记录命中的源点，完整的调试明细只在收集可视化数据时记录
+        const auto pointIndex = targetSignaturesInfo.pointIndex;
+        auto recordMatch = [&](SessionTable::Handle handle) {
+            sessionMatchedPoints_[handle].push_back(pointIndex);
+            markSessionScoreChanged(handle);
+            if (collectVisualizationData_) {
+                sessionMatchInfos_[handle].push_back(makeDebugMatchInfo());
+            }
+        };
 
-                    continue;
-                } 
-            } else {
-                // 创建新的候选项
-                double channelRatio = 1.0;
-                const auto targetChannelCount = targetSignaturesInfo.mediaItem->channelCount();
-                if (targetChannelCount > 0) {
-                    // 如果候选音频通道数大于输入音频通道数，则根据通道比例调整最大可匹配特征数
-                    channelRatio = std::min(1.0, static_cast<double>(inputChannelCount) / targetChannelCount);
-                }
-                // 计算考虑通道比例后的最大可匹配特征数
-                const auto targetHashesCount = targetSignaturesInfo.signature->size();
-                const auto maxPossibleMatches = static_cast<size_t>(targetHashesCount * channelRatio);
+        // 存储到session历史记录中，用于可视化
+        auto recordHistory = [&](const CandidateSessionKey& key) {
+            if (collectVisualizationData_) {
+                auto& matchInfos = allSessionsHistory_.try_emplace(generateSessionId(key), makeDebugMatchInfoList()).first->second;
+                matchInfos.push_back(makeDebugMatchInfo());
+                ++historyMatchCount_;
+            }
+        };
 
-                // 查找源SignaturePoint以获取完整信息（源点就是目标签名中的匹配点）
-                const SignaturePoint* sourcePoint = targetSignaturesInfo.signaturePoint;
-                
-                // 初始化unique时间戳
-                double roundedTime = std::round(queryPoint.timestamp * 100.0) / 100.0;
-                std::unordered_set<double> initialUniqueTimestamps = {roundedTime};
+        const int64_t quantizedTimestamp = TimestampWindow::quantize(queryPoint.timestamp);
+
+        const auto foundHandle = sessions_.find(sessionKey);
+        if (foundHandle != SessionTable::kInvalidHandle) {
+            auto& candidate = sessions_.at(foundHandle);
+            if (candidate.isNotified) {
+                return;
+            }
+            if (queryPoint.timestamp >= candidate.lastMatchTime || true) {  // todo: 当前不考虑时间戳，直接更新match count
+                candidate.matchCount += 1;
                 
-                MatchingCandidate newCandidate = {
-                    .targetSignatureInfo = &targetSignaturesInfo,
-                    .maxPossibleMatches = maxPossibleMatches,
-                    .matchCount = 1,
-                    .matchInfos = { DebugMatchInfo { 
-                        hexHashString(queryPoint.hash), 
-                        queryPoint.timestamp, 
-                        targetSignaturesInfo.signaturePoint->timestamp, 
-                        actualOffset, 
-                        queryPoint.frequency, 
-                        queryPoint.amplitude,
-                        sourcePoint->frequency,
-                        sourcePoint->amplitude,
-                        *sourcePoint
-                    } },
-                    .lastMatchTime = queryPoint.timestamp,
-                    .offset = actualOffset,
-                    .actualOffsetSum = actualOffset,  // 初始化累积偏移
-                    .offsetCount = 1,                 // 初始化偏移计数
-                    .uniqueTimestampCount = 1,        // 初始化unique时间戳数量
-                    .uniqueTimestamps = std::move(initialUniqueTimestamps), // 初始化unique时间戳集合
-                    .isMatchCountChanged = true,
-                    .isNotified = false,
-                };
+                // 更新unique时间戳
+                if (candidate.timestamps.insert(quantizedTimestamp)) {
+                    candidate.uniqueTimestampCount += 1;
+                }
                 
-                // 第一步：尝试与现有的同signature sessions合并
-                CandidateSessionKey mergedSessionKey = tryMergeWithExistingSessions(sessionKey, newCandidate);
-                if (mergedSessionKey.signature != nullptr) {
-                    // 成功合并到现有session，添加可视化数据
-                    if (collectVisualizationData_) {
-                        std::string sessionId = generateSessionId(mergedSessionKey);
-                        allSessionsHistory_[sessionId].push_back(
-                            DebugMatchInfo { 
-                                hexHashString(queryPoint.hash), 
-                                queryPoint.timestamp, 
-                                targetSignaturesInfo.signaturePoint->timestamp, 
-                                actualOffset, 
-                                queryPoint.frequency, 
-                                queryPoint.amplitude,
-                                sourcePoint->frequency,
-                                sourcePoint->amplitude,
-                                *sourcePoint
-                            });
-                    }
-                    
-                    if (queryPointprint < 300) {
-                        std::cout << "rrr merged into existing session: " << queryPointprint 
-                        << " hash: 0x" << std::hex << queryPoint.hash << std::dec 
-                        << ", timestamp: " << queryPoint.timestamp 
-                        << ", merged into sessionKey: " << hash_seesion_key_func(mergedSessionKey) 
-                        << ", new match count: " << session2CandidateMap_[mergedSessionKey].matchCount << std::endl;
-                    }
-                    continue; // 合并成功，处理下一个hash
+                recordMatch(foundHandle);
+                // 时间轮按调度时的过期时间取出session，过期时间只会推后时不必重新调度
+                if (queryPoint.timestamp < candidate.lastMatchTime) {
+                    expiryWheel_.schedule(foundHandle, queryPoint.timestamp + matchExpireTime_);
                 }
+                candidate.lastMatchTime = queryPoint.timestamp;
+                candidate.isMatchCountChanged = true;
                 
-                // 第二步：合并失败，检查是否需要计分淘汰策略
-                bool shouldAddCandidate = true;
-                CandidateSessionKey sessionToRemove{0, nullptr};
+                // 累积实际偏移
+                candidate.actualOffsetSum += actualOffset;
+                candidate.offsetSquareSum += static_cast<double>(actualOffset) * actualOffset;
+                candidate.offsetCount += 1;
+
+                recordHistory(sessionKey);
+                return;
+            } 
+        } else {
+            // 创建新的候选项
+            double channelRatio = 1.0;
+            const auto targetChannelCount = targetSignaturesInfo.mediaItem->channelCount();
+            if (targetChannelCount > 0) {
+                // 如果候选音频通道数大于输入音频通道数，则根据通道比例调整最大可匹配特征数
+                channelRatio = std::min(1.0, static_cast<double>(inputChannelCount) / targetChannelCount);
+            }
+            // 计算考虑通道比例后的最大可匹配特征数
+            const auto targetHashesCount = targetSignaturesInfo.signature->size();
+            const auto maxPossibleMatches = static_cast<uint32_t>(targetHashesCount * channelRatio);
+
+            SessionRecord newCandidate = {
+                .key = sessionKey,
+                .mediaItem = targetSignaturesInfo.mediaItem,
+                .maxPossibleMatches = maxPossibleMatches,
+                .matchCount = 1,
+                .uniqueTimestampCount = 1,        // 初始化unique时间戳数量
+                .offsetCount = 1,                 // 初始化偏移计数
+                .actualOffsetSum = actualOffset,  // 初始化累积偏移
+                .offsetSquareSum = static_cast<double>(actualOffset) * actualOffset,
+                .lastMatchTime = queryPoint.timestamp,
+                .firstMatchTime = queryPoint.timestamp,
+                .firstHitNanos = batchStartNanos_,
+                .timestamps = {},
+                .isMatchCountChanged = true,
+                .isNotified = false,
+            };
+            newCandidate.timestamps.reset(quantizedTimestamp);  // 初始化unique时间戳集合
+            
+            // 第一步：尝试与现有的同signature sessions合并
+            const auto mergedHandle = tryMergeWithExistingSessions(newCandidate);
+            if (mergedHandle != SessionTable::kInvalidHandle) {
+                // 成功合并到现有session，添加匹配明细及可视化数据
+                const auto& mergedCandidate = sessions_.at(mergedHandle);
+                recordMatch(mergedHandle);
+                recordHistory(mergedCandidate.key);
                 
-                if (signature2SessionCnt_[targetSignaturesInfo.signature] >= maxCandidatesPerSignature_) {
-                    // 使用计分机制决定是否替换同一signature下的现有session
-                    if (shouldReplaceSessionInSignature(newCandidate, targetSignaturesInfo.signature, queryPoint.timestamp)) {
-                        sessionToRemove = findLowestScoreSessionInSignature(targetSignaturesInfo.signature, queryPoint.timestamp);
+                ++stats_.mergedSessionCount;
+#ifdef ENABLED_DIAGNOSE
+                if (queryPointprint < 300 && logEnabled(MatcherLogLevel::Verbose)) {
+                    std::cout << "rrr merged into existing session: " << queryPointprint 
+                    << " hash: 0x" << std::hex << queryPoint.hash << std::dec 
+                    << ", timestamp: " << queryPoint.timestamp 
+                    << ", merged into sessionKey: " << hash_seesion_key_func(mergedCandidate.key) 
+                    << ", new match count: " << mergedCandidate.matchCount << std::endl;
+                }
+#endif
+                return; // 合并成功，处理下一个hash
+            }
+            
+            // 第二步：合并失败，检查是否需要计分淘汰策略
+            bool shouldAddCandidate = true;
+            auto sessionToRemove = SessionTable::kInvalidHandle;
+            
+            if (sessionCountOf(targetSignaturesInfo.signatureId) >= maxCandidatesPerSignature_) {
+                // 使用计分机制决定是否替换同一signature下的现有session
+                if (shouldReplaceSessionInSignature(newCandidate, targetSignaturesInfo.signatureId, queryPoint.timestamp)) {
+                    sessionToRemove = findLowestScoreSessionInSignature(targetSignaturesInfo.signatureId, queryPoint.timestamp);
+#ifdef ENABLED_DIAGNOSE
+                    if (logEnabled(MatcherLogLevel::Verbose)) {
                         std::cout << "Replacing low-score session within signature " 
-                                  << targetSignaturesInfo.signature << " (offset: " << sessionToRemove.offset << ")" 
+                                  << targetSignaturesInfo.signatureId << " (offset: " << sessions_.at(sessionToRemove).key.offset << ")" 
                                   << " with new candidate" << std::endl;
-                    } else {
-                        shouldAddCandidate = false;
+                    }
+#endif
+                } else {
+                    shouldAddCandidate = false;
+#ifdef ENABLED_DIAGNOSE
+                    if (logEnabled(MatcherLogLevel::Verbose)) {
                         std::cout << "Ignoring new candidate due to low score compared to existing sessions in signature" << std::endl;
                     }
+#endif
                 }
-                else if (session2CandidateMap_.size() >= maxCandidates_) {
-                    // 使用计分机制决定是否替换现有session
-                    if (shouldReplaceSession(newCandidate, queryPoint.timestamp)) {
-                        sessionToRemove = findLowestScoreSession(queryPoint.timestamp);
+            }
+            else if (sessions_.size() >= maxCandidates_) {
+                // 使用计分机制决定是否替换现有session
+                if (shouldReplaceSession(newCandidate, queryPoint.timestamp)) {
+                    sessionToRemove = findLowestScoreSession(queryPoint.timestamp);
+#ifdef ENABLED_DIAGNOSE
+                    if (logEnabled(MatcherLogLevel::Verbose)) {
                         std::cout << "Replacing low-score session for " 
-                                  << sessionToRemove.signature << " with new candidate for "
-                                  << targetSignaturesInfo.signature << std::endl;
-                    } else {
-                        shouldAddCandidate = false;
+                                  << sessions_.at(sessionToRemove).key.signatureId << " with new candidate for "
+                                  << targetSignaturesInfo.signatureId << std::endl;
+                    }
+#endif
+                } else {
+                    shouldAddCandidate = false;
+#ifdef ENABLED_DIAGNOSE
+                    if (logEnabled(MatcherLogLevel::Verbose)) {
                         std::cout << "Ignoring new candidate due to low score compared to existing sessions" << std::endl;
                     }
+#endif
                 }
-                
-                if (shouldAddCandidate) {
-                    // 如果需要移除旧session，先移除
-                    if (sessionToRemove.signature != nullptr) {
-                        auto removeIt = session2CandidateMap_.find(sessionToRemove);
-                        if (removeIt != session2CandidateMap_.end()) {
-                            signature2SessionCnt_[sessionToRemove.signature] -= 1;
-                            session2CandidateMap_.erase(removeIt);
-                            std::cout << "Removed low-score session: signature=" << sessionToRemove.signature 
-                                      << ", offset=" << sessionToRemove.offset << std::endl;
-                        }
-                    }
-                    
-                    // 添加新session
-                    signature2SessionCnt_[targetSignaturesInfo.signature] += 1;
-                    
-                    // 存储到session历史记录中，用于可视化
-                    if (collectVisualizationData_) {
-                        std::string sessionId = generateSessionId(sessionKey);
-                        allSessionsHistory_[sessionId].push_back(
-                            DebugMatchInfo { 
-                                hexHashString(queryPoint.hash), 
-                                queryPoint.timestamp, 
-                                targetSignaturesInfo.signaturePoint->timestamp, 
-                                actualOffset, 
-                                queryPoint.frequency, 
-                                queryPoint.amplitude,
-                                sourcePoint->frequency,
-                                sourcePoint->amplitude,
-                                *sourcePoint
-                            });
+            }
+            
+            if (!shouldAddCandidate) {
+                ++stats_.rejectedSessionCount;
+            } else {
+                // 如果需要移除旧session，先移除
+                if (sessionToRemove != SessionTable::kInvalidHandle) {
+                    const auto removedKey = sessions_.at(sessionToRemove).key;
+                    trace(kSessionEvictTraceEvent, sessions_.at(sessionToRemove).matchCount,
+                          removedKey.offset, queryPoint.timestamp);
+                    removeSession(sessionToRemove);
+                    ++stats_.evictedSessionCount;
+#ifdef ENABLED_DIAGNOSE
+                    if (logEnabled(MatcherLogLevel::Verbose)) {
+                        std::cout << "Removed low-score session: signature=" << removedKey.signatureId 
+                                  << ", offset=" << removedKey.offset << std::endl;
                     }
+#endif
+                }
+                
+                // 添加新session
+                const auto handle = addSession(newCandidate);
+                if (handle == SessionTable::kInvalidHandle) {
+                    std::cerr << "警告: session表已满，忽略新的候选session" << std::endl;
+                    return;
+                }
+                recordMatch(handle);
+                recordHistory(sessionKey);
+                ++stats_.newSessionCount;
+                trace(kSessionCreateTraceEvent, 0, sessionKey.offset, queryPoint.timestamp);
 
-                    session2CandidateMap_[sessionKey] = newCandidate;
-                    // if (queryPointprint < 300) {
-                        std::cout << "rrr add new candidate: " << queryPointprint << " hash: 0x" << std::hex << queryPoint.hash << std::dec 
-                        << ", timestamp: " << queryPoint.timestamp 
-                        << ", targetSignaturesInfo.signaturePoint->timestamp: " << targetSignaturesInfo.signaturePoint->timestamp 
-                        << ", actualOffset: " << actualOffset 
-                        << ", sessionKey: " << hash_seesion_key_func(sessionKey) 
-                        << ", matchcount: " << newCandidate.matchCount 
-                        << ", uniqueTimestampCount: " << newCandidate.uniqueTimestampCount
-                        << ", actualOffsetSum: " << newCandidate.actualOffsetSum
-                        << ", offsetCount: " << newCandidate.offsetCount
-                        << ", averageOffset: " << newCandidate.actualOffsetSum / newCandidate.offsetCount 
-                        << ", score: " << calculateSessionScore(newCandidate, queryPoint.timestamp) << std::endl;
-                    // }
+#ifdef ENABLED_DIAGNOSE
+                if (logEnabled(MatcherLogLevel::Verbose)) {
+                    std::cout << "rrr add new candidate: " << queryPointprint << " hash: 0x" << std::hex << queryPoint.hash << std::dec 
+                    << ", timestamp: " << queryPoint.timestamp 
+                    << ", targetTimestamp: " << targetTimestamp 
+                    << ", actualOffset: " << actualOffset 
+                    << ", sessionKey: " << hash_seesion_key_func(sessionKey) 
+                    << ", matchcount: " << newCandidate.matchCount 
+                    << ", uniqueTimestampCount: " << newCandidate.uniqueTimestampCount
+                    << ", actualOffsetSum: " << newCandidate.actualOffsetSum
+                    << ", offsetCount: " << newCandidate.offsetCount
+                    << ", averageOffset: " << newCandidate.actualOffsetSum / newCandidate.offsetCount 
+                    << ", score: " << calculateSessionScore(newCandidate, queryPoint.timestamp) << std::endl;
                 }
-            }  
+#endif
+            }
+        }  
+    };
+
+    // 未通过粗筛的目标指纹只在已有session时继续参与匹配，保证进行中的session不会因某一批票数少而中断
+    auto passesCoarseVote = [&](uint32_t signatureIndex) {
+        if (voteFilter.passes(signatureIndex)) {
+            return true;
+        }
+        return sessionCountOf(static_cast<SignatureId>(catalogIdBase_ + signatureIndex)) > 0;
+    };
+
+    const auto resolvedToleranceMs = static_cast<int64_t>(offsetTolerance_ * 1000.0);
+
+    // step1 add/update candidate using actual time offsets
+    for (size_t i = 0; i < querySignature.size(); ++i) {
+        const auto& queryPoint = querySignature[i];
+        ++queryPointprint;
+
+        const auto postings = queryPostings[i];
+        if (postings.first == postings.second) {
+            continue;
+        }
+        ++queryPointHitCount;
+
+        for (auto posting = postings.first; posting != postings.second; ++posting) {
+            ++stats_.postingHitCount;
+            const auto& resolved = resolvedSignatures_[posting->signatureIndex];
+            if (resolved.handle != SessionTable::kInvalidHandle) {
+                const auto offset = calculateActualOffset(
+                    queryPoint.timestamp, signatureViews_[posting->signatureIndex].timestamp(posting->pointIndex));
+                if (std::abs(static_cast<int64_t>(offset) - resolved.offsetMs) <= resolvedToleranceMs) {
+                    ++stats_.resolvedSkippedPostingCount;
+                    continue;
+                }
+            }
+            if (!passesCoarseVote(posting->signatureIndex)) {
+                ++stats_.coarsePrunedPostingCount;
+                continue;
+            }
+            processTargetHit(queryPoint, TargetSignatureInfo2{
+                &mediaItems[posting->signatureIndex],
+                &signatureViews_[posting->signatureIndex],
+                posting->signatureIndex,
+                posting->pointIndex,
+                catalogIdBase_ + posting->signatureIndex
+            });
         }
     }
-    std::cout << "rrr queryPointHitCount: " << queryPointHitCount << std::endl;
+    stats_.queryHitCount = queryPointHitCount;
+#ifdef ENABLED_DIAGNOSE
+    if (logEnabled(MatcherLogLevel::Verbose)) {
+        std::cout << "rrr queryPointHitCount: " << queryPointHitCount << std::endl;
+    }
+#endif
 
     // step1.5: 全局合并时间偏移在容错范围内的session
     // 注意：现在每个新session都会优先尝试与现有session合并，
@@ -463,9 +835,10 @@ void SignatureMatcher::processQuerySignature(
     // step2 evaluate candidate
     double currentTimestamp = querySignature.back().timestamp;
     matchResults_.clear();
-    expiredCandidateSessionKeys_.clear();
+    matchDetections_.clear();
+    expiredSessions_.clear();
 
-    auto evaluateConfidenceFunc = [this](const MatchingCandidate& candidate) -> double {
+    auto evaluateConfidenceFunc = [this](const SessionRecord& candidate) -> double {
         double confidence = 0.0;
         // 计算置信度
         if (candidate.matchCount >= minMatchesRequired_) {
@@ -484,20 +857,20 @@ void SignatureMatcher::processQuerySignature(
         return confidence;
     };
     
-    // 输出session2CandidateMap_中match count最大的100个对象的match count
-    if (!session2CandidateMap_.empty()) {
+#ifdef ENABLED_DIAGNOSE
+    // 输出match count最大的100个session的match count
+    if (!sessions_.empty() && logEnabled(MatcherLogLevel::Verbose)) {
         // 创建一个包含所有候选项的向量
-        std::vector<std::pair<CandidateSessionKey, MatchingCandidate>> candidates;
-        for (const auto& pair : session2CandidateMap_) {
-            candidates.push_back(pair);
-
-            std::vector<DebugMatchInfo> matchInfos;
-        }
+        std::vector<SessionTable::Handle> candidates;
+        candidates.reserve(sessions_.size());
+        sessions_.forEach([&](SessionTable::Handle handle, const SessionRecord&) {
+            candidates.push_back(handle);
+        });
         
         // 按match count降序排序
         std::sort(candidates.begin(), candidates.end(), 
-            [](const auto& a, const auto& b) {
-                return a.second.matchCount > b.second.matchCount;
+            [this](SessionTable::Handle a, SessionTable::Handle b) {
+                return sessions_.at(a).matchCount > sessions_.at(b).matchCount;
             });
         
         // 只输出前100个或全部（如果少于100个）
@@ -505,29 +878,31 @@ void SignatureMatcher::processQuerySignature(
         std::cout << "Top " << outputCount << " candidates by match count:" << std::endl;
         
         for (size_t i = 0; i < outputCount; ++i) {
-            const auto& [key, candidate] = candidates[i];
+            const auto& candidate = sessions_.at(candidates[i]);
             double sessionScore = calculateSessionScore(candidate, currentTimestamp);
             std::cout << "  [" << i + 1 << "] MediaItem: " 
-                      << candidate.targetSignatureInfo->mediaItem->title()
-                      << ", Offset: " << key.offset
+                      << candidate.mediaItem->title()
+                      << ", Offset: " << candidate.key.offset
                       << ", MatchCount: " << candidate.matchCount
                       << ", uniqueTimestampCount: " << candidate.uniqueTimestampCount
                       << ", MaxPossible: " << candidate.maxPossibleMatches
                       << ", Confidence: " << evaluateConfidenceFunc(candidate)
                       << ", Score: " << std::fixed << std::setprecision(4) << sessionScore
                       << ", LastMatchTime: " << candidate.lastMatchTime
-                      << ", sessionKey: " << hash_seesion_key_func(key)
+                      << ", sessionKey: " << hash_seesion_key_func(candidate.key)
                       << ", averageOffset: " << candidate.actualOffsetSum / candidate.offsetCount
                       << std::endl;
         }
-        auto duplicateMatchInfosOfCandidates = findDuplicateHashes(candidates);
-        int i = 0;
+        if (collectVisualizationData_) {
+            auto duplicateMatchInfosOfCandidates = findDuplicateHashes(candidates);
+        }
     }
+#endif
 
     
 
 
-    for (const auto& [sessionKey, candidate] : session2CandidateMap_) {
+    sessions_.forEach([&](SessionTable::Handle handle, SessionRecord& candidate) {
 
         if (candidate.isMatchCountChanged && !candidate.isNotified) {
             const auto confidence = evaluateConfidenceFunc(candidate);
@@ -538,191 +913,701 @@ void SignatureMatcher::processQuerySignature(
                     // 计算平均偏移
                     double averageOffset = candidate.actualOffsetSum / candidate.offsetCount;
 
-                    std::vector<SignaturePoint> matchedPoints;
-                    for (const auto& matchInfo : candidate.matchInfos) {
-                        matchedPoints.push_back(matchInfo.sourcePoint);
-                    }
-                    
-                    auto matchResult = MatchResult{
-                        .mediaItem = candidate.targetSignatureInfo->mediaItem,
+                    // 已通知的session不再累积匹配明细，命中下标直接移交给结果，不拷贝
+                    auto pointIndices = std::make_shared<const std::vector<uint32_t>>(
+                        std::move(sessionMatchedPoints_[handle]));
+                    sessionMatchedPoints_[handle].clear();
+
+                    const auto target = signatureOf(candidate.key.signatureId);
+                    matchResults_.push_back(MatchResult{
+                        .mediaItem = candidate.mediaItem,
                         .offset = averageOffset,  // 使用平均偏移（秒）
                         .confidence = confidence,
-                        .matchedPoints = matchedPoints,
+                        .matchedPoints = {},
                         .matchCount = candidate.matchCount,
                         .uniqueTimestampMatchCount = candidate.uniqueTimestampCount,
                         .id = 0,
-                    };
-                    matchResults_.push_back(matchResult);
-                    session2CandidateMap_[sessionKey].isNotified = true;
+                        .targetCatalog = target.first,
+                        .targetSignatureIndex = target.second,
+                        .matchedPointIndices = std::move(pointIndices),
+                    });
+                    if (materializeMatchedPoints_) {
+                        auto& matchResult = matchResults_.back();
+                        matchResult.matchedPoints = matchResult.expandMatchedPoints();
+                    }
+                    matchDetections_.push_back(MatchDetection{candidate.firstMatchTime, candidate.firstHitNanos});
+                    candidate.isNotified = true;
+                    markSignatureResolved(handle);
+                    trace(kSessionNotifyTraceEvent, static_cast<uint32_t>(candidate.matchCount), averageOffset, confidence);
                     
-                    std::cout << "Match accepted: matchCount=" << candidate.matchCount 
-                              << ", uniqueTimestamps=" << candidate.uniqueTimestampCount 
-                              << ", confidence=" << confidence << std::endl;
+                    if (logEnabled(MatcherLogLevel::Info)) {
+                        std::cout << "Match accepted: matchCount=" << candidate.matchCount 
+                                  << ", uniqueTimestamps=" << candidate.uniqueTimestampCount 
+                                  << ", confidence=" << confidence << std::endl;
+                    }
                 } else {
-                    std::cout << "Match rejected due to insufficient unique timestamps: matchCount=" 
-                              << candidate.matchCount << ", uniqueTimestamps=" << candidate.uniqueTimestampCount 
-                              << ", required=" << minMatchesUniqueTimestampRequired_ << std::endl;
+#ifdef ENABLED_DIAGNOSE
+                    if (logEnabled(MatcherLogLevel::Verbose)) {
+                        std::cout << "Match rejected due to insufficient unique timestamps: matchCount=" 
+                                  << candidate.matchCount << ", uniqueTimestamps=" << candidate.uniqueTimestampCount 
+                                  << ", required=" << minMatchesUniqueTimestampRequired_ << std::endl;
+                    }
+#endif
                 }
             }
         }
+    });
+
+    // Setp4 remove expired candidate
+    // 只检查时间轮取出的session，未过期的（调度后又有命中）按最新的过期时间重新调度
+    expiryWheel_.collectDue(currentTimestamp, expiredSessions_);
+    size_t expiredCount = 0;
+    for (const auto handle : expiredSessions_) {
+        const auto deadline = sessions_.at(handle).lastMatchTime + matchExpireTime_;
+        if (deadline < currentTimestamp) {
+            expiredSessions_[expiredCount++] = handle;
+        } else {
+            expiryWheel_.schedule(handle, deadline);
+        }
+    }
+    expiredSessions_.resize(expiredCount);
+    // 按记录池下标顺序移除，与全量遍历时一致
+    std::sort(expiredSessions_.begin(), expiredSessions_.end());
+    for (const auto expiredSession : expiredSessions_) {
+        const auto& expired = sessions_.at(expiredSession);
+        trace(kSessionExpireTraceEvent, static_cast<uint32_t>(expired.matchCount), expired.key.offset, expired.lastMatchTime);
+        removeSession(expiredSession);
+    }
+
+    // 结构化统计，由processQuerySignature在通知结果后回调
+    stats_.timestamp = currentTimestamp;
+    stats_.expiredSessionCount = expiredSessions_.size();
+    stats_.notifiedMatchCount = matchResults_.size();
+    stats_.activeSessionCount = sessions_.size();
+
+    // 旧目录快照不再被任何session引用时释放
+    releaseRetiredCatalogs();
+}
+
+SessionTable::Handle SignatureMatcher::addSession(const SessionRecord& record) {
+    const auto handle = sessions_.insert(record);
+    if (handle != SessionTable::kInvalidHandle) {
+        indexSession(handle);
+        sessionMatchedPoints_[handle].clear();
+        sessionMatchInfos_[handle].clear();
+        markSessionScoreChanged(handle);
+        expiryWheel_.schedule(handle, record.lastMatchTime + matchExpireTime_);
+    }
+    return handle;
+}
+
+void SignatureMatcher::removeSession(SessionTable::Handle handle) {
+    unindexSession(handle);
+    // 保留明细向量的容量，记录池位置复用时不再重新分配
+    sessionMatchedPoints_[handle].clear();
+    sessionMatchInfos_[handle].clear();
+    // 使堆中该session的条目失效
+    ++sessionVersions_[handle];
+    expiryWheel_.cancel(handle);
+    const auto signatureIndex = signatureIndexOf(sessions_.at(handle).key.signatureId);
+    if (signatureIndex < resolvedSignatures_.size() && resolvedSignatures_[signatureIndex].handle == handle) {
+        resolvedSignatures_[signatureIndex].handle = SessionTable::kInvalidHandle;
+    }
+    sessions_.erase(handle);
+}
+
+void SignatureMatcher::indexSession(SessionTable::Handle handle) {
+    auto& handles = signatureSessions_[sessions_.at(handle).key.signatureId];
+    handles.insert(std::lower_bound(handles.begin(), handles.end(), handle), handle);
+}
+
+void SignatureMatcher::unindexSession(SessionTable::Handle handle) {
+    auto it = signatureSessions_.find(sessions_.at(handle).key.signatureId);
+    if (it == signatureSessions_.end()) {
+        return;
+    }
+    auto& handles = it->second;
+    auto pos = std::lower_bound(handles.begin(), handles.end(), handle);
+    if (pos != handles.end() && *pos == handle) {
+        handles.erase(pos);
+    }
+    if (handles.empty()) {
+        signatureSessions_.erase(it);
+    }
+}
+
+size_t SignatureMatcher::sessionCountOf(SignatureId signatureId) const {
+    auto it = signatureSessions_.find(signatureId);
+    return it != signatureSessions_.end() ? it->second.size() : 0;
+}
+
+void SignatureMatcher::setMatchThreads(size_t threads) {
+    shards_.clear();
+    shardRunner_.reset();
+    if (threads <= 1) {
+        return;
+    }
+    shards_.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        auto shard = std::make_unique<SignatureMatcher>(catalog_, config_, index_);
+        shard->setLogLevel(logLevel_);
+        shard->setTraceRing(trace_);
+        shards_.push_back(std::move(shard));
+    }
+    partitionShardIndexes();
+    shardRunner_ = std::make_unique<ChannelTaskRunner>(threads - 1);
+}
+
+void SignatureMatcher::partitionShardIndexes() {
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        shards_[i]->shardPostingIndex_ = CatalogIndex::partition(signatureViews_, *index_, i, shards_.size());
+    }
+}
+
+void SignatureMatcher::reset() {
+    for (const auto& shard : shards_) {
+        shard->reset();
+    }
+    expiredSessions_.clear();
+    sessions_.forEach([this](SessionTable::Handle handle, const SessionRecord&) {
+        expiredSessions_.push_back(handle);
+    });
+    for (const auto handle : expiredSessions_) {
+        removeSession(handle);
+    }
+    expiredSessions_.clear();
+
+    for (const auto& entry : mergeOrder_) {
+        inMergeOrder_[entry.handle] = 0;
+    }
+    mergeOrder_.clear();
+
+    for (const auto handle : dirtyScoreSessions_) {
+        sessionScoreDirty_[handle] = 0;
+    }
+    dirtyScoreSessions_.clear();
+    globalScoreHeap_.clear();
+    signatureScoreHeaps_.clear();
+    scoreHeapsValid_ = false;
+
+    expiryWheel_.clear();
+    signatureSessions_.clear();
+    retiredCatalogs_.clear();
+    allSessionsHistory_.clear();
+    historyMatchCount_ = 0;
+    historyTrimAt_ = 0;
+    peakSampler_.reset();
+    pointSampler_.reset();
+    stats_ = MatchStats{};
+}
+
+void SignatureMatcher::saveState(StateWriter& writer) const {
+    writer.writeVarint(sessions_.capacity());
+    writer.writeDouble(matchExpireTime_);
+    writer.writeVarint(shards_.size());
+
+    // 第一次被命中的时刻按相对现在的时长保存，恢复时换算到新进程的时钟上
+    const uint64_t now = TraceRing::now();
+    size_t sessionCount = 0;
+    sessions_.forEach([&](SessionTable::Handle, const SessionRecord& candidate) {
+        sessionCount += signatureIndexOf(candidate.key.signatureId) != SIZE_MAX ? 1 : 0;
+    });
+    writer.writeVarint(sessionCount);
+    sessions_.forEach([&](SessionTable::Handle handle, const SessionRecord& candidate) {
+        const size_t signatureIndex = signatureIndexOf(candidate.key.signatureId);
+        if (signatureIndex == SIZE_MAX) {
+            return;
+        }
+        writer.writeVarint(handle);
+        writer.writeVarint(signatureIndex);
+        writer.writeVarint(signatureViews_[signatureIndex].size());
+        writer.writeSigned(candidate.key.offset);
+        writer.writeVarint(candidate.maxPossibleMatches);
+        writer.writeVarint(candidate.matchCount);
+        writer.writeVarint(candidate.uniqueTimestampCount);
+        writer.writeVarint(candidate.offsetCount);
+        writer.writeSigned(candidate.actualOffsetSum);
+        writer.writeDouble(candidate.offsetSquareSum);
+        writer.writeDouble(candidate.lastMatchTime);
+        writer.writeDouble(candidate.firstMatchTime);
+        writer.writeVarint(now > candidate.firstHitNanos ? now - candidate.firstHitNanos : 0);
+        candidate.timestamps.saveState(writer);
+        writer.writeBool(candidate.isMatchCountChanged);
+        writer.writeBool(candidate.isNotified);
+
+        const auto& matchedPoints = sessionMatchedPoints_[handle];
+        writer.writeVarint(matchedPoints.size());
+        for (const auto pointIndex : matchedPoints) {
+            writer.writeVarint(pointIndex);
+        }
+    });
+
+    // 空闲记录池位置的顺序决定之后新session的handle，淘汰和合并在分数相同时按handle取舍
+    const auto& freeHandles = sessions_.freeHandles();
+    writer.writeVarint(freeHandles.size());
+    for (const auto handle : freeHandles) {
+        writer.writeVarint(handle);
+    }
+    expiryWheel_.saveState(writer);
+
+    size_t resolvedCount = 0;
+    for (const auto& resolved : resolvedSignatures_) {
+        resolvedCount += resolved.handle != SessionTable::kInvalidHandle ? 1 : 0;
+    }
+    writer.writeVarint(resolvedCount);
+    for (size_t signatureIndex = 0; signatureIndex < resolvedSignatures_.size(); ++signatureIndex) {
+        const auto& resolved = resolvedSignatures_[signatureIndex];
+        if (resolved.handle != SessionTable::kInvalidHandle) {
+            writer.writeVarint(signatureIndex);
+            writer.writeVarint(resolved.handle);
+            writer.writeSigned(resolved.offsetMs);
+        }
+    }
+
+    for (const auto& shard : shards_) {
+        shard->saveState(writer);
+    }
+}
+
+bool SignatureMatcher::restoreState(StateReader& reader) {
+    reset();
+    const size_t capacity = sessions_.capacity();
+    if (reader.readVarint() != capacity || reader.readDouble() != matchExpireTime_ ||
+        reader.readVarint() != shards_.size()) {
+        return false;
+    }
+
+    const uint64_t now = TraceRing::now();
+    const auto& signatures = signatureViews_;
+    const auto& mediaItems = catalog_->mediaItems();
+    size_t droppedCount = 0;
+    const size_t sessionCount = reader.readCount(capacity);
+    for (size_t i = 0; i < sessionCount && reader.ok(); ++i) {
+        const auto handle = static_cast<SessionTable::Handle>(reader.readCount(capacity - 1));
+        const size_t signatureIndex = reader.readVarint();
+        const size_t signatureSize = reader.readVarint();
+
+        SessionRecord record{};
+        record.key.offset = static_cast<int32_t>(reader.readSigned());
+        record.maxPossibleMatches = static_cast<uint32_t>(reader.readVarint());
+        record.matchCount = static_cast<uint32_t>(reader.readVarint());
+        record.uniqueTimestampCount = static_cast<uint32_t>(reader.readVarint());
+        record.offsetCount = static_cast<uint32_t>(reader.readVarint());
+        record.actualOffsetSum = reader.readSigned();
+        record.offsetSquareSum = reader.readDouble();
+        record.lastMatchTime = reader.readDouble();
+        record.firstMatchTime = reader.readDouble();
+        const uint64_t firstHitAge = reader.readVarint();
+        record.firstHitNanos = now > firstHitAge ? now - firstHitAge : 0;
+        record.timestamps.restoreState(reader);
+        record.isMatchCountChanged = reader.readBool();
+        record.isNotified = reader.readBool();
+
+        std::vector<uint32_t> matchedPoints(reader.readCount(reader.remaining()));
+        for (auto& pointIndex : matchedPoints) {
+            pointIndex = static_cast<uint32_t>(reader.readVarint());
+        }
+        if (!reader.ok()) {
+            break;
+        }
+
+        // 目标指纹按下标对应到本匹配器的catalog，点数不同说明不是同一份指纹
+        if (signatureIndex >= signatures.size() || signatures[signatureIndex].size() != signatureSize) {
+            ++droppedCount;
+            continue;
+        }
+        for (const auto pointIndex : matchedPoints) {
+            if (pointIndex >= signatureSize) {
+                reader.fail();
+            }
+        }
+        record.key.signatureId = static_cast<SignatureId>(catalogIdBase_ + signatureIndex);
+        record.mediaItem = &mediaItems[signatureIndex];
+        if (!reader.ok() || !sessions_.insertAt(handle, record)) {
+            reader.fail();
+            break;
+        }
+        indexSession(handle);
+        sessionMatchedPoints_[handle] = std::move(matchedPoints);
+    }
+
+    std::vector<SessionTable::Handle> freeOrder(reader.readCount(capacity));
+    for (auto& handle : freeOrder) {
+        handle = static_cast<SessionTable::Handle>(reader.readCount(capacity - 1));
+    }
+    sessions_.restoreFreeOrder(freeOrder);
+
+    // 被丢弃的session不放回时间轮；每个session都必须在时间轮中，否则永远不会过期
+    expiryWheel_.restoreState(reader, [this](SessionTable::Handle handle) { return sessions_.contains(handle); });
+    if (expiryWheel_.size() != sessions_.size()) {
+        reader.fail();
+    }
 
+    const size_t resolvedCount = reader.readCount(reader.remaining());
+    for (size_t i = 0; i < resolvedCount && reader.ok(); ++i) {
+        const size_t signatureIndex = reader.readVarint();
+        const auto handle = static_cast<SessionTable::Handle>(reader.readCount(capacity - 1));
+        const auto offsetMs = static_cast<int32_t>(reader.readSigned());
+        if (reader.ok() && sessions_.contains(handle) && signatureIndexOf(sessions_.at(handle).key.signatureId) == signatureIndex) {
+            resolvedSignatures_[signatureIndex] = ResolvedSignature{handle, offsetMs};
+        }
+    }
 
-        if (candidate.lastMatchTime + matchExpireTime_ < currentTimestamp) {
-            expiredCandidateSessionKeys_.push_back(sessionKey);
+    for (const auto& shard : shards_) {
+        if (!reader.ok() || !shard->restoreState(reader)) {
+            reader.fail();
         }
     }
 
-    // Setp3 notify match result
-    for (const auto& matchResult : matchResults_) {
-        matchNotifyCallback_(matchResult);
+    if (!reader.ok()) {
+        reset();
+        return false;
+    }
+    if (logEnabled(MatcherLogLevel::Info)) {
+        std::cout << "已恢复session状态: session数量 " << sessions_.size()
+                  << ", 目标指纹不在当前catalog中而丢弃的session数量 " << droppedCount << std::endl;
     }
+    return true;
+}
 
+void SignatureMatcher::addMemoryUsage(MatcherMemoryUsage& usage) const {
+    usage.queryBufferBytes += heapBytes(queryPostings_) + heapBytes(sortedQueryKeys_) + heapBytes(uniqueQueryHashes_) +
+                              heapBytes(uniqueQueryPostings_) + coarseVoteFilter_.memoryUsage();
 
-    // Setp4 remove expired candidate
-    for (const auto& expiredCandidateSessionKey : expiredCandidateSessionKeys_) {
-        session2CandidateMap_.erase(expiredCandidateSessionKey);
-        signature2SessionCnt_[expiredCandidateSessionKey.signature] -= 1;
+    usage.sessionCount += sessions_.size();
+    size_t sessionBytes = sessions_.memoryUsage() + heapBytes(sessionMatchedPoints_) + heapBytes(sessionMatchInfos_) +
+                          heapBytes(mergeOrder_) + heapBytes(inMergeOrder_) + heapBytes(mergeRemoved_) +
+                          globalScoreHeap_.memoryUsage() + heapBytes(signatureScoreHeaps_) +
+                          heapBytes(sessionVersions_) + heapBytes(sessionScoreDirty_) + heapBytes(dirtyScoreSessions_) +
+                          expiryWheel_.memoryUsage() + heapBytes(expiredSessions_) + heapBytes(resolvedSignatures_) +
+                          heapBytes(signatureSessions_) + heapBytes(retiredCatalogs_);
+    for (const auto& matchedPoints : sessionMatchedPoints_) {
+        sessionBytes += heapBytes(matchedPoints);
+    }
+    for (const auto& [signatureId, handles] : signatureSessions_) {
+        sessionBytes += heapBytes(handles);
+    }
+    for (const auto& [signatureId, heap] : signatureScoreHeaps_) {
+        sessionBytes += heap.memoryUsage();
+    }
+    usage.sessionBytes += sessionBytes;
+
+    // 匹配明细的数组、历史表的节点和桶由计数分配器记录，历史表的键和可视化数据按容量计
+    size_t historyBytes = historyMemory_.bytes() + heapBytes(visualizationData_.allPeaks) +
+                          heapBytes(visualizationData_.fingerprintPoints) + heapBytes(visualizationData_.matchedPoints);
+    for (const auto& [sessionId, matchInfos] : allSessionsHistory_) {
+        historyBytes += heapBytes(sessionId);
+    }
+    usage.historyBytes += historyBytes;
+    usage.historyPeakBytes += historyMemory_.peakBytes();
+
+    size_t resultBytes = heapBytes(matchResults_) + heapBytes(matchDetections_);
+    for (const auto& result : matchResults_) {
+        resultBytes += heapBytes(result.matchedPoints);
+    }
+    usage.resultBytes += resultBytes;
+
+    if (shardPostingIndex_) {
+        usage.shardIndexBytes += shardPostingIndex_->memoryUsage().totalBytes();
+    }
+    for (const auto& shard : shards_) {
+        shard->addMemoryUsage(usage);
+    }
+}
+
+size_t SignatureMatcher::signatureIndexOf(SignatureId signatureId) const {
+    if (signatureId < catalogIdBase_ || signatureId - catalogIdBase_ >= catalog_->signatureCount()) {
+        return SIZE_MAX;
+    }
+    return signatureId - catalogIdBase_;
+}
+
+std::pair<const ICatalog*, size_t> SignatureMatcher::signatureOf(SignatureId signatureId) const {
+    const auto signatureIndex = signatureIndexOf(signatureId);
+    if (signatureIndex != SIZE_MAX) {
+        return {catalog_.get(), signatureIndex};
+    }
+    for (const auto& retired : retiredCatalogs_) {
+        if (signatureId >= retired.idBase && signatureId - retired.idBase < retired.catalog->signatureCount()) {
+            return {retired.catalog.get(), static_cast<size_t>(signatureId - retired.idBase)};
+        }
+    }
+    // session只会引用当前catalog或保留的旧快照
+    throw std::out_of_range("signature id不属于任何目录快照");
+}
+
+void SignatureMatcher::markSignatureResolved(SessionTable::Handle handle) {
+    const auto& candidate = sessions_.at(handle);
+    const auto signatureIndex = signatureIndexOf(candidate.key.signatureId);
+    if (signatureIndex >= resolvedSignatures_.size() || candidate.offsetCount == 0) {
+        return;
+    }
+    const double averageOffset = static_cast<double>(candidate.actualOffsetSum) / candidate.offsetCount;
+    resolvedSignatures_[signatureIndex] = ResolvedSignature{handle, static_cast<int32_t>(std::llround(averageOffset))};
+}
+
+void SignatureMatcher::rebuildResolvedSignatures() {
+    resolvedSignatures_.assign(catalog_->signatureCount(), ResolvedSignature{SessionTable::kInvalidHandle, 0});
+    sessions_.forEach([this](SessionTable::Handle handle, const SessionRecord& candidate) {
+        if (candidate.isNotified) {
+            markSignatureResolved(handle);
+        }
+    });
+}
+
+void SignatureMatcher::markSessionScoreChanged(SessionTable::Handle handle) {
+    if (!scoreHeapsValid_ || sessionScoreDirty_[handle]) {
+        return;
     }
+    sessionScoreDirty_[handle] = 1;
+    dirtyScoreSessions_.push_back(handle);
+}
+
+void SignatureMatcher::prepareScoreHeaps() {
+    // 过期条目超过有效条目时同样重建，避免堆无限增长
+    const bool tooManyStale = globalScoreHeap_.size() > 2 * sessions_.size() + 64;
+    if (scoreHeapsValid_ && !tooManyStale) {
+        for (const auto handle : dirtyScoreSessions_) {
+            sessionScoreDirty_[handle] = 0;
+            if (!sessions_.contains(handle)) {
+                continue;
+            }
+            const auto& candidate = sessions_.at(handle);
+            const auto version = ++sessionVersions_[handle];
+            // 不含活跃度的基础分，查询时再按最后匹配时间加上活跃度项
+            const double baseScore = combineSessionScore(candidate, 0.0);
+            globalScoreHeap_.push(baseScore, candidate.lastMatchTime, handle, version);
+            signatureScoreHeaps_[candidate.key.signatureId].push(baseScore, candidate.lastMatchTime, handle, version);
+        }
+        dirtyScoreSessions_.clear();
+        return;
+    }
+
+    for (const auto handle : dirtyScoreSessions_) {
+        sessionScoreDirty_[handle] = 0;
+    }
+    dirtyScoreSessions_.clear();
+
+    globalScoreHeap_.clear();
+    for (auto& entry : signatureScoreHeaps_) {
+        entry.second.clear();
+    }
+    sessions_.forEach([this](SessionTable::Handle handle, const SessionRecord& candidate) {
+        const double baseScore = combineSessionScore(candidate, 0.0);
+        globalScoreHeap_.append(baseScore, candidate.lastMatchTime, handle, sessionVersions_[handle]);
+        signatureScoreHeaps_[candidate.key.signatureId].append(baseScore, candidate.lastMatchTime, handle,
+                                                               sessionVersions_[handle]);
+    });
+    globalScoreHeap_.build();
+    for (auto it = signatureScoreHeaps_.begin(); it != signatureScoreHeaps_.end();) {
+        if (it->second.empty()) {
+            it = signatureScoreHeaps_.erase(it);
+        } else {
+            it->second.build();
+            ++it;
+        }
+    }
+    scoreHeapsValid_ = true;
 }
 
 // Merge sessions with similar time offsets within tolerance
 void SignatureMatcher::mergeSimilarSessions() {
-    if (session2CandidateMap_.empty()) {
+    if (sessions_.empty()) {
+        for (const auto& entry : mergeOrder_) {
+            inMergeOrder_[entry.handle] = 0;
+        }
+        mergeOrder_.clear();
         return;
     }
     
-    // 按signature分组，只在同一个signature内进行合并
-    std::unordered_map<const std::vector<SignaturePoint>*, std::vector<CandidateSessionKey>> signatureGroups;
+    // 维护按(signature, 平均偏移)排序的session顺序：去掉已移除的session，追加新的session
+    size_t kept = 0;
+    for (const auto& entry : mergeOrder_) {
+        if (sessions_.contains(entry.handle)) {
+            mergeOrder_[kept++] = entry;
+        } else {
+            inMergeOrder_[entry.handle] = 0;
+        }
+    }
+    mergeOrder_.resize(kept);
+    sessions_.forEach([this](SessionTable::Handle handle, const SessionRecord&) {
+        if (!inMergeOrder_[handle]) {
+            inMergeOrder_[handle] = 1;
+            mergeOrder_.push_back(MergeEntry{0, 0.0, handle});
+        }
+    });
+    
+    // 刷新排序键（记录池位置复用后signature可能改变）
+    for (auto& entry : mergeOrder_) {
+        const auto& candidate = sessions_.at(entry.handle);
+        entry.signatureId = candidate.key.signatureId;
+        entry.avgOffset = candidate.offsetCount > 0
+            ? static_cast<double>(candidate.actualOffsetSum) / candidate.offsetCount : 0.0;
+    }
     
-    for (const auto& [sessionKey, candidate] : session2CandidateMap_) {
-        signatureGroups[sessionKey.signature].push_back(sessionKey);
+    // 两次调用之间平均偏移变化很小，上次的顺序基本有序，插入排序接近线性
+    auto entryLess = [](const MergeEntry& a, const MergeEntry& b) {
+        if (a.signatureId != b.signatureId) {
+            return a.signatureId < b.signatureId;
+        }
+        if (a.avgOffset != b.avgOffset) {
+            return a.avgOffset < b.avgOffset;
+        }
+        return a.handle < b.handle;
+    };
+    for (size_t i = 1; i < mergeOrder_.size(); ++i) {
+        const MergeEntry entry = mergeOrder_[i];
+        size_t j = i;
+        while (j > 0 && entryLess(entry, mergeOrder_[j - 1])) {
+            mergeOrder_[j] = mergeOrder_[j - 1];
+            --j;
+        }
+        mergeOrder_[j] = entry;
     }
     
-    // 对每个signature组内的session进行合并
-    for (auto& [signature, sessionKeys] : signatureGroups) {
-        if (sessionKeys.size() <= 1) {
-            continue; // 只有一个session，无需合并
+    // 标记需要删除的session
+    mergeRemoved_.assign(mergeOrder_.size(), 0);
+    const double toleranceMs = offsetTolerance_ * 1000.0;
+    
+    // 相邻扫描：同一signature内按平均偏移从小到大，只需向后查看偏移差在容错范围内的session
+    size_t groupStart = 0;
+    size_t groupRemoved = 0;
+    for (size_t i = 0; i < mergeOrder_.size(); ++i) {
+        if (mergeOrder_[i].signatureId != mergeOrder_[groupStart].signatureId) {
+            groupStart = i;
+            groupRemoved = 0;
+        }
+        if (mergeRemoved_[i]) {
+            continue; // 已经被标记删除
         }
         
-        // 按平均偏移排序，便于查找相近的session
-        std::sort(sessionKeys.begin(), sessionKeys.end(), 
-            [this](const CandidateSessionKey& a, const CandidateSessionKey& b) {
-                const auto& candidateA = session2CandidateMap_[a];
-                const auto& candidateB = session2CandidateMap_[b];
-                
-                // 添加安全检查，防止除零错误
-                if (candidateA.offsetCount == 0 || candidateB.offsetCount == 0) {
-                    std::cerr << "Warning: offsetCount is zero in mergeSimilarSessions!" << std::endl;
-                    return false;
-                }
-                
-                double avgOffsetA = static_cast<double>(candidateA.actualOffsetSum) / candidateA.offsetCount;
-                double avgOffsetB = static_cast<double>(candidateB.actualOffsetSum) / candidateB.offsetCount;
-                return avgOffsetA < avgOffsetB;
-            });
+        auto& primaryCandidate = sessions_.at(mergeOrder_[i].handle);
         
-        // 标记需要删除的session
-        std::vector<CandidateSessionKey> sessionsToRemove;
+        // 添加安全检查
+        if (primaryCandidate.offsetCount == 0) {
+            std::cerr << "Warning: Primary candidate offsetCount is zero!" << std::endl;
+            continue;
+        }
         
-        // 从第一个session开始，查找可以合并的session
-        for (size_t i = 0; i < sessionKeys.size(); ++i) {
-            if (std::find(sessionsToRemove.begin(), sessionsToRemove.end(), sessionKeys[i]) != sessionsToRemove.end()) {
+        const double primaryAvgOffset = mergeOrder_[i].avgOffset;
+        
+        // 查找可以与当前session合并的其他session
+        for (size_t j = i + 1; j < mergeOrder_.size() && mergeOrder_[j].signatureId == mergeOrder_[i].signatureId; ++j) {
+            const double secondaryAvgOffset = mergeOrder_[j].avgOffset;
+            
+            // 检查两个session的平均偏移是否在容错范围内，之后的session偏移更大，无需继续查找
+            if (secondaryAvgOffset - primaryAvgOffset > toleranceMs) {
+                break;
+            }
+            if (mergeRemoved_[j]) {
                 continue; // 已经被标记删除
             }
             
-            auto& primaryCandidate = session2CandidateMap_[sessionKeys[i]];
+            const auto& secondaryCandidate = sessions_.at(mergeOrder_[j].handle);
             
             // 添加安全检查
-            if (primaryCandidate.offsetCount == 0) {
-                std::cerr << "Warning: Primary candidate offsetCount is zero!" << std::endl;
+            if (secondaryCandidate.offsetCount == 0) {
+                std::cerr << "Warning: Secondary candidate offsetCount is zero!" << std::endl;
                 continue;
             }
             
-            double primaryAvgOffset = static_cast<double>(primaryCandidate.actualOffsetSum) / primaryCandidate.offsetCount;
+            // 合并session前先验证数据合理性
+            int64_t newOffsetSum = primaryCandidate.actualOffsetSum + secondaryCandidate.actualOffsetSum;
+            uint32_t newOffsetCount = primaryCandidate.offsetCount + secondaryCandidate.offsetCount;
+#ifdef ENABLED_DIAGNOSE
+            double newAvgOffset = static_cast<double>(newOffsetSum) / newOffsetCount;
+#endif
             
             
-            // 查找可以与当前session合并的其他session
-            for (size_t j = i + 1; j < sessionKeys.size(); ++j) {
-                if (std::find(sessionsToRemove.begin(), sessionsToRemove.end(), sessionKeys[j]) != sessionsToRemove.end()) {
-                    continue; // 已经被标记删除
-                }
-                
-                auto& secondaryCandidate = session2CandidateMap_[sessionKeys[j]];
-                
-                // 添加安全检查
-                if (secondaryCandidate.offsetCount == 0) {
-                    std::cerr << "Warning: Secondary candidate offsetCount is zero!" << std::endl;
-                    continue;
-                }
-                
-                double secondaryAvgOffset = static_cast<double>(secondaryCandidate.actualOffsetSum) / secondaryCandidate.offsetCount;
-                
-                
-                // 检查两个session的平均偏移是否在容错范围内
-                double offsetDifference = std::abs(primaryAvgOffset - secondaryAvgOffset);
-                double toleranceMs = offsetTolerance_ * 1000.0;
-                
-                if (offsetDifference <= toleranceMs) {
-                    // 合并session前先验证数据合理性
-                    int64_t newOffsetSum = primaryCandidate.actualOffsetSum + secondaryCandidate.actualOffsetSum;
-                    size_t newOffsetCount = primaryCandidate.offsetCount + secondaryCandidate.offsetCount;
-                    double newAvgOffset = static_cast<double>(newOffsetSum) / newOffsetCount;
-                    
-                    
-                    // 合并session
-                    primaryCandidate.matchCount += secondaryCandidate.matchCount;
-                    primaryCandidate.actualOffsetSum = newOffsetSum;
-                    primaryCandidate.offsetCount = newOffsetCount;
-                    
-                    // 合并unique时间戳
-                    for (const auto& timestamp : secondaryCandidate.uniqueTimestamps) {
-                        primaryCandidate.uniqueTimestamps.insert(timestamp);
-                    }
-                    primaryCandidate.uniqueTimestampCount = primaryCandidate.uniqueTimestamps.size();
-                    
-                    // 合并匹配信息
-                    primaryCandidate.matchInfos.insert(
-                        primaryCandidate.matchInfos.end(),
-                        secondaryCandidate.matchInfos.begin(),
-                        secondaryCandidate.matchInfos.end()
-                    );
-                    
-                    // 更新最后匹配时间
-                    primaryCandidate.lastMatchTime = std::max(
-                        primaryCandidate.lastMatchTime, 
-                        secondaryCandidate.lastMatchTime
-                    );
-                    
-                    primaryCandidate.isMatchCountChanged = true;
-                    
-                    // 标记secondary session为删除
-                    sessionsToRemove.push_back(sessionKeys[j]);
-                    
-                    std::cout << "Merged sessions: primary avg offset = " << primaryAvgOffset 
-                              << "ms, secondary avg offset = " << secondaryAvgOffset 
-                              << "ms, new avg offset = " << newAvgOffset
-                              << "ms, new match count = " << primaryCandidate.matchCount 
-                              << ", new unique timestamp count = " << primaryCandidate.uniqueTimestampCount
-                              << ", tolerance = " << toleranceMs << "ms" << std::endl;
-                }
+            // 合并session
+            primaryCandidate.matchCount += secondaryCandidate.matchCount;
+            primaryCandidate.actualOffsetSum = newOffsetSum;
+            primaryCandidate.offsetSquareSum += secondaryCandidate.offsetSquareSum;
+            primaryCandidate.offsetCount = newOffsetCount;
+            
+            // 合并unique时间戳
+            primaryCandidate.uniqueTimestampCount += static_cast<uint32_t>(
+                primaryCandidate.timestamps.mergeFrom(secondaryCandidate.timestamps));
+            
+            // 合并匹配信息
+            auto& primaryMatchedPoints = sessionMatchedPoints_[mergeOrder_[i].handle];
+            const auto& secondaryMatchedPoints = sessionMatchedPoints_[mergeOrder_[j].handle];
+            primaryMatchedPoints.insert(primaryMatchedPoints.end(), secondaryMatchedPoints.begin(), secondaryMatchedPoints.end());
+            auto& primaryMatchInfos = sessionMatchInfos_[mergeOrder_[i].handle];
+            const auto& secondaryMatchInfos = sessionMatchInfos_[mergeOrder_[j].handle];
+            primaryMatchInfos.insert(primaryMatchInfos.end(), secondaryMatchInfos.begin(), secondaryMatchInfos.end());
+            
+            // 更新最后匹配时间
+            primaryCandidate.lastMatchTime = std::max(
+                primaryCandidate.lastMatchTime, 
+                secondaryCandidate.lastMatchTime
+            );
+            primaryCandidate.firstMatchTime = std::min(primaryCandidate.firstMatchTime, secondaryCandidate.firstMatchTime);
+            primaryCandidate.firstHitNanos = std::min(primaryCandidate.firstHitNanos, secondaryCandidate.firstHitNanos);
+            
+            primaryCandidate.isMatchCountChanged = true;
+            markSessionScoreChanged(mergeOrder_[i].handle);
+            
+            // 标记secondary session为删除
+            mergeRemoved_[j] = 1;
+            ++groupRemoved;
+            ++stats_.mergedSessionCount;
+            trace(kSessionMergeTraceEvent, static_cast<uint32_t>(primaryCandidate.matchCount),
+                  primaryCandidate.key.offset, secondaryCandidate.key.offset);
+            
+#ifdef ENABLED_DIAGNOSE
+            if (logEnabled(MatcherLogLevel::Verbose)) {
+                std::cout << "Merged sessions: primary avg offset = " << primaryAvgOffset 
+                          << "ms, secondary avg offset = " << secondaryAvgOffset 
+                          << "ms, new avg offset = " << newAvgOffset
+                          << "ms, new match count = " << primaryCandidate.matchCount 
+                          << ", new unique timestamp count = " << primaryCandidate.uniqueTimestampCount
+                          << ", tolerance = " << toleranceMs << "ms" << std::endl;
             }
+#endif
         }
         
-        // 删除被合并的session
-        for (const auto& sessionKey : sessionsToRemove) {
-            signature2SessionCnt_[sessionKey.signature] -= 1;
-            session2CandidateMap_.erase(sessionKey);
+#ifdef ENABLED_DIAGNOSE
+        const bool groupEnds = i + 1 == mergeOrder_.size() || mergeOrder_[i + 1].signatureId != mergeOrder_[i].signatureId;
+        if (groupEnds && groupRemoved > 0 && logEnabled(MatcherLogLevel::Verbose)) {
+            std::cout << "Removed " << groupRemoved 
+                      << " merged sessions for signature " << mergeOrder_[i].signatureId << std::endl;
         }
-        
-        if (!sessionsToRemove.empty()) {
-            std::cout << "Removed " << sessionsToRemove.size() 
-                      << " merged sessions for signature " << signature << std::endl;
+#endif
+    }
+    
+    // 删除被合并的session，并从排序中去掉
+    kept = 0;
+    for (size_t i = 0; i < mergeOrder_.size(); ++i) {
+        if (mergeRemoved_[i]) {
+            inMergeOrder_[mergeOrder_[i].handle] = 0;
+            removeSession(mergeOrder_[i].handle);
+        } else {
+            mergeOrder_[kept++] = mergeOrder_[i];
         }
     }
+    mergeOrder_.resize(kept);
 }
 
 // 计算候选session的分数
-double SignatureMatcher::calculateSessionScore(const MatchingCandidate& candidate, double currentTimestamp) const {
+double SignatureMatcher::calculateSessionScore(const SessionRecord& candidate, double currentTimestamp) const {
+    return combineSessionScore(candidate, activityScoreOf(candidate.lastMatchTime, currentTimestamp));
+}
+
+double SignatureMatcher::activityScoreOf(double lastMatchTime, double currentTimestamp) const {
+    // 3. 活跃度分数 (0-1)：基于最后匹配时间的新鲜度
+    double activityScore = 0.0;
+    double timeSinceLastMatch = currentTimestamp - lastMatchTime;
+    if (timeSinceLastMatch >= 0) {
+        // 使用指数衰减函数，半衰期设为matchExpireTime的1/3
+        double halfLife = matchExpireTime_ / 3.0;
+        activityScore = std::exp(-timeSinceLastMatch * std::log(2.0) / halfLife);
+    }
+    return activityScore;
+}
+
+// 由活跃度分数和其余评分因子计算综合分数，activityScore越大分数越高
+double SignatureMatcher::combineSessionScore(const SessionRecord& candidate, double activityScore) const {
     // 计算各项评分因子
     
     // 1. 匹配密度分数 (0-1)：匹配数量与最大可能匹配数的比值
@@ -739,14 +1624,7 @@ double SignatureMatcher::calculateSessionScore(const MatchingCandidate& candidat
         matchCountScore = std::log(1.0 + normalizedCount) / std::log(101.0);
     }
     
-    // 3. 活跃度分数 (0-1)：基于最后匹配时间的新鲜度
-    double activityScore = 0.0;
-    double timeSinceLastMatch = currentTimestamp - candidate.lastMatchTime;
-    if (timeSinceLastMatch >= 0) {
-        // 使用指数衰减函数，半衰期设为matchExpireTime的1/3
-        double halfLife = matchExpireTime_ / 3.0;
-        activityScore = std::exp(-timeSinceLastMatch * std::log(2.0) / halfLife);
-    }
+    // 3. 活跃度分数 (0-1)：由calculateSessionScore按当前时间戳计算后传入
     
     // 4. 偏移一致性分数 (0-1)：偏移值的一致性越高分数越高
     double consistencyScore = 1.0;  // 默认满分
@@ -754,13 +1632,8 @@ double SignatureMatcher::calculateSessionScore(const MatchingCandidate& candidat
         // 计算平均偏移
         double avgOffset = static_cast<double>(candidate.actualOffsetSum) / candidate.offsetCount;
         
-        // 计算偏移的标准差（简化计算）
-        double variance = 0.0;
-        for (const auto& matchInfo : candidate.matchInfos) {
-            double diff = matchInfo.offset - avgOffset;
-            variance += diff * diff;
-        }
-        variance /= candidate.offsetCount;
+        // 由偏移的和与平方和计算方差：E[x^2] - E[x]^2
+        double variance = std::max(0.0, candidate.offsetSquareSum / candidate.offsetCount - avgOffset * avgOffset);
         double stdDev = std::sqrt(variance);
         
         // 将标准差转换为一致性分数 (标准差越小，一致性越高)
@@ -773,35 +1646,30 @@ double SignatureMatcher::calculateSessionScore(const MatchingCandidate& candidat
     // 权重分配：匹配密度35%，匹配数量25%，活跃度25%，一致性15%
     double totalScore = 0.1 * matchDensityScore + 
                        0.50 * matchCountScore + 
-                       0.35 * activityScore + 
+                       kActivityWeight * activityScore + 
                        0.05 * consistencyScore;
     
     return totalScore;
 }
 
 // 找到分数最低的session
-CandidateSessionKey SignatureMatcher::findLowestScoreSession(double currentTimestamp) const {
-    if (session2CandidateMap_.empty()) {
-        return CandidateSessionKey{0, nullptr};
-    }
-    
-    auto lowestIt = session2CandidateMap_.begin();
-    double lowestScore = calculateSessionScore(lowestIt->second, currentTimestamp);
-    
-    for (auto it = session2CandidateMap_.begin(); it != session2CandidateMap_.end(); ++it) {
-        double score = calculateSessionScore(it->second, currentTimestamp);
-        if (score < lowestScore) {
-            lowestScore = score;
-            lowestIt = it;
-        }
-    }
-    
-    return lowestIt->first;
+SessionTable::Handle SignatureMatcher::findLowestScoreSession(double currentTimestamp) {
+    prepareScoreHeaps();
+    return globalScoreHeap_.findLowest(
+        [this](SessionTable::Handle handle, uint32_t version) {
+            return sessions_.contains(handle) && sessionVersions_[handle] == version;
+        },
+        [this, currentTimestamp](SessionTable::Handle handle) {
+            return calculateSessionScore(sessions_.at(handle), currentTimestamp);
+        },
+        [this, currentTimestamp](double lastMatchTime) {
+            return kActivityWeight * activityScoreOf(lastMatchTime, currentTimestamp);
+        });
 }
 
 // 检查是否应该替换现有session
-bool SignatureMatcher::shouldReplaceSession(const MatchingCandidate& newCandidate, double currentTimestamp) const {
-    if (session2CandidateMap_.size() < maxCandidates_) {
+bool SignatureMatcher::shouldReplaceSession(const SessionRecord& newCandidate, double currentTimestamp) {
+    if (sessions_.size() < maxCandidates_) {
         return false; // 还有空间，不需要替换
     }
     
@@ -809,17 +1677,12 @@ bool SignatureMatcher::shouldReplaceSession(const MatchingCandidate& newCandidat
     double newScore = calculateSessionScore(newCandidate, currentTimestamp);
     
     // 找到分数最低的现有session
-    CandidateSessionKey lowestKey = findLowestScoreSession(currentTimestamp);
-    if (lowestKey.signature == nullptr) {
+    const auto lowestHandle = findLowestScoreSession(currentTimestamp);
+    if (lowestHandle == SessionTable::kInvalidHandle) {
         return false; // 没有找到有效的session
     }
     
-    auto lowestIt = session2CandidateMap_.find(lowestKey);
-    if (lowestIt == session2CandidateMap_.end()) {
-        return false; // session不存在
-    }
-    
-    double lowestScore = calculateSessionScore(lowestIt->second, currentTimestamp);
+    double lowestScore = calculateSessionScore(sessions_.at(lowestHandle), currentTimestamp);
     
     // 如果新候选的分数显著高于最低分的现有session，则替换
     // 添加一个小的阈值避免频繁替换
@@ -829,63 +1692,42 @@ bool SignatureMatcher::shouldReplaceSession(const MatchingCandidate& newCandidat
 }
 
 // 找到指定signature下分数最低的session
-CandidateSessionKey SignatureMatcher::findLowestScoreSessionInSignature(
-    const std::vector<SignaturePoint>* signature, double currentTimestamp) const {
+SessionTable::Handle SignatureMatcher::findLowestScoreSessionInSignature(
+    SignatureId signatureId, double currentTimestamp) {
     
-    if (session2CandidateMap_.empty()) {
-        return CandidateSessionKey{0, nullptr};
+    prepareScoreHeaps();
+    auto it = signatureScoreHeaps_.find(signatureId);
+    if (it == signatureScoreHeaps_.end()) {
+        return SessionTable::kInvalidHandle;
     }
-    
-    // 找到第一个属于指定signature的session作为初始比较对象
-    auto lowestIt = session2CandidateMap_.end();
-    for (auto it = session2CandidateMap_.begin(); it != session2CandidateMap_.end(); ++it) {
-        if (it->first.signature == signature) {
-            lowestIt = it;
-            break;
-        }
-    }
-    
-    if (lowestIt == session2CandidateMap_.end()) {
-        return CandidateSessionKey{0, nullptr}; // 没有找到属于该signature的session
-    }
-    
-    double lowestScore = calculateSessionScore(lowestIt->second, currentTimestamp);
-    
-    // 继续查找该signature下分数更低的session
-    for (auto it = session2CandidateMap_.begin(); it != session2CandidateMap_.end(); ++it) {
-        if (it->first.signature == signature) {
-            double score = calculateSessionScore(it->second, currentTimestamp);
-            if (score < lowestScore) {
-                lowestScore = score;
-                lowestIt = it;
-            }
-        }
-    }
-    
-    return lowestIt->first;
+    return it->second.findLowest(
+        [this](SessionTable::Handle handle, uint32_t version) {
+            return sessions_.contains(handle) && sessionVersions_[handle] == version;
+        },
+        [this, currentTimestamp](SessionTable::Handle handle) {
+            return calculateSessionScore(sessions_.at(handle), currentTimestamp);
+        },
+        [this, currentTimestamp](double lastMatchTime) {
+            return kActivityWeight * activityScoreOf(lastMatchTime, currentTimestamp);
+        });
 }
 
 // 检查是否应该替换同一signature下的现有session
 bool SignatureMatcher::shouldReplaceSessionInSignature(
-    const MatchingCandidate& newCandidate, 
-    const std::vector<SignaturePoint>* signature, 
-    double currentTimestamp) const {
+    const SessionRecord& newCandidate, 
+    SignatureId signatureId, 
+    double currentTimestamp) {
     
     // 计算新候选的分数
     double newScore = calculateSessionScore(newCandidate, currentTimestamp);
     
     // 找到该signature下分数最低的现有session
-    CandidateSessionKey lowestKey = findLowestScoreSessionInSignature(signature, currentTimestamp);
-    if (lowestKey.signature == nullptr) {
+    const auto lowestHandle = findLowestScoreSessionInSignature(signatureId, currentTimestamp);
+    if (lowestHandle == SessionTable::kInvalidHandle) {
         return false; // 没有找到有效的session
     }
     
-    auto lowestIt = session2CandidateMap_.find(lowestKey);
-    if (lowestIt == session2CandidateMap_.end()) {
-        return false; // session不存在
-    }
-    
-    double lowestScore = calculateSessionScore(lowestIt->second, currentTimestamp);
+    double lowestScore = calculateSessionScore(sessions_.at(lowestHandle), currentTimestamp);
     
     // 如果新候选的分数显著高于该signature下最低分的现有session，则替换
     // 使用相同的阈值避免频繁替换
@@ -910,13 +1752,7 @@ bool SignatureMatcher::saveVisualization(const std::string& filename) const {
     // 基于allSessionsHistory_重新生成matchedPoints
     for (const auto& [sessionId, matchInfos] : allSessionsHistory_) {
         for (const auto& matchInfo : matchInfos) {
-            // 解析hash字符串
-            uint32_t hash = 0;
-            if (matchInfo.hash.find("0x") != std::string::npos) {
-                std::stringstream ss;
-                ss << std::hex << matchInfo.hash.substr(matchInfo.hash.find("0x") + 2);
-                ss >> hash;
-            }
+            const uint32_t hash = matchInfo.hash;
             
             // 直接使用DebugMatchInfo中的信息，不需要手动查询
             // 使用sessionId的hash值作为session标识
@@ -951,21 +1787,21 @@ bool SignatureMatcher::saveSessionsData(const std::string& filename) const {
     std::vector<SessionData> topSessions;
     
     // Create a vector of all candidates for sorting
-    std::vector<std::pair<CandidateSessionKey, MatchingCandidate>> candidates;
-    for (const auto& pair : session2CandidateMap_) {
-        candidates.push_back(pair);
-    }
+    std::vector<const SessionRecord*> candidates;
+    sessions_.forEach([&](SessionTable::Handle, const SessionRecord& candidate) {
+        candidates.push_back(&candidate);
+    });
     
     // Sort by match count in descending order
     std::sort(candidates.begin(), candidates.end(), 
-        [](const auto& a, const auto& b) {
-            return a.second.matchCount > b.second.matchCount;
+        [](const SessionRecord* a, const SessionRecord* b) {
+            return a->matchCount > b->matchCount;
         });
     
     // Take top 3 sessions or fewer if less are available
     size_t sessionsToInclude = std::min(candidates.size(), size_t(5));
     for (size_t i = 0; i < sessionsToInclude; ++i) {
-        const auto& [key, candidate] = candidates[i];
+        const auto& candidate = *candidates[i];
         
         SessionData sessionData;
         sessionData.id = i + 1; // Use 1-based index for session ID
@@ -983,7 +1819,7 @@ bool SignatureMatcher::saveSessionsData(const std::string& filename) const {
         sessionData.confidence = confidence;
         
         // Extract media title
-        sessionData.mediaTitle = candidate.targetSignatureInfo->mediaItem->title();
+        sessionData.mediaTitle = candidate.mediaItem->title();
         
         topSessions.push_back(sessionData);
     }
@@ -1014,18 +1850,16 @@ bool SignatureMatcher::saveComparisonData(const VisualizationData& sourceData,
         std::vector<DebugMatchInfo> matchInfos;
         double lastMatchTime;
         size_t uniqueTimestampCount;
-        std::unordered_set<double> uniqueTimestamps;
         size_t maxPossibleMatches = 100; // 默认值，后续会从活跃session中更新
     };
     
     std::vector<SessionStats> allSessionStats;
     
-    // 首先建立sessionId到活跃MatchingCandidate的映射，用于补充媒体信息
-    std::unordered_map<std::string, const MatchingCandidate*> sessionIdToActiveCandidate;
-    for (const auto& [sessionKey, candidate] : session2CandidateMap_) {
-        std::string sessionId = generateSessionId(sessionKey);
-        sessionIdToActiveCandidate[sessionId] = &candidate;
-    }
+    // 首先建立sessionId到活跃session记录的映射，用于补充媒体信息
+    std::unordered_map<std::string, const SessionRecord*> sessionIdToActiveCandidate;
+    sessions_.forEach([&](SessionTable::Handle, const SessionRecord& candidate) {
+        sessionIdToActiveCandidate[generateSessionId(candidate.key)] = &candidate;
+    });
     
     // 从allSessionsHistory_中重建每个session的统计信息
     for (const auto& [sessionId, matchInfos] : allSessionsHistory_) {
@@ -1036,22 +1870,25 @@ bool SignatureMatcher::saveComparisonData(const VisualizationData& sourceData,
         SessionStats stats;
         stats.sessionId = sessionId;
         stats.matchCount = matchInfos.size();
-        stats.matchInfos = matchInfos;
+        stats.matchInfos.assign(matchInfos.begin(), matchInfos.end());
         stats.lastMatchTime = 0.0;
         
-        // 计算unique时间戳
+        // 计算unique时间戳，与匹配时相同按10ms量化后排序去重
+        std::vector<int64_t> quantizedTimestamps;
+        quantizedTimestamps.reserve(matchInfos.size());
         for (const auto& matchInfo : matchInfos) {
-            double roundedTime = std::round(matchInfo.queryTime * 100.0) / 100.0;
-            stats.uniqueTimestamps.insert(roundedTime);
+            quantizedTimestamps.push_back(TimestampWindow::quantize(matchInfo.queryTime));
             stats.lastMatchTime = std::max(stats.lastMatchTime, matchInfo.queryTime);
         }
-        stats.uniqueTimestampCount = stats.uniqueTimestamps.size();
+        std::sort(quantizedTimestamps.begin(), quantizedTimestamps.end());
+        stats.uniqueTimestampCount = static_cast<size_t>(
+            std::unique(quantizedTimestamps.begin(), quantizedTimestamps.end()) - quantizedTimestamps.begin());
         
         // 尝试从活跃候选中获取媒体信息
         auto activeIt = sessionIdToActiveCandidate.find(sessionId);
         if (activeIt != sessionIdToActiveCandidate.end()) {
             const auto* activeCandidate = activeIt->second;
-            stats.mediaTitle = activeCandidate->targetSignatureInfo->mediaItem->title();
+            stats.mediaTitle = activeCandidate->mediaItem->title();
             stats.maxPossibleMatches = activeCandidate->maxPossibleMatches;
             
             // 使用活跃候选的精确置信度计算
@@ -1112,13 +1949,7 @@ bool SignatureMatcher::saveComparisonData(const VisualizationData& sourceData,
         
         // 基于该session的匹配信息生成可视化点
         for (const auto& matchInfo : sessionStats.matchInfos) {
-            // 解析hash字符串
-            uint32_t hash = 0;
-            if (matchInfo.hash.find("0x") != std::string::npos) {
-                std::stringstream ss;
-                ss << std::hex << matchInfo.hash.substr(matchInfo.hash.find("0x") + 2);
-                ss >> hash;
-            }
+            const uint32_t hash = matchInfo.hash;
             
             // 直接使用DebugMatchInfo中的查询点信息生成查询数据匹配点
             sessionQueryData.matchedPoints.push_back(
@@ -1157,35 +1988,28 @@ bool SignatureMatcher::saveComparisonData(const VisualizationData& sourceData,
 }
 
 // 尝试将新的候选session与现有的同signature sessions合并
-CandidateSessionKey SignatureMatcher::tryMergeWithExistingSessions(
-    const CandidateSessionKey& newSessionKey, 
-    const MatchingCandidate& newCandidate) {
+SessionTable::Handle SignatureMatcher::tryMergeWithExistingSessions(const SessionRecord& newCandidate) {
     
     // 只在同一个signature内查找可合并的session
-    std::vector<CandidateSessionKey> candidateKeys;
-    for (const auto& [sessionKey, candidate] : session2CandidateMap_) {
-        if (sessionKey.signature == newSessionKey.signature) {
-            candidateKeys.push_back(sessionKey);
-        }
-    }
-    
-    if (candidateKeys.empty()) {
-        return CandidateSessionKey{0, nullptr}; // 没有同signature的session
+    auto sameSignature = signatureSessions_.find(newCandidate.key.signatureId);
+    if (sameSignature == signatureSessions_.end()) {
+        return SessionTable::kInvalidHandle; // 没有同signature的session
     }
     
     // 计算新session的平均偏移
     if (newCandidate.offsetCount == 0) {
         std::cerr << "Warning: New candidate offsetCount is zero!" << std::endl;
-        return CandidateSessionKey{0, nullptr};
+        return SessionTable::kInvalidHandle;
     }
     
     double newAvgOffset = static_cast<double>(newCandidate.actualOffsetSum) / newCandidate.offsetCount;
     
     double toleranceMs = offsetTolerance_ * 1000.0;
     
-    // 查找可以合并的现有session
-    for (const auto& existingKey : candidateKeys) {
-        auto& existingCandidate = session2CandidateMap_[existingKey];
+    // 查找可以合并的现有session，取记录池中第一个满足条件的session（同signature的session按handle升序排列）
+    auto mergedHandle = SessionTable::kInvalidHandle;
+    for (const auto handle : sameSignature->second) {
+        const auto& existingCandidate = sessions_.at(handle);
         
         // 安全检查
         if (existingCandidate.offsetCount == 0) {
@@ -1196,59 +2020,67 @@ CandidateSessionKey SignatureMatcher::tryMergeWithExistingSessions(
         double existingAvgOffset = static_cast<double>(existingCandidate.actualOffsetSum) / existingCandidate.offsetCount;
         
         // 检查两个session的平均偏移是否在容错范围内
-        double offsetDifference = std::abs(newAvgOffset - existingAvgOffset);
-        
-        if (offsetDifference <= toleranceMs) {
-            // 可以合并，先验证合并后的数据合理性
-            int64_t mergedOffsetSum = existingCandidate.actualOffsetSum + newCandidate.actualOffsetSum;
-            size_t mergedOffsetCount = existingCandidate.offsetCount + newCandidate.offsetCount;
-            double mergedAvgOffset = static_cast<double>(mergedOffsetSum) / mergedOffsetCount;
-            
-            // 执行合并
-            existingCandidate.matchCount += newCandidate.matchCount;
-            existingCandidate.actualOffsetSum = mergedOffsetSum;
-            existingCandidate.offsetCount = mergedOffsetCount;
-            
-            // 合并unique时间戳
-            for (const auto& timestamp : newCandidate.uniqueTimestamps) {
-                existingCandidate.uniqueTimestamps.insert(timestamp);
-            }
-            existingCandidate.uniqueTimestampCount = existingCandidate.uniqueTimestamps.size();
-            
-            // 合并匹配信息
-            existingCandidate.matchInfos.insert(
-                existingCandidate.matchInfos.end(),
-                newCandidate.matchInfos.begin(),
-                newCandidate.matchInfos.end()
-            );
-            
-            // 更新最后匹配时间
-            existingCandidate.lastMatchTime = std::max(
-                existingCandidate.lastMatchTime, 
-                newCandidate.lastMatchTime
-            );
-            
-            existingCandidate.isMatchCountChanged = true;
-            
-            std::cout << "Merged new session into existing: new avg offset = " << newAvgOffset 
-                      << "ms, existing avg offset = " << existingAvgOffset 
-                      << "ms, merged avg offset = " << mergedAvgOffset
-                      << "ms, merged match count = " << existingCandidate.matchCount 
-                      << ", new unique timestamp count = " << existingCandidate.uniqueTimestampCount
-                      << ", tolerance = " << toleranceMs << "ms" << std::endl;
-            
-            return existingKey; // 返回被合并到的session key
+        if (std::abs(newAvgOffset - existingAvgOffset) <= toleranceMs) {
+            mergedHandle = handle;
+            break;
         }
     }
     
-    return CandidateSessionKey{0, nullptr}; // 没有找到可合并的session
+    if (mergedHandle == SessionTable::kInvalidHandle) {
+        return SessionTable::kInvalidHandle; // 没有找到可合并的session
+    }
+    
+    auto& existingCandidate = sessions_.at(mergedHandle);
+#ifdef ENABLED_DIAGNOSE
+    double existingAvgOffset = static_cast<double>(existingCandidate.actualOffsetSum) / existingCandidate.offsetCount;
+#endif
+    
+    // 可以合并，先验证合并后的数据合理性
+    int64_t mergedOffsetSum = existingCandidate.actualOffsetSum + newCandidate.actualOffsetSum;
+    uint32_t mergedOffsetCount = existingCandidate.offsetCount + newCandidate.offsetCount;
+#ifdef ENABLED_DIAGNOSE
+    double mergedAvgOffset = static_cast<double>(mergedOffsetSum) / mergedOffsetCount;
+#endif
+    
+    // 执行合并
+    existingCandidate.matchCount += newCandidate.matchCount;
+    existingCandidate.actualOffsetSum = mergedOffsetSum;
+    existingCandidate.offsetSquareSum += newCandidate.offsetSquareSum;
+    existingCandidate.offsetCount = mergedOffsetCount;
+    
+    // 合并unique时间戳
+    existingCandidate.uniqueTimestampCount += static_cast<uint32_t>(
+        existingCandidate.timestamps.mergeFrom(newCandidate.timestamps));
+    
+    // 更新最后匹配时间
+    existingCandidate.lastMatchTime = std::max(
+        existingCandidate.lastMatchTime, 
+        newCandidate.lastMatchTime
+    );
+    existingCandidate.firstMatchTime = std::min(existingCandidate.firstMatchTime, newCandidate.firstMatchTime);
+    existingCandidate.firstHitNanos = std::min(existingCandidate.firstHitNanos, newCandidate.firstHitNanos);
+    
+    existingCandidate.isMatchCountChanged = true;
+    
+#ifdef ENABLED_DIAGNOSE
+    if (logEnabled(MatcherLogLevel::Verbose)) {
+        std::cout << "Merged new session into existing: new avg offset = " << newAvgOffset 
+                  << "ms, existing avg offset = " << existingAvgOffset 
+                  << "ms, merged avg offset = " << mergedAvgOffset
+                  << "ms, merged match count = " << existingCandidate.matchCount 
+                  << ", new unique timestamp count = " << existingCandidate.uniqueTimestampCount
+                  << ", tolerance = " << toleranceMs << "ms" << std::endl;
+    }
+#endif
+    
+    return mergedHandle; // 返回被合并到的session
 }
 
 // 生成sessionKey的字符串表示，用于可视化session ID
 std::string SignatureMatcher::generateSessionId(const CandidateSessionKey& sessionKey) const {
-    // 使用offset和signature地址拼接生成唯一ID
+    // 使用offset和signature id拼接生成唯一ID
     std::stringstream ss;
-    ss << "s_" << sessionKey.offset << "_" << reinterpret_cast<uintptr_t>(sessionKey.signature);
+    ss << "s_" << sessionKey.offset << "_" << sessionKey.signatureId;
     return ss.str();
 }
 
@@ -7,42 +7,20 @@
 #include <memory>
 #include <string>
 #include "afp/media_item.h"
+#include "afp/imatcher.h"
+#include "afp/latency_histogram.h"
 #include "signature/signature_generator.h"
 #include "catalog/catalog.h"
+#include "catalog/catalog_index.h"
 #include "config/performance_config.h"
 #include "debugger/visualization.h"
-
-namespace afp {
-
-struct CandidateSessionKey {
-    int32_t offset; // ms
-    const std::vector<SignaturePoint>* signature;
-
-    bool operator==(const CandidateSessionKey& other) const {
-        return offset == other.offset && signature == other.signature;
-    }
-};
-
-} // namespace afp
-
-
-namespace std {
-    template <>
-    struct hash<afp::CandidateSessionKey> {
-        size_t operator()(const afp::CandidateSessionKey& k) const {
-            uintptr_t ptr = reinterpret_cast<uintptr_t>(k.signature);
-#if INTPTR_MAX == INT32_MAX  // 32-bit platform
-            uint32_t ptr_low16 = static_cast<uint32_t>(ptr & 0xFFFF);
-            uint32_t offset_low16 = static_cast<uint32_t>(k.offset & 0xFFFF);
-            return static_cast<size_t>((ptr_low16 << 16) | offset_low16);
-#else  // 64-bit platform
-            uint64_t ptr_low32 = static_cast<uint64_t>(ptr & 0xFFFFFFFF);
-            uint64_t offset_low32 = static_cast<uint64_t>(k.offset & 0xFFFFFFFF);
-            return static_cast<size_t>((ptr_low32 << 32) | offset_low32);
-#endif
-        }
-    };
-}
+#include "signature/session_table.h"
+#include "signature/coarse_vote_filter.h"
+#include "signature/session_score_heap.h"
+#include "signature/session_expiry_wheel.h"
+#include "base/trace_ring.h"
+#include "base/memory_accounting.h"
+#include "base/channel_task_runner.h"
 
 namespace afp {
 
@@ -66,9 +44,13 @@ struct MatchCandidate {
 class SignatureMatcher {
 public:
     using MatchNotifyCallback = std::function<void(const MatchResult&)>;
+    using StatsCallback = std::function<void(const MatchStats&)>;
+    using MatchResultSink = std::function<void(MatchResult&&)>;
     
     // 构造函数 - 接收目录参数
-    SignatureMatcher(std::shared_ptr<ICatalog> catalog, std::shared_ptr<IPerformanceConfig> config);
+    // index为空时自行获取/构建catalog的倒排索引；多个匹配器可共享同一个由该catalog构建的索引
+    SignatureMatcher(std::shared_ptr<ICatalog> catalog, std::shared_ptr<IPerformanceConfig> config,
+                     std::shared_ptr<const ICatalogIndex> index = nullptr);
     
     // 析构函数
     ~SignatureMatcher();
@@ -78,8 +60,90 @@ public:
         matchNotifyCallback_ = callback;
     }
     
-    // 处理来自流式输入的指纹点并执行匹配
+    // 设置匹配结果输出：设置后结果以移动方式交给sink，不再调用匹配通知回调；传入空sink恢复回调
+    void setMatchResultSink(MatchResultSink sink) {
+        matchResultSink_ = std::move(sink);
+    }
+
+    // 设置诊断日志级别，Quiet时跳过所有只为日志服务的排序和输出
+    void setLogLevel(MatcherLogLevel level) {
+        logLevel_ = level;
+        for (const auto& shard : shards_) {
+            shard->setLogLevel(level);
+        }
+    }
+
+    // 设置查询侧匹配的线程数，threads > 1时session按signature下标分片，分片在常驻的工作线程上处理各自的倒排记录，
+    // 结果在通知前按分片顺序汇总；每个分片各自按maxCandidates限制session数量。
+    // 每个分片另有一份只含本分片倒排记录的索引，在设置和切换目录时构建，所有分片合计约为整个索引的大小。
+    // 分片不收集可视化数据；应在第一次processQuerySignature之前设置，切换时已有的session被丢弃
+    void setMatchThreads(size_t threads);
+
+    // 设置统计回调，每次processQuerySignature结束时调用
+    void setStatsCallback(StatsCallback callback) {
+        statsCallback_ = std::move(callback);
+    }
+
+    // 设置事件追踪缓冲（由调用方持有），session的创建、淘汰、合并、通知和过期写入其中；为空时不记录
+    void setTraceRing(TraceRing* trace) {
+        trace_ = trace;
+        for (const auto& shard : shards_) {
+            shard->setTraceRing(trace);
+        }
+    }
+
+    // 设置检测延迟统计（由调用方持有），每个通知的结果记录从session第一次被命中到通知的挂钟和音频延迟；为空时不记录
+    // 分片的结果由本对象汇总后记录，分片本身不需要设置
+    void setLatencyStats(MatchLatencyStats* latencyStats) {
+        latencyStats_ = latencyStats;
+    }
+
+    // 最近一次processQuerySignature的统计，没有可匹配的查询点时各计数为0
+    const MatchStats& lastStats() const {
+        return stats_;
+    }
+
+    // 切换到新的目录快照，index为空时自行获取/构建
+    // 新目录以旧目录为前缀时进行中的session迁移到新目录上继续累积，其余session保留旧快照直至过期
+    void updateCatalog(std::shared_ptr<ICatalog> catalog, std::shared_ptr<const ICatalogIndex> index = nullptr);
+
+    // 处理来自流式输入的指纹点并执行匹配，querySignature只包含上次调用之后新生成的指纹点
     void processQuerySignature(const std::vector<SignaturePoint>& querySignature, size_t inputChannelCount);
+
+    // 目录分片的两步匹配（见CatalogShard），两步依次调用与processQuerySignature的结果相同
+    // 第一步：查找本批查询指纹点并粗筛计票，把本目录中通过筛选的目标指纹（下标, 得分）按下标升序写入candidates，
+    // 未开启粗筛时candidates为空
+    void voteQuerySignature(const std::vector<SignaturePoint>& querySignature,
+                            std::vector<std::pair<uint32_t, uint32_t>>& candidates);
+
+    // 第二步：粗筛只保留selected中的目标指纹（各分片候选合并后的全局前K名中属于本目录的部分，升序），
+    // 再做session匹配、结果判定和通知
+    void matchVotedQuerySignature(const std::vector<SignaturePoint>& querySignature,
+                                  const std::vector<uint32_t>& selected, size_t inputChannelCount);
+
+    // 进行中的session数量
+    size_t sessionCount() const {
+        size_t count = sessions_.size();
+        for (const auto& shard : shards_) {
+            count += shard->sessionCount();
+        }
+        return count;
+    }
+
+    // 把查询缓冲、session状态、匹配明细和待通知结果占用的内存（包括各分片）累加到usage，不含generator和traceBytes
+    void addMemoryUsage(MatcherMemoryUsage& usage) const;
+
+    // 移除所有session及其匹配明细，回到刚构建时的状态（保留已分配的容量、回调和目录），用于匹配器复用
+    void reset();
+
+    // 保存进行中的session（包括各分片），用于把流迁移到另一个匹配器后继续累积
+    // session按当前catalog中signature的下标引用目标指纹，保留在旧目录快照上的session不保存；匹配明细的可视化数据不保存
+    void saveState(StateWriter& writer) const;
+
+    // 恢复saveState保存的session，之前的session全部丢弃，session保持原来的记录池位置，之后的匹配与未迁移时一致
+    // catalog中下标超出范围或指纹点数量不同的session被丢弃；容量、过期时间、分片数与保存时不同或数据不合法时
+    // 返回false，匹配器回到reset之后的状态
+    bool restoreState(StateReader& reader);
     
     // 获取当前候选结果集
     const std::vector<MatchCandidate>& candidates() const {
@@ -118,6 +182,11 @@ public:
         return visualizationData_;
     }
     
+    // 设置可视化数据的采样和上限，见VisualizationLimits；session匹配历史按时间窗口和maxSessions裁剪
+    void setVisualizationLimits(const VisualizationLimits& limits) {
+        visualizationLimits_ = limits;
+    }
+
     // Set title for visualization
     void setVisualizationTitle(const std::string& title) {
         visualizationData_.title = title;
@@ -142,18 +211,38 @@ public:
 
 private:
     std::shared_ptr<ICatalog> catalog_;  // 存储目录引用
+    std::vector<SignatureView> signatureViews_;  // catalog_中各指纹的紧凑视图，attachCatalog时缓存
     std::vector<MatchCandidate> candidates_;  // 所有候选结果
     std::unordered_map<const MediaItem*, std::vector<size_t>> mediaItemCandidates_;  // 媒体项到候选索引的映射
     MatchNotifyCallback matchNotifyCallback_;  // 匹配通知回调
-    static size_t nextCandidateId_;     // 下一个候选ID
-    
+    MatchResultSink matchResultSink_;          // 匹配结果输出，设置后代替通知回调
+    StatsCallback statsCallback_;              // 统计回调
+    MatchStats stats_;                         // 本次调用的统计
+    TraceRing* trace_ = nullptr;               // 事件追踪，分片与主匹配器共用同一个
+    MatchLatencyStats* latencyStats_ = nullptr; // 检测延迟统计
+    uint64_t batchStartNanos_ = 0;             // 本次匹配调用的开始时刻，记入新session的firstHitNanos
 
+    void trace(const TraceEventDesc& desc, uint32_t count, double value_a, double value_b) {
+        if (trace_) {
+            trace_->instant(desc, count, value_a, value_b);
+        }
+    }
+    MatcherLogLevel logLevel_ = MatcherLogLevel::Verbose;
+
+    bool logEnabled(MatcherLogLevel level) const {
+        return logLevel_ >= level;
+    }
+
+    // 查询命中时由倒排记录解析出的目标信息
     struct TargetSignatureInfo2 {
         const MediaItem *mediaItem;
-        const SignaturePoint *signaturePoint;  // 直接存储SignaturePoint指针，包含完整信息
-        const std::vector<SignaturePoint> *signature;
+        const SignatureView *signature;     // 目标指纹的紧凑视图
+        uint32_t signatureIndex;            // 在当前catalog中的下标
+        uint32_t pointIndex;                // 命中的目标指纹点在signature中的下标
+        SignatureId signatureId;
     };
-    std::unordered_map<uint32_t, std::vector<TargetSignatureInfo2>> hash2TargetSignaturesInfoMap_;  // 哈希值到时间戳的映射
+    // 哈希值到目标指纹点的倒排索引，可由多个匹配器共享；未传入时优先使用catalog从文件映射的预构建索引
+    std::shared_ptr<const ICatalogIndex> index_;
 
     std::shared_ptr<IPerformanceConfig> config_;
     size_t maxCandidates_;         // 最大候选结果数
@@ -163,11 +252,89 @@ private:
     size_t minMatchesRequired_;    // 最小匹配点数要求
     size_t minMatchesUniqueTimestampRequired_; // 最小unique时间戳数量要求
     double offsetTolerance_;       // 时间偏移容忍度 (秒)
+    bool materializeMatchedPoints_; // 是否在结果中直接生成matchedPoints
+
+    // 每个目标指纹的session，按handle升序（即session表的遍历顺序）；数量受maxCandidatesPerSignature限制，
+    // 用于统计同signature的session数量和查找可合并的session，不必遍历整个session表
+    std::unordered_map<SignatureId, std::vector<SessionTable::Handle>> signatureSessions_;
+
+    // 第一阶段粗筛：按目标指纹计票，只对得票最高的目标指纹做session匹配
+    CoarseVoteFilter coarseVoteFilter_;
+    // 本批每个查询点命中的倒排记录范围，粗筛和session匹配两个阶段共用
+    using QueryPostingRange = std::pair<const IndexPosting*, const IndexPosting*>;
+    std::vector<QueryPostingRange> queryPostings_;
+    // 查找前按哈希排序的(哈希 << 32 | 查询点下标)，去重后的哈希及其倒排记录范围
+    std::vector<uint64_t> sortedQueryKeys_;
+    std::vector<uint32_t> uniqueQueryHashes_;
+    std::vector<QueryPostingRange> uniqueQueryPostings_;
+
+    // 已通知的目标指纹：按signature下标记录已通知session及其平均偏移
+    // 该session存在期间，偏移在容忍度以内的命中直接跳过，不再查找session表；偏移漂移的命中照常处理
+    struct ResolvedSignature {
+        SessionTable::Handle handle;  // 已通知的session，kInvalidHandle表示未通知
+        int32_t offsetMs;             // 通知时的平均偏移（毫秒）
+    };
+    std::vector<ResolvedSignature> resolvedSignatures_;
+
+    // 查找本批查询指纹点的倒排记录并粗筛计票，没有需要匹配的内容时返回false
+    bool prepareQueryBatch(const std::vector<SignaturePoint>& querySignature);
+
+    // 对prepareQueryBatch查找的倒排记录做session匹配，记录延迟、通知结果和统计
+    void matchQueryBatch(const std::vector<SignaturePoint>& querySignature, size_t inputChannelCount);
+
+    // 当前catalog的id起点，见SignatureId
+    SignatureId catalogIdBase_ = 0;
+
+    // 当前catalog中signature的下标，不属于当前catalog（旧目录快照）时返回SIZE_MAX
+    size_t signatureIndexOf(SignatureId signatureId) const;
+
+    // id对应的目标指纹所在的catalog（当前catalog或仍被session引用的旧目录快照）及其在该catalog中的下标
+    std::pair<const ICatalog*, size_t> signatureOf(SignatureId signatureId) const;
+
+    // 记录session所属signature已通知
+    void markSignatureResolved(SessionTable::Handle handle);
+
+    // 按现有的已通知session重建resolvedSignatures_
+    void rebuildResolvedSignatures();
+
+    // 多线程匹配的session分片，为空时在本对象上单线程匹配；分片只使用lookupShardPostings和matchQueryPostings
+    std::vector<std::unique_ptr<SignatureMatcher>> shards_;
+    // 执行分片的常驻工作线程（分片数 - 1个，调用线程执行其余分片）
+    std::unique_ptr<ChannelTaskRunner> shardRunner_;
+    // 分片自己的索引，只含本分片目标指纹的倒排记录（见CatalogIndex::partition）；非分片对象为空
+    std::shared_ptr<const CatalogIndex> shardPostingIndex_;
+
+    // 为各分片按当前catalog划分索引
+    void partitionShardIndexes();
+
+    // 分片用本对象（汇总方）去重排序后的查询哈希在自己的索引中查找，按查询点的原始顺序展开到queryPostings_
+    void lookupShardPostings(const std::vector<uint32_t>& uniqueHashes, const std::vector<uint64_t>& sortedKeys);
+
+    // 用已查好的倒排记录范围和粗筛结果匹配本批查询点：创建/更新session、合并、评估、移除过期session，
+    // 结果留在matchResults_和stats_中
+    void matchQueryPostings(const std::vector<SignaturePoint>& querySignature, size_t inputChannelCount,
+                            const std::vector<QueryPostingRange>& queryPostings, const CoarseVoteFilter& voteFilter);
+
+    // 在各分片上并行执行matchQueryPostings并汇总结果和统计
+    void matchQueryPostingsInShards(const std::vector<SignaturePoint>& querySignature, size_t inputChannelCount);
 
-    std::unordered_map< const std::vector<SignaturePoint> *, size_t> signature2SessionCnt_;
+    // 切换目录后仍被session引用的旧目录快照
+    struct RetiredCatalog {
+        std::shared_ptr<ICatalog> catalog;
+        std::shared_ptr<const ICatalogIndex> index;
+        SignatureId idBase;  // 该快照的id起点
+    };
+    std::vector<RetiredCatalog> retiredCatalogs_;
+
+    // 校验/构建当前catalog的倒排索引
+    void attachCatalog();
+
+    // 释放不再被任何session引用的旧目录快照
+    void releaseRetiredCatalogs();
 
+    // 调试用的完整匹配明细，只在收集可视化数据时记录，哈希在输出时再格式化
     struct DebugMatchInfo {
-        std::string hash;
+        uint32_t hash;
         double queryTime;
         double targetTime;
         int32_t offset;
@@ -180,62 +347,121 @@ private:
 
         SignaturePoint sourcePoint;   
     };
-    struct MatchingCandidate;
-    std::unordered_map<size_t, std::vector<std::pair<size_t, DebugMatchInfo>>> findDuplicateHashes(const std::vector<std::pair<CandidateSessionKey, MatchingCandidate>>& candidates);
-
-    struct MatchingCandidate {
-        const TargetSignatureInfo2* targetSignatureInfo; // 目标签名信息
-        size_t maxPossibleMatches;          // 最大可能匹配点数 
-        size_t matchCount;                  // 匹配点数量
-        std::vector<DebugMatchInfo> matchInfos;           // 匹配信息
-        double lastMatchTime;               // 最后一次匹配的时间戳
-        int32_t offset;                     // 时间偏移（毫秒，用于session key）
-        int64_t actualOffsetSum;             // 累积的实际时间偏移（毫秒），使用int64_t防止溢出
-        int64_t offsetCount;                 // 偏移计数，用于计算平均值
-        size_t uniqueTimestampCount;        // unique时间戳数量
-        std::unordered_set<double> uniqueTimestamps; // unique时间戳集合（保留2位小数精度）
-        bool isMatchCountChanged;           // 是否匹配点数量发生变化
-        bool isNotified;                    // 是否已通知
+    // 匹配明细只在收集可视化数据时记录且随输入增长，由计数分配器记入historyMemory_
+    MemoryCounter historyMemory_;
+    using DebugMatchInfoList = std::vector<DebugMatchInfo, CountingAllocator<DebugMatchInfo>>;
+    DebugMatchInfoList makeDebugMatchInfoList() {
+        return DebugMatchInfoList(CountingAllocator<DebugMatchInfo>(&historyMemory_));
+    }
+    std::unordered_map<size_t, std::vector<std::pair<size_t, DebugMatchInfo>>> findDuplicateHashes(const std::vector<SessionTable::Handle>& sessions);
+
+    // 候选session表，记录池容量为maxCandidates_
+    SessionTable sessions_;
+    // 以下按记录池下标存放，与session记录分开保存
+    // 每个session命中的源点在其signature中的下标，用于生成结果的matchedPoints
+    std::vector<std::vector<uint32_t>> sessionMatchedPoints_;
+    // 每个session的完整匹配明细，只在collectVisualizationData_开启时记录
+    std::vector<DebugMatchInfoList> sessionMatchInfos_;
+
+    // 合并相近session用的排序，按(signature, 平均偏移)排列，跨调用保留以便增量维护
+    struct MergeEntry {
+        SignatureId signatureId;
+        double avgOffset;
+        SessionTable::Handle handle;
     };
-    std::unordered_map<CandidateSessionKey, MatchingCandidate> session2CandidateMap_;
+    std::vector<MergeEntry> mergeOrder_;
+    std::vector<uint8_t> inMergeOrder_;   // 按记录池下标，session是否已在mergeOrder_中
+    std::vector<uint8_t> mergeRemoved_;   // 按mergeOrder_下标，本次被合并删除的session
+
+    // 淘汰用的分数堆，全局一个、每个signature一个
+    // 第一次需要淘汰时构建，之后session变化时惰性写入新条目
+    SessionScoreHeap globalScoreHeap_;
+    std::unordered_map<SignatureId, SessionScoreHeap> signatureScoreHeaps_;
+    std::vector<uint32_t> sessionVersions_;    // 按记录池下标，session变化写入堆或被移除时递增
+    std::vector<uint8_t> sessionScoreDirty_;   // 按记录池下标，分数已变化但尚未写入堆
+    std::vector<SessionTable::Handle> dirtyScoreSessions_;
+    bool scoreHeapsValid_ = false;
+
+    // 按过期时间组织session的时间轮，每次只取出可能过期的session
+    SessionExpiryWheel expiryWheel_;
+
     std::vector<MatchResult> matchResults_;
-    std::vector<CandidateSessionKey> expiredCandidateSessionKeys_;
+    // 与matchResults_一一对应：结果所属session最早命中的查询时间戳和第一次被命中的时刻，用于统计检测延迟
+    struct MatchDetection {
+        double firstMatchTime;
+        uint64_t firstHitNanos;
+    };
+    std::vector<MatchDetection> matchDetections_;
+    std::vector<SessionTable::Handle> expiredSessions_;
     
     // Visualization data
     bool collectVisualizationData_ = false;
     VisualizationData visualizationData_;
+    VisualizationLimits visualizationLimits_;
+    VisualizationSampler peakSampler_;
+    VisualizationSampler pointSampler_;
     
     // 存储整个过程中所有session的历史数据，用于可视化
     // Key: sessionKey的字符串表示, Value: 该session的所有匹配信息
-    std::unordered_map<std::string, std::vector<DebugMatchInfo>> allSessionsHistory_;
+    using SessionHistoryMap = std::unordered_map<std::string, DebugMatchInfoList, std::hash<std::string>,
+                                                 std::equal_to<std::string>,
+                                                 CountingAllocator<std::pair<const std::string, DebugMatchInfoList>>>;
+    SessionHistoryMap allSessionsHistory_{SessionHistoryMap::allocator_type(&historyMemory_)};
+    size_t historyMatchCount_ = 0;   // allSessionsHistory_中的匹配明细总数
+    size_t historyTrimAt_ = 0;       // 明细总数达到此值时按visualizationLimits_裁剪历史
+
+    // 按visualizationLimits_裁剪session匹配历史和进行中session的明细，均摊到每条明细为O(1)
+    void trimSessionHistory(double latestQueryTime);
     
+    // 添加新session，表已满时返回SessionTable::kInvalidHandle
+    SessionTable::Handle addSession(const SessionRecord& record);
+
+    // 移除session及其匹配明细
+    void removeSession(SessionTable::Handle handle);
+
+    // 把session加入/移出signatureSessions_
+    void indexSession(SessionTable::Handle handle);
+    void unindexSession(SessionTable::Handle handle);
+
+    // 同一目标指纹的session数量
+    size_t sessionCountOf(SignatureId signatureId) const;
+
+    // session的分数可能发生变化，分数堆有效时记录下来，下次查询堆顶前写入
+    void markSessionScoreChanged(SessionTable::Handle handle);
+
+    // 保证分数堆可用：无效或过期条目过多时重建，否则写入变化的session
+    void prepareScoreHeaps();
+
     // Helper method for merging sessions with similar time offsets
     void mergeSimilarSessions();
     
     // 尝试将新的候选session与现有的同signature sessions合并
-    // 返回值：如果成功合并返回被合并到的sessionKey，否则返回{0, nullptr}
-    CandidateSessionKey tryMergeWithExistingSessions(
-        const CandidateSessionKey& newSessionKey, 
-        const MatchingCandidate& newCandidate);
+    // 返回值：如果成功合并返回被合并到的session，否则返回SessionTable::kInvalidHandle
+    SessionTable::Handle tryMergeWithExistingSessions(const SessionRecord& newCandidate);
     
     // 计算候选session的分数
-    double calculateSessionScore(const MatchingCandidate& candidate, double currentTimestamp) const;
+    double calculateSessionScore(const SessionRecord& candidate, double currentTimestamp) const;
+
+    // 由活跃度分数和session的其余评分因子计算综合分数
+    double combineSessionScore(const SessionRecord& candidate, double activityScore) const;
+
+    // 最后匹配时间为lastMatchTime的session在currentTimestamp时的活跃度分数 (0-1)
+    double activityScoreOf(double lastMatchTime, double currentTimestamp) const;
     
-    // 找到分数最低的session
-    CandidateSessionKey findLowestScoreSession(double currentTimestamp) const;
+    // 找到分数最低的session（查询全局分数堆）
+    SessionTable::Handle findLowestScoreSession(double currentTimestamp);
     
     // 检查是否应该替换现有session
-    bool shouldReplaceSession(const MatchingCandidate& newCandidate, double currentTimestamp) const;
+    bool shouldReplaceSession(const SessionRecord& newCandidate, double currentTimestamp);
     
-    // 找到指定signature下分数最低的session
-    CandidateSessionKey findLowestScoreSessionInSignature(
-        const std::vector<SignaturePoint>* signature, double currentTimestamp) const;
+    // 找到指定signature下分数最低的session（查询该signature的分数堆）
+    SessionTable::Handle findLowestScoreSessionInSignature(SignatureId signatureId, double currentTimestamp);
     
     // 检查是否应该替换同一signature下的现有session
     bool shouldReplaceSessionInSignature(
-        const MatchingCandidate& newCandidate, 
-        const std::vector<SignaturePoint>* signature, 
-        double currentTimestamp) const;
+        const SessionRecord& newCandidate, 
+        SignatureId signatureId, 
+        double currentTimestamp);
     
     // 生成sessionKey的字符串表示，用于可视化session ID
     std::string generateSessionId(const CandidateSessionKey& sessionKey) const;
@@ -0,0 +1,43 @@
+#include "band_noise_tracker.h"
+#include <algorithm>
+#include <cmath>
+
+namespace afp {
+
+BandNoiseTracker::BandNoiseTracker(double time_constant)
+    : time_constant_(time_constant) {
+}
+
+void BandNoiseTracker::update(const std::vector<float>& band_levels, double timestamp) {
+    if (band_levels.size() != levels_.size()) {
+        levels_.assign(band_levels.size(), 0.0f);
+        last_timestamps_.assign(band_levels.size(), 0.0);
+        initialized_.assign(band_levels.size(), 0);
+    }
+
+    for (size_t band = 0; band < band_levels.size(); ++band) {
+        const float observed = band_levels[band];
+        if (observed <= 0.0f) {
+            continue;
+        }
+
+        if (!initialized_[band]) {
+            levels_[band] = observed;
+            initialized_[band] = 1;
+        } else {
+            // 间隔越长新观测的权重越大，间隔超过几个时间常数后旧估计基本被替换
+            const double elapsed = std::max(0.0, timestamp - last_timestamps_[band]);
+            const double alpha = time_constant_ > 0.0 ? 1.0 - std::exp(-elapsed / time_constant_) : 1.0;
+            levels_[band] += static_cast<float>(alpha) * (observed - levels_[band]);
+        }
+        last_timestamps_[band] = timestamp;
+    }
+}
+
+void BandNoiseTracker::reset() {
+    levels_.clear();
+    last_timestamps_.clear();
+    initialized_.clear();
+}
+
+} // namespace afp
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace afp {
+
+// 各频段噪声水平的滑动估计
+// 每次观测按距上次观测的时间做指数滑动平均，时间常数是噪声估计窗口的长度；
+// 状态只有每个频段的估计值和上次观测时间，更新的开销与窗口长度无关，不需要保存窗口内的历史再排序取中位数
+class BandNoiseTracker {
+public:
+    explicit BandNoiseTracker(double time_constant);
+
+    // 以timestamp时刻各频段的噪声观测值更新估计，观测值不大于0的频段不更新
+    // 频段数与之前不同时先清空
+    void update(const std::vector<float>& band_levels, double timestamp);
+
+    // 频段是否已经有估计值
+    bool hasLevel(size_t band) const { return band < initialized_.size() && initialized_[band]; }
+
+    // 频段的估计值，还没有观测时为0
+    float level(size_t band) const { return hasLevel(band) ? levels_[band] : 0.0f; }
+
+    void reset();
+
+private:
+    double time_constant_;
+    std::vector<float> levels_;
+    std::vector<double> last_timestamps_;
+    std::vector<uint8_t> initialized_;
+};
+
+} // namespace afp
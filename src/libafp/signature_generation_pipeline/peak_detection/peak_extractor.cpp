@@ -3,34 +3,60 @@
 namespace afp {
 
 PeakExtractor::PeakExtractor(SignatureGenerationPipelineCtx* ctx)
-    : ctx_(ctx) {
+    : ctx_(ctx)
+    , frame_kernels_(selectFrameKernels(ctx->fft_size)) {
+    // 参与分位数统计的bin：避开两端localMaxRange个bin，且频率在[minFreq, maxFreq]内
+    // bin频率随下标单调递增，满足条件的bin是连续的一段
+    const auto& peak_config = ctx_->config->getPeakDetectionConfig();
+    const auto& bin_frequencies = ctx_->bin_frequencies;
+    quantile_first_bin_ = peak_config.localMaxRange;
+    quantile_last_bin_ = bin_frequencies.size() > peak_config.localMaxRange
+        ? bin_frequencies.size() - peak_config.localMaxRange : 0;
+    while (quantile_first_bin_ < quantile_last_bin_ && bin_frequencies[quantile_first_bin_] < peak_config.minFreq) {
+        ++quantile_first_bin_;
+    }
+    while (quantile_last_bin_ > quantile_first_bin_ && bin_frequencies[quantile_last_bin_ - 1] > peak_config.maxFreq) {
+        --quantile_last_bin_;
+    }
+
+    // 候选峰值的bin同样是连续的一段，提取时不再逐bin比较频率
+    candidate_first_bin_ = 0;
+    candidate_last_bin_ = bin_frequencies.size();
+    while (candidate_first_bin_ < candidate_last_bin_ && bin_frequencies[candidate_first_bin_] < peak_config.minFreq) {
+        ++candidate_first_bin_;
+    }
+    while (candidate_last_bin_ > candidate_first_bin_ && bin_frequencies[candidate_last_bin_ - 1] > peak_config.maxFreq) {
+        --candidate_last_bin_;
+    }
 }
 
-std::vector<Peak> PeakExtractor::extractPeaks(
-    const std::vector<FFTResult>& fft_results,
+void PeakExtractor::extractPeaks(
+    const SpectrogramView& spectrogram,
     int start_idx, int end_idx,
-    float quantile_threshold) {
+    float quantile_threshold,
+    std::vector<Peak>& all_peaks) {
     
-    std::vector<Peak> all_peaks;
+    all_peaks.clear();
     const auto& peak_config = ctx_->config->getPeakDetectionConfig();
-    const size_t fft_size = ctx_->config->getFFTConfig().fftSize;
+    const size_t bin_count = spectrogram.binCount();
+    const auto& bin_frequencies = ctx_->bin_frequencies;
     
     // 计算分位数阈值
     float quantile_magnitude = calculateQuantileThreshold(
-        fft_results, start_idx, end_idx, quantile_threshold);
+        spectrogram, start_idx, end_idx, quantile_threshold);
+
+    // 计算检测区域内每个bin的时频邻域最大值
+    computeNeighbourMax(spectrogram, start_idx, end_idx);
     
     // 优化：一次遍历所有频率，避免重复检查
     for (int frame_idx = start_idx; frame_idx < end_idx; ++frame_idx) {
-        const auto& current_frame = fft_results[frame_idx];
+        const float* current_magnitudes = spectrogram.magnitudes(frame_idx);
+        const float* neighbour_max = neighbour_max_.data() + (frame_idx - start_idx) * bin_count;
         
-        for (size_t freq_idx = 0; freq_idx < fft_size / 2; ++freq_idx) {
-            float current_freq = current_frame.frequencies[freq_idx];
-            float current_magnitude = current_frame.magnitudes[freq_idx];
-            
-            // 检查是否在任何有效频段范围内
-            if (current_freq < peak_config.minFreq || current_freq > peak_config.maxFreq) {
-                continue;
-            }
+        // 只遍历频率在有效范围内的bin
+        for (size_t freq_idx = candidate_first_bin_; freq_idx < candidate_last_bin_; ++freq_idx) {
+            float current_freq = bin_frequencies[freq_idx];
+            float current_magnitude = current_magnitudes[freq_idx];
             
             // 检查双重幅度阈值
             if (current_magnitude <= quantile_magnitude || 
@@ -38,8 +64,8 @@ std::vector<Peak> PeakExtractor::extractPeaks(
                 continue;
             }
             
-            // 检查是否为时频域局部最大值
-            if (!isLocalMaximum(fft_results, frame_idx, freq_idx, current_magnitude)) {
+            // 检查是否为时频域局部最大值：严格大于频率和时间两个方向上的所有邻居
+            if (current_magnitude <= neighbour_max[freq_idx]) {
                 continue;
             }
             
@@ -47,88 +73,62 @@ std::vector<Peak> PeakExtractor::extractPeaks(
             Peak peak;
             peak.frequency = static_cast<uint32_t>(current_freq);
             peak.magnitude = current_magnitude;
-            peak.timestamp = current_frame.timestamp;
+            peak.timestamp = spectrogram.timestamp(frame_idx);
             
             all_peaks.push_back(peak);
 
             if (ctx_->visualization_config->collectVisualizationData_) {
-                ctx_->visualization_config->visualizationData_.allPeaks.emplace_back(peak.frequency, peak.timestamp, peak.magnitude);
+                ctx_->visualization_config->addPeak(peak.frequency, peak.timestamp, peak.magnitude);
             }
         }
     }
-    
-    return all_peaks;
 }
 
-bool PeakExtractor::isLocalMaximum(
-    const std::vector<FFTResult>& fft_results,
-    int frame_idx, size_t freq_idx,
-    float current_magnitude) const {
+void PeakExtractor::computeNeighbourMax(
+    const SpectrogramView& spectrogram,
+    int start_idx, int end_idx) {
     
     const auto& peak_config = ctx_->config->getPeakDetectionConfig();
-    const size_t fft_size = ctx_->config->getFFTConfig().fftSize;
+    const size_t bin_count = spectrogram.binCount();
+    const size_t frame_count = static_cast<size_t>(end_idx - start_idx);
+    const size_t time_range = peak_config.timeMaxRange;
     
-    // 检查频率维度上的局部最大值
-    for (size_t j = 1; j <= peak_config.localMaxRange; ++j) {
-        // 检查左边界
-        if (freq_idx >= j) {
-            if (current_magnitude <= fft_results[frame_idx].magnitudes[freq_idx - j]) {
-                return false;
-            }
-        }
-        // 检查右边界
-        if (freq_idx + j < fft_size / 2) {
-            if (current_magnitude <= fft_results[frame_idx].magnitudes[freq_idx + j]) {
-                return false;
-            }
-        }
-    }
+    // 时间方向：每个元素是一整帧，各bin一起计算；只需要检测区域前后各time_range帧
+    const size_t first_frame = static_cast<size_t>(start_idx) >= time_range ? start_idx - time_range : 0;
+    const size_t last_frame = std::min(static_cast<size_t>(end_idx) + time_range, spectrogram.size());
+    neighbour_max_.resize(frame_count * bin_count);
+    sliding_max_.neighbourMax(
+        [&](size_t i) { return spectrogram.magnitudes(first_frame + i); },
+        last_frame - first_frame, bin_count, time_range,
+        start_idx - first_frame, end_idx - first_frame, neighbour_max_.data());
     
-    // 检查时间维度上的局部最大值
-    for (size_t j = 1; j <= peak_config.timeMaxRange; ++j) {
-        // 与前面的帧比较
-        if (frame_idx >= static_cast<int>(j)) {
-            if (current_magnitude <= fft_results[frame_idx - j].magnitudes[freq_idx]) {
-                return false;
-            }
-        }
+    // 频率方向：逐帧计算，再与时间方向的结果合并
+    frequency_max_.resize(bin_count);
+    for (size_t frame_i = 0; frame_i < frame_count; ++frame_i) {
+        const float* magnitudes = spectrogram.magnitudes(start_idx + frame_i);
+        sliding_max_.neighbourMax(
+            [&](size_t i) { return magnitudes + i; },
+            bin_count, 1, peak_config.localMaxRange,
+            0, bin_count, frequency_max_.data());
         
-        // 与后面的帧比较
-        if (frame_idx + static_cast<int>(j) < static_cast<int>(fft_results.size())) {
-            if (current_magnitude <= fft_results[frame_idx + j].magnitudes[freq_idx]) {
-                return false;
-            }
-        }
+        frame_kernels_.max_in_place(neighbour_max_.data() + frame_i * bin_count, frequency_max_.data(), bin_count);
     }
-    
-    return true;
 }
 
 float PeakExtractor::calculateQuantileThreshold(
-    const std::vector<FFTResult>& fft_results,
+    const SpectrogramView& spectrogram,
     int start_idx, int end_idx,
-    float quantile) const {
+    float quantile) {
     
-    const auto& peak_config = ctx_->config->getPeakDetectionConfig();
-    const size_t fft_size = ctx_->config->getFFTConfig().fftSize;
-    
-    std::vector<float> all_magnitudes;  // TODO: 性能优化，用同一个vector对象，避免重复创建
+    auto& all_magnitudes = quantile_magnitudes_;
+    all_magnitudes.clear();
     
-    // 收集窗口内所有帧的幅度值
+    // 收集窗口内所有帧在有效频率范围内的幅度值，每帧是连续的一段
     for (int frame_idx = start_idx; frame_idx < end_idx; ++frame_idx) {
-        const auto& current_frame = fft_results[frame_idx];
-        for (size_t freq_idx = peak_config.localMaxRange; 
-             freq_idx < fft_size / 2 - peak_config.localMaxRange; 
-             ++freq_idx) {
-            
-            float current_freq = current_frame.frequencies[freq_idx];
-            
-            // 只收集在有效频率范围内的幅度值
-            if (current_freq >= peak_config.minFreq && 
-                current_freq <= peak_config.maxFreq) {
-                all_magnitudes.push_back(current_frame.magnitudes[freq_idx]);
-            }
-        }
+        const float* current_magnitudes = spectrogram.magnitudes(frame_idx);
+        all_magnitudes.insert(all_magnitudes.end(),
+                              current_magnitudes + quantile_first_bin_,
+                              current_magnitudes + quantile_last_bin_);
     }
     
     // 计算分位数
@@ -136,19 +136,24 @@ float PeakExtractor::calculateQuantileThreshold(
         return 0.0f;
     }
     
-    std::sort(all_magnitudes.begin(), all_magnitudes.end());
     size_t n = all_magnitudes.size();
     
     float position = quantile * (n - 1);
     size_t lower_index = static_cast<size_t>(std::floor(position));
     size_t upper_index = static_cast<size_t>(std::ceil(position));
     
+    // 只需要两个相邻的顺序统计量，用线性时间的选择代替整体排序，结果与排序后取值相同
+    std::nth_element(all_magnitudes.begin(), all_magnitudes.begin() + lower_index, all_magnitudes.end());
+    const float lower_value = all_magnitudes[lower_index];
+    
     if (lower_index == upper_index) {
-        return all_magnitudes[lower_index];
+        return lower_value;
     } else {
+        // nth_element之后lower_index之后的元素都不小于lower_value，其中最小的即下一个顺序统计量
+        const float upper_value = *std::min_element(all_magnitudes.begin() + upper_index, all_magnitudes.end());
         float weight = position - lower_index;
-        return all_magnitudes[lower_index] * (1.0f - weight) + 
-               all_magnitudes[upper_index] * weight;
+        return lower_value * (1.0f - weight) + 
+               upper_value * weight;
     }
 }
 
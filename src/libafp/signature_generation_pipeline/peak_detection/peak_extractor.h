@@ -2,10 +2,12 @@
 
 #include "signature_generation_pipeline/signature_generation_pipeline_ctx.h"
 #include "frequency_band_manager.h"
+#include "sliding_max_filter.h"
 #include <vector>
 #include <algorithm>
-#include "base/fft_result.h"
+#include "base/spectrogram_ring.h"
 #include "base/peek.h"
+#include "audio/frame_kernels.h"
 
 namespace afp {
 
@@ -13,26 +15,49 @@ class PeakExtractor {
 public:
     PeakExtractor(SignatureGenerationPipelineCtx* ctx);
     
-    // 从FFT结果中提取峰值
-    std::vector<Peak> extractPeaks(
-        const std::vector<FFTResult>& fft_results,
+    // 从频谱中提取峰值，结果写入peaks（先清空），peaks可在多次调用之间复用以避免分配
+    void extractPeaks(
+        const SpectrogramView& spectrogram,
         int start_idx, int end_idx,
-        float quantile_threshold);
+        float quantile_threshold,
+        std::vector<Peak>& peaks);
+
+    // 分位数和邻域最大值缓冲占用的内存（字节）
+    size_t memoryUsage() const {
+        return (quantile_magnitudes_.capacity() + neighbour_max_.capacity() + frequency_max_.capacity()) * sizeof(float) +
+               sliding_max_.memoryUsage();
+    }
 
 private:
     SignatureGenerationPipelineCtx* ctx_;
     
-    // 检查是否为时频域局部最大值
-    bool isLocalMaximum(
-        const std::vector<FFTResult>& fft_results,
-        int frame_idx, size_t freq_idx,
-        float current_magnitude) const;
+    // 计算检测区域[start_idx, end_idx)内每个bin的邻域最大值（频率方向±localMaxRange、时间方向±timeMaxRange，不含自身），
+    // 结果写入neighbour_max_；用两遍可分离的滑动最大值代替逐个bin比较邻居，代价与两个范围无关
+    void computeNeighbourMax(
+        const SpectrogramView& spectrogram,
+        int start_idx, int end_idx);
     
     // 计算分位数阈值
     float calculateQuantileThreshold(
-        const std::vector<FFTResult>& fft_results,
+        const SpectrogramView& spectrogram,
         int start_idx, int end_idx,
-        float quantile) const;
+        float quantile);
+
+    // 计算分位数时收集幅度值的缓冲，在多次检测之间复用
+    std::vector<float> quantile_magnitudes_;
+    // 参与分位数统计的bin范围[quantile_first_bin_, quantile_last_bin_)
+    size_t quantile_first_bin_;
+    size_t quantile_last_bin_;
+    // 频率在[minFreq, maxFreq]内、可能成为峰值的bin范围[candidate_first_bin_, candidate_last_bin_)
+    size_t candidate_first_bin_;
+    size_t candidate_last_bin_;
+
+    // 按FFT大小特化的逐bin取最大值内核
+    const FrameKernels frame_kernels_;
+
+    SlidingMaxFilter sliding_max_;
+    std::vector<float> neighbour_max_;   // 检测区域内每个bin的邻域最大值，按帧依次存放
+    std::vector<float> frequency_max_;   // 单帧频率方向的邻域最大值
 };
 
 } // namespace afp 
\ No newline at end of file
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace afp {
+
+// van Herk/Gil-Werman滑动最大值，用于计算时频域局部最大值判断所需的邻域最大值
+// 序列按range分块，块内做一遍前缀最大值和一遍后缀最大值，长度为range的窗口[a, a+range-1]的最大值
+// 为max(后缀[a], 前缀[a+range-1])，每个元素的代价与range无关
+// 序列的每个元素是width个连续的float（如频谱的一帧），各分量独立计算，内层循环可由编译器向量化；
+// NEON平台上显式每次处理4个float。幅度没有NaN，vmaxq_f32与std::max的结果在比较意义上一致
+class SlidingMaxFilter {
+public:
+    // 对下标[0, n)的元素，计算[out_begin, out_end)中每个元素i的邻域最大值：
+    // max{ rows(j) : 1 <= |j - i| <= range, 0 <= j < n }，不含元素自身，越界部分截断，邻域为空时为-inf
+    // rows(j)返回第j个元素的起始地址；结果按元素依次写入out，每个元素width个float
+    template<typename RowAt>
+    void neighbourMax(RowAt rows, size_t n, size_t width, size_t range,
+                      size_t out_begin, size_t out_end, float* out) {
+        if (range == 0 || n < 2) {
+            std::fill(out, out + (out_end - out_begin) * width, -std::numeric_limits<float>::infinity());
+            return;
+        }
+
+        prefix_.resize(n * width);
+        suffix_.resize(n * width);
+        for (size_t block = 0; block < n; block += range) {
+            const size_t block_end = std::min(block + range, n);
+            std::copy(rows(block), rows(block) + width, prefix_.data() + block * width);
+            for (size_t i = block + 1; i < block_end; ++i) {
+                maxOf(prefix_.data() + (i - 1) * width, rows(i), width, prefix_.data() + i * width);
+            }
+            std::copy(rows(block_end - 1), rows(block_end - 1) + width, suffix_.data() + (block_end - 1) * width);
+            for (size_t i = block_end - 1; i-- > block;) {
+                maxOf(suffix_.data() + (i + 1) * width, rows(i), width, suffix_.data() + i * width);
+            }
+        }
+
+        // 两侧的邻域都完整的元素：左邻域[i-range, i-1]和右邻域[i+1, i+range]各由一个后缀和一个前缀得到
+        const size_t inner_begin = std::max(out_begin, range);
+        const size_t inner_end = n > range ? std::max(std::min(out_end, n - range), inner_begin) : inner_begin;
+        for (size_t i = out_begin; i < std::min(inner_begin, out_end); ++i) {
+            edgeMax(i, n, width, range, out + (i - out_begin) * width);
+        }
+        if (inner_begin < inner_end) {
+            // 按连续的float处理，单个float的序列与整帧的序列共用同一个可向量化的循环
+            const size_t count = (inner_end - inner_begin) * width;
+            const float* left_suffix = suffix_.data() + (inner_begin - range) * width;
+            const float* left_prefix = prefix_.data() + (inner_begin - 1) * width;
+            const float* right_suffix = suffix_.data() + (inner_begin + 1) * width;
+            const float* right_prefix = prefix_.data() + (inner_begin + range) * width;
+            float* dst = out + (inner_begin - out_begin) * width;
+            size_t k = 0;
+#if defined(__ARM_NEON)
+            for (; k + 4 <= count; k += 4) {
+                const float32x4_t left = vmaxq_f32(vld1q_f32(left_suffix + k), vld1q_f32(left_prefix + k));
+                const float32x4_t right = vmaxq_f32(vld1q_f32(right_suffix + k), vld1q_f32(right_prefix + k));
+                vst1q_f32(dst + k, vmaxq_f32(left, right));
+            }
+#endif
+            for (; k < count; ++k) {
+                dst[k] = std::max(std::max(left_suffix[k], left_prefix[k]),
+                                  std::max(right_suffix[k], right_prefix[k]));
+            }
+        }
+        for (size_t i = std::max(inner_end, inner_begin); i < out_end; ++i) {
+            edgeMax(i, n, width, range, out + (i - out_begin) * width);
+        }
+    }
+
+    // 前缀和后缀最大值缓冲占用的内存（字节）
+    size_t memoryUsage() const { return (prefix_.capacity() + suffix_.capacity()) * sizeof(float); }
+
+private:
+    static void maxOf(const float* a, const float* b, size_t width, float* dst) {
+        size_t k = 0;
+#if defined(__ARM_NEON)
+        for (; k + 4 <= width; k += 4) {
+            vst1q_f32(dst + k, vmaxq_f32(vld1q_f32(a + k), vld1q_f32(b + k)));
+        }
+#endif
+        for (; k < width; ++k) {
+            dst[k] = std::max(a[k], b[k]);
+        }
+    }
+
+    // 靠近序列两端、邻域被截断的元素
+    void edgeMax(size_t i, size_t n, size_t width, size_t range, float* dst) {
+        std::fill(dst, dst + width, -std::numeric_limits<float>::infinity());
+        if (i > 0) {
+            windowMax(i >= range ? i - range : 0, i - 1, range, width, dst);
+        }
+        if (i + 1 < n) {
+            windowMax(i + 1, std::min(i + range, n - 1), range, width, dst);
+        }
+    }
+
+    // 把窗口[first, last]的最大值合并进dst，窗口长度不超过range，且只会在序列两端被截断
+    void windowMax(size_t first, size_t last, size_t range, size_t width, float* dst) const {
+        const float* suffix = suffix_.data() + first * width;
+        const float* prefix = prefix_.data() + last * width;
+        if (first / range != last / range) {
+            maxOf(dst, suffix, width, dst);
+            maxOf(dst, prefix, width, dst);
+        } else if (first % range == 0) {
+            maxOf(dst, prefix, width, dst);
+        } else {
+            maxOf(dst, suffix, width, dst);
+        }
+    }
+
+    std::vector<float> prefix_;   // 块内前缀最大值
+    std::vector<float> suffix_;   // 块内后缀最大值
+};
+
+} // namespace afp
@@ -1,5 +1,6 @@
 #include "channel_split_phase.h"
 #include <iostream>
+#include "base/state_stream.h"
 
 namespace afp {
 
@@ -12,7 +13,7 @@ ChannelSplitPhase::ChannelSplitPhase(SignatureGenerationPipelineCtx* ctx)
 
 #ifdef ENABLED_DIAGNOSE
     std::cout << "[DIAGNOSE-通道分离] ChannelSplitPhase 初始化: 通道数=" << ctx->channel_count 
-              << ", 采样率=" << ctx->sample_rate << "Hz, 每通道缓冲区大小=" 
+              << ", 采样率=" << ctx->format->sampleRate() << "Hz, 每通道缓冲区大小=" 
               << ctx->channel_buffer_sample_count << "样本" << std::endl;
 #endif
 }
@@ -33,6 +34,8 @@ void ChannelSplitPhase::handleAudioData(const void* buffer, size_t bufferSize, d
         return;
     }
 
+    PhaseTimer timer(ctx_->counters, ctx_->trace, PipelinePhase::ChannelSplit);
+
 #ifdef ENABLED_DIAGNOSE
     std::cout << "[DIAGNOSE-通道分离] 开始处理音频数据: 大小=" << bufferSize << "字节, 起始时间=" 
               << startTimestamp << "s, 帧大小=" << ctx_->format->frameSize() << "字节" << std::endl;
@@ -90,6 +93,7 @@ void ChannelSplitPhase::handleAudioData(const void* buffer, size_t bufferSize, d
             }
 #endif
             
+            ctx_->counters.addOut(PipelinePhase::ChannelSplit, ctx_->channel_buffer_sample_count * ctx_->channel_count);
             emphasisPhase_->handleSamples(ctx_->channel_samples, ctx_->channel_buffer_sample_count, currentTimestamp);
             
             // 重置写入位置
@@ -108,6 +112,8 @@ void ChannelSplitPhase::handleAudioData(const void* buffer, size_t bufferSize, d
         currentTimestamp += static_cast<double>(samplesProcessed) / sampleRate;
     }
 
+    ctx_->counters.addIn(PipelinePhase::ChannelSplit, totalProcessedSamples * ctx_->channel_count);
+
 #ifdef ENABLED_DIAGNOSE
     double processedDuration = static_cast<double>(totalProcessedSamples) / ctx_->format->sampleRate();
     std::cout << "[DIAGNOSE-通道分离] 处理完成: 总样本数=" << totalProcessedSamples 
@@ -117,9 +123,12 @@ void ChannelSplitPhase::handleAudioData(const void* buffer, size_t bufferSize, d
 }
 
 void ChannelSplitPhase::flush() { 
+    PhaseTimer timer(ctx_->counters, ctx_->trace, PipelinePhase::ChannelSplit);
+
     if (channelWritePositions_[0] > 0) {
         const auto sample_count = channelWritePositions_[0];
         
+        ctx_->counters.addOut(PipelinePhase::ChannelSplit, sample_count * ctx_->channel_count);
         emphasisPhase_->flush(ctx_->channel_samples, sample_count);
 
         for (size_t i = 0; i < ctx_->format->channels(); ++i) {
@@ -128,4 +137,20 @@ void ChannelSplitPhase::flush() {
     }
 }
 
-} // namespace afp
\ No newline at end of file
+void ChannelSplitPhase::saveState(StateWriter& writer) const {
+    // 各通道同步写入，写入位置相同
+    writer.writeVarint(channelWritePositions_[0]);
+    for (size_t i = 0; i < ctx_->channel_count; ++i) {
+        writer.writeFloats(ctx_->channel_samples[i], channelWritePositions_[0]);
+    }
+}
+
+void ChannelSplitPhase::restoreState(StateReader& reader) {
+    const size_t sample_count = reader.readCount(ctx_->channel_buffer_sample_count - 1);
+    for (size_t i = 0; i < ctx_->channel_count; ++i) {
+        reader.readFloats(ctx_->channel_samples[i], sample_count);
+        channelWritePositions_[i] = sample_count;
+    }
+}
+
+} // namespace afp
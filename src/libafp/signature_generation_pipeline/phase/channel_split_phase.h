@@ -20,6 +20,10 @@ public:
 
     void flush();
 
+    // 保存/恢复各通道缓冲区中尚未凑满一块的样本
+    void saveState(StateWriter& writer) const;
+    void restoreState(StateReader& reader);
+
 private:
     PCMReader pcmReader_;
     SignatureGenerationPipelineCtx* ctx_;
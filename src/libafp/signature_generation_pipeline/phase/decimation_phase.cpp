@@ -0,0 +1,122 @@
+#include "signature_generation_pipeline/phase/decimation_phase.h"
+#include <iostream>
+#include "base/memory_accounting.h"
+#include "base/state_stream.h"
+
+namespace afp {
+
+DecimationPhase::DecimationPhase(SignatureGenerationPipelineCtx* ctx)
+    : ctx_(ctx)
+    , fftPhase_(nullptr) {
+    output_samples_.fill(nullptr);
+    if (ctx_->decimation_factor <= 1) {
+        return;
+    }
+
+    const auto max_freq = ctx_->config->getPeakDetectionConfig().maxFreq;
+    for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
+        decimators_[channel_i] = std::make_unique<PolyphaseDecimator>(
+            ctx_->decimation_factor, ctx_->format->sampleRate(), max_freq);
+    }
+
+#ifdef ENABLED_DIAGNOSE
+    std::cout << "[DIAGNOSE-降采样] DecimationPhase 初始化: 降采样倍数=" << ctx_->decimation_factor
+              << ", 输入采样率=" << ctx_->format->sampleRate() << "Hz, 分析采样率=" << ctx_->sample_rate
+              << "Hz, 滤波器抽头数=" << decimators_[0]->tapCount() << std::endl;
+#endif
+}
+
+DecimationPhase::~DecimationPhase() = default;
+
+size_t DecimationPhase::memoryUsage() const {
+    size_t bytes = 0;
+    for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
+        if (decimators_[channel_i]) {
+            bytes += decimators_[channel_i]->memoryUsage();
+        }
+        bytes += heapBytes(output_buffers_[channel_i]);
+    }
+    return bytes;
+}
+
+void DecimationPhase::attach(FftPhase* fftPhase) {
+    fftPhase_ = fftPhase;
+}
+
+size_t DecimationPhase::decimate(ChannelArray<float*>& channel_samples, size_t sample_count) {
+    size_t output_count = 0;
+    for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
+        auto& decimator = *decimators_[channel_i];
+        auto& output = output_buffers_[channel_i];
+        output.resize(decimator.maxOutputCount(sample_count));
+        // 各通道的滤波器状态同步推进，输出数量相同
+        output_count = decimator.process(channel_samples[channel_i], sample_count, output.data());
+        output_samples_[channel_i] = output.data();
+    }
+    return output_count;
+}
+
+void DecimationPhase::handleSamples(ChannelArray<float*>& channel_samples, size_t sample_count, double start_timestamp) {
+    PhaseTimer timer(ctx_->counters, ctx_->trace, PipelinePhase::Decimation);
+    ctx_->counters.addIn(PipelinePhase::Decimation, sample_count * ctx_->channel_count);
+
+    if (ctx_->decimation_factor <= 1) {
+        ctx_->counters.addOut(PipelinePhase::Decimation, sample_count * ctx_->channel_count);
+        fftPhase_->handleSamples(channel_samples, sample_count, start_timestamp);
+        return;
+    }
+
+    // 输出第m个样本与输入第m*D个样本对齐，起始时间戳不变
+    const size_t output_count = decimate(channel_samples, sample_count);
+
+#ifdef ENABLED_DIAGNOSE
+    std::cout << "[DIAGNOSE-降采样] 输入样本数=" << sample_count << ", 输出样本数=" << output_count
+              << ", 起始时间=" << start_timestamp << "s" << std::endl;
+#endif
+
+    ctx_->counters.addOut(PipelinePhase::Decimation, output_count * ctx_->channel_count);
+    fftPhase_->handleSamples(output_samples_, output_count, start_timestamp);
+}
+
+void DecimationPhase::flush(ChannelArray<float*>& channel_samples, size_t sample_count) {
+    PhaseTimer timer(ctx_->counters, ctx_->trace, PipelinePhase::Decimation);
+    ctx_->counters.addIn(PipelinePhase::Decimation, sample_count * ctx_->channel_count);
+
+    if (ctx_->decimation_factor <= 1) {
+        ctx_->counters.addOut(PipelinePhase::Decimation, sample_count * ctx_->channel_count);
+        fftPhase_->flush(channel_samples, sample_count);
+        return;
+    }
+
+    // 处理最后一段输入后排空滤波器，尾部样本一起交给FFT阶段
+    const size_t output_count = decimate(channel_samples, sample_count);
+    size_t drained_count = 0;
+    for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
+        auto& decimator = *decimators_[channel_i];
+        auto& output = output_buffers_[channel_i];
+        output.resize(output_count + decimator.maxOutputCount(0));
+        drained_count = decimator.drain(output.data() + output_count);
+        output_samples_[channel_i] = output.data();
+    }
+
+    ctx_->counters.addOut(PipelinePhase::Decimation, (output_count + drained_count) * ctx_->channel_count);
+    fftPhase_->flush(output_samples_, output_count + drained_count);
+}
+
+void DecimationPhase::saveState(StateWriter& writer) const {
+    for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
+        if (decimators_[channel_i]) {
+            decimators_[channel_i]->saveState(writer);
+        }
+    }
+}
+
+void DecimationPhase::restoreState(StateReader& reader) {
+    for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
+        if (decimators_[channel_i]) {
+            decimators_[channel_i]->restoreState(reader);
+        }
+    }
+}
+
+} // namespace afp
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "signature_generation_pipeline/signature_generation_pipeline_ctx.h"
+#include "signature_generation_pipeline/phase/fft_phase.h"
+#include "audio/polyphase_decimator.h"
+#include "base/channel_array.h"
+#include <memory>
+#include <vector>
+
+namespace afp {
+
+// 位于预加重和FFT之间：按ctx的降采样倍数低通并降采样，降采样倍数为1时原样转发
+class DecimationPhase {
+
+public:
+    DecimationPhase(SignatureGenerationPipelineCtx* ctx);
+
+    ~DecimationPhase();
+
+    void attach(FftPhase* fftPhase);
+
+    void handleSamples(ChannelArray<float*>& channel_samples, size_t sample_count, double start_timestamp);
+
+    void flush(ChannelArray<float*>& channel_samples, size_t sample_count);
+
+    // 保存/恢复各通道降采样滤波器的输入历史，不降采样时没有状态
+    void saveState(StateWriter& writer) const;
+    void restoreState(StateReader& reader);
+
+    // 降采样滤波器和输出缓冲占用的内存（字节）
+    size_t memoryUsage() const;
+
+private:
+    // 降采样一段输入，结果写入output_samples_，返回每个通道的输出样本数
+    size_t decimate(ChannelArray<float*>& channel_samples, size_t sample_count);
+
+    SignatureGenerationPipelineCtx* ctx_;
+    FftPhase* fftPhase_;
+
+    ChannelArray<std::unique_ptr<PolyphaseDecimator>> decimators_;
+    ChannelArray<std::vector<float>> output_buffers_;
+    ChannelArray<float*> output_samples_;
+};
+
+} // namespace afp
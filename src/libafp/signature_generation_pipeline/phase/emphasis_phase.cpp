@@ -1,29 +1,43 @@
 #include "signature_generation_pipeline/phase/emphasis_phase.h"
+#include "audio/emphasis_kernels.h"
 #include <iostream>
+#include "base/state_stream.h"
 
 namespace afp {
 
+namespace {
+
+constexpr float kPreEmphasisCoefficient = 0.95f;
+
+} // namespace
+
 EmphasisPhase::EmphasisPhase(SignatureGenerationPipelineCtx* ctx)
     : ctx_(ctx) {
+    previous_samples_.fill(0.0f);
+
 #ifdef ENABLED_DIAGNOSE
-    std::cout << "[DIAGNOSE-预加重] EmphasisPhase 初始化: 通道数=" << ctx->channel_count << std::endl;
+    std::cout << "[DIAGNOSE-预加重] EmphasisPhase 初始化: 通道数=" << ctx->channel_count
+              << ", 预加重内核: " << preEmphasisSimdName() << std::endl;
 #endif
 }
 
 EmphasisPhase::~EmphasisPhase() = default;
 
-void EmphasisPhase::attach(FftPhase* fftPhase) {
-    fftPhase_ = fftPhase;
+void EmphasisPhase::attach(DecimationPhase* decimationPhase) {
+    decimationPhase_ = decimationPhase;
 }
 
 void EmphasisPhase::handleSamples(ChannelArray<float*>& channel_samples, size_t sample_count, double start_timestamp) {
+    PhaseTimer timer(ctx_->counters, ctx_->trace, PipelinePhase::Emphasis);
+    ctx_->counters.addIn(PipelinePhase::Emphasis, sample_count * ctx_->channel_count);
+
 #ifdef ENABLED_DIAGNOSE
     std::cout << "[DIAGNOSE-预加重] 开始处理样本: 样本数=" << sample_count 
               << ", 起始时间=" << start_timestamp << "s, 通道数=" << ctx_->channel_count << std::endl;
 #endif
 
     // 对输入的buffer按FFT Size进行切分，一旦积累到FFT Size的buffer，就进行预加重处理，处理之后传入下一个阶段
-    // 预加重处理：buffer[i] -= 0.95f * buffer[i-1];
+    // 预加重处理：y[i] = x[i] - 0.95f * x[i-1]，x[i-1]为原始样本，第一个样本接续上一批的最后一个样本
     // 预加重处理之后，传入下一个阶段
 
     for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
@@ -53,9 +67,7 @@ void EmphasisPhase::handleSamples(ChannelArray<float*>& channel_samples, size_t
         // std::cout << std::endl;
 #endif
 
-        for (size_t i = 1; i < sample_count; ++i) {
-            channel_sample[i] -= 0.95f * channel_sample[i-1];
-        }
+        previous_samples_[channel_i] = applyPreEmphasis(channel_sample, sample_count, kPreEmphasisCoefficient, previous_samples_[channel_i]);
 
 #ifdef ENABLED_DIAGNOSE
         // // 记录处理后的统计信息
@@ -87,21 +99,31 @@ void EmphasisPhase::handleSamples(ChannelArray<float*>& channel_samples, size_t
     }
 
 #ifdef ENABLED_DIAGNOSE
-    // std::cout << "[DIAGNOSE-预加重] 预加重处理完成，传递给FFT阶段" << std::endl;
+    // std::cout << "[DIAGNOSE-预加重] 预加重处理完成，传递给降采样阶段" << std::endl;
 #endif
 
-    fftPhase_->handleSamples(channel_samples, sample_count, start_timestamp);
+    ctx_->counters.addOut(PipelinePhase::Emphasis, sample_count * ctx_->channel_count);
+    decimationPhase_->handleSamples(channel_samples, sample_count, start_timestamp);
 }
 
 void EmphasisPhase::flush(ChannelArray<float*>& channel_samples, size_t sample_count) {
+    PhaseTimer timer(ctx_->counters, ctx_->trace, PipelinePhase::Emphasis);
+    ctx_->counters.addIn(PipelinePhase::Emphasis, sample_count * ctx_->channel_count);
+
     for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
-        float* channel_sample = channel_samples[channel_i];
-        for (size_t i = 0; i < sample_count; ++i) {
-            channel_sample[i] -= 0.95f * channel_sample[i-1];
-        }
+        previous_samples_[channel_i] = applyPreEmphasis(channel_samples[channel_i], sample_count, kPreEmphasisCoefficient, previous_samples_[channel_i]);
     }
 
-    fftPhase_->flush(channel_samples, sample_count);
+    ctx_->counters.addOut(PipelinePhase::Emphasis, sample_count * ctx_->channel_count);
+    decimationPhase_->flush(channel_samples, sample_count);
+}
+
+void EmphasisPhase::saveState(StateWriter& writer) const {
+    writer.writeFloats(previous_samples_.data(), ctx_->channel_count);
+}
+
+void EmphasisPhase::restoreState(StateReader& reader) {
+    reader.readFloats(previous_samples_.data(), ctx_->channel_count);
 }
 
-} // namespace afp
\ No newline at end of file
+} // namespace afp
@@ -1,7 +1,7 @@
 #pragma once
 
 #include "signature_generation_pipeline/signature_generation_pipeline_ctx.h"
-#include "signature_generation_pipeline/phase/fft_phase.h"
+#include "signature_generation_pipeline/phase/decimation_phase.h"
 #include "base/channel_array.h"
 
 namespace afp {
@@ -13,15 +13,22 @@ public:
 
     ~EmphasisPhase();
 
-    void attach(FftPhase* fftPhase);
+    void attach(DecimationPhase* decimationPhase);
 
     void handleSamples(ChannelArray<float*>& channel_samples, size_t sample_count, double start_timestamp);
 
     void flush(ChannelArray<float*>& channel_samples, size_t sample_count);
 
+    // 保存/恢复各通道上一批的最后一个原始样本
+    void saveState(StateWriter& writer) const;
+    void restoreState(StateReader& reader);
+
 private:
     SignatureGenerationPipelineCtx* ctx_;
-    FftPhase* fftPhase_;
+    DecimationPhase* decimationPhase_;
+
+    // 每个通道上一批的最后一个原始样本，第一批之前为0
+    ChannelArray<float> previous_samples_;
 };
 
 } // namespace afp
\ No newline at end of file
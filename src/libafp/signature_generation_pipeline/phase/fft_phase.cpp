@@ -1,13 +1,27 @@
 #include "fft_phase.h"
+#include <algorithm>
 #include <cmath>
 #include <iostream>
+#include "base/memory_accounting.h"
+#include "base/state_stream.h"
 
 namespace afp {
 
+namespace {
+
+const TraceEventDesc kFftWindowsTraceEvent = {"FftWindows", "pipeline", "windows", "first_timestamp", "last_timestamp"};
+
+} // namespace
+
 FftPhase::FftPhase(SignatureGenerationPipelineCtx* ctx)
     : ctx_(ctx) 
-    , fft_size_(ctx->config->getFFTConfig().fftSize)
-    , hop_size_(ctx->config->getFFTConfig().hopSize)
+    , fft_size_(ctx->fft_size)
+    , hop_size_(ctx->hop_size)
+    , magnitude_scale_(static_cast<float>(ctx->decimation_factor))
+    , log_magnitude_kernel_(selectLogMagnitudeKernel(ctx->config->getFFTConfig().fastLogMagnitude))
+    , frame_kernels_(selectFrameKernels(ctx->fft_size))
+    , silence_gate_energy_(ctx->config->getFFTConfig().silenceGateRms * ctx->config->getFFTConfig().silenceGateRms * ctx->fft_size)
+    , magnitude_quantization_bits_(ctx->config->getFFTConfig().magnitudeQuantizationBits)
     {
     // 初始化汉宁窗
     hanning_window_.resize(fft_size_);
@@ -15,23 +29,34 @@ FftPhase::FftPhase(SignatureGenerationPipelineCtx* ctx)
         hanning_window_[i] = 0.5f * (1.0f - std::cos(2.0f * M_PI * i / (fft_size_ - 1)));
     }
 
-    windowed_samples_.resize(fft_size_);
-    
-    // 初始化FFT缓冲区
-    fft_result_buffer_.resize(fft_size_);
+    // 初始化批量FFT缓冲区：实数输入每个窗口只输出非负频率的fft_size_/2+1个bin
+    batch_inputs_.reserve(fft_size_);
+    batch_outputs_.reserve(fft_size_ / 2 + 1);
 
-    fft_ = FFTFactory::create(fft_size_);
+    // 定点FFT不支持的大小退回平台默认的后端
+    if (ctx->config->getFFTConfig().fixedPointFft) {
+        fft_ = FFTFactory::createFixedPoint(fft_size_);
+    }
+    if (!fft_) {
+        fft_ = FFTFactory::create(fft_size_);
+    }
 
-    fft_results_.fill(std::vector<FFTResult>());
     for (size_t channel_i = 0; channel_i < ctx->channel_count; ++channel_i) {
-        ring_buffers_[channel_i] = std::make_unique<RingBuffer<float>>(fft_size_);
-        fft_results_[channel_i].reserve(fft_size_ / hop_size_);
+        ring_buffers_[channel_i] = std::make_unique<MirroredRingBuffer>(fft_size_);
+        short_frames_[channel_i] = std::make_unique<SpectrogramRing>(fft_size_ / hop_size_ + 1, fft_size_ / 2);
+        silence_gates_[channel_i].hop_energies.assign((fft_size_ + hop_size_ - 1) / hop_size_ + 1, 0.0f);
     }
 
 #ifdef ENABLED_DIAGNOSE
     std::cout << "[DIAGNOSE-FFT] FftPhase 初始化: FFT大小=" << fft_size_ 
               << ", hop大小=" << hop_size_ << ", 通道数=" << ctx->channel_count 
               << ", 采样率=" << ctx->sample_rate << "Hz" << std::endl;
+    std::cout << "[DIAGNOSE-FFT] 帧内核: " << (frame_kernels_.specialized ? "fixed" : "generic") << std::endl;
+    std::cout << "[DIAGNOSE-FFT] 静音门限: 窗口能量<" << silence_gate_energy_ << std::endl;
+    std::cout << "[DIAGNOSE-FFT] 对数幅度内核: "
+              << (ctx->config->getFFTConfig().fastLogMagnitude ? logMagnitudeSimdName() : "exact") << std::endl;
+    std::cout << "[DIAGNOSE-FFT] 定点FFT: " << (ctx->config->getFFTConfig().fixedPointFft ? "是" : "否")
+              << ", 幅度量化位数: " << magnitude_quantization_bits_ << std::endl;
     std::cout << "[DIAGNOSE-FFT] 窗函数设置完成，前5个汉宁窗系数: ";
     for (size_t i = 0; i < std::min<size_t>(5, fft_size_); ++i) {
         std::cout << hanning_window_[i] << " ";
@@ -40,12 +65,30 @@ FftPhase::FftPhase(SignatureGenerationPipelineCtx* ctx)
 #endif
 }
 
-void FftPhase::attach(PeakDetectionPhase* peakDetectionPhase) {
-    peakDetectionPhase_ = peakDetectionPhase;
+void FftPhase::attach(IShortFrameConsumer* shortFrameConsumer) {
+    shortFrameConsumer_ = shortFrameConsumer;
 }
 
 FftPhase::~FftPhase() = default;
 
+size_t FftPhase::ringBufferMemoryUsage() const {
+    size_t bytes = 0;
+    for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
+        bytes += ring_buffers_[channel_i]->memoryUsage();
+    }
+    return bytes;
+}
+
+size_t FftPhase::memoryUsage() const {
+    size_t bytes = heapBytes(hanning_window_) + heapBytes(pending_windows_) +
+                   heapBytes(batch_inputs_) + heapBytes(batch_outputs_);
+    for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
+        bytes += heapBytes(silence_gates_[channel_i].hop_energies);
+        bytes += short_frames_[channel_i]->memoryUsage();
+    }
+    return bytes;
+}
+
 void FftPhase::handleSamples(ChannelArray<float*>& channel_samples, size_t sample_count, double start_timestamp) {
     if (!has_current_timestamp_) {
         current_timestamp_ = start_timestamp;
@@ -61,15 +104,14 @@ void FftPhase::handleSamples(ChannelArray<float*>& channel_samples, size_t sampl
 }
 
 void FftPhase::handleSamplesImpl(ChannelArray<float*>& channel_samples, size_t sample_count) {
-    for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
-        fft_results_[channel_i].clear();
-    }
+    PhaseTimer timer(ctx_->counters, ctx_->trace, PipelinePhase::Fft);
+    ctx_->counters.addIn(PipelinePhase::Fft, sample_count * ctx_->channel_count);
 
     for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
         float* samples = channel_samples[channel_i];
         size_t samples_remaining = sample_count;
         size_t sample_offset = 0;
-        RingBuffer<float>* ring_buffer = ring_buffers_[channel_i].get();
+        MirroredRingBuffer* ring_buffer = ring_buffers_[channel_i].get();
 
         size_t fft_count_for_channel = 0;
 
@@ -89,6 +131,7 @@ void FftPhase::handleSamplesImpl(ChannelArray<float*>& channel_samples, size_t s
             
             sample_offset += samples_written;
             samples_remaining -= samples_written;
+            silence_gates_[channel_i].unscanned += samples_written;
             
             // 如果ring buffer已满，执行FFT处理
             if (ring_buffer->full()) {
@@ -104,7 +147,11 @@ void FftPhase::handleSamplesImpl(ChannelArray<float*>& channel_samples, size_t s
                 std::cout << "  窗口长度=" << (static_cast<double>(hop_size_) / ctx_->sample_rate) << "s" << std::endl;
 #endif
                 
-                processFFTWindow(channel_i, window_start_timestamp);
+                if (isSilentWindow(channel_i)) {
+                    pending_windows_.push_back(PendingWindow{channel_i, window_start_timestamp, true});
+                } else {
+                    gatherFFTWindow(channel_i, window_start_timestamp);
+                }
                 
                 // 移动窗口（移除hop_size_个样本）
                 ring_buffer->moveWindow(hop_size_);
@@ -120,100 +167,179 @@ void FftPhase::handleSamplesImpl(ChannelArray<float*>& channel_samples, size_t s
         }
 
 #ifdef ENABLED_DIAGNOSE
-        std::cout << "[DIAGNOSE-FFT] 通道" << channel_i << "处理完成，共执行" << fft_count_for_channel 
-                  << "次FFT，生成" << fft_results_[channel_i].size() << "个FFT结果" << std::endl;
+        std::cout << "[DIAGNOSE-FFT] 通道" << channel_i << "处理完成，共收集" << fft_count_for_channel 
+                  << "个FFT窗口" << std::endl;
 #endif
     }
 
+    ctx_->counters.addOut(PipelinePhase::Fft, pending_windows_.size());
+    PipelineCounters::add(ctx_->counters.silent_windows, pending_windows_.size() - pending_transform_count_);
+    if (!pending_windows_.empty()) {
+        ctx_->trace.instant(kFftWindowsTraceEvent, static_cast<uint32_t>(pending_windows_.size()),
+                            pending_windows_.front().timestamp, pending_windows_.back().timestamp);
+    }
+
+    transformPendingWindows();
+
+    ChannelArray<SpectrogramView> short_frame_views;
+    for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
+        short_frame_views[channel_i] = short_frames_[channel_i]->view();
+    }
+
 #ifdef ENABLED_DIAGNOSE
     size_t total_fft_results = 0;
     for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
-        total_fft_results += fft_results_[channel_i].size();
+        total_fft_results += short_frame_views[channel_i].size();
     }
     std::cout << "[DIAGNOSE-FFT] FFT处理完成，总共生成" << total_fft_results 
               << "个FFT结果，传递给峰值检测阶段, FFT结果详情:";
     for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
-        std::cout << "通道" << channel_i << ": " << fft_results_[channel_i].size() << "个FFT结果, 详情:[";
-        for (const auto& fft_result : fft_results_[channel_i]) {
-            std::cout << fft_result.timestamp << "s ";
+        const auto& view = short_frame_views[channel_i];
+        std::cout << "通道" << channel_i << ": " << view.size() << "个FFT结果, 详情:[";
+        for (size_t i = 0; i < view.size(); ++i) {
+            std::cout << view.timestamp(i) << "s ";
         }
         std::cout << "]" << std::endl;
     }
 #endif
 
-    peakDetectionPhase_->handleShortFrames(fft_results_);
+    shortFrameConsumer_->handleShortFrames(short_frame_views);
 }
 
 
-void FftPhase::processFFTWindow(size_t channel_i, double timestamp) {
-    // 从ring buffer读取数据并应用窗函数
-    ring_buffers_[channel_i]->read(windowed_samples_.data(), fft_size_);
+void FftPhase::gatherFFTWindow(size_t channel_i, double timestamp) {
+    // 窗口追加到本批的输入末尾，记录所属通道和时间戳，变换在所有通道收集完之后一次完成
+    const size_t offset = pending_transform_count_ * fft_size_;
+    pending_windows_.push_back(PendingWindow{channel_i, timestamp, false});
+    ++pending_transform_count_;
+    batch_inputs_.resize(offset + fft_size_);
+    float* windowed_samples = batch_inputs_.data() + offset;
+
+    // ring buffer中的窗口是连续的，直接从中读取
+    const float* samples = ring_buffers_[channel_i]->data();
 
 #ifdef ENABLED_DIAGNOSE
     // 计算应用窗函数前的统计信息
     float pre_window_energy = 0.0f;
     for (size_t i = 0; i < fft_size_; ++i) {
-        pre_window_energy += windowed_samples_[i] * windowed_samples_[i];
+        pre_window_energy += samples[i] * samples[i];
     }
     
     std::cout << "[DIAGNOSE-FFT] 通道" << channel_i << "FFT窗口处理: 窗口开始时间戳=" << timestamp 
               << "s, 窗函数前能量=" << pre_window_energy << std::endl;
 #endif
     
-    // 应用汉宁窗
-    for (size_t i = 0; i < fft_size_; ++i) {
-        windowed_samples_[i] *= hanning_window_[i];
-    }
+    // 应用汉宁窗，与读取合并为一次遍历
+    frame_kernels_.apply_window(samples, hanning_window_.data(), fft_size_, windowed_samples);
 
 #ifdef ENABLED_DIAGNOSE
     // 计算应用窗函数后的统计信息
     float post_window_energy = 0.0f;
     for (size_t i = 0; i < fft_size_; ++i) {
-        post_window_energy += windowed_samples_[i] * windowed_samples_[i];
+        post_window_energy += windowed_samples[i] * windowed_samples[i];
     }
     
     // std::cout << "[DIAGNOSE-FFT] 通道" << channel_i << "应用汉宁窗后能量=" << post_window_energy 
     //           << ", 能量衰减比=" << (pre_window_energy > 0 ? post_window_energy / pre_window_energy : 0) << std::endl;
 #endif
     
-    // 执行FFT
-    if (!fft_->transform(windowed_samples_.data(), fft_result_buffer_.data())) {
+}
+
+bool FftPhase::isSilentWindow(size_t channel_i) {
+    if (silence_gate_energy_ <= 0.0f) {
+        return false;
+    }
+
+    // 新写入的样本在窗口末尾，第一个窗口时是整个窗口，之后是一个帧移
+    auto& gate = silence_gates_[channel_i];
+    const float* samples = ring_buffers_[channel_i]->data();
+    float hop_energy = 0.0f;
+    for (size_t i = fft_size_ - std::min(gate.unscanned, fft_size_); i < fft_size_; ++i) {
+        hop_energy += samples[i] * samples[i];
+    }
+    gate.unscanned = 0;
+    gate.hop_energies[gate.next] = hop_energy;
+    gate.next = (gate.next + 1) % gate.hop_energies.size();
+
+    float window_energy = 0.0f;
+    for (float energy : gate.hop_energies) {
+        window_energy += energy;
+    }
+
 #ifdef ENABLED_DIAGNOSE
-        std::cout << "[DIAGNOSE-FFT] 通道" << channel_i << "FFT变换失败！" << std::endl;
+    if (window_energy < silence_gate_energy_) {
+        std::cout << "[DIAGNOSE-FFT] 通道" << channel_i << "窗口能量上界=" << window_energy 
+                  << "低于静音门限，跳过FFT" << std::endl;
+    }
 #endif
+
+    return window_energy < silence_gate_energy_;
+}
+
+void FftPhase::transformPendingWindows() {
+    // 短帧缓冲只保存本批的结果，容量按本批各通道的窗口数增长，稳定后不再分配
+    ChannelArray<size_t> window_counts;
+    window_counts.fill(0);
+    for (const auto& window : pending_windows_) {
+        ++window_counts[window.channel];
+    }
+    for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
+        short_frames_[channel_i]->reserve(window_counts[channel_i]);
+        short_frames_[channel_i]->reset();
+    }
+
+    if (pending_windows_.empty()) {
+        return;
+    }
+
+    // 本批所有通道、所有就绪窗口一次变换，静音窗口不参与
+    const size_t bins = fft_size_ / 2 + 1;
+    batch_outputs_.resize(pending_transform_count_ * bins);
+    if (pending_transform_count_ > 0 &&
+        !fft_->transformBatch(batch_inputs_.data(), pending_transform_count_, batch_outputs_.data())) {
+#ifdef ENABLED_DIAGNOSE
+        std::cout << "[DIAGNOSE-FFT] 批量FFT变换失败，丢弃" << pending_windows_.size() << "个窗口！" << std::endl;
+#endif
+        pending_windows_.clear();
+        pending_transform_count_ = 0;
         return;  // TODO: 错误处理
     }
 
-    FFTResult fftResult;  // TTFResult 可以叫做ShortFrame
-    fftResult.magnitudes.resize(fft_size_ / 2);
-    fftResult.frequencies.resize(fft_size_ / 2);
-    fftResult.timestamp = timestamp;
+    size_t transform_i = 0;
+    for (const auto& window : pending_windows_) {
+        if (window.silent) {
+            short_frames_[window.channel]->pushSilent(window.timestamp);
+            continue;
+        }
+        buildShortFrame(window.channel, window.timestamp, batch_outputs_.data() + transform_i * bins);
+        ++transform_i;
+    }
+    pending_windows_.clear();
+    pending_transform_count_ = 0;
+}
+
+void FftPhase::buildShortFrame(size_t channel_i, double timestamp, const std::complex<float>* spectrum) {
+    // 幅度谱直接写入短帧缓冲，频率由ctx_->bin_frequencies统一给出
+    float* magnitudes = short_frames_[channel_i]->pushBack(timestamp);
+
+    // 计算对数幅度谱
+    log_magnitude_kernel_(spectrum, fft_size_ / 2, magnitude_scale_, magnitudes);
+    if (magnitude_quantization_bits_ != 0) {
+        quantizeMagnitudes(magnitudes, fft_size_ / 2, magnitude_quantization_bits_);
+    }
 
 #ifdef ENABLED_DIAGNOSE
     float max_magnitude = 0.0f;
     float total_magnitude = 0.0f;
     size_t valid_bins = 0;
-#endif
-    
-    // 计算幅度谱和频率
     for (size_t i = 0; i < fft_size_ / 2; ++i) {
-        // 计算复数的模
-        float magnitude = std::abs(fft_result_buffer_[i]);
-        
-        // 对数频谱，保持绝对值以确保不同短帧之间的可比性
-        fftResult.magnitudes[i] = magnitude > 0.00001f ? 20.0f * std::log10(magnitude) + 100.0f : 0;
-        
-        // 计算每个bin对应的频率
-        fftResult.frequencies[i] = i * static_cast<float>(ctx_->format->sampleRate()) / static_cast<float>(fft_size_);
-
-#ifdef ENABLED_DIAGNOSE
-        if (fftResult.magnitudes[i] > 0) {
-            max_magnitude = std::max(max_magnitude, fftResult.magnitudes[i]);
-            total_magnitude += fftResult.magnitudes[i];
+        if (magnitudes[i] > 0) {
+            max_magnitude = std::max(max_magnitude, magnitudes[i]);
+            total_magnitude += magnitudes[i];
             valid_bins++;
         }
-#endif
     }
+#endif
 
 #ifdef ENABLED_DIAGNOSE
     // float avg_magnitude = (valid_bins > 0) ? total_magnitude / valid_bins : 0;
@@ -227,20 +353,41 @@ void FftPhase::processFFTWindow(size_t channel_i, double timestamp) {
     // for (size_t freq : key_freqs) {
     //     size_t bin = freq * fft_size_ / ctx_->format->sampleRate();
     //     if (bin < fft_size_ / 2) {
-    //         std::cout << freq << "Hz(" << fftResult.magnitudes[bin] << ") ";
+    //         std::cout << freq << "Hz(" << magnitudes[bin] << ") ";
     //     }
     // }
     // std::cout << std::endl;
 #endif
-    
-    // 将FFT结果存储到vector中
-    fft_results_[channel_i].push_back(std::move(fftResult));
 }
 
 void FftPhase::flush(ChannelArray<float*>& channel_samples, size_t sample_count) {
     handleSamplesImpl(channel_samples, sample_count);
 
-    peakDetectionPhase_->flush();
+    shortFrameConsumer_->flush();
+}
+
+void FftPhase::saveState(StateWriter& writer) const {
+    writer.writeBool(has_current_timestamp_);
+    writer.writeDouble(current_timestamp_);
+    for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
+        ring_buffers_[channel_i]->saveState(writer);
+        const auto& gate = silence_gates_[channel_i];
+        writer.writeFloats(gate.hop_energies.data(), gate.hop_energies.size());
+        writer.writeVarint(gate.next);
+        writer.writeVarint(gate.unscanned);
+    }
+}
+
+void FftPhase::restoreState(StateReader& reader) {
+    has_current_timestamp_ = reader.readBool();
+    current_timestamp_ = reader.readDouble();
+    for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
+        ring_buffers_[channel_i]->restoreState(reader);
+        auto& gate = silence_gates_[channel_i];
+        reader.readFloats(gate.hop_energies.data(), gate.hop_energies.size());
+        gate.next = reader.readCount(gate.hop_energies.size() - 1);
+        gate.unscanned = reader.readCount(fft_size_);
+    }
 }
 
-} // namespace afp
\ No newline at end of file
+} // namespace afp
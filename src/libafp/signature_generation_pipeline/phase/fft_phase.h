@@ -1,11 +1,13 @@
 #pragma once
 
 #include "signature_generation_pipeline/signature_generation_pipeline_ctx.h"
-#include "signature_generation_pipeline/phase/peak_detection_phase.h"
+#include "signature_generation_pipeline/phase/short_frame_consumer.h"
 #include "base/channel_array.h"
-#include "base/ring_buffer.h"
-#include "base/fft_result.h"
+#include "base/mirrored_ring_buffer.h"
+#include "base/spectrogram_ring.h"
 #include "fft/fft_interface.h"
+#include "audio/log_magnitude_kernels.h"
+#include "audio/frame_kernels.h"
 
 namespace afp {
 
@@ -16,34 +18,83 @@ public:
 
     ~FftPhase();
     
-    void attach(PeakDetectionPhase* peakDetectionPhase);
+    // 同步模式下连接峰值检测阶段，线程模式下连接ShortFrameHandoff
+    void attach(IShortFrameConsumer* shortFrameConsumer);
 
 
     void handleSamples(ChannelArray<float*>& channel_samples, size_t sample_count, double start_timestamp);
 
     void flush(ChannelArray<float*>& channel_samples, size_t sample_count);
 
+    // 样本环形缓冲占用的内存（字节）
+    size_t ringBufferMemoryUsage() const;
+
+    // 窗函数、批处理缓冲、静音门限和短帧占用的内存（字节），不含样本环形缓冲和FFT后端内部的内存
+    size_t memoryUsage() const;
+
+    // 保存/恢复样本环形缓冲、静音门限的能量历史和短帧时间戳；本批的窗口和短帧在调用之间总是为空，不保存
+    void saveState(StateWriter& writer) const;
+    void restoreState(StateReader& reader);
+
 private:
     void handleSamplesImpl(ChannelArray<float*>& channel_samples, size_t sample_count);
 
-    // Process one FFT window from ring buffer
-    void processFFTWindow(size_t channel_i, double timestamp);
+    // 从ring buffer取出一个窗口，加窗后加入本批待变换的窗口
+    void gatherFFTWindow(size_t channel_i, double timestamp);
+
+    // 累加ring buffer中新写入样本的能量，判断当前窗口是否低于静音门限
+    bool isSilentWindow(size_t channel_i);
+
+    // 批量变换本批收集的所有窗口，按收集顺序生成短帧
+    void transformPendingWindows();
+
+    // 由一个窗口的频谱生成幅度谱，追加到该通道的短帧缓冲
+    void buildShortFrame(size_t channel_i, double timestamp, const std::complex<float>* spectrum);
 private:
     SignatureGenerationPipelineCtx* ctx_;
-    PeakDetectionPhase* peakDetectionPhase_;
+    IShortFrameConsumer* shortFrameConsumer_;
 
     const size_t fft_size_;
     std::vector<float> hanning_window_;
-    std::vector<float> windowed_samples_;
     std::unique_ptr<FFTInterface> fft_;
-    std::vector<std::complex<float>> fft_result_buffer_;  // Complex buffer for FFT output
+
+    // 本批待变换的窗口
+    struct PendingWindow {
+        size_t channel;
+        double timestamp;
+        bool silent;            // 低于静音门限，不做变换，直接生成静音帧
+    };
+    std::vector<PendingWindow> pending_windows_;
+    size_t pending_transform_count_ = 0;              // 本批需要变换的窗口数
+    std::vector<float> batch_inputs_;                 // 各窗口加窗后的样本，依次存放
+    std::vector<std::complex<float>> batch_outputs_;  // 各窗口的fft_size_/2+1个bin，依次存放
     const size_t hop_size_;
+    // 降采样后窗口内的样本数按倍数减少，幅度按倍数补偿，使峰值阈值与不降采样时一致
+    const float magnitude_scale_;
+    // 复数频谱 -> 对数幅度谱的内核，由配置选择精确或向量化的近似版本
+    const LogMagnitudeKernel log_magnitude_kernel_;
+    // 按FFT大小特化的加窗内核
+    const FrameKernels frame_kernels_;
+    // 窗口能量门限（silenceGateRms^2 * fft_size_），0表示关闭
+    const float silence_gate_energy_;
+    // 对数幅度的量化位数，0表示不量化
+    const uint32_t magnitude_quantization_bits_;
+
+    // 每个通道最近几次帧移写入的样本能量，窗口能量取它们的和
+    // 覆盖的样本不少于一个窗口，得到的是窗口能量的上界，只会少判静音而不会误判
+    struct SilenceGate {
+        std::vector<float> hop_energies;
+        size_t next = 0;
+        size_t unscanned = 0;   // ring buffer中还没有计入能量的最新样本数
+    };
+    ChannelArray<SilenceGate> silence_gates_;
     
     // Ring buffer for overlapping windows
-    ChannelArray<RingBufferPtr<float>> ring_buffers_;
+    // 镜像存储，窗口总是连续的，加窗时直接从中读取
+    ChannelArray<MirroredRingBufferPtr> ring_buffers_;
     
-    // Storage for FFT results
-    ChannelArray<std::vector<FFTResult>> fft_results_;
+    // 本批生成的短帧（幅度谱），以视图的形式传给峰值检测阶段
+    ChannelArray<std::unique_ptr<SpectrogramRing>> short_frames_;
 
     double current_timestamp_ = 0.0;
     bool has_current_timestamp_ = false;
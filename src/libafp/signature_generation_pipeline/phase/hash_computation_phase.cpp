@@ -1,10 +1,49 @@
 #include "hash_computation_phase.h"
 #include <iostream>
 #include <algorithm>
+#include <cmath>
+#include <limits>
 #include "base/scored_triple_frame_combination.h"
+#include "base/memory_accounting.h"
+#include "base/state_stream.h"
 
 namespace afp {
 
+namespace {
+
+const TraceEventDesc kSignaturePointsTraceEvent = {"SignaturePoints", "pipeline", "points", "first_timestamp", "last_timestamp"};
+
+// 对columns中与frequency的频率差绝对值在[min_delta, max_delta]内的峰值区间依次调用fn(begin, end)
+// columns按频率升序，符合条件的峰值是至多两段连续区间，用二分查找定位
+template<typename Fn>
+void forEachFreqDeltaSpan(
+    const PeakColumns& columns,
+    uint32_t frequency, size_t min_delta, size_t max_delta, Fn&& fn) {
+
+    const auto visit = [&](int64_t low, int64_t high) {
+        const size_t begin = columns.lowerBound(low);
+        const size_t end = columns.upperBound(high);
+        if (begin < end) {
+            fn(begin, end);
+        }
+    };
+
+    const int64_t f = frequency;
+    const int64_t below_low = f - static_cast<int64_t>(max_delta);
+    const int64_t below_high = f - static_cast<int64_t>(min_delta);
+    const int64_t above_low = f + static_cast<int64_t>(min_delta);
+    const int64_t above_high = f + static_cast<int64_t>(max_delta);
+    if (above_low <= below_high) {
+        // min_delta为0时两段相接，合并为一段，避免重复访问
+        visit(below_low, above_high);
+    } else {
+        visit(below_low, below_high);
+        visit(above_low, above_high);
+    }
+}
+
+} // namespace
+
 HashComputationPhase::HashComputationPhase(SignatureGenerationPipelineCtx* ctx)
     : ctx_(ctx)
     , symmetric_frame_range_(ctx_->config->getSignatureGenerationConfig().symmetricFrameRange)
@@ -18,6 +57,10 @@ HashComputationPhase::HashComputationPhase(SignatureGenerationPipelineCtx* ctx)
     const auto max_signature_point_count_per_channel = ctx_->config->getSignatureGenerationConfig().maxTripleFrameCombinations * symmetric_frame_range_;
     existing_triple_frame_combinations_.reserve(max_signature_point_count_per_channel * ctx_->channel_count);
     signature_points_.reserve(max_signature_point_count_per_channel * ctx_->channel_count);
+    for (size_t i = 0; i < ctx_->channel_count; i++) {
+        channel_signature_points_[i].reserve(max_signature_point_count_per_channel);
+        triple_frame_scratches_[i].top_combinations.reserve(signature_generation_config_.maxTripleFrameCombinations);
+    }
 
 #ifdef ENABLED_DIAGNOSE
     std::cout << "[DIAGNOSE-哈希计算] HashComputationPhase 初始化:" << std::endl;
@@ -33,7 +76,26 @@ HashComputationPhase::HashComputationPhase(SignatureGenerationPipelineCtx* ctx)
 #endif
 }
 
+size_t HashComputationPhase::memoryUsage() const {
+    size_t bytes = existing_triple_frame_combinations_.memoryUsage() + heapBytes(signature_points_);
+    for (size_t channel = 0; channel < ctx_->channel_count; ++channel) {
+        bytes += heapBytes(channel_signature_points_[channel]);
+        bytes += frame_ring_buffers_[channel]->memoryUsage([](const Frame& frame) {
+            return heapBytes(frame.peaks);
+        });
+        const auto& scratch = triple_frame_scratches_[channel];
+        bytes += scratch.frame1_columns.memoryUsage() + scratch.frame3_columns.memoryUsage() +
+                 heapBytes(scratch.span_scores) + heapBytes(scratch.top_combinations);
+    }
+    return bytes;
+}
+
 void HashComputationPhase::handleFrame(ChannelArray<std::vector<Frame>>& channel_long_frames) {
+    PhaseTimer timer(ctx_->counters, ctx_->trace, PipelinePhase::HashComputation);
+    for (size_t i = 0; i < ctx_->channel_count; i++) {
+        ctx_->counters.addIn(PipelinePhase::HashComputation, channel_long_frames[i].size());
+    }
+
 #ifdef ENABLED_DIAGNOSE
     size_t total_frames = 0;
     for (size_t i = 0; i < ctx_->channel_count; i++) {
@@ -51,7 +113,8 @@ void HashComputationPhase::handleFrame(ChannelArray<std::vector<Frame>>& channel
     }
 #endif
 
-    for (size_t i = 0; i < ctx_->channel_count; i++) {
+    // 各通道的长帧缓冲相互独立，可按通道并行处理
+    ctx_->forEachChannel([&](size_t i) {
         auto& long_frames = channel_long_frames[i];
 
         for (auto& frame : long_frames) {
@@ -62,7 +125,17 @@ void HashComputationPhase::handleFrame(ChannelArray<std::vector<Frame>>& channel
                       << "/" << frame_ring_buffers_[i]->capacity() << std::endl;
 #endif
             
-            frame_ring_buffers_[i]->push(frame);
+            // 长帧交换进环形缓冲区，frame换回被覆盖的旧长帧，其峰值数组由长帧构建阶段回收复用
+            frame_ring_buffers_[i]->push(std::move(frame));
+
+            if (ctx_->low_latency) {
+                // 每个三帧组合在其右侧帧到达时立即生成，缓冲区只用于保留左侧帧和锚点帧
+                consumeNewestFrame(i);
+                if (frame_ring_buffers_[i]->full()) {
+                    frame_ring_buffers_[i]->pop();
+                }
+                continue;
+            }
 
             if (frame_ring_buffers_[i]->full()) {
 #ifdef ENABLED_DIAGNOSE
@@ -72,7 +145,9 @@ void HashComputationPhase::handleFrame(ChannelArray<std::vector<Frame>>& channel
                 frame_ring_buffers_[i]->pop();
             }
         }
-    }
+    });
+
+    collectSignaturePoints();
 
 #ifdef ENABLED_DIAGNOSE
     std::cout << "[DIAGNOSE-哈希计算] 本轮生成指纹点数: " << signature_points_.size() << std::endl;
@@ -80,13 +155,40 @@ void HashComputationPhase::handleFrame(ChannelArray<std::vector<Frame>>& channel
 #endif
 
     if (signature_points_.size() > 0) {
-        ctx_->on_signature_points_generated(signature_points_);
+        ctx_->counters.addOut(PipelinePhase::HashComputation, signature_points_.size());
+        ctx_->trace.instant(kSignaturePointsTraceEvent, static_cast<uint32_t>(signature_points_.size()),
+                            signature_points_.front().timestamp, signature_points_.back().timestamp);
+        {
+            PhaseTimer delivery_timer(ctx_->counters, ctx_->trace, PipelinePhase::Delivery);
+            ctx_->on_signature_points_generated(signature_points_);
+        }
         
         existing_triple_frame_combinations_.clear();
         signature_points_.clear();
     }
 }
 
+void HashComputationPhase::collectSignaturePoints() {
+    // 按通道顺序去重合并，结果与逐通道依次计算时相同
+    for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
+        for (const auto& signaturePoint : channel_signature_points_[channel_i]) {
+            // Add to visualization data if enabled
+            if (ctx_->visualization_config->collectVisualizationData_) {
+                ctx_->visualization_config->addFingerprintPoint(
+                    signaturePoint.frequency, 
+                    signaturePoint.timestamp, 
+                    signaturePoint.hash
+                );
+            }
+
+            if (existing_triple_frame_combinations_.insert(signaturePoint.hash, signaturePoint.timestamp)) {
+                signature_points_.push_back(signaturePoint);
+            }
+        }
+        channel_signature_points_[channel_i].clear();
+    }
+}
+
 void HashComputationPhase::consumeFrame(size_t channel) {
 
     auto& ring_buffer = frame_ring_buffers_[channel];
@@ -106,8 +208,9 @@ void HashComputationPhase::consumeFrame(size_t channel) {
     }
 #endif
 
-    // 生成对称的三帧组合：从(x-n, x, x+n)到(x-1, x, x+1)
-    for (size_t distance = 1; distance <= symmetric_frame_range_; distance++) {
+    // 生成对称的三帧组合：从(x-n, x, x+n)到(x-1, x, x+1)，n按当前降级级别生效
+    const size_t frameRange = ctx_->symmetricFrameRange();
+    for (size_t distance = 1; distance <= frameRange; distance++) {
     size_t frame1Index = anchorIndex - distance;  // 左侧帧
     size_t frame2Index = anchorIndex;             // 锚点帧
     size_t frame3Index = anchorIndex + distance;  // 右侧帧
@@ -132,207 +235,57 @@ void HashComputationPhase::consumeFrame(size_t channel) {
         continue;
     }
 
-    // 统计不同原因的过滤数量
-    size_t totalPossibleCombinations = 0;
-    size_t filteredByFreqDelta1_min = 0;
-    size_t filteredByFreqDelta1_max = 0;
-    size_t filteredByTimeDelta1 = 0;
-    size_t filteredByFreqDelta2 = 0;
-    size_t filteredByTimeDelta2 = 0;
-    size_t filteredByFreqDeltaSimilarity = 0;
-    size_t filteredByLowScore = 0;
-    size_t validCombinations = 0;
-    size_t acceptedCombinations = 0;
-
-    // 潜在组合总数
-    size_t theoreticalCombinations = frame1.peaks.size() * frame2.peaks.size() * frame3.peaks.size();
+    totalAcceptedCombinations += processTripleFrameCombination(frame1, frame2, frame3, channel, anchorIndex, distance);
+    }
 
 #ifdef ENABLED_DIAGNOSE
-    std::cout << "[DIAGNOSE-哈希计算] 通道" << channel << "锚点" << anchorIndex  << "，距离" << distance << "，"
-              << "理论可能的峰值组合数: " << theoreticalCombinations << " (帧1:"
-              << frame1.peaks.size() << "峰值, 帧2:" << frame2.peaks.size() 
-              << "峰值, 帧3:" << frame3.peaks.size() << "峰值)" << std::endl;
+    std::cout << "[DIAGNOSE-哈希计算] 通道" << channel << "消费帧完成，总接受组合数: " 
+              << totalAcceptedCombinations << ", 本通道候选指纹点数: " 
+              << channel_signature_points_[channel].size() << std::endl;
 #endif
+}
 
-    // 收集所有有效的峰值组合并计算评分
-    std::vector<ScoredTripleFrameCombination> validCombinationsVec;
-
-    // 从中间帧选择锚点峰值
-    for (const auto& anchorPeak : frame2.peaks) {
-        // 从第一帧（最旧）和第三帧（最新）中选择目标峰值
-        for (const auto& targetPeak1 : frame1.peaks) {
-            // 计算所有可能的组合数
-            totalPossibleCombinations += frame3.peaks.size();
-            
-            // 计算第一个频率差并检查是否在有效范围内
-            int32_t freqDelta1 = static_cast<int32_t>(anchorPeak.frequency) - static_cast<int32_t>(targetPeak1.frequency);
-            if (std::abs(freqDelta1) < signature_generation_config_.minFreqDelta) {
-                filteredByFreqDelta1_min += frame3.peaks.size();
-                continue; // 跳过频率差太小
-            }
-            if (std::abs(freqDelta1) > signature_generation_config_.maxFreqDelta) {
-                filteredByFreqDelta1_max += frame3.peaks.size();
-                continue; // 跳过频率差太大
-            }
-            
-            // 检查时间差是否在有效范围内
-            double timeDelta1 = anchorPeak.timestamp - targetPeak1.timestamp;
-            if (std::abs(timeDelta1) > signature_generation_config_.maxTimeDelta) {
-                filteredByTimeDelta1 += frame3.peaks.size();
-                continue; // 跳过时间差太大的配对
-            }
-
-            for (const auto& targetPeak2 : frame3.peaks) {
-                // 计算第二个频率差并检查是否在有效范围内
-                int32_t freqDelta2 = static_cast<int32_t>(targetPeak2.frequency) - static_cast<int32_t>(anchorPeak.frequency);
-                if (std::abs(freqDelta2) < signature_generation_config_.minFreqDelta || 
-                    std::abs(freqDelta2) > signature_generation_config_.maxFreqDelta) {
-                    filteredByFreqDelta2++;
-                    continue; // 跳过频率差太小或太大的配对
-                }
-                
-                // 检查时间差是否在有效范围内
-                double timeDelta2 = targetPeak2.timestamp - anchorPeak.timestamp;
-                if (std::abs(timeDelta2) > signature_generation_config_.maxTimeDelta) {
-                    filteredByTimeDelta2++;
-                    continue; // 跳过时间差太大的配对
-                }
-                
-                // 确保频率差之间有足够的差异，避免生成类似的哈希值
-                if (std::abs(freqDelta1 - freqDelta2) < signature_generation_config_.minFreqDelta / 2) {
-                    filteredByFreqDeltaSimilarity++;
-                    continue; // 两个频率差太相似
-                }
-                
-                // 计算评分
-                double score = computeTripleFrameCombinationScore(anchorPeak, targetPeak1, targetPeak2);
-                
-                // 检查评分是否满足最低阈值
-                if (score < signature_generation_config_.minTripleFrameScore) {
-                    filteredByLowScore++;
-                    continue; // 跳过评分过低的组合
-                }
-                
-                // 计算三帧组合哈希值，使用峰值的实际时间戳，而不是帧的时间戳
-                // uint32_t hash = computeTripleFrameHash(anchorPeak, targetPeak1, targetPeak2);
-                
-                // 添加到有效组合列表
-                ScoredTripleFrameCombination combination;
-                combination.anchorPeak = &anchorPeak;
-                combination.targetPeak1 = &targetPeak1;
-                combination.targetPeak2 = &targetPeak2;
-                combination.score = score;
-                // combination.hash = hash;
-                
-                validCombinationsVec.push_back(combination);
-                validCombinations++;
-            }
-        }
-    }
-
-    // TODO: 评估是排序好还是用堆好
-
-    // 按评分排序，保留topN
-    std::sort(validCombinationsVec.begin(), validCombinationsVec.end(), std::greater<ScoredTripleFrameCombination>());
-
-    // 限制保留的组合数量
-    size_t maxCombinations = std::min(validCombinationsVec.size(), signature_generation_config_.maxTripleFrameCombinations);
-    acceptedCombinations = 0;
-
-    // Todo: 按时间排序
-
-    // 生成签名点
-    for (size_t i = 0; i < maxCombinations; i++) {
-        const auto& combination = validCombinationsVec[i];
-        const auto& anchorPeak = *combination.anchorPeak;
-        const auto& targetPeak1 = *combination.targetPeak1;
-        const auto& targetPeak2 = *combination.targetPeak2;
-
-        uint32_t hash = computeTripleFrameHash(anchorPeak, targetPeak1, targetPeak2);
+void HashComputationPhase::consumeNewestFrame(size_t channel) {
+    auto& ring_buffer = frame_ring_buffers_[channel];
+    const size_t newestIndex = ring_buffer->size() - 1;
+    const Frame& frame3 = (*ring_buffer)[newestIndex];
 
-        // 创建签名点
-        SignaturePoint signaturePoint;
-        signaturePoint.hash = hash;
-        signaturePoint.timestamp = anchorPeak.timestamp; // 使用锚点峰值的精确时间戳
-        signaturePoint.frequency = anchorPeak.frequency;
-        signaturePoint.amplitude = static_cast<uint32_t>(anchorPeak.magnitude * 1000);
-        
-        // Add to visualization data if enabled
-        if (ctx_->visualization_config->collectVisualizationData_) {
-            ctx_->visualization_config->visualizationData_.fingerprintPoints.emplace_back(
-                signaturePoint.frequency, 
-                signaturePoint.timestamp, 
-                signaturePoint.hash
-            );
-        }
+    size_t totalAcceptedCombinations = 0;
 
-        std::pair<uint32_t, double> unique_key(signaturePoint.hash, signaturePoint.timestamp);
-        if (existing_triple_frame_combinations_.find(unique_key) == existing_triple_frame_combinations_.end()) {
-            existing_triple_frame_combinations_.insert(unique_key);
-            signature_points_.push_back(signaturePoint);
+    // 生成以最新帧为右侧帧的三帧组合：从(x-1, x, x+1)到(x-n, x, x+n)，x = 最新帧 - 距离
+    const size_t frameRange = ctx_->symmetricFrameRange();
+    for (size_t distance = 1; distance <= frameRange && distance * 2 <= newestIndex; distance++) {
+        const size_t anchorIndex = newestIndex - distance;
+        const Frame& frame1 = (*ring_buffer)[anchorIndex - distance];
+        const Frame& frame2 = (*ring_buffer)[anchorIndex];
 
 #ifdef ENABLED_DIAGNOSE
-            if (acceptedCombinations < 3) { // 只显示前几个
-                std::cout << "[DIAGNOSE-哈希计算] 通道" << channel << "生成指纹点" << (acceptedCombinations + 1) 
-                          << ": 哈希=" << std::hex << hash << std::dec 
-                          << ", 时间=" << signaturePoint.timestamp << "s"
-                          << ", 频率=" << signaturePoint.frequency << "Hz"
-                          << ", 评分=" << combination.score << std::endl;
-            }
+        std::cout << "[DIAGNOSE-哈希计算] 通道" << channel << "低延迟模式处理距离=" << distance 
+                  << "的三帧组合，帧索引[" << anchorIndex - distance << "," << anchorIndex << "," << newestIndex 
+                  << "]，时间戳[" << frame1.timestamp << "s," << frame2.timestamp << "s," 
+                  << frame3.timestamp << "s]" << std::endl;
 #endif
-        }
-
-        acceptedCombinations++;
-    }
-
-    totalAcceptedCombinations += acceptedCombinations;
 
-    // 输出窗口过滤统计信息
-    if (totalPossibleCombinations > 0) {
-#ifdef ENABLED_DIAGNOSE
-        std::cout << "[DIAGNOSE-哈希计算] 通道" << channel << "锚点" << anchorIndex  << "，距离" << distance << "，"
-                  << "总可能组合: " << totalPossibleCombinations 
-                  << ", 有效组合: " << validCombinations
-                  << ", 接受: " << acceptedCombinations 
-                  << " (" << (acceptedCombinations * 100.0 / totalPossibleCombinations) << "%)" << std::endl;
-        
-        // 详细的过滤统计
-        if (validCombinations > 0) {
-            std::cout << "[DIAGNOSE-哈希计算] 通道" << channel << "锚点" << anchorIndex  << "，距离" << distance << "，"
-                      << "过滤分布 - FreqDelta1_min: " << filteredByFreqDelta1_min << " (" << (filteredByFreqDelta1_min * 100.0 / totalPossibleCombinations) << "%)"
-                      << ", FreqDelta1_max: " << filteredByFreqDelta1_max << " (" << (filteredByFreqDelta1_max * 100.0 / totalPossibleCombinations) << "%)"
-                      << ", TimeDelta1: " << filteredByTimeDelta1 << " (" << (filteredByTimeDelta1 * 100.0 / totalPossibleCombinations) << "%)"
-                      << ", FreqDelta2: " << filteredByFreqDelta2 << " (" << (filteredByFreqDelta2 * 100.0 / totalPossibleCombinations) << "%)"
-                      << ", TimeDelta2: " << filteredByTimeDelta2 << " (" << (filteredByTimeDelta2 * 100.0 / totalPossibleCombinations) << "%)"
-                      << ", FreqDeltaSimilarity: " << filteredByFreqDeltaSimilarity << " (" << (filteredByFreqDeltaSimilarity * 100.0 / totalPossibleCombinations) << "%)"
-                      << ", LowScore: " << filteredByLowScore << " (" << (filteredByLowScore * 100.0 / totalPossibleCombinations) << "%)"
-                      << ", TopN筛选: " << (validCombinations - acceptedCombinations) << " (" << ((validCombinations - acceptedCombinations) * 100.0 / totalPossibleCombinations) << "%)"
-                      << std::endl;
+        // 跳过包含空帧的窗口
+        if (frame1.peaks.empty() || frame2.peaks.empty() || frame3.peaks.empty()) {
+            continue;
         }
-#endif
-    } else {
-#ifdef ENABLED_DIAGNOSE
-        std::cout << "[DIAGNOSE-哈希计算] 通道" << channel << "锚点" << anchorIndex  << "，距离" << distance << "，"
-                  << "没有可能的峰值组合，无法生成指纹" << std::endl;
-#endif
-    }
+
+        totalAcceptedCombinations += processTripleFrameCombination(frame1, frame2, frame3, channel, anchorIndex, distance);
     }
 
 #ifdef ENABLED_DIAGNOSE
-    std::cout << "[DIAGNOSE-哈希计算] 通道" << channel << "消费帧完成，总接受组合数: " 
-              << totalAcceptedCombinations << ", 本次生成指纹点数: " 
-              << signature_points_.size() << std::endl;
+    std::cout << "[DIAGNOSE-哈希计算] 通道" << channel << "低延迟模式消费最新帧完成，总接受组合数: " 
+              << totalAcceptedCombinations << ", 本通道候选指纹点数: " 
+              << channel_signature_points_[channel].size() << std::endl;
 #endif
 }
 
-
-
-
 // 计算三帧峰值组合的评分
 double HashComputationPhase::computeTripleFrameCombinationScore(
-    const Peak& anchorPeak,
-    const Peak& targetPeak1,
-    const Peak& targetPeak2) {
+    const PeakScoreTerms& anchorPeak,
+    const PeakScoreTerms& targetPeak1,
+    const PeakScoreTerms& targetPeak2) const {
     
     double score = 0.0;
     
@@ -387,9 +340,67 @@ double HashComputationPhase::computeTripleFrameCombinationScore(
     score += freqPositionScore * 0.07;
     
     // 5. 峰值尖锐度评分 (3% 权重) - 优先选择更尖锐的峰值
-    double sharpnessScore = (std::log10(anchorPeak.magnitude + 1) + 
-                           std::log10(targetPeak1.magnitude + 1) + 
-                           std::log10(targetPeak2.magnitude + 1)) / 3.0;
+    double sharpnessScore = (anchorPeak.sharpness + targetPeak1.sharpness + targetPeak2.sharpness) / 3.0;
+    score += sharpnessScore * 0.03;
+    
+    return score;
+}
+
+void HashComputationPhase::scoreTargetSpan(
+    const PeakScoreTerms& anchorPeak,
+    const PeakScoreTerms& targetPeak1,
+    const PeakColumns& targets, size_t begin, size_t end,
+    double* scores) const {
+
+    const int32_t freqDelta1 = static_cast<int32_t>(anchorPeak.frequency) - static_cast<int32_t>(targetPeak1.frequency);
+    for (size_t i = begin; i < end; ++i) {
+        // 检查时间差是否在有效范围内
+        const int32_t freqDelta2 = static_cast<int32_t>(targets.frequency[i]) - static_cast<int32_t>(anchorPeak.frequency);
+        const double timeDelta2 = targets.timestamp[i] - anchorPeak.timestamp;
+        // 确保频率差之间有足够的差异，避免生成类似的哈希值
+        if (std::abs(timeDelta2) > signature_generation_config_.maxTimeDelta ||
+            std::abs(freqDelta1 - freqDelta2) < signature_generation_config_.minFreqDelta / 2) {
+            scores[i - begin] = -std::numeric_limits<double>::infinity();
+            continue;
+        }
+        scores[i - begin] = computeTripleFrameCombinationScore(anchorPeak, targetPeak1, scoreTermsOf(targets, i));
+    }
+}
+
+double HashComputationPhase::computeTripleFrameScoreUpperBound(
+    const PeakScoreTerms& anchorPeak,
+    const PeakScoreTerms& targetPeak1,
+    float maxMagnitude2,
+    double minTimeDelta2) const {
+
+    // 与computeTripleFrameCombinationScore逐项对应、按相同顺序累加：
+    // 只含锚点和目标峰值1的部分相同，含目标峰值2的部分取其最大可能值；各项都随之单调，因此不小于实际评分
+    double score = 0.0;
+    
+    double magnitudeScore = std::pow(anchorPeak.magnitude * targetPeak1.magnitude * maxMagnitude2, 1.0/3.0);
+    score += magnitudeScore * 0.4;
+    
+    int32_t freqDelta1 = std::abs(static_cast<int32_t>(anchorPeak.frequency) - static_cast<int32_t>(targetPeak1.frequency));
+    double freqDelta1Normalized = static_cast<double>(freqDelta1 - signature_generation_config_.minFreqDelta) / 
+                                  (signature_generation_config_.maxFreqDelta - signature_generation_config_.minFreqDelta);
+    double freqDelta1Score = 1.0 - 4.0 * std::pow(freqDelta1Normalized - 0.5, 2);
+    freqDelta1Score = std::max(0.0, freqDelta1Score);
+    double freqDelta2Score = 1.0;   // 倒置二次函数的最大值
+    double avgFreqDeltaScore = (freqDelta1Score + freqDelta2Score) / 2.0;
+    score += avgFreqDeltaScore * 25.0 * 0.3;
+    
+    double timeDelta1 = std::abs(anchorPeak.timestamp - targetPeak1.timestamp);
+    double timeDelta1Normalized = timeDelta1 / signature_generation_config_.maxTimeDelta;
+    double timeDelta2Normalized = minTimeDelta2 / signature_generation_config_.maxTimeDelta;
+    double timeDelta1Score = (1.0 - timeDelta1Normalized) * 10.0;
+    double timeDelta2Score = (1.0 - timeDelta2Normalized) * 10.0;
+    double avgTimeDeltaScore = (timeDelta1Score + timeDelta2Score) / 2.0;
+    score += avgTimeDeltaScore * 0.2;
+    
+    double freqPositionScore = 10.0;   // 频率位置评分的最大值
+    score += freqPositionScore * 0.07;
+    
+    double sharpnessScore = (anchorPeak.sharpness + targetPeak1.sharpness + std::log10(maxMagnitude2 + 1)) / 3.0;
     score += sharpnessScore * 0.03;
     
     return score;
@@ -465,19 +476,26 @@ void HashComputationPhase::flush() {
     // 即使ring buffer的数据少于symmetric_frame_range_ * 2 + 1
     // 但如果symmetric_frame_range_ > 1, 此时仍旧有可以计算三帧hash的组合
 
+    PhaseTimer timer(ctx_->counters, ctx_->trace, PipelinePhase::HashComputation);
+
 #ifdef ENABLED_DIAGNOSE
     std::cout << "[DIAGNOSE-哈希计算] 开始flush处理:" << std::endl;
 #endif
 
-    for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
+    ctx_->forEachChannel([&](size_t channel_i) {
         auto& ring_buffer = frame_ring_buffers_[channel_i];
+
+        if (ctx_->low_latency) {
+            // 低延迟模式下每个三帧组合在右侧帧到达时已经生成，缓冲区中没有待处理的组合
+            return;
+        }
         
         if (ring_buffer->size() < 3) {
 #ifdef ENABLED_DIAGNOSE
             std::cout << "[DIAGNOSE-哈希计算flush] 通道" << channel_i << "缓存数据不足，跳过: " 
                       << ring_buffer->size() << " < 3" << std::endl;
 #endif
-            continue;
+            return;
         }
 
 #ifdef ENABLED_DIAGNOSE
@@ -505,7 +523,7 @@ void HashComputationPhase::flush() {
             size_t max_distance_left = anchor_idx;                    // 向左最大距离
             size_t max_distance_right = ring_buffer->size() - 1 - anchor_idx; // 向右最大距离
             size_t max_usable_distance = std::min(max_distance_left, max_distance_right);
-            max_usable_distance = std::min(max_usable_distance, symmetric_frame_range_);
+            max_usable_distance = std::min(max_usable_distance, ctx_->symmetricFrameRange());
             
             if (max_usable_distance == 0) {
 #ifdef ENABLED_DIAGNOSE
@@ -557,7 +575,9 @@ void HashComputationPhase::flush() {
         std::cout << "[DIAGNOSE-哈希计算flush] 通道" << channel_i << "处理完成，处理锚点数: " 
                   << total_processed_anchors << std::endl;
 #endif
-    }
+    });
+
+    collectSignaturePoints();
 
 #ifdef ENABLED_DIAGNOSE
     std::cout << "[DIAGNOSE-哈希计算flush] flush处理完成，本次生成指纹点数: " << signature_points_.size() << std::endl;
@@ -565,7 +585,13 @@ void HashComputationPhase::flush() {
 #endif
 
     if (signature_points_.size() > 0) {
-        ctx_->on_signature_points_generated(signature_points_);
+        ctx_->counters.addOut(PipelinePhase::HashComputation, signature_points_.size());
+        ctx_->trace.instant(kSignaturePointsTraceEvent, static_cast<uint32_t>(signature_points_.size()),
+                            signature_points_.front().timestamp, signature_points_.back().timestamp);
+        {
+            PhaseTimer delivery_timer(ctx_->counters, ctx_->trace, PipelinePhase::Delivery);
+            ctx_->on_signature_points_generated(signature_points_);
+        }
         
         existing_triple_frame_combinations_.clear();
         signature_points_.clear();
@@ -582,114 +608,125 @@ void HashComputationPhase::flush() {
 }
 
 // 处理三帧组合的辅助方法（从 consumeFrame 中提取的逻辑）
-void HashComputationPhase::processTripleFrameCombination(
+size_t HashComputationPhase::processTripleFrameCombination(
     const Frame& frame1, const Frame& frame2, const Frame& frame3,
-    size_t channel, size_t anchor_idx, size_t distance) {
+    size_t channel, [[maybe_unused]] size_t anchor_idx, [[maybe_unused]] size_t distance) {
     
-    // 统计不同原因的过滤数量
-    size_t totalPossibleCombinations = 0;
-    size_t filteredByFreqDelta1_min = 0;
-    size_t filteredByFreqDelta1_max = 0;
-    size_t filteredByTimeDelta1 = 0;
-    size_t filteredByFreqDelta2 = 0;
-    size_t filteredByTimeDelta2 = 0;
-    size_t filteredByFreqDeltaSimilarity = 0;
-    size_t filteredByLowScore = 0;
-    size_t validCombinations = 0;
-    size_t acceptedCombinations = 0;
+    const size_t maxCombinations = ctx_->maxTripleFrameCombinations();
+    const size_t minFreqDelta = signature_generation_config_.minFreqDelta;
+    const size_t maxFreqDelta = signature_generation_config_.maxFreqDelta;
+    const double maxTimeDelta = signature_generation_config_.maxTimeDelta;
+    const double minScore = signature_generation_config_.minTripleFrameScore;
 
-    // 潜在组合总数
-    size_t theoreticalCombinations = frame1.peaks.size() * frame2.peaks.size() * frame3.peaks.size();
+    // 潜在组合总数，只用于诊断输出
+    [[maybe_unused]] const size_t theoreticalCombinations = frame1.peaks.size() * frame2.peaks.size() * frame3.peaks.size();
+    size_t scoredCombinations = 0;      // 实际计算了评分的组合数
+    size_t prunedPairs = 0;             // 因评分上限不足而整体跳过的(锚点, 目标峰值1)数
 
 #ifdef ENABLED_DIAGNOSE
-    std::cout << "[DIAGNOSE-哈希计算flush] 通道" << channel << "锚点" << anchor_idx  << "，距离" << distance << "，"
+    std::cout << "[DIAGNOSE-哈希计算] 通道" << channel << "锚点" << anchor_idx  << "，距离" << distance << "，"
               << "理论可能的峰值组合数: " << theoreticalCombinations << " (帧1:"
               << frame1.peaks.size() << "峰值, 帧2:" << frame2.peaks.size() 
               << "峰值, 帧3:" << frame3.peaks.size() << "峰值)" << std::endl;
 #endif
 
-    // 收集所有有效的峰值组合并计算评分
-    std::vector<ScoredTripleFrameCombination> validCombinationsVec;
+    if (maxCombinations == 0) {
+        return 0;
+    }
+
+    auto& scratch = triple_frame_scratches_[channel];
+    const PeakColumns& columns1 = scratch.frame1_columns;
+    const PeakColumns& columns3 = scratch.frame3_columns;
+    scratch.frame1_columns.assign(frame1.peaks);
+    scratch.frame3_columns.assign(frame3.peaks);
+    scratch.span_scores.resize(columns3.size());
+
+    const float maxMagnitude3 = *std::max_element(columns3.magnitude.begin(), columns3.magnitude.end());
+
+    // 以最差的组合为堆顶的小顶堆，只保留评分最高的maxCombinations个组合
+    auto& topCombinations = scratch.top_combinations;
+    topCombinations.clear();
+    const auto better = [](const ScoredTripleFrameCombination& a, const ScoredTripleFrameCombination& b) {
+        if (a.score != b.score) return a.score > b.score;
+        return a.order < b.order;
+    };
+
+    const uint64_t frame1Count = frame1.peaks.size();
+    const uint64_t frame3Count = frame3.peaks.size();
 
     // 从中间帧选择锚点峰值
-    for (const auto& anchorPeak : frame2.peaks) {
-        // 从第一帧（最旧）和第三帧（最新）中选择目标峰值
-        for (const auto& targetPeak1 : frame1.peaks) {
-            // 计算所有可能的组合数
-            totalPossibleCombinations += frame3.peaks.size();
-            
-            // 计算第一个频率差并检查是否在有效范围内
-            int32_t freqDelta1 = static_cast<int32_t>(anchorPeak.frequency) - static_cast<int32_t>(targetPeak1.frequency);
-            if (std::abs(freqDelta1) < signature_generation_config_.minFreqDelta) {
-                filteredByFreqDelta1_min += frame3.peaks.size();
-                continue; // 跳过频率差太小
-            }
-            if (std::abs(freqDelta1) > signature_generation_config_.maxFreqDelta) {
-                filteredByFreqDelta1_max += frame3.peaks.size();
-                continue; // 跳过频率差太大
-            }
+    for (size_t anchorIdx = 0; anchorIdx < frame2.peaks.size(); ++anchorIdx) {
+        const auto& anchorPeak = frame2.peaks[anchorIdx];
+        const PeakScoreTerms anchorTerms{
+            anchorPeak.frequency, anchorPeak.magnitude, anchorPeak.timestamp, std::log10(anchorPeak.magnitude + 1)};
+
+        // 第三帧峰值与锚点的最小时间差，用于计算评分上限
+        double minTimeDelta2 = std::abs(anchorPeak.timestamp - columns3.timestamp[0]);
+        for (double timestamp : columns3.timestamp) {
+            minTimeDelta2 = std::min(minTimeDelta2, std::abs(anchorPeak.timestamp - timestamp));
+        }
+
+        // 从第一帧（最旧）和第三帧（最新）中选择目标峰值，频率差不在[minFreqDelta, maxFreqDelta]内的区间直接跳过
+        forEachFreqDeltaSpan(columns1, anchorPeak.frequency, minFreqDelta, maxFreqDelta, [&](size_t begin1, size_t end1) {
+        for (size_t target1Col = begin1; target1Col < end1; ++target1Col) {
+            const PeakScoreTerms target1Terms = scoreTermsOf(columns1, target1Col);
             
             // 检查时间差是否在有效范围内
-            double timeDelta1 = anchorPeak.timestamp - targetPeak1.timestamp;
-            if (std::abs(timeDelta1) > signature_generation_config_.maxTimeDelta) {
-                filteredByTimeDelta1 += frame3.peaks.size();
+            double timeDelta1 = anchorPeak.timestamp - target1Terms.timestamp;
+            if (std::abs(timeDelta1) > maxTimeDelta) {
                 continue; // 跳过时间差太大的配对
             }
 
-            for (const auto& targetPeak2 : frame3.peaks) {
-                // 计算第二个频率差并检查是否在有效范围内
-                int32_t freqDelta2 = static_cast<int32_t>(targetPeak2.frequency) - static_cast<int32_t>(anchorPeak.frequency);
-                if (std::abs(freqDelta2) < signature_generation_config_.minFreqDelta || 
-                    std::abs(freqDelta2) > signature_generation_config_.maxFreqDelta) {
-                    filteredByFreqDelta2++;
-                    continue; // 跳过频率差太小或太大的配对
-                }
-                
-                // 检查时间差是否在有效范围内
-                double timeDelta2 = targetPeak2.timestamp - anchorPeak.timestamp;
-                if (std::abs(timeDelta2) > signature_generation_config_.maxTimeDelta) {
-                    filteredByTimeDelta2++;
-                    continue; // 跳过时间差太大的配对
-                }
-                
-                // 确保频率差之间有足够的差异，避免生成类似的哈希值
-                if (std::abs(freqDelta1 - freqDelta2) < signature_generation_config_.minFreqDelta / 2) {
-                    filteredByFreqDeltaSimilarity++;
-                    continue; // 两个频率差太相似
-                }
-                
-                // 计算评分
-                double score = computeTripleFrameCombinationScore(anchorPeak, targetPeak1, targetPeak2);
-                
-                // 检查评分是否满足最低阈值
-                if (score < signature_generation_config_.minTripleFrameScore) {
-                    filteredByLowScore++;
-                    continue; // 跳过评分过低的组合
-                }
-                
-                // 添加到有效组合列表
-                ScoredTripleFrameCombination combination;
-                combination.anchorPeak = &anchorPeak;
-                combination.targetPeak1 = &targetPeak1;
-                combination.targetPeak2 = &targetPeak2;
-                combination.score = score;
-                
-                validCombinationsVec.push_back(combination);
-                validCombinations++;
+            // 剪枝：任何第二个目标峰值都达不到最低评分，或无法超过已保留的最差组合时，跳过这一对
+            const double upperBound = computeTripleFrameScoreUpperBound(anchorTerms, target1Terms, maxMagnitude3, minTimeDelta2);
+            if (upperBound < minScore ||
+                (topCombinations.size() == maxCombinations && upperBound < topCombinations.front().score)) {
+                ++prunedPairs;
+                continue;
             }
+
+            const uint32_t target1Idx = columns1.source_index[target1Col];
+            forEachFreqDeltaSpan(columns3, anchorPeak.frequency, minFreqDelta, maxFreqDelta, [&](size_t begin3, size_t end3) {
+                // 先对整段批量评分，再把达到阈值的组合放入堆
+                double* scores = scratch.span_scores.data();
+                scoreTargetSpan(anchorTerms, target1Terms, columns3, begin3, end3, scores);
+                scoredCombinations += end3 - begin3;
+
+                for (size_t target2Col = begin3; target2Col < end3; ++target2Col) {
+                    const double score = scores[target2Col - begin3];
+                    
+                    // 检查评分是否满足最低阈值
+                    if (score < minScore) {
+                        continue; // 跳过评分过低或被过滤的组合
+                    }
+                    
+                    const uint32_t target2Idx = columns3.source_index[target2Col];
+                    ScoredTripleFrameCombination combination;
+                    combination.anchorPeak = &anchorPeak;
+                    combination.targetPeak1 = &frame1.peaks[target1Idx];
+                    combination.targetPeak2 = &frame3.peaks[target2Idx];
+                    combination.score = score;
+                    combination.order = (anchorIdx * frame1Count + target1Idx) * frame3Count + target2Idx;
+
+                    if (topCombinations.size() < maxCombinations) {
+                        topCombinations.push_back(combination);
+                        std::push_heap(topCombinations.begin(), topCombinations.end(), better);
+                    } else if (better(combination, topCombinations.front())) {
+                        std::pop_heap(topCombinations.begin(), topCombinations.end(), better);
+                        topCombinations.back() = combination;
+                        std::push_heap(topCombinations.begin(), topCombinations.end(), better);
+                    }
+                }
+            });
         }
+        });
     }
 
-    // 按评分排序，保留topN
-    std::sort(validCombinationsVec.begin(), validCombinationsVec.end(), std::greater<ScoredTripleFrameCombination>());
-
-    // 限制保留的组合数量
-    size_t maxCombinations = std::min(validCombinationsVec.size(), signature_generation_config_.maxTripleFrameCombinations);
-    acceptedCombinations = 0;
+    // 按评分从高到低生成签名点
+    std::sort_heap(topCombinations.begin(), topCombinations.end(), better);
+    size_t acceptedCombinations = 0;
 
-    // 生成签名点
-    for (size_t i = 0; i < maxCombinations; i++) {
-        const auto& combination = validCombinationsVec[i];
+    for (const auto& combination : topCombinations) {
         const auto& anchorPeak = *combination.anchorPeak;
         const auto& targetPeak1 = *combination.targetPeak1;
         const auto& targetPeak2 = *combination.targetPeak2;
@@ -703,43 +740,78 @@ void HashComputationPhase::processTripleFrameCombination(
         signaturePoint.frequency = anchorPeak.frequency;
         signaturePoint.amplitude = static_cast<uint32_t>(anchorPeak.magnitude * 1000);
         
-        // Add to visualization data if enabled
-        if (ctx_->visualization_config->collectVisualizationData_) {
-            ctx_->visualization_config->visualizationData_.fingerprintPoints.emplace_back(
-                signaturePoint.frequency, 
-                signaturePoint.timestamp, 
-                signaturePoint.hash
-            );
-        }
-
-        std::pair<uint32_t, double> unique_key(signaturePoint.hash, signaturePoint.timestamp);
-        if (existing_triple_frame_combinations_.find(unique_key) == existing_triple_frame_combinations_.end()) {
-            existing_triple_frame_combinations_.insert(unique_key);
-            signature_points_.push_back(signaturePoint);
+        // 先记入本通道的候选，跨通道去重在collectSignaturePoints中按通道顺序进行
+        channel_signature_points_[channel].push_back(signaturePoint);
 
 #ifdef ENABLED_DIAGNOSE
-            if (acceptedCombinations < 3) { // 只显示前几个
-                std::cout << "[DIAGNOSE-哈希计算flush] 通道" << channel << "生成指纹点" << (acceptedCombinations + 1) 
-                          << ": 哈希=" << std::hex << hash << std::dec 
-                          << ", 时间=" << signaturePoint.timestamp << "s"
-                          << ", 频率=" << signaturePoint.frequency << "Hz"
-                          << ", 评分=" << combination.score << std::endl;
-            }
-#endif
+        if (acceptedCombinations < 3) { // 只显示前几个
+            std::cout << "[DIAGNOSE-哈希计算] 通道" << channel << "生成指纹点" << (acceptedCombinations + 1) 
+                      << ": 哈希=" << std::hex << hash << std::dec 
+                      << ", 时间=" << signaturePoint.timestamp << "s"
+                      << ", 频率=" << signaturePoint.frequency << "Hz"
+                      << ", 评分=" << combination.score << std::endl;
         }
+#endif
 
         acceptedCombinations++;
     }
 
     // 输出窗口过滤统计信息
-    if (totalPossibleCombinations > 0) {
 #ifdef ENABLED_DIAGNOSE
-        std::cout << "[DIAGNOSE-哈希计算flush] 通道" << channel << "锚点" << anchor_idx  << "，距离" << distance << "，"
-                  << "总可能组合: " << totalPossibleCombinations 
-                  << ", 有效组合: " << validCombinations
+    if (theoreticalCombinations > 0) {
+        std::cout << "[DIAGNOSE-哈希计算] 通道" << channel << "锚点" << anchor_idx  << "，距离" << distance << "，"
+                  << "总可能组合: " << theoreticalCombinations 
+                  << ", 计算评分: " << scoredCombinations
+                  << ", 剪枝跳过的目标峰值对: " << prunedPairs
                   << ", 接受: " << acceptedCombinations 
-                  << " (" << (acceptedCombinations * 100.0 / totalPossibleCombinations) << "%)" << std::endl;
+                  << " (" << (acceptedCombinations * 100.0 / theoreticalCombinations) << "%)" << std::endl;
+    }
 #endif
+
+    return acceptedCombinations;
+}
+
+void savePeaks(StateWriter& writer, const std::vector<Peak>& peaks) {
+    writer.writeVarint(peaks.size());
+    for (const auto& peak : peaks) {
+        writer.writeVarint(peak.frequency);
+        writer.writeFloat(peak.magnitude);
+        writer.writeDouble(peak.timestamp);
+    }
+}
+
+void restorePeaks(StateReader& reader, std::vector<Peak>& peaks) {
+    // 每个峰值至少13个字节，分配之前按剩余数据量校验峰值数
+    peaks.resize(reader.readCount(reader.remaining() / 13));
+    for (auto& peak : peaks) {
+        peak.frequency = static_cast<uint32_t>(reader.readVarint());
+        peak.magnitude = reader.readFloat();
+        peak.timestamp = reader.readDouble();
+    }
+}
+
+void HashComputationPhase::saveState(StateWriter& writer) const {
+    for (size_t channel = 0; channel < ctx_->channel_count; ++channel) {
+        const auto& ring_buffer = *frame_ring_buffers_[channel];
+        writer.writeVarint(ring_buffer.size());
+        for (size_t i = 0; i < ring_buffer.size(); ++i) {
+            writer.writeDouble(ring_buffer[i].timestamp);
+            savePeaks(writer, ring_buffer[i].peaks);
+        }
+    }
+}
+
+void HashComputationPhase::restoreState(StateReader& reader) {
+    for (size_t channel = 0; channel < ctx_->channel_count; ++channel) {
+        auto& ring_buffer = *frame_ring_buffers_[channel];
+        const size_t frame_count = reader.readCount(ring_buffer.capacity() - 1);
+        ring_buffer.reset();
+        for (size_t i = 0; i < frame_count && reader.ok(); ++i) {
+            Frame frame;
+            frame.timestamp = reader.readDouble();
+            restorePeaks(reader, frame.peaks);
+            ring_buffer.push(std::move(frame));
+        }
     }
 }
 
@@ -4,7 +4,9 @@
 #include "base/frame.h"
 #include "base/ring_buffer.h"
 #include "base/channel_array.h"
-#include <unordered_set>
+#include "base/signature_key_set.h"
+#include "base/scored_triple_frame_combination.h"
+#include "base/peak_columns.h"
 #include <vector>
 
 
@@ -12,20 +14,38 @@
 
 namespace afp {
 
+// 峰值的检查点格式，长帧构建阶段和hash计算阶段共用
+void savePeaks(StateWriter& writer, const std::vector<Peak>& peaks);
+void restorePeaks(StateReader& reader, std::vector<Peak>& peaks);
+
 class HashComputationPhase {
 
 public:
     HashComputationPhase(SignatureGenerationPipelineCtx* ctx);
 
+    // 长帧以交换的方式存入各通道的环形缓冲区，返回后channel_long_frames中是被换出的旧长帧
     void handleFrame(ChannelArray<std::vector<Frame>>& channel_long_frames);
 
     void flush();
 
+    // 长帧环形缓冲、三帧组合去重集合、评分缓冲和输出缓冲占用的内存（字节）
+    size_t memoryUsage() const;
+
+    // 保存/恢复各通道环形缓冲中尚未用完的长帧；去重集合和输出缓冲每轮清空，不保存
+    void saveState(StateWriter& writer) const;
+    void restoreState(StateReader& reader);
+
 private:
     void consumeFrame(size_t channel);
 
-    // 处理三帧组合的辅助方法（从 consumeFrame 中提取的逻辑）
-    void processTripleFrameCombination(
+    // 低延迟模式：以最新的长帧为右侧帧，生成所有以它结尾的三帧组合(x-d, x, x+d)，不等待锚点右侧的帧收齐
+    void consumeNewestFrame(size_t channel);
+
+    // 把各通道的候选指纹点按通道顺序去重后并入signature_points_，在所有通道计算完成后调用
+    void collectSignaturePoints();
+
+    // 处理三帧组合：枚举三帧的峰值组合，保留评分最高的maxTripleFrameCombinations个生成候选指纹点，返回保留的组合数
+    size_t processTripleFrameCombination(
         const Frame& frame1, const Frame& frame2, const Frame& frame3,
         size_t channel, size_t anchor_idx, size_t distance);
 
@@ -34,30 +54,60 @@ private:
         const Peak& targetPeak1,
         const Peak& targetPeak2);
 
-    double computeTripleFrameCombinationScore(
-        const Peak& anchorPeak,
-        const Peak& targetPeak1,
-        const Peak& targetPeak2);
+    // 评分用到的单个峰值的数值
+    struct PeakScoreTerms {
+        uint32_t frequency;
+        float magnitude;
+        double timestamp;
+        float sharpness;    // log10(magnitude + 1)
+    };
 
+    static PeakScoreTerms scoreTermsOf(const PeakColumns& columns, size_t i) {
+        return PeakScoreTerms{columns.frequency[i], columns.magnitude[i], columns.timestamp[i], columns.sharpness[i]};
+    }
 
-    // 使用unordered_set作为查询结构以获得O(1)的查找性能
-    struct PairHash {
-        size_t operator()(const std::pair<uint32_t, double>& p) const {
-            // 组合两个哈希值
-            return std::hash<uint32_t>{}(p.first) ^ 
-                    (std::hash<double>{}(p.second) << 1);
-        }
-    };
+    double computeTripleFrameCombinationScore(
+        const PeakScoreTerms& anchorPeak,
+        const PeakScoreTerms& targetPeak1,
+        const PeakScoreTerms& targetPeak2) const;
+
+    // 锚点和第一个目标峰值确定时，对targets中[begin, end)的每个第二个目标峰值批量评分，写入scores
+    // 时间差超出范围或两个频率差太相似的组合评分为负无穷
+    void scoreTargetSpan(
+        const PeakScoreTerms& anchorPeak,
+        const PeakScoreTerms& targetPeak1,
+        const PeakColumns& targets, size_t begin, size_t end,
+        double* scores) const;
+
+    // 锚点和第一个目标峰值确定时，任意第二个目标峰值能得到的评分上限
+    // maxMagnitude2、minTimeDelta2是候选的第二个目标峰值中最大的幅度和与锚点最小的时间差
+    double computeTripleFrameScoreUpperBound(
+        const PeakScoreTerms& anchorPeak,
+        const PeakScoreTerms& targetPeak1,
+        float maxMagnitude2,
+        double minTimeDelta2) const;
 
 private:
     SignatureGenerationPipelineCtx* ctx_;
     const size_t symmetric_frame_range_;
     const SignatureGenerationConfig& signature_generation_config_;
 
-    std::unordered_set<std::pair<uint32_t, double>, PairHash> existing_triple_frame_combinations_;
+    // 本轮已输出的(hash, 时间戳)，用于跨通道去重，每轮清空后复用
+    SignatureKeySet existing_triple_frame_combinations_;
     std::vector<SignaturePoint> signature_points_;
+    // 每个通道本轮生成的候选指纹点，通道并行时各自写入，合并前尚未跨通道去重
+    ChannelArray<std::vector<SignaturePoint>> channel_signature_points_;
 
     ChannelArray<RingBufferPtr<Frame>> frame_ring_buffers_;
+
+    // 三帧组合枚举用的缓冲，每个通道一份，在多次枚举之间复用
+    struct TripleFrameScratch {
+        PeakColumns frame1_columns;             // 第一帧的峰值，按频率升序的列式存储
+        PeakColumns frame3_columns;             // 第三帧的峰值，按频率升序的列式存储
+        std::vector<double> span_scores;        // 一段第二个目标峰值的批量评分
+        std::vector<ScoredTripleFrameCombination> top_combinations;   // 当前评分最高的组合，最差的在堆顶
+    };
+    ChannelArray<TripleFrameScratch> triple_frame_scratches_;
 };
 
 } // namespace afp
\ No newline at end of file
@@ -1,5 +1,8 @@
 #include "long_frame_building_phase.h"
+#include <cmath>
 #include <iostream>
+#include "base/memory_accounting.h"
+#include "base/state_stream.h"
 
 namespace afp {
 
@@ -37,11 +40,31 @@ LongFrameBuildingPhase::LongFrameBuildingPhase(SignatureGenerationPipelineCtx* c
 LongFrameBuildingPhase::~LongFrameBuildingPhase() {
 }
 
+size_t LongFrameBuildingPhase::memoryUsage() const {
+    size_t bytes = 0;
+    for (size_t channel = 0; channel < ctx_->channel_count; ++channel) {
+        bytes += heapBytes(peak_buffers_[channel]) + heapBytes(long_frames_[channel]);
+        for (const auto& frame : long_frames_[channel]) {
+            bytes += heapBytes(frame.peaks);
+        }
+        bytes += heapBytes(spare_peak_buffers_[channel]);
+        for (const auto& peaks : spare_peak_buffers_[channel]) {
+            bytes += heapBytes(peaks);
+        }
+    }
+    return bytes;
+}
+
 void LongFrameBuildingPhase::attach(HashComputationPhase* hash_computation_phase) {
     hash_computation_phase_ = hash_computation_phase;
 }
 
 void LongFrameBuildingPhase::handlePeaks(ChannelArray<std::vector<Peak>>& peaks) {
+    PhaseTimer timer(ctx_->counters, ctx_->trace, PipelinePhase::LongFrameBuilding);
+    for (size_t i = 0; i < ctx_->channel_count; i++) {
+        ctx_->counters.addIn(PipelinePhase::LongFrameBuilding, peaks[i].size());
+    }
+
 #ifdef ENABLED_DIAGNOSE
     size_t total_peaks = 0;
     for (size_t i = 0; i < ctx_->channel_count; i++) {
@@ -61,9 +84,10 @@ void LongFrameBuildingPhase::handlePeaks(ChannelArray<std::vector<Peak>>& peaks)
     }
 #endif
 
-    for (size_t i = 0; i < ctx_->channel_count; i++) {
-        handleChannelPeaks(i, peaks[i]);
-    }
+    // 各通道的峰值缓冲、窗口和长帧相互独立，可按通道并行处理
+    ctx_->forEachChannel([&](size_t channel_i) {
+        handleChannelPeaks(channel_i, peaks[channel_i]);
+    });
 
 #ifdef ENABLED_DIAGNOSE
     size_t total_long_frames = 0;
@@ -82,9 +106,12 @@ void LongFrameBuildingPhase::handlePeaks(ChannelArray<std::vector<Peak>>& peaks)
     }
 #endif
 
+    for (size_t i = 0; i < ctx_->channel_count; i++) {
+        ctx_->counters.addOut(PipelinePhase::LongFrameBuilding, long_frames_[i].size());
+    }
     hash_computation_phase_->handleFrame(long_frames_);
     for (size_t i = 0; i < ctx_->channel_count; i++) {
-        long_frames_[i].clear();
+        recycleLongFrames(i);
     }
 }
 
@@ -151,8 +178,10 @@ void LongFrameBuildingPhase::handleChannelPeaks(size_t channel, std::vector<Peak
             }
 
             // 滑动窗口到下一个位置
-            double old_start = wnd_info.start_time;
-            double old_end = wnd_info.end_time;
+#ifdef ENABLED_DIAGNOSE
+            const double old_start = wnd_info.start_time;
+            const double old_end = wnd_info.end_time;
+#endif
             wnd_info.start_time = wnd_info.end_time;
             wnd_info.end_time = wnd_info.start_time + ctx_->config->getSignatureGenerationConfig().frameDuration;
             
@@ -209,13 +238,18 @@ void LongFrameBuildingPhase::consumePeaks(size_t channel) {
     }
 #endif
 
-    Frame frame;
-    frame.peaks = std::move(peak_buffer);
-    frame.timestamp = wnd_infos_[channel].start_time;
-    
+    // 峰值数组直接移入长帧，峰值缓冲换上回收的数组
+    long_frames_[channel].push_back(Frame{std::move(peak_buffer), wnd_infos_[channel].start_time});
+
+    auto& spare_peak_buffers = spare_peak_buffers_[channel];
+    if (!spare_peak_buffers.empty()) {
+        peak_buffer = std::move(spare_peak_buffers.back());
+        spare_peak_buffers.pop_back();
+    }
     peak_buffer.clear();
 
 #ifdef ENABLED_DIAGNOSE
+    const Frame& frame = long_frames_[channel].back();
     std::cout << "[DIAGNOSE-长帧构建] 通道" << channel << "生成长帧: 时间戳=" 
               << frame.timestamp << "s, 峰值数=" << frame.peaks.size() << std::endl;
     std::cout << "  峰值详情:[";
@@ -224,11 +258,22 @@ void LongFrameBuildingPhase::consumePeaks(size_t channel) {
     }
     std::cout << "]" << std::endl;
 #endif
+}
 
-    long_frames_[channel].push_back(frame);
+void LongFrameBuildingPhase::recycleLongFrames(size_t channel) {
+    auto& spare_peak_buffers = spare_peak_buffers_[channel];
+    for (auto& frame : long_frames_[channel]) {
+        if (frame.peaks.capacity() > 0) {
+            frame.peaks.clear();
+            spare_peak_buffers.push_back(std::move(frame.peaks));
+        }
+    }
+    long_frames_[channel].clear();
 }
 
 void LongFrameBuildingPhase::flush() {
+    PhaseTimer timer(ctx_->counters, ctx_->trace, PipelinePhase::LongFrameBuilding);
+
 #ifdef ENABLED_DIAGNOSE
     std::cout << "[DIAGNOSE-长帧构建] 开始清空所有剩余峰值缓冲区" << std::endl;
 #endif
@@ -249,11 +294,31 @@ void LongFrameBuildingPhase::flush() {
     std::cout << "[DIAGNOSE-长帧构建] 清空完成，总计清空" << total_flushed << "个峰值" << std::endl;
 #endif
 
+    for (size_t i = 0; i < ctx_->channel_count; i++) {
+        ctx_->counters.addOut(PipelinePhase::LongFrameBuilding, long_frames_[i].size());
+    }
     hash_computation_phase_->handleFrame(long_frames_);
     for (size_t i = 0; i < ctx_->channel_count; i++) {
-        long_frames_[i].clear();
+        recycleLongFrames(i);
     }
 
     hash_computation_phase_->flush();
 }
-}
\ No newline at end of file
+
+void LongFrameBuildingPhase::saveState(StateWriter& writer) const {
+    for (size_t channel = 0; channel < ctx_->channel_count; ++channel) {
+        writer.writeDouble(wnd_infos_[channel].start_time);
+        writer.writeDouble(wnd_infos_[channel].end_time);
+        savePeaks(writer, peak_buffers_[channel]);
+    }
+}
+
+void LongFrameBuildingPhase::restoreState(StateReader& reader) {
+    for (size_t channel = 0; channel < ctx_->channel_count; ++channel) {
+        wnd_infos_[channel].start_time = reader.readDouble();
+        wnd_infos_[channel].end_time = reader.readDouble();
+        restorePeaks(reader, peak_buffers_[channel]);
+    }
+}
+
+} // namespace afp
@@ -20,6 +20,13 @@ public:
 
     void flush();
 
+    // 峰值缓冲、长帧及备用峰值数组占用的内存（字节）
+    size_t memoryUsage() const;
+
+    // 保存/恢复各通道当前长帧窗口及其中已收到的峰值
+    void saveState(StateWriter& writer) const;
+    void restoreState(StateReader& reader);
+
 private:
     struct WndInfo {
         double start_time;
@@ -30,6 +37,9 @@ private:
 
     void consumePeaks(size_t channel);
 
+    // 回收hash计算阶段换回的旧长帧的峰值数组，之后清空long_frames_
+    void recycleLongFrames(size_t channel);
+
 private:
     SignatureGenerationPipelineCtx* ctx_;
     size_t max_peak_count_;
@@ -39,6 +49,9 @@ private:
 
     ChannelArray<std::vector<Frame>> long_frames_;
 
+    // 回收的峰值数组，生成长帧后给峰值缓冲换上，避免每个长帧重新分配
+    ChannelArray<std::vector<std::vector<Peak>>> spare_peak_buffers_;
+
     HashComputationPhase* hash_computation_phase_;
 };
 
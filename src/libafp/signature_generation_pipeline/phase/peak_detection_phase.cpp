@@ -2,13 +2,21 @@
 #include <iostream>
 #include <algorithm>
 #include <map>
+#include "base/memory_accounting.h"
+#include "base/state_stream.h"
 
 namespace afp {
 
+namespace {
+
+const TraceEventDesc kPeakWindowTraceEvent = {"PeakWindow", "pipeline", "peaks", "start_timestamp", "end_timestamp"};
+
+} // namespace
+
 PeakDetectionPhase::PeakDetectionPhase(SignatureGenerationPipelineCtx* ctx)
     : ctx_(ctx)
-    , peek_detection_duration_(ctx->config->getPeakDetectionConfig().peakTimeDuration)
     , peak_config_(ctx->config->getPeakDetectionConfig())
+    , peek_detection_duration_(ctx->peak_detection_duration)
     , fft_results_cache_()
     , detected_peaks_()
     , detection_states_()
@@ -18,18 +26,38 @@ PeakDetectionPhase::PeakDetectionPhase(SignatureGenerationPipelineCtx* ctx)
         static_cast<float>(peak_config_.minFreq),
         static_cast<float>(peak_config_.maxFreq),
         peak_config_.numFrequencyBands);
-    
-    // 初始化峰值提取器
-    peak_extractor_ = std::make_unique<PeakExtractor>(ctx);
+
+    // 频段划分和权重在整个生命周期内不变，预先算好bin到频段的映射和按权重的分配顺序
+    bin_bands_.resize(ctx_->bin_frequencies.size());
+    for (size_t freq_idx = 0; freq_idx < bin_bands_.size(); ++freq_idx) {
+        bin_bands_[freq_idx] = band_manager_->findBandIndex(ctx_->bin_frequencies[freq_idx]);
+    }
+    band_weights_ = band_manager_->getBandWeights();
+    total_weight_ = band_manager_->getTotalWeight();
+    bands_by_weight_.resize(band_weights_.size());
+    for (size_t i = 0; i < bands_by_weight_.size(); ++i) {
+        bands_by_weight_[i] = static_cast<int>(i);
+    }
+    std::stable_sort(bands_by_weight_.begin(), bands_by_weight_.end(),
+                     [&](int a, int b) { return band_weights_[a] > band_weights_[b]; });
     
     // 计算每个通道缓存的容量
-    const auto shortFrameDuration = static_cast<double>(ctx_->config->getFFTConfig().hopSize) / ctx_->sample_rate;
+    const auto shortFrameDuration = static_cast<double>(ctx_->hop_size) / ctx_->sample_rate;
     const auto peakDetectionFrameCount = std::ceil(peek_detection_duration_ / shortFrameDuration);
     const auto totalBufferSize = peakDetectionFrameCount + 2 * peak_config_.timeMaxRange;
 
     // 初始化每个通道的ring buffer和数据结构
     for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
-        fft_results_cache_[channel_i] = std::make_unique<RingBuffer<FFTResult>>(totalBufferSize);
+        fft_results_cache_[channel_i] = std::make_unique<SpectrogramRing>(totalBufferSize, ctx_->fft_size / 2);
+        // 峰值提取器带有计算用的缓冲，每个通道一个，通道并行时互不干扰
+        peak_extractors_[channel_i] = std::make_unique<PeakExtractor>(ctx);
+        auto& scratch = quota_scratches_[channel_i];
+        scratch.band_energies.resize(band_weights_.size());
+        scratch.band_offsets.resize(band_weights_.size() + 1);
+        scratch.band_cursors.resize(band_weights_.size());
+        scratch.band_quotas.resize(band_weights_.size());
+        scratch.insufficient_bands.reserve(band_weights_.size());
+        scratch.need_more_bands.reserve(band_weights_.size());
         detected_peaks_[channel_i].clear();
         detection_states_[channel_i].reset();
     }
@@ -50,289 +78,352 @@ PeakDetectionPhase::PeakDetectionPhase(SignatureGenerationPipelineCtx* ctx)
 
 PeakDetectionPhase::~PeakDetectionPhase() = default;
 
+size_t PeakDetectionPhase::memoryUsage() const {
+    size_t bytes = heapBytes(bin_bands_) + heapBytes(band_weights_) + heapBytes(bands_by_weight_) +
+                   heapBytes(band_manager_->getBands());
+    for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
+        bytes += fft_results_cache_[channel_i]->memoryUsage();
+        bytes += peak_extractors_[channel_i]->memoryUsage();
+        bytes += heapBytes(raw_peaks_[channel_i]) + heapBytes(detected_peaks_[channel_i]);
+        const auto& scratch = quota_scratches_[channel_i];
+        bytes += heapBytes(scratch.band_energies) + heapBytes(scratch.band_offsets) + heapBytes(scratch.band_cursors) +
+                 heapBytes(scratch.band_peaks) + heapBytes(scratch.band_quotas) +
+                 heapBytes(scratch.insufficient_bands) + heapBytes(scratch.need_more_bands) +
+                 heapBytes(scratch.filtered_peaks);
+    }
+    return bytes;
+}
+
 void PeakDetectionPhase::attach(LongFrameBuildingPhase* longFrameBuildingPhase) {
     longFrameBuildingPhase_ = longFrameBuildingPhase;
 }
 
-void PeakDetectionPhase::handleShortFrames(ChannelArray<std::vector<FFTResult>>& fft_results) {
+void PeakDetectionPhase::handleShortFrames(const ChannelArray<SpectrogramView>& short_frames) {
+    PhaseTimer timer(ctx_->counters, ctx_->trace, PipelinePhase::PeakDetection);
+    for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
+        ctx_->counters.addIn(PipelinePhase::PeakDetection, short_frames[channel_i].size());
+    }
+
 #ifdef ENABLED_DIAGNOSE
-    bool is_satisfied_to_detect = false;
     size_t total_fft_results = 0;
     for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
-        total_fft_results += fft_results[channel_i].size();
+        total_fft_results += short_frames[channel_i].size();
     }
     std::cout << "[DIAGNOSE-峰值检测] 开始处理短帧: 总FFT结果数=" << total_fft_results << std::endl;
 #endif
 
+    // 各通道的缓存、检测状态和峰值提取器相互独立，可按通道并行处理
+    ChannelArray<bool> channel_detected;
+    channel_detected.fill(false);
+    ctx_->forEachChannel([&](size_t channel_i) {
+        channel_detected[channel_i] = handleChannelShortFrames(channel_i, short_frames[channel_i]);
+    });
+
+    // 如果检测到峰值，则通知长帧构建阶段处理峰值
+    bool has_peaks = false;
+    size_t total_peaks = 0;
     for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
-        auto& fftr = fft_results[channel_i];
-        size_t fftr_remaining = fftr.size();
-        size_t fftr_offset = 0;
-        auto* fftr_ring_buffer = fft_results_cache_[channel_i].get();
-        auto& detection_state = detection_states_[channel_i];
-        
+        total_peaks += detected_peaks_[channel_i].size();
+        if (detected_peaks_[channel_i].size() > 0) {
+            has_peaks = true;
+        }
+    }
+
 #ifdef ENABLED_DIAGNOSE
-        std::cout << "[DIAGNOSE-峰值检测] 处理通道" << channel_i << ": 新增FFT结果=" 
-                  << fftr.size() << ", 缓存状态=" << fftr_ring_buffer->size() 
-                  << "/" << fftr_ring_buffer->capacity() << "缓存详情:[";
-        for (size_t i = 0; i < fftr_ring_buffer->size(); ++i) {
-            std::cout << (*fftr_ring_buffer)[i].timestamp << "s ";
+    const bool is_satisfied_to_detect = std::any_of(
+        channel_detected.begin(), channel_detected.begin() + ctx_->channel_count, [](bool detected) { return detected; });
+    if (is_satisfied_to_detect) {
+        std::cout << "[DIAGNOSE-峰值检测] 峰值检测完成: 总峰值数=" << total_peaks 
+                << ", 有峰值=" << (has_peaks ? "是" : "否") << std::endl;
+        for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
+            std::cout << "  通道" << channel_i << ": " << detected_peaks_[channel_i].size() << "个峰值" << std::endl;
         }
-        std::cout << "]";
-        if (detection_state.window_initialized) {
-            std::cout << "  当前窗口: [" << detection_state.current_window_start_time 
-                      << "s-" << detection_state.current_window_end_time << "s]" << std::endl;
-            std::cout << "  超出窗口元素数: " << detection_state.elements_beyond_window << std::endl;
-        } else {
-            std::cout << "  窗口未初始化" << std::endl;
+    } else {
+        std::cout << "[DIAGNOSE-峰值检测] 峰值检测还未满足要求";
+        for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
+            std::cout << "  通道" << channel_i << ": 当前缓存-[";
+
+            auto* fftr_ring_buffer = fft_results_cache_[channel_i].get();
+            for (size_t i = 0; i < fftr_ring_buffer->size(); ++i) {
+                std::cout << fftr_ring_buffer->timestamp(i) << "s ";
+            }
+            std::cout << "] 个"<< fftr_ring_buffer->size() << "元素, 当前时间窗-[" << detection_states_[channel_i].current_window_start_time << "s-" 
+                      << detection_states_[channel_i].current_window_end_time << "s]" << std::endl;
         }
+    }
+
 #endif
-        
-        if (!detection_state.window_initialized && fftr.size() > 0) {
-            detection_state.current_window_start_time = fftr[0].timestamp;
-            detection_state.current_window_end_time = detection_state.current_window_start_time + peek_detection_duration_;
-            detection_state.window_initialized = true;
-            
-#ifdef ENABLED_DIAGNOSE
-            std::cout << "[DIAGNOSE-窗口初始化] 通道" << channel_i << "初始化检测窗口:" << std::endl;
-            std::cout << "  起始时间戳: " << fftr[0].timestamp << "s" << std::endl;
-            std::cout << "  窗口时间: [" << detection_state.current_window_start_time << "s-" 
-                      << detection_state.current_window_end_time << "s]" << std::endl;
-            std::cout << "  窗口持续时间: " << peek_detection_duration_ << "s" << std::endl;
-#endif
+
+    if (has_peaks) {
+        ctx_->counters.addOut(PipelinePhase::PeakDetection, total_peaks);
+        longFrameBuildingPhase_->handlePeaks(detected_peaks_);
+
+        for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
+            detected_peaks_[channel_i].clear();
         }
+    }
+}
 
-        for (auto& fftr_item : fftr) {
-            // 当ring buffer 中只有peak_config_.timeMaxRange个元素时，把时间窗滑动到当前这个fftr_item所属的窗口
-            if (fftr_ring_buffer->size() == peak_config_.timeMaxRange) {
-                auto next_window_start_time = detection_state.current_window_end_time;
-                while (fftr_item.timestamp >= next_window_start_time) {
-                    detection_state.current_window_start_time = next_window_start_time;
-                    detection_state.current_window_end_time = next_window_start_time + peek_detection_duration_;
-                    next_window_start_time += peek_detection_duration_;
-                    
+bool PeakDetectionPhase::handleChannelShortFrames(size_t channel_i, const SpectrogramView& fftr) {
+    auto* fftr_ring_buffer = fft_results_cache_[channel_i].get();
+    auto& detection_state = detection_states_[channel_i];
+    bool detected = false;
+    
 #ifdef ENABLED_DIAGNOSE
-                    std::cout << "[DIAGNOSE-峰值检测窗口调整] 通道" << channel_i << "时间戳" << fftr_item.timestamp 
-                              << "s超出当前窗口，调整窗口到: [" << detection_state.current_window_start_time 
-                              << "s-" << detection_state.current_window_end_time << "s]" << std::endl;
+    std::cout << "[DIAGNOSE-峰值检测] 处理通道" << channel_i << ": 新增FFT结果=" 
+              << fftr.size() << ", 缓存状态=" << fftr_ring_buffer->size() 
+              << "/" << fftr_ring_buffer->capacity() << "缓存详情:[";
+    for (size_t i = 0; i < fftr_ring_buffer->size(); ++i) {
+        std::cout << fftr_ring_buffer->timestamp(i) << "s ";
+    }
+    std::cout << "]";
+    if (detection_state.window_initialized) {
+        std::cout << "  当前窗口: [" << detection_state.current_window_start_time 
+                  << "s-" << detection_state.current_window_end_time << "s]" << std::endl;
+        std::cout << "  超出窗口元素数: " << detection_state.elements_beyond_window << std::endl;
+    } else {
+        std::cout << "  窗口未初始化" << std::endl;
+    }
 #endif
-                }
-            }
-
-            // 写入数据到ring buffer
-            fftr_ring_buffer->push_back(fftr_item);
-            
+    
+    if (!detection_state.window_initialized && fftr.size() > 0) {
+        detection_state.current_window_start_time = fftr.timestamp(0);
+        detection_state.current_window_end_time = detection_state.current_window_start_time + peek_detection_duration_;
+        detection_state.window_initialized = true;
+        
 #ifdef ENABLED_DIAGNOSE
-            if (fftr_ring_buffer->size() % 10 == 0) { // 每10个元素输出一次状态
-                std::cout << "[DIAGNOSE-峰值检测数据写入, 每写入10个元素输出一次状态] 通道" << channel_i << "写入时间戳" << fftr_item.timestamp 
-                          << "s，缓存大小=" << fftr_ring_buffer->size() << std::endl;
-            }
+        std::cout << "[DIAGNOSE-窗口初始化] 通道" << channel_i << "初始化检测窗口:" << std::endl;
+        std::cout << "  起始时间戳: " << fftr.timestamp(0) << "s" << std::endl;
+        std::cout << "  窗口时间: [" << detection_state.current_window_start_time << "s-" 
+                  << detection_state.current_window_end_time << "s]" << std::endl;
+        std::cout << "  窗口持续时间: " << peek_detection_duration_ << "s" << std::endl;
 #endif
+    }
 
-            // 如果不够安全距离，继续累加元素
-            if (fftr_ring_buffer->size() <= peak_config_.timeMaxRange) {
-#ifdef ENABLED_DIAGNOSE
-                if (fftr_ring_buffer->size() == peak_config_.timeMaxRange) {
-                    std::cout << "[DIAGNOSE-安全距离] 通道" << channel_i << "达到前缘安全距离: " 
-                              << peak_config_.timeMaxRange << "个元素" << std::endl;
-                }
-#endif
-                continue;
-            }
+    for (size_t fftr_i = 0; fftr_i < fftr.size(); ++fftr_i) {
+        const double fftr_timestamp = fftr.timestamp(fftr_i);
 
-            // 如果当前元素时间戳小于等于当前窗口结束时间戳，继续累加元素
-            if (fftr_item.timestamp <= detection_state.current_window_end_time) {
-                continue;
-            }
-            
-            ++detection_state.elements_beyond_window;
-            if (detection_state.elements_beyond_window == 1) {
-                detection_state.first_beyond_window_timestamp = fftr_item.timestamp;
+        // 当ring buffer 中只有peak_config_.timeMaxRange个元素时，把时间窗滑动到当前这个短帧所属的窗口
+        if (fftr_ring_buffer->size() == peak_config_.timeMaxRange) {
+            auto next_window_start_time = detection_state.current_window_end_time;
+            while (fftr_timestamp >= next_window_start_time) {
+                detection_state.current_window_start_time = next_window_start_time;
+                detection_state.current_window_end_time = next_window_start_time + peek_detection_duration_;
+                next_window_start_time += peek_detection_duration_;
                 
 #ifdef ENABLED_DIAGNOSE
-                std::cout << "[DIAGNOSE-峰值检测超出窗口] 通道" << channel_i << "第一个超出窗口的元素:" << std::endl;
-                std::cout << "  时间戳: " << fftr_item.timestamp << "s" << std::endl;
-                std::cout << "  窗口结束时间: " << detection_state.current_window_end_time << "s" << std::endl;
-#endif
-            }
-            
-            // 如果不超过尾部安全距离，继续累加元素
-            if (detection_state.elements_beyond_window < peak_config_.timeMaxRange) {
-#ifdef ENABLED_DIAGNOSE
-                if (detection_state.elements_beyond_window % 5 == 0) { // 每5个元素输出一次
-                    std::cout << "[DIAGNOSE-峰值检测累积超出] 通道" << channel_i << "超出窗口元素数: " 
-                              << detection_state.elements_beyond_window << "/" << peak_config_.timeMaxRange << std::endl;
-                }
+                std::cout << "[DIAGNOSE-峰值检测窗口调整] 通道" << channel_i << "时间戳" << fftr_timestamp 
+                          << "s超出当前窗口，调整窗口到: [" << detection_state.current_window_start_time 
+                          << "s-" << detection_state.current_window_end_time << "s]" << std::endl;
 #endif
-                continue;
             }
+        }
 
+        // 写入数据到ring buffer
+        fftr_ring_buffer->pushBack(fftr, fftr_i);
+        
 #ifdef ENABLED_DIAGNOSE
-            std::cout << "[DIAGNOSE-峰值检测检测条件满足] 通道" << channel_i << "满足峰值检测条件:" << std::endl;
-            std::cout << "  缓存大小: " << fftr_ring_buffer->size() << std::endl;
-            std::cout << "  检测窗口: [" << detection_state.current_window_start_time 
-                      << "s-" << detection_state.current_window_end_time << "s]" << std::endl;
-            std::cout << "  超出窗口元素数: " << detection_state.elements_beyond_window 
-                      << " (需要: " << peak_config_.timeMaxRange << ")" << std::endl;
+        if (fftr_ring_buffer->size() % 10 == 0) { // 每10个元素输出一次状态
+            std::cout << "[DIAGNOSE-峰值检测数据写入, 每写入10个元素输出一次状态] 通道" << channel_i << "写入时间戳" << fftr_timestamp 
+                      << "s，缓存大小=" << fftr_ring_buffer->size() << std::endl;
+        }
 #endif
 
-            // 超过当前时间窗口结束时间戳的元素已经有 peak_config_.timeMaxRange 个，进行峰值检测
-            // 除去前后安全距离，至少要有一个元素
-            if (fftr_ring_buffer->size() >= 2 * peak_config_.timeMaxRange + 1) {
-                std::vector<FFTResult> current_results = fftr_ring_buffer->getRange(0, fftr_ring_buffer->size());
-                
+        // 如果不够安全距离，继续累加元素
+        if (fftr_ring_buffer->size() <= peak_config_.timeMaxRange) {
 #ifdef ENABLED_DIAGNOSE
-                const int start_idx = peak_config_.timeMaxRange;
-                const int end_idx = current_results.size() - peak_config_.timeMaxRange;
-                std::cout << "[DIAGNOSE-峰值检测开始检测] 通道" << channel_i << "开始峰值检测:" << std::endl;
-                std::cout << "  检测区域: [" << start_idx << ", " << end_idx << ") / [0, " << current_results.size() << ")" << std::endl;
-                std::cout << "  检测区域大小: " << (end_idx - start_idx) << "个短帧" << std::endl;
-                if (end_idx > start_idx) {
-                    std::cout << "  时间范围: ["; 
-                    for (int i = start_idx; i < end_idx; ++i) {
-                        std::cout << current_results[i].timestamp << "s ";
-                    }
-                    std::cout << "]" << std::endl;
-                }
-                is_satisfied_to_detect = true;
-#endif
-                
-                detectPeaksInWindow(current_results, peak_config_.timeMaxRange, current_results.size() - peak_config_.timeMaxRange, channel_i);
+            if (fftr_ring_buffer->size() == peak_config_.timeMaxRange) {
+                std::cout << "[DIAGNOSE-安全距离] 通道" << channel_i << "达到前缘安全距离: " 
+                          << peak_config_.timeMaxRange << "个元素" << std::endl;
             }
+#endif
+            continue;
+        }
 
-            // 移动窗口（移除到剩下2 * peak_config.timeMaxRange个样本）
-            size_t keep_count = 2 * peak_config_.timeMaxRange;
-            if (fftr_ring_buffer->size() < keep_count) {
-                std::throw_with_nested(std::runtime_error("fftr_ring_buffer->size() < keep_count"));
-            }
-            
-            size_t remove_count = fftr_ring_buffer->size() - keep_count;
+        // 如果当前元素时间戳小于等于当前窗口结束时间戳，继续累加元素
+        if (fftr_timestamp <= detection_state.current_window_end_time) {
+            continue;
+        }
+        
+        ++detection_state.elements_beyond_window;
+        if (detection_state.elements_beyond_window == 1) {
+            detection_state.first_beyond_window_timestamp = fftr_timestamp;
             
 #ifdef ENABLED_DIAGNOSE
-            std::cout << "[DIAGNOSE-峰值检测窗口移动] 通道" << channel_i << "移动窗口:" << std::endl;
-            std::cout << "  移除元素数: " << remove_count << std::endl;
-            std::cout << "  保留元素数: " << keep_count << std::endl;
-            std::cout << "  移动前缓存大小: " << fftr_ring_buffer->size() << std::endl;
+            std::cout << "[DIAGNOSE-峰值检测超出窗口] 通道" << channel_i << "第一个超出窗口的元素:" << std::endl;
+            std::cout << "  时间戳: " << fftr_timestamp << "s" << std::endl;
+            std::cout << "  窗口结束时间: " << detection_state.current_window_end_time << "s" << std::endl;
 #endif
-            
-            fftr_ring_buffer->moveWindow(remove_count);
-            
+        }
+        
+        // 如果不超过尾部安全距离，继续累加元素
+        if (detection_state.elements_beyond_window < peak_config_.timeMaxRange) {
 #ifdef ENABLED_DIAGNOSE
-            std::cout << "  移动后缓存大小: " << fftr_ring_buffer->size() << std::endl;
+            if (detection_state.elements_beyond_window % 5 == 0) { // 每5个元素输出一次
+                std::cout << "[DIAGNOSE-峰值检测累积超出] 通道" << channel_i << "超出窗口元素数: " 
+                          << detection_state.elements_beyond_window << "/" << peak_config_.timeMaxRange << std::endl;
+            }
 #endif
+            continue;
+        }
 
-            // 更新窗口到ring buffer 中倒数第peak_config_.timeMaxRange个元素所属的窗口
-            const auto next_wnd_start_idx = fftr_ring_buffer->size() - peak_config_.timeMaxRange;
-            auto& next_wnd_start_fftr_item = (*fftr_ring_buffer)[next_wnd_start_idx];
-            
-            // 将窗口滑动到next_wnd_start_fftr_item所属的窗口区间
-            auto next_window_start_time = detection_state.current_window_end_time;
-            auto old_window_start = detection_state.current_window_start_time;
-            auto old_window_end = detection_state.current_window_end_time;
-            
-            while (next_wnd_start_fftr_item.timestamp >= next_window_start_time) {
-                detection_state.current_window_start_time = next_window_start_time;
-                detection_state.current_window_end_time = next_window_start_time + peek_detection_duration_;
-                next_window_start_time = detection_state.current_window_end_time;
-            }
-            
 #ifdef ENABLED_DIAGNOSE
-            std::cout << "[DIAGNOSE-峰值检测窗口更新] 通道" << channel_i << "更新检测窗口:" << std::endl;
-            std::cout << "  参考元素时间戳: " << next_wnd_start_fftr_item.timestamp << "s (索引:" << next_wnd_start_idx << ")" << std::endl;
-            std::cout << "  旧窗口: [" << old_window_start << "s-" << old_window_end << "s]" << std::endl;
-            std::cout << "  新窗口: [" << detection_state.current_window_start_time << "s-" 
-                      << detection_state.current_window_end_time << "s]" << std::endl;
+        std::cout << "[DIAGNOSE-峰值检测检测条件满足] 通道" << channel_i << "满足峰值检测条件:" << std::endl;
+        std::cout << "  缓存大小: " << fftr_ring_buffer->size() << std::endl;
+        std::cout << "  检测窗口: [" << detection_state.current_window_start_time 
+                  << "s-" << detection_state.current_window_end_time << "s]" << std::endl;
+        std::cout << "  超出窗口元素数: " << detection_state.elements_beyond_window 
+                  << " (需要: " << peak_config_.timeMaxRange << ")" << std::endl;
 #endif
-            
-            detection_state.elements_beyond_window = 0;
-            detection_state.first_beyond_window_timestamp = 0.0;
-            
-            // 更新first_beyond_window_timestamp和elements_beyond_window
-            for (size_t i = 1; i < peak_config_.timeMaxRange; ++i) {
-                if ((*fftr_ring_buffer)[next_wnd_start_idx + i].timestamp > detection_state.current_window_end_time) {
-                    ++detection_state.elements_beyond_window;
-                    if (detection_state.elements_beyond_window == 1) {
-                        detection_state.first_beyond_window_timestamp = (*fftr_ring_buffer)[next_wnd_start_idx + i].timestamp;
-                    }
-                }
-            }
+
+        // 超过当前时间窗口结束时间戳的元素已经有 peak_config_.timeMaxRange 个，进行峰值检测
+        // 除去前后安全距离，至少要有一个元素
+        if (fftr_ring_buffer->size() >= 2 * peak_config_.timeMaxRange + 1) {
+            const SpectrogramView current_results = fftr_ring_buffer->view();
+            detected = true;
             
 #ifdef ENABLED_DIAGNOSE
-            std::cout << "  重新计算超出窗口元素数: " << detection_state.elements_beyond_window << std::endl;
-            if (detection_state.elements_beyond_window > 0) {
-                std::cout << "  首个超出元素时间戳: " << detection_state.first_beyond_window_timestamp << "s" << std::endl;
+            const int start_idx = peak_config_.timeMaxRange;
+            const int end_idx = current_results.size() - peak_config_.timeMaxRange;
+            std::cout << "[DIAGNOSE-峰值检测开始检测] 通道" << channel_i << "开始峰值检测:" << std::endl;
+            std::cout << "  检测区域: [" << start_idx << ", " << end_idx << ") / [0, " << current_results.size() << ")" << std::endl;
+            std::cout << "  检测区域大小: " << (end_idx - start_idx) << "个短帧" << std::endl;
+            if (end_idx > start_idx) {
+                std::cout << "  时间范围: ["; 
+                for (int i = start_idx; i < end_idx; ++i) {
+                    std::cout << current_results.timestamp(i) << "s ";
+                }
+                std::cout << "]" << std::endl;
             }
 #endif
+            
+            detectPeaksInWindow(current_results, peak_config_.timeMaxRange, current_results.size() - peak_config_.timeMaxRange, channel_i);
         }
-    }
 
-    // 如果检测到峰值，则通知长帧构建阶段处理峰值
-    bool has_peaks = false;
-    size_t total_peaks = 0;
-    for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
-        total_peaks += detected_peaks_[channel_i].size();
-        if (detected_peaks_[channel_i].size() > 0) {
-            has_peaks = true;
+        // 移动窗口（移除到剩下2 * peak_config.timeMaxRange个样本）
+        size_t keep_count = 2 * peak_config_.timeMaxRange;
+        if (fftr_ring_buffer->size() < keep_count) {
+            std::throw_with_nested(std::runtime_error("fftr_ring_buffer->size() < keep_count"));
         }
-    }
+        
+        size_t remove_count = fftr_ring_buffer->size() - keep_count;
+        
+#ifdef ENABLED_DIAGNOSE
+        std::cout << "[DIAGNOSE-峰值检测窗口移动] 通道" << channel_i << "移动窗口:" << std::endl;
+        std::cout << "  移除元素数: " << remove_count << std::endl;
+        std::cout << "  保留元素数: " << keep_count << std::endl;
+        std::cout << "  移动前缓存大小: " << fftr_ring_buffer->size() << std::endl;
+#endif
+        
+        fftr_ring_buffer->moveWindow(remove_count);
+        
+#ifdef ENABLED_DIAGNOSE
+        std::cout << "  移动后缓存大小: " << fftr_ring_buffer->size() << std::endl;
+#endif
 
+        // 更新窗口到ring buffer 中倒数第peak_config_.timeMaxRange个元素所属的窗口
+        const auto next_wnd_start_idx = fftr_ring_buffer->size() - peak_config_.timeMaxRange;
+        const double next_wnd_start_timestamp = fftr_ring_buffer->timestamp(next_wnd_start_idx);
+        
+        // 将窗口滑动到next_wnd_start_idx处元素所属的窗口区间
+        auto next_window_start_time = detection_state.current_window_end_time;
 #ifdef ENABLED_DIAGNOSE
-    if (is_satisfied_to_detect) {
-        std::cout << "[DIAGNOSE-峰值检测] 峰值检测完成: 总峰值数=" << total_peaks 
-                << ", 有峰值=" << (has_peaks ? "是" : "否") << std::endl;
-        for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
-            std::cout << "  通道" << channel_i << ": " << detected_peaks_[channel_i].size() << "个峰值" << std::endl;
+        const auto old_window_start = detection_state.current_window_start_time;
+        const auto old_window_end = detection_state.current_window_end_time;
+#endif
+        
+        while (next_wnd_start_timestamp >= next_window_start_time) {
+            detection_state.current_window_start_time = next_window_start_time;
+            detection_state.current_window_end_time = next_window_start_time + peek_detection_duration_;
+            next_window_start_time = detection_state.current_window_end_time;
         }
-    } else {
-        std::cout << "[DIAGNOSE-峰值检测] 峰值检测还未满足要求";
-        for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
-            std::cout << "  通道" << channel_i << ": 当前缓存-[";
-
-            auto* fftr_ring_buffer = fft_results_cache_[channel_i].get();
-            for (size_t i = 0; i < fftr_ring_buffer->size(); ++i) {
-                std::cout << (*fftr_ring_buffer)[i].timestamp << "s ";
+        
+#ifdef ENABLED_DIAGNOSE
+        std::cout << "[DIAGNOSE-峰值检测窗口更新] 通道" << channel_i << "更新检测窗口:" << std::endl;
+        std::cout << "  参考元素时间戳: " << next_wnd_start_timestamp << "s (索引:" << next_wnd_start_idx << ")" << std::endl;
+        std::cout << "  旧窗口: [" << old_window_start << "s-" << old_window_end << "s]" << std::endl;
+        std::cout << "  新窗口: [" << detection_state.current_window_start_time << "s-" 
+                  << detection_state.current_window_end_time << "s]" << std::endl;
+#endif
+        
+        detection_state.elements_beyond_window = 0;
+        detection_state.first_beyond_window_timestamp = 0.0;
+        
+        // 更新first_beyond_window_timestamp和elements_beyond_window
+        for (size_t i = 1; i < peak_config_.timeMaxRange; ++i) {
+            if (fftr_ring_buffer->timestamp(next_wnd_start_idx + i) > detection_state.current_window_end_time) {
+                ++detection_state.elements_beyond_window;
+                if (detection_state.elements_beyond_window == 1) {
+                    detection_state.first_beyond_window_timestamp = fftr_ring_buffer->timestamp(next_wnd_start_idx + i);
+                }
             }
-            std::cout << "] 个"<< fftr_ring_buffer->size() << "元素, 当前时间窗-[" << detection_states_[channel_i].current_window_start_time << "s-" 
-                      << detection_states_[channel_i].current_window_end_time << "s]" << std::endl;
         }
-    }
-
+        
+#ifdef ENABLED_DIAGNOSE
+        std::cout << "  重新计算超出窗口元素数: " << detection_state.elements_beyond_window << std::endl;
+        if (detection_state.elements_beyond_window > 0) {
+            std::cout << "  首个超出元素时间戳: " << detection_state.first_beyond_window_timestamp << "s" << std::endl;
+        }
 #endif
+    }
 
-    if (has_peaks) {
-        longFrameBuildingPhase_->handlePeaks(detected_peaks_);
+    return detected;
+}
 
-        for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
-            detected_peaks_[channel_i].clear();
-        }
+void PeakDetectionPhase::setWindowOrigin(double window_start_time) {
+    for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
+        auto& detection_state = detection_states_[channel_i];
+        detection_state.current_window_start_time = window_start_time;
+        detection_state.current_window_end_time = window_start_time + peek_detection_duration_;
+        detection_state.window_initialized = true;
     }
 }
 
 void PeakDetectionPhase::detectPeaksInWindow(
-    const std::vector<FFTResult>& fft_results,
+    const SpectrogramView& spectrogram,
     int start_idx, int end_idx,
     size_t channel_i) {
 
+    const auto trace_window = [&](size_t peak_count) {
+        ctx_->trace.instant(kPeakWindowTraceEvent, static_cast<uint32_t>(peak_count),
+                            spectrogram.timestamp(start_idx), spectrogram.timestamp(end_idx - 1));
+    };
+
 #ifdef ENABLED_DIAGNOSE
     std::cout << "[DIAGNOSE-峰值检测] 通道" << channel_i << "开始窗口内峰值检测:" << std::endl;
-    std::cout << "  FFT结果数量: " << fft_results.size() << std::endl;
+    std::cout << "  FFT结果数量: " << spectrogram.size() << std::endl;
     std::cout << "  检测范围: [" << start_idx << ", " << end_idx << ")" << std::endl;
     std::cout << "  分位数阈值: " << peak_config_.quantileThreshold << std::endl;
 #endif
     
+    // 静音帧的幅度全为0，不会超过分位数阈值；窗口内全是静音帧时不可能有峰值，跳过提取
+    bool all_silent = true;
+    for (int i = start_idx; i < end_idx && all_silent; ++i) {
+        all_silent = spectrogram.silent(i);
+    }
+    if (all_silent) {
+#ifdef ENABLED_DIAGNOSE
+        std::cout << "[DIAGNOSE-峰值检测] 通道" << channel_i << "检测窗口内全是静音帧，跳过峰值提取" << std::endl;
+#endif
+        trace_window(0);
+        return;
+    }
+
     // 使用峰值提取器检测峰值
-    std::vector<Peak> raw_peaks = peak_extractor_->extractPeaks(
-        fft_results, start_idx, end_idx, peak_config_.quantileThreshold);
+    auto& raw_peaks = raw_peaks_[channel_i];
+    peak_extractors_[channel_i]->extractPeaks(
+        spectrogram, start_idx, end_idx, peak_config_.quantileThreshold, raw_peaks);
     
     if (raw_peaks.empty()) {
 #ifdef ENABLED_DIAGNOSE
         std::cout << "[DIAGNOSE-峰值检测] 通道" << channel_i << "未检测到原始峰值" << std::endl;
 #endif
+        trace_window(0);
         return;
     }
     
     // 计算动态峰值配额
-    int dynamic_quota = calculateDynamicPeakQuota(fft_results, start_idx, end_idx, channel_i);
+    int dynamic_quota = calculateDynamicPeakQuota(spectrogram, start_idx, end_idx, channel_i);
     
 #ifdef ENABLED_DIAGNOSE
     std::cout << "[DIAGNOSE-峰值检测] 通道" << channel_i << "原始峰值统计:" << std::endl;
@@ -353,34 +444,37 @@ void PeakDetectionPhase::detectPeaksInWindow(
 #endif
     
     // 如果峰值数量超过配额，进行过滤
-    std::vector<Peak> final_peaks;
+    auto& scratch = quota_scratches_[channel_i];
+    const std::vector<Peak>* final_peaks_ptr = &raw_peaks;
     if (static_cast<int>(raw_peaks.size()) > dynamic_quota) {
-        std::vector<int> band_quotas = allocatePeakQuotas(raw_peaks, dynamic_quota);
-        final_peaks = filterPeaksToQuota(raw_peaks, band_quotas);
+        groupPeaksByBand(raw_peaks, scratch);
+        allocatePeakQuotas(dynamic_quota, scratch);
+        filterPeaksToQuota(scratch);
+        final_peaks_ptr = &scratch.filtered_peaks;
         
 #ifdef ENABLED_DIAGNOSE
         // std::cout << "[DIAGNOSE-峰值过滤] 通道" << channel_i << "需要过滤峰值" << std::endl;
         // std::cout << "  频段配额分配: ";
-        // for (size_t i = 0; i < band_quotas.size(); ++i) {
-        //     if (band_quotas[i] > 0) {
+        // for (size_t i = 0; i < scratch.band_quotas.size(); ++i) {
+        //     if (scratch.band_quotas[i] > 0) {
         //         const auto& bands = band_manager_->getBands();
         //         std::cout << bands[i].min_freq << "-" << bands[i].max_freq 
-        //                   << "Hz(" << band_quotas[i] << ") ";
+        //                   << "Hz(" << scratch.band_quotas[i] << ") ";
         //     }
         // }
         // std::cout << std::endl;
 #endif
     } else {
-        final_peaks = std::move(raw_peaks);
-        
 #ifdef ENABLED_DIAGNOSE
         std::cout << "[DIAGNOSE-峰值检测] 通道" << channel_i << "峰值数量未超配额，无需过滤" << std::endl;
 #endif
     }
     
     // 存储检测结果
+    const std::vector<Peak>& final_peaks = *final_peaks_ptr;
     detected_peaks_[channel_i].insert(
         detected_peaks_[channel_i].end(), final_peaks.begin(), final_peaks.end());
+    trace_window(final_peaks.size());
     
 #ifdef ENABLED_DIAGNOSE
     std::cout << "[DIAGNOSE-峰值检测] 通道" << channel_i << "最终保留 " << final_peaks.size() 
@@ -398,25 +492,24 @@ void PeakDetectionPhase::detectPeaksInWindow(
 }
 
 int PeakDetectionPhase::calculateDynamicPeakQuota(
-    const std::vector<FFTResult>& fft_results,
+    const SpectrogramView& spectrogram,
     int start_idx, int end_idx,
     size_t channel_i) {
     
-    const size_t fft_size = ctx_->fft_size;
+    const size_t bin_count = spectrogram.binCount();
     
     // 计算频段能量
-    std::vector<float> band_energies(band_manager_->getBands().size(), 0.0f);
-    std::vector<float> band_noise_levels(band_manager_->getBands().size(), 0.0f);
+    auto& band_energies = quota_scratches_[channel_i].band_energies;
+    std::fill(band_energies.begin(), band_energies.end(), 0.0f);
     
-    // 收集每个频段的能量和噪声水平
+    // 收集每个频段的能量
     for (int frame_idx = start_idx; frame_idx < end_idx; ++frame_idx) {
-        const auto& frame = fft_results[frame_idx];
+        const float* magnitudes = spectrogram.magnitudes(frame_idx);
         
-        for (size_t freq_idx = 0; freq_idx < fft_size / 2; ++freq_idx) {
-            float freq = frame.frequencies[freq_idx];
-            float magnitude = frame.magnitudes[freq_idx];
+        for (size_t freq_idx = 0; freq_idx < bin_count; ++freq_idx) {
+            float magnitude = magnitudes[freq_idx];
             
-            int band_idx = band_manager_->findBandIndex(freq);
+            int band_idx = bin_bands_[freq_idx];
             if (band_idx >= 0) {
                 band_energies[band_idx] += magnitude * magnitude;
             }
@@ -444,12 +537,14 @@ int PeakDetectionPhase::calculateDynamicPeakQuota(
     float combined_factor = peak_config_.energyWeightFactor * energy_factor + 
                            peak_config_.snrWeightFactor * snr_factor;
     
+    // 上限按当前降级级别生效
+    const size_t max_peaks_per_frame = ctx_->maxPeaksPerFrame();
     int dynamic_count = static_cast<int>(
         peak_config_.minPeaksPerFrame + 
-        combined_factor * (peak_config_.maxPeaksPerFrameLimit - peak_config_.minPeaksPerFrame));
+        combined_factor * (max_peaks_per_frame - peak_config_.minPeaksPerFrame));
     
     int final_quota = std::max(static_cast<int>(peak_config_.minPeaksPerFrame), 
-                              std::min(dynamic_count, static_cast<int>(peak_config_.maxPeaksPerFrameLimit)));
+                              std::min(dynamic_count, static_cast<int>(max_peaks_per_frame)));
 
 #ifdef ENABLED_DIAGNOSE
     std::cout << "[DIAGNOSE-动态配额] 通道" << channel_i << "配额计算:" << std::endl;
@@ -457,35 +552,53 @@ int PeakDetectionPhase::calculateDynamicPeakQuota(
     std::cout << "  SNR因子: " << snr_factor << ", 组合因子: " << combined_factor << std::endl;
     std::cout << "  计算配额: " << dynamic_count << ", 最终配额: " << final_quota << std::endl;
     std::cout << "  配额范围: [" << peak_config_.minPeaksPerFrame << ", " 
-              << peak_config_.maxPeaksPerFrameLimit << "]" << std::endl;
+              << max_peaks_per_frame << "]" << std::endl;
 #endif
 
     return final_quota;
 }
 
-std::vector<int> PeakDetectionPhase::allocatePeakQuotas(
+void PeakDetectionPhase::groupPeaksByBand(
     const std::vector<Peak>& peaks,
-    int total_quota) {
-    
-    const auto& bands = band_manager_->getBands();
-    std::vector<int> band_quotas(bands.size(), 0);
-    
-    // 将峰值按频段分组
-    std::vector<std::vector<Peak>> band_peaks(bands.size());
+    PeakQuotaScratch& scratch) {
+
+    const size_t band_count = band_weights_.size();
+    auto& offsets = scratch.band_offsets;
+    auto& cursors = scratch.band_cursors;
+
+    // 计数排序：先统计各频段的峰值数，再按前缀和把峰值依次放到各自频段的区间
+    std::fill(offsets.begin(), offsets.end(), 0);
     for (const auto& peak : peaks) {
         int band_idx = band_manager_->findBandIndex(static_cast<float>(peak.frequency));
         if (band_idx >= 0) {
-            band_peaks[band_idx].push_back(peak);
+            ++offsets[band_idx + 1];
         }
     }
+    for (size_t i = 0; i < band_count; ++i) {
+        offsets[i + 1] += offsets[i];
+        cursors[i] = offsets[i];
+    }
+
+    scratch.band_peaks.resize(offsets[band_count]);
+    for (const auto& peak : peaks) {
+        int band_idx = band_manager_->findBandIndex(static_cast<float>(peak.frequency));
+        if (band_idx >= 0) {
+            scratch.band_peaks[cursors[band_idx]++] = peak;
+        }
+    }
+}
+
+void PeakDetectionPhase::allocatePeakQuotas(
+    int total_quota,
+    PeakQuotaScratch& scratch) {
     
-    // 根据权重分配初始配额
-    std::vector<float> band_weights = band_manager_->getBandWeights();
-    float total_weight = band_manager_->getTotalWeight();
+    const size_t band_count = band_weights_.size();
+    auto& band_quotas = scratch.band_quotas;
     
+    // 根据权重分配初始配额
     int allocated_quota = 0;
-    for (size_t i = 0; i < bands.size(); ++i) {
-        band_quotas[i] = static_cast<int>((band_weights[i] / total_weight) * total_quota);
+    for (size_t i = 0; i < band_count; ++i) {
+        band_quotas[i] = static_cast<int>((band_weights_[i] / total_weight_) * total_quota);
         allocated_quota += band_quotas[i];
     }
     
@@ -493,45 +606,43 @@ std::vector<int> PeakDetectionPhase::allocatePeakQuotas(
     int remaining_quota = total_quota - allocated_quota;
     
     // 按权重降序分配剩余配额
-    std::vector<std::pair<float, size_t>> weighted_bands;
-    for (size_t i = 0; i < bands.size(); ++i) {
-        weighted_bands.emplace_back(band_weights[i], i);
-    }
-    std::sort(weighted_bands.begin(), weighted_bands.end(),
-              [](const auto& a, const auto& b) { return a.first > b.first; });
-    
-    for (const auto& wb : weighted_bands) {
+    for (int band : bands_by_weight_) {
         if (remaining_quota <= 0) break;
-        band_quotas[wb.second]++;
+        band_quotas[band]++;
         remaining_quota--;
     }
 
 #ifdef ENABLED_DIAGNOSE
     std::cout << "[DIAGNOSE-初始配额] 初始配额分配完成:" << std::endl;
-    for (size_t i = 0; i < bands.size(); ++i) {
-        std::cout << "  频段" << i << ": 权重=" << band_weights[i] 
+    for (size_t i = 0; i < band_count; ++i) {
+        std::cout << "  频段" << i << ": 权重=" << band_weights_[i] 
                   << ", 初始配额=" << band_quotas[i] 
-                  << ", 峰值数=" << band_peaks[i].size() << std::endl;
+                  << ", 峰值数=" << scratch.bandPeakCount(i) << std::endl;
     }
 #endif
     
     // 优化分配策略：处理空频段和峰值不足的频段，将多余配额收回
-    std::vector<int> insufficient_bands;   // 峰值数量少于配额的频段（包括空频段）
-    std::vector<int> need_more_bands;      // 峰值数量超过配额的频段
-    
-    for (size_t i = 0; i < band_peaks.size(); ++i) {
-        int peak_count = static_cast<int>(band_peaks[i].size());
-        if (peak_count < band_quotas[i]) {
-            insufficient_bands.push_back(i);
-        } else if (peak_count > band_quotas[i]) {
-            need_more_bands.push_back(i);
+    auto& insufficient_bands = scratch.insufficient_bands;
+    auto& need_more_bands = scratch.need_more_bands;
+    insufficient_bands.clear();
+    need_more_bands.clear();
+    
+    for (size_t i = 0; i < band_count; ++i) {
+        if (static_cast<int>(scratch.bandPeakCount(i)) < band_quotas[i]) {
+            insufficient_bands.push_back(static_cast<int>(i));
+        }
+    }
+    // 按权重降序收集，剩余配额优先分配给高权重频段
+    for (int band : bands_by_weight_) {
+        if (static_cast<int>(scratch.bandPeakCount(band)) > band_quotas[band]) {
+            need_more_bands.push_back(band);
         }
     }
     
     // 从峰值不足的频段收回多余配额
     remaining_quota = 0;
     for (int band : insufficient_bands) {
-        int actual_peaks = static_cast<int>(band_peaks[band].size());
+        int actual_peaks = static_cast<int>(scratch.bandPeakCount(band));
         int excess_quota = band_quotas[band] - actual_peaks;
         remaining_quota += excess_quota;
         band_quotas[band] = actual_peaks;  // 设置为实际峰值数量
@@ -545,15 +656,11 @@ std::vector<int> PeakDetectionPhase::allocatePeakQuotas(
 #endif
     
     // 按优先级将剩余配额分配给需要更多峰值的频段
-    // 优先分配给高权重频段
-    std::sort(need_more_bands.begin(), need_more_bands.end(),
-              [&](int a, int b) { return band_weights[a] > band_weights[b]; });
-    
     while (remaining_quota > 0 && !need_more_bands.empty()) {
         bool allocated = false;
         for (int band : need_more_bands) {
             if (remaining_quota <= 0) break;
-            if (band_quotas[band] < static_cast<int>(band_peaks[band].size())) {
+            if (band_quotas[band] < static_cast<int>(scratch.bandPeakCount(band))) {
                 band_quotas[band]++;
                 remaining_quota--;
                 allocated = true;
@@ -577,90 +684,91 @@ std::vector<int> PeakDetectionPhase::allocatePeakQuotas(
         // 移除已满足的频段
         need_more_bands.erase(
             std::remove_if(need_more_bands.begin(), need_more_bands.end(),
-                [&](int band) { return band_quotas[band] >= static_cast<int>(band_peaks[band].size()); }),
+                [&](int band) { return band_quotas[band] >= static_cast<int>(scratch.bandPeakCount(band)); }),
             need_more_bands.end()
         );
     }
 
 #ifdef ENABLED_DIAGNOSE
+    const auto& bands = band_manager_->getBands();
     std::cout << "[DIAGNOSE-配额分配] 频段配额详情:" << std::endl;
-    for (size_t i = 0; i < bands.size(); ++i) {
+    for (size_t i = 0; i < band_count; ++i) {
         std::cout << "  频段" << i << " [" << bands[i].min_freq << "-" << bands[i].max_freq 
-                  << "Hz]: 峰值数=" << band_peaks[i].size() << ", 配额=" << band_quotas[i] 
-                  << ", 权重=" << band_weights[i] << std::endl;
+                  << "Hz]: 峰值数=" << scratch.bandPeakCount(i) << ", 配额=" << band_quotas[i] 
+                  << ", 权重=" << band_weights_[i] << std::endl;
     }
 
     size_t final_allocated_quota = 0;
-    for (size_t i = 0; i < band_quotas.size(); ++i) {
+    for (size_t i = 0; i < band_count; ++i) {
         final_allocated_quota += band_quotas[i];
     }
 
     std::cout << "  总配额: " << total_quota << ", 最终分配: " << final_allocated_quota 
               << ", 剩余: " << (total_quota - final_allocated_quota) << std::endl;
 #endif
-    
-    return band_quotas;
 }
 
-std::vector<Peak> PeakDetectionPhase::filterPeaksToQuota(
-    const std::vector<Peak>& peaks,
-    const std::vector<int>& band_quotas) {
+void PeakDetectionPhase::filterPeaksToQuota(PeakQuotaScratch& scratch) {
     
-    const auto& bands = band_manager_->getBands();
-    std::vector<std::vector<Peak>> band_peaks(bands.size());
+    const size_t band_count = band_weights_.size();
     
-    // 将峰值按频段分组
-    for (const auto& peak : peaks) {
-        int band_idx = band_manager_->findBandIndex(static_cast<float>(peak.frequency));
-        if (band_idx >= 0) {
-            band_peaks[band_idx].push_back(peak);
-        }
-    }
+    // 幅度降序；幅度相同时按时间、频率排列，保证选出的峰值与输入顺序无关
+    const auto stronger = [](const Peak& a, const Peak& b) {
+        if (a.magnitude != b.magnitude) return a.magnitude > b.magnitude;
+        if (a.timestamp != b.timestamp) return a.timestamp < b.timestamp;
+        return a.frequency < b.frequency;
+    };
     
-    // 在每个频段内按幅度排序并选择顶部峰值
-    std::vector<Peak> filtered_peaks;
-    for (size_t i = 0; i < band_peaks.size(); ++i) {
-        if (band_quotas[i] == 0 || band_peaks[i].empty()) {
+    // 在每个频段内选择幅度最大的峰值：只需把前k个分出来，用nth_element代替整体排序
+    auto& filtered_peaks = scratch.filtered_peaks;
+    filtered_peaks.clear();
+    for (size_t i = 0; i < band_count; ++i) {
+        const size_t band_peak_count = scratch.bandPeakCount(i);
+        if (scratch.band_quotas[i] == 0 || band_peak_count == 0) {
             continue;
         }
         
-        // 按幅度降序排序
-        std::sort(band_peaks[i].begin(), band_peaks[i].end(),
-                  [](const Peak& a, const Peak& b) { return a.magnitude > b.magnitude; });
+        auto band_begin = scratch.band_peaks.begin() + scratch.band_offsets[i];
+        auto band_end = scratch.band_peaks.begin() + scratch.band_offsets[i + 1];
         
         // 选择顶部峰值
-        int peaks_to_select = std::min(band_quotas[i], static_cast<int>(band_peaks[i].size()));
+        size_t peaks_to_select = std::min(static_cast<size_t>(scratch.band_quotas[i]), band_peak_count);
+        if (peaks_to_select < band_peak_count) {
+            std::nth_element(band_begin, band_begin + peaks_to_select, band_end, stronger);
+        }
 
 #ifdef ENABLED_DIAGNOSE
+        const auto& bands = band_manager_->getBands();
         std::cout << "[DIAGNOSE-峰值过滤] 频段" << i << " [" << bands[i].min_freq 
                   << "-" << bands[i].max_freq << "Hz]: 选择" << peaks_to_select 
-                  << "/" << band_peaks[i].size() << "个峰值, 详情:[";
-        for (size_t j = 0; j < band_peaks[i].size(); ++j) {
-            const auto& peak = band_peaks[i][j];
+                  << "/" << band_peak_count << "个峰值, 详情:[";
+        for (size_t j = 0; j < band_peak_count; ++j) {
+            const auto& peak = band_begin[j];
             std::cout << (j < peaks_to_select ? "✅" : "❌") << peak.frequency << "Hz@" << peak.timestamp << "s(" 
                       << peak.magnitude << ") ";
         }
         std::cout << "]" << std::endl;
 #endif
 
-        for (int j = 0; j < peaks_to_select; ++j) {
-            filtered_peaks.push_back(band_peaks[i][j]);
-        }
+        filtered_peaks.insert(filtered_peaks.end(), band_begin, band_begin + peaks_to_select);
     }
     
-    // 按时间戳排序
+    // 按时间戳排序，同一时间的峰值按频率排列
     std::sort(filtered_peaks.begin(), filtered_peaks.end(),
-              [](const Peak& a, const Peak& b) { return a.timestamp < b.timestamp; });
+              [](const Peak& a, const Peak& b) {
+                  if (a.timestamp != b.timestamp) return a.timestamp < b.timestamp;
+                  return a.frequency < b.frequency;
+              });
 
 #ifdef ENABLED_DIAGNOSE
-    std::cout << "[DIAGNOSE-峰值过滤] 过滤完成: 原始" << peaks.size() 
+    std::cout << "[DIAGNOSE-峰值过滤] 过滤完成: 原始" << scratch.band_peaks.size() 
               << "个峰值 -> 保留" << filtered_peaks.size() << "个峰值" << std::endl;
 #endif
-    
-    return filtered_peaks;
 }
 
 void PeakDetectionPhase::flush() {
+    PhaseTimer timer(ctx_->counters, ctx_->trace, PipelinePhase::PeakDetection);
+
     // 用于在音频数据全部输入结束后，刷新本阶段的缓存数据到下一个阶段
     // 当前fft_results_cache_存储的fft_results_除去前后安全距离2 * peak_config_.timeMaxRange，中间时长大于peek_detection_duration_ * 0.8时，则认为是有价值的缓存，进行峰值检测处理
 
@@ -671,7 +779,8 @@ void PeakDetectionPhase::flush() {
     bool has_peaks = false;
     size_t total_peaks = 0;
 
-    for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
+    // 各通道的检测互不依赖，可按通道并行处理
+    ctx_->forEachChannel([&](size_t channel_i) {
         auto* fftr_ring_buffer = fft_results_cache_[channel_i].get();
         
         if (fftr_ring_buffer->size() < 2 * peak_config_.timeMaxRange + 1) {
@@ -679,7 +788,7 @@ void PeakDetectionPhase::flush() {
             std::cout << "[DIAGNOSE-峰值检测flush] 通道" << channel_i << "缓存数据不足，跳过: " 
                       << fftr_ring_buffer->size() << " < " << (2 * peak_config_.timeMaxRange + 1) << std::endl;
 #endif
-            continue;
+            return;
         }
 
         // 计算除去前后安全距离后的有效数据时长
@@ -690,11 +799,11 @@ void PeakDetectionPhase::flush() {
 #ifdef ENABLED_DIAGNOSE
             std::cout << "[DIAGNOSE-峰值检测flush] 通道" << channel_i << "有效检测区域为空，跳过" << std::endl;
 #endif
-            continue;
+            return;
         }
 
-        const double effective_start_time = (*fftr_ring_buffer)[start_idx].timestamp;
-        const double effective_end_time = (*fftr_ring_buffer)[end_idx - 1].timestamp;
+        const double effective_start_time = fftr_ring_buffer->timestamp(start_idx);
+        const double effective_end_time = fftr_ring_buffer->timestamp(end_idx - 1);
         const double effective_duration = effective_end_time - effective_start_time;
         const double min_required_duration = peek_detection_duration_ * 0.8;
 
@@ -711,28 +820,27 @@ void PeakDetectionPhase::flush() {
 #ifdef ENABLED_DIAGNOSE
             std::cout << "[DIAGNOSE-峰值检测flush] 通道" << channel_i << "有效时长不足，跳过处理" << std::endl;
 #endif
-            continue;
+            return;
         }
 
 #ifdef ENABLED_DIAGNOSE
         std::cout << "[DIAGNOSE-峰值检测flush] 通道" << channel_i << "满足处理条件，开始峰值检测" << std::endl;
 #endif
 
-        // 获取所有缓存数据进行峰值检测
-        std::vector<FFTResult> current_results = fftr_ring_buffer->getRange(0, fftr_ring_buffer->size());
-        
-        // 进行峰值检测
-        detectPeaksInWindow(current_results, start_idx, end_idx, channel_i);
-        
-        total_peaks += detected_peaks_[channel_i].size();
-        if (detected_peaks_[channel_i].size() > 0) {
-            has_peaks = true;
-        }
+        // 在全部缓存数据上进行峰值检测
+        detectPeaksInWindow(fftr_ring_buffer->view(), start_idx, end_idx, channel_i);
 
 #ifdef ENABLED_DIAGNOSE
         std::cout << "[DIAGNOSE-峰值检测flush] 通道" << channel_i << "检测完成，峰值数: " 
                   << detected_peaks_[channel_i].size() << std::endl;
 #endif
+    });
+
+    for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
+        total_peaks += detected_peaks_[channel_i].size();
+        if (detected_peaks_[channel_i].size() > 0) {
+            has_peaks = true;
+        }
     }
 
 #ifdef ENABLED_DIAGNOSE
@@ -742,6 +850,7 @@ void PeakDetectionPhase::flush() {
 
     // 如果检测到峰值，则通知长帧构建阶段处理峰值
     if (has_peaks) {
+        ctx_->counters.addOut(PipelinePhase::PeakDetection, total_peaks);
         longFrameBuildingPhase_->handlePeaks(detected_peaks_);
 
         // 清空峰值缓存
@@ -767,4 +876,28 @@ void PeakDetectionPhase::flush() {
     longFrameBuildingPhase_->flush();
 }
 
-} // namespace afp
\ No newline at end of file
+void PeakDetectionPhase::saveState(StateWriter& writer) const {
+    for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
+        fft_results_cache_[channel_i]->saveState(writer);
+        const auto& detection_state = detection_states_[channel_i];
+        writer.writeBool(detection_state.window_initialized);
+        writer.writeDouble(detection_state.current_window_start_time);
+        writer.writeDouble(detection_state.current_window_end_time);
+        writer.writeDouble(detection_state.first_beyond_window_timestamp);
+        writer.writeVarint(detection_state.elements_beyond_window);
+    }
+}
+
+void PeakDetectionPhase::restoreState(StateReader& reader) {
+    for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
+        fft_results_cache_[channel_i]->restoreState(reader);
+        auto& detection_state = detection_states_[channel_i];
+        detection_state.window_initialized = reader.readBool();
+        detection_state.current_window_start_time = reader.readDouble();
+        detection_state.current_window_end_time = reader.readDouble();
+        detection_state.first_beyond_window_timestamp = reader.readDouble();
+        detection_state.elements_beyond_window = reader.readCount(peak_config_.timeMaxRange);
+    }
+}
+
+} // namespace afp
@@ -4,10 +4,10 @@
 #include "signature_generation_pipeline/peak_detection/frequency_band_manager.h"
 #include "signature_generation_pipeline/peak_detection/peak_extractor.h"
 #include "signature_generation_pipeline/phase/long_frame_building_phase.h"
+#include "signature_generation_pipeline/phase/short_frame_consumer.h"
 #include "base/channel_array.h"
-#include "base/fft_result.h"
+#include "base/spectrogram_ring.h"
 #include "base/peek.h"
-#include "base/ring_buffer.h"
 
 namespace afp {
 
@@ -27,44 +27,73 @@ struct PeakDetectionState {
     }
 };
 
-class PeakDetectionPhase {
+// 峰值配额分配和过滤用的缓冲，每个通道一份，在多次检测之间复用，容量稳定后检测窗口内不再分配内存
+struct PeakQuotaScratch {
+    std::vector<float> band_energies;       // 各频段的平均能量
+    std::vector<size_t> band_offsets;       // 各频段的峰值在band_peaks中的范围[band_offsets[i], band_offsets[i+1])
+    std::vector<size_t> band_cursors;       // 分组时各频段的写入位置
+    std::vector<Peak> band_peaks;           // 按频段分组的原始峰值，频段内保持原始顺序
+    std::vector<int> band_quotas;           // 各频段的配额
+    std::vector<int> insufficient_bands;    // 峰值数量少于配额的频段（包括空频段）
+    std::vector<int> need_more_bands;       // 峰值数量超过配额的频段，按权重降序
+    std::vector<Peak> filtered_peaks;       // 过滤后保留的峰值，按时间戳排序
+
+    size_t bandPeakCount(size_t band) const { return band_offsets[band + 1] - band_offsets[band]; }
+};
+
+class PeakDetectionPhase : public IShortFrameConsumer {
 
 public:
     PeakDetectionPhase(SignatureGenerationPipelineCtx* ctx);
 
-    ~PeakDetectionPhase();
+    ~PeakDetectionPhase() override;
 
     void attach(LongFrameBuildingPhase* longFrameBuildingPhase);
 
 
-    void handleShortFrames(ChannelArray<std::vector<FFTResult>>& fft_results);
+    // 处理FFT阶段本批生成的短帧，短帧逐帧复制进本阶段的频谱缓存
+    void handleShortFrames(const ChannelArray<SpectrogramView>& short_frames) override;
+
+    void flush() override;
+
+    // 指定第一个检测窗口的起始时间，默认以第一个短帧的时间戳为起点
+    void setWindowOrigin(double window_start_time);
+
+    // 短帧缓存、峰值提取器、峰值和配额缓冲占用的内存（字节）
+    size_t memoryUsage() const;
 
-    void flush();
+    // 保存/恢复各通道的短帧缓存和检测窗口；检测到的峰值在每批结束时已交给长帧构建阶段，不保存
+    void saveState(StateWriter& writer) const;
+    void restoreState(StateReader& reader);
 
 private:
-    void extractPeaks(std::vector<FFTResult>& fft_results, size_t channel_i);
-    
+    // 处理单个通道本批的短帧，只访问该通道的状态，可在工作线程上执行；返回本批是否执行了峰值检测
+    bool handleChannelShortFrames(size_t channel_i, const SpectrogramView& fftr);
+
     // 在指定窗口内检测峰值
     void detectPeaksInWindow(
-        const std::vector<FFTResult>& fft_results,
+        const SpectrogramView& spectrogram,
         int start_idx, int end_idx,
         size_t channel_i);
     
     // 计算动态峰值配额
     int calculateDynamicPeakQuota(
-        const std::vector<FFTResult>& fft_results,
+        const SpectrogramView& spectrogram,
         int start_idx, int end_idx,
         size_t channel_i);
     
-    // 按频段分配峰值配额
-    std::vector<int> allocatePeakQuotas(
+    // 把峰值按频段分组到scratch.band_peaks，不属于任何频段的峰值丢弃
+    void groupPeaksByBand(
         const std::vector<Peak>& peaks,
-        int total_quota);
+        PeakQuotaScratch& scratch);
+
+    // 按频段分配峰值配额，结果写入scratch.band_quotas；需要先调用groupPeaksByBand
+    void allocatePeakQuotas(
+        int total_quota,
+        PeakQuotaScratch& scratch);
     
-    // 过滤峰值到指定配额
-    std::vector<Peak> filterPeaksToQuota(
-        const std::vector<Peak>& peaks,
-        const std::vector<int>& band_quotas);
+    // 按scratch.band_quotas在每个频段内保留幅度最大的峰值，结果写入scratch.filtered_peaks
+    void filterPeaksToQuota(PeakQuotaScratch& scratch);
 
 private:
     SignatureGenerationPipelineCtx* ctx_;
@@ -73,18 +102,28 @@ private:
     
     double peek_detection_duration_;
 
-    // 每个通道的FFT结果缓存（使用ring buffer）
-    ChannelArray<RingBufferPtr<FFTResult>> fft_results_cache_;
+    // 每个通道的短帧缓存（预分配的频谱环形缓冲，检测时直接在其上取视图）
+    ChannelArray<std::unique_ptr<SpectrogramRing>> fft_results_cache_;
     
+    // 每个通道峰值提取器输出的原始峰值，在多次检测之间复用
+    ChannelArray<std::vector<Peak>> raw_peaks_;
+
     // 检测到的峰值结果
     ChannelArray<std::vector<Peak>> detected_peaks_;
     
     // 峰值检测状态跟踪
     ChannelArray<PeakDetectionState> detection_states_;
     
+    // 每个通道的配额分配缓冲
+    ChannelArray<PeakQuotaScratch> quota_scratches_;
+    
     // 工具类
     std::unique_ptr<FrequencyBandManager> band_manager_;
-    std::unique_ptr<PeakExtractor> peak_extractor_;
+    std::vector<int> bin_bands_;            // 每个频率bin所属的频段，不属于任何频段时为-1
+    std::vector<float> band_weights_;
+    float total_weight_;
+    std::vector<int> bands_by_weight_;      // 按权重降序排列的频段，权重相同时序号小的在前
+    ChannelArray<std::unique_ptr<PeakExtractor>> peak_extractors_;
 };
 
 } // namespace afp
\ No newline at end of file
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "base/channel_array.h"
+#include "base/spectrogram_ring.h"
+
+namespace afp {
+
+// FFT阶段输出的短帧（幅度谱）的接收方
+// 同步模式下由峰值检测阶段直接接收，线程模式下由ShortFrameHandoff接收后转交给后台线程
+class IShortFrameConsumer {
+public:
+    virtual ~IShortFrameConsumer() = default;
+
+    // 处理FFT阶段本批生成的短帧，视图只在调用期间有效
+    virtual void handleShortFrames(const ChannelArray<SpectrogramView>& short_frames) = 0;
+
+    // 输入结束，刷新之后各阶段缓存的数据
+    virtual void flush() = 0;
+};
+
+} // namespace afp
@@ -0,0 +1,171 @@
+#include "short_frame_handoff.h"
+#include "base/memory_accounting.h"
+
+namespace afp {
+
+namespace {
+
+// 同时在途的帧块数，决定调用线程最多领先后台线程几批
+constexpr size_t kBlockCount = 4;
+// 尚未交付的指纹点批数上限，满了之后后台线程等待调用线程交付
+constexpr size_t kSignaturePointsCapacity = 64;
+
+} // namespace
+
+ShortFrameHandoff::ShortFrameHandoff(SignatureGenerationPipelineCtx* ctx)
+    : ctx_(ctx)
+    , on_signature_points_generated_(std::move(ctx->on_signature_points_generated))
+    , blocks_(kBlockCount)
+    , filled_blocks_(kBlockCount)
+    , free_blocks_(kBlockCount)
+    , signature_points_(kSignaturePointsCapacity)
+{
+    for (size_t block_i = 0; block_i < blocks_.size(); ++block_i) {
+        for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
+            blocks_[block_i].frames[channel_i] = std::make_unique<SpectrogramRing>(
+                ctx_->fft_size / ctx_->hop_size + 1, ctx_->fft_size / 2);
+        }
+        size_t free_block = block_i;
+        free_blocks_.tryPush(std::move(free_block));
+    }
+
+    ctx_->on_signature_points_generated = [this](const std::vector<SignaturePoint>& signature_points) {
+        publishSignaturePoints(signature_points);
+    };
+}
+
+ShortFrameHandoff::~ShortFrameHandoff() {
+    stopping_.store(true, std::memory_order_release);
+    worker_signal_.notify();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+}
+
+size_t ShortFrameHandoff::memoryUsage() const {
+    size_t bytes = heapBytes(blocks_) + filled_blocks_.memoryUsage() + free_blocks_.memoryUsage() +
+                   signature_points_.memoryUsage();
+    for (const auto& block : blocks_) {
+        for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
+            bytes += block.frames[channel_i]->memoryUsage();
+        }
+    }
+    return bytes;
+}
+
+void ShortFrameHandoff::attach(PeakDetectionPhase* peakDetectionPhase) {
+    peakDetectionPhase_ = peakDetectionPhase;
+    worker_ = std::thread(&ShortFrameHandoff::run, this);
+}
+
+void ShortFrameHandoff::handleShortFrames(const ChannelArray<SpectrogramView>& short_frames) {
+    PhaseTimer timer(ctx_->counters, ctx_->trace, PipelinePhase::Handoff);
+    const size_t block_i = acquireBlock();
+    auto& block = blocks_[block_i];
+    block.kind = BlockKind::ShortFrames;
+    for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
+        const auto& view = short_frames[channel_i];
+        auto* frames = block.frames[channel_i].get();
+        frames->reserve(view.size());
+        frames->reset();
+        for (size_t i = 0; i < view.size(); ++i) {
+            frames->pushBack(view, i);
+        }
+    }
+    submitBlock(block_i);
+}
+
+void ShortFrameHandoff::flush() {
+    PhaseTimer timer(ctx_->counters, ctx_->trace, PipelinePhase::Handoff);
+    submitAndWait(BlockKind::Flush);
+}
+
+void ShortFrameHandoff::drain() {
+    PhaseTimer timer(ctx_->counters, ctx_->trace, PipelinePhase::Handoff);
+    submitAndWait(BlockKind::Drain);
+}
+
+void ShortFrameHandoff::submitAndWait(BlockKind kind) {
+    const size_t block_i = acquireBlock();
+    blocks_[block_i].kind = kind;
+    submitBlock(block_i);
+    ++flush_requested_;
+
+    auto completed = [this] {
+        return flush_completed_.load(std::memory_order_acquire) >= flush_requested_;
+    };
+    while (!completed()) {
+        deliverSignaturePoints();
+        caller_signal_.wait([&] { return completed() || !signature_points_.empty(); });
+    }
+    deliverSignaturePoints();
+}
+
+void ShortFrameHandoff::deliverSignaturePoints() {
+    std::vector<SignaturePoint> signature_points;
+    while (signature_points_.tryPop(signature_points)) {
+        PhaseTimer timer(ctx_->counters, ctx_->trace, PipelinePhase::Delivery);
+        worker_signal_.notify();
+        on_signature_points_generated_(signature_points);
+    }
+}
+
+size_t ShortFrameHandoff::acquireBlock() {
+    size_t block_i = 0;
+    while (!free_blocks_.tryPop(block_i)) {
+        deliverSignaturePoints();
+        caller_signal_.wait([this] { return !free_blocks_.empty() || !signature_points_.empty(); });
+    }
+    return block_i;
+}
+
+void ShortFrameHandoff::submitBlock(size_t block_i) {
+    // 队列容量与帧块数相同，取到空闲帧块时一定能入队
+    filled_blocks_.tryPush(std::move(block_i));
+    worker_signal_.notify();
+}
+
+void ShortFrameHandoff::run() {
+    ChannelArray<SpectrogramView> short_frames;
+    size_t block_i = 0;
+    auto stopping = [this] { return stopping_.load(std::memory_order_acquire); };
+    while (!stopping()) {
+        if (!filled_blocks_.tryPop(block_i)) {
+            worker_signal_.wait([&] { return stopping() || !filled_blocks_.empty(); });
+            continue;
+        }
+
+        auto& block = blocks_[block_i];
+        if (block.kind == BlockKind::Flush) {
+            peakDetectionPhase_->flush();
+            flush_completed_.fetch_add(1, std::memory_order_release);
+        } else if (block.kind == BlockKind::Drain) {
+            flush_completed_.fetch_add(1, std::memory_order_release);
+        } else {
+            for (size_t channel_i = 0; channel_i < ctx_->channel_count; ++channel_i) {
+                short_frames[channel_i] = block.frames[channel_i]->view();
+            }
+            peakDetectionPhase_->handleShortFrames(short_frames);
+        }
+
+        free_blocks_.tryPush(std::move(block_i));
+        caller_signal_.notify();
+    }
+}
+
+void ShortFrameHandoff::publishSignaturePoints(const std::vector<SignaturePoint>& signature_points) {
+    std::vector<SignaturePoint> copy = signature_points;
+    auto stopping = [this] { return stopping_.load(std::memory_order_acquire); };
+    while (!signature_points_.tryPush(std::move(copy))) {
+        // 析构时调用线程不再交付，直接丢弃
+        if (stopping()) {
+            return;
+        }
+        worker_signal_.wait([&] {
+            return stopping() || signature_points_.size() < signature_points_.capacity();
+        });
+    }
+    caller_signal_.notify();
+}
+
+} // namespace afp
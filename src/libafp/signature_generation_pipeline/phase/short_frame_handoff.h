@@ -0,0 +1,90 @@
+#pragma once
+
+#include "signature_generation_pipeline/signature_generation_pipeline_ctx.h"
+#include "signature_generation_pipeline/phase/short_frame_consumer.h"
+#include "signature_generation_pipeline/phase/peak_detection_phase.h"
+#include "base/spsc_queue.h"
+#include "base/wait_signal.h"
+#include <atomic>
+#include <thread>
+
+namespace afp {
+
+// 线程模式下FFT阶段与峰值检测阶段之间的交接：
+// 调用线程执行到FFT为止，短帧按批复制进预分配的帧块，经单生产者单消费者队列交给后台线程，
+// 后台线程执行峰值检测、长帧构建和hash计算，生成的指纹点经另一个队列回到调用线程，在调用线程上交给回调
+// 帧块用完时调用线程等待后台线程归还（不丢数据），flush等待后台线程处理完全部数据，
+// 因此每批短帧的处理顺序和分批方式都与同步模式相同，输出的指纹点完全一致
+class ShortFrameHandoff : public IShortFrameConsumer {
+public:
+    // 接管ctx的指纹点回调：后台线程生成的指纹点先入队，由deliverSignaturePoints在调用线程上交给原回调
+    explicit ShortFrameHandoff(SignatureGenerationPipelineCtx* ctx);
+
+    // 停止并等待后台线程；尚未flush的数据直接丢弃，不再交给回调
+    ~ShortFrameHandoff() override;
+
+    ShortFrameHandoff(const ShortFrameHandoff&) = delete;
+    ShortFrameHandoff& operator=(const ShortFrameHandoff&) = delete;
+
+    // 连接峰值检测阶段并启动后台线程
+    void attach(PeakDetectionPhase* peakDetectionPhase);
+
+    void handleShortFrames(const ChannelArray<SpectrogramView>& short_frames) override;
+
+    // 等待后台线程处理完之前的所有短帧并完成flush，返回前交付全部指纹点
+    void flush() override;
+
+    // 等待后台线程处理完之前的所有短帧（不flush），返回前交付全部指纹点，之后可以在调用线程上读取后续阶段的状态
+    void drain();
+
+    // 把后台线程已经生成的指纹点依次交给回调，只在调用线程上调用
+    void deliverSignaturePoints();
+
+    // 帧块和队列占用的内存（字节），后台线程空闲（flush之后）时读取
+    size_t memoryUsage() const;
+
+private:
+    enum class BlockKind {
+        ShortFrames,
+        Flush,
+        Drain,      // 不携带数据，后台线程处理到它时说明之前的短帧都已处理完
+    };
+
+    // 一批短帧，帧块在构造时分配，容量随批大小增长，之后循环复用
+    struct FrameBlock {
+        BlockKind kind = BlockKind::ShortFrames;
+        ChannelArray<std::unique_ptr<SpectrogramRing>> frames;
+    };
+
+    // 调用线程：取一个空闲帧块，没有时等待后台线程归还，等待期间交付指纹点避免后台线程阻塞在输出上
+    size_t acquireBlock();
+    void submitBlock(size_t block_i);
+
+    // 调用线程：提交一个不携带数据的帧块并等待后台线程处理完它，期间交付指纹点
+    void submitAndWait(BlockKind kind);
+
+    // 后台线程
+    void run();
+    void publishSignaturePoints(const std::vector<SignaturePoint>& signature_points);
+
+private:
+    SignatureGenerationPipelineCtx* ctx_;
+    PeakDetectionPhase* peakDetectionPhase_ = nullptr;
+    SignaturePointsGeneratedCallback on_signature_points_generated_;
+
+    std::vector<FrameBlock> blocks_;
+    SpscQueue<size_t> filled_blocks_;   // 调用线程 -> 后台线程
+    SpscQueue<size_t> free_blocks_;     // 后台线程 -> 调用线程
+    SpscQueue<std::vector<SignaturePoint>> signature_points_;  // 后台线程 -> 调用线程
+
+    // 队列本身不阻塞，等待方阻塞在对应的信号上，另一端改变队列或计数后通知
+    WaitSignal caller_signal_;  // 后台线程归还帧块、完成flush/drain或产出指纹点时通知调用线程
+    WaitSignal worker_signal_;  // 调用线程提交帧块、交付指纹点腾出队列空间或析构时通知后台线程
+
+    size_t flush_requested_ = 0;                // 调用线程已提交的flush/drain次数
+    std::atomic<size_t> flush_completed_{0};    // 后台线程已完成的flush/drain次数
+    std::atomic<bool> stopping_{false};
+    std::thread worker_;
+};
+
+} // namespace afp
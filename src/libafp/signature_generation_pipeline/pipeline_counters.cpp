@@ -0,0 +1,84 @@
+#include "signature_generation_pipeline/pipeline_counters.h"
+
+namespace afp {
+
+namespace {
+
+// 各区段在追踪中的事件，与PipelinePhase的顺序相同
+const TraceEventDesc kPhaseTraceEvents[PipelineCounters::kPhaseCount] = {
+    {"ChannelSplit", "pipeline", nullptr, nullptr, nullptr},
+    {"Emphasis", "pipeline", nullptr, nullptr, nullptr},
+    {"Decimation", "pipeline", nullptr, nullptr, nullptr},
+    {"Fft", "pipeline", nullptr, nullptr, nullptr},
+    {"PeakDetection", "pipeline", nullptr, nullptr, nullptr},
+    {"LongFrameBuilding", "pipeline", nullptr, nullptr, nullptr},
+    {"HashComputation", "pipeline", nullptr, nullptr, nullptr},
+    {"Handoff", "pipeline", nullptr, nullptr, nullptr},
+    {"Delivery", "pipeline", nullptr, nullptr, nullptr},
+};
+
+uint64_t nanosecondsOf(std::chrono::steady_clock::time_point time) {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count());
+}
+
+} // namespace
+
+GeneratorPerformanceStats PipelineCounters::snapshot(uint32_t input_sample_rate, size_t degradation_level) const {
+    auto load = [](const std::atomic<uint64_t>& counter) {
+        return counter.load(std::memory_order_relaxed);
+    };
+    auto phaseStats = [&](PipelinePhase phase) {
+        const auto i = static_cast<size_t>(phase);
+        return PipelinePhaseStats{load(phase_ns[i]), load(items_in[i]), load(items_out[i])};
+    };
+
+    GeneratorPerformanceStats stats;
+    stats.channelSplit = phaseStats(PipelinePhase::ChannelSplit);
+    stats.emphasis = phaseStats(PipelinePhase::Emphasis);
+    stats.decimation = phaseStats(PipelinePhase::Decimation);
+    stats.fft = phaseStats(PipelinePhase::Fft);
+    stats.peakDetection = phaseStats(PipelinePhase::PeakDetection);
+    stats.longFrameBuilding = phaseStats(PipelinePhase::LongFrameBuilding);
+    stats.hashComputation = phaseStats(PipelinePhase::HashComputation);
+    stats.silentWindowCount = load(silent_windows);
+    stats.handoffNanoseconds = load(phase_ns[static_cast<size_t>(PipelinePhase::Handoff)]);
+    stats.deliveryNanoseconds = load(phase_ns[static_cast<size_t>(PipelinePhase::Delivery)]);
+    stats.audioSeconds = static_cast<double>(load(input_sample_frames)) / input_sample_rate;
+    stats.processingSeconds = static_cast<double>(load(caller_ns)) * 1e-9;
+    stats.realtimeFactor = stats.audioSeconds > 0.0 ? stats.processingSeconds / stats.audioSeconds : 0.0;
+    stats.degradationLevel = degradation_level;
+    return stats;
+}
+
+thread_local PhaseTimer* PhaseTimer::current_ = nullptr;
+
+PhaseTimer::PhaseTimer(PipelineCounters& counters, TraceRing& trace, PipelinePhase phase)
+    : counter_(counters.phase_ns[static_cast<size_t>(phase)])
+    , trace_(trace)
+    , trace_event_(kPhaseTraceEvents[static_cast<size_t>(phase)])
+    , parent_(current_)
+    , start_(Clock::now()) {
+    if (parent_) {
+        parent_->accumulate(start_);
+    }
+    current_ = this;
+    trace_.record(trace_event_, TraceRing::kBegin, nanosecondsOf(start_));
+}
+
+PhaseTimer::~PhaseTimer() {
+    const auto now = Clock::now();
+    trace_.record(trace_event_, TraceRing::kEnd, nanosecondsOf(now));
+    accumulate(now);
+    current_ = parent_;
+    if (parent_) {
+        parent_->start_ = now;
+    }
+}
+
+void PhaseTimer::accumulate(Clock::time_point now) {
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now - start_).count();
+    PipelineCounters::add(counter_, static_cast<uint64_t>(elapsed));
+}
+
+} // namespace afp
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include "afp/isignature_generator.h"
+#include "base/trace_ring.h"
+
+namespace afp {
+
+// 单独计时的区段：各阶段，以及线程模式下的短帧交接和指纹点输出（不计入调用它们的阶段）
+enum class PipelinePhase : size_t {
+    ChannelSplit = 0,
+    Emphasis,
+    Decimation,
+    Fft,
+    PeakDetection,
+    LongFrameBuilding,
+    HashComputation,
+    Handoff,
+    Delivery,
+    Count,
+};
+
+// 流水线的累计计数，各阶段在所在的线程上以relaxed原子操作累加，snapshot可在任意线程上读取
+struct PipelineCounters {
+    static constexpr size_t kPhaseCount = static_cast<size_t>(PipelinePhase::Count);
+
+    std::array<std::atomic<uint64_t>, kPhaseCount> phase_ns{};
+    std::array<std::atomic<uint64_t>, kPhaseCount> items_in{};
+    std::array<std::atomic<uint64_t>, kPhaseCount> items_out{};
+    std::atomic<uint64_t> silent_windows{0};
+    std::atomic<uint64_t> caller_ns{0};             // appendStreamBuffer和flush在调用线程上的总耗时
+    std::atomic<uint64_t> input_sample_frames{0};   // 输入的采样帧数（输入采样率下）
+
+    static void add(std::atomic<uint64_t>& counter, uint64_t value) {
+        counter.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    void addIn(PipelinePhase phase, uint64_t count) { add(items_in[static_cast<size_t>(phase)], count); }
+    void addOut(PipelinePhase phase, uint64_t count) { add(items_out[static_cast<size_t>(phase)], count); }
+
+    GeneratorPerformanceStats snapshot(uint32_t input_sample_rate, size_t degradation_level) const;
+};
+
+// 区段计时器，只累计本区段自身的耗时：阶段之间是同步调用链，下游的计时器构造时暂停上游的计时，析构时恢复
+// 嵌套关系用线程局部的指针记录，各线程（调用线程、后台线程）互不影响；每次进出只读两次时钟
+// 追踪开启时，进出时刻同时作为该区段的开始/结束事件写入trace
+class PhaseTimer {
+public:
+    PhaseTimer(PipelineCounters& counters, TraceRing& trace, PipelinePhase phase);
+    ~PhaseTimer();
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void accumulate(Clock::time_point now);
+
+    std::atomic<uint64_t>& counter_;
+    TraceRing& trace_;
+    const TraceEventDesc& trace_event_;
+    PhaseTimer* parent_;
+    Clock::time_point start_;
+
+    static thread_local PhaseTimer* current_;
+};
+
+} // namespace afp
@@ -0,0 +1,60 @@
+#include "signature_generation_pipeline/realtime_load_controller.h"
+#include <iostream>
+
+namespace afp {
+
+RealtimeLoadController::RealtimeLoadController(SignatureGenerationPipelineCtx* ctx)
+    : ctx_(ctx)
+    , target_realtime_factor_(ctx->config->getSignatureGenerationConfig().targetRealtimeFactor) {
+}
+
+void RealtimeLoadController::setCallback(ISignatureGenerator::DegradationCallback callback) {
+    callback_ = std::move(callback);
+}
+
+void RealtimeLoadController::record(double processing_seconds, double audio_seconds) {
+    if (!enabled()) {
+        return;
+    }
+
+    processing_seconds_ += processing_seconds;
+    audio_seconds_ += audio_seconds;
+    if (audio_seconds_ < kEvaluationPeriod) {
+        return;
+    }
+
+    const double realtime_factor = processing_seconds_ / audio_seconds_;
+    processing_seconds_ = 0.0;
+    audio_seconds_ = 0.0;
+
+    const size_t level = ctx_->degradationLevel();
+    if (realtime_factor > target_realtime_factor_ && level < SignatureGenerationPipelineCtx::kMaxDegradationLevel) {
+        setLevel(level + 1, realtime_factor);
+    } else if (realtime_factor < target_realtime_factor_ * kRecoveryRatio && level > 0) {
+        setLevel(level - 1, realtime_factor);
+    }
+}
+
+void RealtimeLoadController::setLevel(size_t level, double realtime_factor) {
+    ctx_->degradation_level.store(level, std::memory_order_relaxed);
+
+    DegradationStats stats;
+    stats.realtimeFactor = realtime_factor;
+    stats.level = level;
+    stats.maxPeaksPerFrame = ctx_->maxPeaksPerFrame();
+    stats.maxTripleFrameCombinations = ctx_->maxTripleFrameCombinations();
+    stats.symmetricFrameRange = ctx_->symmetricFrameRange();
+
+#ifdef ENABLED_DIAGNOSE
+    std::cout << "[DIAGNOSE-自适应降级] 实时率=" << realtime_factor << ", 目标=" << target_realtime_factor_
+              << ", 降级级别调整为" << level << ": 每帧最多峰值数=" << stats.maxPeaksPerFrame
+              << ", 最多三帧组合数=" << stats.maxTripleFrameCombinations
+              << ", 对称帧范围=" << stats.symmetricFrameRange << std::endl;
+#endif
+
+    if (callback_) {
+        callback_(stats);
+    }
+}
+
+} // namespace afp
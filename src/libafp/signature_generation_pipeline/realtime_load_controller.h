@@ -0,0 +1,41 @@
+#pragma once
+
+#include "signature_generation_pipeline/signature_generation_pipeline_ctx.h"
+#include "afp/isignature_generator.h"
+
+namespace afp {
+
+// 自适应降级的反馈控制：统计每个评估周期内的处理时间与音频时长之比（实时率），
+// 超过目标时把ctx的降级级别升一级，低于目标的一半时降一级，两个阈值之间保持不变以免来回切换
+// 级别变化通过回调报告；目标为0时不做任何统计
+class RealtimeLoadController {
+public:
+    explicit RealtimeLoadController(SignatureGenerationPipelineCtx* ctx);
+
+    void setCallback(ISignatureGenerator::DegradationCallback callback);
+
+    // 记录一次输入的处理耗时和音频时长（秒），满一个评估周期时调整降级级别
+    void record(double processing_seconds, double audio_seconds);
+
+    bool enabled() const { return target_realtime_factor_ > 0.0; }
+
+    // 离线处理时关闭，始终按配置全量处理
+    void disable() { target_realtime_factor_ = 0.0; }
+
+private:
+    // 每个评估周期对应的音频时长（秒）
+    static constexpr double kEvaluationPeriod = 1.0;
+    // 实时率低于目标的这个比例时才恢复
+    static constexpr double kRecoveryRatio = 0.5;
+
+    void setLevel(size_t level, double realtime_factor);
+
+    SignatureGenerationPipelineCtx* ctx_;
+    double target_realtime_factor_;
+    ISignatureGenerator::DegradationCallback callback_;
+
+    double processing_seconds_ = 0.0;   // 本评估周期的累计处理耗时
+    double audio_seconds_ = 0.0;        // 本评估周期的累计音频时长
+};
+
+} // namespace afp
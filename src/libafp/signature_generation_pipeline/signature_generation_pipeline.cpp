@@ -1,34 +1,157 @@
 #include "signature_generation_pipeline/signature_generation_pipeline.h"
+#include <chrono>
+#include "base/memory_accounting.h"
 
 namespace afp {
 
-SignatureGenerationPipeline::SignatureGenerationPipeline(std::shared_ptr<IPerformanceConfig> config, std::shared_ptr<PCMFormat> format, SignaturePointsGeneratedCallback&& on_signature_points_generated)
+SignatureGenerationPipeline::SignatureGenerationPipeline(std::shared_ptr<IPerformanceConfig> config, std::shared_ptr<PCMFormat> format, SignaturePointsGeneratedCallback&& on_signature_points_generated, bool threaded, bool parallel_channels)
     : ctx_(config, format, std::move(on_signature_points_generated))
     , channelSplitPhase_(&ctx_)
     , emphasisPhase_(&ctx_)
+    , decimationPhase_(&ctx_)
     , fftPhase_(&ctx_)
     , peakDetectionPhase_(&ctx_)
     , longFrameBuildingPhase_(&ctx_)
     , hashComputationPhase_(&ctx_)
+    , loadController_(&ctx_)
     {
         // Wire
         channelSplitPhase_.attach(&emphasisPhase_);
-        emphasisPhase_.attach(&fftPhase_);
-        fftPhase_.attach(&peakDetectionPhase_);
+        emphasisPhase_.attach(&decimationPhase_);
+        decimationPhase_.attach(&fftPhase_);
+        if (parallel_channels && ctx_.channel_count > 1) {
+            // 调用线程（线程模式下为后台线程）处理其中一个通道
+            ctx_.channel_task_runner = std::make_unique<ChannelTaskRunner>(ctx_.channel_count - 1);
+        }
+        if (threaded) {
+            shortFrameHandoff_ = std::make_unique<ShortFrameHandoff>(&ctx_);
+            fftPhase_.attach(shortFrameHandoff_.get());
+        } else {
+            fftPhase_.attach(&peakDetectionPhase_);
+        }
         peakDetectionPhase_.attach(&longFrameBuildingPhase_);
         longFrameBuildingPhase_.attach(&hashComputationPhase_);
+        if (shortFrameHandoff_) {
+            shortFrameHandoff_->attach(&peakDetectionPhase_);
+        }
 
     }
 
 
 bool SignatureGenerationPipeline::appendStreamBuffer(const void* buffer, size_t bufferSize, double startTimestamp) {
+    const auto start_time = std::chrono::steady_clock::now();
+
     channelSplitPhase_.handleAudioData(buffer, bufferSize, startTimestamp);
+
+    if (shortFrameHandoff_) {
+        shortFrameHandoff_->deliverSignaturePoints();
+    }
+
+    // 线程模式下后台线程跟不上时，调用线程会在交接处等待，同样体现在耗时里
+    const auto elapsed = std::chrono::steady_clock::now() - start_time;
+    const size_t sample_frames = bufferSize / ctx_.format->frameSize();
+    PipelineCounters::add(ctx_.counters.caller_ns, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    PipelineCounters::add(ctx_.counters.input_sample_frames, sample_frames);
+
+    if (loadController_.enabled()) {
+        const double audio_seconds = static_cast<double>(bufferSize) / ctx_.format->frameSize() / ctx_.format->sampleRate();
+        loadController_.record(std::chrono::duration<double>(elapsed).count(), audio_seconds);
+    }
     
     return true;
 }
 
 void SignatureGenerationPipeline::flush() {
+    const auto start_time = std::chrono::steady_clock::now();
+
     channelSplitPhase_.flush();
+
+    const auto elapsed = std::chrono::steady_clock::now() - start_time;
+    PipelineCounters::add(ctx_.counters.caller_ns, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+GeneratorPerformanceStats SignatureGenerationPipeline::performanceStats() const {
+    return ctx_.counters.snapshot(ctx_.format->sampleRate(), ctx_.degradationLevel());
+}
+
+GeneratorMemoryUsage SignatureGenerationPipeline::memoryUsage() const {
+    GeneratorMemoryUsage usage;
+    usage.inputBufferBytes = ctx_.channel_count * ctx_.channel_buffer_sample_count * sizeof(float) +
+                             heapBytes(ctx_.bin_frequencies) + decimationPhase_.memoryUsage() +
+                             fftPhase_.ringBufferMemoryUsage();
+    usage.fftBytes = fftPhase_.memoryUsage();
+    usage.peakDetectionBytes = peakDetectionPhase_.memoryUsage();
+    usage.longFrameBytes = longFrameBuildingPhase_.memoryUsage();
+    usage.hashBytes = hashComputationPhase_.memoryUsage();
+    usage.handoffBytes = shortFrameHandoff_ ? shortFrameHandoff_->memoryUsage() : 0;
+    usage.traceBytes = ctx_.trace.memoryUsage();
+    return usage;
+}
+
+void SignatureGenerationPipeline::enableTracing(size_t capacity) {
+    if (capacity == 0) {
+        ctx_.trace.disable();
+        return;
+    }
+    ctx_.trace.enable(capacity);
+}
+
+void SignatureGenerationPipeline::setDegradationCallback(ISignatureGenerator::DegradationCallback callback) {
+    loadController_.setCallback(std::move(callback));
+}
+
+void SignatureGenerationPipeline::disableDegradation() {
+    loadController_.disable();
+}
+
+void SignatureGenerationPipeline::setPeakDetectionWindowOrigin(double window_start_time) {
+    peakDetectionPhase_.setWindowOrigin(window_start_time);
+}
+
+void SignatureGenerationPipeline::saveState(StateWriter& writer) {
+    if (shortFrameHandoff_) {
+        shortFrameHandoff_->drain();
+    }
+
+    // 决定各阶段缓冲大小的参数，恢复时逐一校验
+    writer.writeVarint(ctx_.format->sampleRate());
+    writer.writeVarint(ctx_.channel_count);
+    writer.writeVarint(ctx_.channel_buffer_sample_count);
+    writer.writeVarint(ctx_.decimation_factor);
+    writer.writeVarint(ctx_.fft_size);
+    writer.writeVarint(ctx_.hop_size);
+    writer.writeVarint(ctx_.degradationLevel());
+
+    channelSplitPhase_.saveState(writer);
+    emphasisPhase_.saveState(writer);
+    decimationPhase_.saveState(writer);
+    fftPhase_.saveState(writer);
+    peakDetectionPhase_.saveState(writer);
+    longFrameBuildingPhase_.saveState(writer);
+    hashComputationPhase_.saveState(writer);
+}
+
+bool SignatureGenerationPipeline::restoreState(StateReader& reader) {
+    if (reader.readVarint() != ctx_.format->sampleRate() ||
+        reader.readVarint() != ctx_.channel_count ||
+        reader.readVarint() != ctx_.channel_buffer_sample_count ||
+        reader.readVarint() != ctx_.decimation_factor ||
+        reader.readVarint() != ctx_.fft_size ||
+        reader.readVarint() != ctx_.hop_size) {
+        return false;
+    }
+    ctx_.degradation_level.store(reader.readCount(SignatureGenerationPipelineCtx::kMaxDegradationLevel),
+                                 std::memory_order_relaxed);
+
+    // 线程模式下后台线程此时没有待处理的短帧，恢复的状态在它取到下一批短帧时可见
+    channelSplitPhase_.restoreState(reader);
+    emphasisPhase_.restoreState(reader);
+    decimationPhase_.restoreState(reader);
+    fftPhase_.restoreState(reader);
+    peakDetectionPhase_.restoreState(reader);
+    longFrameBuildingPhase_.restoreState(reader);
+    hashComputationPhase_.restoreState(reader);
+    return reader.ok();
 }
 
 void SignatureGenerationPipeline::attachVisualizationConfig(VisualizationConfig* visualization_config) {
@@ -8,11 +8,14 @@
 
 #include "signature_generation_pipeline/phase/channel_split_phase.h"
 #include "signature_generation_pipeline/phase/emphasis_phase.h"
+#include "signature_generation_pipeline/phase/decimation_phase.h"
 #include "signature_generation_pipeline/phase/fft_phase.h"
 #include "signature_generation_pipeline/phase/peak_detection_phase.h"
 #include "signature_generation_pipeline/phase/long_frame_building_phase.h"
 #include "signature_generation_pipeline/phase/hash_computation_phase.h"
+#include "signature_generation_pipeline/phase/short_frame_handoff.h"
 #include "signature_generation_pipeline/signature_generation_pipeline_ctx.h"
+#include "signature_generation_pipeline/realtime_load_controller.h"
 #include <memory>
 
 namespace afp {
@@ -20,7 +23,10 @@ namespace afp {
 class SignatureGenerationPipeline {
 
 public:
-    SignatureGenerationPipeline(std::shared_ptr<IPerformanceConfig> config, std::shared_ptr<PCMFormat> format, SignaturePointsGeneratedCallback&& on_signature_points_generated);
+    // threaded为true时FFT及之前的阶段在调用线程上执行，峰值检测、长帧构建和hash计算在后台线程上执行，
+    // 指纹点仍在调用线程上（appendStreamBuffer和flush期间）交给回调，flush返回时全部交付，输出与同步模式一致
+    // parallel_channels为true时峰值检测、长帧构建和hash计算按通道分发到工作线程，输出与逐通道处理一致
+    SignatureGenerationPipeline(std::shared_ptr<IPerformanceConfig> config, std::shared_ptr<PCMFormat> format, SignaturePointsGeneratedCallback&& on_signature_points_generated, bool threaded = false, bool parallel_channels = false);
 
     SignatureGenerationPipeline(const SignatureGenerationPipeline&) = delete;
     SignatureGenerationPipeline& operator=(const SignatureGenerationPipeline&) = delete;
@@ -33,17 +39,50 @@ public:
 
     void flush();
 
+    // 累计性能统计的快照，可在任意线程上调用
+    GeneratorPerformanceStats performanceStats() const;
+
+    // 各阶段缓冲占用的内存，signatureBytes由生成器填写；线程模式下在flush之后调用
+    GeneratorMemoryUsage memoryUsage() const;
+
+    // 开启或关闭（capacity为0）事件追踪，见ISignatureGenerator::enableTracing
+    void enableTracing(size_t capacity);
+
+    const TraceRing& traceRing() const { return ctx_.trace; }
+
     void attachVisualizationConfig(VisualizationConfig* visualization_config);
 
+    // 设置自适应降级的状态回调，见ISignatureGenerator::setDegradationCallback
+    void setDegradationCallback(ISignatureGenerator::DegradationCallback callback);
+
+    // 关闭自适应降级，用于离线处理，需在输入任何数据前调用
+    void disableDegradation();
+
+    // 指定峰值检测窗口的起点（分段生成时用于与完整流的窗口边界对齐），需在输入任何数据前调用
+    void setPeakDetectionWindowOrigin(double window_start_time);
+
+    // 保存流状态：各阶段的环形缓冲、尚未凑满的样本、峰值检测和长帧窗口、未用完的长帧以及降级级别
+    // 线程模式下先等待后台线程处理完已提交的短帧，期间生成的指纹点照常交给回调
+    void saveState(StateWriter& writer);
+
+    // 恢复saveState保存的流状态，需在输入任何数据前调用；格式或配置不一致、数据不合法时返回false，此时流水线应丢弃
+    bool restoreState(StateReader& reader);
+
 private:
     SignatureGenerationPipelineCtx ctx_;
 
     ChannelSplitPhase channelSplitPhase_;
     EmphasisPhase emphasisPhase_;
+    DecimationPhase decimationPhase_;
     FftPhase fftPhase_;
     PeakDetectionPhase peakDetectionPhase_;
     LongFrameBuildingPhase longFrameBuildingPhase_;
     HashComputationPhase hashComputationPhase_;
+
+    RealtimeLoadController loadController_;
+
+    // 线程模式下FFT阶段与峰值检测阶段之间的交接，放在各阶段之后声明，析构时先停止后台线程
+    std::unique_ptr<ShortFrameHandoff> shortFrameHandoff_;
 };
 
 } // namespace afp
\ No newline at end of file
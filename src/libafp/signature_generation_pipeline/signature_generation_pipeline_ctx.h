@@ -1,13 +1,19 @@
 #pragma once
 
 #include "config/performance_config.h"
+#include <algorithm>
+#include <atomic>
 #include <memory>
 #include <functional>
 #include <vector>
 #include "base/channel_array.h"
+#include "base/channel_task_runner.h"
 #include "afp/isignature_generator.h"
 #include "afp/pcm_format.h"
 #include "base/visualization_config.h"
+#include "base/state_stream.h"
+#include "audio/polyphase_decimator.h"
+#include "signature_generation_pipeline/pipeline_counters.h"
 
 namespace afp {
 
@@ -19,28 +25,123 @@ struct SignatureGenerationPipelineCtx {
 
     ChannelArray<float *> channel_samples;
     size_t channel_buffer_sample_count;  // 每个通道的样本数量
-    size_t fft_size;
+    size_t decimation_factor;            // FFT前的降采样倍数，1表示不降采样
+    size_t fft_size;                     // 分析采样率下的FFT大小
+    size_t hop_size;                     // 分析采样率下的帧移
 
     size_t channel_count;
-    uint32_t sample_rate;
+    uint32_t sample_rate;                // 分析采样率（降采样之后），输入采样率见format
+    std::vector<float> bin_frequencies;  // 每个频率bin对应的频率（Hz），所有短帧共用
+
+    bool low_latency;                    // 低延迟流式模式，见SignatureGenerationConfig::streamingLatencyBudgetMs
+    double peak_detection_duration;      // 峰值检测窗口（秒），低延迟模式下可能比配置的短
+
+    // 自适应降级级别，0表示按配置全量处理，每升一级峰值数、组合数和对称帧范围减半
+    // 由调用线程上的RealtimeLoadController修改，线程模式下后台线程上的阶段同时读取
+    std::atomic<size_t> degradation_level{0};
+    static constexpr size_t kMaxDegradationLevel = 3;
 
     SignaturePointsGeneratedCallback on_signature_points_generated;
 
-    VisualizationConfig* visualization_config;
+    // 各阶段的耗时和吞吐量计数，见ISignatureGenerator::performanceStats
+    PipelineCounters counters;
+
+    // 事件追踪，默认关闭，见ISignatureGenerator::enableTracing
+    TraceRing trace;
+
+    VisualizationConfig* visualization_config = nullptr;
+
+    // 启用通道并行时按通道分发任务，为空时各通道在当前线程上依次处理
+    std::unique_ptr<ChannelTaskRunner> channel_task_runner;
 
     SignatureGenerationPipelineCtx(std::shared_ptr<IPerformanceConfig> a_config, std::shared_ptr<PCMFormat> a_format, SignaturePointsGeneratedCallback&& a_on_signature_points_generated) 
     : config(a_config)
     , format(a_format)
-    , channel_buffer_sample_count(a_config->getFFTConfig().fftSize)  // 每个通道的缓冲区大小是FFT Size
+    , channel_buffer_sample_count(chooseChannelBufferSampleCount(*a_config))
+    , decimation_factor(chooseDecimationFactor(*a_config, a_format->sampleRate()))
+    , fft_size(a_config->getFFTConfig().fftSize / decimation_factor)
+    , hop_size(a_config->getFFTConfig().hopSize / decimation_factor)
     , channel_count(a_format->channels())
-    , sample_rate(a_format->sampleRate())
+    , sample_rate(a_format->sampleRate() / static_cast<uint32_t>(decimation_factor))
     , on_signature_points_generated(std::move(a_on_signature_points_generated))
-    , fft_size(a_config->getFFTConfig().fftSize)
     {
         channel_samples.fill(nullptr);
         for (size_t i = 0; i < channel_count; i++) {
             channel_samples[i] = new float[channel_buffer_sample_count];
         }
+
+        bin_frequencies.resize(fft_size / 2);
+        for (size_t i = 0; i < bin_frequencies.size(); ++i) {
+            bin_frequencies[i] = i * static_cast<float>(sample_rate) / static_cast<float>(fft_size);
+        }
+
+        low_latency = a_config->getSignatureGenerationConfig().streamingLatencyBudgetMs > 0.0;
+        peak_detection_duration = choosePeakDetectionDuration(*a_config, a_format->sampleRate());
+    }
+
+    // 每个通道的缓冲区大小：默认是FFT Size，低延迟模式下按帧移送入下一阶段
+    static size_t chooseChannelBufferSampleCount(const IPerformanceConfig& config) {
+        const auto& fft_config = config.getFFTConfig();
+        if (config.getSignatureGenerationConfig().streamingLatencyBudgetMs > 0.0) {
+            return fft_config.hopSize;
+        }
+        return fft_config.fftSize;
+    }
+
+    // 低延迟模式下，从预算中扣除固定开销后剩余的时间作为峰值检测窗口的上限，但不短于一个长帧
+    // 固定开销：输入按帧移送入的等待、峰值检测前后各timeMaxRange个短帧的保护区、长帧收齐的等待、
+    // 以及距离为1的三帧组合等待下一个长帧
+    static double choosePeakDetectionDuration(const IPerformanceConfig& config, uint32_t input_sample_rate) {
+        const auto& peak_config = config.getPeakDetectionConfig();
+        const auto& signature_config = config.getSignatureGenerationConfig();
+        if (signature_config.streamingLatencyBudgetMs <= 0.0) {
+            return peak_config.peakTimeDuration;
+        }
+
+        const double hop_duration = static_cast<double>(config.getFFTConfig().hopSize) / input_sample_rate;
+        const double fixed_latency = hop_duration * (1 + peak_config.timeMaxRange) + 2 * signature_config.frameDuration;
+        const double available = signature_config.streamingLatencyBudgetMs / 1000.0 - fixed_latency;
+        return std::min(peak_config.peakTimeDuration, std::max(available, signature_config.frameDuration));
+    }
+
+    // 降采样使FFT、幅度谱和峰值检测的工作量按倍数减少，时间和频率分辨率保持不变
+    static size_t chooseDecimationFactor(const IPerformanceConfig& config, uint32_t sample_rate) {
+        const auto& fft_config = config.getFFTConfig();
+        if (!fft_config.enableDecimation) {
+            return 1;
+        }
+        return PolyphaseDecimator::chooseFactor(sample_rate, config.getPeakDetectionConfig().maxFreq,
+                                                fft_config.fftSize, fft_config.hopSize);
+    }
+
+    // 按当前降级级别生效的参数，各阶段在每次使用时读取
+    size_t maxPeaksPerFrame() const {
+        const auto& peak_config = config->getPeakDetectionConfig();
+        return std::max(peak_config.minPeaksPerFrame, peak_config.maxPeaksPerFrameLimit >> degradationLevel());
+    }
+
+    size_t maxTripleFrameCombinations() const {
+        return std::max<size_t>(1, config->getSignatureGenerationConfig().maxTripleFrameCombinations >> degradationLevel());
+    }
+
+    size_t symmetricFrameRange() const {
+        return std::max<size_t>(1, config->getSignatureGenerationConfig().symmetricFrameRange >> degradationLevel());
+    }
+
+    size_t degradationLevel() const { return degradation_level.load(std::memory_order_relaxed); }
+
+    // 对每个通道执行task(channel_i)，task只能访问该通道自己的状态
+    // 收集可视化数据时各阶段会追加到共享的可视化数据中，此时总是依次执行，保证顺序与同步执行相同
+    template<typename Task>
+    void forEachChannel(Task&& task) {
+        const bool collecting_visualization = visualization_config && visualization_config->collectVisualizationData_;
+        if (channel_task_runner && !collecting_visualization) {
+            channel_task_runner->run(channel_count, task);
+            return;
+        }
+        for (size_t channel_i = 0; channel_i < channel_count; ++channel_i) {
+            task(channel_i);
+        }
     }
 
     SignatureGenerationPipelineCtx(const SignatureGenerationPipelineCtx&) = delete;
@@ -6,16 +6,29 @@
 #include <iomanip>
 #include <set>
 #include <map>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
 #include "afp/afp_interface.h"
+#include "base/json_string.h"
 #include "debugger/visualization.h"
 #include "signature/signature_generator.h"
+#include "signature/segmented_signature_generator.h"
 #include "signature/signature_matcher.h"
 #include "matcher/matcher.h"
+#include "audio/pcm_file_reader.h"
+#include "audio/audio_decoder_interface.h"
 namespace fs = std::filesystem;
 
 // 可视化文件夹名称
 const std::string VISUALIZATION_DIR = "visualization_file_o";
 
+// 可视化文件的扩展名：默认JSON，--viz-format columns时为列式目录（见afp::Visualizer::isColumnarPath）
+std::string visualizationExtension = ".json";
+
 // 创建可视化文件夹并返回完整路径
 std::string createVisualizationPath(const std::string& filename) {
     // 创建可视化文件夹（如果不存在）
@@ -28,6 +41,20 @@ std::string createVisualizationPath(const std::string& filename) {
     return fs::path(VISUALIZATION_DIR) / filename;
 }
 
+// 平台配置之上的选项：--decimate时FFT前降采样，生成和匹配须使用相同的设置
+afp::PerformanceConfigOptions configOptions;
+
+// 匹配端的低延迟流式模式预算（毫秒），--latency-budget-ms设置，生成目录时不使用
+double latencyBudgetMs = 0.0;
+
+// 离线匹配文件的配置选项：处理速度不受实时预算限制，关闭自适应降级，结果不随机器负载变化
+afp::PerformanceConfigOptions offlineConfigOptions() {
+    auto options = configOptions;
+    options.adaptiveDegradation = false;
+    options.streamingLatencyBudgetMs = latencyBudgetMs;
+    return options;
+}
+
 // 默认音频格式：16位有符号整数，小端序，单声道，44100Hz
 const afp::PCMFormat defaultFormat(44100, 
                                  afp::SampleFormat::S16,
@@ -36,116 +63,255 @@ const afp::PCMFormat defaultFormat(44100,
                                  afp::ChannelLayout::Mono);
 
 // 打印指纹信息（用于调试）
-void printSignature(const std::vector<afp::SignaturePoint>& signature, const std::string& prefix) {
+// 打印指纹点数量和前100个指纹点，signature提供size()、hash(i)和timestamp(i)
+template<typename Signature>
+void printSignaturePoints(const Signature& signature, const std::string& prefix) {
     std::cout << prefix << " 指纹信息:" << std::endl;
     std::cout << "  - 指纹点数量: " << signature.size() << std::endl;
     
-    if (!signature.empty()) {
+    if (signature.size() > 0) {
         std::cout << "  - 前100个指纹点:" << std::endl;
         for (size_t i = 0; i < std::min(size_t(100), signature.size()); ++i) {
             std::cout << "    [" << i << "] Hash: 0x" 
-                     << std::hex << std::setw(8) << std::setfill('0') << signature[i].hash
-                     << std::dec << ", Timestamp: " << signature[i].timestamp << std::endl;
+                     << std::hex << std::setw(8) << std::setfill('0') << signature.hash(i)
+                     << std::dec << ", Timestamp: " << signature.timestamp(i) << std::endl;
         }
     }
     
     std::cout << std::endl;
 }
 
-// 读取PCM文件
-std::vector<uint8_t> readPCMFile(const std::string& filename) {
-    std::ifstream file(filename, std::ios::binary);
-    if (!file.is_open()) {
-        std::cerr << "Failed to open file: " << filename << std::endl;
-        return {};
+void printSignature(const std::vector<afp::SignaturePoint>& signature, const std::string& prefix) {
+    struct PointsView {
+        const std::vector<afp::SignaturePoint>& points;
+        size_t size() const { return points.size(); }
+        uint32_t hash(size_t i) const { return points[i].hash; }
+        double timestamp(size_t i) const { return points[i].timestamp; }
+    };
+    printSignaturePoints(PointsView{signature}, prefix);
+}
+
+// 目录中的指纹直接读取紧凑视图，不展开整个catalog
+void printSignature(const afp::SignatureView& signature, const std::string& prefix) {
+    printSignaturePoints(signature, prefix);
+}
+
+// 流式输入时每次送入的帧数（44.1kHz下约0.37秒），可用--chunk-frames修改
+size_t ingestChunkFrames = 16384;
+
+// 按块把PCM文件送入appendStreamBuffer，时间戳按已送入的帧数累计；任意一块失败时返回false
+template<typename Append>
+bool streamPCMFile(afp::PcmFileReader& reader, Append&& append) {
+    afp::PcmFileReader::Chunk chunk;
+    while (reader.next(chunk)) {
+        if (!append(chunk.data, chunk.size, chunk.startTimestamp)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// .pcm以外的输入（mp3、mov、wav等）由解码前端直接解码为与defaultFormat相同格式的PCM流，不生成中间文件
+bool isPCMFile(const std::string& filename) {
+    return fs::path(filename).extension() == ".pcm";
+}
+
+// 按块把输入文件送入append：PCM文件映射后按块读取，其余格式边解码边送入；读取、解码或任意一块处理失败时返回false
+template<typename Append>
+bool streamInputFile(const std::string& filename, Append&& append) {
+    if (isPCMFile(filename)) {
+        afp::PcmFileReader reader;
+        if (!reader.open(filename, defaultFormat, ingestChunkFrames)) {
+            std::cerr << "Failed to read PCM file: " << filename << std::endl;
+            return false;
+        }
+        return streamPCMFile(reader, append);
+    }
+
+    auto decoder = afp::AudioDecoderFactory::create(filename, defaultFormat.sampleRate());
+    if (!decoder) {
+        std::cerr << "Failed to open media file: " << filename << std::endl;
+        return false;
+    }
+    std::vector<int16_t> chunk(ingestChunkFrames);
+    size_t decodedFrames = 0;
+    while (size_t frames = decoder->read(chunk.data(), chunk.size())) {
+        const double startTimestamp = static_cast<double>(decodedFrames) / defaultFormat.sampleRate();
+        if (!append(chunk.data(), frames * sizeof(int16_t), startTimestamp)) {
+            return false;
+        }
+        decodedFrames += frames;
+    }
+    if (decoder->failed() || decodedFrames == 0) {
+        std::cerr << "Failed to decode media file: " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// 加载目录：文件夹按分段目录加载所有段，否则按单个catalog文件加载，失败时返回nullptr
+std::shared_ptr<afp::ICatalog> loadCatalog(const std::string& catalogFile) {
+    if (fs::is_directory(catalogFile)) {
+        return afp::interface::loadCatalogSegments(catalogFile);
+    }
+    auto catalog = afp::interface::createCatalog();
+    if (!catalog->loadFromFile(catalogFile)) {
+        return nullptr;
+    }
+    return catalog;
+}
+
+// 生成单个文件的指纹
+// segmentJobs > 1 时把单个文件切分为多段并行生成（可视化需要完整流水线状态，此时仍串行生成）
+bool generateFileSignature(std::shared_ptr<afp::IPerformanceConfig> config,
+                          const std::string& inputFile,
+                          bool generateVisualizations,
+                          std::vector<afp::SignaturePoint>& signature,
+                          size_t segmentJobs = 1) {
+    // 检查文件是否存在
+    if (!fs::exists(inputFile)) {
+        std::cerr << "Input file does not exist: " << inputFile << std::endl;
+        return false;
+    }
+
+    std::cout << "Processing: " << inputFile << std::endl;
+    
+    if (segmentJobs > 1 && !generateVisualizations && isPCMFile(inputFile)) {
+        // 分段生成需要同时访问整个文件，直接使用映射视图；需要解码的格式仍按顺序流式生成
+        afp::PcmFileReader reader;
+        if (!reader.open(inputFile, defaultFormat, ingestChunkFrames)) {
+            std::cerr << "Failed to read PCM file" << std::endl;
+            return false;
+        }
+        std::cout << "PCM 文件大小: " << reader.size() << " 字节" << std::endl;
+
+        afp::SegmentedSignatureGenerator segmentedGenerator(config, defaultFormat, segmentJobs);
+        if (!segmentedGenerator.generate(reader.data(), reader.size(), 0.0, signature)) {
+            std::cerr << "Failed to generate signature" << std::endl;
+            return false;
+        }
+        return true;
     }
 
-    // 获取文件大小
-    file.seekg(0, std::ios::end);
-    size_t size = file.tellg();
-    file.seekg(0, std::ios::beg);
+    // 创建生成器并生成指纹
+    auto generator = afp::interface::createSignatureGenerator(config);
+    
+    // Enable visualization if requested
+    if (generateVisualizations) {
+        auto* generatorImpl = dynamic_cast<afp::SignatureGenerator*>(generator.get());
+        if (generatorImpl) {
+            generatorImpl->enableVisualization(true);
+            generatorImpl->setVisualizationTitle(fs::path(inputFile).stem().string());
+            
+            // 设置音频文件路径
+            generatorImpl->setAudioFilePath(fs::absolute(inputFile).string());
+        }
+    }
+    
+    if (!generator->init(defaultFormat)) {
+        std::cerr << "Failed to initialize generator" << std::endl;
+        return false;
+    }
+
+    if (!streamInputFile(inputFile, [&](const void* data, size_t size, double startTimestamp) {
+            return generator->appendStreamBuffer(data, size, startTimestamp);
+        })) {
+        std::cerr << "Failed to generate signature" << std::endl;
+        return false;
+    }
 
-    // 读取原始数据
-    std::vector<uint8_t> data(size);
-    file.read(reinterpret_cast<char*>(data.data()), size);
+    // 移出生成的指纹，避免拷贝
+    signature = generator->takeSignature();
     
-    return data;
+    // Save visualization if requested
+    if (generateVisualizations) {
+        auto* generatorImpl = dynamic_cast<afp::SignatureGenerator*>(generator.get());
+        if (generatorImpl) {
+            std::string vizFilename = fs::path(inputFile).stem().string() + "_fingerprint" + visualizationExtension;
+            std::string vizPath = createVisualizationPath(vizFilename);
+            std::cout << "Generating visualization: " << vizPath << std::endl;
+            generatorImpl->saveVisualization(vizPath);
+        }
+    }
+
+    return true;
 }
 
 // 生成指纹模式
+// jobs > 1 时多个文件在工作线程上并行生成（每个线程各自的流水线），结果按输入顺序合并到目录
+// segmentParallel 时文件逐个处理，每个文件内部切分为jobs段并行生成，适用于少量长录音
+// appendSegment 时outputFile为分段目录，生成的指纹作为一个新段追加，不重写已有内容
 void generateFingerprints(const std::string& algorithm, 
                          const std::string& outputFile,
                          const std::vector<std::string>& inputFiles,
-                         bool generateVisualizations = false) {
+                         bool generateVisualizations = false,
+                         size_t jobs = 1,
+                         bool segmentParallel = false,
+                         bool appendSegment = false,
+                         bool writeHashStats = false) {
     // 创建配置和目录 - 生成模式使用高精度配置
-    auto config = afp::interface::createPerformanceConfig(afp::PlatformType::Mobile_Gen);
+    auto config = afp::interface::createPerformanceConfig(afp::PlatformType::Mobile_Gen, configOptions);
     auto catalog = afp::interface::createCatalog();
-    
-    for (const auto& inputFile : inputFiles) {
-        // 检查文件是否存在
-        if (!fs::exists(inputFile)) {
-            std::cerr << "Input file does not exist: " << inputFile << std::endl;
-            continue;
-        }
 
-        std::cout << "Processing: " << inputFile << std::endl;
-        
-        // 读取PCM数据
-        auto buffer = readPCMFile(inputFile);
-        if (buffer.empty()) {
-            std::cerr << "Failed to read PCM file" << std::endl;
-            continue;
-        }
+    std::vector<std::vector<afp::SignaturePoint>> signatures(inputFiles.size());
+    std::vector<char> succeeded(inputFiles.size(), 0);
+    std::atomic<size_t> nextFileIndex{0};
 
-        std::cout << "PCM 文件大小: " << buffer.size() << " 字节" << std::endl;
+    auto worker = [&]() {
+        for (size_t i = nextFileIndex++; i < inputFiles.size(); i = nextFileIndex++) {
+            succeeded[i] = generateFileSignature(config, inputFiles[i], generateVisualizations, signatures[i]);
+        }
+    };
 
-        // 创建生成器并生成指纹
-        auto generator = afp::interface::createSignatureGenerator(config);
-        
-        // Enable visualization if requested
-        if (generateVisualizations) {
-            auto* generatorImpl = dynamic_cast<afp::SignatureGenerator*>(generator.get());
-            if (generatorImpl) {
-                generatorImpl->enableVisualization(true);
-                generatorImpl->setVisualizationTitle(fs::path(inputFile).stem().string());
-                
-                // 设置音频文件路径
-                generatorImpl->setAudioFilePath(fs::absolute(inputFile).string());
-            }
+    const size_t workerCount = std::max<size_t>(1, std::min(jobs, inputFiles.size()));
+    if (segmentParallel) {
+        for (size_t i = 0; i < inputFiles.size(); ++i) {
+            succeeded[i] = generateFileSignature(config, inputFiles[i], generateVisualizations, signatures[i], jobs);
         }
-        
-        if (!generator->init(defaultFormat)) {
-            std::cerr << "Failed to initialize generator" << std::endl;
-            continue;
+    } else if (workerCount == 1) {
+        worker();
+    } else {
+        std::cout << "并行生成指纹，工作线程数: " << workerCount << std::endl;
+        std::vector<std::thread> workers;
+        workers.reserve(workerCount);
+        for (size_t i = 0; i < workerCount; ++i) {
+            workers.emplace_back(worker);
         }
+        for (auto& thread : workers) {
+            thread.join();
+        }
+    }
 
-        if (!generator->appendStreamBuffer(buffer.data(), buffer.size(), 0.0)) {
-            std::cerr << "Failed to generate signature" << std::endl;
+    // 按输入顺序合并，保证目录内容与串行生成一致
+    for (size_t i = 0; i < inputFiles.size(); ++i) {
+        if (!succeeded[i]) {
             continue;
         }
 
         // 打印生成的指纹信息
-        printSignature(generator->signature(), "生成");
+        printSignature(signatures[i], "生成");
 
         // 创建媒体信息
         afp::MediaItem mediaItem;
-        mediaItem.setTitle(fs::path(inputFile).stem().string());
+        mediaItem.setTitle(fs::path(inputFiles[i]).stem().string());
         mediaItem.setSubtitle("Generated from PCM file");
         mediaItem.setChannelCount(defaultFormat.channels());
 
         // 添加到目录
-        catalog->addSignature(generator->signature(), mediaItem);
-        
-        // Save visualization if requested
-        if (generateVisualizations) {
-            auto* generatorImpl = dynamic_cast<afp::SignatureGenerator*>(generator.get());
-            if (generatorImpl) {
-                std::string vizFilename = fs::path(inputFile).stem().string() + "_fingerprint.json";
-                std::string vizPath = createVisualizationPath(vizFilename);
-                std::cout << "Generating visualization: " << vizPath << std::endl;
-                generatorImpl->saveVisualization(vizPath);
-            }
+        catalog->addSignature(signatures[i], mediaItem);
+        signatures[i].clear();
+        signatures[i].shrink_to_fit();
+    }
+
+    // 追加为新段
+    if (appendSegment) {
+        if (!afp::interface::appendCatalogSegment(outputFile, *catalog)) {
+            std::cerr << "Failed to append catalog segment" << std::endl;
+            return;
         }
+        std::cout << "Fingerprints appended to: " << outputFile << std::endl;
+        std::cout << "总共追加了 " << catalog->signatureCount() << " 个指纹" << std::endl;
+        return;
     }
 
     // 保存到文件
@@ -155,35 +321,46 @@ void generateFingerprints(const std::string& algorithm,
     }
 
     std::cout << "Fingerprints saved to: " << outputFile << std::endl;
-    std::cout << "总共保存了 " << catalog->signatures().size() << " 个指纹" << std::endl;
+    std::cout << "总共保存了 " << catalog->signatureCount() << " 个指纹" << std::endl;
+
+    // 倒排记录长度统计仅供选择停用哈希阈值参考，写入失败不影响catalog本身
+    if (writeHashStats) {
+        const std::string statsFile = outputFile + ".hashstats";
+        if (afp::interface::writeCatalogIndexStatistics(catalog, statsFile)) {
+            std::cout << "Hash statistics saved to: " << statsFile << std::endl;
+        } else {
+            std::cerr << "Failed to write hash statistics: " << statsFile << std::endl;
+        }
+    }
 }
 
 // 匹配指纹模式
 void matchFingerprints(const std::string& algorithm, 
                       const std::string& catalogFile, 
                       const std::vector<std::string>& inputFiles, 
-                      bool generateVisualizations = false) {
+                      bool generateVisualizations = false,
+                      bool quiet = false,
+                      size_t jobs = 1) {
     // 创建配置和目录 - 匹配模式使用平衡配置
-    auto config = afp::interface::createPerformanceConfig(afp::PlatformType::Mobile);
-    auto catalog = afp::interface::createCatalog();
+    auto config = afp::interface::createPerformanceConfig(afp::PlatformType::Mobile, offlineConfigOptions());
 
-    // 加载目录
-    if (!catalog->loadFromFile(catalogFile)) {
+    auto catalog = loadCatalog(catalogFile);
+    if (!catalog) {
         std::cerr << "Failed to load catalog" << std::endl;
         return;
     }
 
     std::cout << "已加载指纹数据库: " << catalogFile << std::endl;
-    std::cout << "数据库中指纹数量: " << catalog->signatures().size() << std::endl;
+    std::cout << "数据库中指纹数量: " << catalog->signatureCount() << std::endl;
     
     // Store source fingerprint visualization data if visualization is enabled
     afp::VisualizationData sourceVizData;
     bool sourceVizEnabled = false;
     
     // 打印加载的指纹信息
-    for (size_t i = 0; i < catalog->signatures().size(); ++i) {
+    for (size_t i = 0; i < catalog->signatureCount(); ++i) {
         std::cout << "数据库中指纹 #" << i << " (" << catalog->mediaItems()[i].title() << "):" << std::endl;
-        printSignature(catalog->signatures()[i], "数据库");
+        printSignature(catalog->signatureView(i), "数据库");
         
         // If visualization is enabled, create source visualization data
         if (generateVisualizations && i == 0) {  // Just using the first signature for simplicity
@@ -192,7 +369,8 @@ void matchFingerprints(const std::string& algorithm,
             sourceVizData.duration = 0.0;
             
             // Add fingerprint points
-            for (const auto& point : catalog->signatures()[i]) {
+            for (size_t j = 0; j < catalog->signatureView(i).size(); ++j) {
+                const auto point = catalog->signaturePoint(i, j);
                 sourceVizData.fingerprintPoints.emplace_back(point.frequency, point.timestamp, point.hash);
                 sourceVizData.allPeaks.emplace_back(point.frequency, point.timestamp, point.amplitude / 1000.0f);
                 
@@ -210,12 +388,15 @@ void matchFingerprints(const std::string& algorithm,
             sourceVizData.audioFilePath = sourceAudioPath;
             
             // Save source visualization
-            std::string sourceVizFilename = catalog->mediaItems()[i].title() + "_source.json";
+            std::string sourceVizFilename = catalog->mediaItems()[i].title() + "_source" + visualizationExtension;
             std::string sourceVizPath = createVisualizationPath(sourceVizFilename);
             afp::Visualizer::saveVisualization(sourceVizData, sourceVizPath);
         }
     }
 
+    // 倒排索引只构建一次，所有输入文件的匹配器共享
+    auto catalogIndex = afp::interface::createCatalogIndex(catalog, config);
+
     // 跟踪哪些文件已匹配和未匹配
     std::set<std::string> matchedFiles;
     std::set<std::string> unmatchedFiles;
@@ -236,7 +417,11 @@ void matchFingerprints(const std::string& algorithm,
         std::string inputFileAbsPath = fs::absolute(inputFile).string();
         
         // 创建匹配器
-        auto matcher = afp::interface::createMatcher(catalog, config, defaultFormat);
+        auto matcher = afp::interface::createMatcher(catalog, catalogIndex, config, defaultFormat);
+        // 可视化需要完整的session历史，只在单线程匹配时收集
+        if (!generateVisualizations) {
+            matcher->setMatchThreads(jobs);
+        }
         
         // 标记当前文件是否匹配
         bool currentFileMatched = false;
@@ -254,6 +439,27 @@ void matchFingerprints(const std::string& algorithm,
             }
         }
         
+        // 安静模式：关闭匹配器诊断输出，改为汇总结构化统计
+        afp::MatchStats fileStats;
+        if (quiet) {
+            matcher->setLogLevel(afp::MatcherLogLevel::Quiet);
+            matcher->setStatsCallback([&](const afp::MatchStats& stats) {
+                fileStats.timestamp = stats.timestamp;
+                fileStats.queryPointCount += stats.queryPointCount;
+                fileStats.queryHitCount += stats.queryHitCount;
+                fileStats.postingHitCount += stats.postingHitCount;
+                fileStats.coarsePrunedPostingCount += stats.coarsePrunedPostingCount;
+                fileStats.resolvedSkippedPostingCount += stats.resolvedSkippedPostingCount;
+                fileStats.newSessionCount += stats.newSessionCount;
+                fileStats.mergedSessionCount += stats.mergedSessionCount;
+                fileStats.evictedSessionCount += stats.evictedSessionCount;
+                fileStats.rejectedSessionCount += stats.rejectedSessionCount;
+                fileStats.expiredSessionCount += stats.expiredSessionCount;
+                fileStats.notifiedMatchCount += stats.notifiedMatchCount;
+                fileStats.activeSessionCount = stats.activeSessionCount;
+            });
+        }
+
         matcher->setMatchCallback([&](const afp::MatchResult& result) {
             currentFileMatched = true;
             
@@ -271,7 +477,7 @@ void matchFingerprints(const std::string& algorithm,
             std::cout << "  Title: " << result.mediaItem->title() << std::endl;
             std::cout << "  Offset: " << result.offset << " seconds" << std::endl;
             std::cout << "  Confidence: " << result.confidence << std::endl;
-            std::cout << "  Matched points: " << result.matchedPoints.size() << std::endl;
+            std::cout << "  Matched points: " << (result.matchedPointIndices ? result.matchedPointIndices->size() : result.matchedPoints.size()) << std::endl;
             std::cout << "  Matched count: " << result.matchCount << std::endl;
             std::cout << "  Unique timestamp match count: " << result.uniqueTimestampMatchCount << std::endl;
             std::cout << std::endl;
@@ -279,23 +485,30 @@ void matchFingerprints(const std::string& algorithm,
 
         std::cout << "Matching: " << inputFile << std::endl;
         
-        // 读取PCM数据
-        auto buffer = readPCMFile(inputFile);
-        if (buffer.empty()) {
-            std::cerr << "Failed to read PCM file" << std::endl;
-            unmatchedFiles.insert(inputFile);
-            continue;
-        }
-
-        std::cout << "待匹配PCM文件大小: " << buffer.size() << " 字节" << std::endl;
-
-        // 执行匹配
-        if (!matcher->appendStreamBuffer(buffer.data(), buffer.size(), 0.0)) {
+        // 按块流式匹配，PCM文件直接映射，其余格式边解码边匹配
+        if (!streamInputFile(inputFile, [&](const void* data, size_t size, double startTimestamp) {
+                return matcher->appendStreamBuffer(data, size, startTimestamp);
+            })) {
             std::cerr << "Failed to match signature" << std::endl;
             unmatchedFiles.insert(inputFile);
             continue;
         }
         
+        if (quiet) {
+            std::cout << "匹配统计: 查询点 " << fileStats.queryPointCount
+                      << ", 命中查询点 " << fileStats.queryHitCount
+                      << ", 命中倒排记录 " << fileStats.postingHitCount
+                      << ", 粗筛过滤 " << fileStats.coarsePrunedPostingCount
+                      << ", 已通知跳过 " << fileStats.resolvedSkippedPostingCount
+                      << ", 新建session " << fileStats.newSessionCount
+                      << ", 合并 " << fileStats.mergedSessionCount
+                      << ", 淘汰 " << fileStats.evictedSessionCount
+                      << ", 忽略 " << fileStats.rejectedSessionCount
+                      << ", 过期 " << fileStats.expiredSessionCount
+                      << ", 通知 " << fileStats.notifiedMatchCount
+                      << ", 活跃session " << fileStats.activeSessionCount << std::endl;
+        }
+        
         // 更新匹配/未匹配列表
         if (currentFileMatched) {
             matchedFiles.insert(inputFile);
@@ -309,7 +522,7 @@ void matchFingerprints(const std::string& algorithm,
             auto* matcherImpl = dynamic_cast<afp::Matcher*>(matcher.get());
             if (matcherImpl) {
                 // Generate query visualization
-                std::string queryVizFilename = fs::path(inputFile).stem().string() + "_query.json";
+                std::string queryVizFilename = fs::path(inputFile).stem().string() + "_query" + visualizationExtension;
                 std::string queryVizPath = createVisualizationPath(queryVizFilename);
                 matcherImpl->signatureMatcher_->setAudioFilePath(inputFileAbsPath);
                 matcherImpl->signatureMatcher_->saveVisualization(queryVizPath);
@@ -317,9 +530,9 @@ void matchFingerprints(const std::string& algorithm,
                 // Generate comparison visualization if source data is available
                 if (sourceVizEnabled) {
                     std::string comparisonBasename = "comparison_" + fs::path(inputFile).stem().string() + "_vs_source";
-                    std::string sourceFilename = createVisualizationPath(comparisonBasename + "_source.json");
-                    std::string queryFilename = createVisualizationPath(comparisonBasename + "_query.json");
-                    std::string sessionsFilename = createVisualizationPath(comparisonBasename + "_sessions.json");
+                    std::string sourceFilename = createVisualizationPath(comparisonBasename + "_source" + visualizationExtension);
+                    std::string queryFilename = createVisualizationPath(comparisonBasename + "_query" + visualizationExtension);
+                    std::string sessionsFilename = createVisualizationPath(comparisonBasename + "_sessions" + visualizationExtension);
                     
                     // 设置查询数据的音频文件路径
                     afp::VisualizationData queryVizData = matcherImpl->signatureMatcher_->getVisualizationData();
@@ -363,16 +576,187 @@ void matchFingerprints(const std::string& algorithm,
               << "%" << std::endl;
 }
 
+// 批量匹配：倒排索引只构建一次，jobs个工作线程各持有一个MatchEngine，按输入顺序领取查询文件，
+// 每个查询是引擎中的一路流，结束后移除，session状态和流缓冲在引擎内复用；
+// 每个查询的结果作为一行JSON写入outputFile（按完成顺序，用file字段对应输入）
+void batchMatchFingerprints(const std::string& catalogFile,
+                            const std::string& outputFile,
+                            const std::vector<std::string>& inputFiles,
+                            size_t jobs) {
+    auto config = afp::interface::createPerformanceConfig(afp::PlatformType::Mobile, offlineConfigOptions());
+    auto catalog = loadCatalog(catalogFile);
+    if (!catalog) {
+        std::cerr << "Failed to load catalog" << std::endl;
+        return;
+    }
+    auto catalogIndex = afp::interface::createCatalogIndex(catalog, config);
+
+    std::ofstream out(outputFile);
+    if (!out) {
+        std::cerr << "Failed to open output file: " << outputFile << std::endl;
+        return;
+    }
+
+    std::mutex outputMutex;
+    std::atomic<size_t> nextFile{0};
+    std::atomic<size_t> matchedCount{0};
+    std::atomic<size_t> failedCount{0};
+    const auto batchStart = std::chrono::steady_clock::now();
+
+    auto worker = [&]() {
+        auto engine = afp::interface::createMatchEngine(catalog, catalogIndex, config);
+        std::vector<afp::MatchResult> results;
+        engine->setMatchCallback([&results](afp::StreamId, const afp::MatchResult& result) {
+            results.push_back(result);
+        });
+
+        for (size_t i = nextFile.fetch_add(1); i < inputFiles.size(); i = nextFile.fetch_add(1)) {
+            const auto& inputFile = inputFiles[i];
+            results.clear();
+            const auto queryStart = std::chrono::steady_clock::now();
+            engine->addStream(i, defaultFormat);
+            const bool ok = streamInputFile(inputFile, [&](const void* data, size_t size, double startTimestamp) {
+                return engine->appendStreamBuffer(i, data, size, startTimestamp);
+            });
+            engine->removeStream(i);
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - queryStart).count();
+
+            // 同一批查询点产生的多个结果的通知顺序取决于复用的session状态，按置信度排序使输出稳定
+            std::stable_sort(results.begin(), results.end(), [](const afp::MatchResult& a, const afp::MatchResult& b) {
+                return a.confidence > b.confidence;
+            });
+
+            std::stringstream line;
+            line << "{\"file\":" << afp::jsonString(inputFile)
+                 << ",\"ok\":" << (ok ? "true" : "false")
+                 << ",\"seconds\":" << seconds
+                 << ",\"matches\":[";
+            for (size_t r = 0; r < results.size(); ++r) {
+                const auto& result = results[r];
+                line << (r ? "," : "")
+                     << "{\"title\":" << afp::jsonString(result.mediaItem->title())
+                     << ",\"subtitle\":" << afp::jsonString(result.mediaItem->subtitle())
+                     << ",\"offset\":" << result.offset
+                     << ",\"confidence\":" << result.confidence
+                     << ",\"matchCount\":" << result.matchCount
+                     << ",\"uniqueTimestampMatchCount\":" << result.uniqueTimestampMatchCount << "}";
+            }
+            line << "]}\n";
+
+            if (!ok) {
+                failedCount.fetch_add(1);
+            } else if (!results.empty()) {
+                matchedCount.fetch_add(1);
+            }
+            std::lock_guard<std::mutex> lock(outputMutex);
+            out << line.str();
+        }
+    };
+
+    const size_t workerCount = std::max<size_t>(1, std::min(jobs, inputFiles.size()));
+    std::vector<std::thread> workers;
+    for (size_t w = 1; w < workerCount; ++w) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : workers) {
+        thread.join();
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - batchStart).count();
+    std::cout << "批量匹配完成: " << inputFiles.size() << " 个文件, 匹配成功 " << matchedCount.load()
+              << ", 读取失败 " << failedCount.load() << ", 线程 " << workerCount
+              << ", 耗时 " << std::fixed << std::setprecision(2) << seconds << " 秒"
+              << " (" << (seconds > 0.0 ? inputFiles.size() / seconds : 0.0) << " 个文件/秒)" << std::endl;
+}
+
+// 以MB为单位输出字节数
+std::string formatBytes(uint64_t bytes) {
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(3) << (bytes / (1024.0 * 1024.0)) << " MB";
+    return ss.str();
+}
+
+// 输出目录、倒排索引以及逐个输入文件流式匹配后匹配器的内存占用
+void reportMemoryUsage(const std::string& catalogFile, const std::vector<std::string>& inputFiles) {
+    auto config = afp::interface::createPerformanceConfig(afp::PlatformType::Mobile, offlineConfigOptions());
+
+    auto catalog = loadCatalog(catalogFile);
+    if (!catalog) {
+        std::cerr << "Failed to load catalog" << std::endl;
+        return;
+    }
+    auto catalogIndex = afp::interface::createCatalogIndex(catalog, config);
+
+    const auto catalogUsage = catalog->memoryUsage();
+    std::cout << "==== 目录 ====" << std::endl;
+    std::cout << "  指纹: " << catalogUsage.signatureCount << " 个, " << catalogUsage.signaturePointCount
+              << " 个指纹点, " << formatBytes(catalogUsage.signatureBytes) << std::endl;
+    if (catalogUsage.expandedBytes > 0) {
+        std::cout << "  展开的指纹点: " << formatBytes(catalogUsage.expandedBytes) << std::endl;
+    }
+    std::cout << "  媒体信息: " << catalogUsage.mediaItemCount << " 个, " << formatBytes(catalogUsage.mediaItemBytes) << std::endl;
+    std::cout << "  合计: " << formatBytes(catalogUsage.totalBytes()) << std::endl;
+
+    const auto indexUsage = catalogIndex->memoryUsage();
+    std::cout << "==== 倒排索引 ====" << std::endl;
+    std::cout << "  哈希: " << indexUsage.hashCount << " 个, 哈希桶 " << formatBytes(indexUsage.bucketBytes) << std::endl;
+    std::cout << "  倒排记录: " << indexUsage.postingCount << " 条, " << formatBytes(indexUsage.postingBytes) << std::endl;
+    std::cout << "  附加结构: " << formatBytes(indexUsage.overheadBytes) << std::endl;
+    std::cout << "  合计: " << formatBytes(indexUsage.totalBytes())
+              << " (其中映射自文件 " << formatBytes(indexUsage.mappedBytes) << ")" << std::endl;
+
+    for (const auto& inputFile : inputFiles) {
+        auto matcher = afp::interface::createMatcher(catalog, catalogIndex, config, defaultFormat);
+        matcher->setLogLevel(afp::MatcherLogLevel::Quiet);
+        if (!streamInputFile(inputFile, [&](const void* data, size_t size, double startTimestamp) {
+                return matcher->appendStreamBuffer(data, size, startTimestamp);
+            })) {
+            std::cerr << "Failed to match signature: " << inputFile << std::endl;
+            continue;
+        }
+
+        const auto usage = matcher->memoryUsage();
+        const auto& generator = usage.generator;
+        std::cout << "==== 匹配器: " << inputFile << " ====" << std::endl;
+        std::cout << "  指纹生成: " << formatBytes(generator.totalBytes()) << std::endl;
+        std::cout << "    输入缓冲: " << formatBytes(generator.inputBufferBytes) << std::endl;
+        std::cout << "    FFT: " << formatBytes(generator.fftBytes) << std::endl;
+        std::cout << "    峰值检测: " << formatBytes(generator.peakDetectionBytes) << std::endl;
+        std::cout << "    长帧构建: " << formatBytes(generator.longFrameBytes) << std::endl;
+        std::cout << "    hash计算: " << formatBytes(generator.hashBytes) << std::endl;
+        std::cout << "    线程交接: " << formatBytes(generator.handoffBytes) << std::endl;
+        std::cout << "    累积指纹点: " << formatBytes(generator.signatureBytes) << std::endl;
+        std::cout << "    事件追踪: " << formatBytes(generator.traceBytes) << std::endl;
+        std::cout << "  查询缓冲: " << formatBytes(usage.queryBufferBytes) << std::endl;
+        std::cout << "  session: " << usage.sessionCount << " 个, " << formatBytes(usage.sessionBytes) << std::endl;
+        std::cout << "  匹配历史: " << formatBytes(usage.historyBytes)
+                  << " (峰值 " << formatBytes(usage.historyPeakBytes) << ")" << std::endl;
+        std::cout << "  匹配结果: " << formatBytes(usage.resultBytes) << std::endl;
+        std::cout << "  事件追踪: " << formatBytes(usage.traceBytes) << std::endl;
+        if (usage.shardIndexBytes > 0) {
+            std::cout << "  分片索引: " << formatBytes(usage.shardIndexBytes) << std::endl;
+        }
+        std::cout << "  合计: " << formatBytes(usage.totalBytes()) << std::endl;
+    }
+}
+
 int main(int argc, char* argv[]) {
     if (argc < 4) {
         std::cerr << "Usage:" << std::endl;
-        std::cerr << "  Generate fingerprints: " << argv[0] << " generate <algorithm> <output_file> <input_file1> [input_file2 ...] [--visualize]" << std::endl;
-        std::cerr << "  Match fingerprints: " << argv[0] << " match <algorithm> <catalog_file> <input_file1> [input_file2 ...] [--visualize]" << std::endl;
+        std::cerr << "  Generate fingerprints: " << argv[0] << " generate <algorithm> <output_file> <input_file1> [input_file2 ...] [--visualize] [--viz-format json|columns] [--jobs N] [--segment-parallel] [--chunk-frames N] [--hash-stats] [--decimate]" << std::endl;
+        std::cerr << "  Append catalog segment: " << argv[0] << " append <algorithm> <catalog_dir> <input_file1> [input_file2 ...] [--jobs N] [--segment-parallel] [--decimate]" << std::endl;
+        std::cerr << "  Compact catalog segments: " << argv[0] << " compact <algorithm> <catalog_dir> [--no-side-tables]" << std::endl;
+        std::cerr << "  Match fingerprints: " << argv[0] << " match <algorithm> <catalog_file|catalog_dir> <input_file1> [input_file2 ...] [--visualize] [--viz-format json|columns] [--quiet] [--jobs N] [--chunk-frames N] [--decimate] [--latency-budget-ms N]" << std::endl;
+        std::cerr << "  Batch match to JSON lines: " << argv[0] << " batch-match <algorithm> <catalog_file|catalog_dir> <output.jsonl> [input_file1 ...] [--input-list list.txt] [--jobs N] [--chunk-frames N] [--decimate] [--latency-budget-ms N]" << std::endl;
+        std::cerr << "  Report memory usage: " << argv[0] << " memory <algorithm> <catalog_file|catalog_dir> [input_file1 ...] [--chunk-frames N] [--decimate] [--latency-budget-ms N]" << std::endl;
         return 1;
     }
 
     std::string mode = argv[1];
     bool visualize = false;
+    size_t jobs = 1;
+    bool segmentParallel = false;
     
     // Check for visualization flag
     for (int i = 1; i < argc; i++) {
@@ -381,17 +765,94 @@ int main(int argc, char* argv[]) {
             break;
         }
     }
+
+    // 并行工作线程数，0表示使用全部CPU核心
+    for (int i = 1; i + 1 < argc; i++) {
+        if (std::string(argv[i]) == "--jobs") {
+            jobs = std::stoul(argv[i + 1]);
+            if (jobs == 0) {
+                jobs = std::max(1u, std::thread::hardware_concurrency());
+            }
+            break;
+        }
+    }
+
+    // 流式输入每块的帧数
+    for (int i = 1; i + 1 < argc; i++) {
+        if (std::string(argv[i]) == "--chunk-frames") {
+            ingestChunkFrames = std::max<size_t>(1, std::stoul(argv[i + 1]));
+            break;
+        }
+    }
+
+    // 可视化文件格式
+    for (int i = 1; i + 1 < argc; i++) {
+        if (std::string(argv[i]) == "--viz-format") {
+            const std::string format = argv[i + 1];
+            if (format == "columns") {
+                visualizationExtension = afp::Visualizer::kColumnarExtension;
+            } else if (format != "json") {
+                std::cerr << "Unknown visualization format: " << format << std::endl;
+                return 1;
+            }
+            break;
+        }
+    }
+
+    // 单个长录音分段并行生成
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--segment-parallel") {
+            segmentParallel = true;
+            break;
+        }
+    }
+
+    // 匹配端的低延迟流式模式
+    for (int i = 1; i + 1 < argc; i++) {
+        if (std::string(argv[i]) == "--latency-budget-ms") {
+            char* end = nullptr;
+            latencyBudgetMs = std::strtod(argv[i + 1], &end);
+            if (end == argv[i + 1] || *end != '\0' || !(latencyBudgetMs >= 0.0)) {
+                std::cerr << "Invalid latency budget: " << argv[i + 1] << std::endl;
+                return 1;
+            }
+            break;
+        }
+    }
+
+    // FFT前降采样
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--decimate") {
+            configOptions.enableDecimation = true;
+            break;
+        }
+    }
+
+    // 生成catalog时在旁边写出哈希统计文件
+    bool hashStats = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--hash-stats") {
+            hashStats = true;
+            break;
+        }
+    }
     
-    if (mode == "generate") {
+    if (mode == "generate" || mode == "append") {
         if (argc < 5) {
-            std::cerr << "Error: Not enough arguments for generate mode" << std::endl;
+            std::cerr << "Error: Not enough arguments for " << mode << " mode" << std::endl;
             return 1;
         }
         std::string algorithm = argv[2];
         std::string outputFile = argv[3];
         std::vector<std::string> inputFiles;
         for (int i = 4; i < argc; ++i) {
-            if (std::string(argv[i]) != "--visualize") {
+            if (std::string(argv[i]) == "--jobs" || std::string(argv[i]) == "--chunk-frames" ||
+                std::string(argv[i]) == "--viz-format") {
+                ++i;  // 跳过选项的参数
+                continue;
+            }
+            if (std::string(argv[i]) != "--visualize" && std::string(argv[i]) != "--segment-parallel" &&
+                std::string(argv[i]) != "--hash-stats" && std::string(argv[i]) != "--decimate") {
                 inputFiles.push_back(argv[i]);
             }
         }
@@ -401,9 +862,24 @@ int main(int argc, char* argv[]) {
             std::cout << "处理文件: " << file << std::endl;
         }
         
-        generateFingerprints(algorithm, outputFile, inputFiles, visualize);
+        generateFingerprints(algorithm, outputFile, inputFiles, visualize, jobs, segmentParallel, mode == "append", hashStats);
         std::cout << "指纹生成完成，已保存到: " << outputFile << std::endl;
         
+    } else if (mode == "compact") {
+        std::string catalogDir = argv[3];
+        bool storeSideTables = true;
+        for (int i = 4; i < argc; ++i) {
+            if (std::string(argv[i]) == "--no-side-tables") {
+                storeSideTables = false;
+            }
+        }
+
+        if (!afp::interface::compactCatalogSegments(catalogDir, storeSideTables)) {
+            std::cerr << "Failed to compact catalog segments" << std::endl;
+            return 1;
+        }
+        std::cout << "目录段合并完成: " << catalogDir << std::endl;
+        
     } else if (mode == "match") {
         if (argc < 5) {
             std::cerr << "Error: Not enough arguments for match mode" << std::endl;
@@ -413,9 +889,16 @@ int main(int argc, char* argv[]) {
         std::string catalogFile = argv[3];
         std::vector<std::string> inputFiles;
         
+        bool quiet = false;
+        
         // 收集所有输入文件
         for (int i = 4; i < argc; ++i) {
-            if (std::string(argv[i]) != "--visualize") {
+            if (std::string(argv[i]) == "--jobs" || std::string(argv[i]) == "--chunk-frames" ||
+                std::string(argv[i]) == "--viz-format" || std::string(argv[i]) == "--latency-budget-ms") {
+                ++i;  // 跳过选项的参数
+            } else if (std::string(argv[i]) == "--quiet") {
+                quiet = true;
+            } else if (std::string(argv[i]) != "--visualize" && std::string(argv[i]) != "--decimate") {
                 inputFiles.push_back(argv[i]);
             }
         }
@@ -433,9 +916,57 @@ int main(int argc, char* argv[]) {
             return 1;
         }
         
-        matchFingerprints(algorithm, catalogFile, inputFiles, visualize);
+        matchFingerprints(algorithm, catalogFile, inputFiles, visualize, quiet, jobs);
         std::cout << "所有文件处理完成!" << std::endl;
         
+    } else if (mode == "batch-match") {
+        if (argc < 5) {
+            std::cerr << "Error: Not enough arguments for batch-match mode" << std::endl;
+            return 1;
+        }
+        std::string catalogFile = argv[3];
+        std::string outputFile = argv[4];
+        std::vector<std::string> inputFiles;
+        for (int i = 5; i < argc; ++i) {
+            if (std::string(argv[i]) == "--jobs" || std::string(argv[i]) == "--chunk-frames" ||
+                std::string(argv[i]) == "--latency-budget-ms") {
+                ++i;  // 跳过选项的参数
+            } else if (std::string(argv[i]) == "--input-list" && i + 1 < argc) {
+                // 每行一个输入文件，用于超出命令行长度的大批量查询
+                std::ifstream list(argv[++i]);
+                if (!list) {
+                    std::cerr << "Failed to open input list: " << argv[i] << std::endl;
+                    return 1;
+                }
+                std::string line;
+                while (std::getline(list, line)) {
+                    if (!line.empty()) {
+                        inputFiles.push_back(line);
+                    }
+                }
+            } else if (std::string(argv[i]) != "--decimate") {
+                inputFiles.push_back(argv[i]);
+            }
+        }
+
+        if (inputFiles.empty()) {
+            std::cerr << "Error: No input files specified for matching" << std::endl;
+            return 1;
+        }
+        batchMatchFingerprints(catalogFile, outputFile, inputFiles, jobs);
+
+    } else if (mode == "memory") {
+        std::string catalogFile = argv[3];
+        std::vector<std::string> inputFiles;
+        for (int i = 4; i < argc; ++i) {
+            if (std::string(argv[i]) == "--chunk-frames" || std::string(argv[i]) == "--latency-budget-ms") {
+                ++i;  // 跳过选项的参数
+            } else if (std::string(argv[i]) != "--decimate") {
+                inputFiles.push_back(argv[i]);
+            }
+        }
+        reportMemoryUsage(catalogFile, inputFiles);
+
     } else {
         std::cerr << "Invalid mode: " << mode << std::endl;
         return 1;
@@ -0,0 +1,328 @@
+#include "server/match_server.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <thread>
+#include "server/server_protocol.h"
+
+namespace fs = std::filesystem;
+
+namespace afp {
+namespace server {
+
+namespace {
+
+// 每个指纹点在线路上的字节数：u32 hash | f64 时间戳 | u32 频率 | u32 振幅
+constexpr size_t kWirePointBytes = 4 + 8 + 4 + 4;
+
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;  // 没有MSG_NOSIGNAL的平台上由server_main忽略SIGPIPE
+#endif
+
+// accept出错（如fd耗尽）后重试前的等待时间
+constexpr auto kAcceptRetryDelay = std::chrono::milliseconds(100);
+
+bool readAll(int fd, void* data, size_t size) {
+    auto* bytes = static_cast<uint8_t*>(data);
+    while (size > 0) {
+        const ssize_t n = ::recv(fd, bytes, size, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        bytes += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool writeAll(int fd, const uint8_t* data, size_t size) {
+    while (size > 0) {
+        const ssize_t n = ::send(fd, data, size, kSendFlags);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+void appendMessage(std::vector<uint8_t>& out, MessageWriter& writer) {
+    const auto& bytes = writer.finish();
+    out.insert(out.end(), bytes.begin(), bytes.end());
+}
+
+bool isValidSampleFormat(uint8_t value) {
+    return value <= static_cast<uint8_t>(SampleFormat::F64);
+}
+
+// 执行一条请求，失败时返回false并写入error
+bool handleRequest(IMatchEngine& engine, MessageType type, MessageReader& reader,
+                   std::vector<SignaturePoint>& points, std::string& error) {
+    const StreamId streamId = reader.u64();
+    switch (type) {
+    case MessageType::OpenStream: {
+        const uint32_t sampleRate = reader.u32();
+        const uint8_t sampleFormat = reader.u8();
+        const uint8_t channels = reader.u8();
+        if (!reader.ok() || sampleRate == 0 || channels == 0 || !isValidSampleFormat(sampleFormat)) {
+            error = "invalid stream format";
+            return false;
+        }
+        const PCMFormat format(sampleRate, static_cast<SampleFormat>(sampleFormat), channels, Endianness::Little,
+                               channels == 1 ? ChannelLayout::Mono : ChannelLayout::Stereo);
+        if (!engine.addStream(streamId, format)) {
+            error = "stream already open";
+            return false;
+        }
+        return true;
+    }
+    case MessageType::Audio: {
+        const double startTimestamp = reader.f64();
+        size_t size = 0;
+        const uint8_t* data = reader.rest(size);
+        if (!reader.ok()) {
+            error = "truncated audio message";
+            return false;
+        }
+        if (!engine.appendStreamBuffer(streamId, data, size, startTimestamp)) {
+            error = "unknown stream or invalid audio";
+            return false;
+        }
+        return true;
+    }
+    case MessageType::Fingerprints: {
+        const uint32_t count = reader.u32();
+        if (!reader.ok() || reader.remaining() != static_cast<size_t>(count) * kWirePointBytes) {
+            error = "truncated fingerprint message";
+            return false;
+        }
+        points.resize(count);
+        for (auto& point : points) {
+            point.hash = reader.u32();
+            point.timestamp = reader.f64();
+            point.frequency = reader.u32();
+            point.amplitude = reader.u32();
+        }
+        if (!engine.appendSignaturePoints(streamId, points.data(), points.size())) {
+            error = "unknown stream";
+            return false;
+        }
+        return true;
+    }
+    case MessageType::SignatureBatch: {
+        size_t size = 0;
+        const uint8_t* data = reader.rest(size);
+        if (!reader.ok()) {
+            error = "truncated signature batch";
+            return false;
+        }
+        if (!engine.appendSignatureBatch(streamId, data, size)) {
+            error = "unknown stream or invalid signature batch";
+            return false;
+        }
+        return true;
+    }
+    case MessageType::CloseStream:
+        if (!reader.ok()) {
+            error = "truncated close message";
+            return false;
+        }
+        if (!engine.removeStream(streamId)) {
+            error = "unknown stream";
+            return false;
+        }
+        return true;
+    default:
+        error = "unknown message type";
+        return false;
+    }
+}
+
+} // namespace
+
+MatchServer::MatchServer(ServerOptions options)
+    : options_(std::move(options)) {
+}
+
+MatchServer::~MatchServer() {
+    if (listenFd_ >= 0) {
+        ::close(listenFd_);
+    }
+}
+
+bool MatchServer::start() {
+    // 加载目录：文件夹按分段目录加载所有段，否则按单个catalog文件加载，与AFingerprint match相同
+    if (fs::is_directory(options_.catalog)) {
+        catalog_ = interface::loadCatalogSegments(options_.catalog);
+    } else {
+        catalog_ = interface::createCatalog();
+        if (!catalog_->loadFromFile(options_.catalog)) {
+            catalog_.reset();
+        }
+    }
+    if (!catalog_) {
+        std::cerr << "Failed to load catalog: " << options_.catalog << std::endl;
+        return false;
+    }
+
+    // 倒排索引只构建一次，所有连接的引擎共享
+    PerformanceConfigOptions configOptions;
+    configOptions.streamingLatencyBudgetMs = options_.latencyBudgetMs;
+    config_ = interface::createPerformanceConfig(options_.platform, configOptions);
+    index_ = interface::createCatalogIndex(catalog_, config_);
+    std::cout << "Catalog loaded: " << catalog_->mediaItems().size() << " items, "
+              << index_->hashCount() << " unique hashes" << std::endl;
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(options_.port);
+    if (::inet_pton(AF_INET, options_.bindAddress.c_str(), &address.sin_addr) != 1) {
+        std::cerr << "Invalid bind address: " << options_.bindAddress << std::endl;
+        return false;
+    }
+
+    listenFd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listenFd_ < 0) {
+        std::cerr << "Failed to create socket" << std::endl;
+        return false;
+    }
+    const int reuse = 1;
+    ::setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (::bind(listenFd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::listen(listenFd_, SOMAXCONN) != 0) {
+        std::cerr << "Failed to listen on " << options_.bindAddress << ":" << options_.port << std::endl;
+        return false;
+    }
+
+    running_ = true;
+    std::cout << "Listening on " << options_.bindAddress << ":" << options_.port << std::endl;
+    return true;
+}
+
+void MatchServer::run() {
+    while (running_) {
+        const int fd = ::accept(listenFd_, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED || !running_) {
+                continue;
+            }
+            // fd或内存耗尽等错误通常是暂时的，稍后重试；只有stop()才结束循环
+            std::cerr << "accept failed: " << std::strerror(errno) << std::endl;
+            std::this_thread::sleep_for(kAcceptRetryDelay);
+            continue;
+        }
+        if (!running_) {
+            ::close(fd);
+            break;
+        }
+
+        // 请求和回复都是小消息，关闭Nagle避免每个Ack等待延迟确认
+        const int noDelay = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+        std::lock_guard<std::mutex> lock(connectionsMutex_);
+        if (connections_.size() >= options_.maxConnections) {
+            std::cerr << "Refusing connection: " << connections_.size() << " connections open (limit "
+                      << options_.maxConnections << ")" << std::endl;
+            ::close(fd);
+            continue;
+        }
+        connections_.insert(fd);
+        std::thread(&MatchServer::runConnection, this, fd).detach();
+    }
+
+    std::unique_lock<std::mutex> lock(connectionsMutex_);
+    for (const int fd : connections_) {
+        ::shutdown(fd, SHUT_RDWR);
+    }
+    connectionsClosed_.wait(lock, [this] { return connections_.empty(); });
+}
+
+void MatchServer::stop() {
+    running_ = false;
+    if (listenFd_ >= 0) {
+        ::shutdown(listenFd_, SHUT_RDWR);
+    }
+}
+
+void MatchServer::runConnection(int fd) {
+    serveConnection(fd);
+
+    // 注销、关闭和通知都在锁内：accept复用这个fd时run()的登记一定在注销之后；run()返回后本线程不再访问this
+    std::lock_guard<std::mutex> lock(connectionsMutex_);
+    connections_.erase(fd);
+    ::close(fd);
+    connectionsClosed_.notify_all();
+}
+
+void MatchServer::serveConnection(int fd) {
+    auto engine = interface::createMatchEngine(catalog_, index_, config_);
+
+    // 匹配结果在请求处理期间同步产生，先写入回复缓冲，和该请求的Ack一起发出
+    std::vector<uint8_t> reply;
+    engine->setMatchCallback([&reply](StreamId streamId, const MatchResult& result) {
+        MessageWriter writer(MessageType::Match);
+        writer.u64(streamId);
+        writer.f64(result.offset);
+        writer.f64(result.confidence);
+        writer.u32(static_cast<uint32_t>(result.matchCount));
+        writer.u32(static_cast<uint32_t>(result.uniqueTimestampMatchCount));
+        writer.str(result.mediaItem ? result.mediaItem->title() : std::string());
+        writer.str(result.mediaItem ? result.mediaItem->subtitle() : std::string());
+        appendMessage(reply, writer);
+    });
+
+    std::vector<uint8_t> message;
+    std::vector<SignaturePoint> points;
+    std::string error;
+    while (true) {
+        uint8_t header[4];
+        if (!readAll(fd, header, sizeof(header))) {
+            break;
+        }
+        MessageReader lengthReader(header, sizeof(header));
+        const uint32_t length = lengthReader.u32();
+        if (length == 0 || length > kMaxMessageBytes) {
+            std::cerr << "Closing connection: invalid message length " << length << std::endl;
+            break;
+        }
+        message.resize(length);
+        if (!readAll(fd, message.data(), message.size())) {
+            break;
+        }
+
+        const auto type = static_cast<MessageType>(message[0]);
+        MessageReader reader(message.data() + 1, message.size() - 1);
+        error.clear();
+        const bool ok = handleRequest(*engine, type, reader, points, error);
+
+        MessageWriter ack(MessageType::Ack);
+        ack.u8(message[0]);
+        ack.u8(ok ? 0 : 1);
+        ack.str(error);
+        appendMessage(reply, ack);
+        if (!writeAll(fd, reply.data(), reply.size())) {
+            break;
+        }
+        reply.clear();
+    }
+}
+
+} // namespace server
+} // namespace afp
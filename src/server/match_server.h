@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include "afp/afp_interface.h"
+
+namespace afp {
+namespace server {
+
+struct ServerOptions {
+    std::string catalog;                 // catalog文件或分段目录
+    std::string bindAddress = "127.0.0.1";
+    uint16_t port = 7700;
+    PlatformType platform = PlatformType::Mobile;
+    // 同时打开的连接数上限，超出时新连接直接关闭
+    // 每个连接占用一个线程、一个MatchEngine和最多kMaxMessageBytes的消息缓冲
+    size_t maxConnections = 64;
+    double latencyBudgetMs = 0.0;        // 低延迟流式模式的预算（毫秒），0表示关闭，见PerformanceConfigOptions::streamingLatencyBudgetMs
+};
+
+// 常驻的匹配服务：catalog和倒排索引在启动时加载一次，之后所有连接共享
+// 每个连接一个分离的线程和一个MatchEngine，连接内可以同时打开多路流；协议见server_protocol.h
+// 同时打开的连接数受ServerOptions::maxConnections限制，超出时新连接直接关闭
+// 仅支持POSIX套接字
+class MatchServer {
+public:
+    explicit MatchServer(ServerOptions options);
+    ~MatchServer();
+
+    // 加载catalog、构建索引并开始监听，失败时返回false
+    bool start();
+
+    // 接受连接直到stop()被调用，accept的暂时性错误记录日志后稍等重试；返回前关闭所有连接并等待连接线程结束
+    void run();
+
+    // 停止接受新连接；只做原子写和shutdown，可以在信号处理函数中调用
+    void stop();
+
+private:
+    // 连接线程的入口：处理连接，结束后关闭fd、注销连接并通知run()
+    void runConnection(int fd);
+
+    // 处理一个连接直到对端关闭或协议出错
+    void serveConnection(int fd);
+
+    ServerOptions options_;
+    std::shared_ptr<ICatalog> catalog_;
+    std::shared_ptr<const ICatalogIndex> index_;
+    std::shared_ptr<IPerformanceConfig> config_;
+    int listenFd_ = -1;
+    std::atomic<bool> running_{false};
+
+    // 连接线程结束时自行注销，不需要join；run()退出时shutdown仍打开的连接，等待connections_变空
+    std::mutex connectionsMutex_;
+    std::condition_variable connectionsClosed_;
+    std::unordered_set<int> connections_;  // 打开的连接（每个对应一个仍在运行的连接线程）
+};
+
+} // namespace server
+} // namespace afp
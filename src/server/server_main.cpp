@@ -0,0 +1,104 @@
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "server/match_server.h"
+
+namespace {
+
+afp::server::MatchServer* runningServer = nullptr;
+
+void handleSignal(int) {
+    if (runningServer) {
+        runningServer->stop();
+    }
+}
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <catalog_file|catalog_dir> [--bind 127.0.0.1] [--port 7700]"
+              << " [--platform mobile|desktop|server] [--max-connections N] [--latency-budget-ms N]" << std::endl;
+}
+
+bool parseOptions(int argc, char* argv[], afp::server::ServerOptions& options) {
+    if (argc < 2) {
+        return false;
+    }
+    options.catalog = argv[1];
+    for (int i = 2; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (arg == "--bind" && has_value) {
+            options.bindAddress = argv[++i];
+        } else if (arg == "--port" && has_value) {
+            const char* value = argv[++i];
+            char* end = nullptr;
+            errno = 0;
+            const unsigned long port = std::strtoul(value, &end, 10);
+            if (end == value || *end != '\0' || errno == ERANGE || value[0] == '-' || port == 0 || port > 65535) {
+                std::cerr << "无效端口: " << value << std::endl;
+                return false;
+            }
+            options.port = static_cast<uint16_t>(port);
+        } else if (arg == "--max-connections" && has_value) {
+            const char* value = argv[++i];
+            char* end = nullptr;
+            errno = 0;
+            const unsigned long long count = std::strtoull(value, &end, 10);
+            if (end == value || *end != '\0' || errno == ERANGE || value[0] == '-' || count == 0) {
+                std::cerr << "无效的连接数上限: " << value << std::endl;
+                return false;
+            }
+            options.maxConnections = static_cast<size_t>(count);
+        } else if (arg == "--latency-budget-ms" && has_value) {
+            const char* value = argv[++i];
+            char* end = nullptr;
+            options.latencyBudgetMs = std::strtod(value, &end);
+            if (end == value || *end != '\0' || !(options.latencyBudgetMs >= 0.0)) {
+                std::cerr << "无效的延迟预算: " << value << std::endl;
+                return false;
+            }
+        } else if (arg == "--platform" && has_value) {
+            const std::string platform = argv[++i];
+            if (platform == "mobile") {
+                options.platform = afp::PlatformType::Mobile;
+            } else if (platform == "desktop") {
+                options.platform = afp::PlatformType::Desktop;
+            } else if (platform == "server") {
+                options.platform = afp::PlatformType::Server;
+            } else {
+                std::cerr << "未知平台: " << platform << std::endl;
+                return false;
+            }
+        } else {
+            std::cerr << "未知参数: " << arg << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    afp::server::ServerOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    afp::server::MatchServer server(options);
+    if (!server.start()) {
+        return 1;
+    }
+
+    runningServer = &server;
+    std::signal(SIGINT, handleSignal);
+    std::signal(SIGTERM, handleSignal);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    server.run();
+    runningServer = nullptr;
+    std::cout << "Server stopped" << std::endl;
+    return 0;
+}
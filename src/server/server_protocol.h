@@ -0,0 +1,135 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// afp_server的线路协议：TCP上的长度前缀消息，所有整数和浮点数均为小端序
+//
+//   消息 = u32 长度（不含这4个字节） | u8 类型 | 负载
+//
+// 客户端请求（每个请求处理完后服务端回复一个Ack，之前先发出本次请求产生的所有Match）：
+//   OpenStream   u64 streamId | u32 采样率 | u8 样本格式（afp::SampleFormat的值）| u8 通道数
+//   Audio        u64 streamId | f64 起始时间戳（秒）| 交错的PCM数据（到消息末尾）
+//   Fingerprints u64 streamId | u32 点数 | 点数 × (u32 hash | f64 时间戳 | u32 频率 | u32 振幅)
+//   CloseStream  u64 streamId
+//   SignatureBatch u64 streamId | afp::SignatureBatchCodec编码的指纹点批次（到消息末尾）
+//
+// 服务端消息：
+//   Match        u64 streamId | f64 偏移 | f64 置信度 | u32 匹配点数 | u32 唯一时间戳匹配数 | 字符串 标题 | 字符串 副标题
+//   Ack          u8 请求类型 | u8 状态（0成功）| 字符串 错误信息
+//
+// 字符串 = u16 字节数 | UTF-8字节
+
+namespace afp {
+namespace server {
+
+enum class MessageType : uint8_t {
+    OpenStream = 1,
+    Audio = 2,
+    Fingerprints = 3,
+    CloseStream = 4,
+    SignatureBatch = 5,
+    Match = 0x81,
+    Ack = 0x82,
+};
+
+// 单个消息的最大长度，超过时服务端断开连接
+constexpr uint32_t kMaxMessageBytes = 64u << 20;
+
+// 按小端序追加到缓冲
+class MessageWriter {
+public:
+    explicit MessageWriter(MessageType type) {
+        bytes_.resize(4);
+        u8(static_cast<uint8_t>(type));
+    }
+
+    void u8(uint8_t value) { bytes_.push_back(value); }
+    void u16(uint16_t value) { append(value, 2); }
+    void u32(uint32_t value) { append(value, 4); }
+    void u64(uint64_t value) { append(value, 8); }
+
+    void f64(double value) {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        u64(bits);
+    }
+
+    // 超过65535字节的部分被截断
+    void str(const std::string& value) {
+        const auto size = static_cast<uint16_t>(std::min<size_t>(value.size(), UINT16_MAX));
+        u16(size);
+        bytes_.insert(bytes_.end(), value.begin(), value.begin() + size);
+    }
+
+    // 填写长度前缀并返回完整的消息
+    const std::vector<uint8_t>& finish() {
+        const auto length = static_cast<uint32_t>(bytes_.size() - 4);
+        for (size_t i = 0; i < 4; ++i) {
+            bytes_[i] = static_cast<uint8_t>(length >> (8 * i));
+        }
+        return bytes_;
+    }
+
+private:
+    void append(uint64_t value, size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+            bytes_.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+
+    std::vector<uint8_t> bytes_;
+};
+
+// 按小端序从消息负载中读取，越界时ok()变为false并返回0
+class MessageReader {
+public:
+    MessageReader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+    uint8_t u8() { return static_cast<uint8_t>(read(1)); }
+    uint16_t u16() { return static_cast<uint16_t>(read(2)); }
+    uint32_t u32() { return static_cast<uint32_t>(read(4)); }
+    uint64_t u64() { return read(8); }
+
+    double f64() {
+        const uint64_t bits = read(8);
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    // 剩余的全部字节
+    const uint8_t* rest(size_t& size) {
+        size = size_ - offset_;
+        const uint8_t* data = data_ + offset_;
+        offset_ = size_;
+        return data;
+    }
+
+    size_t remaining() const { return size_ - offset_; }
+    bool ok() const { return ok_; }
+
+private:
+    uint64_t read(size_t size) {
+        if (!ok_ || size_ - offset_ < size) {
+            ok_ = false;
+            return 0;
+        }
+        uint64_t value = 0;
+        for (size_t i = 0; i < size; ++i) {
+            value |= static_cast<uint64_t>(data_[offset_ + i]) << (8 * i);
+        }
+        offset_ += size;
+        return value;
+    }
+
+    const uint8_t* data_;
+    size_t size_;
+    size_t offset_ = 0;
+    bool ok_ = true;
+};
+
+} // namespace server
+} // namespace afp
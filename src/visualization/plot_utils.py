@@ -5,11 +5,85 @@
 """
 
 import json
+import os
 import re
 
+COLUMNAR_EXTENSION = '.columns'
+
+
+def is_columnar_path(filename):
+    """是否为列式格式（Visualizer按.columns目录保存的.npy列）"""
+    return os.path.isdir(filename) and filename.rstrip('/\\').endswith(COLUMNAR_EXTENSION)
+
+
+class ColumnRows:
+    """
+    把一组等长的列按行访问，行的布局与JSON格式相同（如[frequency, time, amplitude]），
+    现有的绘图代码不需要修改；列本身是内存映射的numpy数组，可以通过columns直接做向量化处理
+    """
+
+    def __init__(self, columns, names):
+        self.columns = columns
+        self.names = names
+        self._arrays = [columns[name] for name in names]
+
+    def __len__(self):
+        return len(self._arrays[0]) if self._arrays else 0
+
+    def _row(self, i):
+        row = []
+        for name, array in zip(self.names, self._arrays):
+            value = array[i].item()
+            # 与JSON格式一致，哈希显示为十六进制字符串
+            row.append(f"0x{value:x}" if name == 'hash' else value)
+        return row
+
+    def __getitem__(self, index):
+        if isinstance(index, slice):
+            return [self._row(i) for i in range(*index.indices(len(self)))]
+        if index < 0:
+            index += len(self)
+        if index < 0 or index >= len(self):
+            raise IndexError(index)
+        return self._row(index)
+
+    def __iter__(self):
+        for i in range(len(self)):
+            yield self._row(i)
+
+
+def _load_columns(directory):
+    import numpy as np
+
+    with open(os.path.join(directory, 'meta.json'), 'r') as f:
+        meta = json.load(f)
+    tables = {}
+    for table, names in meta.get('tables', {}).items():
+        columns = {name: np.load(os.path.join(directory, f"{table}.{name}.npy"), mmap_mode='r')
+                   for name in names}
+        tables[table] = ColumnRows(columns, names)
+    return meta, tables
+
 
 def load_data(filename):
-    """Load fingerprint data from JSON file"""
+    """Load fingerprint data from JSON file or a columnar .columns directory"""
+    if is_columnar_path(filename):
+        meta, tables = _load_columns(filename)
+        data = {key: value for key, value in meta.items() if key not in ('format', 'kind', 'tables')}
+        data.update(tables)
+        return data
+    with open(filename, 'r') as f:
+        return json.load(f)
+
+
+def load_sessions(filename):
+    """Load top sessions data from JSON file or a columnar .columns directory"""
+    if is_columnar_path(filename):
+        meta, tables = _load_columns(filename)
+        sessions = tables['sessions']
+        titles = meta.get('mediaTitle', [])
+        return [{'id': row[0], 'matchCount': row[1], 'confidence': row[2], 'mediaTitle': title}
+                for row, title in zip(sessions, titles)]
     with open(filename, 'r') as f:
         return json.load(f)
 
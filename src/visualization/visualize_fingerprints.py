@@ -18,7 +18,7 @@ from visualization.config import (AUDIO_SUPPORT, PCM_SAMPLE_RATE, PCM_CHANNELS,
                     REFRESH_RATE_30FPS, REFRESH_RATE_60FPS, 
                     _ui_refresh_interval, _playback_update_interval,
                     clean_up)
-from visualization.plot_utils import load_data
+from visualization.plot_utils import load_data, load_sessions
 from visualization.audio_player import AudioPlayer
 from visualization.plotting import create_interactive_plot, create_comparison_plot
 
@@ -27,10 +27,10 @@ def main():
     global PCM_SAMPLE_RATE, PCM_CHANNELS, PCM_FORMAT, _ui_refresh_interval, _playback_update_interval
     
     parser = argparse.ArgumentParser(description='Visualize audio fingerprints with audio playback')
-    parser.add_argument('--source', type=str, help='Source audio fingerprint JSON file')
-    parser.add_argument('--query', type=str, help='Query audio fingerprint JSON file')
+    parser.add_argument('--source', type=str, help='Source audio fingerprint JSON file or .columns directory')
+    parser.add_argument('--query', type=str, help='Query audio fingerprint JSON file or .columns directory')
     parser.add_argument('--output', type=str, help='Output image file')
-    parser.add_argument('--sessions', type=str, help='JSON file containing top sessions data')
+    parser.add_argument('--sessions', type=str, help='JSON file or .columns directory containing top sessions data')
     parser.add_argument('--source-audio', type=str, help='Source audio file (WAV/MP3/PCM) for playback (overrides path in JSON)')
     parser.add_argument('--query-audio', type=str, help='Query audio file (WAV/MP3/PCM) for playback (overrides path in JSON)')
     # PCM格式参数
@@ -166,8 +166,7 @@ def main():
         top_sessions = None
         if args.sessions:
             try:
-                with open(args.sessions, 'r') as f:
-                    top_sessions = json.load(f)
+                top_sessions = load_sessions(args.sessions)
                 print(f"会话数据加载成功: {len(top_sessions)} 个会话")
             except Exception as e:
                 print(f"警告: 加载会话数据文件失败: {e}")